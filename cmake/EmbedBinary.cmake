@@ -0,0 +1,41 @@
+#
+# Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+
+# Converts a binary file into a C++ header with a byte array.
+# Usage: cmake -DINPUT=<file> -DOUTPUT=<header> -DVARIABLE=<name> -P EmbedBinary.cmake
+
+if (NOT INPUT OR NOT OUTPUT OR NOT VARIABLE)
+    message(FATAL_ERROR "EmbedBinary.cmake requires INPUT, OUTPUT and VARIABLE to be defined")
+endif()
+
+file(READ "${INPUT}" contents HEX)
+string(LENGTH "${contents}" length)
+math(EXPR size "${length} / 2")
+
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${contents}")
+# Break the array into lines of 32 bytes
+string(REGEX REPLACE "((0x[0-9a-f][0-9a-f],){32})" "\\1\n    " bytes "${bytes}")
+
+file(WRITE "${OUTPUT}"
+    "// Generated from ${INPUT} by EmbedBinary.cmake, do not edit.\n"
+    "#pragma once\n\n"
+    "static const unsigned char ${VARIABLE}[${size}] = {\n    ${bytes}\n};\n")
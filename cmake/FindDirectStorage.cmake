@@ -0,0 +1,55 @@
+#
+# Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+
+
+find_package(PackageHandleStandardArgs)
+
+if (WIN32)
+
+    if (NOT DirectStorage_SEARCH_PATHS)
+        set (DirectStorage_SEARCH_PATHS
+            "${CMAKE_SOURCE_DIR}/dstorage"
+            "${CMAKE_PROJECT_DIR}/dstorage")
+    endif()
+
+    if (CMAKE_SIZEOF_VOID_P EQUAL 8)
+        find_library(DirectStorage_LIBRARY dstorage
+            PATHS ${DirectStorage_SEARCH_PATHS}
+            PATH_SUFFIXES native/lib/x64 lib/x64)
+    else()
+        find_library(DirectStorage_LIBRARY dstorage
+            PATHS ${DirectStorage_SEARCH_PATHS}
+            PATH_SUFFIXES native/lib/x86 lib/x86)
+    endif()
+
+    find_path(DirectStorage_INCLUDE_DIR dstorage.h
+        PATHS ${DirectStorage_SEARCH_PATHS}
+        PATH_SUFFIXES native/include include)
+endif()
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(DirectStorage
+    REQUIRED_VARS
+        DirectStorage_INCLUDE_DIR
+        DirectStorage_LIBRARY
+)
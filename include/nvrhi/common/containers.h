@@ -99,6 +99,22 @@ struct static_vector : private std::array<T, _max_elements>
     size_t size() const noexcept                { return current_size; }
     constexpr size_t max_size() const noexcept  { return max_elements; }
 
+    bool operator== (const static_vector& other) const
+    {
+        if (current_size != other.current_size)
+            return false;
+
+        for (size_t i = 0; i < current_size; i++)
+        {
+            if (!((*this)[i] == other[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool operator!= (const static_vector& other) const { return !(*this == other); }
+
     void fill(const T& value) noexcept
     {
         base::fill(value);
@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+// Hashing functions used by the NVRHI caches. They are based on wyhash by Wang Yi (public domain),
+// which mixes values with a 64x64->128 bit multiplication and is both fast and well distributed.
+// The results are deterministic but may change between NVRHI versions, so persisted hashes must be versioned.
+
+namespace nvrhi
+{
+    static constexpr uint64_t c_HashSecret[4] = {
+        0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+    // Computes the full 128-bit product of a and b, returning the low half in a and the high half in b.
+    inline void hash_mum(uint64_t& a, uint64_t& b)
+    {
+#if defined(__SIZEOF_INT128__)
+        const __uint128_t r = __uint128_t(a) * b;
+        a = uint64_t(r);
+        b = uint64_t(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128(a, b, &b);
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+        const uint64_t lo = a * b;
+        b = __umulh(a, b);
+        a = lo;
+#else
+        const uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+        const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        const uint64_t t = rl + (rm0 << 32);
+        uint64_t carry = t < rl;
+        const uint64_t lo = t + (rm1 << 32);
+        carry += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+    }
+
+    // Mixes two 64-bit values into one.
+    inline uint64_t hash_mix(uint64_t a, uint64_t b)
+    {
+        hash_mum(a, b);
+        return a ^ b;
+    }
+
+    // Hashes a block of memory.
+    inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0)
+    {
+        auto read64 = [](const uint8_t* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; };
+        auto read32 = [](const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return uint64_t(v); };
+
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        seed ^= hash_mix(seed ^ c_HashSecret[0], c_HashSecret[1]);
+
+        uint64_t a = 0;
+        uint64_t b = 0;
+
+        if (size <= 16)
+        {
+            if (size >= 4)
+            {
+                const size_t offset = (size >> 3) << 2;
+                a = (read32(p) << 32) | read32(p + offset);
+                b = (read32(p + size - 4) << 32) | read32(p + size - 4 - offset);
+            }
+            else if (size > 0)
+            {
+                a = (uint64_t(p[0]) << 16) | (uint64_t(p[size >> 1]) << 8) | uint64_t(p[size - 1]);
+            }
+        }
+        else
+        {
+            size_t remaining = size;
+
+            if (remaining > 48)
+            {
+                uint64_t seed1 = seed;
+                uint64_t seed2 = seed;
+                do
+                {
+                    seed = hash_mix(read64(p) ^ c_HashSecret[1], read64(p + 8) ^ seed);
+                    seed1 = hash_mix(read64(p + 16) ^ c_HashSecret[2], read64(p + 24) ^ seed1);
+                    seed2 = hash_mix(read64(p + 32) ^ c_HashSecret[3], read64(p + 40) ^ seed2);
+                    p += 48;
+                    remaining -= 48;
+                } while (remaining > 48);
+                seed ^= seed1 ^ seed2;
+            }
+
+            while (remaining > 16)
+            {
+                seed = hash_mix(read64(p) ^ c_HashSecret[1], read64(p + 8) ^ seed);
+                p += 16;
+                remaining -= 16;
+            }
+
+            // The last 16 bytes of the block, which may overlap the bytes that were already processed
+            a = read64(p + remaining - 16);
+            b = read64(p + remaining - 8);
+        }
+
+        a ^= c_HashSecret[1];
+        b ^= seed;
+        hash_mum(a, b);
+        return hash_mix(a ^ c_HashSecret[0] ^ uint64_t(size), b ^ c_HashSecret[1]);
+    }
+
+    // Combines the std::hash of a value into an existing hash. Unlike XOR-based combining,
+    // the result depends on the order of the values, and equal values don't cancel out.
+    template <class T>
+    void hash_combine(size_t& seed, const T& v)
+    {
+        std::hash<T> hasher;
+        seed = size_t(hash_mix(uint64_t(seed) ^ c_HashSecret[0], uint64_t(hasher(v)) ^ c_HashSecret[1]));
+    }
+}
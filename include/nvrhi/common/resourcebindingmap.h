@@ -86,9 +86,10 @@ namespace std
     {
         std::size_t operator()(nvrhi::TextureBindingKey const& s) const noexcept
         {
-            return std::hash<nvrhi::Format>()(s.format)
-                ^ std::hash<nvrhi::TextureSubresourceSet>()(s)
-                ^ std::hash<bool>()(s.isReadOnlyDSV);
+            size_t hash = std::hash<nvrhi::TextureSubresourceSet>()(s);
+            nvrhi::hash_combine(hash, s.format);
+            nvrhi::hash_combine(hash, s.isReadOnlyDSV);
+            return hash;
         }
     };
 
@@ -96,8 +97,10 @@ namespace std
     {
         std::size_t operator()(nvrhi::BufferBindingKey const& s) const noexcept
         {
-            return std::hash<nvrhi::Format>()(s.format)
-                ^ std::hash<nvrhi::BufferRange>()(s);
+            size_t hash = std::hash<nvrhi::BufferRange>()(s);
+            nvrhi::hash_combine(hash, s.format);
+            nvrhi::hash_combine(hash, s.type);
+            return hash;
         }
     };
 }
\ No newline at end of file
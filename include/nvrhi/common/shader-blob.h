@@ -0,0 +1,149 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace nvrhi 
+{
+    // Shader permutation blobs are produced by the shaderCompiler tool and contain multiple binaries
+    // of the same shader compiled with different sets of defines (permutations).
+    //
+    // Version 1 ("NVSP") is a flat sequence of ShaderBlobEntry headers, each followed by the permutation
+    // string and the binary. Finding a permutation requires a linear scan.
+    //
+    // Version 2 ("NVS2") starts with a ShaderBlobHeader, followed by an index of ShaderBlobIndexEntry items
+    // sorted by the permutation hash, the permutation strings, and the binaries aligned to c_ShaderBlobAlignment.
+    // A permutation is found with a binary search over the index, and the file can be used directly
+    // from a memory mapping. All offsets are relative to the start of the blob.
+    //
+    // Version 2 blobs can be compressed, which is indicated by c_ShaderBlobFlagCompressed in the header.
+    // In a compressed blob, the index is followed by a ShaderBlobDictionary, and every binary is stored as
+    // a ShaderBlobCompressedPayload followed by the binary compressed in the LZ4 block format.
+    // The dictionary is a piece of a typical binary from the same blob that is used as an external LZ4 dictionary
+    // for all the binaries, which helps because the permutations of one shader have a lot in common.
+    // Compressed blobs need to be opened with utils::ShaderBlobFile, which decompresses the binaries.
+    //
+    // The permutation string is the list of defines in the order they were specified, separated by spaces,
+    // for example "USE_SHADOWS=1 QUALITY=2".
+
+    struct ShaderConstant
+    {
+        const char* name;
+        const char* value; // can be null for defines without a value
+    };
+
+    struct ShaderBlobEntry
+    {
+        uint32_t permutationSize;
+        uint32_t dataSize;
+    };
+
+    constexpr uint32_t c_ShaderBlobAlignment = 16;
+
+    struct ShaderBlobHeader
+    {
+        char signature[4]; // "NVS2"
+        uint32_t permutationCount;
+        uint32_t payloadAlignment;
+        uint32_t flags;
+    };
+
+    constexpr uint32_t c_ShaderBlobFlagCompressed = 0x1;
+
+    struct ShaderBlobIndexEntry
+    {
+        uint64_t permutationHash;
+        uint32_t permutationOffset;
+        uint32_t permutationSize;
+        uint64_t dataOffset;
+        uint64_t dataSize;
+    };
+
+    struct ShaderBlobDictionary
+    {
+        uint64_t offset;
+        uint64_t size; // can be 0
+    };
+
+    struct ShaderBlobCompressedPayload
+    {
+        uint32_t uncompressedSize;
+        uint32_t reserved;
+    };
+
+    // LZ4 offsets are 16-bit, so matches can't reach further back than this
+    constexpr size_t c_ShaderBlobMaxDictionarySize = 65535;
+
+    static_assert(sizeof(ShaderBlobHeader) == 16, "The blob layout must not depend on the compiler");
+    static_assert(sizeof(ShaderBlobIndexEntry) == 32, "The blob layout must not depend on the compiler");
+    static_assert(sizeof(ShaderBlobDictionary) == 16, "The blob layout must not depend on the compiler");
+    static_assert(sizeof(ShaderBlobCompressedPayload) == 8, "The blob layout must not depend on the compiler");
+
+    // The hash used in the version 2 index: 64-bit FNV-1a. It is part of the file format and must never change.
+    inline uint64_t hashShaderPermutation(const char* permutation, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= uint8_t(permutation[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Returns true if the data starts with the signature of a version 1 or version 2 blob
+    // and (for version 2) the index fits into the data.
+    NVRHI_API bool isValidShaderBlob(const void* blob, size_t blobSize);
+
+    // Finds the binary for a permutation in a blob of either version. The returned pointer points into the blob.
+    // A blob that is not a permutation blob is treated as a single binary with no permutations.
+    // Returns false for compressed blobs.
+    NVRHI_API bool findPermutationInBlob(
+        const void* blob,
+        size_t blobSize,
+        const ShaderConstant* constants,
+        uint32_t numConstants,
+        const void** pBinary,
+        size_t* pSize);
+
+    // Compresses a binary in the LZ4 block format, optionally using a dictionary (up to c_ShaderBlobMaxDictionarySize bytes)
+    // that the decompressor must also be given.
+    NVRHI_API std::vector<uint8_t> compressShaderBinary(
+        const void* data,
+        size_t size,
+        const void* dictionary,
+        size_t dictionarySize);
+
+    // Decompresses an LZ4 block. Returns false if the data is corrupted or doesn't decompress into exactly 'dstSize' bytes.
+    NVRHI_API bool decompressShaderBinary(
+        const void* src,
+        size_t srcSize,
+        void* dst,
+        size_t dstSize,
+        const void* dictionary,
+        size_t dictionarySize);
+}
@@ -41,6 +41,10 @@ namespace nvrhi::d3d11
     {
         IMessageCallback* messageCallback = nullptr;
         ID3D11DeviceContext* context = nullptr;
+
+        // Size of the dynamic buffer that volatile constant buffers are sub-allocated from, if the device supports
+        // D3D11.1 constant buffer offsetting. Set to 0 to give each volatile buffer its own resource instead.
+        uint32_t volatileConstantBufferRingSize = 4 * 1024 * 1024;
     };
 
     NVRHI_API DeviceHandle createDevice(const DeviceDesc& desc);
@@ -30,6 +30,11 @@
 
 #include <d3d12.h>
 
+// DirectStorage interfaces, declared in dstorage.h
+struct IDStorageFactory;
+struct IDStorageFile;
+struct IDStorageQueue;
+
 namespace nvrhi
 {
     namespace ObjectTypes
@@ -75,6 +80,8 @@ namespace nvrhi::d3d12
         virtual D3D12_CPU_DESCRIPTOR_HANDLE getCpuHandle(DescriptorIndex index) = 0;
         virtual D3D12_CPU_DESCRIPTOR_HANDLE getCpuHandleShaderVisible(DescriptorIndex index) = 0;
         virtual D3D12_GPU_DESCRIPTOR_HANDLE getGpuHandle(DescriptorIndex index) = 0;
+        // The native heaps are created on the first allocation and replaced when the heap grows,
+        // so these return null until a descriptor has been allocated
         [[nodiscard]] virtual ID3D12DescriptorHeap* getHeap() const = 0;
         [[nodiscard]] virtual ID3D12DescriptorHeap* getShaderVisibleHeap() const = 0;
 
@@ -92,6 +99,101 @@ namespace nvrhi::d3d12
         Sampler
     };
 
+    // Describes the state of one of the heaps that the device places resources into
+    // when DeviceDesc::enablePlacedResourcePools is set.
+    struct PlacedResourceHeapStatistics
+    {
+        HeapHandle heap;
+        uint64_t usedBytes = 0;
+        uint64_t largestFreeRange = 0;
+        uint32_t numAllocations = 0;
+        uint32_t numFreeRanges = 0;
+    };
+
+    enum class DirectStorageSourceType : uint8_t
+    {
+        File,
+        Memory
+    };
+
+    enum class DirectStorageCompression : uint8_t
+    {
+        None,
+        // Decompressed on the GPU when the DirectStorage runtime supports it, on the CPU otherwise
+        GDeflate
+    };
+
+    struct DirectStorageQueueDesc
+    {
+        // Factory obtained from DStorageGetFactory; it's only used to create the queue.
+        IDStorageFactory* factory = nullptr;
+        DirectStorageSourceType sourceType = DirectStorageSourceType::File;
+        // Maximum number of requests in the queue, must be between 128 and 8192 (DSTORAGE_MIN/MAX_QUEUE_CAPACITY)
+        uint16_t capacity = 1024;
+        const char* debugName = nullptr;
+
+        DirectStorageQueueDesc& setFactory(IDStorageFactory* value) { factory = value; return *this; }
+        DirectStorageQueueDesc& setSourceType(DirectStorageSourceType value) { sourceType = value; return *this; }
+        DirectStorageQueueDesc& setCapacity(uint16_t value) { capacity = value; return *this; }
+        DirectStorageQueueDesc& setDebugName(const char* value) { debugName = value; return *this; }
+    };
+
+    // Reads data from a file or from memory straight into a buffer range or into texture subresources.
+    // Exactly one of destBuffer and destTexture must be set.
+    // For textures, the uncompressed data contains subresources starting at (mipLevel, arraySlice) in the layout
+    // returned by ID3D12Device::GetCopyableFootprints, and the request fills as many subresources as the data covers.
+    struct DirectStorageRequest
+    {
+        IDStorageFile* file = nullptr;
+        uint64_t fileOffset = 0;
+        const void* memory = nullptr;
+        uint32_t size = 0;
+
+        DirectStorageCompression compression = DirectStorageCompression::None;
+        // Size of the data after decompression, or 0 if the request is not compressed
+        uint32_t uncompressedSize = 0;
+
+        IBuffer* destBuffer = nullptr;
+        uint64_t destOffset = 0;
+
+        ITexture* destTexture = nullptr;
+        MipLevel mipLevel = 0;
+        ArraySlice arraySlice = 0;
+
+        DirectStorageRequest& setFile(IDStorageFile* value, uint64_t offset) { file = value; fileOffset = offset; return *this; }
+        DirectStorageRequest& setMemory(const void* value) { memory = value; return *this; }
+        DirectStorageRequest& setSize(uint32_t value) { size = value; return *this; }
+        DirectStorageRequest& setCompression(DirectStorageCompression value, uint32_t uncompressed) { compression = value; uncompressedSize = uncompressed; return *this; }
+        DirectStorageRequest& setDestBuffer(IBuffer* value, uint64_t offset = 0) { destBuffer = value; destOffset = offset; return *this; }
+        DirectStorageRequest& setDestTexture(ITexture* value, MipLevel mip = 0, ArraySlice slice = 0) { destTexture = value; mipLevel = mip; arraySlice = slice; return *this; }
+    };
+
+    // Wraps a DirectStorage queue. Requests write into the destination resources outside of any NVRHI command list,
+    // so the resources must be in the Common state when the requests execute. Create them with
+    // initialState = ResourceStates::Common and keepInitialState = true, and don't use them until the upload completes.
+    class IDirectStorageQueue : public IResource
+    {
+    public:
+        // Adds a request to the queue. Returns false if the request is invalid.
+        // The destination resources are kept alive until a signal enqueued after the request completes.
+        virtual bool enqueueRequest(const DirectStorageRequest& request) = 0;
+
+        // Makes the event query complete when all previously enqueued requests are finished.
+        // The query can be polled and waited upon with the regular IDevice functions.
+        virtual void enqueueSignal(IEventQuery* query) = 0;
+
+        // Starts processing the enqueued requests and signals.
+        virtual void submit() = 0;
+
+        // Makes the NVRHI queue wait on the GPU for all previously enqueued signals. Work executed on that queue
+        // afterwards can use the resources written by the requests that precede those signals.
+        virtual void queueWaitForSignals(CommandQueue waitQueue) = 0;
+
+        [[nodiscard]] virtual IDStorageQueue* getNativeQueue() const = 0;
+    };
+
+    typedef RefCountPtr<IDirectStorageQueue> DirectStorageQueueHandle;
+
     class IDevice : public nvrhi::IDevice
     {
     public:
@@ -100,6 +202,19 @@ namespace nvrhi::d3d12
         virtual GraphicsPipelineHandle createHandleForNativeGraphicsPipeline(IRootSignature* rootSignature, ID3D12PipelineState* pipelineState, const GraphicsPipelineDesc& desc, const FramebufferInfo& framebufferInfo) = 0;
         virtual MeshletPipelineHandle createHandleForNativeMeshletPipeline(IRootSignature* rootSignature, ID3D12PipelineState* pipelineState, const MeshletPipelineDesc& desc, const FramebufferInfo& framebufferInfo) = 0;
         [[nodiscard]] virtual IDescriptorHeap* getDescriptorHeap(DescriptorHeapType heapType) = 0;
+        virtual void getPlacedResourceHeapStatistics(std::vector<PlacedResourceHeapStatistics>& outStatistics) = 0;
+
+        // Returns null if NVRHI is built without DirectStorage support (NVRHI_WITH_DIRECTSTORAGE).
+        virtual DirectStorageQueueHandle createDirectStorageQueue(const DirectStorageQueueDesc& desc) = 0;
+
+        // Interop with fences owned by the application, e.g. shared fences used by CUDA or video encoders.
+        // The fence signaled by a queue reaches the instance IDs returned by executeCommandLists.
+        // queueWaitForFence makes the command lists executed next wait for the value; queueSignalFence signals the value
+        // after all command lists executed so far, including the ones queued by deferred submission.
+        [[nodiscard]] virtual ID3D12Fence* getQueueFence(CommandQueue queue) = 0;
+        virtual void queueWaitForFence(CommandQueue waitQueue, ID3D12Fence* fence, uint64_t value) = 0;
+        virtual void queueSignalFence(CommandQueue executionQueue, ID3D12Fence* fence, uint64_t value) = 0;
+        virtual uint64_t queueGetCompletedInstance(CommandQueue queue) = 0;
     };
 
     typedef RefCountPtr<IDevice> DeviceHandle;
@@ -112,11 +227,65 @@ namespace nvrhi::d3d12
         ID3D12CommandQueue* pComputeCommandQueue = nullptr;
         ID3D12CommandQueue* pCopyCommandQueue = nullptr;
 
+        // Copy queues of the other nodes of a linked adapter, element i is created with node mask (2 << i).
+        // Command lists with CommandListParameters::nodeMask selecting one of these nodes execute on its queue.
+        // Graphics and compute work only runs on node 0, see MultiGPUFeatureInfo.
+        ID3D12CommandQueue* const* ppNodeCopyCommandQueues = nullptr;
+        uint32_t numNodeCopyCommandQueues = 0;
+
+        // Initial sizes of the descriptor heaps. The heaps are created on the first allocation and grow when they are full.
         uint32_t renderTargetViewHeapSize = 1024;
         uint32_t depthStencilViewHeapSize = 1024;
         uint32_t shaderResourceViewHeapSize = 16384;
         uint32_t samplerHeapSize = 1024;
         uint32_t maxTimerQueries = 256;
+        uint32_t maxOcclusionQueries = 1024;
+        uint32_t maxPipelineStatisticsQueries = 256;
+
+        // When enabled, single descriptor allocations and releases go through small per-thread caches
+        // instead of locking the shared descriptor heap every time. The caches hold on to some
+        // descriptors, so the heaps may grow slightly larger than without them.
+        bool enableDescriptorHeapThreadCaches = false;
+
+        // When enabled, non-virtual buffers and textures are created as placed resources in heaps
+        // managed by the device instead of committed resources. Shared resources and resources
+        // larger than half of the pool heap size are still committed.
+        bool enablePlacedResourcePools = false;
+        uint64_t placedResourcePoolHeapSize = 64 * 1024 * 1024;
+
+        // When enabled and supported by the device (D3D12_OPTIONS12), barriers are recorded through
+        // ID3D12GraphicsCommandList7::Barrier with explicit sync, access and layout instead of legacy transitions.
+        // Textures in the Common and copy states share the COMMON layout, so handing them over between queues
+        // does not change their layout. Requires NVRHI to be built with headers that declare Enhanced Barriers.
+        bool enableEnhancedBarriers = false;
+
+        // When enabled, the device tracks which device-local heaps and committed resources are used by each
+        // submitted command list and evicts the least recently used ones when the video memory budget is exceeded.
+        // Evicted objects are made resident again before the command lists that use them execute.
+        // Resources in binding sets are seen whether or not the sets use trackLiveness, but resources that are only
+        // accessed through descriptor tables are not seen by the tracking and must use ResidencyPriority::Maximum
+        // to be safe from eviction.
+        bool enableResidencyManagement = false;
+
+        // When enabled, a thread owned by the device retires the command lists that have finished executing
+        // every 'backgroundGarbageCollectionInterval' microseconds, so the referenced resources may be released
+        // and destroyed on that thread. runGarbageCollection still needs to be called for the memory budget callback,
+        // but has little work left.
+        bool enableBackgroundGarbageCollection = false;
+        uint32_t backgroundGarbageCollectionInterval = 1000;
+
+        // When enabled, executeCommandLists makes the queue wait for the latest submissions on the other queues
+        // that wrote the buffers and textures used by the command lists, and for the latest submissions there
+        // that accessed the resources which the command lists write. Each dependency produces one wait, and the waits
+        // added with queueWaitForCommandList are taken into account. Only the resources that go through automatic
+        // state tracking are seen, so the ones accessed through descriptor tables or with automatic barriers disabled
+        // still need manual waits. Command lists for nodes other than 0 are not synchronized.
+        // Acceleration structure storage is synchronized between the graphics and compute queues even when disabled.
+        bool enableAutomaticQueueSync = false;
+
+        // When enabled, createDevice sends the time spent in each stage of the device initialization
+        // to the message callback with MessageSeverity::Info.
+        bool reportStartupTimes = false;
     };
 
     NVRHI_API DeviceHandle createDevice(const DeviceDesc& desc);
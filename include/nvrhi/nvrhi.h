@@ -23,11 +23,13 @@
 #pragma once
 
 #include <nvrhi/common/containers.h>
+#include <nvrhi/common/hash.h>
 #include <nvrhi/common/resource.h>
 
 #include <cstdint>
 #include <cmath>
 #include <cstring>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -62,7 +64,7 @@ namespace nvrhi
 {
     // Version of the public API provided by NVRHI.
     // Increment this when any changes to the API are made.
-    static constexpr uint32_t c_HeaderVersion = 14;
+    static constexpr uint32_t c_HeaderVersion = 35;
 
     // Verifies that the version of the implementation matches the version of the header.
     // Returns true if they match. Use this when initializing apps using NVRHI as a shared library.
@@ -292,14 +294,27 @@ namespace nvrhi
         Readback
     };
 
+    // Eviction priority hint for heaps and committed resources. Only used by the D3D12 backend,
+    // see d3d12::DeviceDesc::enableResidencyManagement. Objects with the Maximum priority are never evicted.
+    enum class ResidencyPriority : uint8_t
+    {
+        Minimum,
+        Low,
+        Normal,
+        High,
+        Maximum
+    };
+
     struct HeapDesc
     {
         uint64_t capacity = 0;
         HeapType type;
         std::string debugName;
+        ResidencyPriority residencyPriority = ResidencyPriority::Normal;
 
         constexpr HeapDesc& setCapacity(uint64_t value) { capacity = value; return *this; }
         constexpr HeapDesc& setType(HeapType value) { type = value; return *this; }
+        constexpr HeapDesc& setResidencyPriority(ResidencyPriority value) { residencyPriority = value; return *this; }
                   HeapDesc& setDebugName(const std::string& value) { debugName = value; return *this; }
     };
 
@@ -339,7 +354,15 @@ namespace nvrhi
     {
         None,
         Read,
-        Write
+        Write,
+
+        // The following modes are only valid for mapping buffers created with CpuAccessMode::Write.
+
+        // The previous contents of the buffer are not preserved. Renames the buffer on DX11 and behaves like Write elsewhere.
+        Discard,
+        // The application guarantees that it doesn't overwrite data that in-flight submissions still read,
+        // so mapping never waits for the GPU. Mostly useful for ring-style dynamic buffers.
+        NoOverwrite
     };
     
     enum class ResourceStates : uint32_t
@@ -368,6 +391,7 @@ namespace nvrhi
         ShadingRateSurface          = 0x00100000,
         OpacityMicromapWrite        = 0x00200000,
         OpacityMicromapBuildInput   = 0x00400000,
+        Predication                 = 0x00800000,
     };
 
     NVRHI_ENUM_CLASS_FLAG_OPERATORS(ResourceStates)
@@ -422,6 +446,11 @@ namespace nvrhi
         // On DX12, the texture resource is created at the time of memory binding.
         bool isVirtual = false;
 
+        // Indicates that the texture is created as a reserved (DX12) or sparse (Vulkan) resource,
+        // and memory is mapped to individual tiles using IDevice::updateTextureTileMappings.
+        // Requires Feature::TiledResources.
+        bool isTiled = false;
+
         Color clearValue;
         bool useClearValue = false;
 
@@ -432,6 +461,15 @@ namespace nvrhi
         // on command list close.
         bool keepInitialState = false;
 
+        ResidencyPriority residencyPriority = ResidencyPriority::Normal;
+
+        // GPU nodes of a linked adapter (DX12) or physical devices of a device group (Vulkan) where the texture
+        // is created and from which it can be accessed, see Feature::MultiGPU. Zero selects the default:
+        // node 0 on DX12, and one instance on every device of the group on Vulkan. On DX12, the creation mask
+        // must have exactly one bit set and the visible mask must include it. The visible mask is ignored on Vulkan.
+        uint32_t creationNodeMask = 0;
+        uint32_t visibleNodeMask = 0;
+
         constexpr TextureDesc& setWidth(uint32_t value) { width = value; return *this; }
         constexpr TextureDesc& setHeight(uint32_t value) { height = value; return *this; }
         constexpr TextureDesc& setDepth(uint32_t value) { depth = value; return *this; }
@@ -446,11 +484,73 @@ namespace nvrhi
         constexpr TextureDesc& setIsUAV(bool value) { isUAV = value; return *this; }
         constexpr TextureDesc& setIsTypeless(bool value) { isTypeless = value; return *this; }
         constexpr TextureDesc& setIsVirtual(bool value) { isVirtual = value; return *this; }
+        constexpr TextureDesc& setIsTiled(bool value) { isTiled = value; return *this; }
         constexpr TextureDesc& setClearValue(const Color& value) { clearValue = value; useClearValue = true; return *this; }
         constexpr TextureDesc& setUseClearValue(bool value) { useClearValue = value; return *this; }
         constexpr TextureDesc& setInitialState(ResourceStates value) { initialState = value; return *this; }
         constexpr TextureDesc& setKeepInitialState(bool value) { keepInitialState = value; return *this; }
         constexpr TextureDesc& setSharedResourceFlags(SharedResourceFlags value) { sharedResourceFlags = value; return *this; }
+        constexpr TextureDesc& setResidencyPriority(ResidencyPriority value) { residencyPriority = value; return *this; }
+        constexpr TextureDesc& setCreationNodeMask(uint32_t value) { creationNodeMask = value; return *this; }
+        constexpr TextureDesc& setVisibleNodeMask(uint32_t value) { visibleNodeMask = value; return *this; }
+    };
+
+    // Tiling information of a tiled texture, see IDevice::getTextureTiling.
+    // The smallest mip levels are packed into a mip tail that is mapped as a whole.
+    struct PackedMipDesc
+    {
+        uint32_t numStandardMips = 0;
+        uint32_t numPackedMips = 0;
+        uint32_t numTilesForPackedMips = 0;
+        uint32_t startTileIndexInOverallResource = 0;
+    };
+
+    struct TileShape
+    {
+        uint32_t widthInTexels = 0;
+        uint32_t heightInTexels = 0;
+        uint32_t depthInTexels = 0;
+    };
+
+    // Describes one standard (not packed) mip level of a tiled texture
+    struct SubresourceTiling
+    {
+        uint32_t widthInTiles = 0;
+        uint32_t heightInTiles = 0;
+        uint32_t depthInTiles = 0;
+        uint32_t startTileIndexInOverallResource = 0;
+    };
+
+    // Coordinates of the first tile of a region, in tiles
+    struct TiledTextureCoordinate
+    {
+        MipLevel mipLevel = 0;
+        ArraySlice arraySlice = 0;
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t z = 0;
+    };
+
+    // A box of width x height x depth tiles in a standard mip level, or, when numTiles is nonzero,
+    // a range of numTiles tiles of the packed mip tail. Packed mips are addressed through the mipLevel
+    // of the first packed mip and PackedMipDesc::numTilesForPackedMips.
+    struct TiledTextureRegion
+    {
+        uint32_t numTiles = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t depth = 0;
+    };
+
+    // Maps the tiles of numTextureRegions regions to consecutive tiles of a heap starting at byteOffsets[i].
+    // If heap is null, the tiles are unmapped.
+    struct TextureTilesMapping
+    {
+        const TiledTextureCoordinate* tiledTextureCoordinates = nullptr;
+        const TiledTextureRegion* tiledTextureRegions = nullptr;
+        const uint64_t* byteOffsets = nullptr;
+        uint32_t numTextureRegions = 0;
+        IHeap* heap = nullptr;
     };
 
     // describes a 2D section of a single mip level + single slice of a texture
@@ -479,6 +579,22 @@ namespace nvrhi
         constexpr TextureSlice& setArraySlice(ArraySlice slice) { arraySlice = slice; return *this; }
     };
 
+    // One subresource of an ICommandList::writeTextureRegions call, laid out like the data of writeTexture
+    struct TextureUploadRegion
+    {
+        MipLevel mipLevel = 0;
+        ArraySlice arraySlice = 0;
+        const void* data = nullptr;
+        size_t rowPitch = 0;
+        size_t depthPitch = 0;
+
+        constexpr TextureUploadRegion& setMipLevel(MipLevel value) { mipLevel = value; return *this; }
+        constexpr TextureUploadRegion& setArraySlice(ArraySlice value) { arraySlice = value; return *this; }
+        constexpr TextureUploadRegion& setData(const void* value) { data = value; return *this; }
+        constexpr TextureUploadRegion& setRowPitch(size_t value) { rowPitch = value; return *this; }
+        constexpr TextureUploadRegion& setDepthPitch(size_t value) { depthPitch = value; return *this; }
+    };
+
     struct TextureSubresourceSet
     {
         static constexpr MipLevel AllMipLevels = MipLevel(-1);
@@ -582,7 +698,9 @@ namespace nvrhi
     {
         uint64_t byteSize = 0;
         uint32_t structStride = 0; // if non-zero it's structured
-        uint32_t maxVersions = 0; // only valid and required to be nonzero for volatile buffers on Vulkan
+        // Only used for volatile buffers on Vulkan. Zero places the versions into a ring shared by the device,
+        // see vulkan::DeviceDesc::volatileBufferRingSize; otherwise each buffer has this many versions of its own.
+        uint32_t maxVersions = 0;
         std::string debugName;
         Format format = Format::UNKNOWN; // for typed buffer views
         bool canHaveUAVs = false;
@@ -611,8 +729,19 @@ namespace nvrhi
 
         CpuAccessMode cpuAccess = CpuAccessMode::None;
 
+        // Only used with cpuAccess = Write. Places the buffer into device-local memory that the CPU writes directly,
+        // i.e. resizable BAR memory on Vulkan or a GPU upload heap on D3D12, so that mapped writes need no copy into VRAM.
+        // Falls back to regular upload memory when Feature::DeviceLocalCpuWrite is not supported or that memory is exhausted.
+        bool preferDeviceLocal = false;
+
         SharedResourceFlags sharedResourceFlags = SharedResourceFlags::None;
 
+        ResidencyPriority residencyPriority = ResidencyPriority::Normal;
+
+        // see TextureDesc::creationNodeMask
+        uint32_t creationNodeMask = 0;
+        uint32_t visibleNodeMask = 0;
+
         constexpr BufferDesc& setByteSize(uint64_t value) { byteSize = value; return *this; }
         constexpr BufferDesc& setStructStride(uint32_t value) { structStride = value; return *this; }
         constexpr BufferDesc& setMaxVersions(uint32_t value) { maxVersions = value; return *this; }
@@ -633,6 +762,10 @@ namespace nvrhi
         constexpr BufferDesc& setInitialState(ResourceStates value) { initialState = value; return *this; }
         constexpr BufferDesc& setKeepInitialState(bool value) { keepInitialState = value; return *this; }
         constexpr BufferDesc& setCpuAccess(CpuAccessMode value) { cpuAccess = value; return *this; }
+        constexpr BufferDesc& setPreferDeviceLocal(bool value) { preferDeviceLocal = value; return *this; }
+        constexpr BufferDesc& setResidencyPriority(ResidencyPriority value) { residencyPriority = value; return *this; }
+        constexpr BufferDesc& setCreationNodeMask(uint32_t value) { creationNodeMask = value; return *this; }
+        constexpr BufferDesc& setVisibleNodeMask(uint32_t value) { visibleNodeMask = value; return *this; }
     };
 
     struct BufferRange
@@ -1003,6 +1136,32 @@ namespace nvrhi
         constexpr RasterState& enableQuadFill() { quadFillEnable = true; return *this; }
         constexpr RasterState& disableQuadFill() { quadFillEnable = false; return *this; }
         constexpr RasterState& setSamplePositions(const char* x, const char* y, int count) { for (int i = 0; i < count; i++) { samplePositionsX[i] = x[i]; samplePositionsY[i] = y[i]; } return *this; }
+
+        bool operator ==(const RasterState& b) const
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                if (samplePositionsX[i] != b.samplePositionsX[i] || samplePositionsY[i] != b.samplePositionsY[i])
+                    return false;
+            }
+
+            return fillMode == b.fillMode
+                && cullMode == b.cullMode
+                && frontCounterClockwise == b.frontCounterClockwise
+                && depthClipEnable == b.depthClipEnable
+                && scissorEnable == b.scissorEnable
+                && multisampleEnable == b.multisampleEnable
+                && antialiasedLineEnable == b.antialiasedLineEnable
+                && depthBias == b.depthBias
+                && depthBiasClamp == b.depthBiasClamp
+                && slopeScaledDepthBias == b.slopeScaledDepthBias
+                && forcedSampleCount == b.forcedSampleCount
+                && programmableSamplePositionsEnable == b.programmableSamplePositionsEnable
+                && conservativeRasterEnable == b.conservativeRasterEnable
+                && quadFillEnable == b.quadFillEnable;
+        }
+
+        bool operator !=(const RasterState& b) const { return !(*this == b); }
     };
 
     //////////////////////////////////////////////////////////////////////////
@@ -1046,6 +1205,16 @@ namespace nvrhi
             constexpr StencilOpDesc& setDepthFailOp(StencilOp value) { depthFailOp = value; return *this; }
             constexpr StencilOpDesc& setPassOp(StencilOp value) { passOp = value; return *this; }
             constexpr StencilOpDesc& setStencilFunc(ComparisonFunc value) { stencilFunc = value; return *this; }
+
+            constexpr bool operator ==(const StencilOpDesc& b) const
+            {
+                return failOp == b.failOp
+                    && depthFailOp == b.depthFailOp
+                    && passOp == b.passOp
+                    && stencilFunc == b.stencilFunc;
+            }
+
+            constexpr bool operator !=(const StencilOpDesc& b) const { return !(*this == b); }
         };
 
         bool            depthTestEnable = true;
@@ -1075,7 +1244,22 @@ namespace nvrhi
         constexpr DepthStencilState& setFrontFaceStencil(const StencilOpDesc& value) { frontFaceStencil = value; return *this; }
         constexpr DepthStencilState& setBackFaceStencil(const StencilOpDesc& value) { backFaceStencil = value; return *this; }
         constexpr DepthStencilState& setDynamicStencilRef(bool value) { dynamicStencilRef = value; return *this; }
-        
+
+        constexpr bool operator ==(const DepthStencilState& b) const
+        {
+            return depthTestEnable == b.depthTestEnable
+                && depthWriteEnable == b.depthWriteEnable
+                && depthFunc == b.depthFunc
+                && stencilEnable == b.stencilEnable
+                && stencilReadMask == b.stencilReadMask
+                && stencilWriteMask == b.stencilWriteMask
+                && stencilRefValue == b.stencilRefValue
+                && dynamicStencilRef == b.dynamicStencilRef
+                && frontFaceStencil == b.frontFaceStencil
+                && backFaceStencil == b.backFaceStencil;
+        }
+
+        constexpr bool operator !=(const DepthStencilState& b) const { return !(*this == b); }
     };
 
     //////////////////////////////////////////////////////////////////////////
@@ -1151,6 +1335,22 @@ namespace nvrhi
         SamplerDesc& setAddressW(SamplerAddressMode mode) { addressW = mode; return *this; }
         SamplerDesc& setAllAddressModes(SamplerAddressMode mode) { addressU = addressV = addressW = mode; return *this; }
         SamplerDesc& setReductionType(SamplerReductionType type) { reductionType = type; return *this; }
+
+        bool operator ==(const SamplerDesc& b) const
+        {
+            return borderColor == b.borderColor
+                && maxAnisotropy == b.maxAnisotropy
+                && mipBias == b.mipBias
+                && minFilter == b.minFilter
+                && magFilter == b.magFilter
+                && mipFilter == b.mipFilter
+                && addressU == b.addressU
+                && addressV == b.addressV
+                && addressW == b.addressW
+                && reductionType == b.reductionType;
+        }
+
+        bool operator !=(const SamplerDesc& b) const { return !(*this == b); }
     };
 
     class ISampler : public IResource 
@@ -1171,6 +1371,12 @@ namespace nvrhi
         TextureSubresourceSet subresources = TextureSubresourceSet(0, 1, 0, 1);
         Format format = Format::UNKNOWN;
         bool isReadOnly = false;
+
+        // Declares that the contents of the attachment are not used after rendering into the framebuffer,
+        // which maps to VK_ATTACHMENT_STORE_OP_DONT_CARE on Vulkan and is ignored on DX11 and DX12.
+        // Vulkan render passes also end when barriers are placed between draws, so the attachment must not
+        // need barriers until the framebuffer is unbound, or its contents become undefined mid-pass.
+        bool discardAfterPass = false;
         
         constexpr FramebufferAttachment& setTexture(ITexture* t) { texture = t; return *this; }
         constexpr FramebufferAttachment& setSubresources(TextureSubresourceSet value) { subresources = value; return *this; }
@@ -1179,6 +1385,7 @@ namespace nvrhi
         constexpr FramebufferAttachment& setMipLevel(MipLevel level) { subresources.baseMipLevel = level; subresources.numMipLevels = 1; return *this; }
         constexpr FramebufferAttachment& setFormat(Format f) { format = f; return *this; }
         constexpr FramebufferAttachment& setReadOnly(bool ro) { isReadOnly = ro; return *this; }
+        constexpr FramebufferAttachment& setDiscardAfterPass(bool value) { discardAfterPass = value; return *this; }
 
         [[nodiscard]] bool valid() const { return texture != nullptr; }
     };
@@ -1524,6 +1731,19 @@ namespace nvrhi
             AccelStructDesc& setIsVirtual(bool value) { isVirtual = value; return *this; }
         };
 
+        // One build or update in a call to ICommandList::buildBottomLevelAccelStructs.
+        struct BottomLevelAccelStructBuild
+        {
+            IAccelStruct* accelStruct = nullptr;
+            const GeometryDesc* geometries = nullptr;
+            size_t numGeometries = 0;
+            AccelStructBuildFlags buildFlags = AccelStructBuildFlags::None;
+
+            BottomLevelAccelStructBuild& setAccelStruct(IAccelStruct* value) { accelStruct = value; return *this; }
+            BottomLevelAccelStructBuild& setGeometries(const GeometryDesc* value, size_t count) { geometries = value; numGeometries = count; return *this; }
+            BottomLevelAccelStructBuild& setBuildFlags(AccelStructBuildFlags value) { buildFlags = value; return *this; }
+        };
+
         //////////////////////////////////////////////////////////////////////////
         // rt::AccelStruct
         //////////////////////////////////////////////////////////////////////////
@@ -1610,6 +1830,16 @@ namespace nvrhi
             result.size = uint16_t(size);
             return result;
         }
+
+        // Volatile CB with a known constant block size, see BindingLayoutDesc::promoteSmallVolatileConstantBuffers
+        static BindingLayoutItem VolatileConstantBuffer(const uint32_t slot, const size_t size)
+        {
+            BindingLayoutItem result{};
+            result.slot = slot;
+            result.type = ResourceType::VolatileConstantBuffer;
+            result.size = uint16_t(size);
+            return result;
+        }
 #undef NVRHI_BINDING_LAYOUT_ITEM_INITIALIZER
     };
 
@@ -1648,12 +1878,27 @@ namespace nvrhi
         //   The motivation for such validation is that DXC maps register spaces to Vulkan descriptor sets by default.
         bool registerSpaceIsDescriptorSet = false;
 
+        // Layouts with this flag are not used with binding sets: their resources are provided at draw or dispatch time
+        // via ICommandList::setPushBindings. On Vulkan with VK_KHR_push_descriptor, they map to push descriptor sets,
+        // which cannot contain volatile constant buffers. Other backends create a binding set internally.
+        bool usePushDescriptors = false;
+
+        // When this flag is set, volatile CB items that specify their size are bound as root constants on DX12,
+        // as long as they fit into c_MaxPushConstantSize together with the push constants of the same layout.
+        // Writing such a buffer with writeBuffer then only stores the data in the command list, and binding it
+        // is a SetGraphicsRoot32BitConstants / SetComputeRoot32BitConstants call with no upload buffer traffic.
+        // The shaders don't need to change, a root constant block is accessed as a regular cbuffer.
+        // Vulkan and DX11 ignore this flag because push constants are not interchangeable with uniform buffers there.
+        bool promoteSmallVolatileConstantBuffers = false;
+
         BindingLayoutItemArray bindings;
         VulkanBindingOffsets bindingOffsets;
 
         BindingLayoutDesc& setVisibility(ShaderType value) { visibility = value; return *this; }
         BindingLayoutDesc& setRegisterSpace(uint32_t value) { registerSpace = value; return *this; }
         BindingLayoutDesc& setRegisterSpaceIsDescriptorSet(bool value) { registerSpaceIsDescriptorSet = value; return *this; }
+        BindingLayoutDesc& setUsePushDescriptors(bool value) { usePushDescriptors = value; return *this; }
+        BindingLayoutDesc& setPromoteSmallVolatileConstantBuffers(bool value) { promoteSmallVolatileConstantBuffers = value; return *this; }
         BindingLayoutDesc& addItem(const BindingLayoutItem& value) { bindings.push_back(value); return *this; }
         BindingLayoutDesc& setBindingOffsets(const VulkanBindingOffsets& value) { bindingOffsets = value; return *this; }
     };
@@ -1671,9 +1916,17 @@ namespace nvrhi
         uint32_t maxCapacity = 0;
         static_vector<BindingLayoutItem, 16> registerSpaces;
 
+        // When set, descriptor tables created with this layout reserve 'maxCapacity' descriptors up front,
+        // and resizeDescriptorTable grows or shrinks them in place: the table's descriptors don't move,
+        // nothing is copied, and the table doesn't need to be bound again.
+        // Vulkan descriptor sets always have 'maxCapacity' descriptors. With EXT_descriptor_buffer, tables behave
+        // like on DX12 instead: without this flag, they start empty and move to a new range when they grow.
+        bool reserveMaxCapacity = false;
+
         BindlessLayoutDesc& setVisibility(ShaderType value) { visibility = value; return *this; }
         BindlessLayoutDesc& setFirstSlot(uint32_t value) { firstSlot = value; return *this; }
         BindlessLayoutDesc& setMaxCapacity(uint32_t value) { maxCapacity = value; return *this; }
+        BindlessLayoutDesc& setReserveMaxCapacity(bool value) { reserveMaxCapacity = value; return *this; }
         BindlessLayoutDesc& addRegisterSpace(const BindingLayoutItem& value) { registerSpaces.push_back(value); return *this; }
     };
 
@@ -2022,10 +2275,87 @@ namespace nvrhi
         RasterState rasterState;
         SinglePassStereoState singlePassStereo;
 
+        // When set, the fields listed in DynamicRenderState are ignored by the graphics pipeline and taken from
+        // GraphicsState::dynamicRenderState at draw time instead, so that pipelines which only differ in those fields
+        // are not needed. The primitive type can only change within the topology class (points, lines, triangles,
+        // patches) of GraphicsPipelineDesc::primType. Requires Feature::ExtendedDynamicState.
+        bool extendedDynamicState = false;
+
         constexpr RenderState& setBlendState(const BlendState& value) { blendState = value; return *this; }
         constexpr RenderState& setDepthStencilState(const DepthStencilState& value) { depthStencilState = value; return *this; }
         constexpr RenderState& setRasterState(const RasterState& value) { rasterState = value; return *this; }
         constexpr RenderState& setSinglePassStereoState(const SinglePassStereoState& value) { singlePassStereo = value; return *this; }
+        constexpr RenderState& setExtendedDynamicState(bool value) { extendedDynamicState = value; return *this; }
+
+        bool operator ==(const RenderState& b) const
+        {
+            return blendState == b.blendState
+                && depthStencilState == b.depthStencilState
+                && rasterState == b.rasterState
+                && singlePassStereo == b.singlePassStereo
+                && extendedDynamicState == b.extendedDynamicState;
+        }
+
+        bool operator !=(const RenderState& b) const { return !(*this == b); }
+    };
+
+    // Per-draw render state for pipelines created with RenderState::extendedDynamicState.
+    // The stencil masks and reference value stay in DepthStencilState.
+    struct DynamicRenderState
+    {
+        PrimitiveType primType = PrimitiveType::TriangleList;
+        RasterCullMode cullMode = RasterCullMode::Back;
+        bool frontCounterClockwise = false;
+        bool depthTestEnable = true;
+        bool depthWriteEnable = true;
+        ComparisonFunc depthFunc = ComparisonFunc::Less;
+        bool stencilEnable = false;
+        DepthStencilState::StencilOpDesc frontFaceStencil;
+        DepthStencilState::StencilOpDesc backFaceStencil;
+
+        constexpr DynamicRenderState& setPrimType(PrimitiveType value) { primType = value; return *this; }
+        constexpr DynamicRenderState& setCullMode(RasterCullMode value) { cullMode = value; return *this; }
+        constexpr DynamicRenderState& setFrontCounterClockwise(bool value) { frontCounterClockwise = value; return *this; }
+        constexpr DynamicRenderState& setDepthTestEnable(bool value) { depthTestEnable = value; return *this; }
+        constexpr DynamicRenderState& setDepthWriteEnable(bool value) { depthWriteEnable = value; return *this; }
+        constexpr DynamicRenderState& setDepthFunc(ComparisonFunc value) { depthFunc = value; return *this; }
+        constexpr DynamicRenderState& setStencilEnable(bool value) { stencilEnable = value; return *this; }
+        constexpr DynamicRenderState& setFrontFaceStencil(const DepthStencilState::StencilOpDesc& value) { frontFaceStencil = value; return *this; }
+        constexpr DynamicRenderState& setBackFaceStencil(const DepthStencilState::StencilOpDesc& value) { backFaceStencil = value; return *this; }
+
+        // Copies the dynamic fields from a pipeline description, which is convenient when converting existing pipelines
+        constexpr DynamicRenderState& setFromRenderState(PrimitiveType primitiveType, const RenderState& renderState)
+        {
+            primType = primitiveType;
+            cullMode = renderState.rasterState.cullMode;
+            frontCounterClockwise = renderState.rasterState.frontCounterClockwise;
+            depthTestEnable = renderState.depthStencilState.depthTestEnable;
+            depthWriteEnable = renderState.depthStencilState.depthWriteEnable;
+            depthFunc = renderState.depthStencilState.depthFunc;
+            stencilEnable = renderState.depthStencilState.stencilEnable;
+            frontFaceStencil = renderState.depthStencilState.frontFaceStencil;
+            backFaceStencil = renderState.depthStencilState.backFaceStencil;
+            return *this;
+        }
+
+        bool operator ==(const DynamicRenderState& other) const
+        {
+            auto stencilEqual = [](const DepthStencilState::StencilOpDesc& a, const DepthStencilState::StencilOpDesc& b) {
+                return a.failOp == b.failOp && a.depthFailOp == b.depthFailOp && a.passOp == b.passOp && a.stencilFunc == b.stencilFunc;
+            };
+
+            return primType == other.primType
+                && cullMode == other.cullMode
+                && frontCounterClockwise == other.frontCounterClockwise
+                && depthTestEnable == other.depthTestEnable
+                && depthWriteEnable == other.depthWriteEnable
+                && depthFunc == other.depthFunc
+                && stencilEnable == other.stencilEnable
+                && stencilEqual(frontFaceStencil, other.frontFaceStencil)
+                && stencilEqual(backFaceStencil, other.backFaceStencil);
+        }
+
+        bool operator !=(const DynamicRenderState& other) const { return !(*this == other); }
     };
 
     enum class VariableShadingRate : uint8_t
@@ -2103,6 +2433,19 @@ namespace nvrhi
         GraphicsPipelineDesc& setRenderState(const RenderState& value) { renderState = value; return *this; }
         GraphicsPipelineDesc& setVariableRateShadingState(const VariableRateShadingState& value) { shadingRateState = value; return *this; }
         GraphicsPipelineDesc& addBindingLayout(IBindingLayout* layout) { bindingLayouts.push_back(layout); return *this; }
+
+        bool operator ==(const GraphicsPipelineDesc& b) const
+        {
+            return primType == b.primType
+                && patchControlPoints == b.patchControlPoints
+                && inputLayout == b.inputLayout
+                && VS == b.VS && HS == b.HS && DS == b.DS && GS == b.GS && PS == b.PS
+                && renderState == b.renderState
+                && shadingRateState == b.shadingRateState
+                && bindingLayouts == b.bindingLayouts;
+        }
+
+        bool operator !=(const GraphicsPipelineDesc& b) const { return !(*this == b); }
     };
 
     class IGraphicsPipeline : public IResource 
@@ -2122,6 +2465,9 @@ namespace nvrhi
 
         ComputePipelineDesc& setComputeShader(IShader* value) { CS = value; return *this; }
         ComputePipelineDesc& addBindingLayout(IBindingLayout* layout) { bindingLayouts.push_back(layout); return *this; }
+
+        bool operator ==(const ComputePipelineDesc& b) const { return CS == b.CS && bindingLayouts == b.bindingLayouts; }
+        bool operator !=(const ComputePipelineDesc& b) const { return !(*this == b); }
     };
 
     class IComputePipeline : public IResource 
@@ -2152,6 +2498,16 @@ namespace nvrhi
         MeshletPipelineDesc& setFragmentShader(IShader* value) { PS = value; return *this; }
         MeshletPipelineDesc& setRenderState(const RenderState& value) { renderState = value; return *this; }
         MeshletPipelineDesc& addBindingLayout(IBindingLayout* layout) { bindingLayouts.push_back(layout); return *this; }
+
+        bool operator ==(const MeshletPipelineDesc& b) const
+        {
+            return primType == b.primType
+                && AS == b.AS && MS == b.MS && PS == b.PS
+                && renderState == b.renderState
+                && bindingLayouts == b.bindingLayouts;
+        }
+
+        bool operator !=(const MeshletPipelineDesc& b) const { return !(*this == b); }
     };
 
     class IMeshletPipeline : public IResource
@@ -2173,6 +2529,49 @@ namespace nvrhi
     class ITimerQuery : public IResource { };
     typedef RefCountPtr<ITimerQuery> TimerQueryHandle;
 
+    struct OcclusionQueryDesc
+    {
+        // Binary queries only report whether any samples have passed (0 or nonzero), which is cheaper on some GPUs
+        // and is enough for predication. Counted queries report the exact number of samples.
+        bool binary = false;
+
+        constexpr OcclusionQueryDesc& setBinary(bool value) { binary = value; return *this; }
+    };
+
+    class IOcclusionQuery : public IResource
+    {
+    public:
+        [[nodiscard]] virtual const OcclusionQueryDesc& getDesc() const = 0;
+    };
+    typedef RefCountPtr<IOcclusionQuery> OcclusionQueryHandle;
+
+    // The field order matches D3D12_QUERY_DATA_PIPELINE_STATISTICS and the order of Vulkan pipeline statistics,
+    // so the values can be read from a single layout on every backend.
+    struct PipelineStatistics
+    {
+        uint64_t inputAssemblyVertices = 0;
+        uint64_t inputAssemblyPrimitives = 0;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t geometryShaderInvocations = 0;
+        uint64_t geometryShaderPrimitives = 0;
+        uint64_t clippingInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t pixelShaderInvocations = 0;
+        uint64_t hullShaderInvocations = 0;
+        uint64_t domainShaderInvocations = 0;
+        uint64_t computeShaderInvocations = 0;
+    };
+
+    class IPipelineStatisticsQuery : public IResource { };
+    typedef RefCountPtr<IPipelineStatisticsQuery> PipelineStatisticsQueryHandle;
+
+    // Defines when draws and dispatches are skipped by ICommandList::setPredication, depending on the predicate value.
+    enum class PredicationOp : uint8_t
+    {
+        SkipIfZero,
+        SkipIfNotZero
+    };
+
     struct VertexBufferBinding
     {
         IBuffer* buffer = nullptr;
@@ -2222,6 +2621,8 @@ namespace nvrhi
         VariableRateShadingState shadingRateState;
         Color blendConstantColor{};
         uint8_t dynamicStencilRefValue = 0;
+        // Only used when the pipeline was created with RenderState::extendedDynamicState
+        DynamicRenderState dynamicRenderState;
 
         BindingSetVector bindings;
 
@@ -2229,6 +2630,8 @@ namespace nvrhi
         IndexBufferBinding indexBuffer;
 
         IBuffer* indirectParams = nullptr;
+        // Buffer that contains the draw count for drawIndirectCount and drawIndexedIndirectCount, as a uint32
+        IBuffer* indirectCountBuffer = nullptr;
 
         GraphicsState& setPipeline(IGraphicsPipeline* value) { pipeline = value; return *this; }
         GraphicsState& setFramebuffer(IFramebuffer* value) { framebuffer = value; return *this; }
@@ -2236,12 +2639,29 @@ namespace nvrhi
         GraphicsState& setShadingRateState(const VariableRateShadingState& value) { shadingRateState = value; return *this; }
         GraphicsState& setBlendColor(const Color& value) { blendConstantColor = value; return *this; }
         GraphicsState& setDynamicStencilRefValue(uint8_t value) { dynamicStencilRefValue = value; return *this; }
+        GraphicsState& setDynamicRenderState(const DynamicRenderState& value) { dynamicRenderState = value; return *this; }
         GraphicsState& addBindingSet(IBindingSet* value) { bindings.push_back(value); return *this; }
         GraphicsState& addVertexBuffer(const VertexBufferBinding& value) { vertexBuffers.push_back(value); return *this; }
         GraphicsState& setIndexBuffer(const IndexBufferBinding& value) { indexBuffer = value; return *this; }
         GraphicsState& setIndirectParams(IBuffer* value) { indirectParams = value; return *this; }
+        GraphicsState& setIndirectCountBuffer(IBuffer* value) { indirectCountBuffer = value; return *this; }
     };
 
+    // An immutable graphics state that is baked once with IDevice::createGraphicsStateBlock.
+    // The block keeps references to all objects used in the state, and the backends precompute the parts
+    // of setGraphicsState that do not depend on the previous state. Binding the same block again with
+    // ICommandList::setGraphicsStateBlock is a single pointer compare unless something else invalidated the state.
+    // Per-draw variation should go through DrawArguments and setPushConstants instead of new blocks.
+    class IGraphicsStateBlock : public IResource
+    {
+    public:
+        [[nodiscard]] virtual const GraphicsState& getState() const = 0;
+        // Hash of the object pointers and parameters in the state, computed when the block is created.
+        [[nodiscard]] virtual uint64_t getHash() const = 0;
+    };
+
+    typedef RefCountPtr<IGraphicsStateBlock> GraphicsStateBlockHandle;
+
     struct DrawArguments
     {
         uint32_t vertexCount = 0;
@@ -2285,6 +2705,108 @@ namespace nvrhi
         constexpr DrawIndexedIndirectArguments& setStartInstanceLocation(uint32_t value) { startInstanceLocation = value; return *this; }
     };
 
+    // A batch of draws for ICommandList::drawMulti and drawIndexedMulti, which all use the current graphics state.
+    // Optionally, each draw can set its own push constants and replace one binding set of the state.
+    struct MultiDrawArguments
+    {
+        const DrawArguments* args = nullptr;
+        uint32_t drawCount = 0;
+
+        // Push constants for each draw, pushConstantsByteSize bytes at pushConstantsStride intervals.
+        // The size must match the push constants expected by the pipeline.
+        const void* pushConstants = nullptr;
+        uint32_t pushConstantsByteSize = 0;
+        uint32_t pushConstantsStride = 0;
+
+        // Binding set for each draw, which replaces element bindingSetIndex of GraphicsState::bindings.
+        // The sets must use the layout of that element, and cannot contain UAVs.
+        IBindingSet* const* bindingSets = nullptr;
+        uint32_t bindingSetIndex = 0;
+
+        MultiDrawArguments& setArgs(const DrawArguments* value, uint32_t count) { args = value; drawCount = count; return *this; }
+        MultiDrawArguments& setPushConstants(const void* data, uint32_t byteSize, uint32_t stride)
+            { pushConstants = data; pushConstantsByteSize = byteSize; pushConstantsStride = stride; return *this; }
+        MultiDrawArguments& setBindingSets(IBindingSet* const* value, uint32_t index) { bindingSets = value; bindingSetIndex = index; return *this; }
+    };
+
+    enum class IndirectArgumentType : uint8_t
+    {
+        Draw,           // DrawIndirectArguments
+        DrawIndexed,    // DrawIndexedIndirectArguments
+        Dispatch,       // 3x uint32_t group counts
+        VertexBuffer,   // IndirectVertexBufferArguments
+        IndexBuffer,    // IndirectIndexBufferArguments
+        PushConstants   // numPushConstantValues 32-bit values
+    };
+
+    struct IndirectArgumentDesc
+    {
+        IndirectArgumentType type = IndirectArgumentType::Draw;
+        // Used with IndirectArgumentType::VertexBuffer
+        uint32_t vertexBufferSlot = 0;
+        // Used with IndirectArgumentType::PushConstants, both are in 32-bit values
+        uint32_t pushConstantOffset = 0;
+        uint32_t numPushConstantValues = 0;
+
+        IndirectArgumentDesc& setType(IndirectArgumentType value) { type = value; return *this; }
+        IndirectArgumentDesc& setVertexBufferSlot(uint32_t value) { vertexBufferSlot = value; return *this; }
+        IndirectArgumentDesc& setPushConstants(uint32_t offset, uint32_t count) { pushConstantOffset = offset; numPushConstantValues = count; return *this; }
+
+        // Returns the size of the argument in the argument buffer
+        [[nodiscard]] NVRHI_API uint32_t getByteSize() const;
+    };
+
+    // The buffer addresses in these structures are native GPU virtual addresses,
+    // such as ID3D12Resource::GetGPUVirtualAddress. NVRHI doesn't track the state of the buffers they point to.
+    struct IndirectVertexBufferArguments
+    {
+        uint64_t gpuAddress = 0;
+        uint32_t byteSize = 0;
+        uint32_t byteStride = 0;
+    };
+
+    struct IndirectIndexBufferArguments
+    {
+        uint64_t gpuAddress = 0;
+        uint32_t byteSize = 0;
+        uint32_t format = 0; // Native value of Format::R16_UINT or R32_UINT, see ICommandSignature::getNativeIndexFormat
+    };
+
+    // Describes the layout of one command in an argument buffer for ICommandList::executeIndirect.
+    // Command signatures are only implemented on DX12, where they map to ID3D12CommandSignature;
+    // Vulkan and DX11 report Feature::CommandSignatures as unsupported.
+    // The last argument must be the Draw, DrawIndexed or Dispatch, and it must be the only one of those.
+    struct CommandSignatureDesc
+    {
+        std::vector<IndirectArgumentDesc> arguments;
+        // Distance between commands in the argument buffer, or 0 to pack them tightly
+        uint32_t byteStride = 0;
+        // The pipeline whose push constants are modified by PushConstants arguments. Only needed when there are such arguments,
+        // and the signature can then only be used with pipelines that have the same binding layouts.
+        IGraphicsPipeline* graphicsPipeline = nullptr;
+        IComputePipeline* computePipeline = nullptr;
+
+        CommandSignatureDesc& addArgument(const IndirectArgumentDesc& value) { arguments.push_back(value); return *this; }
+        CommandSignatureDesc& setByteStride(uint32_t value) { byteStride = value; return *this; }
+        CommandSignatureDesc& setGraphicsPipeline(IGraphicsPipeline* value) { graphicsPipeline = value; return *this; }
+        CommandSignatureDesc& setComputePipeline(IComputePipeline* value) { computePipeline = value; return *this; }
+
+        // Returns byteStride, or the size of the tightly packed arguments if byteStride is 0
+        [[nodiscard]] NVRHI_API uint32_t getCommandByteStride() const;
+    };
+
+    class ICommandSignature : public IResource
+    {
+    public:
+        [[nodiscard]] virtual const CommandSignatureDesc& getDesc() const = 0;
+
+        // Returns the value to write into IndirectIndexBufferArguments::format for an index format,
+        // or 0 if the format cannot be used for index buffers.
+        [[nodiscard]] virtual uint32_t getNativeIndexFormat(Format format) const = 0;
+    };
+
+    typedef RefCountPtr<ICommandSignature> CommandSignatureHandle;
+
     struct ComputeState
     {
         IComputePipeline* pipeline = nullptr;
@@ -2309,6 +2831,8 @@ namespace nvrhi
         BindingSetVector bindings;
 
         IBuffer* indirectParams = nullptr;
+        // Buffer that contains the dispatch count for dispatchMeshIndirectCount, as a uint32
+        IBuffer* indirectCountBuffer = nullptr;
 
         MeshletState& setPipeline(IMeshletPipeline* value) { pipeline = value; return *this; }
         MeshletState& setFramebuffer(IFramebuffer* value) { framebuffer = value; return *this; }
@@ -2316,6 +2840,7 @@ namespace nvrhi
         MeshletState& setBlendColor(const Color& value) { blendConstantColor = value; return *this; }
         MeshletState& addBindingSet(IBindingSet* value) { bindings.push_back(value); return *this; }
         MeshletState& setIndirectParams(IBuffer* value) { indirectParams = value; return *this; }
+        MeshletState& setIndirectCountBuffer(IBuffer* value) { indirectCountBuffer = value; return *this; }
         MeshletState& setDynamicStencilRefValue(uint8_t value) { dynamicStencilRefValue = value; return *this; }
     };
 
@@ -2353,6 +2878,8 @@ namespace nvrhi
             PipelineHitGroupDesc& setIsProceduralPrimitive(bool value) { isProceduralPrimitive = value; return *this; }
         };
 
+        class IPipeline;
+
         struct PipelineDesc
         {
             std::vector<PipelineShaderDesc> shaders;
@@ -2363,6 +2890,16 @@ namespace nvrhi
             uint32_t maxRecursionDepth = 1;
             int32_t hlslExtensionsUAV = -1;
 
+            // Compile the pipeline as a library - a state object collection on D3D12 or a pipeline library on Vulkan.
+            // Libraries cannot be used to create shader tables, they are only linked into other pipelines.
+            // Requires Feature::RayTracingPipelineLibraries.
+            bool isLibrary = false;
+
+            // Library pipelines whose shaders and hit groups are linked into this pipeline without recompiling them.
+            // Their global binding layouts, payload size, attribute size and recursion depth must match this pipeline's.
+            // Libraries cannot be linked into other libraries.
+            std::vector<RefCountPtr<IPipeline>> libraries;
+
             PipelineDesc& addShader(const PipelineShaderDesc& value) { shaders.push_back(value); return *this; }
             PipelineDesc& addHitGroup(const PipelineHitGroupDesc& value) { hitGroups.push_back(value); return *this; }
             PipelineDesc& addBindingLayout(IBindingLayout* value) { globalBindingLayouts.push_back(value); return *this; }
@@ -2370,10 +2907,10 @@ namespace nvrhi
             PipelineDesc& setMaxAttributeSize(uint32_t value) { maxAttributeSize = value; return *this; }
             PipelineDesc& setMaxRecursionDepth(uint32_t value) { maxRecursionDepth = value; return *this; }
             PipelineDesc& setHlslExtensionsUAV(int32_t value) { hlslExtensionsUAV = value; return *this; }
+            PipelineDesc& setIsLibrary(bool value) { isLibrary = value; return *this; }
+            PipelineDesc& addLibrary(IPipeline* value) { libraries.push_back(value); return *this; }
         };
 
-        class IPipeline;
-
         class IShaderTable : public IResource
         {
         public:
@@ -2381,6 +2918,17 @@ namespace nvrhi
             virtual int addMissShader(const char* exportName, IBindingSet* bindings = nullptr) = 0;
             virtual int addHitGroup(const char* exportName, IBindingSet* bindings = nullptr) = 0;
             virtual int addCallableShader(const char* exportName, IBindingSet* bindings = nullptr) = 0;
+
+            // Replace the shader and local bindings of an existing record, identified by the index returned from add*.
+            // Unlike the add* and clear* functions, which change the table layout and make the next setRayTracingState
+            // rewrite the entire table, these only patch the modified records in the table's device-local buffer.
+            // The patch is recorded into the next command list that binds the table, so command lists using the same
+            // table must be executed in the order they were recorded.
+            // Returns false if the index is out of range or the export is not valid.
+            virtual bool setMissShader(int index, const char* exportName, IBindingSet* bindings = nullptr) = 0;
+            virtual bool setHitGroup(int index, const char* exportName, IBindingSet* bindings = nullptr) = 0;
+            virtual bool setCallableShader(int index, const char* exportName, IBindingSet* bindings = nullptr) = 0;
+
             virtual void clearMissShaders() = 0;
             virtual void clearHitShaders() = 0;
             virtual void clearCallableShaders() = 0;
@@ -2442,7 +2990,18 @@ namespace nvrhi
         VirtualResources,
         ComputeQueue,
         CopyQueue,
-        ConstantBufferRanges
+        ConstantBufferRanges,
+        CommandListBundles,
+        SplitBarriers,
+        DrawIndirectCount,
+        CommandSignatures,
+        PipelineStatisticsQueries,
+        Predication,
+        TiledResources,
+        RayTracingPipelineLibraries,
+        MultiGPU,
+        ExtendedDynamicState,
+        DeviceLocalCpuWrite
     };
 
     enum class MessageSeverity : uint8_t
@@ -2467,6 +3026,16 @@ namespace nvrhi
         uint32_t shadingRateImageTileSize;
     };
 
+    // Returned by queryFeatureSupport(Feature::MultiGPU), which is true when the device has more than one node.
+    // The multi-GPU support is limited to placing resources on nodes and moving data between them: it is not
+    // sufficient for split-frame or alternate-frame rendering. On DX12, nodes other than node 0 only run copy
+    // command lists, and there is no GPU-side synchronization between nodes. On Vulkan, command buffers can be
+    // broadcast to several devices of the group, but there are no peer memory bindings between the devices.
+    struct MultiGPUFeatureInfo
+    {
+        uint32_t numNodes = 1;
+    };
+
     // IMessageCallback should be implemented by the application.
     class IMessageCallback
     {
@@ -2484,35 +3053,356 @@ namespace nvrhi
         IMessageCallback& operator=(const IMessageCallback&) = delete;
         IMessageCallback& operator=(const IMessageCallback&&) = delete;
     };
-    
+
+    struct MemoryHeapStatistics
+    {
+        // True for memory local to the GPU: DXGI_MEMORY_SEGMENT_GROUP_LOCAL or VK_MEMORY_HEAP_DEVICE_LOCAL_BIT
+        bool deviceLocal = false;
+
+        // Size of the heap, or 0 if unknown (DX11 and DX12 don't report segment sizes)
+        uint64_t size = 0;
+
+        // Memory used by the process in this heap
+        uint64_t usage = 0;
+
+        // Amount of memory that the process can use in this heap before it should expect paging or allocation failures
+        uint64_t budget = 0;
+    };
+
+    struct MemoryStatistics
+    {
+        // Per-heap usage and budget reported by the OS or the driver. DX11 and DX12 report one local and one non-local
+        // segment through IDXGIAdapter3::QueryVideoMemoryInfo. Vulkan reports every memory heap; usage and budget
+        // are only filled in when VK_EXT_memory_budget is enabled.
+        std::vector<MemoryHeapStatistics> heaps;
+        bool budgetAvailable = false;
+
+        // Memory allocated by NVRHI for its own purposes
+        uint64_t uploadBufferBytes = 0;      // Upload chunks and rings of all command lists
+        uint64_t scratchBufferBytes = 0;     // Acceleration structure build scratch buffers
+        uint64_t descriptorHeapBytes = 0;    // Descriptor heaps, DX12 only
+
+        // Memory released by compacting BLAS'es with compactBottomLevelAccelStructs, for the BLAS'es that still exist.
+        // Only tracked by the built-in compaction in DX12 and Vulkan, i.e. without RTXMU.
+        uint64_t compactionSavedBytes = 0;
+
+        [[nodiscard]] uint64_t getUsage(bool deviceLocal) const
+        {
+            uint64_t result = 0;
+            for (const MemoryHeapStatistics& heap : heaps)
+                if (heap.deviceLocal == deviceLocal) result += heap.usage;
+            return result;
+        }
+
+        [[nodiscard]] uint64_t getBudget(bool deviceLocal) const
+        {
+            uint64_t result = 0;
+            for (const MemoryHeapStatistics& heap : heaps)
+                if (heap.deviceLocal == deviceLocal) result += heap.budget;
+            return result;
+        }
+    };
+
+    // IMemoryBudgetCallback can be implemented by the application to be notified about budget changes,
+    // see IDevice::setMemoryBudgetCallback.
+    class IMemoryBudgetCallback
+    {
+    protected:
+        IMemoryBudgetCallback() = default;
+        virtual ~IMemoryBudgetCallback() = default;
+
+    public:
+        virtual void memoryBudgetChanged(const MemoryStatistics& statistics) = 0;
+
+        IMemoryBudgetCallback(const IMemoryBudgetCallback&) = delete;
+        IMemoryBudgetCallback(const IMemoryBudgetCallback&&) = delete;
+        IMemoryBudgetCallback& operator=(const IMemoryBudgetCallback&) = delete;
+        IMemoryBudgetCallback& operator=(const IMemoryBudgetCallback&&) = delete;
+    };
+
     class IDevice;
 
     struct CommandListParameters
     {
         // A command list with enableImmediateExecution = true maps to the immediate context on DX11.
         // Two immediate command lists cannot be open at the same time, which is checked by the validation layer.
+        // Other command lists record into deferred contexts on DX11, and run when passed to executeCommandLists.
         bool enableImmediateExecution = true;
 
         // Minimum size of memory chunks created to upload data to the device on DX12.
         size_t uploadChunkSize = 64 * 1024;
 
+        // When nonzero, uploads on DX12 and Vulkan use a single persistently mapped ring buffer of this size instead of
+        // a pool of chunks that grows as needed. The size is a hard cap: when the ring is full, the CPU waits for the
+        // oldest submitted instance of the command list to finish, and uploads larger than the ring fail.
+        size_t uploadRingSize = 0;
+
         // Minimum size of memory chunks created for AS build scratch buffers.
         size_t scratchChunkSize = 64 * 1024;
 
         // Maximum total memory size used for all AS build scratch buffers owned by this command list.
         size_t scratchMaxMemory = 1024 * 1024 * 1024;
 
+        // Maximum scratch memory size used by one batch of builds in buildBottomLevelAccelStructs.
+        // Larger sets of builds are split into multiple batches, each with its own scratch allocation.
+        size_t scratchBatchSize = 64 * 1024 * 1024;
+
         // Type of the queue that this command list is to be executed on.
         // COPY and COMPUTE queues have limited subsets of methods available.
         CommandQueue queueType = CommandQueue::Graphics;
 
+        // A bundle records draw calls once and can be replayed into other command lists with ICommandList::executeBundle
+        // any number of times. It maps to a D3D12 bundle or a Vulkan secondary command buffer, see Feature::CommandListBundles.
+        // Bundles can only contain setGraphicsState, draw calls, push constants and markers, and they must be on the graphics queue.
+        // All graphics states in a bundle must use bundleFramebuffer and the same viewport state, and cannot use volatile
+        // constant buffers or variable rate shading. The resource states required by the bundle are captured when it is
+        // recorded and applied by the command list that executes it. Re-opening a bundle does not affect the command lists
+        // that already executed its previous contents.
+        bool isBundle = false;
+
+        // The framebuffer that all draw calls in a bundle render into. Required when isBundle = true, ignored otherwise.
+        IFramebuffer* bundleFramebuffer = nullptr;
+
+        // GPU nodes that execute the command list, see Feature::MultiGPU. Zero means node 0.
+        // On Vulkan, several bits may be set to broadcast the commands to multiple devices of the group.
+        // On DX12, exactly one bit may be set, and command lists for nodes other than node 0 must use the copy queue
+        // because the descriptor heaps only exist on node 0. Such command lists execute on the node's queue
+        // from DeviceDesc::pNodeCopyCommandQueues, and copies between nodes are recorded with the regular copy
+        // methods on resources whose visibleNodeMask includes the executing node.
+        // On Vulkan, resources can only be accessed by the devices in their creationNodeMask: there are no peer
+        // memory bindings, so copies between the instances of a resource on different devices are not supported.
+        // On DX12, the node queues are not covered by automatic queue synchronization, and the instances returned
+        // by executeCommandLists for them cannot be passed to queueWaitForCommandList or waitForSubmissions.
+        // Use waitForIdle to order work between nodes.
+        uint32_t nodeMask = 0;
+
+        // Enables the counters returned by ICommandList::getStatistics and summed up by IDevice::getCommandListStatistics.
+        // When disabled, the recording functions only test this flag.
+        bool enableStatistics = false;
+
+        // Defers clearTextureFloat and clearDepthStencilTexture on single mip levels of render target textures until
+        // the next setGraphicsState or setMeshletState. If the framebuffer has an attachment with exactly the cleared
+        // subresources, the clear becomes its load operation (VK_ATTACHMENT_LOAD_OP_CLEAR), otherwise it is executed
+        // before the state is set. Any other command executes the pending clears first.
+        // Only implemented on Vulkan: the DX11 and DX12 clears already use the fast clear hardware.
+        bool enableDeferredClears = false;
+
         CommandListParameters& setEnableImmediateExecution(bool value) { enableImmediateExecution = value; return *this; }
         CommandListParameters& setUploadChunkSize(size_t value) { uploadChunkSize = value; return *this; }
+        CommandListParameters& setUploadRingSize(size_t value) { uploadRingSize = value; return *this; }
         CommandListParameters& setScratchChunkSize(size_t value) { scratchChunkSize = value; return *this; }
         CommandListParameters& setScratchMaxMemory(size_t value) { scratchMaxMemory = value; return *this; }
+        CommandListParameters& setScratchBatchSize(size_t value) { scratchBatchSize = value; return *this; }
         CommandListParameters& setQueueType(CommandQueue value) { queueType = value; return *this; }
+        CommandListParameters& setIsBundle(bool value) { isBundle = value; return *this; }
+        CommandListParameters& setBundleFramebuffer(IFramebuffer* value) { bundleFramebuffer = value; return *this; }
+        CommandListParameters& setNodeMask(uint32_t value) { nodeMask = value; return *this; }
+        CommandListParameters& setEnableStatistics(bool value) { enableStatistics = value; return *this; }
+        CommandListParameters& setEnableDeferredClears(bool value) { enableDeferredClears = value; return *this; }
     };
     
+    // Memory used by a command list to upload data for writeBuffer, writeTexture and similar operations.
+    struct UploadStatistics
+    {
+        // Size of the upload ring, or the total size of all upload chunks when the ring is not used
+        uint64_t capacity = 0;
+
+        // Memory used by uploads that the GPU may still read, and its maximum over the lifetime of the command list
+        uint64_t bytesInFlight = 0;
+        uint64_t highWaterMark = 0;
+
+        // Number of times the CPU had to wait for the GPU because the upload ring was full
+        uint64_t numStalls = 0;
+    };
+
+    // Counters accumulated by a command list while it is recorded, see CommandListParameters::enableStatistics.
+    // They are reset when the command list is opened. The counters of the bundles passed to executeBundles
+    // are added to the command list that executes them, each time they are executed.
+    struct CommandListStatistics
+    {
+        // Draws (including mesh shader dispatches) and compute or ray tracing dispatches. Multi-draw and indirect calls
+        // count the draws they contain, calls with a GPU-side draw count count as one.
+        uint64_t numDraws = 0;
+        uint64_t numDispatches = 0;
+
+        // Barriers emitted by the automatic state tracking: state transitions of textures and buffers,
+        // and UAV barriers between consecutive writes in the same state
+        uint64_t numTextureTransitions = 0;
+        uint64_t numBufferTransitions = 0;
+        uint64_t numUavBarriers = 0;
+
+        // Parts of the state passed to the set*State functions (pipeline, framebuffer, binding sets, vertex and index
+        // buffers, viewports, dynamic state) that were applied, and that were skipped because they didn't change
+        uint64_t numStateChangesApplied = 0;
+        uint64_t numStateChangesSkipped = 0;
+
+        // Data written into upload memory or volatile buffer versions by writeBuffer, writeTexture and similar commands
+        uint64_t bytesUploaded = 0;
+
+        // Descriptors and push constants written while recording: push descriptors on Vulkan, descriptors for
+        // the binding sets created from push bindings on DX12, and setPushConstants data on both.
+        // Binding sets and descriptor tables are written when they are created and are not counted here.
+        uint64_t numDescriptorsWritten = 0;
+        uint64_t pushConstantBytes = 0;
+
+        // Number of distinct resources (textures, buffers, binding sets, pipelines and so on) that the command list
+        // keeps alive until it finishes executing. Each resource is counted once no matter how often it's used.
+        // Staging resources, queries and the contents of executed bundles are not included.
+        uint64_t numReferencedResources = 0;
+
+        CommandListStatistics& operator+=(const CommandListStatistics& other)
+        {
+            numDraws += other.numDraws;
+            numDispatches += other.numDispatches;
+            numTextureTransitions += other.numTextureTransitions;
+            numBufferTransitions += other.numBufferTransitions;
+            numUavBarriers += other.numUavBarriers;
+            numStateChangesApplied += other.numStateChangesApplied;
+            numStateChangesSkipped += other.numStateChangesSkipped;
+            bytesUploaded += other.bytesUploaded;
+            numDescriptorsWritten += other.numDescriptorsWritten;
+            pushConstantBytes += other.pushConstantBytes;
+            numReferencedResources += other.numReferencedResources;
+            return *this;
+        }
+    };
+
+    // Counters of the device-level object cache, see IDevice::setObjectCacheEnabled
+    struct ObjectCacheStatistics
+    {
+        struct Counters
+        {
+            // Create calls that returned a cached object, and calls that had to create a new one
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+
+            // Number of objects currently held by the cache
+            uint64_t numObjects = 0;
+        };
+
+        // Graphics, compute and meshlet pipelines
+        Counters pipelines;
+        Counters bindingSets;
+        Counters samplers;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // GPU profiler
+    //////////////////////////////////////////////////////////////////////////
+
+    struct GpuProfilerDesc
+    {
+        // Queue that executes the command lists that record profiled scopes. Copy queues are not supported.
+        CommandQueue queue = CommandQueue::Graphics;
+
+        // Scopes beyond this number are not recorded and are counted in GpuProfilerFrameResults::numDroppedScopes
+        uint32_t maxScopesPerFrame = 1024;
+
+        // Number of frames that can wait for their results at the same time.
+        // beginFrame waits for the oldest frame on the CPU when all of them are waiting.
+        uint32_t maxFramesInFlight = 4;
+
+        GpuProfilerDesc& setQueue(CommandQueue value) { queue = value; return *this; }
+        GpuProfilerDesc& setMaxScopesPerFrame(uint32_t value) { maxScopesPerFrame = value; return *this; }
+        GpuProfilerDesc& setMaxFramesInFlight(uint32_t value) { maxFramesInFlight = value; return *this; }
+    };
+
+    constexpr uint32_t c_GpuProfilerNoParent = ~0u;
+
+    struct GpuProfilerScope
+    {
+        std::string name;
+        // Index of the enclosing scope in GpuProfilerFrameResults::scopes, or c_GpuProfilerNoParent for top-level scopes
+        uint32_t parent = c_GpuProfilerNoParent;
+        uint32_t depth = 0;
+        // Relative to the earliest timestamp in the frame
+        double beginMilliseconds = 0.0;
+        double endMilliseconds = 0.0;
+    };
+
+    struct GpuProfilerFrameResults
+    {
+        // Sequential number of the frame, counting beginFrame calls from 0
+        uint64_t frameIndex = 0;
+
+        // All scopes of the frame in the order in which they were begun, so a parent always precedes its children
+        std::vector<GpuProfilerScope> scopes;
+        uint32_t numDroppedScopes = 0;
+
+        // CPU time of the earliest timestamp in the frame, in seconds, obtained through clock calibration.
+        // Uses QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere.
+        // Only valid when hasCpuTime is true, which requires GetClockCalibration or VK_EXT_calibrated_timestamps.
+        double cpuBeginTime = 0.0;
+        bool hasCpuTime = false;
+    };
+
+    // Collects GPU timestamps for beginMarker/endMarker pairs recorded in the command lists that use the profiler,
+    // see ICommandList::setGpuProfiler. The timestamps of a frame are resolved with one operation in endFrame
+    // and the results become available a few frames later.
+    // All command lists that record scopes for a frame must be executed on the profiler's queue before endFrame is called.
+    class IGpuProfiler : public IResource
+    {
+    public:
+        virtual void beginFrame() = 0;
+        virtual void endFrame() = 0;
+
+        // Returns the results of the oldest frame whose queries have been resolved and removes them from the profiler,
+        // or returns false if there is no such frame yet.
+        virtual bool getFrameResults(GpuProfilerFrameResults& outResults) = 0;
+    };
+
+    typedef RefCountPtr<IGpuProfiler> GpuProfilerHandle;
+
+    //////////////////////////////////////////////////////////////////////////
+    // Trace recorder
+    //////////////////////////////////////////////////////////////////////////
+
+    struct TraceRecorderDesc
+    {
+        // File that receives the trace in the Chrome trace event format, which can be opened by Perfetto and chrome://tracing
+        std::string outputPath;
+
+        // Events kept in memory between flushes. Events recorded while the buffer is full are dropped,
+        // so the cost of recording an event never includes file I/O.
+        uint32_t maxBufferedEvents = 65536;
+
+        TraceRecorderDesc& setOutputPath(const std::string& value) { outputPath = value; return *this; }
+        TraceRecorderDesc& setMaxBufferedEvents(uint32_t value) { maxBufferedEvents = value; return *this; }
+    };
+
+    // Collects CPU events and GPU profiler scopes on a common timeline and writes them into a trace file.
+    // The device records its own events into the recorder set with IDevice::setTraceRecorder: command list open and close,
+    // executeCommandLists, garbage collection, pipeline creation and upload chunk allocation.
+    // Times are in seconds on the clock returned by getTraceClockSeconds, which is also the clock used by
+    // GpuProfilerFrameResults::cpuBeginTime. All methods are thread-safe.
+    class ITraceRecorder : public IResource
+    {
+    public:
+        // Records a CPU event on the calling thread's track. The strings are copied, long names are truncated.
+        virtual void recordCpuEvent(const char* name, const char* category, double beginSeconds, double endSeconds,
+            const char* argName = nullptr, uint64_t argValue = 0) = 0;
+
+        // Records the scopes of a profiler frame on the track of the queue. Returns false if the frame
+        // has no CPU time (see GpuProfilerFrameResults::hasCpuTime) or if the buffer has no space for its scopes.
+        virtual bool recordGpuFrame(const GpuProfilerFrameResults& results, CommandQueue queue) = 0;
+
+        // Writes the buffered events into the file. Returns false if the file could not be written.
+        // The recorder also flushes when it is destroyed.
+        virtual bool flush() = 0;
+
+        // Number of events dropped because the buffer was full
+        virtual uint64_t getNumDroppedEvents() = 0;
+    };
+
+    typedef RefCountPtr<ITraceRecorder> TraceRecorderHandle;
+
+    // Returns the current time on the trace clock, in seconds.
+    // Uses QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere.
+    NVRHI_API double getTraceClockSeconds();
+
+    // Creates a trace recorder and opens its output file. Returns null if the file cannot be created.
+    NVRHI_API TraceRecorderHandle createTraceRecorder(const TraceRecorderDesc& desc);
+
     //////////////////////////////////////////////////////////////////////////
     // ICommandList
     //////////////////////////////////////////////////////////////////////////
@@ -2534,6 +3424,11 @@ namespace nvrhi
         virtual void copyTexture(IStagingTexture* dest, const TextureSlice& destSlice, ITexture* src, const TextureSlice& srcSlice) = 0;
         virtual void copyTexture(ITexture* dest, const TextureSlice& destSlice, IStagingTexture* src, const TextureSlice& srcSlice) = 0;
         virtual void writeTexture(ITexture* dest, uint32_t arraySlice, uint32_t mipLevel, const void* data, size_t rowPitch, size_t depthPitch = 0) = 0;
+
+        // Uploads several subresources of a texture at once. The data for all regions is placed into a single
+        // upload allocation, the texture is transitioned once, and the copies are issued together:
+        // a single vkCmdCopyBufferToImage on Vulkan. DX11 has no upload memory and performs one UpdateSubresource per region.
+        virtual void writeTextureRegions(ITexture* dest, const TextureUploadRegion* regions, size_t numRegions) = 0;
         virtual void resolveTexture(ITexture* dest, const TextureSubresourceSet& dstSubresources, ITexture* src, const TextureSubresourceSet& srcSubresources) = 0;
 
         virtual void writeBuffer(IBuffer* b, const void* data, size_t dataSize, uint64_t destOffsetBytes = 0) = 0;
@@ -2544,19 +3439,73 @@ namespace nvrhi
         // Only valid after setGraphicsState or setComputeState etc.
         virtual void setPushConstants(const void* data, size_t byteSize) = 0;
 
+        // Provides the resources for the binding layout at 'layoutIndex' in the next pipeline, which must be created
+        // with BindingLayoutDesc::usePushDescriptors. Call before set[Graphics|Compute|Meshlet]State and leave the
+        // corresponding element of the state's bindings array NULL. The bindings are consumed by that set*State call,
+        // including the state transitions for the resources, and no BindingSet object is created on Vulkan.
+        virtual void setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings) = 0;
+
+        // Creates a binding set whose descriptors are sub-allocated from a linear allocator owned by the command list,
+        // which is much cheaper than IDevice::createBindingSet for sets that are used in one or a few states.
+        // The descriptor memory is reclaimed in large chunks once the command list instances that used it retire,
+        // so transient sets should not be kept around for longer than a frame or two.
+        // Only valid while the command list is open; the set may be used in other command lists too.
+        virtual BindingSetHandle createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout) = 0;
+
         virtual void setGraphicsState(const GraphicsState& state) = 0;
+        // Equivalent to setGraphicsState(block->getState()), but rebinding the block that is already current
+        // skips the state comparison entirely. See IGraphicsStateBlock.
+        virtual void setGraphicsStateBlock(IGraphicsStateBlock* block) = 0;
         virtual void draw(const DrawArguments& args) = 0;
         virtual void drawIndexed(const DrawArguments& args) = 0;
+
+        // Issue a batch of draws with one call, see MultiDrawArguments. The backends run the loop internally,
+        // which avoids the per-draw overhead of the virtual calls and the validation layer.
+        // On Vulkan with VK_EXT_multi_draw and VkPhysicalDeviceMultiDrawFeaturesEXT::multiDraw enabled at device
+        // creation, runs of draws with the same instance parameters and no per-draw push constants or binding sets
+        // become single vkCmdDrawMulti[Indexed]EXT calls.
+        virtual void drawMulti(const MultiDrawArguments& multiDraw) = 0;
+        virtual void drawIndexedMulti(const MultiDrawArguments& multiDraw) = 0;
+
         virtual void drawIndirect(uint32_t offsetBytes, uint32_t drawCount = 1) = 0;
         virtual void drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount = 1) = 0;
+
+        // Versions of drawIndirect and drawIndexedIndirect that read the draw count from GraphicsState::indirectCountBuffer
+        // at countOffsetBytes. The number of draws is the smaller of that value and maxDrawCount.
+        // Requires Feature::DrawIndirectCount.
+        virtual void drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) = 0;
+        virtual void drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) = 0;
+
+        // Replays closed bundle command lists, see CommandListParameters::isBundle. All bundles must use the same bundleFramebuffer
+        // and are executed inside one render pass, in the order given. This is the way to record a single render pass on
+        // several threads: record one bundle per thread concurrently, then execute them all with one call.
+        // The resource state requirements of all bundles are merged and transitioned before the render pass.
+        // Invalidates the current graphics, compute, meshlet and ray tracing state, so it has to be set again after the call.
+        virtual void executeBundles(ICommandList* const* bundles, size_t numBundles) = 0;
         
         virtual void setComputeState(const ComputeState& state) = 0;
         virtual void dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) = 0;
         virtual void dispatchIndirect(uint32_t offsetBytes) = 0;
 
+        // Executes up to maxCommandCount commands laid out according to the signature, starting at offsetBytes in the
+        // indirectParams buffer of the current graphics or compute state, depending on the signature's final argument.
+        // For graphics signatures, the command count is read from GraphicsState::indirectCountBuffer at countOffsetBytes
+        // if that buffer is set. If the signature changes vertex buffers, the index buffer or push constants, the current
+        // state is invalidated and has to be set again after the call. Requires Feature::CommandSignatures.
+        virtual void executeIndirect(ICommandSignature* signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes = 0) = 0;
+
         virtual void setMeshletState(const MeshletState& state) = 0;
         virtual void dispatchMesh(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) = 0;
 
+        // Indirect mesh dispatches read from MeshletState::indirectParams, with a stride of 12 bytes.
+        // Each entry is the group counts (X, Y, Z) on D3D12 and on Vulkan with EXT_mesh_shader.
+        // When Vulkan falls back to NV_mesh_shader, dispatches are 1D and each entry is read as (taskCount, firstTask),
+        // with the third value unused, so argument buffers in the (X, Y, Z) layout cannot be shared with that path.
+        // The count variant reads the number of dispatches from MeshletState::indirectCountBuffer at countOffsetBytes
+        // and requires Feature::DrawIndirectCount.
+        virtual void dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount = 1) = 0;
+        virtual void dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) = 0;
+
         virtual void setRayTracingState(const rt::State& state) = 0;
         virtual void dispatchRays(const rt::DispatchRaysArguments& args) = 0;
 
@@ -2564,7 +3513,22 @@ namespace nvrhi
         
         virtual void buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) = 0;
+
+        // Compacts the BLAS'es built with the AllowCompaction flag whose builds have finished executing on the GPU.
+        // The compacted size of such BLAS'es is written out when they are built, so this function should be called
+        // some time after the builds, e.g. once per frame. Each compacted BLAS object keeps its identity and switches
+        // to the new storage, and the original storage is released when this command list finishes executing.
+        // TLAS'es that reference the compacted BLAS'es must be rebuilt after this command list.
+        // A full rebuild of a compacted BLAS (without PerformUpdate) switches it back to storage of the original size,
+        // and the BLAS can then be compacted again.
         virtual void compactBottomLevelAccelStructs() = 0;
+
+        // Builds or updates multiple BLAS'es. The state transitions for all builds are committed at once, the scratch space
+        // is allocated for all builds together, and the builds are recorded without barriers between them, on Vulkan with
+        // a single vkCmdBuildAccelerationStructuresKHR call. Sets of builds that need more scratch space than
+        // CommandListParameters::scratchBatchSize are split into multiple batches. The acceleration structures must be unique.
+        virtual void buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds) = 0;
+
         virtual void buildTopLevelAccelStruct(rt::IAccelStruct* as, const rt::InstanceDesc* pInstances, size_t numInstances,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) = 0;
 
@@ -2574,13 +3538,48 @@ namespace nvrhi
         virtual void buildTopLevelAccelStructFromBuffer(rt::IAccelStruct* as, nvrhi::IBuffer* instanceBuffer, uint64_t instanceBufferOffset, size_t numInstances,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) = 0;
 
+        // A version of buildTopLevelAccelStruct that lets the application write the instances directly into GPU-visible
+        // upload memory, avoiding the intermediate copies. beginTopLevelInstanceWrite returns a pointer to space for
+        // 'numInstances' instances, or NULL if the allocation failed. The instances must use the 'blasDeviceAddress' field,
+        // see IAccelStruct::getDeviceAddress(). The memory is write-only and stays valid until commitTopLevelInstanceWrite
+        // is called for the same TLAS, which records the build. Only one instance write can be pending per command list.
+        // The optional list of BLAS'es referenced by the instances is used for state and liveness tracking.
+        virtual rt::InstanceDesc* beginTopLevelInstanceWrite(rt::IAccelStruct* as, size_t numInstances) = 0;
+        virtual void commitTopLevelInstanceWrite(rt::IAccelStruct* as, rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None,
+            rt::IAccelStruct* const* bottomLevelASes = nullptr, size_t numBottomLevelASes = 0) = 0;
+
         virtual void beginTimerQuery(ITimerQuery* query) = 0;
         virtual void endTimerQuery(ITimerQuery* query) = 0;
 
+        // Occlusion and pipeline statistics queries can only be used on graphics command lists.
+        // On Vulkan, queries that were not reset on the host (see vulkan::DeviceDesc::hostQueryResetSupported) are reset
+        // in the command buffer, which ends the current render pass. A query begun inside a render pass must be ended
+        // before that render pass ends, i.e. before the framebuffer changes or a copy, clear or dispatch is recorded.
+        virtual void beginOcclusionQuery(IOcclusionQuery* query) = 0;
+        virtual void endOcclusionQuery(IOcclusionQuery* query) = 0;
+        virtual void beginPipelineStatisticsQuery(IPipelineStatisticsQuery* query) = 0;
+        virtual void endPipelineStatisticsQuery(IPipelineStatisticsQuery* query) = 0;
+
+        // Writes the results of the queries into consecutive uint64_t values in the buffer, without a CPU round-trip.
+        // The queries must have been ended in this command list or in previously executed ones.
+        // Queries that occupy consecutive native query slots are resolved with a single operation.
+        // Not supported on DX11.
+        virtual void resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* buffer, uint64_t offsetBytes) = 0;
+
+        // Skips the following draws and dispatches depending on the value in the buffer, see PredicationOp.
+        // DX12 reads a 64-bit value and Vulkan reads a 32-bit value, so resolved occlusion query results work on both.
+        // The offset must be a multiple of 8. On Vulkan, the buffer must be created with isDrawIndirectArgs = true.
+        // Pass a null buffer to disable predication. Requires Feature::Predication.
+        virtual void setPredication(IBuffer* buffer, uint64_t offsetBytes, PredicationOp op = PredicationOp::SkipIfZero) = 0;
+
         // Command list range markers
         virtual void beginMarker(const char *name) = 0;
         virtual void endMarker() = 0;
 
+        // When a profiler is set, every beginMarker/endMarker pair also records a pair of timestamps into the profiler's
+        // current frame. The setting persists when the command list is closed and opened again. Pass null to disable.
+        virtual void setGpuProfiler(IGpuProfiler* profiler) = 0;
+
         // Enables or disables the automatic barrier placement on set[...]State, copy, write, and clear operations.
         // By default, automatic barriers are enabled, but can be optionally disabled to improve CPU performance and/or specific barrier placement.
         // When automatic barriers are disabled, it is application's responsibility to set correct states for all used resources.
@@ -2606,6 +3605,13 @@ namespace nvrhi
         virtual void setBufferState(IBuffer* buffer, ResourceStates stateBits) = 0;
         virtual void setAccelStructState(rt::IAccelStruct* as, ResourceStates stateBits) = 0;
 
+        // Split barriers - these begin a transition now and complete it at the next use of the resource, letting the GPU
+        // overlap the transition with the work recorded in between. The next operation that requires the resource, or
+        // closing the command list, waits for the transition to finish. Call these right after the last use in the old state.
+        // On backends without Feature::SplitBarriers, these behave like setTextureState and setBufferState.
+        virtual void beginTextureStateTransition(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) = 0;
+        virtual void beginBufferStateTransition(IBuffer* buffer, ResourceStates stateBits) = 0;
+
         // Permanent resource state transitions - these make resource usage cheaper by excluding it from state tracking in the future.
         // Like setTexture/BufferState, these methods put barriers into the pending list. Call commitBarriers() after.
         virtual void setPermanentTextureState(ITexture* texture, ResourceStates stateBits) = 0;
@@ -2614,6 +3620,12 @@ namespace nvrhi
         // Flushes the barriers from the pending list into the GAPI command list.
         virtual void commitBarriers() = 0;
 
+        // Places a barrier between two placed resources that share heap memory, before resourceAfter is used.
+        // Either resource can be null, which means any resource that may use the same memory.
+        // Commits the pending barriers first. The contents of resourceAfter are undefined after the barrier,
+        // so render targets and depth-stencil textures must be cleared or fully overwritten before they are read.
+        virtual void aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter) = 0;
+
         // Returns the current tracked state of a texture subresource or a buffer.
         virtual ResourceStates getTextureSubresourceState(ITexture* texture, ArraySlice arraySlice, MipLevel mipLevel) = 0;
         virtual ResourceStates getBufferState(IBuffer* buffer) = 0;
@@ -2621,10 +3633,290 @@ namespace nvrhi
         // Returns the owning device, does NOT call AddRef on it
         virtual IDevice* getDevice() = 0;
         virtual const CommandListParameters& getDesc() = 0;
+
+        // Returns the memory usage of the command list's upload buffers, see CommandListParameters::uploadRingSize
+        virtual UploadStatistics getUploadStatistics() = 0;
+
+        // Returns the counters recorded since the command list was last opened, see CommandListParameters::enableStatistics.
+        // All counters are zero when statistics are disabled or not supported (DX11).
+        virtual CommandListStatistics getStatistics() = 0;
+
+        // Front-end for executeBundles(..., 1) for convenience
+        void executeBundle(ICommandList* bundle)
+        {
+            executeBundles(&bundle, 1);
+        }
     };
 
     typedef RefCountPtr<ICommandList> CommandListHandle;
 
+    //////////////////////////////////////////////////////////////////////////
+    // Asynchronous pipeline creation
+    //////////////////////////////////////////////////////////////////////////
+
+    // Application-provided job system used for asynchronous pipeline creation and for parallel compilation
+    // of ray tracing pipelines on Vulkan (VK_KHR_deferred_host_operations).
+    // scheduleTask may be called from any thread. The task must eventually run on a thread other than
+    // the one that will wait for it, and several tasks must be able to run concurrently.
+    class ITaskScheduler
+    {
+    public:
+        virtual void scheduleTask(std::function<void()> task) = 0;
+
+        // Returns the number of tasks that the scheduler can run in parallel, used to limit the number of
+        // worker tasks submitted for a single compilation.
+        virtual uint32_t getConcurrency() { return 1; }
+
+        virtual ~ITaskScheduler() = default;
+    };
+
+    // The result of one of the IDevice::create...PipelineAsync calls.
+    // Only the getter that matches the creation function returns a non-null pipeline, and only after isReady() returns true.
+    // If the pipeline could not be created, isReady() returns true and the getter returns null.
+    class IPipelineCompilation : public IResource
+    {
+    public:
+        [[nodiscard]] virtual bool isReady() const = 0;
+        virtual void wait() = 0;
+
+        [[nodiscard]] virtual GraphicsPipelineHandle getGraphicsPipeline() const = 0;
+        [[nodiscard]] virtual ComputePipelineHandle getComputePipeline() const = 0;
+        [[nodiscard]] virtual MeshletPipelineHandle getMeshletPipeline() const = 0;
+        [[nodiscard]] virtual rt::PipelineHandle getRayTracingPipeline() const = 0;
+    };
+
+    typedef RefCountPtr<IPipelineCompilation> PipelineCompilationHandle;
+
+    //////////////////////////////////////////////////////////////////////////
+    // Texture streaming
+    //////////////////////////////////////////////////////////////////////////
+
+    struct TextureStreamerDesc
+    {
+        // Queue that executes the uploads. Use CommandQueue::Graphics on devices without a copy queue, such as D3D11.
+        CommandQueue uploadQueue = CommandQueue::Copy;
+
+        // Queue that consumes the streamed textures, see ITextureStreamer::acquireTexture.
+        CommandQueue consumerQueue = CommandQueue::Graphics;
+
+        // Requests are packed into batches of approximately this many bytes of texel data. Each batch is recorded
+        // into one command list whose upload chunk has this size, so the staging memory for a batch is one allocation.
+        // A request that is larger than the batch size gets a batch of its own.
+        size_t maxBatchSize = 32 * 1024 * 1024;
+
+        // Maximum number of batches that are submitted and not yet finished on the GPU.
+        // Submitting another batch blocks until the oldest one finishes.
+        uint32_t maxBatchesInFlight = 4;
+
+        TextureStreamerDesc& setUploadQueue(CommandQueue value) { uploadQueue = value; return *this; }
+        TextureStreamerDesc& setConsumerQueue(CommandQueue value) { consumerQueue = value; return *this; }
+        TextureStreamerDesc& setMaxBatchSize(size_t value) { maxBatchSize = value; return *this; }
+        TextureStreamerDesc& setMaxBatchesInFlight(uint32_t value) { maxBatchesInFlight = value; return *this; }
+    };
+
+    struct TextureStreamingSubresource
+    {
+        MipLevel mipLevel = 0;
+        ArraySlice arraySlice = 0;
+        const void* data = nullptr;
+        size_t rowPitch = 0;
+        size_t depthPitch = 0;
+
+        TextureStreamingSubresource& setMipLevel(MipLevel value) { mipLevel = value; return *this; }
+        TextureStreamingSubresource& setArraySlice(ArraySlice value) { arraySlice = value; return *this; }
+        TextureStreamingSubresource& setData(const void* value) { data = value; return *this; }
+        TextureStreamingSubresource& setRowPitch(size_t value) { rowPitch = value; return *this; }
+        TextureStreamingSubresource& setDepthPitch(size_t value) { depthPitch = value; return *this; }
+    };
+
+    struct TextureStreamingRequest
+    {
+        ITexture* texture = nullptr;
+        std::vector<TextureStreamingSubresource> subresources;
+
+        // Called from ITextureStreamer::update or flush after the upload has finished on the GPU.
+        std::function<void(ITexture*)> onComplete;
+
+        TextureStreamingRequest& setTexture(ITexture* value) { texture = value; return *this; }
+        TextureStreamingRequest& addSubresource(const TextureStreamingSubresource& value) { subresources.push_back(value); return *this; }
+        TextureStreamingRequest& setOnComplete(std::function<void(ITexture*)> value) { onComplete = std::move(value); return *this; }
+    };
+
+    // Identifies the batch that a streaming request was placed into. Tickets increase monotonically.
+    typedef uint64_t TextureStreamingTicket;
+
+    // Uploads texture data on a separate queue. Created by IDevice::createTextureStreamer.
+    // Streamed textures should be created with initialState = ResourceStates::Common and keepInitialState = true,
+    // because the copy queue cannot transition them into shader-readable states.
+    // All methods are thread-safe.
+    class ITextureStreamer : public IResource
+    {
+    public:
+        // Records the uploads into the current batch. The subresource data is copied into staging memory
+        // before the call returns. Returns 0 if the request is invalid.
+        virtual TextureStreamingTicket enqueue(const TextureStreamingRequest& request) = 0;
+
+        // Submits the current batch if it's not empty and calls the callbacks of the finished batches.
+        // Intended to be called once per frame.
+        virtual void update() = 0;
+
+        // Submits the current batch and waits on the CPU until all batches are finished, then calls the callbacks.
+        virtual void flush() = 0;
+
+        [[nodiscard]] virtual bool isComplete(TextureStreamingTicket ticket) = 0;
+
+        // Must be called before the texture is used on the consumer queue, and before the command list using it
+        // is executed. Submits the texture's batch if necessary and makes the consumer queue wait for it on the GPU.
+        // Returns false if the texture has no uploads pending, which also means it can be used right away.
+        virtual bool acquireTexture(ITexture* texture) = 0;
+    };
+
+    typedef RefCountPtr<ITextureStreamer> TextureStreamerHandle;
+
+    //////////////////////////////////////////////////////////////////////////
+    // Asynchronous readback
+    //////////////////////////////////////////////////////////////////////////
+
+    struct ReadbackRingDesc
+    {
+        // Queue that executes the command lists with the readback copies. Completion is tracked on this queue.
+        CommandQueue queue = CommandQueue::Graphics;
+
+        // Buffer readbacks are sub-allocated from CPU-readable chunks of this size. A readback that is larger
+        // than the chunk size gets a dedicated buffer, which is released when the readback retires.
+        uint64_t chunkSize = 1024 * 1024;
+
+        // Maximum number of chunks that exist at the same time, so the ring occupies up to maxChunks * chunkSize bytes.
+        // Readbacks that don't fit into the ring fail instead of waiting for the GPU.
+        uint32_t maxChunks = 16;
+
+        ReadbackRingDesc& setQueue(CommandQueue value) { queue = value; return *this; }
+        ReadbackRingDesc& setChunkSize(uint64_t value) { chunkSize = value; return *this; }
+        ReadbackRingDesc& setMaxChunks(uint32_t value) { maxChunks = value; return *this; }
+    };
+
+    // Identifies a readback. Tickets increase monotonically, and 0 is never a valid ticket.
+    typedef uint64_t ReadbackTicket;
+
+    struct ReadbackResult
+    {
+        ReadbackTicket ticket = 0;
+        const void* data = nullptr;
+        size_t size = 0;
+
+        // Distance between the rows of a texture readback. Equal to size for buffer readbacks.
+        size_t rowPitch = 0;
+    };
+
+    // Called from IReadbackRing::update after the copy has finished on the GPU.
+    // The data pointer is only valid for the duration of the call.
+    typedef std::function<void(const ReadbackResult&)> ReadbackCallback;
+
+    // Copies GPU data into persistent CPU-readable memory without waiting for the GPU. Created by IDevice::createReadbackRing.
+    // The copies are recorded into the application's command lists. After those command lists are executed,
+    // the application calls update(), which marks the submission point and retires the readbacks whose copies finished.
+    // Finished readbacks are either passed to their callbacks or kept until they are fetched with getResult and released.
+    // All methods are thread-safe.
+    class IReadbackRing : public IResource
+    {
+    public:
+        // Records a copy of the buffer range into the ring. The command list must be executed on the ring's queue
+        // before the next call to update(). Returns 0 if the ring is full or the request is invalid.
+        virtual ReadbackTicket readBuffer(ICommandList* commandList, IBuffer* buffer, uint64_t offset, uint64_t size, ReadbackCallback onComplete = nullptr) = 0;
+
+        // Records a copy of one texture slice into a pooled staging texture. Staging textures are reused
+        // by later readbacks with the same format and slice size. Returns 0 if the request is invalid.
+        virtual ReadbackTicket readTexture(ICommandList* commandList, ITexture* texture, const TextureSlice& slice, ReadbackCallback onComplete = nullptr) = 0;
+
+        // Closes the group of readbacks recorded since the previous update() by placing an event query on the queue,
+        // then retires the groups that finished on the GPU and calls their callbacks. Never blocks.
+        // Intended to be called once per frame, after the command lists with the readbacks are executed.
+        // Concurrent calls are serialized, so the callbacks must not call update() themselves.
+        virtual void update() = 0;
+
+        [[nodiscard]] virtual bool isComplete(ReadbackTicket ticket) = 0;
+
+        // Returns true and fills outResult if a readback without a callback has retired.
+        // The data stays valid until the ticket is released.
+        virtual bool getResult(ReadbackTicket ticket, ReadbackResult& outResult) = 0;
+
+        // Frees the data of a readback without a callback. Can be called before the readback retires to discard it.
+        virtual void release(ReadbackTicket ticket) = 0;
+    };
+
+    typedef RefCountPtr<IReadbackRing> ReadbackRingHandle;
+
+    //////////////////////////////////////////////////////////////////////////
+    // Transient resources
+    //////////////////////////////////////////////////////////////////////////
+
+    struct TransientResourcePoolDesc
+    {
+        // Size of the heaps that the pool creates. Resources that are larger get a heap of their own.
+        uint64_t heapSize = 256 * 1024 * 1024;
+
+        // Placed resources that have not been used for this many frames are released.
+        uint32_t maxUnusedFrames = 8;
+
+        TransientResourcePoolDesc& setHeapSize(uint64_t value) { heapSize = value; return *this; }
+        TransientResourcePoolDesc& setMaxUnusedFrames(uint32_t value) { maxUnusedFrames = value; return *this; }
+    };
+
+    typedef uint32_t TransientResourceId;
+    static constexpr TransientResourceId c_InvalidTransientResource = ~0u;
+
+    struct TransientResourcePoolStatistics
+    {
+        // Total size of the heaps created by the pool
+        uint64_t heapBytes = 0;
+        // Sum of the sizes of the resources declared in the current frame, i.e. the memory needed without aliasing
+        uint64_t declaredBytes = 0;
+        uint32_t numHeaps = 0;
+        // Number of placed resource objects that the pool keeps for reuse
+        uint32_t numPlacedResources = 0;
+    };
+
+    // Places resources that are only used within a frame into heaps, so that resources whose lifetimes
+    // don't overlap share memory. Created by IDevice::createTransientResourcePool.
+    //
+    // Every frame, call beginFrame, declare the resources with the range of uses where they are needed, and call allocate.
+    // Uses are arbitrary increasing numbers, such as render pass indices. Then call beginUse when recording each use,
+    // which places the aliasing barriers for the resources whose first use it is. The uses must be recorded in order
+    // and executed on one queue. Resources placed at the same offsets with the same descriptions are reused across frames.
+    //
+    // Declared resources are created with keepInitialState = true. If the initial state is Unknown, it is chosen from
+    // the usage flags. The contents of a resource are undefined at its first use. The pool is not thread-safe.
+    class ITransientResourcePool : public IResource
+    {
+    public:
+        virtual void beginFrame() = 0;
+
+        virtual TransientResourceId declareTexture(const TextureDesc& desc, uint32_t firstUse, uint32_t lastUse) = 0;
+        virtual TransientResourceId declareBuffer(const BufferDesc& desc, uint32_t firstUse, uint32_t lastUse) = 0;
+
+        // Places the declared resources. Returns false if a heap or a resource could not be created.
+        virtual bool allocate() = 0;
+
+        // Return the resources after allocate, or null if the ID is invalid or not a texture/buffer.
+        [[nodiscard]] virtual ITexture* getTexture(TransientResourceId id) = 0;
+        [[nodiscard]] virtual IBuffer* getBuffer(TransientResourceId id) = 0;
+
+        // Records the aliasing barriers for the resources that are first used by the given use.
+        virtual void beginUse(ICommandList* commandList, uint32_t use) = 0;
+
+        [[nodiscard]] virtual TransientResourcePoolStatistics getStatistics() = 0;
+    };
+
+    typedef RefCountPtr<ITransientResourcePool> TransientResourcePoolHandle;
+
+    // Identifies a command list submission: the instance returned by executeCommandLists on the queue.
+    // Instance 0 means that no submission is known.
+    struct SubmissionId
+    {
+        CommandQueue queue = CommandQueue::Graphics;
+        uint64_t instance = 0;
+    };
+
     //////////////////////////////////////////////////////////////////////////
     // IDevice
     //////////////////////////////////////////////////////////////////////////
@@ -2638,6 +3930,17 @@ namespace nvrhi
         virtual MemoryRequirements getTextureMemoryRequirements(ITexture* texture) = 0;
         virtual bool bindTextureMemory(ITexture* texture, IHeap* heap, uint64_t offset) = 0;
 
+        // Returns the tiling information of a tiled texture. Any of the output pointers can be null.
+        // On input, numSubresourceTilings specifies the capacity of the subresourceTilings array;
+        // on output, it is set to the number of standard mip levels written.
+        virtual void getTextureTiling(ITexture* texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+            uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings) = 0;
+
+        // Updates the memory mapping of the tiles of a tiled texture on the queue. The update is ordered with
+        // the command lists submitted to the same queue. The heap pages must be 64 KB aligned.
+        virtual void updateTextureTileMappings(ITexture* texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings,
+            CommandQueue executionQueue = CommandQueue::Graphics) = 0;
+
         virtual TextureHandle createHandleForNativeTexture(ObjectType objectType, Object texture, const TextureDesc& desc) = 0;
 
         virtual StagingTextureHandle createStagingTexture(const TextureDesc& d, CpuAccessMode cpuAccess) = 0;
@@ -2647,6 +3950,13 @@ namespace nvrhi
         virtual BufferHandle createBuffer(const BufferDesc& d) = 0;
         virtual void *mapBuffer(IBuffer* buffer, CpuAccessMode cpuAccess) = 0;
         virtual void unmapBuffer(IBuffer* buffer) = 0;
+
+        // Maps the buffer like mapBuffer, but returns null instead of waiting if the GPU is still using the buffer.
+        // With CpuAccessMode::NoOverwrite, the map always succeeds.
+        // If outLastUse is not null, it receives the latest submission that the buffer contents depend on,
+        // which can be passed to waitForSubmissions after a failed attempt. The tracked uses are the copies
+        // to and from CPU-accessible buffers. DX11 doesn't expose submissions, so the instance is always 0 there.
+        virtual void *tryMapBuffer(IBuffer* buffer, CpuAccessMode cpuAccess, SubmissionId* outLastUse = nullptr) = 0;
         virtual MemoryRequirements getBufferMemoryRequirements(IBuffer* buffer) = 0;
         virtual bool bindBufferMemory(IBuffer* buffer, IHeap* heap, uint64_t offset) = 0;
 
@@ -2675,18 +3985,58 @@ namespace nvrhi
         virtual float getTimerQueryTime(ITimerQuery* query) = 0;
         virtual void resetTimerQuery(ITimerQuery* query) = 0;
 
+        // Returns null if the device doesn't support timestamps on the requested queue.
+        virtual GpuProfilerHandle createGpuProfiler(const GpuProfilerDesc& desc) = 0;
+
+        // Occlusion queries - see also begin/endOcclusionQuery and resolveOcclusionQueries in ICommandList
+        virtual OcclusionQueryHandle createOcclusionQuery(const OcclusionQueryDesc& desc = OcclusionQueryDesc()) = 0;
+        virtual bool pollOcclusionQuery(IOcclusionQuery* query) = 0;
+        // Waits for the query to complete and returns the number of passed samples, or nonzero for binary queries
+        virtual uint64_t getOcclusionQueryResult(IOcclusionQuery* query) = 0;
+        virtual void resetOcclusionQuery(IOcclusionQuery* query) = 0;
+
+        // Pipeline statistics queries, require Feature::PipelineStatisticsQueries
+        virtual PipelineStatisticsQueryHandle createPipelineStatisticsQuery() = 0;
+        virtual bool pollPipelineStatisticsQuery(IPipelineStatisticsQuery* query) = 0;
+        // Waits for the query to complete
+        virtual PipelineStatistics getPipelineStatistics(IPipelineStatisticsQuery* query) = 0;
+        virtual void resetPipelineStatisticsQuery(IPipelineStatisticsQuery* query) = 0;
+
         // Returns the API kind that the RHI backend is running on top of.
         virtual GraphicsAPI getGraphicsAPI() = 0;
         
         virtual FramebufferHandle createFramebuffer(const FramebufferDesc& desc) = 0;
         
         virtual GraphicsPipelineHandle createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb) = 0;
+
+        // Bakes a graphics state into an immutable block, see IGraphicsStateBlock.
+        // Returns NULL if the state has no pipeline or framebuffer.
+        virtual GraphicsStateBlockHandle createGraphicsStateBlock(const GraphicsState& state) = 0;
         
         virtual ComputePipelineHandle createComputePipeline(const ComputePipelineDesc& desc) = 0;
 
         virtual MeshletPipelineHandle createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb) = 0;
 
         virtual rt::PipelineHandle createRayTracingPipeline(const rt::PipelineDesc& desc) = 0;
+
+        // Returns null if Feature::CommandSignatures is not supported, which is the case on Vulkan and DX11.
+        virtual CommandSignatureHandle createCommandSignature(const CommandSignatureDesc& desc) = 0;
+
+        // Pipeline cache persistence. The exported blob is opaque and only valid for the same backend, device and driver.
+        // Import the blob before creating any pipelines. importPipelineCache returns false and leaves the current cache
+        // in place if the blob is stale or corrupted. Both functions return false on backends that have no pipeline cache.
+        virtual bool exportPipelineCache(std::vector<uint8_t>& outData) = 0;
+        virtual bool importPipelineCache(const void* data, size_t dataSize) = 0;
+
+        // Sets the job system used by the create...PipelineAsync functions below. The scheduler is not reference counted
+        // and must outlive the device, or be reset to null after all pending compilations have finished.
+        // When no scheduler is set, each asynchronous compilation runs on its own short-lived thread.
+        virtual void setTaskScheduler(ITaskScheduler* scheduler) = 0;
+        virtual ITaskScheduler* getTaskScheduler() = 0;
+
+        // Sets the recorder that receives the CPU events of the device and its command lists, see ITraceRecorder.
+        // Pass null to stop recording. Must not be called while other threads use the device.
+        virtual void setTraceRecorder(ITraceRecorder* recorder) = 0;
         
         virtual BindingLayoutHandle createBindingLayout(const BindingLayoutDesc& desc) = 0;
         virtual BindingLayoutHandle createBindlessLayout(const BindlessLayoutDesc& desc) = 0;
@@ -2697,6 +4047,12 @@ namespace nvrhi
         virtual void resizeDescriptorTable(IDescriptorTable* descriptorTable, uint32_t newSize, bool keepContents = true) = 0;
         virtual bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem& item) = 0;
 
+        // Writes several items into a descriptor table with a single vkUpdateDescriptorSets or CopyDescriptors call.
+        // Returns false without writing anything if any item's slot is outside of the table's capacity.
+        // Different threads may write into the same table concurrently, as long as they write different slots
+        // and the table is not resized at the same time; see utils::DescriptorSlotAllocator.
+        virtual bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem* items, size_t numItems) = 0;
+
         virtual rt::OpacityMicromapHandle createOpacityMicromap(const rt::OpacityMicromapDesc& desc) = 0;
         virtual rt::AccelStructHandle createAccelStruct(const rt::AccelStructDesc& desc) = 0;
         virtual MemoryRequirements getAccelStructMemoryRequirements(rt::IAccelStruct* as) = 0;
@@ -2707,10 +4063,56 @@ namespace nvrhi
         virtual void queueWaitForCommandList(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance) = 0;
         virtual void waitForIdle() = 0;
 
+        // Enables or disables deferred submission. While it is enabled, executeCommandLists returns the instance IDs
+        // as usual but only queues the command lists, and flushSubmissions submits everything queued on each queue
+        // with a single vkQueueSubmit2 / ExecuteCommandLists sequence. Waits on the CPU for a queued instance
+        // (waitForIdle, mapping staging resources, reading queries) flush the queue first. A cross-queue wait is only
+        // recorded: flushing the waiting queue flushes the waited queue up to the awaited instance before submitting
+        // the wait. Presentation is not tracked: call flushSubmissions before presenting.
+        // Disabling deferred submission flushes the queued command lists. Has no effect on DX11.
+        virtual void setDeferredSubmission(bool enable) = 0;
+        virtual void flushSubmissions() = 0;
+
+        // Waits on the CPU until the command list instances returned by executeCommandLists finish executing:
+        // 'instances[i]' on 'queues[i]', all of them or any of them depending on 'waitAll'. Instance 0 counts as finished.
+        // Returns false if the timeout expires first or if the arguments are invalid. A timeout of 0 only polls.
+        // Backed by vkWaitSemaphores on Vulkan and SetEventOnMultipleFenceCompletion on DX12, so no polling is involved.
+        virtual bool waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions,
+            bool waitAll, uint64_t timeoutNanoseconds = ~0ull) = 0;
+
         // Releases the resources that were referenced in the command lists that have finished executing.
         // IMPORTANT: Call this method at least once per frame.
         virtual void runGarbageCollection() = 0;
 
+        // Time-budgeted variant of runGarbageCollection: retires the finished command lists, oldest first,
+        // until about 'maxMicroseconds' have passed. Returns true if everything that had finished executing was released,
+        // or false if the budget ran out and the rest is left for the next call.
+        virtual bool runGarbageCollection(uint32_t maxMicroseconds) = 0;
+
+        // Returns the current memory usage and budget of the device heaps and the memory allocated by NVRHI internally.
+        virtual MemoryStatistics getMemoryStatistics() = 0;
+
+        // Returns the sum of the statistics of the command lists that were created with enableStatistics and executed
+        // since the last reset. Calling it once per frame with 'reset' set gives per-frame totals.
+        virtual CommandListStatistics getCommandListStatistics(bool reset) = 0;
+
+        // Enables the device-level object cache, which is disabled by default. While it is enabled, createGraphicsPipeline,
+        // createComputePipeline, createMeshletPipeline, createBindingSet and createSampler return the existing object
+        // when they are called with parameters equal to an earlier call, and framebuffers with the same
+        // FramebufferInfo for pipelines. Binding sets created with trackLiveness = false are never cached because
+        // they don't keep their resources alive. The cached objects stay alive until runGarbageCollection finds that
+        // the cache holds the only reference to them, and disabling the cache releases all of them. Thread-safe.
+        virtual void setObjectCacheEnabled(bool enable) = 0;
+
+        // Returns the hit and miss counters of the object cache, and resets them if 'reset' is set.
+        virtual ObjectCacheStatistics getObjectCacheStatistics(bool reset) = 0;
+
+        // Sets a callback that is invoked from runGarbageCollection when the budget of any heap changes,
+        // e.g. when other applications allocate or release video memory. Pass null to remove the callback.
+        // On DX11 and DX12, changes are detected with RegisterVideoMemoryBudgetChangeNotificationEvent;
+        // on Vulkan, the budget is polled when VK_EXT_memory_budget is enabled.
+        virtual void setMemoryBudgetCallback(IMemoryBudgetCallback* callback) = 0;
+
         virtual bool queryFeatureSupport(Feature feature, void* pInfo = nullptr, size_t infoSize = 0) = 0;
 
         virtual FormatSupport queryFormatSupport(Format format) = 0;
@@ -2724,16 +4126,29 @@ namespace nvrhi
         {
             return executeCommandLists(&commandList, 1, executionQueue);
         }
+
+        // Asynchronous front-ends for the create...Pipeline functions. The pipeline is created on the task scheduler,
+        // and the returned object can be polled or waited upon. The descriptors, framebuffer and other objects
+        // referenced by them are kept alive until the compilation finishes. The device is also kept alive.
+        NVRHI_API PipelineCompilationHandle createGraphicsPipelineAsync(const GraphicsPipelineDesc& desc, IFramebuffer* fb);
+        NVRHI_API PipelineCompilationHandle createComputePipelineAsync(const ComputePipelineDesc& desc);
+        NVRHI_API PipelineCompilationHandle createMeshletPipelineAsync(const MeshletPipelineDesc& desc, IFramebuffer* fb);
+        NVRHI_API PipelineCompilationHandle createRayTracingPipelineAsync(const rt::PipelineDesc& desc);
+
+        // Creates a texture streamer that records uploads into its own command lists, see ITextureStreamer.
+        // Returns null if the device doesn't support the upload queue.
+        NVRHI_API TextureStreamerHandle createTextureStreamer(const TextureStreamerDesc& desc);
+
+        // Creates a ring of CPU-readable memory for readbacks that don't stall the CPU, see IReadbackRing.
+        // Returns null if the device doesn't support the queue.
+        NVRHI_API ReadbackRingHandle createReadbackRing(const ReadbackRingDesc& desc);
+
+        // Creates a pool that aliases the memory of frame-local resources, see ITransientResourcePool.
+        // Returns null if the device doesn't support Feature::VirtualResources.
+        NVRHI_API TransientResourcePoolHandle createTransientResourcePool(const TransientResourcePoolDesc& desc);
     };
 
     typedef RefCountPtr<IDevice> DeviceHandle;
-
-    template <class T>
-    void hash_combine(size_t& seed, const T& v)
-    {
-        std::hash<T> hasher;
-        seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-    }
 }
 
 #undef NVRHI_ENUM_CLASS_FLAG_OPERATORS
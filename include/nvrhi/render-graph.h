@@ -0,0 +1,145 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+
+#include <functional>
+#include <string>
+
+namespace nvrhi::utils
+{
+    typedef uint32_t RenderGraphResource;
+    typedef uint32_t RenderGraphPass;
+    static constexpr RenderGraphResource c_InvalidRenderGraphResource = ~0u;
+    static constexpr RenderGraphPass c_InvalidRenderGraphPass = ~0u;
+
+    struct RenderGraphDesc
+    {
+        // Parameters of the pool that places the graph's transient resources. The pool is only used on devices
+        // with Feature::VirtualResources, other devices get committed resources that are kept for the same number of frames.
+        TransientResourcePoolDesc transientPool;
+
+        // Run the passes marked with asyncCompute on CommandQueue::Compute if the device supports Feature::ComputeQueue.
+        bool enableAsyncCompute = true;
+
+        // Record the passes of a batch into several command lists in parallel, using the device's task scheduler
+        // or short-lived threads when there is no scheduler. Ignored on D3D11.
+        bool enableParallelRecording = true;
+        uint32_t minPassesPerCommandList = 4;
+        uint32_t maxCommandListsPerBatch = 8;
+
+        // Begin the transitions of resources right after their last use when the next use is at least one pass later.
+        bool enableSplitBarriers = true;
+
+        // Remove the passes whose results do not reach an imported resource or a pass with side effects.
+        bool enablePassCulling = true;
+
+        RenderGraphDesc& setTransientPool(const TransientResourcePoolDesc& value) { transientPool = value; return *this; }
+        RenderGraphDesc& setEnableAsyncCompute(bool value) { enableAsyncCompute = value; return *this; }
+        RenderGraphDesc& setEnableParallelRecording(bool value) { enableParallelRecording = value; return *this; }
+        RenderGraphDesc& setMinPassesPerCommandList(uint32_t value) { minPassesPerCommandList = value; return *this; }
+        RenderGraphDesc& setMaxCommandListsPerBatch(uint32_t value) { maxCommandListsPerBatch = value; return *this; }
+        RenderGraphDesc& setEnableSplitBarriers(bool value) { enableSplitBarriers = value; return *this; }
+        RenderGraphDesc& setEnablePassCulling(bool value) { enablePassCulling = value; return *this; }
+    };
+
+    struct RenderGraphPassDesc
+    {
+        std::string name;
+
+        // The pass only uses compute work and may run on the compute queue.
+        // Its resource states must be valid on that queue.
+        bool asyncCompute = false;
+
+        // The pass is never culled. Use this for passes that write to resources that are not part of the graph,
+        // such as readback buffers or the swap chain when it's not imported.
+        bool hasSideEffects = false;
+
+        RenderGraphPassDesc& setName(const std::string& value) { name = value; return *this; }
+        RenderGraphPassDesc& setAsyncCompute(bool value) { asyncCompute = value; return *this; }
+        RenderGraphPassDesc& setHasSideEffects(bool value) { hasSideEffects = value; return *this; }
+    };
+
+    // Records the commands of a pass. The resources declared by the pass are in the requested states when it's called,
+    // and the command list has automatic barriers disabled. Callbacks of different passes may run concurrently.
+    typedef std::function<void(ICommandList* commandList)> RenderGraphPassCallback;
+
+    struct RenderGraphStatistics
+    {
+        uint32_t numPasses = 0;
+        uint32_t numCulledPasses = 0;
+        uint32_t numAsyncComputePasses = 0;
+        uint32_t numCommandLists = 0;
+        uint32_t numSplitBarriers = 0;
+        uint32_t numTransientResources = 0;
+    };
+
+    // A frame graph that orders the barriers, queue synchronization, and transient memory of a set of passes.
+    // Created by CreateRenderGraph.
+    //
+    // Every frame, call reset, declare the resources and the passes with the states they use each resource in,
+    // then call compile and execute. Passes execute in declaration order, so a pass can only read the results of
+    // passes declared before it. Writes are assumed to keep the previous contents of the resource for culling purposes.
+    //
+    // Transient resources only exist for one frame, their memory is shared with other transient resources that are
+    // not used at the same time, and their contents are undefined at the first use. Imported resources are owned by
+    // the application: the graph starts from the provided state and transitions them to finalState at the end,
+    // unless their keepInitialState is set or finalState is Unknown. The graph is not thread-safe, but getTexture
+    // and getBuffer can be called from the pass callbacks.
+    class IRenderGraph : public IResource
+    {
+    public:
+        virtual void reset() = 0;
+
+        virtual RenderGraphResource createTexture(const TextureDesc& desc) = 0;
+        virtual RenderGraphResource createBuffer(const BufferDesc& desc) = 0;
+        virtual RenderGraphResource importTexture(ITexture* texture, ResourceStates currentState, ResourceStates finalState = ResourceStates::Unknown) = 0;
+        virtual RenderGraphResource importBuffer(IBuffer* buffer, ResourceStates currentState, ResourceStates finalState = ResourceStates::Unknown) = 0;
+
+        virtual RenderGraphPass addPass(const RenderGraphPassDesc& desc, RenderGraphPassCallback callback) = 0;
+
+        virtual void readTexture(RenderGraphPass pass, RenderGraphResource texture, ResourceStates state, TextureSubresourceSet subresources = AllSubresources) = 0;
+        virtual void writeTexture(RenderGraphPass pass, RenderGraphResource texture, ResourceStates state, TextureSubresourceSet subresources = AllSubresources) = 0;
+        virtual void readBuffer(RenderGraphPass pass, RenderGraphResource buffer, ResourceStates state) = 0;
+        virtual void writeBuffer(RenderGraphPass pass, RenderGraphResource buffer, ResourceStates state) = 0;
+
+        // Culls the passes, allocates the transient resources, and plans the barriers and command lists.
+        // Returns false if the graph is invalid or a resource could not be created.
+        virtual bool compile() = 0;
+
+        // Records the compiled passes and submits them. Returns false if the graph has not been compiled.
+        virtual bool execute() = 0;
+
+        // Return the resources for a graph handle, or null for transient resources before compile or culled resources.
+        [[nodiscard]] virtual ITexture* getTexture(RenderGraphResource texture) = 0;
+        [[nodiscard]] virtual IBuffer* getBuffer(RenderGraphResource buffer) = 0;
+
+        [[nodiscard]] virtual RenderGraphStatistics getStatistics() = 0;
+    };
+
+    typedef RefCountPtr<IRenderGraph> RenderGraphHandle;
+
+    NVRHI_API RenderGraphHandle CreateRenderGraph(IDevice* device, const RenderGraphDesc& desc = RenderGraphDesc());
+}
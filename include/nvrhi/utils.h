@@ -22,8 +22,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
+#include <memory>
 #include <nvrhi/nvrhi.h>
+#include <nvrhi/common/shader-blob.h>
 
 namespace nvrhi::utils
 {
@@ -108,6 +111,99 @@ namespace nvrhi::utils
     void NotSupported();
     void InvalidEnum();
 
+    // Read-only shader permutation blob file, see shader-blob.h for the format.
+    // The file is mapped into memory, so opening it takes constant time regardless of its size,
+    // and the binaries are passed to createShader directly from the mapping.
+    // Binaries in compressed blobs are decompressed on first use and kept in memory until the file is closed;
+    // decompressAll can be called during warm-up to decompress everything in parallel.
+    // Version 1 blobs are also supported, but finding a permutation in them requires a linear scan.
+    class ShaderBlobFile
+    {
+    public:
+        ShaderBlobFile() = default;
+        NVRHI_API ~ShaderBlobFile();
+
+        ShaderBlobFile(const ShaderBlobFile&) = delete;
+        ShaderBlobFile& operator=(const ShaderBlobFile&) = delete;
+
+        NVRHI_API bool open(const char* fileName);
+        NVRHI_API void close();
+
+        [[nodiscard]] bool isOpen() const { return m_Data != nullptr; }
+        [[nodiscard]] const void* getData() const { return m_Data; }
+        [[nodiscard]] size_t getSize() const { return m_Size; }
+
+        // Returns the number of permutations in a version 2 blob, or 0 for version 1 blobs.
+        [[nodiscard]] NVRHI_API uint32_t getPermutationCount() const;
+        [[nodiscard]] NVRHI_API bool isCompressed() const;
+
+        // Decompresses all binaries of a compressed blob, using the scheduler's tasks or, if there is no scheduler,
+        // worker threads. Returns false if some of the binaries are corrupted. Thread-safe.
+        NVRHI_API bool decompressAll(ITaskScheduler* scheduler = nullptr) const;
+
+        // The returned pointer is valid until the file is closed. Thread-safe.
+        NVRHI_API bool findPermutation(const ShaderConstant* constants, uint32_t numConstants, const void** pBinary, size_t* pSize) const;
+
+        // Returns null if the permutation is not found in the file.
+        NVRHI_API ShaderHandle createShader(IDevice* device, const ShaderDesc& desc, const ShaderConstant* constants, uint32_t numConstants) const;
+        NVRHI_API ShaderLibraryHandle createShaderLibrary(IDevice* device, const ShaderConstant* constants, uint32_t numConstants) const;
+
+    private:
+        struct DecompressedBinary
+        {
+            std::once_flag once;
+            std::vector<uint8_t> data;
+            bool valid = false;
+        };
+
+        const void* m_Data = nullptr;
+        size_t m_Size = 0;
+        const uint8_t* m_Dictionary = nullptr;
+        size_t m_DictionarySize = 0;
+        std::unique_ptr<DecompressedBinary[]> m_Decompressed; // only for compressed blobs, one per index entry
+
+        const DecompressedBinary& getDecompressedBinary(size_t index) const;
+    };
+
+    // Generates mip chains on the GPU with a single-pass compute downsampler. One dispatch produces up to 12 mips:
+    // every thread group reduces a 64x64 tile, and the last group to finish, found through a global atomic counter,
+    // reduces the remaining small mips. The shaders are embedded into the library when it's built with NVRHI_EMBED_SHADERS.
+    // Supports 2D, 2D array and cube textures created with isUAV = true, with normalized or float formats that allow
+    // typed UAV stores. sRGB textures must be created with isTypeless = true, because their mips are written through
+    // linear UAVs, which needs a castable format on DX12 and VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT on Vulkan.
+    // DX11 is not supported. The generator creates its pipeline on first use, so keep one per device.
+    // Command lists that use the same generator must not execute concurrently, because they share the counter buffer.
+    class MipGenerator
+    {
+    public:
+        NVRHI_API explicit MipGenerator(IDevice* device);
+
+        MipGenerator(const MipGenerator&) = delete;
+        MipGenerator& operator=(const MipGenerator&) = delete;
+
+        // Returns false if the shaders for the device's graphics API are not available.
+        [[nodiscard]] NVRHI_API bool isSupported();
+
+        // Fills the mips above baseMipLevel from baseMipLevel. Returns false if the texture is not supported.
+        NVRHI_API bool generateMips(ICommandList* commandList, ITexture* texture, MipLevel baseMipLevel = 0);
+
+    private:
+        DeviceHandle m_Device;
+        ShaderHandle m_Shader;
+        BindingLayoutHandle m_BindingLayout;
+        ComputePipelineHandle m_Pipeline;
+        SamplerHandle m_Sampler;
+        BufferHandle m_CounterBuffer;
+        BufferHandle m_IntermediateBuffer;
+        uint32_t m_MaxArraySlices = 0;
+        bool m_Initialized = false;
+        std::mutex m_Mutex;
+
+        bool initialize();
+        bool reserveArraySlices(uint32_t arraySlices);
+        bool isTextureSupported(ITexture* texture);
+    };
+
     class BitSetAllocator
     {
     public:
@@ -124,4 +220,28 @@ namespace nvrhi::utils
         std::mutex m_Mutex;
     };
 
+    // Lock-free allocator of slots in a bindless descriptor table.
+    // Loader threads can allocate slots and write them with IDevice::writeDescriptorTable concurrently,
+    // without any application-level locking. The capacity is fixed, allocate returns -1 when the table is full.
+    class DescriptorSlotAllocator
+    {
+    public:
+        explicit DescriptorSlotAllocator(uint32_t capacity);
+
+        int allocate();
+        // Allocates up to 'count' slots that are not necessarily contiguous, returns the number of slots allocated.
+        uint32_t allocate(uint32_t* outSlots, uint32_t count);
+        void release(int slot);
+        [[nodiscard]] uint32_t getCapacity() const { return m_Capacity; }
+        [[nodiscard]] uint32_t getNumAllocated() const { return m_NumAllocated.load(std::memory_order_relaxed); }
+
+    private:
+        // One bit per slot, set when the slot is allocated
+        std::unique_ptr<std::atomic<uint64_t>[]> m_Words;
+        uint32_t m_NumWords = 0;
+        uint32_t m_Capacity = 0;
+        std::atomic<uint32_t> m_NextWord = 0;
+        std::atomic<uint32_t> m_NumAllocated = 0;
+    };
+
 }
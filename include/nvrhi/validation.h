@@ -26,5 +26,33 @@
 
 namespace nvrhi::validation
 {
-    NVRHI_API DeviceHandle createValidationLayer(IDevice* underlyingDevice);
+    enum class ValidationLevel : uint8_t
+    {
+        // Checks the command list state, object lifetimes and queue types, and the compatibility of the pipeline
+        // with the binding sets and the framebuffer. Compatibility results are cached per pipeline and set of
+        // binding layouts for the duration of a command list recording.
+        Lightweight,
+
+        // Additionally checks the descriptions of all objects referenced by every state and transient binding set.
+        Full
+    };
+
+    struct ValidationLayerDesc
+    {
+        // Validation level of the command lists. Resource and pipeline creation is always fully validated.
+        ValidationLevel level = ValidationLevel::Full;
+
+        // With the Lightweight level, command lists opened during every Nth frame are validated fully.
+        // Frames are counted by the calls to IDevice::runGarbageCollection. 0 disables the sampling.
+        uint32_t fullValidationFrameInterval = 0;
+
+        ValidationLayerDesc& setLevel(ValidationLevel value) { level = value; return *this; }
+        ValidationLayerDesc& setFullValidationFrameInterval(uint32_t value) { fullValidationFrameInterval = value; return *this; }
+    };
+
+    NVRHI_API DeviceHandle createValidationLayer(IDevice* underlyingDevice, const ValidationLayerDesc& desc = ValidationLayerDesc());
+
+    // Makes a command list created by a validation layer device use full validation from its next open(),
+    // regardless of the device's validation level. Ignored for other command lists.
+    NVRHI_API void setFullValidation(ICommandList* commandList, bool enable);
 }
@@ -43,6 +43,8 @@ namespace nvrhi::vulkan
         virtual void queueWaitForSemaphore(CommandQueue waitQueue, VkSemaphore semaphore, uint64_t value) = 0;
         virtual void queueSignalSemaphore(CommandQueue executionQueue, VkSemaphore semaphore, uint64_t value) = 0;
         virtual uint64_t queueGetCompletedInstance(CommandQueue queue) = 0;
+        // Note: the semaphores passed to queueWaitForSemaphore and queueSignalSemaphore can be timeline semaphores
+        // created by the application with VkExportSemaphoreCreateInfo, which is the way to share them with CUDA or video APIs.
         virtual FramebufferHandle createHandleForNativeFramebuffer(VkRenderPass renderPass, 
             VkFramebuffer framebuffer, const FramebufferDesc& desc, bool transferOwnership) = 0;
     };
@@ -74,9 +76,91 @@ namespace nvrhi::vulkan
         size_t numDeviceExtensions = 0;
 
         uint32_t maxTimerQueries = 256;
+        uint32_t maxOcclusionQueries = 1024;
+        uint32_t maxPipelineStatisticsQueries = 256;
 
         // Indicates if VkPhysicalDeviceVulkan12Features::bufferDeviceAddress was set to 'true' at device creation time
         bool bufferDeviceAddressSupported = false;
+
+        // Indicates if VkPhysicalDeviceVulkan13Features::dynamicRendering (or the VK_KHR_dynamic_rendering feature)
+        // was set to 'true' at device creation time. Framebuffers created by createFramebuffer then only store
+        // the attachment views and are rendered with vkCmdBeginRendering, and graphics pipelines only depend on
+        // the framebuffer's FramebufferInfo. Framebuffers from createHandleForNativeFramebuffer still use their render pass,
+        // and pipelines created for one kind of framebuffer cannot be used with the other.
+        bool dynamicRenderingSupported = false;
+
+        // Indicates if VkPhysicalDeviceExtendedDynamicStateFeaturesEXT::extendedDynamicState was set to 'true'
+        // at device creation time, or the device uses Vulkan 1.3 where that state is always dynamic.
+        // Enables Feature::ExtendedDynamicState and RenderState::extendedDynamicState.
+        bool extendedDynamicStateSupported = false;
+
+        // Indicates if VkPhysicalDeviceFeatures::occlusionQueryPrecise was set to 'true' at device creation time.
+        // Without it, counted occlusion queries only report zero or nonzero, like binary queries.
+        bool occlusionQueryPreciseSupported = false;
+
+        // Indicates if VkPhysicalDeviceFeatures::pipelineStatisticsQuery was set to 'true' at device creation time
+        bool pipelineStatisticsQuerySupported = false;
+
+        // Indicates if VkPhysicalDeviceVulkan12Features::hostQueryReset was set to 'true' at device creation time.
+        // Queries are then reset on the host when they are created and in Device::reset*Query, so beginning them
+        // doesn't need a vkCmdResetQueryPool and doesn't end the current render pass. Queries that are begun again
+        // without a reset* call are still reset in the command buffer, outside of the render pass.
+        bool hostQueryResetSupported = false;
+
+        // Indicates if VkPhysicalDeviceFeatures::sparseBinding and sparseResidencyImage2D were set to 'true'
+        // at device creation time. Tiled textures also require the queues used with updateTextureTileMappings
+        // to support sparse binding.
+        bool sparseResidencySupported = false;
+
+        // Indicates if VkPhysicalDeviceVulkan12Features::descriptorBindingUpdateUnusedWhilePending and the
+        // descriptorBinding*UpdateAfterBind features for all descriptor types used in bindless layouts were set
+        // to 'true' at device creation time. Bindless layouts then use the update-after-bind flags, so descriptor
+        // tables can be written and resized while command buffers that use them are pending or being recorded.
+        bool descriptorUpdateAfterBindSupported = false;
+
+        // Indicates if VkPhysicalDeviceDescriptorBufferFeaturesEXT::descriptorBuffer and descriptorBufferPushDescriptors
+        // were set to 'true' at device creation time. Requires bufferDeviceAddressSupported. Binding sets and descriptor tables
+        // then write their descriptors with vkGetDescriptorEXT into one buffer owned by the device and are bound with offsets,
+        // so no descriptor pools or sets are used and descriptor tables can be written from any thread without locking.
+        // Binding sets and descriptor tables have no native VkDescriptorSet objects in this mode, and all pipelines
+        // are created with VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT.
+        bool descriptorBufferSupported = false;
+
+        // Size of the descriptor buffer used when descriptorBufferSupported is set. The buffer cannot grow,
+        // so creating binding sets and descriptor tables fails when it is full.
+        uint64_t descriptorBufferSize = 32 * 1024 * 1024;
+
+        // Number of physical devices in the device group that the VkDevice was created with, see Feature::MultiGPU.
+        // When it is greater than 1, command buffers use the device masks from CommandListParameters::nodeMask,
+        // and memory for resources with a nonzero creationNodeMask is only allocated on those devices.
+        // Each device only accesses its own instance of a resource, see MultiGPUFeatureInfo.
+        uint32_t deviceGroupSize = 1;
+
+        // When enabled, a thread owned by the device retires the command buffers that have finished executing
+        // every 'backgroundGarbageCollectionInterval' microseconds, so the referenced resources may be released
+        // and destroyed on that thread. runGarbageCollection still needs to be called for the memory budget callback,
+        // but has little work left.
+        bool enableBackgroundGarbageCollection = false;
+        uint32_t backgroundGarbageCollectionInterval = 1000;
+
+        // Size of the shared ring that stores the versions of volatile constant buffers created with maxVersions = 0.
+        // The ring is allocated on first use and cannot grow because the descriptor sets reference it directly,
+        // so if it runs out, an error is reported and the writes are dropped until some chunks are retired.
+        uint64_t volatileBufferRingSize = 16 * 1024 * 1024;
+
+        // When enabled, executeCommandLists makes the queue wait for the latest submissions on the other queues
+        // that wrote the buffers and textures used by the command lists, and for the latest submissions there
+        // that accessed the resources which the command lists write. Each dependency produces one wait, and the waits
+        // added with queueWaitForCommandList are taken into account. Only the resources that go through automatic
+        // state tracking are seen, so the ones accessed through descriptor tables or with automatic barriers disabled
+        // still need manual waits. Buffers and textures are created with concurrent sharing between the queue families
+        // of the device, which makes queue family ownership transfers unnecessary but may disable some compression.
+        // Acceleration structure storage is synchronized between the graphics and compute queues even when disabled.
+        bool enableAutomaticQueueSync = false;
+
+        // When enabled, createDevice sends the time spent in each stage of the device initialization
+        // to the message callback with MessageSeverity::Info.
+        bool reportStartupTimes = false;
     };
 
     NVRHI_API DeviceHandle createDevice(const DeviceDesc& desc);
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <nvrhi/nvrhi.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nvrhi
+{
+    class PipelineCompilation : public RefCounter<IPipelineCompilation>
+    {
+    public:
+        GraphicsPipelineHandle graphicsPipeline;
+        ComputePipelineHandle computePipeline;
+        MeshletPipelineHandle meshletPipeline;
+        rt::PipelineHandle rayTracingPipeline;
+
+        void complete()
+        {
+            {
+                std::lock_guard lockGuard(m_Mutex);
+                m_Ready.store(true, std::memory_order_release);
+            }
+            m_Condition.notify_all();
+        }
+
+        bool isReady() const override
+        {
+            return m_Ready.load(std::memory_order_acquire);
+        }
+
+        void wait() override
+        {
+            std::unique_lock lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_Ready.load(std::memory_order_acquire); });
+        }
+
+        GraphicsPipelineHandle getGraphicsPipeline() const override { return isReady() ? graphicsPipeline : nullptr; }
+        ComputePipelineHandle getComputePipeline() const override { return isReady() ? computePipeline : nullptr; }
+        MeshletPipelineHandle getMeshletPipeline() const override { return isReady() ? meshletPipeline : nullptr; }
+        rt::PipelineHandle getRayTracingPipeline() const override { return isReady() ? rayTracingPipeline : nullptr; }
+
+    private:
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::atomic<bool> m_Ready = false;
+    };
+
+    // Runs 'work' on the device's task scheduler, or on a detached thread if there is no scheduler.
+    // The lambda holds references to the device and the compilation object until it completes.
+    template<typename Work>
+    static PipelineCompilationHandle schedulePipelineCompilation(IDevice* device, Work&& work)
+    {
+        RefCountPtr<PipelineCompilation> compilation = RefCountPtr<PipelineCompilation>::Create(new PipelineCompilation());
+
+        std::function<void()> task = [deviceHandle = DeviceHandle(device), compilation, work = std::forward<Work>(work)]()
+        {
+            work(deviceHandle.Get(), *compilation);
+            compilation->complete();
+        };
+
+        if (ITaskScheduler* scheduler = device->getTaskScheduler())
+            scheduler->scheduleTask(std::move(task));
+        else
+            std::thread(std::move(task)).detach();
+
+        return compilation;
+    }
+
+    PipelineCompilationHandle IDevice::createGraphicsPipelineAsync(const GraphicsPipelineDesc& desc, IFramebuffer* fb)
+    {
+        return schedulePipelineCompilation(this, [desc, framebuffer = FramebufferHandle(fb)](IDevice* device, PipelineCompilation& compilation)
+        {
+            compilation.graphicsPipeline = device->createGraphicsPipeline(desc, framebuffer);
+        });
+    }
+
+    PipelineCompilationHandle IDevice::createComputePipelineAsync(const ComputePipelineDesc& desc)
+    {
+        return schedulePipelineCompilation(this, [desc](IDevice* device, PipelineCompilation& compilation)
+        {
+            compilation.computePipeline = device->createComputePipeline(desc);
+        });
+    }
+
+    PipelineCompilationHandle IDevice::createMeshletPipelineAsync(const MeshletPipelineDesc& desc, IFramebuffer* fb)
+    {
+        return schedulePipelineCompilation(this, [desc, framebuffer = FramebufferHandle(fb)](IDevice* device, PipelineCompilation& compilation)
+        {
+            compilation.meshletPipeline = device->createMeshletPipeline(desc, framebuffer);
+        });
+    }
+
+    PipelineCompilationHandle IDevice::createRayTracingPipelineAsync(const rt::PipelineDesc& desc)
+    {
+        return schedulePipelineCompilation(this, [desc](IDevice* device, PipelineCompilation& compilation)
+        {
+            compilation.rayTracingPipeline = device->createRayTracingPipeline(desc);
+        });
+    }
+
+} // namespace nvrhi
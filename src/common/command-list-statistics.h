@@ -0,0 +1,70 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "state-tracking.h"
+#include <initializer_list>
+
+namespace nvrhi
+{
+    // Adds the barriers collected by the state tracker since the last commit to the statistics.
+    // A split transition is counted once, at its Begin half.
+    inline void countBarriers(const CommandListResourceStateTracker& stateTracker, CommandListStatistics& statistics)
+    {
+        for (const TextureBarrier& barrier : stateTracker.getTextureBarriers())
+        {
+            if (barrier.split == BarrierSplit::End)
+                continue;
+
+            if (barrier.stateBefore == barrier.stateAfter)
+                ++statistics.numUavBarriers;
+            else
+                ++statistics.numTextureTransitions;
+        }
+
+        for (const BufferBarrier& barrier : stateTracker.getBufferBarriers())
+        {
+            if (barrier.split == BarrierSplit::End)
+                continue;
+
+            if (barrier.stateBefore == barrier.stateAfter)
+                ++statistics.numUavBarriers;
+            else
+                ++statistics.numBufferTransitions;
+        }
+    }
+
+    // Adds the parts of a state that the diffing in set*State has applied or skipped
+    inline void countStateChanges(CommandListStatistics& statistics, std::initializer_list<bool> updates)
+    {
+        for (bool update : updates)
+        {
+            if (update)
+                ++statistics.numStateChangesApplied;
+            else
+                ++statistics.numStateChangesSkipped;
+        }
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "dxgi-memory.h"
+
+namespace nvrhi
+{
+    DxgiMemoryBudget::~DxgiMemoryBudget()
+    {
+        if (m_BudgetChangeEvent)
+        {
+            if (m_Adapter)
+                m_Adapter->UnregisterVideoMemoryBudgetChangeNotification(m_BudgetChangeCookie);
+
+            CloseHandle(m_BudgetChangeEvent);
+            m_BudgetChangeEvent = nullptr;
+        }
+    }
+
+    void DxgiMemoryBudget::initialize(IDXGIAdapter* adapter)
+    {
+        if (!adapter || FAILED(adapter->QueryInterface(IID_PPV_ARGS(&m_Adapter))))
+            return;
+
+        m_BudgetChangeEvent = CreateEvent(nullptr, false, false, nullptr);
+        if (!m_BudgetChangeEvent)
+            return;
+
+        if (FAILED(m_Adapter->RegisterVideoMemoryBudgetChangeNotificationEvent(m_BudgetChangeEvent, &m_BudgetChangeCookie)))
+        {
+            CloseHandle(m_BudgetChangeEvent);
+            m_BudgetChangeEvent = nullptr;
+        }
+    }
+
+    void DxgiMemoryBudget::queryHeaps(MemoryStatistics& statistics) const
+    {
+        if (!m_Adapter)
+            return;
+
+        const DXGI_MEMORY_SEGMENT_GROUP segmentGroups[] = { DXGI_MEMORY_SEGMENT_GROUP_LOCAL, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL };
+
+        for (DXGI_MEMORY_SEGMENT_GROUP segmentGroup : segmentGroups)
+        {
+            DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+            if (FAILED(m_Adapter->QueryVideoMemoryInfo(0, segmentGroup, &info)))
+                continue;
+
+            MemoryHeapStatistics& heap = statistics.heaps.emplace_back();
+            heap.deviceLocal = (segmentGroup == DXGI_MEMORY_SEGMENT_GROUP_LOCAL);
+            heap.usage = info.CurrentUsage;
+            heap.budget = info.Budget;
+
+            statistics.budgetAvailable = true;
+        }
+    }
+
+    bool DxgiMemoryBudget::pollBudgetChange()
+    {
+        if (!m_BudgetChangeEvent)
+            return false;
+
+        return WaitForSingleObject(m_BudgetChangeEvent, 0) == WAIT_OBJECT_0;
+    }
+}
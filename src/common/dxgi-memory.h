@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <dxgi1_4.h>
+
+namespace nvrhi
+{
+    // Queries the video memory budget of a DXGI adapter and watches for budget changes.
+    // Does nothing on systems where the adapter doesn't implement IDXGIAdapter3.
+    class DxgiMemoryBudget
+    {
+    public:
+        DxgiMemoryBudget() = default;
+        ~DxgiMemoryBudget();
+
+        DxgiMemoryBudget(const DxgiMemoryBudget&) = delete;
+        DxgiMemoryBudget& operator=(const DxgiMemoryBudget&) = delete;
+
+        void initialize(IDXGIAdapter* adapter);
+
+        // Adds one local and one non-local heap to the statistics and sets budgetAvailable
+        void queryHeaps(MemoryStatistics& statistics) const;
+
+        // Returns true if the budget has changed since the last call
+        bool pollBudgetChange();
+
+    private:
+        RefCountPtr<IDXGIAdapter3> m_Adapter;
+        HANDLE m_BudgetChangeEvent = nullptr;
+        DWORD m_BudgetChangeCookie = 0;
+    };
+}
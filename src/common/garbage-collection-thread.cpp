@@ -0,0 +1,59 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "garbage-collection-thread.h"
+
+namespace nvrhi
+{
+    GarbageCollectionThread::GarbageCollectionThread(std::function<void()> collect, std::chrono::microseconds interval)
+        : m_Collect(std::move(collect))
+        , m_Interval(interval)
+    {
+        // Start the thread last, after the members it uses are initialized
+        m_Thread = std::thread(&GarbageCollectionThread::run, this);
+    }
+
+    GarbageCollectionThread::~GarbageCollectionThread()
+    {
+        {
+            std::lock_guard lockGuard(m_Mutex);
+            m_Stop = true;
+        }
+
+        m_Condition.notify_one();
+        m_Thread.join();
+    }
+
+    void GarbageCollectionThread::run()
+    {
+        std::unique_lock lock(m_Mutex);
+
+        while (!m_Condition.wait_for(lock, m_Interval, [this] { return m_Stop; }))
+        {
+            // The collection doesn't need the mutex, and holding it would delay the destructor
+            lock.unlock();
+            m_Collect();
+            lock.lock();
+        }
+    }
+}
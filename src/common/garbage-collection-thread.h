@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace nvrhi
+{
+    // A thread owned by a device that periodically retires the command lists that have finished executing,
+    // see DeviceDesc::enableBackgroundGarbageCollection. The callback must be safe to run concurrently with
+    // command list submission and with IDevice::runGarbageCollection.
+    class GarbageCollectionThread
+    {
+    public:
+        GarbageCollectionThread(std::function<void()> collect, std::chrono::microseconds interval);
+
+        // Stops the thread and waits for the current collection to finish
+        ~GarbageCollectionThread();
+
+        GarbageCollectionThread(const GarbageCollectionThread&) = delete;
+        GarbageCollectionThread& operator=(const GarbageCollectionThread&) = delete;
+
+    private:
+        std::function<void()> m_Collect;
+        std::chrono::microseconds m_Interval;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        bool m_Stop = false;
+        std::thread m_Thread;
+
+        void run();
+    };
+}
@@ -0,0 +1,252 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "gpu-profiler.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace nvrhi
+{
+    GpuProfilerBase::GpuProfilerBase(IDevice* device, const GpuProfilerDesc& desc)
+        : m_Device(device)
+        , m_Desc(desc)
+    {
+    }
+
+    bool GpuProfilerBase::initialize()
+    {
+        if (m_Desc.maxScopesPerFrame == 0 || m_Desc.maxFramesInFlight == 0)
+            return false;
+
+        BufferDesc bufferDesc;
+        bufferDesc.byteSize = uint64_t(getTotalQueryCount()) * sizeof(uint64_t);
+        bufferDesc.cpuAccess = CpuAccessMode::Read;
+        bufferDesc.debugName = "GpuProfilerReadback";
+        bufferDesc.initialState = ResourceStates::CopyDest;
+        bufferDesc.keepInitialState = true;
+        m_ReadbackBuffer = m_Device->createBuffer(bufferDesc);
+        if (!m_ReadbackBuffer)
+            return false;
+
+        m_Slots.resize(m_Desc.maxFramesInFlight);
+        for (FrameSlot& slot : m_Slots)
+        {
+            slot.commandList = m_Device->createCommandList(CommandListParameters()
+                .setEnableImmediateExecution(false)
+                .setQueueType(m_Desc.queue));
+            slot.query = m_Device->createEventQuery();
+            if (!slot.commandList || !slot.query)
+                return false;
+
+            slot.scopes.reserve(m_Desc.maxScopesPerFrame);
+        }
+
+        return true;
+    }
+
+    void GpuProfilerBase::beginFrame()
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        // beginFrame without a matching endFrame keeps recording into the current frame
+        if (m_FrameActive)
+            return;
+
+        FrameSlot& slot = m_Slots[m_CurrentSlot];
+
+        if (slot.pending)
+        {
+            // All slots are in flight: wait for the oldest frame and keep its results until they are requested.
+            m_Device->waitEventQuery(slot.query);
+            m_CompletedFrames.emplace_back();
+            readFrameResults(slot, m_CurrentSlot, m_CompletedFrames.back());
+            m_OldestPendingSlot = (m_CurrentSlot + 1) % m_Desc.maxFramesInFlight;
+        }
+
+        slot.scopes.clear();
+        slot.frameIndex = m_FrameCounter++;
+        slot.numDroppedScopes = 0;
+        slot.hasCalibration = false;
+        m_FrameActive = true;
+    }
+
+    void GpuProfilerBase::endFrame()
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (!m_FrameActive)
+            return;
+
+        FrameSlot& slot = m_Slots[m_CurrentSlot];
+        const uint32_t slotBase = m_CurrentSlot * m_Desc.maxScopesPerFrame;
+        const uint32_t numScopes = uint32_t(slot.scopes.size());
+
+        slot.commandList->open();
+
+        // Close the scopes that were left open so that every query in the resolved range has a value
+        for (uint32_t index = 0; index < numScopes; ++index)
+        {
+            if (!slot.scopes[index].ended)
+                recordTimestamp(slot.commandList, getEndQuery(slotBase + index));
+        }
+
+        if (numScopes > 0)
+        {
+            const uint32_t firstQuery = getBeginQuery(slotBase);
+            recordResolve(slot.commandList, firstQuery, numScopes * 2, m_ReadbackBuffer, uint64_t(firstQuery) * sizeof(uint64_t));
+        }
+
+        slot.commandList->close();
+
+        ICommandList* commandList = slot.commandList;
+        m_Device->executeCommandLists(&commandList, 1, m_Desc.queue);
+        m_Device->resetEventQuery(slot.query);
+        m_Device->setEventQuery(slot.query, m_Desc.queue);
+
+        slot.hasCalibration = getClockCalibration(slot.calibrationGpuTimestamp, slot.calibrationCpuSeconds);
+
+        bool anyPending = false;
+        for (const FrameSlot& other : m_Slots)
+            anyPending = anyPending || other.pending;
+        if (!anyPending)
+            m_OldestPendingSlot = m_CurrentSlot;
+
+        slot.pending = true;
+        m_CurrentSlot = (m_CurrentSlot + 1) % m_Desc.maxFramesInFlight;
+        m_FrameActive = false;
+    }
+
+    bool GpuProfilerBase::getFrameResults(GpuProfilerFrameResults& outResults)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (!m_CompletedFrames.empty())
+        {
+            outResults = std::move(m_CompletedFrames.front());
+            m_CompletedFrames.pop_front();
+            return true;
+        }
+
+        FrameSlot& slot = m_Slots[m_OldestPendingSlot];
+        if (!slot.pending || !m_Device->pollEventQuery(slot.query))
+            return false;
+
+        readFrameResults(slot, m_OldestPendingSlot, outResults);
+        m_OldestPendingSlot = (m_OldestPendingSlot + 1) % m_Desc.maxFramesInFlight;
+        return true;
+    }
+
+    uint32_t GpuProfilerBase::beginScope(const char* name, uint32_t parentScope)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (!m_FrameActive)
+            return c_InvalidScope;
+
+        FrameSlot& slot = m_Slots[m_CurrentSlot];
+        if (slot.scopes.size() >= m_Desc.maxScopesPerFrame)
+        {
+            ++slot.numDroppedScopes;
+            return c_InvalidScope;
+        }
+
+        const uint32_t slotBase = m_CurrentSlot * m_Desc.maxScopesPerFrame;
+
+        ScopeRecord& record = slot.scopes.emplace_back();
+        record.name = name ? name : "";
+
+        // A parent from another frame can happen when a command list stays open across endFrame
+        if (parentScope != c_InvalidScope && parentScope >= slotBase && parentScope - slotBase < slot.scopes.size() - 1)
+            record.parent = parentScope - slotBase;
+
+        return slotBase + uint32_t(slot.scopes.size() - 1);
+    }
+
+    void GpuProfilerBase::endScope(uint32_t scope)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (scope == c_InvalidScope)
+            return;
+
+        const uint32_t slotIndex = scope / m_Desc.maxScopesPerFrame;
+        const uint32_t index = scope % m_Desc.maxScopesPerFrame;
+        FrameSlot& slot = m_Slots[slotIndex];
+        if (index < slot.scopes.size())
+            slot.scopes[index].ended = true;
+    }
+
+    void GpuProfilerBase::readFrameResults(FrameSlot& slot, uint32_t slotIndex, GpuProfilerFrameResults& outResults)
+    {
+        slot.pending = false;
+
+        outResults.frameIndex = slot.frameIndex;
+        outResults.numDroppedScopes = slot.numDroppedScopes;
+        outResults.scopes.clear();
+        outResults.cpuBeginTime = 0.0;
+        outResults.hasCpuTime = false;
+
+        const uint32_t numScopes = uint32_t(slot.scopes.size());
+        if (numScopes == 0)
+            return;
+
+        const uint64_t* timestamps = static_cast<const uint64_t*>(m_Device->mapBuffer(m_ReadbackBuffer, CpuAccessMode::Read));
+        if (!timestamps)
+            return;
+
+        timestamps += getBeginQuery(slotIndex * m_Desc.maxScopesPerFrame);
+
+        uint64_t frameBegin = std::numeric_limits<uint64_t>::max();
+        for (uint32_t index = 0; index < numScopes; ++index)
+            frameBegin = std::min(frameBegin, timestamps[getBeginQuery(index)]);
+
+        const double millisecondsPerTick = getTimestampPeriod() * 1000.0;
+
+        outResults.scopes.resize(numScopes);
+        for (uint32_t index = 0; index < numScopes; ++index)
+        {
+            const ScopeRecord& record = slot.scopes[index];
+            GpuProfilerScope& scope = outResults.scopes[index];
+
+            scope.name = record.name;
+            scope.parent = record.parent;
+            scope.depth = (record.parent == c_GpuProfilerNoParent) ? 0 : outResults.scopes[record.parent].depth + 1;
+
+            const uint64_t begin = timestamps[getBeginQuery(index)];
+            const uint64_t end = std::max(begin, timestamps[getEndQuery(index)]);
+            scope.beginMilliseconds = double(begin - frameBegin) * millisecondsPerTick;
+            scope.endMilliseconds = double(end - frameBegin) * millisecondsPerTick;
+        }
+
+        m_Device->unmapBuffer(m_ReadbackBuffer);
+
+        if (slot.hasCalibration)
+        {
+            const double deltaSeconds = (double(frameBegin) - double(slot.calibrationGpuTimestamp)) * getTimestampPeriod();
+            outResults.cpuBeginTime = slot.calibrationCpuSeconds + deltaSeconds;
+            outResults.hasCpuTime = true;
+        }
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace nvrhi
+{
+    // Backend-independent part of IGpuProfiler: allocates scopes and query indices, submits the per-frame resolve
+    // and builds the frame results. Every scope uses two consecutive queries, (scope * 2) and (scope * 2 + 1),
+    // and the queries of each frame slot are resolved into the readback buffer with one operation.
+    class GpuProfilerBase : public RefCounter<IGpuProfiler>
+    {
+    public:
+        static constexpr uint32_t c_InvalidScope = ~0u;
+
+        GpuProfilerBase(IDevice* device, const GpuProfilerDesc& desc);
+
+        // Creates the readback buffer and the per-frame command lists and queries. Returns false on failure.
+        bool initialize();
+
+        void beginFrame() override;
+        void endFrame() override;
+        bool getFrameResults(GpuProfilerFrameResults& outResults) override;
+
+        // Called by the command lists from beginMarker/endMarker. The parent is the innermost scope that is open
+        // in the same command list, or c_InvalidScope. beginScope returns c_InvalidScope if there is no active frame
+        // or the frame is out of scopes; such scopes must not record timestamps.
+        uint32_t beginScope(const char* name, uint32_t parentScope);
+        void endScope(uint32_t scope);
+
+        [[nodiscard]] const GpuProfilerDesc& getDesc() const { return m_Desc; }
+        [[nodiscard]] uint32_t getTotalQueryCount() const { return m_Desc.maxScopesPerFrame * m_Desc.maxFramesInFlight * 2; }
+
+        static uint32_t getBeginQuery(uint32_t scope) { return scope * 2; }
+        static uint32_t getEndQuery(uint32_t scope) { return scope * 2 + 1; }
+
+    protected:
+        // Records a timestamp query from a command list that is open on the profiler's queue.
+        virtual void recordTimestamp(ICommandList* commandList, uint32_t queryIndex) = 0;
+
+        // Copies 64-bit timestamps [firstQuery, firstQuery + numQueries) into the buffer and prepares the queries for reuse.
+        virtual void recordResolve(ICommandList* commandList, uint32_t firstQuery, uint32_t numQueries, IBuffer* buffer, uint64_t bufferOffset) = 0;
+
+        // Length of one timestamp tick, in seconds.
+        virtual double getTimestampPeriod() = 0;
+
+        // Samples a GPU timestamp and the CPU time at the same moment, see GpuProfilerFrameResults::cpuBeginTime.
+        virtual bool getClockCalibration(uint64_t& outGpuTimestamp, double& outCpuSeconds) = 0;
+
+        DeviceHandle m_Device;
+
+    private:
+        struct ScopeRecord
+        {
+            std::string name;
+            uint32_t parent = c_GpuProfilerNoParent;
+            bool ended = false;
+        };
+
+        struct FrameSlot
+        {
+            std::vector<ScopeRecord> scopes;
+            CommandListHandle commandList;
+            EventQueryHandle query;
+            uint64_t frameIndex = 0;
+            uint32_t numDroppedScopes = 0;
+            bool pending = false;
+            bool hasCalibration = false;
+            uint64_t calibrationGpuTimestamp = 0;
+            double calibrationCpuSeconds = 0.0;
+        };
+
+        void readFrameResults(FrameSlot& slot, uint32_t slotIndex, GpuProfilerFrameResults& outResults);
+
+        GpuProfilerDesc m_Desc;
+        BufferHandle m_ReadbackBuffer;
+        std::vector<FrameSlot> m_Slots;
+        std::deque<GpuProfilerFrameResults> m_CompletedFrames;
+        std::mutex m_Mutex;
+        uint64_t m_FrameCounter = 0;
+        uint32_t m_CurrentSlot = 0;
+        uint32_t m_OldestPendingSlot = 0;
+        bool m_FrameActive = false;
+    };
+
+} // namespace nvrhi
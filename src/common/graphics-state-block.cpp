@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "graphics-state-block.h"
+#include <nvrhi/common/hash.h>
+
+namespace nvrhi
+{
+    GraphicsStateBlock::GraphicsStateBlock(const GraphicsState& _state)
+        : state(_state)
+        , hash(computeHash(_state))
+    {
+        m_References.push_back(state.pipeline);
+        m_References.push_back(state.framebuffer);
+
+        for (IBindingSet* bindingSet : state.bindings)
+        {
+            if (bindingSet)
+                m_References.push_back(bindingSet);
+        }
+
+        for (const VertexBufferBinding& binding : state.vertexBuffers)
+        {
+            if (binding.buffer)
+                m_References.push_back(binding.buffer);
+        }
+
+        if (state.indexBuffer.buffer)
+            m_References.push_back(state.indexBuffer.buffer);
+
+        if (state.indirectParams)
+            m_References.push_back(state.indirectParams);
+
+        if (state.indirectCountBuffer)
+            m_References.push_back(state.indirectCountBuffer);
+    }
+
+    uint64_t GraphicsStateBlock::computeHash(const GraphicsState& state)
+    {
+        size_t hash = 0;
+        hash_combine(hash, state.pipeline);
+        hash_combine(hash, state.framebuffer);
+
+        for (const Viewport& viewport : state.viewport.viewports)
+        {
+            hash_combine(hash, viewport.minX);
+            hash_combine(hash, viewport.maxX);
+            hash_combine(hash, viewport.minY);
+            hash_combine(hash, viewport.maxY);
+            hash_combine(hash, viewport.minZ);
+            hash_combine(hash, viewport.maxZ);
+        }
+
+        for (const Rect& rect : state.viewport.scissorRects)
+        {
+            hash_combine(hash, rect.minX);
+            hash_combine(hash, rect.maxX);
+            hash_combine(hash, rect.minY);
+            hash_combine(hash, rect.maxY);
+        }
+
+        hash_combine(hash, state.shadingRateState.enabled);
+        hash_combine(hash, uint32_t(state.shadingRateState.shadingRate));
+        hash_combine(hash, uint32_t(state.shadingRateState.pipelinePrimitiveCombiner));
+        hash_combine(hash, uint32_t(state.shadingRateState.imageCombiner));
+        hash_combine(hash, state.blendConstantColor.r);
+        hash_combine(hash, state.blendConstantColor.g);
+        hash_combine(hash, state.blendConstantColor.b);
+        hash_combine(hash, state.blendConstantColor.a);
+        hash_combine(hash, state.dynamicStencilRefValue);
+
+        const DynamicRenderState& dynamicState = state.dynamicRenderState;
+        hash_combine(hash, uint32_t(dynamicState.primType));
+        hash_combine(hash, uint32_t(dynamicState.cullMode));
+        hash_combine(hash, dynamicState.frontCounterClockwise);
+        hash_combine(hash, dynamicState.depthTestEnable);
+        hash_combine(hash, dynamicState.depthWriteEnable);
+        hash_combine(hash, uint32_t(dynamicState.depthFunc));
+        hash_combine(hash, dynamicState.stencilEnable);
+        for (const DepthStencilState::StencilOpDesc* stencil : { &dynamicState.frontFaceStencil, &dynamicState.backFaceStencil })
+        {
+            hash_combine(hash, uint32_t(stencil->failOp));
+            hash_combine(hash, uint32_t(stencil->depthFailOp));
+            hash_combine(hash, uint32_t(stencil->passOp));
+            hash_combine(hash, uint32_t(stencil->stencilFunc));
+        }
+
+        for (IBindingSet* bindingSet : state.bindings)
+            hash_combine(hash, bindingSet);
+
+        for (const VertexBufferBinding& binding : state.vertexBuffers)
+        {
+            hash_combine(hash, binding.buffer);
+            hash_combine(hash, binding.slot);
+            hash_combine(hash, binding.offset);
+        }
+
+        hash_combine(hash, state.indexBuffer.buffer);
+        hash_combine(hash, uint32_t(state.indexBuffer.format));
+        hash_combine(hash, state.indexBuffer.offset);
+        hash_combine(hash, state.indirectParams);
+        hash_combine(hash, state.indirectCountBuffer);
+
+        return uint64_t(hash);
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <vector>
+
+namespace nvrhi
+{
+    // Backend-independent part of IGraphicsStateBlock: it owns references to all objects in the state
+    // and the precomputed hash. Backends derive from it to add their own baked data.
+    class GraphicsStateBlock : public RefCounter<IGraphicsStateBlock>
+    {
+    public:
+        GraphicsState state;
+        uint64_t hash = 0;
+
+        explicit GraphicsStateBlock(const GraphicsState& _state);
+
+        [[nodiscard]] const GraphicsState& getState() const override { return state; }
+        [[nodiscard]] uint64_t getHash() const override { return hash; }
+
+        static uint64_t computeHash(const GraphicsState& state);
+
+    private:
+        std::vector<ResourceHandle> m_References;
+    };
+
+} // namespace nvrhi
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace nvrhi
+{
+    // Counts the memory that a backend allocates for its own purposes, reported through IDevice::getMemoryStatistics.
+    struct InternalMemoryCounters
+    {
+        std::atomic<uint64_t> uploadBufferBytes = 0;
+        std::atomic<uint64_t> scratchBufferBytes = 0;
+        std::atomic<uint64_t> descriptorHeapBytes = 0;
+        std::atomic<uint64_t> compactionSavedBytes = 0;
+    };
+
+    // Adds the size of an allocation to one of the counters for as long as the object exists.
+    // The counters are shared so that allocations released after the device don't access freed memory.
+    class TrackedAllocation
+    {
+    public:
+        typedef std::atomic<uint64_t> InternalMemoryCounters::* Counter;
+
+        TrackedAllocation() = default;
+
+        TrackedAllocation(std::shared_ptr<InternalMemoryCounters> counters, Counter counter, uint64_t size)
+            : m_Counters(std::move(counters))
+            , m_Counter(counter)
+            , m_Size(size)
+        {
+            if (m_Counters)
+                ((*m_Counters).*m_Counter) += m_Size;
+        }
+
+        ~TrackedAllocation() { reset(); }
+
+        TrackedAllocation(const TrackedAllocation&) = delete;
+        TrackedAllocation& operator=(const TrackedAllocation&) = delete;
+
+        TrackedAllocation(TrackedAllocation&& other) noexcept
+            : m_Counters(std::move(other.m_Counters))
+            , m_Counter(other.m_Counter)
+            , m_Size(other.m_Size)
+        {
+            other.m_Size = 0;
+        }
+
+        TrackedAllocation& operator=(TrackedAllocation&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                m_Counters = std::move(other.m_Counters);
+                m_Counter = other.m_Counter;
+                m_Size = other.m_Size;
+                other.m_Size = 0;
+            }
+            return *this;
+        }
+
+        void reset()
+        {
+            if (m_Counters)
+                ((*m_Counters).*m_Counter) -= m_Size;
+
+            m_Counters.reset();
+            m_Size = 0;
+        }
+
+    private:
+        std::shared_ptr<InternalMemoryCounters> m_Counters;
+        Counter m_Counter = nullptr;
+        uint64_t m_Size = 0;
+    };
+
+} // namespace nvrhi
@@ -0,0 +1,293 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+#include <nvrhi/utils.h>
+
+#include <algorithm>
+
+#if NVRHI_EMBEDDED_DXIL
+#include "generate-mips.dxil.h"
+#endif
+#if NVRHI_EMBEDDED_SPIRV
+#include "generate-mips.spirv.h"
+#endif
+
+namespace nvrhi::utils
+{
+    // Matches the Constants structure in src/common/shaders/generate-mips.hlsl
+    struct MipGeneratorConstants
+    {
+        uint32_t inputSize[2];
+        float invInputSize[2];
+        uint32_t numMips;
+        uint32_t numGroups;
+        uint32_t isSRGB;
+        uint32_t padding;
+    };
+
+    static constexpr uint32_t c_MaxMipsPerDispatch = 12;
+    static constexpr uint32_t c_TileSize = 64;
+    static constexpr uint32_t c_CounterSlot = 12;
+    static constexpr uint32_t c_IntermediateSlot = 13;
+    static constexpr uint32_t c_IntermediateTexelsPerSlice = 64 * 64;
+
+    // The last thread group of a dispatch can only reduce 64x64 tiles, so inputs larger than this only get the first 6 mips
+    static constexpr uint32_t c_MaxSinglePassSize = c_TileSize * 64;
+
+    static Format getLinearFormat(Format format)
+    {
+        switch (format)  // NOLINT(clang-diagnostic-switch-enum)
+        {
+        case Format::SRGBA8_UNORM: return Format::RGBA8_UNORM;
+        case Format::SBGRA8_UNORM: return Format::BGRA8_UNORM;
+        default: return format;
+        }
+    }
+
+    MipGenerator::MipGenerator(IDevice* device)
+        : m_Device(device)
+    {
+    }
+
+    bool MipGenerator::initialize()
+    {
+        if (m_Initialized)
+            return m_Pipeline != nullptr;
+
+        m_Initialized = true;
+
+        const void* binary = nullptr;
+        size_t binarySize = 0;
+
+        switch (m_Device->getGraphicsAPI())
+        {
+        case GraphicsAPI::D3D12:
+#if NVRHI_EMBEDDED_DXIL
+            binary = g_GenerateMipsDXIL;
+            binarySize = sizeof(g_GenerateMipsDXIL);
+#endif
+            break;
+
+        case GraphicsAPI::VULKAN:
+#if NVRHI_EMBEDDED_SPIRV
+            binary = g_GenerateMipsSPIRV;
+            binarySize = sizeof(g_GenerateMipsSPIRV);
+#endif
+            break;
+
+        case GraphicsAPI::D3D11:
+        default:
+            break;
+        }
+
+        if (!binary)
+            return false;
+
+        ShaderDesc shaderDesc(ShaderType::Compute);
+        shaderDesc.debugName = "MipGenerator";
+        m_Shader = m_Device->createShader(shaderDesc, binary, binarySize);
+
+        BindingLayoutDesc layoutDesc;
+        layoutDesc.setVisibility(ShaderType::Compute)
+            .addItem(BindingLayoutItem::PushConstants(0, sizeof(MipGeneratorConstants)))
+            .addItem(BindingLayoutItem::Texture_SRV(0))
+            .addItem(BindingLayoutItem::Sampler(0));
+        for (uint32_t mip = 0; mip < c_MaxMipsPerDispatch; mip++)
+            layoutDesc.addItem(BindingLayoutItem::Texture_UAV(mip));
+        layoutDesc.addItem(BindingLayoutItem::StructuredBuffer_UAV(c_CounterSlot))
+            .addItem(BindingLayoutItem::StructuredBuffer_UAV(c_IntermediateSlot));
+
+        m_BindingLayout = m_Device->createBindingLayout(layoutDesc);
+
+        m_Sampler = m_Device->createSampler(SamplerDesc()
+            .setAllFilters(true)
+            .setAllAddressModes(SamplerAddressMode::Clamp));
+
+        if (!m_Shader || !m_BindingLayout || !m_Sampler)
+            return false;
+
+        m_Pipeline = m_Device->createComputePipeline(ComputePipelineDesc()
+            .setComputeShader(m_Shader)
+            .addBindingLayout(m_BindingLayout));
+
+        return m_Pipeline != nullptr;
+    }
+
+    bool MipGenerator::reserveArraySlices(uint32_t arraySlices)
+    {
+        if (arraySlices <= m_MaxArraySlices)
+            return true;
+
+        m_CounterBuffer = m_Device->createBuffer(BufferDesc()
+            .setByteSize(sizeof(uint32_t) * arraySlices)
+            .setStructStride(sizeof(uint32_t))
+            .setCanHaveUAVs(true)
+            .setInitialState(ResourceStates::UnorderedAccess)
+            .setKeepInitialState(true)
+            .setDebugName("MipGenerator/Counters"));
+
+        m_IntermediateBuffer = m_Device->createBuffer(BufferDesc()
+            .setByteSize(sizeof(float) * 4 * c_IntermediateTexelsPerSlice * arraySlices)
+            .setStructStride(sizeof(float) * 4)
+            .setCanHaveUAVs(true)
+            .setInitialState(ResourceStates::UnorderedAccess)
+            .setKeepInitialState(true)
+            .setDebugName("MipGenerator/Intermediate"));
+
+        if (!m_CounterBuffer || !m_IntermediateBuffer)
+        {
+            m_MaxArraySlices = 0;
+            return false;
+        }
+
+        m_MaxArraySlices = arraySlices;
+        return true;
+    }
+
+    bool MipGenerator::isSupported()
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        return initialize();
+    }
+
+    bool MipGenerator::isTextureSupported(ITexture* texture)
+    {
+        const TextureDesc& desc = texture->getDesc();
+        const FormatInfo& formatInfo = getFormatInfo(desc.format);
+
+        if (!desc.isUAV || desc.sampleCount > 1 || formatInfo.blockSize != 1)
+            return false;
+
+        if (formatInfo.kind != FormatKind::Normalized && formatInfo.kind != FormatKind::Float)
+            return false;
+
+        // The linear UAVs of sRGB textures need a format that can be reinterpreted
+        if (formatInfo.isSRGB && !desc.isTypeless)
+            return false;
+
+        switch (desc.dimension)  // NOLINT(clang-diagnostic-switch-enum)
+        {
+        case TextureDimension::Texture2D:
+        case TextureDimension::Texture2DArray:
+        case TextureDimension::TextureCube:
+        case TextureDimension::TextureCubeArray:
+            break;
+        default:
+            return false;
+        }
+
+        const FormatSupport support = m_Device->queryFormatSupport(getLinearFormat(desc.format));
+        return (support & FormatSupport::ShaderUavStore) != 0 && (m_Device->queryFormatSupport(desc.format) & FormatSupport::ShaderSample) != 0;
+    }
+
+    bool MipGenerator::generateMips(ICommandList* commandList, ITexture* texture, MipLevel baseMipLevel)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (!initialize())
+        {
+            m_Device->getMessageCallback()->message(MessageSeverity::Error,
+                "MipGenerator: no embedded shaders for this graphics API. DX11 is not supported, DX12 and Vulkan require "
+                "the library to be built with NVRHI_EMBED_SHADERS");
+            return false;
+        }
+
+        if (!commandList || !texture || !isTextureSupported(texture))
+        {
+            m_Device->getMessageCallback()->message(MessageSeverity::Error,
+                "MipGenerator: the texture must be a 2D, 2D array or cube texture with isUAV = true and a normalized or float format "
+                "that supports typed UAV stores, and sRGB textures must have isTypeless = true");
+            return false;
+        }
+
+        const TextureDesc& desc = texture->getDesc();
+        if (baseMipLevel + 1 >= desc.mipLevels)
+            return true;
+
+        if (!reserveArraySlices(desc.arraySize))
+            return false;
+
+        const Format linearFormat = getLinearFormat(desc.format);
+        const bool isSRGB = getFormatInfo(desc.format).isSRGB;
+
+        MipLevel inputMip = baseMipLevel;
+        while (inputMip + 1 < desc.mipLevels)
+        {
+            const uint32_t inputWidth = std::max(desc.width >> inputMip, 1u);
+            const uint32_t inputHeight = std::max(desc.height >> inputMip, 1u);
+
+            const uint32_t maxMips = (std::max(inputWidth, inputHeight) > c_MaxSinglePassSize) ? 6 : c_MaxMipsPerDispatch;
+            const uint32_t numMips = std::min(maxMips, desc.mipLevels - inputMip - 1);
+
+            BindingSetDesc setDesc;
+            setDesc.addItem(BindingSetItem::PushConstants(0, sizeof(MipGeneratorConstants)))
+                .addItem(BindingSetItem::Texture_SRV(0, texture, Format::UNKNOWN,
+                    TextureSubresourceSet(inputMip, 1, 0, desc.arraySize), TextureDimension::Texture2DArray))
+                .addItem(BindingSetItem::Sampler(0, m_Sampler));
+
+            // The slots past the last generated mip are never written, they get the first output mip
+            for (uint32_t mip = 0; mip < c_MaxMipsPerDispatch; mip++)
+            {
+                const MipLevel outputMip = inputMip + 1 + (mip < numMips ? mip : 0);
+                setDesc.addItem(BindingSetItem::Texture_UAV(mip, texture, linearFormat,
+                    TextureSubresourceSet(outputMip, 1, 0, desc.arraySize), TextureDimension::Texture2DArray));
+            }
+
+            setDesc.addItem(BindingSetItem::StructuredBuffer_UAV(c_CounterSlot, m_CounterBuffer))
+                .addItem(BindingSetItem::StructuredBuffer_UAV(c_IntermediateSlot, m_IntermediateBuffer));
+
+            BindingSetHandle bindingSet = m_Device->createBindingSet(setDesc, m_BindingLayout);
+            if (!bindingSet)
+                return false;
+
+            const uint32_t numGroupsX = (inputWidth + c_TileSize - 1) / c_TileSize;
+            const uint32_t numGroupsY = (inputHeight + c_TileSize - 1) / c_TileSize;
+
+            MipGeneratorConstants constants = {};
+            constants.inputSize[0] = inputWidth;
+            constants.inputSize[1] = inputHeight;
+            constants.invInputSize[0] = 1.f / float(inputWidth);
+            constants.invInputSize[1] = 1.f / float(inputHeight);
+            constants.numMips = numMips;
+            constants.numGroups = numGroupsX * numGroupsY;
+            constants.isSRGB = isSRGB ? 1 : 0;
+
+            // The last thread group of every slice is found by counting the finished groups
+            if (numMips > 6)
+                commandList->clearBufferUInt(m_CounterBuffer, 0);
+
+            commandList->setComputeState(ComputeState()
+                .setPipeline(m_Pipeline)
+                .addBindingSet(bindingSet));
+            commandList->setPushConstants(&constants, sizeof(constants));
+            commandList->dispatch(numGroupsX, numGroupsY, desc.arraySize);
+
+            inputMip += numMips;
+        }
+
+        return true;
+    }
+
+} // namespace nvrhi::utils
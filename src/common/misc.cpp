@@ -120,6 +120,38 @@ namespace nvrhi
         return result;
     }
     
+    uint32_t IndirectArgumentDesc::getByteSize() const
+    {
+        switch (type)
+        {
+        case IndirectArgumentType::Draw:
+            return sizeof(DrawIndirectArguments);
+        case IndirectArgumentType::DrawIndexed:
+            return sizeof(DrawIndexedIndirectArguments);
+        case IndirectArgumentType::Dispatch:
+            return 3 * sizeof(uint32_t);
+        case IndirectArgumentType::VertexBuffer:
+            return sizeof(IndirectVertexBufferArguments);
+        case IndirectArgumentType::IndexBuffer:
+            return sizeof(IndirectIndexBufferArguments);
+        case IndirectArgumentType::PushConstants:
+            return numPushConstantValues * sizeof(uint32_t);
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t CommandSignatureDesc::getCommandByteStride() const
+    {
+        if (byteStride != 0)
+            return byteStride;
+
+        uint32_t packedSize = 0;
+        for (const IndirectArgumentDesc& argument : arguments)
+            packedSize += argument.getByteSize();
+        return packedSize;
+    }
+
     bool BlendState::RenderTarget::usesConstantColor() const
     {
         return srcBlend == BlendFactor::ConstantColor || srcBlend == BlendFactor::OneMinusConstantColor ||
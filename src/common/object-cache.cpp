@@ -0,0 +1,164 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+#include "object-cache.h"
+
+namespace nvrhi
+{
+    // The hashes only cover the fields that usually differ, the keys are compared in full
+
+    static void hashRenderState(size_t& hash, const RenderState& state)
+    {
+        hash_combine(hash, state.blendState);
+        hash_combine(hash, state.depthStencilState.depthTestEnable);
+        hash_combine(hash, state.depthStencilState.depthWriteEnable);
+        hash_combine(hash, state.depthStencilState.depthFunc);
+        hash_combine(hash, state.depthStencilState.stencilEnable);
+        hash_combine(hash, state.rasterState.fillMode);
+        hash_combine(hash, state.rasterState.cullMode);
+        hash_combine(hash, state.rasterState.depthBias);
+        hash_combine(hash, state.extendedDynamicState);
+    }
+
+    static void hashBindingLayouts(size_t& hash, const BindingLayoutVector& layouts)
+    {
+        for (const BindingLayoutHandle& layout : layouts)
+            hash_combine(hash, layout.Get());
+    }
+
+    size_t ObjectCacheKeyHash::operator()(const FramebufferPipelineKey<GraphicsPipelineDesc>& key) const
+    {
+        const GraphicsPipelineDesc& desc = key.desc;
+
+        size_t hash = 0;
+        hash_combine(hash, desc.primType);
+        hash_combine(hash, desc.patchControlPoints);
+        hash_combine(hash, desc.inputLayout.Get());
+        hash_combine(hash, desc.VS.Get());
+        hash_combine(hash, desc.HS.Get());
+        hash_combine(hash, desc.DS.Get());
+        hash_combine(hash, desc.GS.Get());
+        hash_combine(hash, desc.PS.Get());
+        hashRenderState(hash, desc.renderState);
+        hashBindingLayouts(hash, desc.bindingLayouts);
+        hash_combine(hash, key.framebufferInfo);
+        hash_combine(hash, key.hasShadingRateAttachment);
+        return hash;
+    }
+
+    size_t ObjectCacheKeyHash::operator()(const FramebufferPipelineKey<MeshletPipelineDesc>& key) const
+    {
+        const MeshletPipelineDesc& desc = key.desc;
+
+        size_t hash = 0;
+        hash_combine(hash, desc.primType);
+        hash_combine(hash, desc.AS.Get());
+        hash_combine(hash, desc.MS.Get());
+        hash_combine(hash, desc.PS.Get());
+        hashRenderState(hash, desc.renderState);
+        hashBindingLayouts(hash, desc.bindingLayouts);
+        hash_combine(hash, key.framebufferInfo);
+        hash_combine(hash, key.hasShadingRateAttachment);
+        return hash;
+    }
+
+    size_t ObjectCacheKeyHash::operator()(const ComputePipelineDesc& desc) const
+    {
+        size_t hash = 0;
+        hash_combine(hash, desc.CS.Get());
+        hashBindingLayouts(hash, desc.bindingLayouts);
+        return hash;
+    }
+
+    size_t ObjectCacheKeyHash::operator()(const BindingSetKey& key) const
+    {
+        size_t hash = 0;
+        hash_combine(hash, key.desc);
+        hash_combine(hash, key.layout.Get());
+        return hash;
+    }
+
+    size_t ObjectCacheKeyHash::operator()(const SamplerDesc& desc) const
+    {
+        size_t hash = 0;
+        hash_combine(hash, desc.borderColor.r);
+        hash_combine(hash, desc.borderColor.g);
+        hash_combine(hash, desc.borderColor.b);
+        hash_combine(hash, desc.borderColor.a);
+        hash_combine(hash, desc.maxAnisotropy);
+        hash_combine(hash, desc.mipBias);
+        hash_combine(hash, desc.minFilter);
+        hash_combine(hash, desc.magFilter);
+        hash_combine(hash, desc.mipFilter);
+        hash_combine(hash, desc.addressU);
+        hash_combine(hash, desc.addressV);
+        hash_combine(hash, desc.addressW);
+        hash_combine(hash, desc.reductionType);
+        return hash;
+    }
+
+    void ObjectCache::setEnabled(bool enable)
+    {
+        m_Enabled.store(enable, std::memory_order_relaxed);
+
+        if (!enable)
+            clear();
+    }
+
+    void ObjectCache::collectGarbage()
+    {
+        m_GraphicsPipelines.collectGarbage();
+        m_MeshletPipelines.collectGarbage();
+        m_ComputePipelines.collectGarbage();
+        // Binding sets go before the samplers that they reference
+        m_BindingSets.collectGarbage();
+        m_Samplers.collectGarbage();
+    }
+
+    void ObjectCache::clear()
+    {
+        m_GraphicsPipelines.clear();
+        m_MeshletPipelines.clear();
+        m_ComputePipelines.clear();
+        m_BindingSets.clear();
+        m_Samplers.clear();
+    }
+
+    ObjectCacheStatistics ObjectCache::getStatistics(bool reset)
+    {
+        ObjectCacheStatistics statistics;
+        statistics.pipelines = m_GraphicsPipelines.getStatistics(reset);
+
+        for (const ObjectCacheStatistics::Counters& counters : { m_MeshletPipelines.getStatistics(reset), m_ComputePipelines.getStatistics(reset) })
+        {
+            statistics.pipelines.hits += counters.hits;
+            statistics.pipelines.misses += counters.misses;
+            statistics.pipelines.numObjects += counters.numObjects;
+        }
+
+        statistics.bindingSets = m_BindingSets.getStatistics(reset);
+        statistics.samplers = m_Samplers.getStatistics(reset);
+        return statistics;
+    }
+}
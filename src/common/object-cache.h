@@ -0,0 +1,246 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace nvrhi
+{
+    // Parameters that identify a graphics or meshlet pipeline: the pipeline description and the part of the
+    // framebuffer that the pipeline depends on
+    template<typename Desc>
+    struct FramebufferPipelineKey
+    {
+        Desc desc;
+        FramebufferInfo framebufferInfo;
+        bool hasShadingRateAttachment = false;
+
+        bool operator ==(const FramebufferPipelineKey& b) const
+        {
+            return desc == b.desc && framebufferInfo == b.framebufferInfo && hasShadingRateAttachment == b.hasShadingRateAttachment;
+        }
+    };
+
+    struct BindingSetKey
+    {
+        BindingSetDesc desc;
+        BindingLayoutHandle layout;
+
+        bool operator ==(const BindingSetKey& b) const
+        {
+            return desc == b.desc && layout == b.layout;
+        }
+    };
+
+    struct ObjectCacheKeyHash
+    {
+        size_t operator()(const FramebufferPipelineKey<GraphicsPipelineDesc>& key) const;
+        size_t operator()(const FramebufferPipelineKey<MeshletPipelineDesc>& key) const;
+        size_t operator()(const ComputePipelineDesc& desc) const;
+        size_t operator()(const BindingSetKey& key) const;
+        size_t operator()(const SamplerDesc& desc) const;
+    };
+
+    // One kind of objects in the ObjectCache. The map holds references to the objects, and collectGarbage
+    // drops the objects that are not referenced anywhere else. An object that is only referenced by the map can
+    // only be reached through the map, so it can't be resurrected while the lock is held, unlike an object
+    // that is removed from a weak map in its destructor.
+    template<typename Key, typename Handle>
+    class ObjectCacheTable
+    {
+    public:
+        // Returns the cached object or creates a new one. The object is created outside of the lock,
+        // so that slow pipeline compilations on different threads don't wait for each other; when two threads
+        // create the same object at once, both get the one that was added first.
+        template<typename Create>
+        Handle getOrCreate(const Key& key, Create&& create)
+        {
+            {
+                std::lock_guard lockGuard(m_Mutex);
+
+                auto it = m_Objects.find(key);
+                if (it != m_Objects.end())
+                {
+                    ++m_Hits;
+                    return it->second;
+                }
+
+                ++m_Misses;
+            }
+
+            Handle object = create();
+            if (!object)
+                return nullptr;
+
+            std::lock_guard lockGuard(m_Mutex);
+            auto result = m_Objects.try_emplace(key, object);
+            return result.first->second;
+        }
+
+        void collectGarbage()
+        {
+            std::vector<Handle> released;
+            {
+                std::lock_guard lockGuard(m_Mutex);
+
+                for (auto it = m_Objects.begin(); it != m_Objects.end(); )
+                {
+                    it->second->AddRef();
+                    if (it->second->Release() == 1)
+                    {
+                        released.push_back(std::move(it->second));
+                        it = m_Objects.erase(it);
+                    }
+                    else
+                        ++it;
+                }
+            }
+
+            // The objects are destroyed here, outside of the lock
+        }
+
+        void clear()
+        {
+            std::unordered_map<Key, Handle, ObjectCacheKeyHash> objects;
+            {
+                std::lock_guard lockGuard(m_Mutex);
+                objects.swap(m_Objects);
+            }
+        }
+
+        ObjectCacheStatistics::Counters getStatistics(bool reset)
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            ObjectCacheStatistics::Counters counters;
+            counters.hits = m_Hits;
+            counters.misses = m_Misses;
+            counters.numObjects = m_Objects.size();
+
+            if (reset)
+            {
+                m_Hits = 0;
+                m_Misses = 0;
+            }
+
+            return counters;
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::unordered_map<Key, Handle, ObjectCacheKeyHash> m_Objects;
+        uint64_t m_Hits = 0;
+        uint64_t m_Misses = 0;
+    };
+
+    // Device-level cache that returns existing objects for create calls with identical parameters,
+    // see IDevice::setObjectCacheEnabled. Each backend device owns one and routes the create calls through it.
+    class ObjectCache
+    {
+    public:
+        void setEnabled(bool enable);
+        [[nodiscard]] bool isEnabled() const { return m_Enabled.load(std::memory_order_relaxed); }
+
+        // The 'create' functions are called when the cache is disabled or doesn't have the object
+        template<typename Create>
+        GraphicsPipelineHandle getGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb, Create&& create)
+        {
+            if (!isEnabled() || !fb)
+                return create();
+
+            FramebufferPipelineKey<GraphicsPipelineDesc> key;
+            key.desc = desc;
+            key.framebufferInfo = fb->getFramebufferInfo();
+            key.hasShadingRateAttachment = fb->getDesc().shadingRateAttachment.valid();
+            return m_GraphicsPipelines.getOrCreate(key, create);
+        }
+
+        template<typename Create>
+        MeshletPipelineHandle getMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb, Create&& create)
+        {
+            if (!isEnabled() || !fb)
+                return create();
+
+            FramebufferPipelineKey<MeshletPipelineDesc> key;
+            key.desc = desc;
+            key.framebufferInfo = fb->getFramebufferInfo();
+            key.hasShadingRateAttachment = fb->getDesc().shadingRateAttachment.valid();
+            return m_MeshletPipelines.getOrCreate(key, create);
+        }
+
+        template<typename Create>
+        ComputePipelineHandle getComputePipeline(const ComputePipelineDesc& desc, Create&& create)
+        {
+            if (!isEnabled())
+                return create();
+
+            return m_ComputePipelines.getOrCreate(desc, create);
+        }
+
+        template<typename Create>
+        BindingSetHandle getBindingSet(const BindingSetDesc& desc, IBindingLayout* layout, Create&& create)
+        {
+            // Without liveness tracking, the set doesn't keep its resources alive. A resource could be destroyed
+            // and another one created at the same address, and the cache would return a set with stale descriptors.
+            if (!isEnabled() || !desc.trackLiveness)
+                return create();
+
+            BindingSetKey key;
+            key.desc = desc;
+            key.layout = layout;
+            return m_BindingSets.getOrCreate(key, create);
+        }
+
+        template<typename Create>
+        SamplerHandle getSampler(const SamplerDesc& desc, Create&& create)
+        {
+            if (!isEnabled())
+                return create();
+
+            return m_Samplers.getOrCreate(desc, create);
+        }
+
+        // Releases the objects that are only referenced by the cache, called from runGarbageCollection
+        void collectGarbage();
+
+        // Releases all objects, called when the cache is disabled and when the device is destroyed
+        void clear();
+
+        ObjectCacheStatistics getStatistics(bool reset);
+
+    private:
+        std::atomic<bool> m_Enabled = false;
+
+        ObjectCacheTable<FramebufferPipelineKey<GraphicsPipelineDesc>, GraphicsPipelineHandle> m_GraphicsPipelines;
+        ObjectCacheTable<FramebufferPipelineKey<MeshletPipelineDesc>, MeshletPipelineHandle> m_MeshletPipelines;
+        ObjectCacheTable<ComputePipelineDesc, ComputePipelineHandle> m_ComputePipelines;
+        ObjectCacheTable<BindingSetKey, BindingSetHandle> m_BindingSets;
+        ObjectCacheTable<SamplerDesc, SamplerHandle> m_Samplers;
+    };
+}
@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "pipeline-cache.h"
+#include <cstring>
+
+namespace nvrhi
+{
+    uint64_t hashPipelineCacheData(const void* data, size_t size, uint64_t seed)
+    {
+        return hash_bytes(data, size, seed);
+    }
+
+    void writePipelineCacheBlob(GraphicsAPI api, const uint8_t deviceUUID[16], const void* data, size_t dataSize, std::vector<uint8_t>& outBlob)
+    {
+        PipelineCacheBlobHeader header;
+        header.graphicsAPI = uint32_t(api);
+        if (deviceUUID)
+            memcpy(header.deviceUUID, deviceUUID, sizeof(header.deviceUUID));
+        header.dataSize = dataSize;
+        header.dataHash = hashPipelineCacheData(data, dataSize);
+
+        outBlob.resize(sizeof(header) + dataSize);
+        memcpy(outBlob.data(), &header, sizeof(header));
+        if (dataSize)
+            memcpy(outBlob.data() + sizeof(header), data, dataSize);
+    }
+
+    bool readPipelineCacheBlob(GraphicsAPI api, const uint8_t deviceUUID[16], const void* blob, size_t blobSize, const void** outData, size_t* outDataSize)
+    {
+        if (!blob || blobSize < sizeof(PipelineCacheBlobHeader))
+            return false;
+
+        PipelineCacheBlobHeader header;
+        memcpy(&header, blob, sizeof(header));
+
+        if (header.magic != PipelineCacheBlobHeader::c_Magic ||
+            header.version != PipelineCacheBlobHeader::c_Version ||
+            header.graphicsAPI != uint32_t(api) ||
+            header.headerVersion != c_HeaderVersion)
+            return false;
+
+        if (deviceUUID && memcmp(header.deviceUUID, deviceUUID, sizeof(header.deviceUUID)) != 0)
+            return false;
+
+        if (header.dataSize != blobSize - sizeof(header))
+            return false;
+
+        const uint8_t* data = static_cast<const uint8_t*>(blob) + sizeof(header);
+        if (header.dataHash != hashPipelineCacheData(data, size_t(header.dataSize)))
+            return false;
+
+        *outData = data;
+        *outDataSize = size_t(header.dataSize);
+        return true;
+    }
+}
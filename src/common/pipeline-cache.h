@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <vector>
+#include <cstdint>
+
+namespace nvrhi
+{
+    // Pipeline cache blobs exported by the backends start with this header. It lets importPipelineCache
+    // reject data that was produced by another backend, another device or driver, or that has been truncated or corrupted,
+    // before the data is handed to the graphics API.
+    struct PipelineCacheBlobHeader
+    {
+        static constexpr uint32_t c_Magic = 0x4350564E; // 'NVPC'
+        static constexpr uint32_t c_Version = 2;
+
+        uint32_t magic = c_Magic;
+        uint32_t version = c_Version;
+        uint32_t graphicsAPI = 0;
+        uint32_t headerVersion = c_HeaderVersion;
+        uint8_t deviceUUID[16] = {};
+        uint64_t dataSize = 0;
+        uint64_t dataHash = 0;
+    };
+
+    // 64-bit hash of a block of memory, used to validate cache data and to build stable pipeline keys.
+    // Changing the hash function requires a new PipelineCacheBlobHeader::c_Version.
+    uint64_t hashPipelineCacheData(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+    // Writes the header followed by the data into outBlob.
+    void writePipelineCacheBlob(GraphicsAPI api, const uint8_t deviceUUID[16], const void* data, size_t dataSize, std::vector<uint8_t>& outBlob);
+
+    // Validates the header and returns a pointer to the data following it, or false if the blob is not compatible.
+    bool readPipelineCacheBlob(GraphicsAPI api, const uint8_t deviceUUID[16], const void* blob, size_t blobSize, const void** outData, size_t* outDataSize);
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "push-bindings.h"
+
+#include <string>
+
+namespace nvrhi
+{
+    void PushBindings::set(uint32_t layoutIndex, const BindingSetDesc& desc)
+    {
+        for (Entry& entry : m_Entries)
+        {
+            if (entry.layoutIndex == layoutIndex)
+            {
+                entry.desc = desc;
+                return;
+            }
+        }
+
+        m_Entries.push_back(Entry{ layoutIndex, desc });
+    }
+
+    void PushBindings::clear()
+    {
+        m_Entries.clear();
+    }
+
+    const BindingSetDesc* PushBindings::get(uint32_t layoutIndex) const
+    {
+        for (const Entry& entry : m_Entries)
+        {
+            if (entry.layoutIndex == layoutIndex)
+                return &entry.desc;
+        }
+
+        return nullptr;
+    }
+
+    bool PushBindings::createBindingSets(IDevice* device, const BindingLayoutVector& layouts, BindingSetVector& bindings,
+        ResourceReferenceList* referencedResources)
+    {
+        bool success = true;
+
+        for (const Entry& entry : m_Entries)
+        {
+            if (entry.layoutIndex >= layouts.size())
+                continue;
+
+            BindingSetHandle bindingSet = device->createBindingSet(entry.desc, layouts[entry.layoutIndex]);
+            if (!bindingSet)
+            {
+                std::string message = "Failed to create a binding set for the push bindings of layout "
+                    + std::to_string(entry.layoutIndex) + ", the state is not set";
+                device->getMessageCallback()->message(MessageSeverity::Error, message.c_str());
+                success = false;
+                break;
+            }
+
+            while (bindings.size() <= entry.layoutIndex)
+                bindings.push_back(nullptr);
+
+            bindings[entry.layoutIndex] = bindingSet;
+
+            if (referencedResources)
+                referencedResources->push_back(bindingSet);
+        }
+
+        m_Entries.clear();
+        return success;
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,70 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include "resource-reference-list.h"
+#include <vector>
+
+namespace nvrhi
+{
+    // Stores the bindings recorded by ICommandList::setPushBindings until the next set*State call consumes them.
+    class PushBindings
+    {
+    public:
+        struct Entry
+        {
+            uint32_t layoutIndex = 0;
+            BindingSetDesc desc;
+        };
+
+        void set(uint32_t layoutIndex, const BindingSetDesc& desc);
+        void clear();
+
+        [[nodiscard]] bool empty() const { return m_Entries.empty(); }
+        [[nodiscard]] const std::vector<Entry>& getEntries() const { return m_Entries; }
+        [[nodiscard]] const BindingSetDesc* get(uint32_t layoutIndex) const;
+
+        // Total number of bindings in all entries
+        [[nodiscard]] size_t getNumBindings() const
+        {
+            size_t count = 0;
+            for (const Entry& entry : m_Entries)
+                count += entry.desc.bindings.size();
+            return count;
+        }
+
+        // Fallback for backends or devices without native push descriptors: creates regular binding sets
+        // from the pushed bindings and puts them into the corresponding slots of the bindings array.
+        // The sets are added to 'referencedResources' because they may be created with trackLiveness = false
+        // and are released by the caller right after binding. Pass NULL only when the native API keeps
+        // the bound descriptors alive, like D3D11. The pushed entries are consumed. Returns false and reports
+        // an error if a binding set could not be created, the state must not be set in that case.
+        bool createBindingSets(IDevice* device, const BindingLayoutVector& layouts, BindingSetVector& bindings,
+            ResourceReferenceList* referencedResources);
+
+    private:
+        std::vector<Entry> m_Entries;
+    };
+
+} // namespace nvrhi
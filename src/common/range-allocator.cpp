@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "range-allocator.h"
+#include <cassert>
+#include <iterator>
+
+namespace nvrhi
+{
+    void RangeAllocator::reset(uint64_t capacity)
+    {
+        m_FreeRangesByOffset.clear();
+        m_FreeRangesBySize.clear();
+        m_Capacity = capacity;
+        m_UsedSize = 0;
+
+        if (capacity > 0)
+            addFreeRange(0, capacity);
+    }
+
+    void RangeAllocator::grow(uint64_t newCapacity)
+    {
+        assert(newCapacity >= m_Capacity);
+
+        const uint64_t oldCapacity = m_Capacity;
+        m_Capacity = newCapacity;
+
+        if (newCapacity > oldCapacity)
+        {
+            // release() treats the new space like a freed allocation, so it merges with a trailing free range
+            m_UsedSize += newCapacity - oldCapacity;
+            release(oldCapacity, newCapacity - oldCapacity);
+        }
+    }
+
+    bool RangeAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+    {
+        assert(size > 0);
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+        // best fit: walk the free ranges starting from the smallest one that could hold the allocation
+        for (auto it = m_FreeRangesBySize.lower_bound(size); it != m_FreeRangesBySize.end(); ++it)
+        {
+            const uint64_t rangeSize = it->first;
+            const uint64_t rangeOffset = it->second;
+            const uint64_t alignedOffset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+
+            if (alignedOffset + size > rangeOffset + rangeSize)
+                continue;
+
+            removeFreeRange(m_FreeRangesByOffset.find(rangeOffset));
+
+            // return the alignment padding and the tail to the free list
+            if (alignedOffset > rangeOffset)
+                addFreeRange(rangeOffset, alignedOffset - rangeOffset);
+
+            const uint64_t tailOffset = alignedOffset + size;
+            if (tailOffset < rangeOffset + rangeSize)
+                addFreeRange(tailOffset, rangeOffset + rangeSize - tailOffset);
+
+            m_UsedSize += size;
+            outOffset = alignedOffset;
+            return true;
+        }
+
+        return false;
+    }
+
+    void RangeAllocator::release(uint64_t offset, uint64_t size)
+    {
+        assert(m_UsedSize >= size);
+        assert(offset + size <= m_Capacity);
+        m_UsedSize -= size;
+
+        // coalesce with the neighboring free ranges
+        auto next = m_FreeRangesByOffset.lower_bound(offset);
+        if (next != m_FreeRangesByOffset.end() && offset + size == next->first)
+        {
+            size += next->second;
+            next = removeFreeRange(next);
+        }
+
+        if (next != m_FreeRangesByOffset.begin())
+        {
+            auto prev = std::prev(next);
+            assert(prev->first + prev->second <= offset); // double release?
+
+            if (prev->first + prev->second == offset)
+            {
+                offset = prev->first;
+                size += prev->second;
+                removeFreeRange(prev);
+            }
+        }
+
+        addFreeRange(offset, size);
+    }
+
+    uint64_t RangeAllocator::getLargestFreeRange() const
+    {
+        if (m_FreeRangesBySize.empty())
+            return 0;
+
+        return m_FreeRangesBySize.rbegin()->first;
+    }
+
+    void RangeAllocator::addFreeRange(uint64_t offset, uint64_t size)
+    {
+        m_FreeRangesByOffset[offset] = size;
+        m_FreeRangesBySize.insert(std::make_pair(size, offset));
+    }
+
+    RangeAllocator::OffsetMap::iterator RangeAllocator::removeFreeRange(OffsetMap::iterator it)
+    {
+        auto range = m_FreeRangesBySize.equal_range(it->second);
+        for (auto sizeIt = range.first; sizeIt != range.second; ++sizeIt)
+        {
+            if (sizeIt->second == it->first)
+            {
+                m_FreeRangesBySize.erase(sizeIt);
+                break;
+            }
+        }
+
+        return m_FreeRangesByOffset.erase(it);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+namespace nvrhi
+{
+    // Manages free space in a linear address range, such as a memory heap or a descriptor heap.
+    // Free ranges are tracked in two maps - by offset, to coalesce neighbors on release,
+    // and by size, to find the best fitting range in logarithmic time.
+    // The allocator is not thread-safe; callers are expected to provide their own locking.
+    class RangeAllocator
+    {
+    public:
+        RangeAllocator() = default;
+        explicit RangeAllocator(uint64_t capacity) { reset(capacity); }
+
+        // Marks the whole range [0, capacity) as free, forgetting all previous allocations.
+        void reset(uint64_t capacity);
+
+        // Adds a new free range at the end, e.g. when the underlying heap has been grown.
+        void grow(uint64_t newCapacity);
+
+        // Finds the smallest free range that fits 'size' bytes at the specified alignment (must be a power of 2).
+        // Returns false if there is no such range.
+        [[nodiscard]] bool allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset);
+
+        // Returns a previously allocated range to the free list and merges it with its free neighbors.
+        void release(uint64_t offset, uint64_t size);
+
+        [[nodiscard]] uint64_t getCapacity() const { return m_Capacity; }
+        [[nodiscard]] uint64_t getUsedSize() const { return m_UsedSize; }
+        [[nodiscard]] uint64_t getFreeSize() const { return m_Capacity - m_UsedSize; }
+        [[nodiscard]] uint64_t getLargestFreeRange() const;
+        [[nodiscard]] size_t getNumFreeRanges() const { return m_FreeRangesByOffset.size(); }
+        [[nodiscard]] bool isEmpty() const { return m_UsedSize == 0; }
+
+    private:
+        typedef std::map<uint64_t, uint64_t> OffsetMap;
+
+        OffsetMap m_FreeRangesByOffset; // offset -> size
+        std::multimap<uint64_t, uint64_t> m_FreeRangesBySize; // size -> offset
+        uint64_t m_Capacity = 0;
+        uint64_t m_UsedSize = 0;
+
+        void addFreeRange(uint64_t offset, uint64_t size);
+        OffsetMap::iterator removeFreeRange(OffsetMap::iterator it);
+    };
+}
@@ -0,0 +1,519 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+#include <nvrhi/nvrhi.h>
+#include <nvrhi/common/misc.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace nvrhi
+{
+    // Offsets of the buffer readbacks within a chunk are aligned to this value, so that the results can be read as any type
+    static constexpr uint64_t c_ReadbackAlignment = 16;
+
+    class ReadbackRing : public RefCounter<IReadbackRing>
+    {
+    public:
+        ReadbackRing(IDevice* device, const ReadbackRingDesc& desc)
+            : m_Device(device)
+            , m_Desc(desc)
+        {
+            m_Desc.chunkSize = std::max(align(m_Desc.chunkSize, c_ReadbackAlignment), c_ReadbackAlignment);
+        }
+
+        ReadbackTicket readBuffer(ICommandList* commandList, IBuffer* buffer, uint64_t offset, uint64_t size, ReadbackCallback onComplete) override;
+        ReadbackTicket readTexture(ICommandList* commandList, ITexture* texture, const TextureSlice& slice, ReadbackCallback onComplete) override;
+        void update() override;
+        bool isComplete(ReadbackTicket ticket) override;
+        bool getResult(ReadbackTicket ticket, ReadbackResult& outResult) override;
+        void release(ReadbackTicket ticket) override;
+
+    private:
+        struct Chunk
+        {
+            BufferHandle buffer;
+            uint64_t used = 0;
+            bool dedicated = false;
+        };
+
+        struct Readback
+        {
+            ReadbackTicket ticket = 0;
+            ReadbackCallback onComplete;
+            bool discarded = false;
+
+            // Buffer readbacks reference a chunk of the group, texture readbacks a staging texture
+            Chunk* chunk = nullptr;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+
+            StagingTextureHandle stagingTexture;
+            uint32_t numRows = 0;
+            uint32_t depth = 0;
+        };
+
+        struct Group
+        {
+            EventQueryHandle query;
+            std::vector<std::unique_ptr<Chunk>> chunks;
+            std::vector<Readback> readbacks;
+            ReadbackTicket lastTicket = 0;
+        };
+
+        struct StoredResult
+        {
+            std::vector<uint8_t> data;
+            size_t rowPitch = 0;
+        };
+
+        DeviceHandle m_Device;
+        ReadbackRingDesc m_Desc;
+        std::mutex m_Mutex;
+
+        // Serializes update(): the groups retired by one call are processed outside of m_Mutex, and the tickets
+        // released meanwhile are only cleared after they have been matched against those groups.
+        std::mutex m_UpdateMutex;
+
+        std::unique_ptr<Group> m_CurrentGroup;
+        std::deque<std::unique_ptr<Group>> m_SubmittedGroups;
+        std::vector<std::unique_ptr<Group>> m_FreeGroups;
+
+        std::vector<std::unique_ptr<Chunk>> m_FreeChunks;
+        uint32_t m_NumChunks = 0;
+
+        std::vector<StagingTextureHandle> m_FreeStagingTextures;
+
+        // Results of the retired readbacks without a callback, kept until they are released
+        std::unordered_map<ReadbackTicket, StoredResult> m_Results;
+
+        // Tickets released while their group was being retired by update() outside of the lock
+        std::unordered_set<ReadbackTicket> m_ReleasedTickets;
+
+        ReadbackTicket m_NextTicket = 1;
+        ReadbackTicket m_LastCompletedTicket = 0;
+
+        Group* getCurrentGroup();
+        Chunk* allocateChunkSpace(Group& group, uint64_t size, uint64_t& outOffset);
+        StagingTextureHandle getStagingTexture(const TextureDesc& desc);
+        void processGroup(Group& group, std::vector<std::pair<ReadbackTicket, StoredResult>>& outResults);
+        void recycleGroup(std::unique_ptr<Group> group);
+    };
+
+    ReadbackRing::Group* ReadbackRing::getCurrentGroup()
+    {
+        if (m_CurrentGroup)
+            return m_CurrentGroup.get();
+
+        if (!m_FreeGroups.empty())
+        {
+            m_CurrentGroup = std::move(m_FreeGroups.back());
+            m_FreeGroups.pop_back();
+        }
+        else
+        {
+            auto group = std::make_unique<Group>();
+            group->query = m_Device->createEventQuery();
+
+            if (!group->query)
+                return nullptr;
+
+            m_CurrentGroup = std::move(group);
+        }
+
+        return m_CurrentGroup.get();
+    }
+
+    ReadbackRing::Chunk* ReadbackRing::allocateChunkSpace(Group& group, uint64_t size, uint64_t& outOffset)
+    {
+        std::unique_ptr<Chunk> chunk;
+
+        if (size > m_Desc.chunkSize)
+        {
+            chunk = std::make_unique<Chunk>();
+            chunk->dedicated = true;
+        }
+        else
+        {
+            // Only the most recent shared chunk of the group is open for allocations
+            for (auto it = group.chunks.rbegin(); it != group.chunks.rend(); ++it)
+            {
+                Chunk* current = it->get();
+                if (current->dedicated)
+                    continue;
+
+                const uint64_t offset = align(current->used, c_ReadbackAlignment);
+                if (offset + size <= m_Desc.chunkSize)
+                {
+                    current->used = offset + size;
+                    outOffset = offset;
+                    return current;
+                }
+                break;
+            }
+
+            if (!m_FreeChunks.empty())
+            {
+                chunk = std::move(m_FreeChunks.back());
+                m_FreeChunks.pop_back();
+            }
+            else if (m_NumChunks < m_Desc.maxChunks)
+            {
+                chunk = std::make_unique<Chunk>();
+                ++m_NumChunks;
+            }
+            else
+            {
+                // The ring is full: the readbacks in flight haven't retired yet
+                return nullptr;
+            }
+        }
+
+        if (!chunk->buffer)
+        {
+            chunk->buffer = m_Device->createBuffer(BufferDesc()
+                .setByteSize(chunk->dedicated ? size : m_Desc.chunkSize)
+                .setCpuAccess(CpuAccessMode::Read)
+                .setInitialState(ResourceStates::CopyDest)
+                .setKeepInitialState(true)
+                .setDebugName(chunk->dedicated ? "ReadbackRing/Dedicated" : "ReadbackRing/Chunk"));
+
+            if (!chunk->buffer)
+            {
+                if (!chunk->dedicated)
+                    --m_NumChunks;
+                return nullptr;
+            }
+        }
+
+        chunk->used = size;
+        outOffset = 0;
+        group.chunks.push_back(std::move(chunk));
+        return group.chunks.back().get();
+    }
+
+    StagingTextureHandle ReadbackRing::getStagingTexture(const TextureDesc& desc)
+    {
+        for (auto it = m_FreeStagingTextures.begin(); it != m_FreeStagingTextures.end(); ++it)
+        {
+            const TextureDesc& existing = (*it)->getDesc();
+            if (existing.format == desc.format && existing.dimension == desc.dimension &&
+                existing.width == desc.width && existing.height == desc.height && existing.depth == desc.depth)
+            {
+                StagingTextureHandle result = std::move(*it);
+                m_FreeStagingTextures.erase(it);
+                return result;
+            }
+        }
+
+        return m_Device->createStagingTexture(desc, CpuAccessMode::Read);
+    }
+
+    ReadbackTicket ReadbackRing::readBuffer(ICommandList* commandList, IBuffer* buffer, uint64_t offset, uint64_t size, ReadbackCallback onComplete)
+    {
+        if (!commandList || !buffer || size == 0 || offset + size > buffer->getDesc().byteSize)
+            return 0;
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        Group* group = getCurrentGroup();
+        if (!group)
+            return 0;
+
+        uint64_t chunkOffset = 0;
+        Chunk* chunk = allocateChunkSpace(*group, size, chunkOffset);
+        if (!chunk)
+            return 0;
+
+        commandList->copyBuffer(chunk->buffer, chunkOffset, buffer, offset, size);
+
+        Readback readback;
+        readback.ticket = m_NextTicket++;
+        readback.onComplete = std::move(onComplete);
+        readback.chunk = chunk;
+        readback.offset = chunkOffset;
+        readback.size = size;
+        group->readbacks.push_back(std::move(readback));
+        group->lastTicket = group->readbacks.back().ticket;
+
+        return group->lastTicket;
+    }
+
+    ReadbackTicket ReadbackRing::readTexture(ICommandList* commandList, ITexture* texture, const TextureSlice& slice, ReadbackCallback onComplete)
+    {
+        if (!commandList || !texture)
+            return 0;
+
+        const TextureDesc& textureDesc = texture->getDesc();
+        if (slice.mipLevel >= textureDesc.mipLevels || slice.arraySlice >= textureDesc.arraySize || textureDesc.sampleCount > 1)
+            return 0;
+
+        const TextureSlice resolvedSlice = slice.resolve(textureDesc);
+
+        TextureDesc stagingDesc;
+        stagingDesc.format = textureDesc.format;
+        stagingDesc.dimension = textureDesc.dimension == TextureDimension::Texture3D ? TextureDimension::Texture3D : TextureDimension::Texture2D;
+        stagingDesc.width = resolvedSlice.width;
+        stagingDesc.height = resolvedSlice.height;
+        stagingDesc.depth = resolvedSlice.depth;
+        stagingDesc.debugName = "ReadbackRing/Staging";
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        Group* group = getCurrentGroup();
+        if (!group)
+            return 0;
+
+        StagingTextureHandle stagingTexture = getStagingTexture(stagingDesc);
+        if (!stagingTexture)
+            return 0;
+
+        commandList->copyTexture(stagingTexture, TextureSlice(), texture, resolvedSlice);
+
+        const FormatInfo& formatInfo = getFormatInfo(textureDesc.format);
+        const uint32_t blockSize = std::max<uint32_t>(formatInfo.blockSize, 1);
+
+        Readback readback;
+        readback.ticket = m_NextTicket++;
+        readback.onComplete = std::move(onComplete);
+        readback.stagingTexture = std::move(stagingTexture);
+        readback.numRows = (resolvedSlice.height + blockSize - 1) / blockSize;
+        readback.depth = resolvedSlice.depth;
+        group->readbacks.push_back(std::move(readback));
+        group->lastTicket = group->readbacks.back().ticket;
+
+        return group->lastTicket;
+    }
+
+    void ReadbackRing::processGroup(Group& group, std::vector<std::pair<ReadbackTicket, StoredResult>>& outResults)
+    {
+        // The copies have finished, so mapping doesn't wait for the GPU.
+        std::unordered_map<Chunk*, const uint8_t*> mappedChunks;
+
+        for (Readback& readback : group.readbacks)
+        {
+            if (readback.discarded)
+                continue;
+
+            ReadbackResult result;
+            result.ticket = readback.ticket;
+
+            void* stagingData = nullptr;
+
+            if (readback.chunk)
+            {
+                auto mapped = mappedChunks.find(readback.chunk);
+                if (mapped == mappedChunks.end())
+                {
+                    const uint8_t* chunkData = static_cast<const uint8_t*>(m_Device->mapBuffer(readback.chunk->buffer, CpuAccessMode::Read));
+                    mapped = mappedChunks.emplace(readback.chunk, chunkData).first;
+                }
+
+                if (!mapped->second)
+                    continue;
+
+                result.data = mapped->second + readback.offset;
+                result.size = size_t(readback.size);
+                result.rowPitch = result.size;
+            }
+            else
+            {
+                size_t rowPitch = 0;
+                stagingData = m_Device->mapStagingTexture(readback.stagingTexture, TextureSlice(), CpuAccessMode::Read, &rowPitch);
+                if (!stagingData)
+                    continue;
+
+                result.data = stagingData;
+                result.rowPitch = rowPitch;
+                result.size = rowPitch * readback.numRows * readback.depth;
+            }
+
+            if (readback.onComplete)
+            {
+                readback.onComplete(result);
+            }
+            else
+            {
+                StoredResult stored;
+                stored.data.resize(result.size);
+                memcpy(stored.data.data(), result.data, result.size);
+                stored.rowPitch = result.rowPitch;
+                outResults.emplace_back(readback.ticket, std::move(stored));
+            }
+
+            if (stagingData)
+                m_Device->unmapStagingTexture(readback.stagingTexture);
+        }
+
+        for (const auto& mapped : mappedChunks)
+        {
+            if (mapped.second)
+                m_Device->unmapBuffer(mapped.first->buffer);
+        }
+    }
+
+    void ReadbackRing::recycleGroup(std::unique_ptr<Group> group)
+    {
+        for (std::unique_ptr<Chunk>& chunk : group->chunks)
+        {
+            // Dedicated buffers are released here, they're unlikely to fit the next large readback exactly
+            if (!chunk->dedicated)
+            {
+                chunk->used = 0;
+                m_FreeChunks.push_back(std::move(chunk));
+            }
+        }
+        group->chunks.clear();
+
+        for (Readback& readback : group->readbacks)
+        {
+            if (readback.stagingTexture)
+                m_FreeStagingTextures.push_back(std::move(readback.stagingTexture));
+        }
+        group->readbacks.clear();
+
+        m_FreeGroups.push_back(std::move(group));
+    }
+
+    void ReadbackRing::update()
+    {
+        std::lock_guard updateLockGuard(m_UpdateMutex);
+
+        std::vector<std::unique_ptr<Group>> completedGroups;
+
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            if (m_CurrentGroup && !m_CurrentGroup->readbacks.empty())
+            {
+                m_Device->resetEventQuery(m_CurrentGroup->query);
+                m_Device->setEventQuery(m_CurrentGroup->query, m_Desc.queue);
+                m_SubmittedGroups.push_back(std::move(m_CurrentGroup));
+            }
+
+            // Groups are closed on the same queue in order, so they complete in that order too.
+            while (!m_SubmittedGroups.empty() && m_Device->pollEventQuery(m_SubmittedGroups.front()->query))
+            {
+                completedGroups.push_back(std::move(m_SubmittedGroups.front()));
+                m_SubmittedGroups.pop_front();
+            }
+        }
+
+        if (completedGroups.empty())
+            return;
+
+        // The retired groups aren't referenced by the ring anymore, so the callbacks are called outside of the lock
+        // and can record more readbacks.
+        std::vector<std::pair<ReadbackTicket, StoredResult>> results;
+        for (const auto& group : completedGroups)
+            processGroup(*group, results);
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        for (auto& result : results)
+        {
+            if (m_ReleasedTickets.erase(result.first) == 0)
+                m_Results[result.first] = std::move(result.second);
+        }
+        m_ReleasedTickets.clear();
+
+        for (auto& group : completedGroups)
+        {
+            m_LastCompletedTicket = std::max(m_LastCompletedTicket, group->lastTicket);
+            recycleGroup(std::move(group));
+        }
+    }
+
+    bool ReadbackRing::isComplete(ReadbackTicket ticket)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        return ticket != 0 && ticket <= m_LastCompletedTicket;
+    }
+
+    bool ReadbackRing::getResult(ReadbackTicket ticket, ReadbackResult& outResult)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        auto it = m_Results.find(ticket);
+        if (it == m_Results.end())
+            return false;
+
+        outResult.ticket = ticket;
+        outResult.data = it->second.data.data();
+        outResult.size = it->second.data.size();
+        outResult.rowPitch = it->second.rowPitch;
+        return true;
+    }
+
+    void ReadbackRing::release(ReadbackTicket ticket)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (m_Results.erase(ticket) != 0)
+            return;
+
+        auto discard = [ticket](Group& group)
+        {
+            for (Readback& readback : group.readbacks)
+            {
+                if (readback.ticket == ticket)
+                {
+                    readback.discarded = true;
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if (m_CurrentGroup && discard(*m_CurrentGroup))
+            return;
+
+        for (const auto& group : m_SubmittedGroups)
+        {
+            if (group->lastTicket >= ticket && discard(*group))
+                return;
+        }
+
+        if (ticket > m_LastCompletedTicket && ticket < m_NextTicket)
+            m_ReleasedTickets.insert(ticket);
+    }
+
+    ReadbackRingHandle IDevice::createReadbackRing(const ReadbackRingDesc& desc)
+    {
+        if (desc.queue == CommandQueue::Copy && !queryFeatureSupport(Feature::CopyQueue))
+            return nullptr;
+
+        if (desc.queue == CommandQueue::Compute && !queryFeatureSupport(Feature::ComputeQueue))
+            return nullptr;
+
+        return ReadbackRingHandle::Create(new ReadbackRing(this, desc));
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace nvrhi
+{
+    // A FIFO for objects that are submitted in order and retired in the same order, such as command buffers
+    // in flight. Unlike std::list or std::deque, it keeps its storage: pop_front advances the head, and the
+    // consumed prefix is dropped once it's at least half of the vector, which moves no more elements than
+    // were popped. Once the vector has grown to the peak number of objects in flight, it doesn't allocate.
+    // The queue is not thread-safe.
+    template<typename T>
+    class RecyclingQueue
+    {
+    public:
+        typedef typename std::vector<T>::iterator iterator;
+        typedef typename std::vector<T>::const_iterator const_iterator;
+
+        void push_back(T value) { m_Items.push_back(std::move(value)); }
+
+        T pop_front()
+        {
+            T value = std::move(m_Items[m_Head]);
+            ++m_Head;
+
+            if (m_Head == m_Items.size())
+            {
+                m_Items.clear();
+                m_Head = 0;
+            }
+            else if (m_Head * 2 >= m_Items.size())
+            {
+                m_Items.erase(m_Items.begin(), m_Items.begin() + ptrdiff_t(m_Head));
+                m_Head = 0;
+            }
+
+            return value;
+        }
+
+        [[nodiscard]] T& front() { return m_Items[m_Head]; }
+        [[nodiscard]] const T& front() const { return m_Items[m_Head]; }
+        [[nodiscard]] bool empty() const { return m_Head == m_Items.size(); }
+        [[nodiscard]] size_t size() const { return m_Items.size() - m_Head; }
+
+        [[nodiscard]] iterator begin() { return m_Items.begin() + ptrdiff_t(m_Head); }
+        [[nodiscard]] iterator end() { return m_Items.end(); }
+        [[nodiscard]] const_iterator begin() const { return m_Items.begin() + ptrdiff_t(m_Head); }
+        [[nodiscard]] const_iterator end() const { return m_Items.end(); }
+
+    private:
+        std::vector<T> m_Items;
+        size_t m_Head = 0;
+    };
+}
@@ -0,0 +1,1096 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <nvrhi/render-graph.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace nvrhi::utils
+{
+    static bool isCompatibleTextureDesc(const TextureDesc& a, const TextureDesc& b)
+    {
+        return a.width == b.width
+            && a.height == b.height
+            && a.depth == b.depth
+            && a.arraySize == b.arraySize
+            && a.mipLevels == b.mipLevels
+            && a.sampleCount == b.sampleCount
+            && a.sampleQuality == b.sampleQuality
+            && a.format == b.format
+            && a.dimension == b.dimension
+            && a.isShaderResource == b.isShaderResource
+            && a.isRenderTarget == b.isRenderTarget
+            && a.isUAV == b.isUAV
+            && a.isTypeless == b.isTypeless
+            && a.clearValue == b.clearValue
+            && a.useClearValue == b.useClearValue
+            && a.initialState == b.initialState;
+    }
+
+    static bool isCompatibleBufferDesc(const BufferDesc& a, const BufferDesc& b)
+    {
+        return a.byteSize == b.byteSize
+            && a.structStride == b.structStride
+            && a.format == b.format
+            && a.canHaveUAVs == b.canHaveUAVs
+            && a.canHaveTypedViews == b.canHaveTypedViews
+            && a.canHaveRawViews == b.canHaveRawViews
+            && a.isVertexBuffer == b.isVertexBuffer
+            && a.isIndexBuffer == b.isIndexBuffer
+            && a.isConstantBuffer == b.isConstantBuffer
+            && a.isDrawIndirectArgs == b.isDrawIndirectArgs
+            && a.initialState == b.initialState;
+    }
+
+    class RenderGraph : public RefCounter<IRenderGraph>
+    {
+    public:
+        RenderGraph(IDevice* device, const RenderGraphDesc& desc);
+
+        void reset() override;
+        RenderGraphResource createTexture(const TextureDesc& desc) override;
+        RenderGraphResource createBuffer(const BufferDesc& desc) override;
+        RenderGraphResource importTexture(ITexture* texture, ResourceStates currentState, ResourceStates finalState) override;
+        RenderGraphResource importBuffer(IBuffer* buffer, ResourceStates currentState, ResourceStates finalState) override;
+        RenderGraphPass addPass(const RenderGraphPassDesc& desc, RenderGraphPassCallback callback) override;
+        void readTexture(RenderGraphPass pass, RenderGraphResource texture, ResourceStates state, TextureSubresourceSet subresources) override;
+        void writeTexture(RenderGraphPass pass, RenderGraphResource texture, ResourceStates state, TextureSubresourceSet subresources) override;
+        void readBuffer(RenderGraphPass pass, RenderGraphResource buffer, ResourceStates state) override;
+        void writeBuffer(RenderGraphPass pass, RenderGraphResource buffer, ResourceStates state) override;
+        bool compile() override;
+        bool execute() override;
+        ITexture* getTexture(RenderGraphResource texture) override;
+        IBuffer* getBuffer(RenderGraphResource buffer) override;
+        RenderGraphStatistics getStatistics() override { return m_Statistics; }
+
+    private:
+        struct Resource
+        {
+            bool isTexture = false;
+            bool imported = false;
+            TextureDesc textureDesc;
+            BufferDesc bufferDesc;
+            TextureHandle texture;
+            BufferHandle buffer;
+            ResourceStates importState = ResourceStates::Unknown;
+            ResourceStates finalState = ResourceStates::Unknown;
+
+            // Results of compile()
+            bool used = false;
+            bool usedOnAsyncCompute = false;
+            uint32_t firstUse = 0;
+            uint32_t lastUse = 0;
+            ResourceStates firstState = ResourceStates::Unknown;
+
+            // Imported resources without keepInitialState have their states carried between command lists by the graph
+            [[nodiscard]] bool needsStateTracking() const
+            {
+                return imported && !(isTexture ? textureDesc.keepInitialState : bufferDesc.keepInitialState);
+            }
+        };
+
+        struct Access
+        {
+            RenderGraphResource resource = c_InvalidRenderGraphResource;
+            ResourceStates state = ResourceStates::Unknown;
+            TextureSubresourceSet subresources = AllSubresources;
+            bool write = false;
+        };
+
+        struct Transition
+        {
+            RenderGraphResource resource = c_InvalidRenderGraphResource;
+            TextureSubresourceSet subresources = AllSubresources;
+            ResourceStates state = ResourceStates::Unknown;
+        };
+
+        struct Pass
+        {
+            RenderGraphPassDesc desc;
+            RenderGraphPassCallback callback;
+            std::vector<Access> accesses;
+
+            // Results of compile()
+            std::vector<RenderGraphPass> producers;
+            std::vector<RenderGraphPass> dependencies;
+            bool needed = false;
+            CommandQueue queue = CommandQueue::Graphics;
+            uint32_t use = 0;
+            uint32_t chunk = 0;
+            std::vector<Transition> splitTransitions;
+        };
+
+        // A range of scheduled passes recorded into one command list
+        struct Chunk
+        {
+            CommandQueue queue = CommandQueue::Graphics;
+            uint32_t firstUse = 0;
+            uint32_t numPasses = 0;
+            std::vector<Transition> initialStates;
+            ICommandList* commandList = nullptr;
+        };
+
+        // Consecutive chunks on the same queue, submitted together
+        struct Batch
+        {
+            CommandQueue queue = CommandQueue::Graphics;
+            uint32_t firstChunk = 0;
+            uint32_t numChunks = 0;
+            int waitBatch = -1;
+            uint64_t instance = 0;
+        };
+
+        struct FallbackResource
+        {
+            TextureHandle texture;
+            BufferHandle buffer;
+            uint64_t lastUsedFrame = 0;
+            bool usedThisFrame = false;
+        };
+
+        DeviceHandle m_Device;
+        RenderGraphDesc m_Desc;
+        TransientResourcePoolHandle m_TransientPool;
+        bool m_AsyncComputeSupported = false;
+        bool m_ParallelRecordingSupported = false;
+
+        std::vector<Resource> m_Resources;
+        std::vector<Pass> m_Passes;
+        std::vector<RenderGraphPass> m_Schedule;
+        std::vector<Chunk> m_Chunks;
+        std::vector<Batch> m_Batches;
+        std::vector<Transition> m_EpilogueInitialStates;
+        std::vector<Transition> m_FinalTransitions;
+        std::vector<CommandListHandle> m_CommandLists[size_t(CommandQueue::Count)];
+        std::vector<FallbackResource> m_FallbackResources;
+        bool m_Compiled = false;
+        uint64_t m_FrameIndex = 0;
+        uint64_t m_LastGraphicsInstance = 0;
+        RenderGraphStatistics m_Statistics;
+
+        void error(const std::string& message) const;
+        void access(RenderGraphPass pass, RenderGraphResource resource, bool isTexture, ResourceStates state, TextureSubresourceSet subresources, bool write);
+        void findDependencies();
+        void cullPasses();
+        bool allocateTransientResources();
+        bool allocateFallbackResource(Resource& resource);
+        void buildChunks();
+        void planTransitions();
+        ICommandList* getCommandList(CommandQueue queue, uint32_t index);
+        void applyTransitions(ICommandList* commandList, const std::vector<Transition>& transitions) const;
+        void recordChunk(const Chunk& chunk);
+        void recordChunks();
+    };
+
+    RenderGraph::RenderGraph(IDevice* device, const RenderGraphDesc& desc)
+        : m_Device(device)
+        , m_Desc(desc)
+    {
+        if (device->queryFeatureSupport(Feature::VirtualResources))
+            m_TransientPool = device->createTransientResourcePool(desc.transientPool);
+
+        m_AsyncComputeSupported = desc.enableAsyncCompute && device->queryFeatureSupport(Feature::ComputeQueue);
+
+        // D3D11 records all command lists into the immediate context, one at a time
+        m_ParallelRecordingSupported = desc.enableParallelRecording && device->getGraphicsAPI() != GraphicsAPI::D3D11;
+    }
+
+    void RenderGraph::error(const std::string& message) const
+    {
+        m_Device->getMessageCallback()->message(MessageSeverity::Error, message.c_str());
+    }
+
+    void RenderGraph::reset()
+    {
+        m_Resources.clear();
+        m_Passes.clear();
+        m_Schedule.clear();
+        m_Chunks.clear();
+        m_Batches.clear();
+        m_EpilogueInitialStates.clear();
+        m_FinalTransitions.clear();
+        m_Compiled = false;
+        m_Statistics = RenderGraphStatistics();
+    }
+
+    RenderGraphResource RenderGraph::createTexture(const TextureDesc& desc)
+    {
+        Resource resource;
+        resource.isTexture = true;
+        resource.textureDesc = desc;
+        m_Resources.push_back(std::move(resource));
+        m_Compiled = false;
+        return RenderGraphResource(m_Resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::createBuffer(const BufferDesc& desc)
+    {
+        Resource resource;
+        resource.bufferDesc = desc;
+        m_Resources.push_back(std::move(resource));
+        m_Compiled = false;
+        return RenderGraphResource(m_Resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::importTexture(ITexture* texture, ResourceStates currentState, ResourceStates finalState)
+    {
+        if (!texture)
+        {
+            error("importTexture: texture is NULL");
+            return c_InvalidRenderGraphResource;
+        }
+
+        Resource resource;
+        resource.isTexture = true;
+        resource.imported = true;
+        resource.textureDesc = texture->getDesc();
+        resource.texture = texture;
+        resource.importState = currentState;
+        resource.finalState = finalState;
+        m_Resources.push_back(std::move(resource));
+        m_Compiled = false;
+        return RenderGraphResource(m_Resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::importBuffer(IBuffer* buffer, ResourceStates currentState, ResourceStates finalState)
+    {
+        if (!buffer)
+        {
+            error("importBuffer: buffer is NULL");
+            return c_InvalidRenderGraphResource;
+        }
+
+        Resource resource;
+        resource.imported = true;
+        resource.bufferDesc = buffer->getDesc();
+        resource.buffer = buffer;
+        resource.importState = currentState;
+        resource.finalState = finalState;
+        m_Resources.push_back(std::move(resource));
+        m_Compiled = false;
+        return RenderGraphResource(m_Resources.size() - 1);
+    }
+
+    RenderGraphPass RenderGraph::addPass(const RenderGraphPassDesc& desc, RenderGraphPassCallback callback)
+    {
+        Pass pass;
+        pass.desc = desc;
+        pass.callback = std::move(callback);
+        m_Passes.push_back(std::move(pass));
+        m_Compiled = false;
+        return RenderGraphPass(m_Passes.size() - 1);
+    }
+
+    void RenderGraph::access(RenderGraphPass pass, RenderGraphResource resource, bool isTexture, ResourceStates state,
+        TextureSubresourceSet subresources, bool write)
+    {
+        if (pass >= m_Passes.size())
+        {
+            error("Invalid render graph pass handle");
+            return;
+        }
+
+        if (resource >= m_Resources.size() || m_Resources[resource].isTexture != isTexture)
+        {
+            std::stringstream ss;
+            ss << "Pass " << m_Passes[pass].desc.name << " uses an invalid render graph " << (isTexture ? "texture" : "buffer") << " handle";
+            error(ss.str());
+            return;
+        }
+
+        if (state == ResourceStates::Unknown)
+        {
+            std::stringstream ss;
+            ss << "Pass " << m_Passes[pass].desc.name << " uses a resource in the Unknown state";
+            error(ss.str());
+            return;
+        }
+
+        Access item;
+        item.resource = resource;
+        item.state = state;
+        item.subresources = isTexture ? subresources.resolve(m_Resources[resource].textureDesc, false) : AllSubresources;
+        item.write = write;
+        m_Passes[pass].accesses.push_back(item);
+        m_Compiled = false;
+    }
+
+    void RenderGraph::readTexture(RenderGraphPass pass, RenderGraphResource texture, ResourceStates state, TextureSubresourceSet subresources)
+    {
+        access(pass, texture, true, state, subresources, false);
+    }
+
+    void RenderGraph::writeTexture(RenderGraphPass pass, RenderGraphResource texture, ResourceStates state, TextureSubresourceSet subresources)
+    {
+        access(pass, texture, true, state, subresources, true);
+    }
+
+    void RenderGraph::readBuffer(RenderGraphPass pass, RenderGraphResource buffer, ResourceStates state)
+    {
+        access(pass, buffer, false, state, AllSubresources, false);
+    }
+
+    void RenderGraph::writeBuffer(RenderGraphPass pass, RenderGraphResource buffer, ResourceStates state)
+    {
+        access(pass, buffer, false, state, AllSubresources, true);
+    }
+
+    void RenderGraph::findDependencies()
+    {
+        struct ResourceUsers
+        {
+            int lastWriter = -1;
+            std::vector<RenderGraphPass> readers;
+        };
+
+        std::vector<ResourceUsers> users(m_Resources.size());
+
+        for (RenderGraphPass passIndex = 0; passIndex < RenderGraphPass(m_Passes.size()); ++passIndex)
+        {
+            Pass& pass = m_Passes[passIndex];
+            pass.producers.clear();
+            pass.dependencies.clear();
+
+            // A write follows the previous writer and all readers since then, and is assumed to keep the previous contents
+            for (const Access& access : pass.accesses)
+            {
+                ResourceUsers& resourceUsers = users[access.resource];
+
+                if (resourceUsers.lastWriter >= 0 && RenderGraphPass(resourceUsers.lastWriter) != passIndex)
+                {
+                    pass.producers.push_back(RenderGraphPass(resourceUsers.lastWriter));
+                    pass.dependencies.push_back(RenderGraphPass(resourceUsers.lastWriter));
+                }
+
+                if (access.write)
+                {
+                    for (RenderGraphPass reader : resourceUsers.readers)
+                    {
+                        if (reader != passIndex)
+                            pass.dependencies.push_back(reader);
+                    }
+                }
+            }
+
+            for (const Access& access : pass.accesses)
+            {
+                ResourceUsers& resourceUsers = users[access.resource];
+
+                if (access.write)
+                {
+                    resourceUsers.lastWriter = int(passIndex);
+                    resourceUsers.readers.clear();
+                }
+                else
+                    resourceUsers.readers.push_back(passIndex);
+            }
+
+            std::sort(pass.producers.begin(), pass.producers.end());
+            pass.producers.erase(std::unique(pass.producers.begin(), pass.producers.end()), pass.producers.end());
+            std::sort(pass.dependencies.begin(), pass.dependencies.end());
+            pass.dependencies.erase(std::unique(pass.dependencies.begin(), pass.dependencies.end()), pass.dependencies.end());
+        }
+    }
+
+    void RenderGraph::cullPasses()
+    {
+        for (Pass& pass : m_Passes)
+        {
+            pass.needed = !m_Desc.enablePassCulling || pass.desc.hasSideEffects;
+
+            for (const Access& access : pass.accesses)
+            {
+                if (access.write && m_Resources[access.resource].imported)
+                    pass.needed = true;
+            }
+        }
+
+        // Producers are always declared before their consumers, so one reverse sweep reaches all of them
+        for (size_t passIndex = m_Passes.size(); passIndex-- > 0; )
+        {
+            if (!m_Passes[passIndex].needed)
+                continue;
+
+            for (RenderGraphPass producer : m_Passes[passIndex].producers)
+                m_Passes[producer].needed = true;
+        }
+    }
+
+    bool RenderGraph::allocateFallbackResource(Resource& resource)
+    {
+        for (FallbackResource& fallback : m_FallbackResources)
+        {
+            if (fallback.usedThisFrame)
+                continue;
+
+            if (resource.isTexture ? (fallback.texture && isCompatibleTextureDesc(fallback.texture->getDesc(), resource.textureDesc))
+                                   : (fallback.buffer && isCompatibleBufferDesc(fallback.buffer->getDesc(), resource.bufferDesc)))
+            {
+                fallback.usedThisFrame = true;
+                fallback.lastUsedFrame = m_FrameIndex;
+                resource.texture = fallback.texture;
+                resource.buffer = fallback.buffer;
+                return true;
+            }
+        }
+
+        FallbackResource fallback;
+        if (resource.isTexture)
+            fallback.texture = m_Device->createTexture(resource.textureDesc);
+        else
+            fallback.buffer = m_Device->createBuffer(resource.bufferDesc);
+
+        if (!fallback.texture && !fallback.buffer)
+            return false;
+
+        fallback.usedThisFrame = true;
+        fallback.lastUsedFrame = m_FrameIndex;
+        resource.texture = fallback.texture;
+        resource.buffer = fallback.buffer;
+        m_FallbackResources.push_back(std::move(fallback));
+        return true;
+    }
+
+    bool RenderGraph::allocateTransientResources()
+    {
+        const uint32_t numUses = uint32_t(m_Schedule.size());
+
+        for (Resource& resource : m_Resources)
+        {
+            resource.used = false;
+            resource.usedOnAsyncCompute = false;
+
+            if (!resource.imported)
+            {
+                resource.texture = nullptr;
+                resource.buffer = nullptr;
+            }
+        }
+
+        for (uint32_t use = 0; use < numUses; ++use)
+        {
+            const Pass& pass = m_Passes[m_Schedule[use]];
+
+            for (const Access& access : pass.accesses)
+            {
+                Resource& resource = m_Resources[access.resource];
+
+                if (!resource.used)
+                {
+                    resource.used = true;
+                    resource.firstUse = use;
+                    resource.firstState = access.state;
+                }
+
+                resource.lastUse = use;
+                if (pass.queue == CommandQueue::Compute)
+                    resource.usedOnAsyncCompute = true;
+            }
+        }
+
+        if (m_TransientPool)
+            m_TransientPool->beginFrame();
+
+        for (FallbackResource& fallback : m_FallbackResources)
+            fallback.usedThisFrame = false;
+
+        std::vector<TransientResourceId> transientIds(m_Resources.size(), c_InvalidTransientResource);
+
+        for (size_t resourceIndex = 0; resourceIndex < m_Resources.size(); ++resourceIndex)
+        {
+            Resource& resource = m_Resources[resourceIndex];
+            if (resource.imported || !resource.used)
+                continue;
+
+            // Transient resources start every command list in the state of their first use. Resources used on
+            // the compute queue start in Common instead, which is valid on all queues, and are excluded from aliasing
+            // because the pool can only order the reuse of memory on one queue.
+            const ResourceStates initialState = resource.usedOnAsyncCompute ? ResourceStates::Common : resource.firstState;
+            const uint32_t firstUse = resource.usedOnAsyncCompute ? 0 : resource.firstUse;
+            const uint32_t lastUse = resource.usedOnAsyncCompute ? numUses - 1 : resource.lastUse;
+
+            if (resource.isTexture)
+            {
+                resource.textureDesc.initialState = initialState;
+                resource.textureDesc.keepInitialState = true;
+            }
+            else
+            {
+                resource.bufferDesc.initialState = initialState;
+                resource.bufferDesc.keepInitialState = true;
+            }
+
+            if (m_TransientPool)
+            {
+                transientIds[resourceIndex] = resource.isTexture
+                    ? m_TransientPool->declareTexture(resource.textureDesc, firstUse, lastUse)
+                    : m_TransientPool->declareBuffer(resource.bufferDesc, firstUse, lastUse);
+            }
+            else if (!allocateFallbackResource(resource))
+            {
+                error("Failed to create a render graph transient resource");
+                return false;
+            }
+
+            ++m_Statistics.numTransientResources;
+        }
+
+        if (m_TransientPool)
+        {
+            if (!m_TransientPool->allocate())
+            {
+                error("Failed to allocate the render graph transient resources");
+                return false;
+            }
+
+            for (size_t resourceIndex = 0; resourceIndex < m_Resources.size(); ++resourceIndex)
+            {
+                const TransientResourceId id = transientIds[resourceIndex];
+                if (id == c_InvalidTransientResource)
+                    continue;
+
+                Resource& resource = m_Resources[resourceIndex];
+                if (resource.isTexture)
+                    resource.texture = m_TransientPool->getTexture(id);
+                else
+                    resource.buffer = m_TransientPool->getBuffer(id);
+            }
+        }
+        else
+        {
+            const uint32_t maxUnusedFrames = m_Desc.transientPool.maxUnusedFrames;
+            m_FallbackResources.erase(std::remove_if(m_FallbackResources.begin(), m_FallbackResources.end(),
+                [this, maxUnusedFrames](const FallbackResource& fallback)
+                {
+                    return fallback.lastUsedFrame + maxUnusedFrames < m_FrameIndex;
+                }), m_FallbackResources.end());
+        }
+
+        return true;
+    }
+
+    void RenderGraph::buildChunks()
+    {
+        const uint32_t numUses = uint32_t(m_Schedule.size());
+        uint32_t batchStart = 0;
+
+        while (batchStart < numUses)
+        {
+            const CommandQueue queue = m_Passes[m_Schedule[batchStart]].queue;
+
+            uint32_t batchEnd = batchStart + 1;
+            while (batchEnd < numUses && m_Passes[m_Schedule[batchEnd]].queue == queue)
+                ++batchEnd;
+
+            const uint32_t numPasses = batchEnd - batchStart;
+            uint32_t numChunks = 1;
+            if (m_ParallelRecordingSupported)
+            {
+                numChunks = numPasses / std::max(m_Desc.minPassesPerCommandList, 1u);
+                numChunks = std::clamp(numChunks, 1u, std::max(m_Desc.maxCommandListsPerBatch, 1u));
+            }
+
+            Batch batch;
+            batch.queue = queue;
+            batch.firstChunk = uint32_t(m_Chunks.size());
+            batch.numChunks = numChunks;
+
+            for (uint32_t chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+            {
+                Chunk chunk;
+                chunk.queue = queue;
+                chunk.firstUse = batchStart + numPasses * chunkIndex / numChunks;
+                chunk.numPasses = batchStart + numPasses * (chunkIndex + 1) / numChunks - chunk.firstUse;
+
+                for (uint32_t use = chunk.firstUse; use < chunk.firstUse + chunk.numPasses; ++use)
+                    m_Passes[m_Schedule[use]].chunk = uint32_t(m_Chunks.size());
+
+                m_Chunks.push_back(std::move(chunk));
+            }
+
+            // The batch waits for the latest batch on another queue that it depends on, earlier ones are implied
+            const uint32_t batchIndex = uint32_t(m_Batches.size());
+            for (uint32_t use = batchStart; use < batchEnd; ++use)
+            {
+                for (RenderGraphPass dependency : m_Passes[m_Schedule[use]].dependencies)
+                {
+                    const Pass& dependencyPass = m_Passes[dependency];
+                    if (!dependencyPass.needed || dependencyPass.queue == queue)
+                        continue;
+
+                    for (int otherBatch = int(batchIndex) - 1; otherBatch > batch.waitBatch; --otherBatch)
+                    {
+                        const Batch& other = m_Batches[otherBatch];
+                        if (dependencyPass.chunk >= other.firstChunk && dependencyPass.chunk < other.firstChunk + other.numChunks)
+                        {
+                            batch.waitBatch = otherBatch;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            m_Batches.push_back(batch);
+            batchStart = batchEnd;
+        }
+
+        m_Statistics.numCommandLists = uint32_t(m_Chunks.size());
+    }
+
+    void RenderGraph::planTransitions()
+    {
+        // Split barriers: when the next use of a resource is later in the same command list and in a different state,
+        // begin the transition right after the current use. Only single accesses per pass are split, so that the
+        // transition covers exactly the subresources that the next pass requires.
+        if (m_Desc.enableSplitBarriers)
+        {
+            struct LastUse
+            {
+                uint32_t use = ~0u;
+                uint32_t numAccesses = 0;
+                Access access;
+            };
+
+            std::vector<LastUse> lastUses(m_Resources.size());
+
+            for (uint32_t use = 0; use < uint32_t(m_Schedule.size()); ++use)
+            {
+                Pass& pass = m_Passes[m_Schedule[use]];
+
+                for (const Access& access : pass.accesses)
+                {
+                    LastUse& lastUse = lastUses[access.resource];
+                    if (lastUse.use == use)
+                    {
+                        ++lastUse.numAccesses;
+                        continue;
+                    }
+
+                    if (lastUse.use != ~0u && lastUse.numAccesses == 1 && use > lastUse.use + 1)
+                    {
+                        Pass& previousPass = m_Passes[m_Schedule[lastUse.use]];
+
+                        const bool singleAccess = std::count_if(pass.accesses.begin(), pass.accesses.end(),
+                            [&access](const Access& other) { return other.resource == access.resource; }) == 1;
+
+                        if (singleAccess && previousPass.chunk == pass.chunk && lastUse.access.state != access.state)
+                        {
+                            Transition transition;
+                            transition.resource = access.resource;
+                            transition.subresources = access.subresources;
+                            transition.state = access.state;
+                            previousPass.splitTransitions.push_back(transition);
+                            ++m_Statistics.numSplitBarriers;
+                        }
+                    }
+
+                    lastUse.use = use;
+                    lastUse.numAccesses = 1;
+                    lastUse.access = access;
+                }
+            }
+        }
+
+        // Imported resources without keepInitialState start every command list in the state that the previous
+        // command list left them in. Keep the sequence of transitions since the last one that covered the whole
+        // resource and replay it with beginTracking[...]State at the start of each command list that uses the resource.
+        std::vector<std::vector<Transition>> history(m_Resources.size());
+
+        for (size_t resourceIndex = 0; resourceIndex < m_Resources.size(); ++resourceIndex)
+        {
+            const Resource& resource = m_Resources[resourceIndex];
+            if (!resource.needsStateTracking())
+                continue;
+
+            Transition transition;
+            transition.resource = RenderGraphResource(resourceIndex);
+            transition.state = resource.importState;
+            history[resourceIndex].push_back(transition);
+        }
+
+        auto recordTransition = [this, &history](RenderGraphResource resourceIndex, TextureSubresourceSet subresources, ResourceStates state)
+        {
+            const Resource& resource = m_Resources[resourceIndex];
+            std::vector<Transition>& resourceHistory = history[resourceIndex];
+
+            if (!resource.isTexture || subresources.isEntireTexture(resource.textureDesc))
+                resourceHistory.clear();
+
+            Transition transition;
+            transition.resource = resourceIndex;
+            transition.subresources = subresources;
+            transition.state = state;
+            resourceHistory.push_back(transition);
+        };
+
+        for (Chunk& chunk : m_Chunks)
+        {
+            chunk.initialStates.clear();
+
+            std::vector<RenderGraphResource> chunkResources;
+            for (uint32_t use = chunk.firstUse; use < chunk.firstUse + chunk.numPasses; ++use)
+            {
+                for (const Access& access : m_Passes[m_Schedule[use]].accesses)
+                {
+                    if (m_Resources[access.resource].needsStateTracking())
+                        chunkResources.push_back(access.resource);
+                }
+            }
+
+            std::sort(chunkResources.begin(), chunkResources.end());
+            chunkResources.erase(std::unique(chunkResources.begin(), chunkResources.end()), chunkResources.end());
+
+            for (RenderGraphResource resourceIndex : chunkResources)
+                chunk.initialStates.insert(chunk.initialStates.end(), history[resourceIndex].begin(), history[resourceIndex].end());
+
+            for (uint32_t use = chunk.firstUse; use < chunk.firstUse + chunk.numPasses; ++use)
+            {
+                const Pass& pass = m_Passes[m_Schedule[use]];
+
+                for (const Access& access : pass.accesses)
+                {
+                    if (m_Resources[access.resource].needsStateTracking())
+                        recordTransition(access.resource, access.subresources, access.state);
+                }
+
+                for (const Transition& transition : pass.splitTransitions)
+                {
+                    if (m_Resources[transition.resource].needsStateTracking())
+                        recordTransition(transition.resource, transition.subresources, transition.state);
+                }
+            }
+        }
+
+        for (size_t resourceIndex = 0; resourceIndex < m_Resources.size(); ++resourceIndex)
+        {
+            const Resource& resource = m_Resources[resourceIndex];
+            if (!resource.needsStateTracking() || resource.finalState == ResourceStates::Unknown)
+                continue;
+
+            m_EpilogueInitialStates.insert(m_EpilogueInitialStates.end(), history[resourceIndex].begin(), history[resourceIndex].end());
+
+            Transition transition;
+            transition.resource = RenderGraphResource(resourceIndex);
+            transition.state = resource.finalState;
+            m_FinalTransitions.push_back(transition);
+        }
+    }
+
+    bool RenderGraph::compile()
+    {
+        m_Schedule.clear();
+        m_Chunks.clear();
+        m_Batches.clear();
+        m_EpilogueInitialStates.clear();
+        m_FinalTransitions.clear();
+        m_Statistics = RenderGraphStatistics();
+        m_Compiled = false;
+        ++m_FrameIndex;
+
+        findDependencies();
+        cullPasses();
+
+        for (RenderGraphPass passIndex = 0; passIndex < RenderGraphPass(m_Passes.size()); ++passIndex)
+        {
+            Pass& pass = m_Passes[passIndex];
+            pass.splitTransitions.clear();
+
+            if (!pass.needed)
+            {
+                ++m_Statistics.numCulledPasses;
+                continue;
+            }
+
+            pass.queue = (pass.desc.asyncCompute && m_AsyncComputeSupported) ? CommandQueue::Compute : CommandQueue::Graphics;
+            pass.use = uint32_t(m_Schedule.size());
+            m_Schedule.push_back(passIndex);
+
+            if (pass.queue == CommandQueue::Compute)
+                ++m_Statistics.numAsyncComputePasses;
+        }
+
+        m_Statistics.numPasses = uint32_t(m_Schedule.size());
+
+        if (!allocateTransientResources())
+            return false;
+
+        buildChunks();
+        planTransitions();
+
+        m_Compiled = true;
+        return true;
+    }
+
+    ICommandList* RenderGraph::getCommandList(CommandQueue queue, uint32_t index)
+    {
+        std::vector<CommandListHandle>& commandLists = m_CommandLists[size_t(queue)];
+
+        while (commandLists.size() <= index)
+        {
+            CommandListHandle commandList = m_Device->createCommandList(CommandListParameters().setQueueType(queue));
+            if (!commandList)
+                return nullptr;
+
+            commandLists.push_back(commandList);
+        }
+
+        return commandLists[index];
+    }
+
+    void RenderGraph::applyTransitions(ICommandList* commandList, const std::vector<Transition>& transitions) const
+    {
+        for (const Transition& transition : transitions)
+        {
+            const Resource& resource = m_Resources[transition.resource];
+            if (resource.isTexture)
+                commandList->beginTrackingTextureState(resource.texture, transition.subresources, transition.state);
+            else
+                commandList->beginTrackingBufferState(resource.buffer, transition.state);
+        }
+    }
+
+    void RenderGraph::recordChunk(const Chunk& chunk)
+    {
+        ICommandList* commandList = chunk.commandList;
+
+        commandList->open();
+        commandList->setEnableAutomaticBarriers(false);
+        applyTransitions(commandList, chunk.initialStates);
+
+        for (uint32_t use = chunk.firstUse; use < chunk.firstUse + chunk.numPasses; ++use)
+        {
+            const Pass& pass = m_Passes[m_Schedule[use]];
+
+            const bool hasMarker = !pass.desc.name.empty();
+            if (hasMarker)
+                commandList->beginMarker(pass.desc.name.c_str());
+
+            // Aliasing barriers go before the transitions of the resources that take over the memory
+            if (m_TransientPool)
+                m_TransientPool->beginUse(commandList, use);
+
+            for (const Access& access : pass.accesses)
+            {
+                const Resource& resource = m_Resources[access.resource];
+                if (resource.isTexture)
+                    commandList->setTextureState(resource.texture, access.subresources, access.state);
+                else
+                    commandList->setBufferState(resource.buffer, access.state);
+            }
+
+            commandList->commitBarriers();
+
+            if (pass.callback)
+                pass.callback(commandList);
+
+            for (const Transition& transition : pass.splitTransitions)
+            {
+                const Resource& resource = m_Resources[transition.resource];
+                if (resource.isTexture)
+                    commandList->beginTextureStateTransition(resource.texture, transition.subresources, transition.state);
+                else
+                    commandList->beginBufferStateTransition(resource.buffer, transition.state);
+            }
+
+            if (hasMarker)
+                commandList->endMarker();
+        }
+
+        commandList->close();
+    }
+
+    void RenderGraph::recordChunks()
+    {
+        const size_t numChunks = m_Chunks.size();
+
+        if (!m_ParallelRecordingSupported || numChunks < 2)
+        {
+            for (const Chunk& chunk : m_Chunks)
+                recordChunk(chunk);
+            return;
+        }
+
+        // The first chunk is recorded on the calling thread while the others run as tasks
+        if (ITaskScheduler* scheduler = m_Device->getTaskScheduler())
+        {
+            std::mutex mutex;
+            std::condition_variable condition;
+            size_t remaining = numChunks - 1;
+
+            for (size_t chunkIndex = 1; chunkIndex < numChunks; ++chunkIndex)
+            {
+                scheduler->scheduleTask([this, chunkIndex, &mutex, &condition, &remaining]()
+                {
+                    recordChunk(m_Chunks[chunkIndex]);
+
+                    std::lock_guard lockGuard(mutex);
+                    if (--remaining == 0)
+                        condition.notify_one();
+                });
+            }
+
+            recordChunk(m_Chunks[0]);
+
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [&remaining]() { return remaining == 0; });
+        }
+        else
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(numChunks - 1);
+
+            for (size_t chunkIndex = 1; chunkIndex < numChunks; ++chunkIndex)
+                threads.emplace_back([this, chunkIndex]() { recordChunk(m_Chunks[chunkIndex]); });
+
+            recordChunk(m_Chunks[0]);
+
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+    }
+
+    bool RenderGraph::execute()
+    {
+        if (!m_Compiled)
+        {
+            error("Render graph must be compiled before it is executed");
+            return false;
+        }
+
+        uint32_t commandListIndices[size_t(CommandQueue::Count)] = {};
+        for (Chunk& chunk : m_Chunks)
+        {
+            chunk.commandList = getCommandList(chunk.queue, commandListIndices[size_t(chunk.queue)]++);
+            if (!chunk.commandList)
+            {
+                error("Failed to create a render graph command list");
+                return false;
+            }
+        }
+
+        ICommandList* epilogue = nullptr;
+        if (!m_FinalTransitions.empty())
+        {
+            epilogue = getCommandList(CommandQueue::Graphics, commandListIndices[size_t(CommandQueue::Graphics)]++);
+            if (!epilogue)
+            {
+                error("Failed to create a render graph command list");
+                return false;
+            }
+        }
+
+        recordChunks();
+
+        std::vector<ICommandList*> commandLists;
+        uint64_t lastComputeInstance = 0;
+        bool computeWaited = true;
+        bool firstComputeBatch = true;
+
+        for (Batch& batch : m_Batches)
+        {
+            const CommandQueue otherQueue = batch.queue == CommandQueue::Compute ? CommandQueue::Graphics : CommandQueue::Compute;
+
+            if (batch.waitBatch >= 0)
+                m_Device->queueWaitForCommandList(batch.queue, otherQueue, m_Batches[batch.waitBatch].instance);
+            else if (batch.queue == CommandQueue::Compute && firstComputeBatch && m_LastGraphicsInstance != 0)
+            {
+                // Transient resources used on the compute queue may share memory with the previous frame's graphics work
+                m_Device->queueWaitForCommandList(CommandQueue::Compute, CommandQueue::Graphics, m_LastGraphicsInstance);
+            }
+
+            commandLists.clear();
+            for (uint32_t chunkIndex = batch.firstChunk; chunkIndex < batch.firstChunk + batch.numChunks; ++chunkIndex)
+                commandLists.push_back(m_Chunks[chunkIndex].commandList);
+
+            batch.instance = m_Device->executeCommandLists(commandLists.data(), commandLists.size(), batch.queue);
+
+            if (batch.queue == CommandQueue::Compute)
+            {
+                lastComputeInstance = batch.instance;
+                computeWaited = false;
+                firstComputeBatch = false;
+            }
+            else
+            {
+                if (batch.waitBatch >= 0 && m_Batches[batch.waitBatch].instance == lastComputeInstance)
+                    computeWaited = true;
+                m_LastGraphicsInstance = batch.instance;
+            }
+        }
+
+        // Later graphics work, including the next frame, must not overlap the compute passes of this frame
+        if (!computeWaited)
+            m_Device->queueWaitForCommandList(CommandQueue::Graphics, CommandQueue::Compute, lastComputeInstance);
+
+        if (epilogue)
+        {
+            epilogue->open();
+            epilogue->setEnableAutomaticBarriers(false);
+            applyTransitions(epilogue, m_EpilogueInitialStates);
+
+            for (const Transition& transition : m_FinalTransitions)
+            {
+                const Resource& resource = m_Resources[transition.resource];
+                if (resource.isTexture)
+                    epilogue->setTextureState(resource.texture, AllSubresources, transition.state);
+                else
+                    epilogue->setBufferState(resource.buffer, transition.state);
+            }
+
+            epilogue->commitBarriers();
+            epilogue->close();
+
+            m_LastGraphicsInstance = m_Device->executeCommandLists(&epilogue, 1, CommandQueue::Graphics);
+        }
+
+        return true;
+    }
+
+    ITexture* RenderGraph::getTexture(RenderGraphResource texture)
+    {
+        if (texture >= m_Resources.size() || !m_Resources[texture].isTexture)
+            return nullptr;
+
+        return m_Resources[texture].texture;
+    }
+
+    IBuffer* RenderGraph::getBuffer(RenderGraphResource buffer)
+    {
+        if (buffer >= m_Resources.size() || m_Resources[buffer].isTexture)
+            return nullptr;
+
+        return m_Resources[buffer].buffer;
+    }
+
+    RenderGraphHandle CreateRenderGraph(IDevice* device, const RenderGraphDesc& desc)
+    {
+        if (!device)
+            return nullptr;
+
+        return RenderGraphHandle::Create(new RenderGraph(device, desc));
+    }
+}
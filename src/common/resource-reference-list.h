@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+namespace nvrhi
+{
+    // The list of resources that a command list instance keeps alive until it finishes executing.
+    // Command lists add the same resources over and over again (every bind, copy and barrier), so the list
+    // deduplicates them with a small open-addressing set of the raw pointers: each unique resource gets
+    // one reference per instance no matter how often it's used. clear() keeps the storage for the next recording.
+    // The list is not thread-safe, like the command lists that use it.
+    class ResourceReferenceList
+    {
+    public:
+        typedef std::vector<RefCountPtr<IResource>>::const_iterator const_iterator;
+
+        // Adds a reference to 'resource' unless the list already holds one. Null pointers are ignored.
+        void push_back(IResource* resource)
+        {
+            if (!resource)
+                return;
+
+            // Keep the load factor at or below 1/2 so that the probe sequences stay short
+            if ((m_Resources.size() + 1) * 2 > m_Table.size())
+                grow();
+
+            if (insert(resource))
+                m_Resources.push_back(resource);
+        }
+
+        void clear()
+        {
+            if (m_Resources.empty())
+                return;
+
+            m_Resources.clear();
+            std::fill(m_Table.begin(), m_Table.end(), nullptr);
+        }
+
+        [[nodiscard]] size_t size() const { return m_Resources.size(); }
+        [[nodiscard]] bool empty() const { return m_Resources.empty(); }
+        [[nodiscard]] const_iterator begin() const { return m_Resources.begin(); }
+        [[nodiscard]] const_iterator end() const { return m_Resources.end(); }
+
+    private:
+        static constexpr size_t c_InitialTableSize = 64;
+
+        std::vector<RefCountPtr<IResource>> m_Resources;
+        std::vector<IResource*> m_Table; // size is 0 or a power of 2, empty slots are null
+
+        [[nodiscard]] size_t getSlot(const IResource* resource) const
+        {
+            // Fibonacci hashing of the pointer, the low bits are always zero because of the alignment
+            const uint64_t key = uint64_t(reinterpret_cast<uintptr_t>(resource)) >> 4;
+            return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & (m_Table.size() - 1);
+        }
+
+        // Returns true if the resource was not in the table yet.
+        bool insert(IResource* resource)
+        {
+            const size_t mask = m_Table.size() - 1;
+            for (size_t slot = getSlot(resource); ; slot = (slot + 1) & mask)
+            {
+                if (m_Table[slot] == resource)
+                    return false;
+
+                if (!m_Table[slot])
+                {
+                    m_Table[slot] = resource;
+                    return true;
+                }
+            }
+        }
+
+        void grow()
+        {
+            m_Table.assign(m_Table.empty() ? c_InitialTableSize : m_Table.size() * 2, nullptr);
+
+            for (const auto& resource : m_Resources)
+                insert(resource.Get());
+        }
+    };
+}
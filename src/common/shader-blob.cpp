@@ -0,0 +1,692 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include <nvrhi/common/shader-blob.h>
+#include <nvrhi/utils.h>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace nvrhi
+{
+    static const char c_ShaderBlobSignatureV1[4] = { 'N', 'V', 'S', 'P' };
+    static const char c_ShaderBlobSignatureV2[4] = { 'N', 'V', 'S', '2' };
+
+    static std::string buildPermutationString(const ShaderConstant* constants, uint32_t numConstants)
+    {
+        std::string permutation;
+
+        for (uint32_t n = 0; n < numConstants; n++)
+        {
+            if (n > 0)
+                permutation += ' ';
+
+            permutation += constants[n].name;
+
+            if (constants[n].value)
+            {
+                permutation += '=';
+                permutation += constants[n].value;
+            }
+        }
+
+        return permutation;
+    }
+
+    bool isValidShaderBlob(const void* blob, size_t blobSize)
+    {
+        if (!blob || blobSize < sizeof(c_ShaderBlobSignatureV1))
+            return false;
+
+        if (memcmp(blob, c_ShaderBlobSignatureV1, sizeof(c_ShaderBlobSignatureV1)) == 0)
+            return true;
+
+        if (blobSize < sizeof(ShaderBlobHeader) || memcmp(blob, c_ShaderBlobSignatureV2, sizeof(c_ShaderBlobSignatureV2)) != 0)
+            return false;
+
+        ShaderBlobHeader header;
+        memcpy(&header, blob, sizeof(header));
+
+        return (blobSize - sizeof(ShaderBlobHeader)) / sizeof(ShaderBlobIndexEntry) >= header.permutationCount;
+    }
+
+    static bool findPermutationInBlobV1(const uint8_t* blob, size_t blobSize, const std::string& permutation,
+        const void** pBinary, size_t* pSize)
+    {
+        size_t offset = sizeof(c_ShaderBlobSignatureV1);
+
+        while (blobSize - offset >= sizeof(ShaderBlobEntry))
+        {
+            ShaderBlobEntry entry;
+            memcpy(&entry, blob + offset, sizeof(entry));
+            offset += sizeof(entry);
+
+            if (blobSize - offset < size_t(entry.permutationSize) + size_t(entry.dataSize))
+                return false;
+
+            const char* entryPermutation = reinterpret_cast<const char*>(blob + offset);
+            size_t entryPermutationSize = entry.permutationSize;
+
+            // shaderCompiler writes the version 1 permutation strings with a trailing space
+            if (entryPermutationSize > 0 && entryPermutation[entryPermutationSize - 1] == ' ')
+                --entryPermutationSize;
+
+            if (entryPermutationSize == permutation.size() && memcmp(entryPermutation, permutation.data(), entryPermutationSize) == 0)
+            {
+                *pBinary = blob + offset + entry.permutationSize;
+                *pSize = entry.dataSize;
+                return true;
+            }
+
+            offset += size_t(entry.permutationSize) + size_t(entry.dataSize);
+        }
+
+        return false;
+    }
+
+    static bool isCompressedShaderBlob(const void* blob, size_t blobSize)
+    {
+        if (blobSize < sizeof(ShaderBlobHeader) || memcmp(blob, c_ShaderBlobSignatureV2, sizeof(c_ShaderBlobSignatureV2)) != 0)
+            return false;
+
+        ShaderBlobHeader header;
+        memcpy(&header, blob, sizeof(header));
+        return (header.flags & c_ShaderBlobFlagCompressed) != 0;
+    }
+
+    static bool findEntryInBlobV2(const uint8_t* blob, size_t blobSize, const std::string& permutation,
+        size_t& outIndex, ShaderBlobIndexEntry& outEntry)
+    {
+        ShaderBlobHeader header;
+        memcpy(&header, blob, sizeof(header));
+
+        const uint8_t* index = blob + sizeof(ShaderBlobHeader);
+        auto readEntry = [index](size_t i) {
+            ShaderBlobIndexEntry entry;
+            memcpy(&entry, index + i * sizeof(ShaderBlobIndexEntry), sizeof(entry));
+            return entry;
+        };
+
+        const uint64_t permutationHash = hashShaderPermutation(permutation.data(), permutation.size());
+
+        // Find the first entry with a matching hash
+        size_t first = 0;
+        size_t count = header.permutationCount;
+        while (count > 0)
+        {
+            size_t step = count / 2;
+            if (readEntry(first + step).permutationHash < permutationHash)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+                count = step;
+        }
+
+        // Different permutations can have the same hash, compare the strings to find the right one
+        for (size_t i = first; i < header.permutationCount; i++)
+        {
+            ShaderBlobIndexEntry entry = readEntry(i);
+            if (entry.permutationHash != permutationHash)
+                break;
+
+            if (entry.permutationSize != permutation.size() ||
+                entry.permutationOffset > blobSize || blobSize - entry.permutationOffset < entry.permutationSize ||
+                entry.dataOffset > blobSize || blobSize - entry.dataOffset < entry.dataSize)
+                continue;
+
+            if (memcmp(blob + entry.permutationOffset, permutation.data(), permutation.size()) == 0)
+            {
+                outIndex = i;
+                outEntry = entry;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool findPermutationInBlob(
+        const void* blob,
+        size_t blobSize,
+        const ShaderConstant* constants,
+        uint32_t numConstants,
+        const void** pBinary,
+        size_t* pSize)
+    {
+        if (!blob || blobSize == 0)
+            return false;
+
+        if (!isValidShaderBlob(blob, blobSize))
+        {
+            if (numConstants == 0)
+            {
+                *pBinary = blob;
+                *pSize = blobSize;
+                return true; // this blob is not a permutation blob, and no permutation is requested
+            }
+            
+            return false;
+        }
+
+        const std::string permutation = buildPermutationString(constants, numConstants);
+        const uint8_t* bytes = static_cast<const uint8_t*>(blob);
+
+        if (memcmp(blob, c_ShaderBlobSignatureV2, sizeof(c_ShaderBlobSignatureV2)) == 0)
+        {
+            if (isCompressedShaderBlob(blob, blobSize))
+                return false;
+
+            size_t index = 0;
+            ShaderBlobIndexEntry entry;
+            if (!findEntryInBlobV2(bytes, blobSize, permutation, index, entry))
+                return false;
+
+            *pBinary = bytes + entry.dataOffset;
+            *pSize = size_t(entry.dataSize);
+            return true;
+        }
+        
+        return findPermutationInBlobV1(bytes, blobSize, permutation, pBinary, pSize);
+    }
+
+    // LZ4 block format constants, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+    constexpr size_t c_Lz4MinMatch = 4;
+    constexpr size_t c_Lz4LastLiterals = 5; // the last 5 bytes of a block are always literals
+    constexpr size_t c_Lz4MatchFindLimit = 12; // the last match must start at least 12 bytes before the end
+    constexpr size_t c_Lz4MaxOffset = 65535;
+    constexpr uint32_t c_Lz4HashLog = 16;
+
+    static uint32_t lz4Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t lz4Hash(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - c_Lz4HashLog);
+    }
+
+    static void lz4WriteLength(std::vector<uint8_t>& out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(uint8_t(length));
+    }
+
+    std::vector<uint8_t> compressShaderBinary(
+        const void* data,
+        size_t size,
+        const void* dictionary,
+        size_t dictionarySize)
+    {
+        dictionarySize = std::min(dictionarySize, c_ShaderBlobMaxDictionarySize);
+
+        // Put the dictionary right before the data, so that matches can reference both
+        std::vector<uint8_t> input(dictionarySize + size);
+        if (dictionarySize)
+            memcpy(input.data(), dictionary, dictionarySize);
+        if (size)
+            memcpy(input.data() + dictionarySize, data, size);
+
+        const uint8_t* base = input.data();
+        const size_t start = dictionarySize;
+        const size_t end = input.size();
+
+        std::vector<uint8_t> out;
+        out.reserve(size + size / 255 + 16);
+
+        std::vector<int64_t> table(size_t(1) << c_Lz4HashLog, -1);
+        for (size_t pos = 0; pos + c_Lz4MinMatch <= dictionarySize; pos++)
+            table[lz4Hash(lz4Read32(base + pos))] = int64_t(pos);
+
+        size_t anchor = start;
+        size_t pos = start;
+
+        if (size >= c_Lz4MatchFindLimit + 1)
+        {
+            const size_t matchFindLimit = end - c_Lz4MatchFindLimit;
+            const size_t matchEndLimit = end - c_Lz4LastLiterals;
+
+            while (pos < matchFindLimit)
+            {
+                const uint32_t sequence = lz4Read32(base + pos);
+                const uint32_t hash = lz4Hash(sequence);
+                const int64_t candidate = table[hash];
+                table[hash] = int64_t(pos);
+
+                if (candidate < 0 || pos - size_t(candidate) > c_Lz4MaxOffset || lz4Read32(base + candidate) != sequence)
+                {
+                    pos++;
+                    continue;
+                }
+
+                size_t matchLength = c_Lz4MinMatch;
+                while (pos + matchLength < matchEndLimit && base[candidate + matchLength] == base[pos + matchLength])
+                    matchLength++;
+
+                const size_t literalLength = pos - anchor;
+                const size_t offset = pos - size_t(candidate);
+                const size_t extraMatchLength = matchLength - c_Lz4MinMatch;
+
+                out.push_back(uint8_t((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(extraMatchLength, 15)));
+                if (literalLength >= 15)
+                    lz4WriteLength(out, literalLength - 15);
+                out.insert(out.end(), base + anchor, base + pos);
+                out.push_back(uint8_t(offset & 0xff));
+                out.push_back(uint8_t(offset >> 8));
+                if (extraMatchLength >= 15)
+                    lz4WriteLength(out, extraMatchLength - 15);
+
+                pos += matchLength;
+                anchor = pos;
+
+                // Index a position inside the match to improve the chances of finding the next one
+                if (pos - 2 < matchFindLimit)
+                    table[lz4Hash(lz4Read32(base + pos - 2))] = int64_t(pos - 2);
+            }
+        }
+
+        // The last sequence contains only literals
+        const size_t literalLength = end - anchor;
+        out.push_back(uint8_t(std::min<size_t>(literalLength, 15) << 4));
+        if (literalLength >= 15)
+            lz4WriteLength(out, literalLength - 15);
+        out.insert(out.end(), base + anchor, base + end);
+
+        return out;
+    }
+
+    bool decompressShaderBinary(
+        const void* src,
+        size_t srcSize,
+        void* dst,
+        size_t dstSize,
+        const void* dictionary,
+        size_t dictionarySize)
+    {
+        const uint8_t* ip = static_cast<const uint8_t*>(src);
+        const uint8_t* const inputEnd = ip + srcSize;
+        uint8_t* const output = static_cast<uint8_t*>(dst);
+        uint8_t* op = output;
+        uint8_t* const outputEnd = output + dstSize;
+        const uint8_t* const dict = static_cast<const uint8_t*>(dictionary);
+
+        auto readLength = [&ip, inputEnd](size_t& length) {
+            uint8_t byte;
+            do
+            {
+                if (ip >= inputEnd)
+                    return false;
+                byte = *ip++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        };
+
+        while (ip < inputEnd)
+        {
+            const uint8_t token = *ip++;
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !readLength(literalLength))
+                return false;
+
+            if (size_t(inputEnd - ip) < literalLength || size_t(outputEnd - op) < literalLength)
+                return false;
+
+            // memcpy with a null pointer is undefined even for zero bytes, and op is null for an empty output
+            if (literalLength != 0)
+            {
+                memcpy(op, ip, literalLength);
+                ip += literalLength;
+                op += literalLength;
+            }
+
+            // The last sequence has no match
+            if (ip == inputEnd)
+                break;
+
+            if (inputEnd - ip < 2)
+                return false;
+
+            const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+            ip += 2;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !readLength(matchLength))
+                return false;
+            matchLength += c_Lz4MinMatch;
+
+            const size_t produced = size_t(op - output);
+            if (offset == 0 || offset > produced + dictionarySize || size_t(outputEnd - op) < matchLength)
+                return false;
+
+            if (offset > produced)
+            {
+                // The match starts in the dictionary and may continue into the output
+                const size_t dictionaryBytes = std::min(offset - produced, matchLength);
+                memcpy(op, dict + dictionarySize - (offset - produced), dictionaryBytes);
+                op += dictionaryBytes;
+                matchLength -= dictionaryBytes;
+
+                if (matchLength == 0)
+                    continue;
+            }
+
+            const uint8_t* match = op - offset;
+            if (offset >= matchLength)
+            {
+                memcpy(op, match, matchLength);
+                op += matchLength;
+            }
+            else
+            {
+                // Overlapping copy that repeats a short pattern
+                for (size_t i = 0; i < matchLength; i++)
+                    *op++ = *match++;
+            }
+        }
+
+        return op == outputEnd;
+    }
+}
+
+namespace nvrhi::utils
+{
+    ShaderBlobFile::~ShaderBlobFile()
+    {
+        close();
+    }
+
+    bool ShaderBlobFile::open(const char* fileName)
+    {
+        close();
+
+        void* data = nullptr;
+        size_t size = 0;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+        {
+            size = size_t(fileSize.QuadPart);
+
+            // The view keeps the mapping and the file open, so the handles can be closed right away
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping)
+            {
+                data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+        }
+
+        CloseHandle(file);
+#else
+        int file = ::open(fileName, O_RDONLY);
+        if (file < 0)
+            return false;
+
+        struct stat fileStat{};
+        if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            size = size_t(fileStat.st_size);
+
+            // The mapping keeps the file open, so the descriptor can be closed right away
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (data == MAP_FAILED)
+                data = nullptr;
+        }
+
+        ::close(file);
+#endif
+
+        if (!data)
+            return false;
+
+        m_Data = data;
+        m_Size = size;
+
+        if (!isValidShaderBlob(m_Data, m_Size))
+        {
+            close();
+            return false;
+        }
+
+        if (isCompressed())
+        {
+            const uint32_t permutationCount = getPermutationCount();
+            const size_t dictionaryOffset = sizeof(ShaderBlobHeader) + sizeof(ShaderBlobIndexEntry) * size_t(permutationCount);
+            if (m_Size - dictionaryOffset < sizeof(ShaderBlobDictionary))
+            {
+                close();
+                return false;
+            }
+
+            ShaderBlobDictionary dictionary;
+            memcpy(&dictionary, static_cast<const uint8_t*>(m_Data) + dictionaryOffset, sizeof(dictionary));
+            if (dictionary.offset > m_Size || m_Size - dictionary.offset < dictionary.size || dictionary.size > c_ShaderBlobMaxDictionarySize)
+            {
+                close();
+                return false;
+            }
+
+            m_Dictionary = static_cast<const uint8_t*>(m_Data) + dictionary.offset;
+            m_DictionarySize = size_t(dictionary.size);
+            m_Decompressed = std::make_unique<DecompressedBinary[]>(permutationCount);
+        }
+
+        return true;
+    }
+
+    void ShaderBlobFile::close()
+    {
+        if (!m_Data)
+            return;
+
+#ifdef _WIN32
+        UnmapViewOfFile(m_Data);
+#else
+        munmap(const_cast<void*>(m_Data), m_Size);
+#endif
+
+        m_Data = nullptr;
+        m_Size = 0;
+        m_Dictionary = nullptr;
+        m_DictionarySize = 0;
+        m_Decompressed.reset();
+    }
+
+    bool ShaderBlobFile::isCompressed() const
+    {
+        return m_Data && isCompressedShaderBlob(m_Data, m_Size);
+    }
+
+    const ShaderBlobFile::DecompressedBinary& ShaderBlobFile::getDecompressedBinary(size_t index) const
+    {
+        DecompressedBinary& binary = m_Decompressed[index];
+
+        // Binaries are decompressed on first use, and concurrent requests for the same binary wait for one decompression
+        std::call_once(binary.once, [this, &binary, index]()
+        {
+            ShaderBlobIndexEntry entry;
+            memcpy(&entry, static_cast<const uint8_t*>(m_Data) + sizeof(ShaderBlobHeader) + index * sizeof(ShaderBlobIndexEntry), sizeof(entry));
+
+            if (entry.dataOffset > m_Size || m_Size - entry.dataOffset < entry.dataSize || entry.dataSize < sizeof(ShaderBlobCompressedPayload))
+                return;
+
+            const uint8_t* payload = static_cast<const uint8_t*>(m_Data) + entry.dataOffset;
+            ShaderBlobCompressedPayload payloadHeader;
+            memcpy(&payloadHeader, payload, sizeof(payloadHeader));
+
+            binary.data.resize(payloadHeader.uncompressedSize);
+            binary.valid = decompressShaderBinary(payload + sizeof(payloadHeader), size_t(entry.dataSize) - sizeof(payloadHeader),
+                binary.data.data(), binary.data.size(), m_Dictionary, m_DictionarySize);
+
+            if (!binary.valid)
+                binary.data = std::vector<uint8_t>();
+        });
+
+        return binary;
+    }
+
+    bool ShaderBlobFile::decompressAll(ITaskScheduler* scheduler) const
+    {
+        if (!isCompressed())
+            return true;
+
+        const uint32_t permutationCount = getPermutationCount();
+
+        uint32_t workerCount = scheduler ? scheduler->getConcurrency() : std::thread::hardware_concurrency();
+        workerCount = std::max(1u, std::min(workerCount, permutationCount));
+
+        std::atomic<uint32_t> nextIndex = 0;
+        std::atomic<bool> success = true;
+
+        auto worker = [this, &nextIndex, &success, permutationCount]()
+        {
+            for (uint32_t index = nextIndex++; index < permutationCount; index = nextIndex++)
+            {
+                if (!getDecompressedBinary(index).valid)
+                    success = false;
+            }
+        };
+
+        // The calling thread is one of the workers
+        if (scheduler)
+        {
+            std::mutex mutex;
+            std::condition_variable condition;
+            uint32_t finishedTasks = 0;
+
+            for (uint32_t i = 1; i < workerCount; i++)
+            {
+                scheduler->scheduleTask([&worker, &mutex, &condition, &finishedTasks]()
+                {
+                    worker();
+
+                    std::lock_guard lockGuard(mutex);
+                    ++finishedTasks;
+                    condition.notify_one();
+                });
+            }
+
+            worker();
+
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [&finishedTasks, workerCount]() { return finishedTasks == workerCount - 1; });
+        }
+        else
+        {
+            std::vector<std::thread> threads;
+            for (uint32_t i = 1; i < workerCount; i++)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+
+        return success;
+    }
+
+    uint32_t ShaderBlobFile::getPermutationCount() const
+    {
+        if (!m_Data || m_Size < sizeof(ShaderBlobHeader) || memcmp(m_Data, c_ShaderBlobSignatureV2, sizeof(c_ShaderBlobSignatureV2)) != 0)
+            return 0;
+
+        ShaderBlobHeader header;
+        memcpy(&header, m_Data, sizeof(header));
+        return header.permutationCount;
+    }
+
+    bool ShaderBlobFile::findPermutation(const ShaderConstant* constants, uint32_t numConstants, const void** pBinary, size_t* pSize) const
+    {
+        if (!m_Data)
+            return false;
+
+        if (m_Decompressed)
+        {
+            size_t index = 0;
+            ShaderBlobIndexEntry entry;
+            if (!findEntryInBlobV2(static_cast<const uint8_t*>(m_Data), m_Size, buildPermutationString(constants, numConstants), index, entry))
+                return false;
+
+            const DecompressedBinary& binary = getDecompressedBinary(index);
+            if (!binary.valid)
+                return false;
+
+            *pBinary = binary.data.data();
+            *pSize = binary.data.size();
+            return true;
+        }
+        
+        return findPermutationInBlob(m_Data, m_Size, constants, numConstants, pBinary, pSize);
+    }
+
+    ShaderHandle ShaderBlobFile::createShader(IDevice* device, const ShaderDesc& desc, const ShaderConstant* constants, uint32_t numConstants) const
+    {
+        const void* binary = nullptr;
+        size_t binarySize = 0;
+
+        if (!findPermutation(constants, numConstants, &binary, &binarySize))
+            return nullptr;
+
+        return device->createShader(desc, binary, binarySize);
+    }
+
+    ShaderLibraryHandle ShaderBlobFile::createShaderLibrary(IDevice* device, const ShaderConstant* constants, uint32_t numConstants) const
+    {
+        const void* binary = nullptr;
+        size_t binarySize = 0;
+
+        if (!findPermutation(constants, numConstants, &binary, &binarySize))
+            return nullptr;
+
+        return device->createShaderLibrary(binary, binarySize);
+    }
+}
@@ -0,0 +1,201 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+// Single-pass mip generation, used by nvrhi::utils::MipGenerator.
+// Every thread group reduces a 64x64 tile of the input mip to mips 1 through 6 using groupshared memory.
+// The last group to finish, found with a global atomic counter, reduces the 6th mips of all tiles to mips 7 through 12.
+// Inputs up to 4096x4096 are handled by one dispatch, larger ones take a dispatch per 6 mips first.
+// Compiled with DXC into DXIL and SPIR-V that are embedded into the library, see NVRHI_EMBED_SHADERS.
+
+struct Constants
+{
+    uint2 inputSize;
+    float2 invInputSize;
+    uint numMips;       // Mips to generate in this dispatch, 1 to 12
+    uint numGroups;     // Thread groups per array slice
+    uint isSRGB;        // The output views use the linear format, so sRGB encoding is done here
+    uint padding;
+};
+
+#ifdef SPIRV
+[[vk::push_constant]] ConstantBuffer<Constants> g_Const;
+#else
+ConstantBuffer<Constants> g_Const : register(b0);
+#endif
+
+Texture2DArray<float4> t_Input : register(t0);
+SamplerState s_Linear : register(s0);
+
+RWTexture2DArray<float4> u_Mip1 : register(u0);
+RWTexture2DArray<float4> u_Mip2 : register(u1);
+RWTexture2DArray<float4> u_Mip3 : register(u2);
+RWTexture2DArray<float4> u_Mip4 : register(u3);
+RWTexture2DArray<float4> u_Mip5 : register(u4);
+RWTexture2DArray<float4> u_Mip6 : register(u5);
+RWTexture2DArray<float4> u_Mip7 : register(u6);
+RWTexture2DArray<float4> u_Mip8 : register(u7);
+RWTexture2DArray<float4> u_Mip9 : register(u8);
+RWTexture2DArray<float4> u_Mip10 : register(u9);
+RWTexture2DArray<float4> u_Mip11 : register(u10);
+RWTexture2DArray<float4> u_Mip12 : register(u11);
+
+// One counter per array slice, cleared before the dispatch
+globallycoherent RWStructuredBuffer<uint> u_Counters : register(u12);
+
+// The 6th mip of every tile in linear space, 64x64 texels per array slice.
+// Kept in a buffer because typed UAV loads aren't available for all formats.
+globallycoherent RWStructuredBuffer<float4> u_Intermediate : register(u13);
+
+static const uint c_IntermediateSize = 64;
+
+groupshared float4 s_Tile[32][32];
+groupshared uint s_Counter;
+
+float3 linearToSrgb(float3 color)
+{
+    float3 low = color * 12.92;
+    float3 high = 1.055 * pow(max(color, 0.0), 1.0 / 2.4) - 0.055;
+    return lerp(high, low, float3(color <= 0.0031308));
+}
+
+void storeMip(uint mip, uint2 position, uint slice, float4 value)
+{
+    uint2 mipSize = max(g_Const.inputSize >> mip, 1);
+    if (any(position >= mipSize))
+        return;
+
+    if (g_Const.isSRGB != 0)
+        value.rgb = linearToSrgb(value.rgb);
+
+    uint3 p = uint3(position, slice);
+    switch (mip)
+    {
+    case 1: u_Mip1[p] = value; break;
+    case 2: u_Mip2[p] = value; break;
+    case 3: u_Mip3[p] = value; break;
+    case 4: u_Mip4[p] = value; break;
+    case 5: u_Mip5[p] = value; break;
+    case 6: u_Mip6[p] = value; break;
+    case 7: u_Mip7[p] = value; break;
+    case 8: u_Mip8[p] = value; break;
+    case 9: u_Mip9[p] = value; break;
+    case 10: u_Mip10[p] = value; break;
+    case 11: u_Mip11[p] = value; break;
+    case 12: u_Mip12[p] = value; break;
+    }
+}
+
+// Reduces the 32x32 texels in s_Tile, which belong to 'firstMip', to the following mips up to 'lastMip'.
+// 'tileOrigin' is the position of the tile in 'firstMip'.
+void reduceTile(uint localIndex, uint2 tileOrigin, uint slice, uint firstMip, uint lastMip)
+{
+    uint size = 32;
+
+    for (uint mip = firstMip + 1; mip <= lastMip; mip++)
+    {
+        size >>= 1;
+        tileOrigin >>= 1;
+
+        uint2 p = uint2(localIndex % size, localIndex / size);
+        bool active = localIndex < size * size;
+
+        float4 value = 0;
+        if (active)
+        {
+            value = (s_Tile[p.y * 2][p.x * 2] + s_Tile[p.y * 2][p.x * 2 + 1]
+                + s_Tile[p.y * 2 + 1][p.x * 2] + s_Tile[p.y * 2 + 1][p.x * 2 + 1]) * 0.25;
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (active)
+        {
+            s_Tile[p.y][p.x] = value;
+            storeMip(mip, tileOrigin + p, slice, value);
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+[numthreads(256, 1, 1)]
+void main(uint3 groupId : SV_GroupID, uint localIndex : SV_GroupIndex)
+{
+    uint slice = groupId.z;
+    uint2 tile = groupId.xy;
+
+    // Mip 1: one bilinear sample in the middle of every 2x2 quad of the input
+    for (uint i = localIndex; i < 32 * 32; i += 256)
+    {
+        uint2 p = uint2(i % 32, i / 32);
+        uint2 position = tile * 32 + p;
+        float2 uv = (float2(position * 2) + 1.0) * g_Const.invInputSize;
+
+        float4 value = t_Input.SampleLevel(s_Linear, float3(uv, slice), 0);
+        s_Tile[p.y][p.x] = value;
+        storeMip(1, position, slice, value);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    reduceTile(localIndex, tile * 32, slice, 1, min(g_Const.numMips, 6));
+
+    if (g_Const.numMips <= 6)
+        return;
+
+    // s_Tile[0][0] now holds the 6th mip of this tile
+    if (localIndex == 0)
+        u_Intermediate[slice * c_IntermediateSize * c_IntermediateSize + tile.y * c_IntermediateSize + tile.x] = s_Tile[0][0];
+
+    DeviceMemoryBarrierWithGroupSync();
+
+    if (localIndex == 0)
+        InterlockedAdd(u_Counters[slice], 1, s_Counter);
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (s_Counter != g_Const.numGroups - 1)
+        return;
+
+    // This is the last group of the slice: all 6th mips are in the intermediate buffer
+    uint2 mip6Size = max(g_Const.inputSize >> 6, 1);
+    uint intermediateBase = slice * c_IntermediateSize * c_IntermediateSize;
+
+    for (uint j = localIndex; j < 32 * 32; j += 256)
+    {
+        uint2 p = uint2(j % 32, j / 32);
+        uint2 source = min(p * 2, mip6Size - 1);
+        uint2 sourceNext = min(p * 2 + 1, mip6Size - 1);
+
+        float4 value = (u_Intermediate[intermediateBase + source.y * c_IntermediateSize + source.x]
+            + u_Intermediate[intermediateBase + source.y * c_IntermediateSize + sourceNext.x]
+            + u_Intermediate[intermediateBase + sourceNext.y * c_IntermediateSize + source.x]
+            + u_Intermediate[intermediateBase + sourceNext.y * c_IntermediateSize + sourceNext.x]) * 0.25;
+
+        s_Tile[p.y][p.x] = value;
+        storeMip(7, p, slice, value);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    reduceTile(localIndex, uint2(0, 0), slice, 7, g_Const.numMips);
+}
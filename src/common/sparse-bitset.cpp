@@ -24,11 +24,69 @@
 
 #include <cstddef>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPARSE_BITSET_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SPARSE_BITSET_NEON 1
+#endif
+
 using namespace nvrhi;
 
 // Set this macro to 1 to run the unit test at initialization time - see below
 #define SPARSE_BITSET_UNIT_TEST 0
 
+// Set this macro to 1 to run the microbenchmark at initialization time and print the timings to stdout
+#define SPARSE_BITSET_BENCHMARK 0
+
+
+// Boolean operations on the 128-bit dense part, r = a & b, r = a & ~b, r = a | b
+
+static void denseAnd(uint64_t* r, const uint64_t* a, const uint64_t* b)
+{
+#if defined(SPARSE_BITSET_SSE2)
+    _mm_store_si128(reinterpret_cast<__m128i*>(r), _mm_and_si128(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(a)),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(b))));
+#elif defined(SPARSE_BITSET_NEON)
+    vst1q_u64(r, vandq_u64(vld1q_u64(a), vld1q_u64(b)));
+#else
+    r[0] = a[0] & b[0];
+    r[1] = a[1] & b[1];
+#endif
+}
+
+static void denseAndNot(uint64_t* r, const uint64_t* a, const uint64_t* b)
+{
+#if defined(SPARSE_BITSET_SSE2)
+    // Note the reversed operand order, _mm_andnot_si128 computes ~first & second
+    _mm_store_si128(reinterpret_cast<__m128i*>(r), _mm_andnot_si128(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(b)),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(a))));
+#elif defined(SPARSE_BITSET_NEON)
+    vst1q_u64(r, vbicq_u64(vld1q_u64(a), vld1q_u64(b)));
+#else
+    r[0] = a[0] & ~b[0];
+    r[1] = a[1] & ~b[1];
+#endif
+}
+
+static void denseOr(uint64_t* r, const uint64_t* a, const uint64_t* b)
+{
+#if defined(SPARSE_BITSET_SSE2)
+    _mm_store_si128(reinterpret_cast<__m128i*>(r), _mm_or_si128(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(a)),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(b))));
+#elif defined(SPARSE_BITSET_NEON)
+    vst1q_u64(r, vorrq_u64(vld1q_u64(a), vld1q_u64(b)));
+#else
+    r[0] = a[0] | b[0];
+    r[1] = a[1] | b[1];
+#endif
+}
+
+
 
 uint32_t& sparse_bitset::findOrInsertWord(uint32_t wordIndex)
 {
@@ -87,9 +145,29 @@ uint32_t sparse_bitset::tryGetWord(uint32_t wordIndex) const
 
 void sparse_bitset::set(uint32_t bitIndex, bool value)
 {
+    if (bitIndex < c_DenseBits)
+    {
+        const uint64_t mask = uint64_t(1) << (bitIndex & 0x3f);
+
+        if (value)
+            m_dense[bitIndex >> 6] |= mask;
+        else
+            m_dense[bitIndex >> 6] &= ~mask;
+
+        return;
+    }
+
     const uint32_t wordIndex = bitIndex >> 5;
+    const uint32_t mask = 1u << (bitIndex & 0x1f);
+
+    // Don't insert empty elements when clearing bits that were never set
+    if (!value)
+    {
+        if (tryGetWord(wordIndex) == 0)
+            return;
+    }
+
     uint32_t& bits = findOrInsertWord(wordIndex);
-    const uint32_t mask = 1 << (bitIndex & 0x1f);
 
     if (value)
         bits |= mask;
@@ -99,9 +177,12 @@ void sparse_bitset::set(uint32_t bitIndex, bool value)
 
 bool sparse_bitset::get(uint32_t bitIndex) const
 {
+    if (bitIndex < c_DenseBits)
+        return (m_dense[bitIndex >> 6] & (uint64_t(1) << (bitIndex & 0x3f))) != 0;
+
     const uint32_t wordIndex = bitIndex >> 5;
     const uint32_t bits = tryGetWord(wordIndex);
-    const uint32_t mask = 1 << (bitIndex & 0x1f);
+    const uint32_t mask = 1u << (bitIndex & 0x1f);
 
     return (bits & mask) != 0;
 }
@@ -109,6 +190,12 @@ bool sparse_bitset::get(uint32_t bitIndex) const
 sparse_bitset sparse_bitset::intersect(const sparse_bitset& a, const sparse_bitset& b)
 {
     sparse_bitset r;
+    denseAnd(r.m_dense, a.m_dense, b.m_dense);
+
+    // Most sets have no high bits, skip the sparse part without touching the vectors' storage
+    if (a.m_storage.empty() || b.m_storage.empty())
+        return r;
+
     std::vector<element>::const_iterator pa = a.m_storage.begin();
     std::vector<element>::const_iterator pb = b.m_storage.begin();
 
@@ -150,6 +237,11 @@ sparse_bitset sparse_bitset::intersect(const sparse_bitset& a, const sparse_bits
 sparse_bitset sparse_bitset::difference(const sparse_bitset& a, const sparse_bitset& b)
 {
     sparse_bitset r;
+    denseAndNot(r.m_dense, a.m_dense, b.m_dense);
+
+    if (a.m_storage.empty())
+        return r;
+
     std::vector<element>::const_iterator pa = a.m_storage.begin();
     std::vector<element>::const_iterator pb = b.m_storage.begin();
 
@@ -192,6 +284,8 @@ sparse_bitset sparse_bitset::difference(const sparse_bitset& a, const sparse_bit
 
 void sparse_bitset::include(const sparse_bitset& b)
 {
+    denseOr(m_dense, m_dense, b.m_dense);
+
     std::vector<element>::iterator pr = m_storage.begin();
     std::vector<element>::const_iterator pb = b.m_storage.begin();
 
@@ -225,6 +319,9 @@ void sparse_bitset::include(const sparse_bitset& b)
 
 bool sparse_bitset::any() const
 {
+    if ((m_dense[0] | m_dense[1]) != 0)
+        return true;
+
     for (const element& elem : m_storage)
     {
         if (elem.bits)
@@ -234,20 +331,41 @@ bool sparse_bitset::any() const
     return false;
 }
 
+void sparse_bitset::getIteratorWord(uint32_t elemIndex, uint32_t& wordIndex, uint32_t& bits) const
+{
+    if (elemIndex < c_DenseWords)
+    {
+        wordIndex = elemIndex;
+        bits = uint32_t(m_dense[elemIndex >> 1] >> ((elemIndex & 1) * 32));
+    }
+    else
+    {
+        const element& elem = m_storage[elemIndex - c_DenseWords];
+        wordIndex = elem.wordIndex;
+        bits = elem.bits;
+    }
+}
+
 uint32_t sparse_bitset::const_iterator::operator*() const
 {
-    const element& elem = bitset->m_storage[elemIndex];
-    return (elem.wordIndex << 5) + bit;
+    uint32_t wordIndex;
+    uint32_t bits;
+    bitset->getIteratorWord(elemIndex, wordIndex, bits);
+    return (wordIndex << 5) + bit;
 }
 
 sparse_bitset::const_iterator& sparse_bitset::const_iterator::operator++()
 {
-    while (elemIndex < bitset->m_storage.size())
+    const uint32_t wordCount = bitset->getIteratorWordCount();
+
+    while (elemIndex < wordCount)
     {
-        const element& elem = bitset->m_storage[elemIndex];
+        uint32_t wordIndex;
+        uint32_t bits;
+        bitset->getIteratorWord(elemIndex, wordIndex, bits);
 
         // Mask out the bits that we already processed
-        [[maybe_unused]] const uint32_t nextBits = elem.bits & ~((1 << (bit + 1)) - 1);
+        [[maybe_unused]] const uint32_t nextBits = (bit < 0) ? bits : (bit >= 31) ? 0 : (bits & ~((2u << bit) - 1));
 
 #if defined(_MSC_VER)
         // Find the index of the lowest unprocessed bit with the MSVC intrinsic
@@ -259,7 +377,7 @@ sparse_bitset::const_iterator& sparse_bitset::const_iterator::operator++()
         }
 #elif defined(__GNUC__) || defined(__clang__)
         // Find the index of the lowest unprocessed bit with the GCC/Clang intrinsic
-        int nextBitIndexPlusOne = __builtin_ffs(nextBits);
+        int nextBitIndexPlusOne = __builtin_ffs(int(nextBits));
         if (nextBitIndexPlusOne > 0)
         {
             bit = nextBitIndexPlusOne - 1;
@@ -269,7 +387,7 @@ sparse_bitset::const_iterator& sparse_bitset::const_iterator::operator++()
         // Linear search through bits - fallback for unsupported compilers
         while (++bit < 32)
         {
-            if (elem.bits & (1 << bit))
+            if (bits & (1u << bit))
                 return *this;
         }
 #endif
@@ -300,11 +418,15 @@ sparse_bitset::const_iterator sparse_bitset::begin() const
 
 sparse_bitset::const_iterator sparse_bitset::end() const
 {
-    return const_iterator{this, uint32_t(m_storage.size()), 0};
+    return const_iterator{this, getIteratorWordCount(), 0};
 }
 
 bool sparse_bitset::isOrdered() const
 {
+    // The sparse storage must not contain words that belong to the dense part
+    if (!m_storage.empty() && m_storage[0].wordIndex < c_DenseWords)
+        return false;
+
     for (size_t i = 1; i < m_storage.size(); ++i)
     {
         if (m_storage[i].wordIndex <= m_storage[i-1].wordIndex)
@@ -409,11 +531,103 @@ public:
         assert(!c.get(1234));
         assert(c.isOrdered());
 
+        // Test the bits around the end of the dense part
+        sparse_bitset d;
+        d.set(63, true);
+        d.set(64, true);
+        d.set(127, true);
+        d.set(128, true);
+        d.set(160, false);
+        assert(d.get(63) && d.get(64) && d.get(127) && d.get(128));
+        assert(!d.get(62) && !d.get(126) && !d.get(129));
+        assert(d.m_storage.size() == 1);
+        assert(d.isOrdered());
+
+        bits.clear();
+        for (uint32_t bit : d)
+            bits.push_back(bit);
+
+        expectedBits = { 63, 64, 127, 128 };
+        assert(bits == expectedBits);
+
+        sparse_bitset e;
+        e.set(64, true);
+        e.set(128, true);
+        assert((d & e).get(64) && (d & e).get(128) && !(d & e).get(63));
+        assert((d - e).get(63) && (d - e).get(127) && !(d - e).get(64) && !(d - e).get(128));
+
         return true;
     }
 };
 
 static bool g_SparseBitSetUnitTest = sparse_bitset_test::run();
 
+} // namespace nvrhi
+#endif
+
+#if SPARSE_BITSET_BENCHMARK
+
+#include <chrono>
+#include <cstdio>
+
+namespace nvrhi
+{
+
+class sparse_bitset_benchmark
+{
+public:
+    // Measures the operations used by the validation layer on typical binding sets with low register indices,
+    // and on sets that also have high indices and therefore use the sparse storage.
+    static bool run()
+    {
+        measure("low indices", 0);
+        measure("high indices", 1000);
+        return true;
+    }
+
+private:
+    static void measure(const char* name, uint32_t highOffset)
+    {
+        constexpr int iterations = 1000000;
+
+        sparse_bitset a;
+        sparse_bitset b;
+        for (uint32_t bit = 0; bit < 16; ++bit)
+        {
+            a.set(bit * 3, true);
+            b.set(bit * 5, true);
+        }
+
+        if (highOffset)
+        {
+            a.set(highOffset, true);
+            b.set(highOffset + 40, true);
+        }
+
+        bool result = false;
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            sparse_bitset diff = a - b;
+            sparse_bitset both = a & b;
+            sparse_bitset all = a;
+            all |= b;
+            result ^= diff.any() ^ both.any() ^ all.any();
+        }
+
+        const auto end = std::chrono::high_resolution_clock::now();
+        const double nanoseconds = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+        // Keep the compiler from removing the loop
+        volatile bool sink = result;
+        (void)sink;
+
+        printf("sparse_bitset (%s): %.1f ns per difference + intersect + include\n", name, nanoseconds / iterations);
+    }
+};
+
+static bool g_SparseBitSetBenchmark = sparse_bitset_benchmark::run();
+
 } // namespace nvrhi
 #endif
\ No newline at end of file
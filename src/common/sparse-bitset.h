@@ -28,22 +28,35 @@
 namespace nvrhi {
 
 // This is a container for bits that has virtually unlimited capacity, otherwise similar to std::bitset.
-// It maintains a sorted vector of elements where each element is a 32-bit word of bits at a given offset.
+// Bits below c_DenseBits are stored inline in two 64-bit words, which covers nearly all binding indices
+// and needs no allocations. Higher bits are kept in a sorted vector of elements where each element
+// is a 32-bit word of bits at a given offset.
 // It is used in the validation layer to compute, modify and compare sets of binding indices,
 // and implements only the operations necessary for that purpose.
 class sparse_bitset
 {
+public:
+    static constexpr uint32_t c_DenseBits = 128;
+
 private:
     friend class sparse_bitset_test;
 
+    // Number of 32-bit words in the dense part, i.e. the word index where the sparse storage starts
+    static constexpr uint32_t c_DenseWords = c_DenseBits / 32;
+
     struct element
     {
         uint32_t wordIndex;
         uint32_t bits;
     };
 
+    alignas(16) uint64_t m_dense[2] = { 0, 0 };
     std::vector<element> m_storage;
 
+    // Returns the 32-bit word at the specified index of the dense part followed by the sparse elements.
+    void getIteratorWord(uint32_t elemIndex, uint32_t& wordIndex, uint32_t& bits) const;
+    [[nodiscard]] uint32_t getIteratorWordCount() const { return c_DenseWords + uint32_t(m_storage.size()); }
+
     // Internal function that finds an element containing the specified bit index.
     // If such element is not present, it is inserted.
     uint32_t& findOrInsertWord(uint32_t wordIndex);
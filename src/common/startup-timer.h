@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace nvrhi
+{
+    // Measures the stages of device creation, see DeviceDesc::reportStartupTimes in the backends.
+    // The breakdown is sent to the message callback as a single Info message.
+    class StartupTimer
+    {
+    public:
+        explicit StartupTimer(bool enabled)
+            : m_Enabled(enabled)
+            , m_Start(std::chrono::steady_clock::now())
+            , m_StageStart(m_Start)
+        { }
+
+        // Ends the current stage and starts the next one
+        void mark(const char* stageName)
+        {
+            if (!m_Enabled)
+                return;
+
+            const auto now = std::chrono::steady_clock::now();
+            m_Stages.push_back({ stageName, std::chrono::duration<double, std::milli>(now - m_StageStart).count() });
+            m_StageStart = now;
+        }
+
+        void report(IMessageCallback* messageCallback, const char* deviceName) const
+        {
+            if (!m_Enabled || !messageCallback)
+                return;
+
+            const double total = std::chrono::duration<double, std::milli>(m_StageStart - m_Start).count();
+
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(3);
+            ss << deviceName << " device created in " << total << " ms:";
+            for (const Stage& stage : m_Stages)
+                ss << "\n    " << stage.name << ": " << stage.milliseconds << " ms";
+
+            messageCallback->message(MessageSeverity::Info, ss.str().c_str());
+        }
+
+    private:
+        struct Stage
+        {
+            const char* name;
+            double milliseconds;
+        };
+
+        bool m_Enabled;
+        std::chrono::steady_clock::time_point m_Start;
+        std::chrono::steady_clock::time_point m_StageStart;
+        std::vector<Stage> m_Stages;
+    };
+
+} // namespace nvrhi
@@ -24,10 +24,77 @@
 
 #include <nvrhi/utils.h>
 
+#include <algorithm>
+#include <mutex>
 #include <sstream>
 
 namespace nvrhi
 {
+    namespace
+    {
+        class TrackingSlotAllocator
+        {
+        public:
+            uint32_t allocate()
+            {
+                std::lock_guard lockGuard(m_Mutex);
+
+                if (!m_FreeSlots.empty())
+                {
+                    uint32_t slot = m_FreeSlots.back();
+                    m_FreeSlots.pop_back();
+                    return slot;
+                }
+
+                return m_NextSlot++;
+            }
+
+            void release(uint32_t slot)
+            {
+                std::lock_guard lockGuard(m_Mutex);
+
+                m_FreeSlots.push_back(slot);
+            }
+
+        private:
+            std::mutex m_Mutex;
+            std::vector<uint32_t> m_FreeSlots;
+            uint32_t m_NextSlot = 0;
+        };
+
+        TrackingSlotAllocator& getTextureSlotAllocator()
+        {
+            static TrackingSlotAllocator allocator;
+            return allocator;
+        }
+
+        TrackingSlotAllocator& getBufferSlotAllocator()
+        {
+            static TrackingSlotAllocator allocator;
+            return allocator;
+        }
+    }
+
+    uint32_t allocateTextureTrackingSlot()
+    {
+        return getTextureSlotAllocator().allocate();
+    }
+
+    void releaseTextureTrackingSlot(uint32_t slot)
+    {
+        getTextureSlotAllocator().release(slot);
+    }
+
+    uint32_t allocateBufferTrackingSlot()
+    {
+        return getBufferSlotAllocator().allocate();
+    }
+
+    void releaseBufferTrackingSlot(uint32_t slot)
+    {
+        getBufferSlotAllocator().release(slot);
+    }
+
     bool verifyPermanentResourceState(ResourceStates permanentState, ResourceStates requiredState, bool isTexture, const std::string& debugName, IMessageCallback* messageCallback)
     {
         if ((permanentState & requiredState) != requiredState)
@@ -43,11 +110,23 @@ namespace nvrhi
         return true;
     }
 
+    // States in which the GPU may write to a resource
+    static const ResourceStates c_WriteStates = ResourceStates::UnorderedAccess | ResourceStates::RenderTarget
+        | ResourceStates::DepthWrite | ResourceStates::StreamOut | ResourceStates::CopyDest | ResourceStates::ResolveDest
+        | ResourceStates::AccelStructWrite | ResourceStates::OpacityMicromapWrite;
+
     static uint32_t calcSubresource(MipLevel mipLevel, ArraySlice arraySlice, const TextureDesc& desc)
     {
         return mipLevel + arraySlice * desc.mipLevels;
     }
 
+    // Split barriers end separately for each subresource, so only regular transitions are merged
+    static bool canMergeTextureBarriers(const TextureBarrier& a, const TextureBarrier& b)
+    {
+        return a.split == BarrierSplit::None && b.split == BarrierSplit::None &&
+            a.stateBefore == b.stateBefore && a.stateAfter == b.stateAfter;
+    }
+
     void CommandListResourceStateTracker::setEnableUavBarriersForTexture(TextureStateExtension* texture, bool enableBarriers)
     {
         TextureState* tracking = getTextureStateTracking(texture, true);
@@ -139,6 +218,9 @@ namespace nvrhi
         if (!tracking)
             return ResourceStates::Unknown;
 
+        if (tracking->subresourceStates.empty())
+            return tracking->state;
+
         uint32_t subresource = calcSubresource(mipLevel, arraySlice, texture->descRef);
         return tracking->subresourceStates[subresource];
     }
@@ -154,6 +236,107 @@ namespace nvrhi
     }
     
     void CommandListResourceStateTracker::requireTextureState(TextureStateExtension* texture, TextureSubresourceSet subresources, ResourceStates state)
+    {
+        requireTextureStateInternal(texture, subresources, state, false);
+    }
+
+    void CommandListResourceStateTracker::requireBufferState(BufferStateExtension* buffer, ResourceStates state)
+    {
+        requireBufferStateInternal(buffer, state, false);
+    }
+
+    void CommandListResourceStateTracker::beginTextureStateTransition(TextureStateExtension* texture, TextureSubresourceSet subresources, ResourceStates state)
+    {
+        requireTextureStateInternal(texture, subresources, state, true);
+    }
+
+    void CommandListResourceStateTracker::beginBufferStateTransition(BufferStateExtension* buffer, ResourceStates state)
+    {
+        requireBufferStateInternal(buffer, state, true);
+    }
+
+    void CommandListResourceStateTracker::endSplitTransitions()
+    {
+        for (uint32_t slot : m_TrackedTextureSlots)
+        {
+            auto& entry = m_TextureStates[slot];
+            TextureStateExtension* texture = entry.resource;
+            TextureState& tracking = entry.state;
+
+            endTextureSplit(texture, true, 0, 0, tracking.state, tracking.splitStateBefore);
+
+            for (size_t subresource = 0; subresource < tracking.subresourceSplitStates.size(); subresource++)
+            {
+                const MipLevel mipLevel = MipLevel(subresource % texture->descRef.mipLevels);
+                const ArraySlice arraySlice = ArraySlice(subresource / texture->descRef.mipLevels);
+                endTextureSplit(texture, false, mipLevel, arraySlice, tracking.subresourceStates[subresource], tracking.subresourceSplitStates[subresource]);
+            }
+        }
+
+        for (uint32_t slot : m_TrackedBufferSlots)
+        {
+            auto& entry = m_BufferStates[slot];
+            endBufferSplit(entry.resource, entry.state.state, entry.state.splitStateBefore);
+        }
+    }
+
+    void CommandListResourceStateTracker::endTextureSplit(TextureStateExtension* texture, bool entireTexture, MipLevel mipLevel, ArraySlice arraySlice,
+        ResourceStates trackedState, ResourceStates& splitStateBefore)
+    {
+        if (splitStateBefore == ResourceStates::Unknown)
+            return;
+
+        // If the Begin barrier hasn't been committed yet, nothing can overlap with the transition: make it a regular barrier
+        for (TextureBarrier& barrier : m_TextureBarriers)
+        {
+            if (barrier.split == BarrierSplit::Begin && barrier.texture == texture && barrier.entireTexture == entireTexture &&
+                (entireTexture || (barrier.mipLevel == mipLevel && barrier.arraySlice == arraySlice)))
+            {
+                barrier.split = BarrierSplit::None;
+                splitStateBefore = ResourceStates::Unknown;
+                return;
+            }
+        }
+
+        TextureBarrier barrier;
+        barrier.texture = texture;
+        barrier.entireTexture = entireTexture;
+        barrier.mipLevel = mipLevel;
+        barrier.arraySlice = arraySlice;
+        barrier.stateBefore = splitStateBefore;
+        barrier.stateAfter = trackedState;
+        barrier.split = BarrierSplit::End;
+        m_TextureBarriers.push_back(barrier);
+
+        splitStateBefore = ResourceStates::Unknown;
+    }
+
+    void CommandListResourceStateTracker::endBufferSplit(BufferStateExtension* buffer, ResourceStates trackedState, ResourceStates& splitStateBefore)
+    {
+        if (splitStateBefore == ResourceStates::Unknown)
+            return;
+
+        for (BufferBarrier& barrier : m_BufferBarriers)
+        {
+            if (barrier.split == BarrierSplit::Begin && barrier.buffer == buffer)
+            {
+                barrier.split = BarrierSplit::None;
+                splitStateBefore = ResourceStates::Unknown;
+                return;
+            }
+        }
+
+        BufferBarrier barrier;
+        barrier.buffer = buffer;
+        barrier.stateBefore = splitStateBefore;
+        barrier.stateAfter = trackedState;
+        barrier.split = BarrierSplit::End;
+        m_BufferBarriers.push_back(barrier);
+
+        splitStateBefore = ResourceStates::Unknown;
+    }
+
+    void CommandListResourceStateTracker::requireTextureStateInternal(TextureStateExtension* texture, TextureSubresourceSet subresources, ResourceStates state, bool beginSplit)
     {
         if (texture->permanentState != 0)
         {
@@ -169,10 +352,15 @@ namespace nvrhi
         {
             // We're requiring state for the entire texture, and it's been tracked as entire texture too
 
+            endTextureSplit(texture, true, 0, 0, tracking->state, tracking->splitStateBefore);
+
             bool transitionNecessary = tracking->state != state;
             bool uavNecessary = ((state & ResourceStates::UnorderedAccess) != 0)
                 && (tracking->enableUavBarriers || !tracking->firstUavBarrierPlaced);
 
+            if (transitionNecessary || (state & c_WriteStates) != 0)
+                tracking->written = true;
+
             if (transitionNecessary || uavNecessary)
             {
                 TextureBarrier barrier;
@@ -180,6 +368,11 @@ namespace nvrhi
                 barrier.entireTexture = true;
                 barrier.stateBefore = tracking->state;
                 barrier.stateAfter = state;
+                if (beginSplit && transitionNecessary)
+                {
+                    barrier.split = BarrierSplit::Begin;
+                    tracking->splitStateBefore = tracking->state;
+                }
                 m_TextureBarriers.push_back(barrier);
             }
 
@@ -198,6 +391,9 @@ namespace nvrhi
             bool stateExpanded = false;
             if (tracking->subresourceStates.empty())
             {
+                // A split transition of the entire texture has to end before the subresources can be transitioned separately
+                endTextureSplit(texture, true, 0, 0, tracking->state, tracking->splitStateBefore);
+
                 if (tracking->state == ResourceStates::Unknown)
                 {
                     std::stringstream ss;
@@ -211,15 +407,24 @@ namespace nvrhi
                 tracking->state = ResourceStates::Unknown;
                 stateExpanded = true;
             }
+
+            if (tracking->subresourceSplitStates.size() != tracking->subresourceStates.size())
+                tracking->subresourceSplitStates.resize(tracking->subresourceStates.size(), ResourceStates::Unknown);
             
             bool anyUavBarrier = false;
+            const size_t firstBarrier = m_TextureBarriers.size();
 
             for (ArraySlice arraySlice = subresources.baseArraySlice; arraySlice < subresources.baseArraySlice + subresources.numArraySlices; arraySlice++)
             {
+                const size_t firstSliceBarrier = m_TextureBarriers.size();
+
                 for (MipLevel mipLevel = subresources.baseMipLevel; mipLevel < subresources.baseMipLevel + subresources.numMipLevels; mipLevel++)
                 {
                     uint32_t subresourceIndex = calcSubresource(mipLevel, arraySlice, texture->descRef);
 
+                    endTextureSplit(texture, false, mipLevel, arraySlice, tracking->subresourceStates[subresourceIndex],
+                        tracking->subresourceSplitStates[subresourceIndex]);
+
                     auto priorState = tracking->subresourceStates[subresourceIndex];
 
                     if (priorState == ResourceStates::Unknown && !stateExpanded)
@@ -236,6 +441,9 @@ namespace nvrhi
                     bool uavNecessary = ((state & ResourceStates::UnorderedAccess) != 0)
                         && !anyUavBarrier && (tracking->enableUavBarriers || !tracking->firstUavBarrierPlaced);
 
+                    if (transitionNecessary || (state & c_WriteStates) != 0)
+                        tracking->written = true;
+
                     if (transitionNecessary || uavNecessary)
                     {
                         TextureBarrier barrier;
@@ -245,7 +453,23 @@ namespace nvrhi
                         barrier.arraySlice = arraySlice;
                         barrier.stateBefore = priorState;
                         barrier.stateAfter = state;
-                        m_TextureBarriers.push_back(barrier);
+                        if (beginSplit && transitionNecessary)
+                        {
+                            barrier.split = BarrierSplit::Begin;
+                            tracking->subresourceSplitStates[subresourceIndex] = priorState;
+                        }
+
+                        // Extend the run of the previous mip level in this array slice
+                        TextureBarrier* previous = (m_TextureBarriers.size() > firstSliceBarrier) ? &m_TextureBarriers.back() : nullptr;
+                        if (previous && canMergeTextureBarriers(*previous, barrier) &&
+                            previous->mipLevel + previous->numMipLevels == mipLevel)
+                        {
+                            ++previous->numMipLevels;
+                        }
+                        else
+                        {
+                            m_TextureBarriers.push_back(barrier);
+                        }
                     }
 
                     tracking->subresourceStates[subresourceIndex] = state;
@@ -256,11 +480,45 @@ namespace nvrhi
                         tracking->firstUavBarrierPlaced = true;
                     }
                 }
+
+                // When this array slice has a single run that matches the one of the previous slice, extend that barrier
+                if (m_TextureBarriers.size() == firstSliceBarrier + 1 && firstSliceBarrier > firstBarrier)
+                {
+                    TextureBarrier& previous = m_TextureBarriers[firstSliceBarrier - 1];
+                    const TextureBarrier& current = m_TextureBarriers.back();
+
+                    if (canMergeTextureBarriers(previous, current) &&
+                        previous.mipLevel == current.mipLevel && previous.numMipLevels == current.numMipLevels &&
+                        previous.arraySlice + previous.numArraySlices == current.arraySlice)
+                    {
+                        ++previous.numArraySlices;
+                        m_TextureBarriers.pop_back();
+                    }
+                }
+            }
+
+            for (size_t index = firstBarrier; index < m_TextureBarriers.size(); index++)
+            {
+                TextureBarrier& barrier = m_TextureBarriers[index];
+                if (barrier.mipLevel == 0 && barrier.numMipLevels == texture->descRef.mipLevels &&
+                    barrier.arraySlice == 0 && barrier.numArraySlices == texture->descRef.arraySize)
+                {
+                    barrier.entireTexture = true;
+                }
+            }
+
+            // All subresources are in the same state now, go back to tracking the texture as a whole.
+            // Split transitions keep the per-subresource tracking because they end separately.
+            if (subresources.isEntireTexture(texture->descRef) && !beginSplit)
+            {
+                tracking->state = state;
+                tracking->subresourceStates.clear();
+                tracking->subresourceSplitStates.clear();
             }
         }
     }
 
-    void CommandListResourceStateTracker::requireBufferState(BufferStateExtension* buffer, ResourceStates state)
+    void CommandListResourceStateTracker::requireBufferStateInternal(BufferStateExtension* buffer, ResourceStates state, bool beginSplit)
     {
         if (buffer->descRef.isVolatile)
             return;
@@ -280,6 +538,8 @@ namespace nvrhi
 
         BufferState* tracking = getBufferStateTracking(buffer, true);
 
+        endBufferSplit(buffer, tracking->state, tracking->splitStateBefore);
+
         if (tracking->state == ResourceStates::Unknown)
         {
             std::stringstream ss;
@@ -293,14 +553,17 @@ namespace nvrhi
         bool uavNecessary = ((state & ResourceStates::UnorderedAccess) != 0)
             && (tracking->enableUavBarriers || !tracking->firstUavBarrierPlaced);
 
-        if (transitionNecessary)
+        if (transitionNecessary || (state & c_WriteStates) != 0)
+            tracking->written = true;
+
+        if (transitionNecessary && !beginSplit)
         {
             // See if this buffer is already used for a different purpose in this batch.
             // If it is, combine the state bits.
             // Example: same buffer used as index and vertex buffer, or as SRV and indirect arguments.
             for (BufferBarrier& barrier : m_BufferBarriers)
             {
-                if (barrier.buffer == buffer)
+                if (barrier.buffer == buffer && barrier.split == BarrierSplit::None)
                 {
                     barrier.stateAfter = ResourceStates(barrier.stateAfter | state);
                     tracking->state = barrier.stateAfter;
@@ -315,6 +578,11 @@ namespace nvrhi
             barrier.buffer = buffer;
             barrier.stateBefore = tracking->state;
             barrier.stateAfter = state;
+            if (beginSplit && transitionNecessary)
+            {
+                barrier.split = BarrierSplit::Begin;
+                tracking->splitStateBefore = tracking->state;
+            }
             m_BufferBarriers.push_back(barrier);
         }
 
@@ -328,12 +596,15 @@ namespace nvrhi
 
     void CommandListResourceStateTracker::keepBufferInitialStates()
     {
-        for (auto& [buffer, tracking] : m_BufferStates)
+        for (uint32_t slot : m_TrackedBufferSlots)
         {
+            const auto& entry = m_BufferStates[slot];
+            BufferStateExtension* buffer = entry.resource;
+
             if (buffer->descRef.keepInitialState && 
                 !buffer->permanentState &&
                 !buffer->descRef.isVolatile &&
-                !tracking->permanentTransition)
+                !entry.state.permanentTransition)
             {
                 requireBufferState(buffer, buffer->descRef.initialState);
             }
@@ -342,11 +613,14 @@ namespace nvrhi
 
     void CommandListResourceStateTracker::keepTextureInitialStates()
     {
-        for (auto& [texture, tracking] : m_TextureStates)
+        for (uint32_t slot : m_TrackedTextureSlots)
         {
+            const auto& entry = m_TextureStates[slot];
+            TextureStateExtension* texture = entry.resource;
+
             if (texture->descRef.keepInitialState && 
                 !texture->permanentState && 
-                !tracking->permanentTransition)
+                !entry.state.permanentTransition)
             {
                 requireTextureState(texture, AllSubresources, texture->descRef.initialState);
             }
@@ -385,32 +659,143 @@ namespace nvrhi
         }
         m_PermanentBufferStates.clear();
 
-        for (const auto& [texture, stateTracking] : m_TextureStates)
+        for (uint32_t slot : m_TrackedTextureSlots)
         {
+            TextureStateExtension* texture = m_TextureStates[slot].resource;
             if (texture->descRef.keepInitialState && !texture->stateInitialized)
                 texture->stateInitialized = true;
         }
 
-        m_TextureStates.clear();
-        m_BufferStates.clear();
+        // Invalidate all entries at once, their storage is kept for the next use of the command list
+        ++m_Generation;
+        m_TrackedTextureSlots.clear();
+        m_TrackedBufferSlots.clear();
+    }
+
+    template<typename TResource>
+    static void collectResourceQueueDependencies(const TResource* resource, bool written, CommandQueue queue, uint64_t* waitInstances)
+    {
+        const ResourceQueueUsage& usage = resource->queueUsage;
+
+        for (uint32_t otherQueue = 0; otherQueue < uint32_t(CommandQueue::Count); otherQueue++)
+        {
+            if (otherQueue == uint32_t(queue))
+                continue;
+
+            const uint64_t instance = written ? usage.lastAccessInstances[otherQueue] : usage.lastWriteInstances[otherQueue];
+            waitInstances[otherQueue] = std::max(waitInstances[otherQueue], instance);
+        }
+    }
+
+    template<typename TResource>
+    static void recordResourceQueueUsage(TResource* resource, bool written, CommandQueue queue, uint64_t instance)
+    {
+        ResourceQueueUsage& usage = resource->queueUsage;
+
+        usage.lastAccessInstances[uint32_t(queue)] = instance;
+        if (written)
+            usage.lastWriteInstances[uint32_t(queue)] = instance;
+    }
+
+    void CommandListResourceStateTracker::collectQueueDependencies(CommandQueue queue, uint64_t* waitInstances, bool accelStructsOnly) const
+    {
+        if (!accelStructsOnly)
+        {
+            for (uint32_t slot : m_TrackedTextureSlots)
+            {
+                const auto& entry = m_TextureStates[slot];
+                collectResourceQueueDependencies(entry.resource, entry.state.written, queue, waitInstances);
+            }
+        }
+
+        for (uint32_t slot : m_TrackedBufferSlots)
+        {
+            const auto& entry = m_BufferStates[slot];
+            if (accelStructsOnly && !entry.resource->descRef.isAccelStructStorage)
+                continue;
+
+            collectResourceQueueDependencies(entry.resource, entry.state.written, queue, waitInstances);
+        }
+    }
+
+    void CommandListResourceStateTracker::recordQueueUsage(CommandQueue queue, uint64_t instance, bool accelStructsOnly) const
+    {
+        if (!accelStructsOnly)
+        {
+            for (uint32_t slot : m_TrackedTextureSlots)
+            {
+                const auto& entry = m_TextureStates[slot];
+                recordResourceQueueUsage(entry.resource, entry.state.written, queue, instance);
+            }
+        }
+
+        for (uint32_t slot : m_TrackedBufferSlots)
+        {
+            const auto& entry = m_BufferStates[slot];
+            if (accelStructsOnly && !entry.resource->descRef.isAccelStructStorage)
+                continue;
+
+            recordResourceQueueUsage(entry.resource, entry.state.written, queue, instance);
+        }
+    }
+
+    void QueueSynchronizer::filterWaits(CommandQueue queue, uint64_t* waitInstances)
+    {
+        uint64_t* knownWaits = m_KnownWaits[uint32_t(queue)];
+
+        for (uint32_t otherQueue = 0; otherQueue < uint32_t(CommandQueue::Count); otherQueue++)
+        {
+            if (otherQueue == uint32_t(queue) || waitInstances[otherQueue] <= knownWaits[otherQueue])
+            {
+                waitInstances[otherQueue] = 0;
+                continue;
+            }
+
+            knownWaits[otherQueue] = waitInstances[otherQueue];
+        }
+    }
+
+    void QueueSynchronizer::waitAdded(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance)
+    {
+        uint64_t& knownWait = m_KnownWaits[uint32_t(waitQueue)][uint32_t(executionQueue)];
+        knownWait = std::max(knownWait, instance);
     }
 
     TextureState* CommandListResourceStateTracker::getTextureStateTracking(TextureStateExtension* texture, bool allowCreate)
     {
-        auto it = m_TextureStates.find(texture);
+        const uint32_t slot = texture->trackingSlot;
 
-        if (it != m_TextureStates.end())
+        if (slot < m_TextureStates.size())
         {
-            return it->second.get();
+            auto& entry = m_TextureStates[slot];
+
+            // The slot may have been reused by a different texture since it was last written, check the owner too
+            if (entry.generation == m_Generation && entry.resource == texture)
+                return &entry.state;
         }
 
         if (!allowCreate)
             return nullptr;
-        
-        std::unique_ptr<TextureState> trackingRef = std::make_unique<TextureState>();
 
-        TextureState* tracking = trackingRef.get();
-        m_TextureStates.insert(std::make_pair(texture, std::move(trackingRef)));
+        if (slot >= m_TextureStates.size())
+            m_TextureStates.resize(slot + 1);
+
+        auto& entry = m_TextureStates[slot];
+        if (entry.generation != m_Generation)
+            m_TrackedTextureSlots.push_back(slot);
+
+        entry.resource = texture;
+        entry.generation = m_Generation;
+
+        TextureState* tracking = &entry.state;
+        tracking->subresourceStates.clear();
+        tracking->subresourceSplitStates.clear();
+        tracking->state = ResourceStates::Unknown;
+        tracking->splitStateBefore = ResourceStates::Unknown;
+        tracking->enableUavBarriers = true;
+        tracking->firstUavBarrierPlaced = false;
+        tracking->permanentTransition = false;
+        tracking->written = false;
         
         if (texture->descRef.keepInitialState)
         {
@@ -422,20 +807,32 @@ namespace nvrhi
 
     BufferState* CommandListResourceStateTracker::getBufferStateTracking(BufferStateExtension* buffer, bool allowCreate)
     {
-        auto it = m_BufferStates.find(buffer);
+        const uint32_t slot = buffer->trackingSlot;
 
-        if (it != m_BufferStates.end())
+        if (slot < m_BufferStates.size())
         {
-            return it->second.get();
+            auto& entry = m_BufferStates[slot];
+
+            // The slot may have been reused by a different buffer since it was last written, check the owner too
+            if (entry.generation == m_Generation && entry.resource == buffer)
+                return &entry.state;
         }
 
         if (!allowCreate)
             return nullptr;
 
-        std::unique_ptr<BufferState> trackingRef = std::make_unique<BufferState>();
+        if (slot >= m_BufferStates.size())
+            m_BufferStates.resize(slot + 1);
+
+        auto& entry = m_BufferStates[slot];
+        if (entry.generation != m_Generation)
+            m_TrackedBufferSlots.push_back(slot);
 
-        BufferState* tracking = trackingRef.get();
-        m_BufferStates.insert(std::make_pair(buffer, std::move(trackingRef)));
+        entry.resource = buffer;
+        entry.generation = m_Generation;
+
+        BufferState* tracking = &entry.state;
+        *tracking = BufferState();
                                                    
         if (buffer->descRef.keepInitialState)
         {
@@ -444,4 +841,66 @@ namespace nvrhi
 
         return tracking;
     }
+
+    bool BundleResourceStates::mergeStates(ResourceStates& existing, ResourceStates required, const std::string& debugName, bool isTexture) const
+    {
+        const ResourceStates merged = existing | required;
+
+        // Read-only states can be combined, but a resource that is written by the bundle needs barriers between uses
+        if (merged != existing && (merged & ResourceStates::UnorderedAccess) != 0 && merged != ResourceStates::UnorderedAccess)
+        {
+            std::stringstream ss;
+            ss << "The " << (isTexture ? "texture " : "buffer ") << utils::DebugNameToString(debugName)
+                << " is used in a bundle with incompatible states 0x" << std::hex << uint32_t(existing)
+                << " and 0x" << std::hex << uint32_t(required) << ". Bundles cannot contain barriers.";
+            m_MessageCallback->message(MessageSeverity::Error, ss.str().c_str());
+            return false;
+        }
+
+        existing = merged;
+        return true;
+    }
+
+    void BundleResourceStates::requireTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates state)
+    {
+        for (TextureRequirement& requirement : m_TextureRequirements)
+        {
+            if (requirement.texture == texture && requirement.subresources == subresources)
+            {
+                mergeStates(requirement.state, state, texture->getDesc().debugName, true);
+                return;
+            }
+        }
+
+        m_TextureRequirements.push_back(TextureRequirement{ texture, subresources, state });
+    }
+
+    void BundleResourceStates::requireBufferState(IBuffer* buffer, ResourceStates state)
+    {
+        const auto it = m_BufferIndices.find(buffer);
+        if (it != m_BufferIndices.end())
+        {
+            mergeStates(m_BufferRequirements[it->second].state, state, buffer->getDesc().debugName, false);
+            return;
+        }
+
+        m_BufferIndices[buffer] = m_BufferRequirements.size();
+        m_BufferRequirements.push_back(BufferRequirement{ buffer, state });
+    }
+
+    void BundleResourceStates::merge(const BundleResourceStates& other)
+    {
+        for (const TextureRequirement& requirement : other.m_TextureRequirements)
+            requireTextureState(requirement.texture, requirement.subresources, requirement.state);
+
+        for (const BufferRequirement& requirement : other.m_BufferRequirements)
+            requireBufferState(requirement.buffer, requirement.state);
+    }
+
+    void BundleResourceStates::clear()
+    {
+        m_TextureRequirements.clear();
+        m_BufferRequirements.clear();
+        m_BufferIndices.clear();
+    }
 } // namespace nvrhi
\ No newline at end of file
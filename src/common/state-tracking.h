@@ -28,14 +28,40 @@
 
 namespace nvrhi
 {
+    // Small integer indices that identify resources in the dense state arrays of CommandListResourceStateTracker.
+    // Indices of destroyed resources are reused, so the arrays only grow to the maximum number of live resources.
+    uint32_t allocateTextureTrackingSlot();
+    void releaseTextureTrackingSlot(uint32_t slot);
+    uint32_t allocateBufferTrackingSlot();
+    void releaseBufferTrackingSlot(uint32_t slot);
+
+    // Latest submissions that accessed a resource on each queue, recorded at executeCommandLists
+    // when automatic queue synchronization is enabled, see QueueSynchronizer
+    struct ResourceQueueUsage
+    {
+        uint64_t lastWriteInstances[uint32_t(CommandQueue::Count)] = {};
+        uint64_t lastAccessInstances[uint32_t(CommandQueue::Count)] = {};
+    };
+
     struct BufferStateExtension
     {
         const BufferDesc& descRef;
         ResourceStates permanentState = ResourceStates::Unknown;
+        ResourceQueueUsage queueUsage;
+        const uint32_t trackingSlot;
 
         explicit BufferStateExtension(const BufferDesc& desc)
             : descRef(desc)
+            , trackingSlot(allocateBufferTrackingSlot())
         { }
+
+        ~BufferStateExtension()
+        {
+            releaseBufferTrackingSlot(trackingSlot);
+        }
+
+        BufferStateExtension(const BufferStateExtension&) = delete;
+        BufferStateExtension& operator=(const BufferStateExtension&) = delete;
     };
 
     struct TextureStateExtension
@@ -43,37 +69,74 @@ namespace nvrhi
         const TextureDesc& descRef;
         ResourceStates permanentState = ResourceStates::Unknown;
         bool stateInitialized = false;
+        ResourceQueueUsage queueUsage;
+        const uint32_t trackingSlot;
 
         explicit TextureStateExtension(const TextureDesc& desc)
             : descRef(desc)
+            , trackingSlot(allocateTextureTrackingSlot())
         { }
+
+        ~TextureStateExtension()
+        {
+            releaseTextureTrackingSlot(trackingSlot);
+        }
+
+        TextureStateExtension(const TextureStateExtension&) = delete;
+        TextureStateExtension& operator=(const TextureStateExtension&) = delete;
+    };
+
+    // Identifies the halves of a split barrier: the transition starts at the Begin barrier and completes at the End barrier,
+    // so the GPU can overlap it with the work recorded in between.
+    enum class BarrierSplit : uint8_t
+    {
+        None,
+        Begin,
+        End
     };
 
+    // A texture is tracked with a single state while all of its subresources are in that state. Once a subset is
+    // transitioned, subresourceStates holds one state per subresource, until a transition of the entire texture
+    // brings all of them back into one state.
     struct TextureState
     {
         std::vector<ResourceStates> subresourceStates;
+        // Prior states of split transitions that have begun but not ended, Unknown where there is none
+        std::vector<ResourceStates> subresourceSplitStates;
         ResourceStates state = ResourceStates::Unknown;
+        ResourceStates splitStateBefore = ResourceStates::Unknown;
         bool enableUavBarriers = true;
         bool firstUavBarrierPlaced = false;
         bool permanentTransition = false;
+        // The command list writes the texture or changes its state
+        bool written = false;
     };
 
     struct BufferState
     {
         ResourceStates state = ResourceStates::Unknown;
+        ResourceStates splitStateBefore = ResourceStates::Unknown;
         bool enableUavBarriers = true;
         bool firstUavBarrierPlaced = false;
         bool permanentTransition = false;
+        // The command list writes the buffer or changes its state
+        bool written = false;
     };
 
+    // Unless entireTexture is set, the barrier covers numMipLevels x numArraySlices subresources starting at
+    // (mipLevel, arraySlice). Transitions of neighboring subresources between the same states are merged into
+    // one barrier, except for split barriers, which always cover a single subresource.
     struct TextureBarrier
     {
         TextureStateExtension* texture = nullptr;
         MipLevel mipLevel = 0;
+        MipLevel numMipLevels = 1;
         ArraySlice arraySlice = 0;
+        ArraySlice numArraySlices = 1;
         bool entireTexture = false;
         ResourceStates stateBefore = ResourceStates::Unknown;
         ResourceStates stateAfter = ResourceStates::Unknown;
+        BarrierSplit split = BarrierSplit::None;
     };
 
     struct BufferBarrier
@@ -81,6 +144,7 @@ namespace nvrhi
         BufferStateExtension* buffer = nullptr;
         ResourceStates stateBefore = ResourceStates::Unknown;
         ResourceStates stateAfter = ResourceStates::Unknown;
+        BarrierSplit split = BarrierSplit::None;
     };
 
     class CommandListResourceStateTracker
@@ -109,10 +173,24 @@ namespace nvrhi
         void requireTextureState(TextureStateExtension* texture, TextureSubresourceSet subresources, ResourceStates state);
         void requireBufferState(BufferStateExtension* buffer, ResourceStates state);
 
+        // Like requireTexture/BufferState, but the transitions are emitted as the Begin halves of split barriers.
+        // The matching End barriers are added by the next requirement on the same resource or by endSplitTransitions.
+        void beginTextureStateTransition(TextureStateExtension* texture, TextureSubresourceSet subresources, ResourceStates state);
+        void beginBufferStateTransition(BufferStateExtension* buffer, ResourceStates state);
+        void endSplitTransitions();
+
         void keepBufferInitialStates();
         void keepTextureInitialStates();
         void commandListSubmitted();
 
+        // Cross-queue synchronization interface, see QueueSynchronizer.
+        // Only the resources that go through the automatic state tracking are seen here.
+        // With accelStructsOnly, only the acceleration structure and micromap storage buffers are considered:
+        // the devices synchronize those even when automatic queue synchronization is disabled.
+
+        void collectQueueDependencies(CommandQueue queue, uint64_t* waitInstances, bool accelStructsOnly = false) const;
+        void recordQueueUsage(CommandQueue queue, uint64_t instance, bool accelStructsOnly = false) const;
+
         [[nodiscard]] const std::vector<TextureBarrier>& getTextureBarriers() const { return m_TextureBarriers; }
         [[nodiscard]] const std::vector<BufferBarrier>& getBufferBarriers() const { return m_BufferBarriers; }
         void clearBarriers() { m_TextureBarriers.clear(); m_BufferBarriers.clear(); }
@@ -120,8 +198,25 @@ namespace nvrhi
     private:
         IMessageCallback* m_MessageCallback;
 
-        std::unordered_map<TextureStateExtension*, std::unique_ptr<TextureState>> m_TextureStates;
-        std::unordered_map<BufferStateExtension*, std::unique_ptr<BufferState>> m_BufferStates;
+        // Per-resource states are stored in dense arrays indexed by the resource's trackingSlot.
+        // An entry is valid only if its generation matches m_Generation, so resetting the tracker after submission
+        // is a counter increment, and the entries (including their subresource state vectors) are reused.
+        template<typename TResource, typename TState>
+        struct TrackingEntry
+        {
+            TResource* resource = nullptr;
+            uint64_t generation = 0;
+            TState state;
+        };
+
+        std::vector<TrackingEntry<TextureStateExtension, TextureState>> m_TextureStates;
+        std::vector<TrackingEntry<BufferStateExtension, BufferState>> m_BufferStates;
+
+        // Slots that are valid in the current generation, for iteration over all tracked resources
+        std::vector<uint32_t> m_TrackedTextureSlots;
+        std::vector<uint32_t> m_TrackedBufferSlots;
+
+        uint64_t m_Generation = 1;
 
         // Deferred transitions of textures and buffers to permanent states.
         // They are executed only when the command list is executed, not when the app calls setPermanentTextureState or setPermanentBufferState.
@@ -133,6 +228,70 @@ namespace nvrhi
 
         TextureState* getTextureStateTracking(TextureStateExtension* texture, bool allowCreate);
         BufferState* getBufferStateTracking(BufferStateExtension* buffer, bool allowCreate);
+
+        void requireTextureStateInternal(TextureStateExtension* texture, TextureSubresourceSet subresources, ResourceStates state, bool beginSplit);
+        void requireBufferStateInternal(BufferStateExtension* buffer, ResourceStates state, bool beginSplit);
+        void endTextureSplit(TextureStateExtension* texture, bool entireTexture, MipLevel mipLevel, ArraySlice arraySlice, ResourceStates trackedState, ResourceStates& splitStateBefore);
+        void endBufferSplit(BufferStateExtension* buffer, ResourceStates trackedState, ResourceStates& splitStateBefore);
+    };
+
+    // Collects the resource states required by a bundle command list while it is being recorded.
+    // Bundles cannot contain barriers, so the command list that executes the bundle replays these requirements
+    // into its own state tracker instead. Repeated requirements for the same resource are merged into one.
+    class BundleResourceStates
+    {
+    public:
+        struct TextureRequirement
+        {
+            ITexture* texture = nullptr;
+            TextureSubresourceSet subresources;
+            ResourceStates state = ResourceStates::Unknown;
+        };
+
+        struct BufferRequirement
+        {
+            IBuffer* buffer = nullptr;
+            ResourceStates state = ResourceStates::Unknown;
+        };
+
+        explicit BundleResourceStates(IMessageCallback* messageCallback)
+            : m_MessageCallback(messageCallback)
+        { }
+
+        void requireTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates state);
+        void requireBufferState(IBuffer* buffer, ResourceStates state);
+        void merge(const BundleResourceStates& other);
+        void clear();
+
+        [[nodiscard]] const std::vector<TextureRequirement>& getTextureRequirements() const { return m_TextureRequirements; }
+        [[nodiscard]] const std::vector<BufferRequirement>& getBufferRequirements() const { return m_BufferRequirements; }
+
+    private:
+        IMessageCallback* m_MessageCallback;
+
+        std::vector<TextureRequirement> m_TextureRequirements;
+        std::vector<BufferRequirement> m_BufferRequirements;
+        std::unordered_map<IBuffer*, size_t> m_BufferIndices;
+
+        bool mergeStates(ResourceStates& existing, ResourceStates required, const std::string& debugName, bool isTexture) const;
+    };
+
+    // Derives the cross-queue waits for a submission from the resources used by its command lists:
+    // an access waits for the latest writes on the other queues, and a write also waits for their latest accesses.
+    // The instances that each queue already waits for are remembered, so that a dependency produces a single wait.
+    // Not thread-safe, the device serializes the submissions that use it.
+    class QueueSynchronizer
+    {
+    public:
+        // Removes the entries of waitInstances[CommandQueue::Count] that 'queue' already waits for
+        // and remembers the remaining ones, which the caller must turn into queue waits
+        void filterWaits(CommandQueue queue, uint64_t* waitInstances);
+
+        // Records a wait that was added by other means, such as queueWaitForCommandList
+        void waitAdded(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance);
+
+    private:
+        uint64_t m_KnownWaits[uint32_t(CommandQueue::Count)][uint32_t(CommandQueue::Count)] = {};
     };
 
     bool verifyPermanentResourceState(ResourceStates permanentState, ResourceStates requiredState, bool isTexture, const std::string& debugName, IMessageCallback* messageCallback);
@@ -0,0 +1,361 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <nvrhi/nvrhi.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace nvrhi
+{
+    class TextureStreamer : public RefCounter<ITextureStreamer>
+    {
+    public:
+        TextureStreamer(IDevice* device, const TextureStreamerDesc& desc)
+            : m_Device(device)
+            , m_Desc(desc)
+        {
+            m_Desc.maxBatchesInFlight = std::max(m_Desc.maxBatchesInFlight, 1u);
+        }
+
+        ~TextureStreamer() override
+        {
+            flush();
+        }
+
+        TextureStreamingTicket enqueue(const TextureStreamingRequest& request) override;
+        void update() override;
+        void flush() override;
+        bool isComplete(TextureStreamingTicket ticket) override;
+        bool acquireTexture(ITexture* texture) override;
+
+    private:
+        struct PendingRequest
+        {
+            TextureHandle texture;
+            std::function<void(ITexture*)> onComplete;
+        };
+
+        struct Batch
+        {
+            CommandListHandle commandList;
+            EventQueryHandle query;
+            TextureStreamingTicket ticket = 0;
+            uint64_t instance = 0;
+            size_t size = 0;
+            std::vector<PendingRequest> requests;
+        };
+
+        typedef std::vector<std::function<void()>> CallbackList;
+
+        DeviceHandle m_Device;
+        TextureStreamerDesc m_Desc;
+        std::mutex m_Mutex;
+
+        std::unique_ptr<Batch> m_CurrentBatch;
+        std::deque<std::unique_ptr<Batch>> m_SubmittedBatches;
+        std::vector<std::unique_ptr<Batch>> m_FreeBatches;
+
+        // Ticket of the batch with the last upload to each texture that hasn't been acquired yet.
+        std::unordered_map<ITexture*, TextureStreamingTicket> m_PendingTextures;
+
+        // Callbacks of the retired batches, to be called outside of the lock.
+        CallbackList m_ReadyCallbacks;
+
+        TextureStreamingTicket m_NextTicket = 1;
+        TextureStreamingTicket m_LastCompletedTicket = 0;
+        uint64_t m_LastConsumerWaitInstance = 0;
+
+        bool beginBatch();
+        void submitCurrentBatch();
+        void retireBatch(std::unique_ptr<Batch> batch);
+        void retireCompletedBatches(bool wait);
+        void runCallbacks();
+        static size_t getSubresourceSize(const TextureDesc& desc, const TextureStreamingSubresource& subresource);
+    };
+
+    size_t TextureStreamer::getSubresourceSize(const TextureDesc& desc, const TextureStreamingSubresource& subresource)
+    {
+        const FormatInfo& formatInfo = getFormatInfo(desc.format);
+        const uint32_t blockSize = std::max<uint32_t>(formatInfo.blockSize, 1);
+        const uint32_t mipHeight = std::max(desc.height >> subresource.mipLevel, 1u);
+        const uint32_t mipDepth = std::max(desc.depth >> subresource.mipLevel, 1u);
+        const uint32_t numRows = (mipHeight + blockSize - 1) / blockSize;
+
+        if (desc.dimension == TextureDimension::Texture3D)
+            return subresource.depthPitch * mipDepth;
+
+        return subresource.rowPitch * numRows;
+    }
+
+    bool TextureStreamer::beginBatch()
+    {
+        std::unique_ptr<Batch> batch;
+        if (!m_FreeBatches.empty())
+        {
+            batch = std::move(m_FreeBatches.back());
+            m_FreeBatches.pop_back();
+        }
+        else
+        {
+            batch = std::make_unique<Batch>();
+
+            batch->commandList = m_Device->createCommandList(CommandListParameters()
+                .setQueueType(m_Desc.uploadQueue)
+                .setUploadChunkSize(m_Desc.maxBatchSize));
+
+            batch->query = m_Device->createEventQuery();
+
+            if (!batch->commandList || !batch->query)
+                return false;
+        }
+
+        batch->ticket = m_NextTicket++;
+        batch->size = 0;
+        batch->commandList->open();
+
+        m_CurrentBatch = std::move(batch);
+        return true;
+    }
+
+    void TextureStreamer::submitCurrentBatch()
+    {
+        if (!m_CurrentBatch)
+            return;
+
+        // Limit the number of batches in flight by waiting for the oldest one to finish.
+        // Its callbacks run on the next update() or flush().
+        if (m_SubmittedBatches.size() >= m_Desc.maxBatchesInFlight)
+        {
+            m_Device->waitEventQuery(m_SubmittedBatches.front()->query);
+            retireCompletedBatches(false);
+        }
+
+        m_CurrentBatch->commandList->close();
+
+        ICommandList* commandList = m_CurrentBatch->commandList;
+        m_CurrentBatch->instance = m_Device->executeCommandLists(&commandList, 1, m_Desc.uploadQueue);
+
+        m_Device->resetEventQuery(m_CurrentBatch->query);
+        m_Device->setEventQuery(m_CurrentBatch->query, m_Desc.uploadQueue);
+
+        m_SubmittedBatches.push_back(std::move(m_CurrentBatch));
+    }
+
+    void TextureStreamer::retireBatch(std::unique_ptr<Batch> batch)
+    {
+        m_LastCompletedTicket = batch->ticket;
+
+        for (PendingRequest& request : batch->requests)
+        {
+            auto pendingTexture = m_PendingTextures.find(request.texture.Get());
+            if (pendingTexture != m_PendingTextures.end() && pendingTexture->second <= batch->ticket)
+                m_PendingTextures.erase(pendingTexture);
+
+            if (request.onComplete)
+            {
+                m_ReadyCallbacks.push_back([callback = std::move(request.onComplete), texture = std::move(request.texture)]()
+                {
+                    callback(texture);
+                });
+            }
+        }
+
+        batch->requests.clear();
+        m_FreeBatches.push_back(std::move(batch));
+    }
+
+    void TextureStreamer::retireCompletedBatches(bool wait)
+    {
+        // Batches are executed on the same queue in submission order, so they complete in that order too.
+        while (!m_SubmittedBatches.empty())
+        {
+            Batch& oldest = *m_SubmittedBatches.front();
+
+            if (wait)
+                m_Device->waitEventQuery(oldest.query);
+            else if (!m_Device->pollEventQuery(oldest.query))
+                break;
+
+            std::unique_ptr<Batch> batch = std::move(m_SubmittedBatches.front());
+            m_SubmittedBatches.pop_front();
+            retireBatch(std::move(batch));
+        }
+    }
+
+    TextureStreamingTicket TextureStreamer::enqueue(const TextureStreamingRequest& request)
+    {
+        if (!request.texture || request.subresources.empty())
+            return 0;
+
+        const TextureDesc& textureDesc = request.texture->getDesc();
+
+        size_t requestSize = 0;
+        for (const TextureStreamingSubresource& subresource : request.subresources)
+        {
+            if (!subresource.data || subresource.mipLevel >= textureDesc.mipLevels || subresource.arraySlice >= textureDesc.arraySize)
+                return 0;
+
+            requestSize += getSubresourceSize(textureDesc, subresource);
+        }
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        // Start a new batch if this request doesn't fit into the current one, unless the current one is empty.
+        if (m_CurrentBatch && m_CurrentBatch->size != 0 && m_CurrentBatch->size + requestSize > m_Desc.maxBatchSize)
+            submitCurrentBatch();
+
+        if (!m_CurrentBatch && !beginBatch())
+            return 0;
+
+        Batch& batch = *m_CurrentBatch;
+
+        std::vector<TextureUploadRegion> regions;
+        regions.reserve(request.subresources.size());
+        for (const TextureStreamingSubresource& subresource : request.subresources)
+        {
+            regions.push_back(TextureUploadRegion()
+                .setMipLevel(subresource.mipLevel)
+                .setArraySlice(subresource.arraySlice)
+                .setData(subresource.data)
+                .setRowPitch(subresource.rowPitch)
+                .setDepthPitch(subresource.depthPitch));
+        }
+
+        batch.commandList->writeTextureRegions(request.texture, regions.data(), regions.size());
+
+        batch.size += requestSize;
+        batch.requests.push_back(PendingRequest{ request.texture, request.onComplete });
+        m_PendingTextures[request.texture] = batch.ticket;
+
+        const TextureStreamingTicket ticket = batch.ticket;
+
+        // The D3D11 command lists map to the immediate context, and only one of them can be open at a time.
+        // Don't keep the batch open between calls there.
+        if (m_Device->getGraphicsAPI() == GraphicsAPI::D3D11)
+            submitCurrentBatch();
+
+        return ticket;
+    }
+
+    void TextureStreamer::runCallbacks()
+    {
+        CallbackList callbacks;
+
+        {
+            std::lock_guard lockGuard(m_Mutex);
+            callbacks.swap(m_ReadyCallbacks);
+        }
+
+        // The callbacks are called outside of the lock so that they can enqueue more work.
+        for (const auto& callback : callbacks)
+            callback();
+    }
+
+    void TextureStreamer::update()
+    {
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            submitCurrentBatch();
+            retireCompletedBatches(false);
+        }
+
+        runCallbacks();
+    }
+
+    void TextureStreamer::flush()
+    {
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            submitCurrentBatch();
+            retireCompletedBatches(true);
+        }
+
+        runCallbacks();
+    }
+
+    bool TextureStreamer::isComplete(TextureStreamingTicket ticket)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (ticket <= m_LastCompletedTicket)
+            return true;
+
+        // The batch may be finished on the GPU without being retired yet.
+        for (const auto& batch : m_SubmittedBatches)
+        {
+            if (batch->ticket == ticket)
+                return m_Device->pollEventQuery(batch->query);
+        }
+
+        return false;
+    }
+
+    bool TextureStreamer::acquireTexture(ITexture* texture)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        auto pendingTexture = m_PendingTextures.find(texture);
+        if (pendingTexture == m_PendingTextures.end())
+            return false;
+
+        const TextureStreamingTicket ticket = pendingTexture->second;
+        m_PendingTextures.erase(pendingTexture);
+
+        if (m_CurrentBatch && m_CurrentBatch->ticket == ticket)
+            submitCurrentBatch();
+
+        for (const auto& batch : m_SubmittedBatches)
+        {
+            if (batch->ticket != ticket)
+                continue;
+
+            // Waiting for an instance also covers all earlier instances on the same queue.
+            if (batch->instance > m_LastConsumerWaitInstance && m_Desc.uploadQueue != m_Desc.consumerQueue)
+            {
+                m_Device->queueWaitForCommandList(m_Desc.consumerQueue, m_Desc.uploadQueue, batch->instance);
+                m_LastConsumerWaitInstance = batch->instance;
+            }
+            break;
+        }
+
+        return true;
+    }
+
+    TextureStreamerHandle IDevice::createTextureStreamer(const TextureStreamerDesc& desc)
+    {
+        if (desc.uploadQueue == CommandQueue::Copy && !queryFeatureSupport(Feature::CopyQueue))
+            return nullptr;
+
+        if (desc.uploadQueue == CommandQueue::Compute && !queryFeatureSupport(Feature::ComputeQueue))
+            return nullptr;
+
+        return TextureStreamerHandle::Create(new TextureStreamer(this, desc));
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,275 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <nvrhi/nvrhi.h>
+#include <nvrhi/common/misc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace nvrhi
+{
+    // Tracks of the GPU queues follow the CPU threads, whose tracks are numbered from 1
+    static constexpr uint32_t c_GpuTrackBase = 1000000;
+
+    static uint32_t getCurrentThreadTrack()
+    {
+        static std::atomic<uint32_t> nextTrack = 1;
+        thread_local uint32_t track = nextTrack++;
+        return track;
+    }
+
+    template<size_t N>
+    static void copyString(char (&dest)[N], const char* source)
+    {
+        if (!source)
+        {
+            dest[0] = 0;
+            return;
+        }
+
+        strncpy(dest, source, N - 1);
+        dest[N - 1] = 0;
+    }
+
+    static void writeJsonString(FILE* file, const char* s)
+    {
+        fputc('"', file);
+        for (; *s; ++s)
+        {
+            const char c = *s;
+            if (c == '"' || c == '\\')
+                fputc('\\', file);
+
+            // Control characters are not valid in JSON strings
+            fputc(uint8_t(c) < 0x20 ? ' ' : c, file);
+        }
+        fputc('"', file);
+    }
+
+    double getTraceClockSeconds()
+    {
+        // steady_clock is QueryPerformanceCounter with MSVC and CLOCK_MONOTONIC with libstdc++ and libc++
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    class TraceRecorder : public RefCounter<ITraceRecorder>
+    {
+    public:
+        TraceRecorder(const TraceRecorderDesc& desc, FILE* file)
+            : m_Desc(desc)
+            , m_File(file)
+            , m_OriginSeconds(getTraceClockSeconds())
+        {
+            // Both buffers are allocated upfront so that recording never allocates
+            m_Events.reserve(m_Desc.maxBufferedEvents);
+            m_FlushEvents.reserve(m_Desc.maxBufferedEvents);
+
+            fputs("{\"traceEvents\":[\n", m_File);
+            fputs("{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"NVRHI\"}}", m_File);
+        }
+
+        ~TraceRecorder() override
+        {
+            flush();
+
+            fputs("\n],\"displayTimeUnit\":\"ms\"}\n", m_File);
+            fclose(m_File);
+        }
+
+        void recordCpuEvent(const char* name, const char* category, double beginSeconds, double endSeconds,
+            const char* argName, uint64_t argValue) override;
+        bool recordGpuFrame(const GpuProfilerFrameResults& results, CommandQueue queue) override;
+        bool flush() override;
+        uint64_t getNumDroppedEvents() override { return m_NumDroppedEvents.load(); }
+
+    private:
+        struct Event
+        {
+            char name[64];
+            char category[24];
+            char argName[24];
+            double beginSeconds;
+            double endSeconds;
+            uint64_t argValue;
+            uint32_t track;
+        };
+
+        void writeTrackName(uint32_t track);
+        void writeEvent(const Event& event);
+
+        TraceRecorderDesc m_Desc;
+
+        // Protects m_Events
+        std::mutex m_Mutex;
+        std::vector<Event> m_Events;
+        std::atomic<uint64_t> m_NumDroppedEvents = 0;
+
+        // Protects the file and the members used to write it
+        std::mutex m_FileMutex;
+        FILE* m_File;
+        std::vector<Event> m_FlushEvents;
+        std::unordered_set<uint32_t> m_NamedTracks;
+        double m_OriginSeconds;
+        bool m_WriteFailed = false;
+    };
+
+    void TraceRecorder::recordCpuEvent(const char* name, const char* category, double beginSeconds, double endSeconds,
+        const char* argName, uint64_t argValue)
+    {
+        Event event;
+        copyString(event.name, name);
+        copyString(event.category, category);
+        copyString(event.argName, argName);
+        event.beginSeconds = beginSeconds;
+        event.endSeconds = endSeconds;
+        event.argValue = argValue;
+        event.track = getCurrentThreadTrack();
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (m_Events.size() >= m_Desc.maxBufferedEvents)
+        {
+            ++m_NumDroppedEvents;
+            return;
+        }
+
+        m_Events.push_back(event);
+    }
+
+    bool TraceRecorder::recordGpuFrame(const GpuProfilerFrameResults& results, CommandQueue queue)
+    {
+        if (!results.hasCpuTime)
+            return false;
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (m_Events.size() + results.scopes.size() > m_Desc.maxBufferedEvents)
+        {
+            m_NumDroppedEvents += results.scopes.size();
+            return false;
+        }
+
+        for (const GpuProfilerScope& scope : results.scopes)
+        {
+            Event event;
+            copyString(event.name, scope.name.c_str());
+            copyString(event.category, "GPU");
+            copyString(event.argName, "depth");
+            event.beginSeconds = results.cpuBeginTime + scope.beginMilliseconds * 1e-3;
+            event.endSeconds = results.cpuBeginTime + scope.endMilliseconds * 1e-3;
+            event.argValue = scope.depth;
+            event.track = c_GpuTrackBase + uint32_t(queue);
+            m_Events.push_back(event);
+        }
+
+        return true;
+    }
+
+    bool TraceRecorder::flush()
+    {
+        std::lock_guard fileLockGuard(m_FileMutex);
+
+        {
+            // Take the buffered events and let the other threads continue recording into the empty buffer
+            std::lock_guard lockGuard(m_Mutex);
+            m_Events.swap(m_FlushEvents);
+        }
+
+        for (const Event& event : m_FlushEvents)
+        {
+            writeEvent(event);
+        }
+
+        m_FlushEvents.clear();
+
+        if (fflush(m_File) != 0 || ferror(m_File))
+            m_WriteFailed = true;
+
+        return !m_WriteFailed;
+    }
+
+    void TraceRecorder::writeTrackName(uint32_t track)
+    {
+        if (!m_NamedTracks.insert(track).second)
+            return;
+
+        static const char* const queueNames[] = { "GPU Graphics", "GPU Compute", "GPU Copy" };
+
+        fprintf(m_File, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", track);
+        if (track >= c_GpuTrackBase)
+        {
+            const uint32_t queue = track - c_GpuTrackBase;
+            writeJsonString(m_File, queue < std::size(queueNames) ? queueNames[queue] : "GPU");
+        }
+        else
+        {
+            fprintf(m_File, "\"Thread %u\"", track);
+        }
+        fputs("}}", m_File);
+    }
+
+    void TraceRecorder::writeEvent(const Event& event)
+    {
+        writeTrackName(event.track);
+
+        // Chrome trace timestamps are in microseconds
+        const double begin = (event.beginSeconds - m_OriginSeconds) * 1e6;
+        const double duration = std::max(event.endSeconds - event.beginSeconds, 0.0) * 1e6;
+
+        fputs(",\n{\"ph\":\"X\",\"pid\":1,\"name\":", m_File);
+        writeJsonString(m_File, event.name);
+        fputs(",\"cat\":", m_File);
+        writeJsonString(m_File, event.category[0] ? event.category : "NVRHI");
+        fprintf(m_File, ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", event.track, begin, duration);
+
+        if (event.argName[0])
+        {
+            fputs(",\"args\":{", m_File);
+            writeJsonString(m_File, event.argName);
+            fprintf(m_File, ":%llu}", (unsigned long long)event.argValue);
+        }
+
+        fputc('}', m_File);
+    }
+
+    TraceRecorderHandle createTraceRecorder(const TraceRecorderDesc& desc)
+    {
+        if (desc.outputPath.empty() || desc.maxBufferedEvents == 0)
+            return nullptr;
+
+        FILE* file = fopen(desc.outputPath.c_str(), "w");
+        if (!file)
+            return nullptr;
+
+        return TraceRecorderHandle::Create(new TraceRecorder(desc, file));
+    }
+
+} // namespace nvrhi
@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <atomic>
+#include <mutex>
+
+namespace nvrhi
+{
+    // Holds the recorder set with IDevice::setTraceRecorder. The recorder can be replaced while other threads,
+    // such as the background garbage collection, record events, so readers get a strong reference from get().
+    class TraceRecorderSlot
+    {
+    public:
+        [[nodiscard]] TraceRecorderHandle get() const
+        {
+            // Skip the lock in the common case of tracing being disabled
+            if (!m_HasRecorder.load(std::memory_order_acquire))
+                return nullptr;
+
+            std::lock_guard lockGuard(m_Mutex);
+            return m_Recorder;
+        }
+
+        void set(ITraceRecorder* recorder)
+        {
+            TraceRecorderHandle previous;
+            {
+                std::lock_guard lockGuard(m_Mutex);
+                previous = std::move(m_Recorder);
+                m_Recorder = recorder;
+                m_HasRecorder.store(recorder != nullptr, std::memory_order_release);
+            }
+            // The previous recorder may flush when it's released, don't hold the lock for that
+        }
+
+    private:
+        mutable std::mutex m_Mutex;
+        TraceRecorderHandle m_Recorder;
+        std::atomic<bool> m_HasRecorder = false;
+    };
+
+    // Records a CPU event covering the lifetime of the object into the recorder, if there is one.
+    // The name, category and argument name must outlive the object.
+    class TraceScope
+    {
+    public:
+        TraceScope(TraceRecorderHandle recorder, const char* name, const char* category)
+            : m_Recorder(std::move(recorder))
+            , m_Name(name)
+            , m_Category(category)
+            , m_BeginSeconds(m_Recorder ? getTraceClockSeconds() : 0.0)
+        { }
+
+        ~TraceScope()
+        {
+            if (m_Recorder)
+                m_Recorder->recordCpuEvent(m_Name, m_Category, m_BeginSeconds, getTraceClockSeconds(), m_ArgName, m_ArgValue);
+        }
+
+        void setArg(const char* name, uint64_t value) { m_ArgName = name; m_ArgValue = value; }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        TraceRecorderHandle m_Recorder; // keeps the recorder alive if it's replaced during the scope
+        const char* m_Name;
+        const char* m_Category;
+        double m_BeginSeconds;
+        const char* m_ArgName = nullptr;
+        uint64_t m_ArgValue = 0;
+    };
+
+} // namespace nvrhi
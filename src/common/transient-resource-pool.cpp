@@ -0,0 +1,500 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <nvrhi/nvrhi.h>
+#include <nvrhi/common/misc.h>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+namespace nvrhi
+{
+    static bool isSameTextureDesc(const TextureDesc& a, const TextureDesc& b)
+    {
+        return a.width == b.width
+            && a.height == b.height
+            && a.depth == b.depth
+            && a.arraySize == b.arraySize
+            && a.mipLevels == b.mipLevels
+            && a.sampleCount == b.sampleCount
+            && a.sampleQuality == b.sampleQuality
+            && a.format == b.format
+            && a.dimension == b.dimension
+            && a.debugName == b.debugName
+            && a.isShaderResource == b.isShaderResource
+            && a.isRenderTarget == b.isRenderTarget
+            && a.isUAV == b.isUAV
+            && a.isTypeless == b.isTypeless
+            && a.isShadingRateSurface == b.isShadingRateSurface
+            && a.clearValue == b.clearValue
+            && a.useClearValue == b.useClearValue
+            && a.initialState == b.initialState;
+    }
+
+    static bool isSameBufferDesc(const BufferDesc& a, const BufferDesc& b)
+    {
+        return a.byteSize == b.byteSize
+            && a.structStride == b.structStride
+            && a.debugName == b.debugName
+            && a.format == b.format
+            && a.canHaveUAVs == b.canHaveUAVs
+            && a.canHaveTypedViews == b.canHaveTypedViews
+            && a.canHaveRawViews == b.canHaveRawViews
+            && a.isVertexBuffer == b.isVertexBuffer
+            && a.isIndexBuffer == b.isIndexBuffer
+            && a.isConstantBuffer == b.isConstantBuffer
+            && a.isDrawIndirectArgs == b.isDrawIndirectArgs
+            && a.isAccelStructBuildInput == b.isAccelStructBuildInput
+            && a.isAccelStructStorage == b.isAccelStructStorage
+            && a.isShaderBindingTable == b.isShaderBindingTable
+            && a.initialState == b.initialState;
+    }
+
+    static size_t hashTextureDesc(const TextureDesc& desc)
+    {
+        size_t hash = 0;
+        hash_combine(hash, desc.width);
+        hash_combine(hash, desc.height);
+        hash_combine(hash, desc.depth);
+        hash_combine(hash, desc.arraySize);
+        hash_combine(hash, desc.mipLevels);
+        hash_combine(hash, desc.sampleCount);
+        hash_combine(hash, desc.format);
+        hash_combine(hash, desc.dimension);
+        return hash;
+    }
+
+    static size_t hashBufferDesc(const BufferDesc& desc)
+    {
+        size_t hash = 0;
+        hash_combine(hash, desc.byteSize);
+        hash_combine(hash, desc.structStride);
+        hash_combine(hash, desc.format);
+        return hash;
+    }
+
+    class TransientResourcePool : public RefCounter<ITransientResourcePool>
+    {
+    public:
+        TransientResourcePool(IDevice* device, const TransientResourcePoolDesc& desc)
+            : m_Device(device)
+            , m_Desc(desc)
+        { }
+
+        void beginFrame() override;
+        TransientResourceId declareTexture(const TextureDesc& desc, uint32_t firstUse, uint32_t lastUse) override;
+        TransientResourceId declareBuffer(const BufferDesc& desc, uint32_t firstUse, uint32_t lastUse) override;
+        bool allocate() override;
+        ITexture* getTexture(TransientResourceId id) override;
+        IBuffer* getBuffer(TransientResourceId id) override;
+        void beginUse(ICommandList* commandList, uint32_t use) override;
+        TransientResourcePoolStatistics getStatistics() override;
+
+    private:
+        // A virtual resource that has been bound to heap memory, kept for reuse in later frames
+        struct PlacedResource
+        {
+            TextureHandle texture;
+            BufferHandle buffer;
+            uint32_t heapIndex = 0;
+            uint64_t offset = 0;
+            uint64_t lastUsedFrame = 0;
+        };
+
+        // Memory requirements of a resource description, with an unbound virtual resource that was created to query them
+        struct RequirementsEntry
+        {
+            bool isTexture = false;
+            TextureDesc textureDesc;
+            BufferDesc bufferDesc;
+            MemoryRequirements requirements;
+            TextureHandle spareTexture;
+            BufferHandle spareBuffer;
+        };
+
+        struct Declaration
+        {
+            bool isTexture = false;
+            TextureDesc textureDesc;
+            BufferDesc bufferDesc;
+            uint32_t firstUse = 0;
+            uint32_t lastUse = 0;
+
+            RequirementsEntry* requirements = nullptr;
+            uint32_t heapIndex = 0;
+            uint64_t offset = 0;
+
+            IResource* resource = nullptr;
+            // The only resource that used the same memory earlier in this frame, or null if there are none or several
+            IResource* aliasedBefore = nullptr;
+        };
+
+        struct PoolHeap
+        {
+            HeapHandle heap;
+            uint64_t size = 0;
+        };
+
+        DeviceHandle m_Device;
+        TransientResourcePoolDesc m_Desc;
+        uint64_t m_FrameIndex = 0;
+
+        std::vector<Declaration> m_Declarations;
+        std::vector<PoolHeap> m_Heaps;
+        std::vector<PlacedResource> m_PlacedResources;
+        std::unordered_map<size_t, std::vector<std::unique_ptr<RequirementsEntry>>> m_Requirements;
+
+        RequirementsEntry* getRequirements(const Declaration& declaration);
+        bool placeDeclaration(Declaration& declaration);
+        bool createResource(Declaration& declaration);
+    };
+
+    void TransientResourcePool::beginFrame()
+    {
+        ++m_FrameIndex;
+        m_Declarations.clear();
+
+        m_PlacedResources.erase(std::remove_if(m_PlacedResources.begin(), m_PlacedResources.end(),
+            [this](const PlacedResource& placed) { return m_FrameIndex - placed.lastUsedFrame > m_Desc.maxUnusedFrames; }),
+            m_PlacedResources.end());
+    }
+
+    static ResourceStates pickTransientTextureState(const TextureDesc& desc)
+    {
+        if (desc.isRenderTarget)
+        {
+            const FormatInfo& formatInfo = getFormatInfo(desc.format);
+            return (formatInfo.hasDepth || formatInfo.hasStencil) ? ResourceStates::DepthWrite : ResourceStates::RenderTarget;
+        }
+
+        if (desc.isUAV)
+            return ResourceStates::UnorderedAccess;
+
+        return ResourceStates::ShaderResource;
+    }
+
+    static ResourceStates pickTransientBufferState(const BufferDesc& desc)
+    {
+        if (desc.canHaveUAVs)
+            return ResourceStates::UnorderedAccess;
+
+        if (desc.isAccelStructStorage)
+            return ResourceStates::AccelStructRead;
+
+        return ResourceStates::ShaderResource;
+    }
+
+    TransientResourceId TransientResourcePool::declareTexture(const TextureDesc& desc, uint32_t firstUse, uint32_t lastUse)
+    {
+        Declaration& declaration = m_Declarations.emplace_back();
+        declaration.isTexture = true;
+        declaration.textureDesc = desc;
+        declaration.textureDesc.isVirtual = true;
+        declaration.textureDesc.keepInitialState = true;
+        if (declaration.textureDesc.initialState == ResourceStates::Unknown)
+            declaration.textureDesc.initialState = pickTransientTextureState(desc);
+        declaration.firstUse = std::min(firstUse, lastUse);
+        declaration.lastUse = std::max(firstUse, lastUse);
+
+        return TransientResourceId(m_Declarations.size() - 1);
+    }
+
+    TransientResourceId TransientResourcePool::declareBuffer(const BufferDesc& desc, uint32_t firstUse, uint32_t lastUse)
+    {
+        Declaration& declaration = m_Declarations.emplace_back();
+        declaration.bufferDesc = desc;
+        declaration.bufferDesc.isVirtual = true;
+        declaration.bufferDesc.keepInitialState = true;
+        if (declaration.bufferDesc.initialState == ResourceStates::Unknown || declaration.bufferDesc.initialState == ResourceStates::Common)
+            declaration.bufferDesc.initialState = pickTransientBufferState(desc);
+        declaration.firstUse = std::min(firstUse, lastUse);
+        declaration.lastUse = std::max(firstUse, lastUse);
+
+        return TransientResourceId(m_Declarations.size() - 1);
+    }
+
+    TransientResourcePool::RequirementsEntry* TransientResourcePool::getRequirements(const Declaration& declaration)
+    {
+        const size_t hash = declaration.isTexture ? hashTextureDesc(declaration.textureDesc) : hashBufferDesc(declaration.bufferDesc);
+        auto& bucket = m_Requirements[hash];
+
+        for (const auto& entry : bucket)
+        {
+            if (declaration.isTexture && entry->isTexture && isSameTextureDesc(entry->textureDesc, declaration.textureDesc))
+                return entry.get();
+            if (!declaration.isTexture && !entry->isTexture && isSameBufferDesc(entry->bufferDesc, declaration.bufferDesc))
+                return entry.get();
+        }
+
+        // The requirements can only be queried from a resource, so create one that will be bound later
+        auto entry = std::make_unique<RequirementsEntry>();
+        entry->isTexture = declaration.isTexture;
+        if (declaration.isTexture)
+        {
+            entry->textureDesc = declaration.textureDesc;
+            entry->spareTexture = m_Device->createTexture(declaration.textureDesc);
+            if (!entry->spareTexture)
+                return nullptr;
+            entry->requirements = m_Device->getTextureMemoryRequirements(entry->spareTexture);
+        }
+        else
+        {
+            entry->bufferDesc = declaration.bufferDesc;
+            entry->spareBuffer = m_Device->createBuffer(declaration.bufferDesc);
+            if (!entry->spareBuffer)
+                return nullptr;
+            entry->requirements = m_Device->getBufferMemoryRequirements(entry->spareBuffer);
+        }
+
+        if (entry->requirements.size == 0)
+            return nullptr;
+
+        bucket.push_back(std::move(entry));
+        return bucket.back().get();
+    }
+
+    bool TransientResourcePool::placeDeclaration(Declaration& declaration)
+    {
+        const uint64_t size = declaration.requirements->requirements.size;
+        const uint64_t alignment = std::max<uint64_t>(declaration.requirements->requirements.alignment, 1);
+
+        struct Range
+        {
+            uint64_t begin;
+            uint64_t end;
+        };
+        std::vector<Range> occupied;
+
+        for (uint32_t heapIndex = 0; heapIndex < uint32_t(m_Heaps.size()); ++heapIndex)
+        {
+            const uint64_t heapSize = m_Heaps[heapIndex].size;
+            if (size > heapSize)
+                continue;
+
+            // Collect the memory of the already placed resources whose lifetimes overlap with this one
+            occupied.clear();
+            for (const Declaration& other : m_Declarations)
+            {
+                if (!other.requirements || &other == &declaration || other.heapIndex != heapIndex || !other.resource)
+                    continue;
+
+                if (other.lastUse < declaration.firstUse || other.firstUse > declaration.lastUse)
+                    continue;
+
+                occupied.push_back({ other.offset, other.offset + other.requirements->requirements.size });
+            }
+
+            std::sort(occupied.begin(), occupied.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+            // First fit
+            uint64_t candidate = 0;
+            for (const Range& range : occupied)
+            {
+                if (align(candidate, alignment) + size <= range.begin)
+                    break;
+                candidate = std::max(candidate, range.end);
+            }
+            candidate = align(candidate, alignment);
+
+            if (candidate + size <= heapSize)
+            {
+                declaration.heapIndex = heapIndex;
+                declaration.offset = candidate;
+                return true;
+            }
+        }
+
+        PoolHeap poolHeap;
+        poolHeap.size = std::max(m_Desc.heapSize, size);
+
+        HeapDesc heapDesc;
+        heapDesc.capacity = poolHeap.size;
+        heapDesc.type = HeapType::DeviceLocal;
+        heapDesc.debugName = "TransientResourcePool";
+        poolHeap.heap = m_Device->createHeap(heapDesc);
+        if (!poolHeap.heap)
+            return false;
+
+        declaration.heapIndex = uint32_t(m_Heaps.size());
+        declaration.offset = 0;
+        m_Heaps.push_back(std::move(poolHeap));
+        return true;
+    }
+
+    bool TransientResourcePool::createResource(Declaration& declaration)
+    {
+        for (PlacedResource& placed : m_PlacedResources)
+        {
+            if (placed.lastUsedFrame == m_FrameIndex || placed.heapIndex != declaration.heapIndex || placed.offset != declaration.offset)
+                continue;
+
+            if (declaration.isTexture && placed.texture && isSameTextureDesc(placed.texture->getDesc(), declaration.textureDesc))
+            {
+                placed.lastUsedFrame = m_FrameIndex;
+                declaration.resource = placed.texture;
+                return true;
+            }
+
+            if (!declaration.isTexture && placed.buffer && isSameBufferDesc(placed.buffer->getDesc(), declaration.bufferDesc))
+            {
+                placed.lastUsedFrame = m_FrameIndex;
+                declaration.resource = placed.buffer;
+                return true;
+            }
+        }
+
+        PlacedResource placed;
+        placed.heapIndex = declaration.heapIndex;
+        placed.offset = declaration.offset;
+        placed.lastUsedFrame = m_FrameIndex;
+
+        IHeap* heap = m_Heaps[declaration.heapIndex].heap;
+        RequirementsEntry* requirements = declaration.requirements;
+
+        if (declaration.isTexture)
+        {
+            placed.texture = requirements->spareTexture ? std::move(requirements->spareTexture) : m_Device->createTexture(declaration.textureDesc);
+            if (!placed.texture || !m_Device->bindTextureMemory(placed.texture, heap, declaration.offset))
+                return false;
+            declaration.resource = placed.texture;
+        }
+        else
+        {
+            placed.buffer = requirements->spareBuffer ? std::move(requirements->spareBuffer) : m_Device->createBuffer(declaration.bufferDesc);
+            if (!placed.buffer || !m_Device->bindBufferMemory(placed.buffer, heap, declaration.offset))
+                return false;
+            declaration.resource = placed.buffer;
+        }
+
+        m_PlacedResources.push_back(std::move(placed));
+        return true;
+    }
+
+    bool TransientResourcePool::allocate()
+    {
+        for (Declaration& declaration : m_Declarations)
+        {
+            declaration.requirements = getRequirements(declaration);
+            if (!declaration.requirements)
+                return false;
+        }
+
+        // Place the largest resources first, they are the hardest to fit
+        std::vector<uint32_t> order(m_Declarations.size());
+        for (uint32_t i = 0; i < uint32_t(order.size()); ++i)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_Declarations[a].requirements->requirements.size > m_Declarations[b].requirements->requirements.size;
+        });
+
+        for (uint32_t index : order)
+        {
+            Declaration& declaration = m_Declarations[index];
+            if (!placeDeclaration(declaration) || !createResource(declaration))
+                return false;
+        }
+
+        // Find the previous users of each resource's memory for the aliasing barriers. When several earlier resources
+        // overlap it, the barrier uses a null resourceBefore to cover all of them.
+        for (Declaration& declaration : m_Declarations)
+        {
+            const Declaration* previous = nullptr;
+            uint32_t numPrevious = 0;
+            const uint64_t end = declaration.offset + declaration.requirements->requirements.size;
+
+            for (const Declaration& other : m_Declarations)
+            {
+                if (other.heapIndex != declaration.heapIndex || other.lastUse >= declaration.firstUse)
+                    continue;
+
+                const uint64_t otherEnd = other.offset + other.requirements->requirements.size;
+                if (other.offset >= end || declaration.offset >= otherEnd)
+                    continue;
+
+                previous = &other;
+                ++numPrevious;
+            }
+
+            declaration.aliasedBefore = (numPrevious == 1) ? previous->resource : nullptr;
+        }
+
+        return true;
+    }
+
+    ITexture* TransientResourcePool::getTexture(TransientResourceId id)
+    {
+        if (id >= m_Declarations.size() || !m_Declarations[id].isTexture)
+            return nullptr;
+
+        return checked_cast<ITexture*>(m_Declarations[id].resource);
+    }
+
+    IBuffer* TransientResourcePool::getBuffer(TransientResourceId id)
+    {
+        if (id >= m_Declarations.size() || m_Declarations[id].isTexture)
+            return nullptr;
+
+        return checked_cast<IBuffer*>(m_Declarations[id].resource);
+    }
+
+    void TransientResourcePool::beginUse(ICommandList* commandList, uint32_t use)
+    {
+        for (const Declaration& declaration : m_Declarations)
+        {
+            // Resources without a previous user in this frame may still alias the memory of the last frame's resources
+            if (declaration.firstUse == use && declaration.resource)
+                commandList->aliasingBarrier(declaration.aliasedBefore, declaration.resource);
+        }
+    }
+
+    TransientResourcePoolStatistics TransientResourcePool::getStatistics()
+    {
+        TransientResourcePoolStatistics statistics;
+
+        for (const PoolHeap& poolHeap : m_Heaps)
+            statistics.heapBytes += poolHeap.size;
+
+        for (const Declaration& declaration : m_Declarations)
+        {
+            if (declaration.requirements)
+                statistics.declaredBytes += declaration.requirements->requirements.size;
+        }
+
+        statistics.numHeaps = uint32_t(m_Heaps.size());
+        statistics.numPlacedResources = uint32_t(m_PlacedResources.size());
+
+        return statistics;
+    }
+
+    TransientResourcePoolHandle IDevice::createTransientResourcePool(const TransientResourcePoolDesc& desc)
+    {
+        if (!queryFeatureSupport(Feature::VirtualResources))
+            return nullptr;
+
+        return TransientResourcePoolHandle::Create(new TransientResourcePool(this, desc));
+    }
+
+} // namespace nvrhi
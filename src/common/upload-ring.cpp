@@ -0,0 +1,105 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "upload-ring.h"
+#include <nvrhi/nvrhi.h>
+#include <nvrhi/common/misc.h>
+#include "versioning.h"
+
+namespace nvrhi
+{
+    bool UploadRing::allocate(uint64_t size, uint64_t alignment, uint64_t currentVersion, uint64_t& outOffset)
+    {
+        if (size > m_Size)
+            return false;
+
+        uint64_t start = align(m_Head, alignment);
+
+        if ((start % m_Size) + size > m_Size)
+        {
+            // Skip to the beginning of the buffer, the padding belongs to this allocation's region
+            start = (start / m_Size + 1) * m_Size;
+        }
+
+        const uint64_t end = start + size;
+
+        if (end - m_Tail > m_Size)
+            return false;
+
+        if (!m_Regions.empty() && m_Regions.back().version == currentVersion)
+            m_Regions.back().end = end;
+        else
+            m_Regions.push_back(Region{ currentVersion, end });
+
+        m_Head = end;
+        outOffset = start % m_Size;
+        return true;
+    }
+
+    void UploadRing::submit(uint64_t currentVersion, uint64_t submittedVersion)
+    {
+        for (Region& region : m_Regions)
+        {
+            if (region.version == currentVersion)
+                region.version = submittedVersion;
+        }
+    }
+
+    void UploadRing::retire(uint64_t completedInstance)
+    {
+        while (!m_Regions.empty())
+        {
+            const Region& region = m_Regions.front();
+
+            // Version 0 means available, see releaseUnsubmitted
+            if (region.version != 0 && (!VersionGetSubmitted(region.version) || VersionGetInstance(region.version) > completedInstance))
+                break;
+
+            m_Tail = region.end;
+            m_Regions.pop_front();
+        }
+
+        // Start over from the beginning when nothing is in flight, so that large allocations don't need to skip
+        if (m_Regions.empty())
+        {
+            m_Head = 0;
+            m_Tail = 0;
+        }
+    }
+
+    void UploadRing::releaseUnsubmitted()
+    {
+        for (Region& region : m_Regions)
+        {
+            if (!VersionGetSubmitted(region.version))
+                region.version = 0;
+        }
+    }
+
+    uint64_t UploadRing::getOldestSubmittedVersion() const
+    {
+        if (m_Regions.empty() || !VersionGetSubmitted(m_Regions.front().version))
+            return 0;
+
+        return m_Regions.front().version;
+    }
+}
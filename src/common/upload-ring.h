@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <deque>
+#include <cstdint>
+
+namespace nvrhi
+{
+    // Tracks the used space in a fixed-size ring buffer, such as the persistently mapped upload ring.
+    // Every allocated region is tagged with the version word of the command list that allocated it (see versioning.h),
+    // and regions are reclaimed in order once their command list instance has been submitted and has finished executing.
+    // Allocations never wrap around the end of the buffer: if one doesn't fit, the rest of the buffer is skipped.
+    // The ring is not thread-safe, like the upload managers that use it.
+    class UploadRing
+    {
+    public:
+        explicit UploadRing(uint64_t size) : m_Size(size) { }
+
+        // Finds space for 'size' bytes at the specified alignment (must be a power of 2 not larger than the ring's
+        // own alignment) and returns its offset from the start of the buffer. Returns false if the ring is full.
+        [[nodiscard]] bool allocate(uint64_t size, uint64_t alignment, uint64_t currentVersion, uint64_t& outOffset);
+
+        // Marks the regions allocated under 'currentVersion' as submitted under 'submittedVersion'.
+        void submit(uint64_t currentVersion, uint64_t submittedVersion);
+
+        // Reclaims the submitted regions whose instances are not newer than 'completedInstance'.
+        void retire(uint64_t completedInstance);
+
+        // Makes the regions that have not been submitted available, for a command list that was closed without
+        // being executed. They are reclaimed in order, after the submitted regions before them.
+        void releaseUnsubmitted();
+
+        // Returns the version of the oldest region if it has been submitted, i.e. the GPU work that the CPU
+        // can wait for to free some space, or 0 if there is no such region.
+        [[nodiscard]] uint64_t getOldestSubmittedVersion() const;
+
+        [[nodiscard]] uint64_t getSize() const { return m_Size; }
+        [[nodiscard]] uint64_t getBytesInFlight() const { return m_Head - m_Tail; }
+
+    private:
+        struct Region
+        {
+            uint64_t version;
+            uint64_t end; // the region starts where the previous one ends
+        };
+
+        // Offsets are virtual and only grow, the physical offset is (offset % m_Size)
+        uint64_t m_Size;
+        uint64_t m_Head = 0;
+        uint64_t m_Tail = 0;
+        std::deque<Region> m_Regions;
+    };
+}
@@ -426,4 +426,96 @@ namespace nvrhi::utils
         }
     }
 
+    DescriptorSlotAllocator::DescriptorSlotAllocator(uint32_t capacity)
+        : m_NumWords((capacity + 63) / 64)
+        , m_Capacity(capacity)
+    {
+        m_Words = std::make_unique<std::atomic<uint64_t>[]>(m_NumWords);
+
+        for (uint32_t word = 0; word < m_NumWords; word++)
+            m_Words[word].store(0, std::memory_order_relaxed);
+
+        // Mark the bits past the end of the last word as allocated so that they are never returned
+        if (capacity % 64 != 0)
+            m_Words[m_NumWords - 1].store(~0ull << (capacity % 64), std::memory_order_relaxed);
+    }
+
+    int DescriptorSlotAllocator::allocate()
+    {
+        uint32_t slot;
+        if (allocate(&slot, 1) == 0)
+            return -1;
+
+        return int(slot);
+    }
+
+    uint32_t DescriptorSlotAllocator::allocate(uint32_t* outSlots, uint32_t count)
+    {
+        if (m_NumWords == 0 || count == 0)
+            return 0;
+
+        uint32_t numAllocated = 0;
+
+        // Start at the word where the last allocation happened, so that threads don't re-scan the full words
+        // at the beginning of the table on every call. Visit every word at most once.
+        const uint32_t startWord = m_NextWord.load(std::memory_order_relaxed) % m_NumWords;
+
+        for (uint32_t i = 0; i < m_NumWords && numAllocated < count; i++)
+        {
+            const uint32_t wordIndex = (startWord + i) % m_NumWords;
+            std::atomic<uint64_t>& word = m_Words[wordIndex];
+
+            uint64_t bits = word.load(std::memory_order_relaxed);
+            while (bits != ~0ull && numAllocated < count)
+            {
+                // Claim as many of the free bits in this word as still needed
+                uint64_t claimed = 0;
+                uint64_t freeBits = ~bits;
+                for (uint32_t n = numAllocated; n < count && freeBits != 0; n++)
+                {
+                    const uint64_t lowestBit = freeBits & (~freeBits + 1);
+                    claimed |= lowestBit;
+                    freeBits &= ~lowestBit;
+                }
+
+                if (word.compare_exchange_weak(bits, bits | claimed, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    for (uint32_t bit = 0; bit < 64; bit++)
+                    {
+                        if (claimed & (1ull << bit))
+                            outSlots[numAllocated++] = wordIndex * 64 + bit;
+                    }
+
+                    m_NextWord.store(wordIndex, std::memory_order_relaxed);
+                    break;
+                }
+                // 'bits' now holds the current value of the word, retry
+            }
+        }
+
+        m_NumAllocated.fetch_add(numAllocated, std::memory_order_relaxed);
+
+        return numAllocated;
+    }
+
+    void DescriptorSlotAllocator::release(int slot)
+    {
+        if (slot < 0 || uint32_t(slot) >= m_Capacity)
+            return;
+
+        const uint64_t mask = 1ull << (uint32_t(slot) % 64);
+        const uint64_t previous = m_Words[uint32_t(slot) / 64].fetch_and(~mask, std::memory_order_release);
+
+        if (previous & mask)
+        {
+            m_NumAllocated.fetch_sub(1, std::memory_order_relaxed);
+
+            // Point new allocations at the word with the released slot if it's before the current position
+            const uint32_t wordIndex = uint32_t(slot) / 64;
+            uint32_t nextWord = m_NextWord.load(std::memory_order_relaxed);
+            while (wordIndex < nextWord && !m_NextWord.compare_exchange_weak(nextWord, wordIndex, std::memory_order_relaxed))
+            { }
+        }
+    }
+
 }
@@ -25,6 +25,11 @@
 #include <nvrhi/d3d11.h>
 #include <nvrhi/common/resourcebindingmap.h>
 #include "../common/dxgi-format.h"
+#include "../common/dxgi-memory.h"
+#include "../common/push-bindings.h"
+#include "../common/graphics-state-block.h"
+#include "../common/trace-recorder.h"
+#include "../common/object-cache.h"
 
 #include <d3d11_1.h>
 #include <map>
@@ -51,14 +56,45 @@ namespace nvrhi::d3d11
     D3D11_TEXTURE_ADDRESS_MODE convertSamplerAddressMode(SamplerAddressMode mode);
     UINT convertSamplerReductionType(SamplerReductionType reductionType);
 
+    // A large dynamic buffer that volatile constant buffer versions are sub-allocated from.
+    // Writes map it with NO_OVERWRITE until it is full, then the whole ring is discarded and a new generation starts.
+    // The versions are bound with the Set*ConstantBuffers1 offsets, which requires D3D11.1.
+    class ConstantBufferRing
+    {
+    public:
+        RefCountPtr<ID3D11Buffer> buffer;
+
+        bool initialize(ID3D11Device* device, uint32_t size);
+        // Makes the next write discard the buffer, which is required for the first map on a deferred context
+        void reset() { m_Offset = m_Size; }
+
+        // Copies the data into the ring and returns its location in 16-byte constants.
+        // At least bufferSize bytes are reserved, because the versions are bound with the size of the whole buffer.
+        bool write(ID3D11DeviceContext* context, const void* data, size_t dataSize, size_t bufferSize, UINT& outFirstConstant);
+
+        [[nodiscard]] uint32_t getGeneration() const { return m_Generation; }
+        [[nodiscard]] uint32_t getSize() const { return m_Size; }
+
+    private:
+        uint32_t m_Size = 0;
+        uint32_t m_Offset = 0;
+        uint32_t m_Generation = 0;
+    };
+
     struct Context
     {
         RefCountPtr<ID3D11Device> device;
         RefCountPtr<ID3D11DeviceContext> immediateContext;
         RefCountPtr<ID3D11DeviceContext1> immediateContext1;
         RefCountPtr<ID3D11Buffer> pushConstantBuffer;
+        ConstantBufferRing* constantBufferRing = nullptr; // NULL if volatile CBs use their own resources
         IMessageCallback* messageCallback = nullptr;
         bool nvapiAvailable = false;
+        bool driverCommandLists = false; // D3D11_FEATURE_DATA_THREADING::DriverCommandLists
+        bool mapNoOverwriteOnDynamicConstantBuffer = false; // D3D11_FEATURE_DATA_D3D11_OPTIONS
+
+        // See IDevice::setTraceRecorder. Only the device-level events are recorded on D3D11.
+        TraceRecorderSlot traceRecorder;
 
         void error(const std::string& message) const;
     };
@@ -104,6 +140,10 @@ namespace nvrhi::d3d11
         BufferDesc desc;
         RefCountPtr<ID3D11Buffer> resource;
         HANDLE sharedHandle = nullptr;
+
+        // For volatile buffers placed into Context::constantBufferRing: 'resource' is the device ring,
+        // and the versions are tracked by each command list, see CommandList::writeRingConstantBuffer.
+        bool inConstantBufferRing = false;
         
         Buffer(const Context& context) : m_Context(context) { }
         const BufferDesc& getDesc() const override { return desc; }
@@ -161,6 +201,29 @@ namespace nvrhi::d3d11
         bool resolved = false;
         float time = 0.f;
     };
+
+    class OcclusionQuery : public RefCounter<IOcclusionQuery>
+    {
+    public:
+        OcclusionQueryDesc desc;
+        RefCountPtr<ID3D11Query> query;
+
+        bool started = false;
+        bool resolved = false;
+        uint64_t result = 0;
+
+        const OcclusionQueryDesc& getDesc() const override { return desc; }
+    };
+
+    class PipelineStatisticsQuery : public RefCounter<IPipelineStatisticsQuery>
+    {
+    public:
+        RefCountPtr<ID3D11Query> query;
+
+        bool started = false;
+        bool resolved = false;
+        PipelineStatistics result;
+    };
     
     class InputLayout : public RefCounter<IInputLayout>
     {
@@ -266,6 +329,15 @@ namespace nvrhi::d3d11
         uint32_t minUAVSlot = D3D11_1_UAV_SLOT_COUNT;
         uint32_t maxUAVSlot = 0;
 
+        // Volatile CBs from the constant buffer ring, whose entries in constantBufferOffsets are updated at bind time
+        struct RingConstantBuffer
+        {
+            Buffer* buffer = nullptr;
+            uint32_t slot = 0;
+            UINT rangeOffset = 0; // in 16-byte constants
+        };
+        static_vector<RingConstantBuffer, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT> ringConstantBuffers;
+
         std::vector<RefCountPtr<IResource>> resources;
         
         const BindingSetDesc* getDesc() const override { return &desc; }
@@ -276,7 +348,13 @@ namespace nvrhi::d3d11
     class CommandList : public RefCounter<ICommandList>
     {
     public:
-        explicit CommandList(const Context& context, IDevice* device, const CommandListParameters& params);
+        // 'deferredContext' is NULL for the immediate command list
+        explicit CommandList(const Context& context, IDevice* device, const CommandListParameters& params, ID3D11DeviceContext* deferredContext = nullptr);
+
+        // Returns the command list recorded by the last close() on a deferred context, or NULL
+        ID3D11CommandList* getRecordedCommandList() const { return m_RecordedCommandList; }
+        // Forgets the cached state after the context state has been reset by ExecuteCommandList
+        void invalidateState();
 
         // IResource implementation
 
@@ -296,6 +374,7 @@ namespace nvrhi::d3d11
         void copyTexture(IStagingTexture* dest, const TextureSlice& destSlice, ITexture* src, const TextureSlice& srcSlice) override;
         void copyTexture(ITexture* dest, const TextureSlice& destSlice, IStagingTexture* src, const TextureSlice& srcSlice) override;
         void writeTexture(ITexture* dest, uint32_t arraySlice, uint32_t mipLevel, const void* data, size_t rowPitch, size_t depthPitch) override;
+        void writeTextureRegions(ITexture* dest, const TextureUploadRegion* regions, size_t numRegions) override;
         void resolveTexture(ITexture* dest, const TextureSubresourceSet& dstSubresources, ITexture* src, const TextureSubresourceSet& srcSubresources) override;
 
         void writeBuffer(IBuffer* b, const void* data, size_t dataSize, uint64_t destOffsetBytes = 0) override;
@@ -303,36 +382,61 @@ namespace nvrhi::d3d11
         void copyBuffer(IBuffer* dest, uint64_t destOffsetBytes, IBuffer* src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes) override;
 
         void setPushConstants(const void* data, size_t byteSize) override;
+        void setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings) override;
+        BindingSetHandle createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout) override;
 
         void setGraphicsState(const GraphicsState& state) override;
+        void setGraphicsStateBlock(IGraphicsStateBlock* block) override;
         void draw(const DrawArguments& args) override;
         void drawIndexed(const DrawArguments& args) override;
+        void drawMulti(const MultiDrawArguments& multiDraw) override;
+        void drawIndexedMulti(const MultiDrawArguments& multiDraw) override;
         void drawIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
         void drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void executeBundles(ICommandList* const* bundles, size_t numBundles) override;
 
         void setComputeState(const ComputeState& state) override;
         void dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
         void dispatchIndirect(uint32_t offsetBytes)  override;
+        void executeIndirect(ICommandSignature* signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes) override;
 
         void setMeshletState(const MeshletState& state) override;
         void dispatchMesh(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
+        void dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
 
         void setRayTracingState(const rt::State& state) override;
         void dispatchRays(const rt::DispatchRaysArguments& args) override;
 
         void buildOpacityMicromap(rt::IOpacityMicromap* omm, const rt::OpacityMicromapDesc& desc) override;
         void buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags) override;
+        void buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds) override;
         void compactBottomLevelAccelStructs() override;
         void buildTopLevelAccelStruct(rt::IAccelStruct* as, const rt::InstanceDesc* pInstances, size_t numInstances, rt::AccelStructBuildFlags buildFlags) override;
         void buildTopLevelAccelStructFromBuffer(rt::IAccelStruct* as, nvrhi::IBuffer* instanceBuffer, uint64_t instanceBufferOffset, size_t numInstances,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) override;
+        rt::InstanceDesc* beginTopLevelInstanceWrite(rt::IAccelStruct* as, size_t numInstances) override;
+        void commitTopLevelInstanceWrite(rt::IAccelStruct* as, rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None,
+            rt::IAccelStruct* const* bottomLevelASes = nullptr, size_t numBottomLevelASes = 0) override;
 
         void beginTimerQuery(ITimerQuery* query) override;
         void endTimerQuery(ITimerQuery* query) override;
 
+        void beginOcclusionQuery(IOcclusionQuery* query) override;
+        void endOcclusionQuery(IOcclusionQuery* query) override;
+        void beginPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void endPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* buffer, uint64_t offsetBytes) override
+            { (void)queries; (void)numQueries; (void)buffer; (void)offsetBytes; utils::NotSupported(); }
+        void setPredication(IBuffer* buffer, uint64_t offsetBytes, PredicationOp op) override
+            { (void)buffer; (void)offsetBytes; (void)op; utils::NotSupported(); }
+
         // perf markers
         void beginMarker(const char* name) override;
         void endMarker() override;
+        void setGpuProfiler(IGpuProfiler* profiler) override { (void)profiler; }
 
         void setEnableAutomaticBarriers(bool enable) override { (void)enable; }
         void setResourceStatesForBindingSet(IBindingSet* bindingSet) override { (void)bindingSet; }
@@ -345,24 +449,36 @@ namespace nvrhi::d3d11
 
         void setTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override { (void)texture; (void)subresources; (void)stateBits; }
         void setBufferState(IBuffer* buffer, ResourceStates stateBits) override { (void)buffer; (void)stateBits; }
+        void beginTextureStateTransition(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override { (void)texture; (void)subresources; (void)stateBits; }
+        void beginBufferStateTransition(IBuffer* buffer, ResourceStates stateBits) override { (void)buffer; (void)stateBits; }
         void setAccelStructState(rt::IAccelStruct* as, ResourceStates stateBits) override { (void)as; (void)stateBits; }
 
         void setPermanentTextureState(ITexture* texture, ResourceStates stateBits) override { (void)texture; (void)stateBits; }
         void setPermanentBufferState(IBuffer* buffer, ResourceStates stateBits) override { (void)buffer; (void)stateBits; }
 
         void commitBarriers() override { }
+        void aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter) override { (void)resourceBefore; (void)resourceAfter; }
 
         ResourceStates getTextureSubresourceState(ITexture* texture, ArraySlice arraySlice, MipLevel mipLevel) override { (void)texture; (void)arraySlice; (void)mipLevel; return ResourceStates::Common; }
         ResourceStates getBufferState(IBuffer* buffer) override { (void)buffer; return ResourceStates::Common; }
 
         IDevice* getDevice() override { return m_Device; }
         const CommandListParameters& getDesc() override { return m_Desc; }
+        UploadStatistics getUploadStatistics() override { return UploadStatistics(); }
+        CommandListStatistics getStatistics() override { return CommandListStatistics(); }
 
     private:
         const Context& m_Context;
         IDevice* m_Device; // weak reference - to avoid a cyclic reference between Device and its ImmediateCommandList
         CommandListParameters m_Desc;
 
+        // The context that the commands are recorded into: the immediate context, or a deferred context
+        // owned by this command list if it was created with enableImmediateExecution = false
+        RefCountPtr<ID3D11DeviceContext> m_DeviceContext;
+        RefCountPtr<ID3D11DeviceContext1> m_DeviceContext1;
+        RefCountPtr<ID3D11CommandList> m_RecordedCommandList;
+        bool m_IsDeferred = false;
+
         RefCountPtr<ID3DUserDefinedAnnotation> m_UserDefinedAnnotation;
 
         int m_NumUAVOverlapCommands = 0;
@@ -389,6 +505,29 @@ namespace nvrhi::d3d11
         uint8_t m_CurrentStencilRefValue = 0;
         bool m_CurrentGraphicsStateValid = false;
         bool m_CurrentComputeStateValid = false;
+        bool m_AnyVolatileBufferWrites = false;
+
+        // The versions of the volatile CBs in the ring that have been written by this command list.
+        // A copy of the data is kept to restore the version after the ring has been discarded on wrap-around.
+        struct RingConstantBufferVersion
+        {
+            UINT firstConstant = 0;
+            uint32_t generation = 0;
+            std::vector<uint8_t> data;
+        };
+        std::unordered_map<Buffer*, RingConstantBufferVersion> m_RingConstantBufferVersions;
+        // The ring offsets bound to each (stage, slot), indexed like c_ConstantBufferStages
+        UINT m_BoundRingConstantBufferOffsets[6][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = {};
+        // The device ring for the immediate command list, or m_DeferredConstantBufferRing for deferred ones,
+        // because sub-allocations from a shared ring cannot be ordered between deferred contexts
+        ConstantBufferRing* m_ConstantBufferRing = nullptr;
+        ConstantBufferRing m_DeferredConstantBufferRing;
+
+        // Bindings recorded with setPushBindings, turned into binding sets by the next set*State call
+        PushBindings m_PushBindings;
+
+        // Per command list, because deferred command lists may be recorded concurrently
+        char m_PushConstantPaddingBuffer[c_MaxPushConstantSize] = {};
 
         void copyTexture(ID3D11Resource* dst, const TextureDesc& dstDesc, const TextureSlice& dstSlice,
             ID3D11Resource* src, const TextureDesc& srcDesc, const TextureSlice& srcSlice);
@@ -402,8 +541,18 @@ namespace nvrhi::d3d11
             const IGraphicsPipeline* newPipeline,
             bool updateFramebuffer,
             BindingSetVector& outSetsToBind) const;
-        void bindGraphicsResourceSets(const BindingSetVector& setsToBind, const IGraphicsPipeline* newPipeline) const;
-        void bindComputeResourceSets(const BindingSetVector& resourceSets, const static_vector<BindingSetHandle, c_MaxBindingLayouts>* currentResourceSets) const;
+        void bindGraphicsResourceSets(const BindingSetVector& setsToBind, const IGraphicsPipeline* newPipeline);
+        void drawMultiInternal(const MultiDrawArguments& multiDraw, bool indexed);
+        void bindComputeResourceSets(const BindingSetVector& resourceSets, const static_vector<BindingSetHandle, c_MaxBindingLayouts>* currentResourceSets);
+
+        void writeRingConstantBuffer(Buffer* buffer, const void* data, size_t dataSize);
+        UINT getRingConstantBufferOffset(const BindingSet::RingConstantBuffer& ringBuffer);
+        // Copies the CB bindings of the set, replacing the ring CBs with the versions written by this command list
+        void resolveConstantBuffers(const BindingSet* set, ShaderType stages, ID3D11Buffer** outBuffers, UINT* outOffsets);
+        // Rebinds the ring CB slots of the current binding sets whose versions have changed since they were bound
+        void updateVolatileConstantBuffers(ShaderType stages);
+        void updateGraphicsVolatileBuffers();
+        void updateComputeVolatileBuffers();
     };
 
     class Device : public RefCounter<IDevice>
@@ -422,6 +571,10 @@ namespace nvrhi::d3d11
         TextureHandle createTexture(const TextureDesc& d) override;
         MemoryRequirements getTextureMemoryRequirements(ITexture* texture) override;
         bool bindTextureMemory(ITexture* texture, IHeap* heap, uint64_t offset) override;
+        void getTextureTiling(ITexture* texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+            uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings) override;
+        void updateTextureTileMappings(ITexture* texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings,
+            CommandQueue executionQueue = CommandQueue::Graphics) override;
 
         TextureHandle createHandleForNativeTexture(ObjectType objectType, Object texture, const TextureDesc& desc) override;
 
@@ -432,6 +585,7 @@ namespace nvrhi::d3d11
         BufferHandle createBuffer(const BufferDesc& d) override;
         void *mapBuffer(IBuffer* b, CpuAccessMode mapFlags) override;
         void unmapBuffer(IBuffer* b) override;
+        void *tryMapBuffer(IBuffer* b, CpuAccessMode mapFlags, SubmissionId* outLastUse) override;
         MemoryRequirements getBufferMemoryRequirements(IBuffer* buffer) override;
         bool bindBufferMemory(IBuffer* buffer, IHeap* heap, uint64_t offset) override;
 
@@ -458,17 +612,36 @@ namespace nvrhi::d3d11
         float getTimerQueryTime(ITimerQuery* query) override;
         void resetTimerQuery(ITimerQuery* query) override;
 
+        // occlusion and pipeline statistics queries
+        OcclusionQueryHandle createOcclusionQuery(const OcclusionQueryDesc& desc) override;
+        bool pollOcclusionQuery(IOcclusionQuery* query) override;
+        uint64_t getOcclusionQueryResult(IOcclusionQuery* query) override;
+        void resetOcclusionQuery(IOcclusionQuery* query) override;
+        PipelineStatisticsQueryHandle createPipelineStatisticsQuery() override;
+        bool pollPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        PipelineStatistics getPipelineStatistics(IPipelineStatisticsQuery* query) override;
+        void resetPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        GpuProfilerHandle createGpuProfiler(const GpuProfilerDesc& desc) override { (void)desc; return nullptr; }
+
         GraphicsAPI getGraphicsAPI() override;
 
         FramebufferHandle createFramebuffer(const FramebufferDesc& desc) override;
 
         GraphicsPipelineHandle createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb) override;
 
+        GraphicsStateBlockHandle createGraphicsStateBlock(const GraphicsState& state) override;
+
         ComputePipelineHandle createComputePipeline(const ComputePipelineDesc& desc) override;
 
         MeshletPipelineHandle createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb) override;
 
         rt::PipelineHandle createRayTracingPipeline(const rt::PipelineDesc& desc) override;
+        CommandSignatureHandle createCommandSignature(const CommandSignatureDesc& desc) override;
+        bool exportPipelineCache(std::vector<uint8_t>& outData) override;
+        bool importPipelineCache(const void* data, size_t dataSize) override;
+        void setTaskScheduler(ITaskScheduler* scheduler) override { m_TaskScheduler = scheduler; }
+        ITaskScheduler* getTaskScheduler() override { return m_TaskScheduler; }
+        void setTraceRecorder(ITraceRecorder* recorder) override { m_Context.traceRecorder.set(recorder); }
 
         BindingLayoutHandle createBindingLayout(const BindingLayoutDesc& desc) override;
         BindingLayoutHandle createBindlessLayout(const BindlessLayoutDesc& desc) override;
@@ -478,6 +651,7 @@ namespace nvrhi::d3d11
 
         void resizeDescriptorTable(IDescriptorTable* descriptorTable, uint32_t newSize, bool keepContents = true) override;
         bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem& item) override;
+        bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem* items, size_t numItems) override;
 
         rt::OpacityMicromapHandle createOpacityMicromap(const rt::OpacityMicromapDesc& desc) override;
         rt::AccelStructHandle createAccelStruct(const rt::AccelStructDesc& desc) override;
@@ -485,10 +659,21 @@ namespace nvrhi::d3d11
         bool bindAccelStructMemory(rt::IAccelStruct* as, IHeap* heap, uint64_t offset) override;
         
         CommandListHandle createCommandList(const CommandListParameters& params = CommandListParameters()) override;
-        uint64_t executeCommandLists(ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue = CommandQueue::Graphics) override { (void)pCommandLists; (void)numCommandLists; (void)executionQueue; return 0; }
+        uint64_t executeCommandLists(ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue = CommandQueue::Graphics) override;
         void queueWaitForCommandList(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance) override { (void)waitQueue; (void)executionQueue; (void)instance; }
         void waitForIdle() override;
-        void runGarbageCollection() override { }
+        void setDeferredSubmission(bool enable) override { (void)enable; }
+        void flushSubmissions() override { }
+        // DX11 has no submission timeline, executeCommandLists always returns instance 0
+        bool waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds) override
+            { (void)queues; (void)instances; (void)numSubmissions; (void)waitAll; (void)timeoutNanoseconds; return true; }
+        void runGarbageCollection() override;
+        bool runGarbageCollection(uint32_t maxMicroseconds) override { (void)maxMicroseconds; runGarbageCollection(); return true; }
+        MemoryStatistics getMemoryStatistics() override;
+        CommandListStatistics getCommandListStatistics(bool) override { return CommandListStatistics(); }
+        void setObjectCacheEnabled(bool enable) override { m_ObjectCache.setEnabled(enable); }
+        ObjectCacheStatistics getObjectCacheStatistics(bool reset) override { return m_ObjectCache.getStatistics(reset); }
+        void setMemoryBudgetCallback(IMemoryBudgetCallback* callback) override { m_MemoryBudgetCallback = callback; }
         bool queryFeatureSupport(Feature feature, void* pInfo = nullptr, size_t infoSize = 0) override;
         FormatSupport queryFormatSupport(Format format) override;
         Object getNativeQueue(ObjectType objectType, CommandQueue queue) override { (void)objectType; (void)queue;  return nullptr; }
@@ -498,6 +683,10 @@ namespace nvrhi::d3d11
         Context m_Context;
         EventQueryHandle m_WaitForIdleQuery;
         CommandListHandle m_ImmediateCommandList;
+        ITaskScheduler* m_TaskScheduler = nullptr;
+        DxgiMemoryBudget m_MemoryBudget;
+        IMemoryBudgetCallback* m_MemoryBudgetCallback = nullptr;
+        ConstantBufferRing m_ConstantBufferRing;
 
         std::unordered_map<size_t, RefCountPtr<ID3D11BlendState>> m_BlendStates;
         std::unordered_map<size_t, RefCountPtr<ID3D11DepthStencilState>> m_DepthStencilStates;
@@ -507,6 +696,7 @@ namespace nvrhi::d3d11
         bool m_FastGeometryShaderSupported = false;
 
         TextureHandle createTexture(const TextureDesc& d, CpuAccessMode cpuAccess) const;
+        void *mapBuffer(Buffer* buffer, CpuAccessMode flags, bool doNotWait);
 
         ID3D11RenderTargetView* getRTVForAttachment(const FramebufferAttachment& attachment);
         ID3D11DepthStencilView* getDSVForAttachment(const FramebufferAttachment& attachment);
@@ -514,6 +704,14 @@ namespace nvrhi::d3d11
         ID3D11BlendState* getBlendState(const BlendState& blendState);
         ID3D11DepthStencilState* getDepthStencilState(const DepthStencilState& depthStencilState);
         ID3D11RasterizerState* getRasterizerState(const RasterState& rasterState);
+
+        SamplerHandle createSamplerInternal(const SamplerDesc& d);
+        GraphicsPipelineHandle createGraphicsPipelineInternal(const GraphicsPipelineDesc& desc, IFramebuffer* fb);
+        ComputePipelineHandle createComputePipelineInternal(const ComputePipelineDesc& desc);
+        BindingSetHandle createBindingSetInternal(const BindingSetDesc& desc, IBindingLayout* layout);
+
+        // Declared last so that the cached objects are released before the rest of the device, see IDevice::setObjectCacheEnabled
+        ObjectCache m_ObjectCache;
     };
 
 } // namespace nvrhi::d3d11
@@ -27,6 +27,7 @@
 #include <nvrhi/utils.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 namespace nvrhi::d3d11
 {
@@ -45,10 +46,67 @@ namespace nvrhi::d3d11
         }
     }
 
+    bool ConstantBufferRing::initialize(ID3D11Device* device, uint32_t size)
+    {
+        D3D11_BUFFER_DESC desc11 = {};
+        desc11.ByteWidth = align(size, c_ConstantBufferOffsetSizeAlignment);
+        desc11.Usage = D3D11_USAGE_DYNAMIC;
+        desc11.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        desc11.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        if (FAILED(device->CreateBuffer(&desc11, nullptr, &buffer)))
+            return false;
+
+        SetDebugName(buffer, "VolatileConstantBufferRing");
+
+        m_Size = desc11.ByteWidth;
+        m_Offset = m_Size; // make the first write discard the buffer
+        return true;
+    }
+
+    bool ConstantBufferRing::write(ID3D11DeviceContext* context, const void* data, size_t dataSize, size_t bufferSize, UINT& outFirstConstant)
+    {
+        // Versions are bound with offsets and sizes in units of 16 constants
+        const uint32_t allocationSize = align(uint32_t(std::max(dataSize, bufferSize)), c_ConstantBufferOffsetSizeAlignment);
+        if (allocationSize > m_Size)
+            return false;
+
+        D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+        if (m_Offset + allocationSize > m_Size)
+        {
+            // Wrap around: the driver renames the buffer, so the older versions cannot be overwritten while in use,
+            // but their contents are lost for the future draws. See CommandList::getRingConstantBufferOffset.
+            mapType = D3D11_MAP_WRITE_DISCARD;
+            m_Offset = 0;
+            ++m_Generation;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedData;
+        if (FAILED(context->Map(buffer, 0, mapType, 0, &mappedData)))
+            return false;
+
+        memcpy((char*)mappedData.pData + m_Offset, data, dataSize);
+        context->Unmap(buffer, 0);
+
+        outFirstConstant = m_Offset / 16;
+        m_Offset += allocationSize;
+        return true;
+    }
+
     BufferHandle Device::createBuffer(const BufferDesc& d)
     {
         assert(d.byteSize <= UINT_MAX);
 
+        if (d.isVolatile && m_Context.constantBufferRing)
+        {
+            // The versions of this buffer are sub-allocated from the ring on each write
+            Buffer* buffer = new Buffer(m_Context);
+            buffer->desc = d;
+            buffer->resource = m_Context.constantBufferRing->buffer;
+            buffer->inConstantBufferRing = true;
+            return BufferHandle::Create(buffer);
+        }
+
         D3D11_BUFFER_DESC desc11 = {};
         desc11.ByteWidth = (UINT)d.byteSize;
 
@@ -66,6 +124,8 @@ namespace nvrhi::d3d11
                 break;
 
             case CpuAccessMode::Write:
+            case CpuAccessMode::Discard:
+            case CpuAccessMode::NoOverwrite:
                 desc11.Usage = D3D11_USAGE_DYNAMIC;
                 desc11.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
                 break;
@@ -150,15 +210,36 @@ namespace nvrhi::d3d11
 
         assert(destOffsetBytes + dataSize <= UINT_MAX);
 
+        if (buffer->inConstantBufferRing)
+        {
+            assert(destOffsetBytes == 0);
+            writeRingConstantBuffer(buffer, data, dataSize);
+            m_AnyVolatileBufferWrites = true;
+            return;
+        }
+
         if (buffer->desc.cpuAccess == CpuAccessMode::Write)
         {
             // we can map if it it's D3D11_USAGE_DYNAMIC, but not UpdateSubresource
             D3D11_MAPPED_SUBRESOURCE mappedData;
             D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD;
             if (destOffsetBytes > 0 || dataSize + destOffsetBytes < buffer->desc.byteSize)
+            {
+                // Deferred contexts can only map dynamic resources with DISCARD (or NO_OVERWRITE for some),
+                // so the rest of the buffer cannot be preserved
+                if (m_IsDeferred)
+                {
+                    std::stringstream ss;
+                    ss << "Partial writes into CPU-writable buffer " << utils::DebugNameToString(buffer->desc.debugName)
+                        << " are not supported on deferred command lists";
+                    m_Context.error(ss.str());
+                    return;
+                }
+
                 mapType = D3D11_MAP_WRITE;
+            }
 
-            const HRESULT res = m_Context.immediateContext->Map(buffer->resource, 0, mapType, 0, &mappedData);
+            const HRESULT res = m_DeviceContext->Map(buffer->resource, 0, mapType, 0, &mappedData);
             if (FAILED(res))
             {
                 std::stringstream ss;
@@ -169,15 +250,47 @@ namespace nvrhi::d3d11
             }
 
             memcpy((char*)mappedData.pData + destOffsetBytes, data, dataSize);
-            m_Context.immediateContext->Unmap(buffer->resource, 0);
+            m_DeviceContext->Unmap(buffer->resource, 0);
         }
         else
         {
             D3D11_BOX box = { UINT(destOffsetBytes), 0, 0, UINT(destOffsetBytes + dataSize), 1, 1 };
             bool useBox = destOffsetBytes > 0 || dataSize < buffer->desc.byteSize;
 
-            m_Context.immediateContext->UpdateSubresource(buffer->resource, 0, useBox ? &box : nullptr, data, (UINT)dataSize, 0);
+            // When the driver does not support command lists natively, the runtime emulation of UpdateSubresource
+            // on deferred contexts applies the box offset to the source pointer as well, so compensate for that.
+            // See the remarks on ID3D11DeviceContext::UpdateSubresource.
+            const char* srcData = static_cast<const char*>(data);
+            if (useBox && m_IsDeferred && !m_Context.driverCommandLists)
+                srcData -= destOffsetBytes;
+
+            m_DeviceContext->UpdateSubresource(buffer->resource, 0, useBox ? &box : nullptr, srcData, (UINT)dataSize, 0);
+        }
+    }
+
+    void CommandList::writeRingConstantBuffer(Buffer* buffer, const void* data, size_t dataSize)
+    {
+        if (!m_ConstantBufferRing->buffer && !m_ConstantBufferRing->initialize(m_Context.device, m_Context.constantBufferRing->getSize()))
+        {
+            m_Context.error("Failed to create the constant buffer ring for a deferred command list");
+            return;
+        }
+
+        RingConstantBufferVersion& version = m_RingConstantBufferVersions[buffer];
+
+        if (!m_ConstantBufferRing->write(m_DeviceContext, data, dataSize, size_t(buffer->desc.byteSize), version.firstConstant))
+        {
+            std::stringstream ss;
+            ss << "Failed to write volatile constant buffer " << utils::DebugNameToString(buffer->desc.debugName)
+                << " into the constant buffer ring";
+            m_Context.error(ss.str());
+            return;
         }
+
+        version.generation = m_ConstantBufferRing->getGeneration();
+
+        if (data != version.data.data())
+            version.data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + dataSize);
     }
 
     void CommandList::clearBufferUInt(IBuffer* buffer, uint32_t clearValue)
@@ -191,7 +304,7 @@ namespace nvrhi::d3d11
         ID3D11UnorderedAccessView* uav = checked_cast<Buffer*>(buffer)->getUAV(Format::UNKNOWN, EntireBuffer, viewType);
 
         UINT clearValues[4] = { clearValue, clearValue, clearValue, clearValue };
-        m_Context.immediateContext->ClearUnorderedAccessViewUint(uav, clearValues);
+        m_DeviceContext->ClearUnorderedAccessViewUint(uav, clearValues);
     }
 
     void CommandList::copyBuffer(IBuffer* _dest, uint64_t destOffsetBytes, IBuffer* _src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes)
@@ -210,13 +323,11 @@ namespace nvrhi::d3d11
         srcBox.top = 0;
         srcBox.front = 0;
         srcBox.back = 1;
-        m_Context.immediateContext->CopySubresourceRegion(dest->resource, 0, (UINT)destOffsetBytes, 0, 0, src->resource, 0, &srcBox);
+        m_DeviceContext->CopySubresourceRegion(dest->resource, 0, (UINT)destOffsetBytes, 0, 0, src->resource, 0, &srcBox);
     }
     
-    void *Device::mapBuffer(IBuffer* _buffer, CpuAccessMode flags)
+    void *Device::mapBuffer(Buffer* buffer, CpuAccessMode flags, bool doNotWait)
     {
-        Buffer* buffer = checked_cast<Buffer*>(_buffer);
-
         D3D11_MAP mapType;
         switch(flags)  // NOLINT(clang-diagnostic-switch-enum)
         {
@@ -226,24 +337,55 @@ namespace nvrhi::d3d11
                 break;
 
             case CpuAccessMode::Write:
+            case CpuAccessMode::Discard:
                 assert(buffer->desc.cpuAccess == CpuAccessMode::Write);
                 mapType = D3D11_MAP_WRITE_DISCARD;
                 break;
 
+            case CpuAccessMode::NoOverwrite:
+                assert(buffer->desc.cpuAccess == CpuAccessMode::Write);
+                // Constant buffers only support no-overwrite maps on DX11.1 drivers that report it
+                mapType = (!buffer->desc.isConstantBuffer || m_Context.mapNoOverwriteOnDynamicConstantBuffer)
+                    ? D3D11_MAP_WRITE_NO_OVERWRITE
+                    : D3D11_MAP_WRITE_DISCARD;
+                break;
+
             default:
                 m_Context.error("Unsupported CpuAccessMode in mapBuffer");
                 return nullptr;
         }
 
+        // Dynamic buffers are renamed or not synchronized at all, so they never wait.
+        // DO_NOT_WAIT is only allowed for the staging buffers.
+        const UINT mapFlags = (doNotWait && mapType == D3D11_MAP_READ) ? D3D11_MAP_FLAG_DO_NOT_WAIT : 0;
+
         D3D11_MAPPED_SUBRESOURCE res;
-        if (SUCCEEDED(m_Context.immediateContext->Map(buffer->resource, 0, mapType, 0, &res)))
+        if (SUCCEEDED(m_Context.immediateContext->Map(buffer->resource, 0, mapType, mapFlags, &res)))
         {
             return res.pData;
         } else {
+            // DXGI_ERROR_WAS_STILL_DRAWING with DO_NOT_WAIT
             return nullptr;
         }
     }
 
+    void *Device::mapBuffer(IBuffer* _buffer, CpuAccessMode flags)
+    {
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        return mapBuffer(buffer, flags, false);
+    }
+
+    void *Device::tryMapBuffer(IBuffer* _buffer, CpuAccessMode flags, SubmissionId* outLastUse)
+    {
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        if (outLastUse)
+            *outLastUse = SubmissionId();
+
+        return mapBuffer(buffer, flags, true);
+    }
+
     void Device::unmapBuffer(IBuffer* _buffer)
     {
         Buffer* buffer = checked_cast<Buffer*>(_buffer);
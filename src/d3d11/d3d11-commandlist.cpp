@@ -22,15 +22,23 @@
 
 #include "d3d11-backend.h"
 #include <nvrhi/utils.h>
+#include <sstream>
+#include <iomanip>
 
 namespace nvrhi::d3d11
 {
-    CommandList::CommandList(const Context& context, IDevice* device, const CommandListParameters& params)
+    CommandList::CommandList(const Context& context, IDevice* device, const CommandListParameters& params, ID3D11DeviceContext* deferredContext)
         : m_Context(context)
         , m_Device(device)
         , m_Desc(params)
+        , m_DeviceContext(deferredContext ? deferredContext : context.immediateContext.Get())
+        , m_IsDeferred(deferredContext != nullptr)
     {
-        m_Context.immediateContext->QueryInterface(IID_PPV_ARGS(&m_UserDefinedAnnotation));
+        m_DeviceContext->QueryInterface(IID_PPV_ARGS(&m_DeviceContext1));
+        m_DeviceContext->QueryInterface(IID_PPV_ARGS(&m_UserDefinedAnnotation));
+
+        // Deferred contexts get their own ring, created on first use
+        m_ConstantBufferRing = m_IsDeferred ? &m_DeferredConstantBufferRing : context.constantBufferRing;
     }
 
     Object CommandList::getNativeObject(ObjectType objectType)
@@ -38,7 +46,7 @@ namespace nvrhi::d3d11
         switch (objectType)
         {
         case ObjectTypes::D3D11_DeviceContext:
-            return Object(m_Context.immediateContext);
+            return Object(m_DeviceContext);
         default:
             return nullptr;
         }
@@ -46,6 +54,17 @@ namespace nvrhi::d3d11
 
     void CommandList::open()
     {
+        m_AnyVolatileBufferWrites = false;
+
+        if (m_IsDeferred)
+        {
+            // Volatile CB versions of deferred lists only live until the command list is closed.
+            // The immediate list keeps them, because volatile CB contents persist between its recordings on DX11.
+            m_RingConstantBufferVersions.clear();
+            m_RecordedCommandList = nullptr;
+            m_ConstantBufferRing->reset();
+        }
+
         clearState();
     }
 
@@ -55,19 +74,36 @@ namespace nvrhi::d3d11
             leaveUAVOverlapSection();
 
         clearState();
+
+        if (m_IsDeferred)
+        {
+            // The deferred context state is reset by FinishCommandList, which matches the clearState above
+            const HRESULT res = m_DeviceContext->FinishCommandList(FALSE, &m_RecordedCommandList);
+            if (FAILED(res))
+            {
+                std::stringstream ss;
+                ss << "FinishCommandList call failed, HRESULT = 0x" << std::hex << std::setw(8) << res;
+                m_Context.error(ss.str());
+            }
+        }
     }
 
     void CommandList::clearState()
     {
-        m_Context.immediateContext->ClearState();
+        m_DeviceContext->ClearState();
 
 #if NVRHI_D3D11_WITH_NVAPI
         if (m_CurrentGraphicsStateValid && m_CurrentSinglePassStereoState.enabled)
         {
-            NvAPI_D3D_SetSinglePassStereoMode(m_Context.immediateContext, 1, 0, 0);
+            NvAPI_D3D_SetSinglePassStereoMode(m_DeviceContext, 1, 0, 0);
         }
 #endif
 
+        invalidateState();
+    }
+
+    void CommandList::invalidateState()
+    {
         m_CurrentGraphicsStateValid = false;
         m_CurrentComputeStateValid = false;
 
@@ -106,7 +142,7 @@ namespace nvrhi::d3d11
     {
 #if NVRHI_D3D11_WITH_NVAPI
         if (m_NumUAVOverlapCommands == 0)
-            NvAPI_D3D11_BeginUAVOverlap(m_Context.immediateContext);
+            NvAPI_D3D11_BeginUAVOverlap(m_DeviceContext);
 #endif
 
         m_NumUAVOverlapCommands += 1;
@@ -116,7 +152,7 @@ namespace nvrhi::d3d11
     {
 #if NVRHI_D3D11_WITH_NVAPI
         if (m_NumUAVOverlapCommands == 1)
-            NvAPI_D3D11_EndUAVOverlap(m_Context.immediateContext);
+            NvAPI_D3D11_EndUAVOverlap(m_DeviceContext);
 #endif
 
         m_NumUAVOverlapCommands = std::max(0, m_NumUAVOverlapCommands - 1);
@@ -141,18 +177,32 @@ namespace nvrhi::d3d11
         }
     }
     
-    static char g_PushConstantPaddingBuffer[c_MaxPushConstantSize] = {};
-
     void CommandList::setPushConstants(const void* data, size_t byteSize)
     {
         if (byteSize > c_MaxPushConstantSize)
             return;
 
-        memcpy(g_PushConstantPaddingBuffer, data, byteSize);
+        memcpy(m_PushConstantPaddingBuffer, data, byteSize);
 
-        m_Context.immediateContext->UpdateSubresource(
+        m_DeviceContext->UpdateSubresource(
             m_Context.pushConstantBuffer, 0, nullptr, 
-            g_PushConstantPaddingBuffer, 0, 0);
+            m_PushConstantPaddingBuffer, 0, 0);
+    }
+
+    void CommandList::setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings)
+    {
+        m_PushBindings.set(layoutIndex, bindings);
+    }
+
+    BindingSetHandle CommandList::createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+    {
+        // D3D11 binding sets only store the views, there are no descriptors to sub-allocate
+        return m_Device->createBindingSet(desc, layout);
+    }
+
+    void CommandList::executeBundles(ICommandList* const*, size_t)
+    {
+        utils::NotSupported();
     }
 
     void CommandList::setMeshletState(const MeshletState&)
@@ -165,6 +215,16 @@ namespace nvrhi::d3d11
         utils::NotSupported();
     }
 
+    void CommandList::dispatchMeshIndirect(uint32_t, uint32_t)
+    {
+        utils::NotSupported();
+    }
+
+    void CommandList::dispatchMeshIndirectCount(uint32_t, uint32_t, uint32_t)
+    {
+        utils::NotSupported();
+    }
+
     void CommandList::setRayTracingState(const rt::State&)
     {
         utils::NotSupported();
@@ -185,6 +245,11 @@ namespace nvrhi::d3d11
         utils::NotSupported();
     }
 
+    void CommandList::buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild*, size_t)
+    {
+        utils::NotSupported();
+    }
+
     void CommandList::compactBottomLevelAccelStructs()
     {
         utils::NotSupported();
@@ -199,4 +264,15 @@ namespace nvrhi::d3d11
     {
         utils::NotSupported();
     }
+
+    rt::InstanceDesc* CommandList::beginTopLevelInstanceWrite(rt::IAccelStruct*, size_t)
+    {
+        utils::NotSupported();
+        return nullptr;
+    }
+
+    void CommandList::commitTopLevelInstanceWrite(rt::IAccelStruct*, rt::AccelStructBuildFlags, rt::IAccelStruct* const*, size_t)
+    {
+        utils::NotSupported();
+    }
 } // namespace nvrhi::d3d11
@@ -28,6 +28,11 @@ namespace nvrhi::d3d11
 {
 
     ComputePipelineHandle Device::createComputePipeline(const ComputePipelineDesc& desc)
+    {
+        return m_ObjectCache.getComputePipeline(desc, [this, &desc] { return createComputePipelineInternal(desc); });
+    }
+
+    ComputePipelineHandle Device::createComputePipelineInternal(const ComputePipelineDesc& desc)
     {
         ComputePipeline *pso = new ComputePipeline();
         pso->desc = desc;
@@ -39,6 +44,15 @@ namespace nvrhi::d3d11
 
     void CommandList::setComputeState(const ComputeState& state)
     {
+        if (!m_PushBindings.empty() && state.pipeline)
+        {
+            ComputeState resolvedState = state;
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, nullptr))
+                setComputeState(resolvedState);
+            m_PushBindings.clear();
+            return;
+        }
+
         ComputePipeline* pso = checked_cast<ComputePipeline*>(state.pipeline);
 
         if (m_CurrentGraphicsStateValid)
@@ -53,7 +67,7 @@ namespace nvrhi::d3d11
         bool updatePipeline = !m_CurrentComputeStateValid || pso != m_CurrentComputePipeline;
         bool updateBindings = updatePipeline || arraysAreDifferent(m_CurrentBindings, state.bindings);
 
-        if (updatePipeline) m_Context.immediateContext->CSSetShader(pso->shader, nullptr, 0);
+        if (updatePipeline) m_DeviceContext->CSSetShader(pso->shader, nullptr, 0);
         if (updateBindings) bindComputeResourceSets(state.bindings, m_CurrentComputeStateValid ? &m_CurrentBindings : nullptr);
 
         m_CurrentIndirectBuffer = state.indirectParams;
@@ -70,21 +84,38 @@ namespace nvrhi::d3d11
 
             m_CurrentComputeStateValid = true;
         }
+
+        updateComputeVolatileBuffers();
+    }
+
+    void CommandList::updateComputeVolatileBuffers()
+    {
+        if (m_AnyVolatileBufferWrites && m_CurrentComputeStateValid)
+            updateVolatileConstantBuffers(ShaderType::Compute);
     }
 
     void CommandList::dispatch(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ)
     {
-        m_Context.immediateContext->Dispatch(groupsX, groupsY, groupsZ);
+        updateComputeVolatileBuffers();
+
+        m_DeviceContext->Dispatch(groupsX, groupsY, groupsZ);
     }
 
     void CommandList::dispatchIndirect(uint32_t offsetBytes)
     {
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentIndirectBuffer.Get());
         
+        updateComputeVolatileBuffers();
+
         if (indirectParams) // validation layer will issue an error otherwise
         {
-            m_Context.immediateContext->DispatchIndirect(indirectParams->resource, (UINT)offsetBytes);
+            m_DeviceContext->DispatchIndirect(indirectParams->resource, (UINT)offsetBytes);
         }
     }
 
+    void CommandList::executeIndirect(ICommandSignature*, uint32_t, uint32_t, uint32_t)
+    {
+        utils::NotSupported();
+    }
+
 } // nanmespace nvrhi::d3d11
\ No newline at end of file
@@ -88,6 +88,32 @@ namespace nvrhi::d3d11
             m_Context.error(ss.str());
         }
 
+        RefCountPtr<IDXGIDevice> dxgiDevice;
+        RefCountPtr<IDXGIAdapter> dxgiAdapter;
+        if (SUCCEEDED(m_Context.device->QueryInterface(IID_PPV_ARGS(&dxgiDevice))) && SUCCEEDED(dxgiDevice->GetAdapter(&dxgiAdapter)))
+        {
+            m_MemoryBudget.initialize(dxgiAdapter);
+        }
+
+        D3D11_FEATURE_DATA_THREADING threading = {};
+        if (SUCCEEDED(m_Context.device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading))))
+        {
+            m_Context.driverCommandLists = threading.DriverCommandLists != FALSE;
+        }
+
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        if (FAILED(m_Context.device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+            options = {};
+
+        m_Context.mapNoOverwriteOnDynamicConstantBuffer = options.MapNoOverwriteOnDynamicConstantBuffer != FALSE;
+
+        if (m_Context.immediateContext1 && desc.volatileConstantBufferRingSize != 0 &&
+            options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer &&
+            m_ConstantBufferRing.initialize(m_Context.device, desc.volatileConstantBufferRingSize))
+        {
+            m_Context.constantBufferRing = &m_ConstantBufferRing;
+        }
+
         m_ImmediateCommandList = CommandListHandle::Create(new CommandList(m_Context, this, CommandListParameters()));   
     }
 
@@ -119,21 +145,65 @@ namespace nvrhi::d3d11
 
     CommandListHandle Device::createCommandList(const CommandListParameters& params)
     {
-        if (!params.enableImmediateExecution)
+        if (params.queueType != CommandQueue::Graphics)
         {
-            m_Context.error("Deferred command lists are not supported by the D3D11 backend.");
+            m_Context.error("Non-graphics queues are not supported by the D3D11 backend.");
             return nullptr;
         }
 
-        if (params.queueType != CommandQueue::Graphics)
+        if (params.isBundle)
         {
-            m_Context.error("Non-graphics queues are not supported by the D3D11 backend.");
+            m_Context.error("Bundle command lists are not supported by the D3D11 backend.");
             return nullptr;
         }
+
+        if (!params.enableImmediateExecution)
+        {
+            // Deferred contexts are emulated by the runtime if the driver doesn't support command lists natively,
+            // which still allows recording on multiple threads but doesn't make the submission any cheaper.
+            RefCountPtr<ID3D11DeviceContext> deferredContext;
+            const HRESULT res = m_Context.device->CreateDeferredContext(0, &deferredContext);
+            if (FAILED(res))
+            {
+                std::stringstream ss;
+                ss << "CreateDeferredContext call failed, HRESULT = 0x" << std::hex << std::setw(8) << res;
+                m_Context.error(ss.str());
+                return nullptr;
+            }
+
+            return CommandListHandle::Create(new CommandList(m_Context, this, params, deferredContext));
+        }
         
         return m_ImmediateCommandList;
     }
 
+    uint64_t Device::executeCommandLists(ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue)
+    {
+        (void)executionQueue;
+
+        TraceScope traceScope(m_Context.traceRecorder.get(), "executeCommandLists", "Submission");
+        traceScope.setArg("commandLists", numCommandLists);
+
+        bool anyExecuted = false;
+
+        for (size_t i = 0; i < numCommandLists; i++)
+        {
+            // The immediate command list has already executed everything while recording
+            ID3D11CommandList* recorded = checked_cast<CommandList*>(pCommandLists[i])->getRecordedCommandList();
+            if (!recorded)
+                continue;
+
+            m_Context.immediateContext->ExecuteCommandList(recorded, FALSE);
+            anyExecuted = true;
+        }
+
+        // ExecuteCommandList with RestoreContextState = FALSE leaves the immediate context in the default state
+        if (anyExecuted)
+            checked_cast<CommandList*>(m_ImmediateCommandList.Get())->invalidateState();
+
+        return 0;
+    }
+
     bool Device::queryFeatureSupport(Feature feature, void* pInfo, size_t infoSize)
     {
         (void)pInfo;
@@ -142,7 +212,7 @@ namespace nvrhi::d3d11
         switch (feature)  // NOLINT(clang-diagnostic-switch-enum)
         {
         case Feature::DeferredCommandLists:
-            return false;
+            return true;
         case Feature::SinglePassStereo:
             return m_SinglePassStereoSupported;
         case Feature::FastGeometryShader:
@@ -155,6 +225,8 @@ namespace nvrhi::d3d11
 #endif
         case Feature::ConstantBufferRanges:
             return m_Context.immediateContext1 != nullptr;
+        case Feature::PipelineStatisticsQueries:
+            return true;
         default:
             return false;
         }
@@ -215,6 +287,22 @@ namespace nvrhi::d3d11
         return nullptr;
     }
 
+    CommandSignatureHandle Device::createCommandSignature(const CommandSignatureDesc&)
+    {
+        return nullptr;
+    }
+
+    bool Device::exportPipelineCache(std::vector<uint8_t>&)
+    {
+        // D3D11 drivers manage their shader caches internally
+        return false;
+    }
+
+    bool Device::importPipelineCache(const void*, size_t)
+    {
+        return false;
+    }
+
     rt::OpacityMicromapHandle Device::createOpacityMicromap(const rt::OpacityMicromapDesc& )
     {
         utils::NotSupported();
@@ -258,7 +346,30 @@ namespace nvrhi::d3d11
         resetEventQuery(m_WaitForIdleQuery);
     }
 
-    SamplerHandle Device::createSampler(const SamplerDesc& d)
+    void Device::runGarbageCollection()
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "runGarbageCollection", "GarbageCollection");
+
+        m_ObjectCache.collectGarbage();
+
+        if (m_MemoryBudget.pollBudgetChange() && m_MemoryBudgetCallback)
+            m_MemoryBudgetCallback->memoryBudgetChanged(getMemoryStatistics());
+    }
+
+    MemoryStatistics Device::getMemoryStatistics()
+    {
+        // The D3D11 backend doesn't allocate any memory of its own beyond regular resources
+        MemoryStatistics statistics;
+        m_MemoryBudget.queryHeaps(statistics);
+        return statistics;
+    }
+
+    SamplerHandle Device::createSampler(const SamplerDesc& desc)
+    {
+        return m_ObjectCache.getSampler(desc, [this, &desc] { return createSamplerInternal(desc); });
+    }
+
+    SamplerHandle Device::createSamplerInternal(const SamplerDesc& d)
     {
         D3D11_SAMPLER_DESC desc11;
 
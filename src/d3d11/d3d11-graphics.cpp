@@ -51,6 +51,11 @@ namespace nvrhi::d3d11
     }
     
     GraphicsPipelineHandle Device::createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb)
+    {
+        return m_ObjectCache.getGraphicsPipeline(desc, fb, [this, &desc, fb] { return createGraphicsPipelineInternal(desc, fb); });
+    }
+
+    GraphicsPipelineHandle Device::createGraphicsPipelineInternal(const GraphicsPipelineDesc& desc, IFramebuffer* fb)
     {
         const RenderState& renderState = desc.renderState;
 
@@ -106,16 +111,16 @@ namespace nvrhi::d3d11
 
     void CommandList::bindGraphicsPipeline(const GraphicsPipeline* pso) const
     {
-        m_Context.immediateContext->IASetPrimitiveTopology(pso->primitiveTopology);
-        m_Context.immediateContext->IASetInputLayout(pso->inputLayout ? pso->inputLayout->layout : nullptr);
+        m_DeviceContext->IASetPrimitiveTopology(pso->primitiveTopology);
+        m_DeviceContext->IASetInputLayout(pso->inputLayout ? pso->inputLayout->layout : nullptr);
 
-        m_Context.immediateContext->RSSetState(pso->pRS);
+        m_DeviceContext->RSSetState(pso->pRS);
 
-        m_Context.immediateContext->VSSetShader(pso->pVS, nullptr, 0);
-        m_Context.immediateContext->HSSetShader(pso->pHS, nullptr, 0);
-        m_Context.immediateContext->DSSetShader(pso->pDS, nullptr, 0);
-        m_Context.immediateContext->GSSetShader(pso->pGS, nullptr, 0);
-        m_Context.immediateContext->PSSetShader(pso->pPS, nullptr, 0);
+        m_DeviceContext->VSSetShader(pso->pVS, nullptr, 0);
+        m_DeviceContext->HSSetShader(pso->pHS, nullptr, 0);
+        m_DeviceContext->DSSetShader(pso->pDS, nullptr, 0);
+        m_DeviceContext->GSSetShader(pso->pGS, nullptr, 0);
+        m_DeviceContext->PSSetShader(pso->pPS, nullptr, 0);
     }
 
     static DX11_ViewportState convertViewportState(const ViewportState& vpState)
@@ -145,8 +150,35 @@ namespace nvrhi::d3d11
         return ret;
     }
 
+    GraphicsStateBlockHandle Device::createGraphicsStateBlock(const GraphicsState& state)
+    {
+        if (!state.pipeline || !state.framebuffer)
+        {
+            m_Context.error("createGraphicsStateBlock: pipeline or framebuffer is NULL");
+            return nullptr;
+        }
+
+        return GraphicsStateBlockHandle::Create(new GraphicsStateBlock(state));
+    }
+
+    void CommandList::setGraphicsStateBlock(IGraphicsStateBlock* block)
+    {
+        // The D3D11 state comparison is already cheap compared to the driver overhead, so there is nothing to bake.
+        setGraphicsState(block->getState());
+    }
+
     void CommandList::setGraphicsState(const GraphicsState& state)
     {
+        if (!m_PushBindings.empty() && state.pipeline)
+        {
+            // D3D11 has no push descriptors, so the pushed bindings become regular binding sets
+            GraphicsState resolvedState = state;
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, nullptr))
+                setGraphicsState(resolvedState);
+            m_PushBindings.clear();
+            return;
+        }
+
         GraphicsPipeline* pipeline = checked_cast<GraphicsPipeline*>(state.pipeline);
         Framebuffer* framebuffer = checked_cast<Framebuffer*>(state.framebuffer);
 
@@ -191,14 +223,14 @@ namespace nvrhi::d3d11
 
             if (pipeline->pixelShaderHasUAVs)
             {
-                m_Context.immediateContext->OMSetRenderTargetsAndUnorderedAccessViews(
+                m_DeviceContext->OMSetRenderTargetsAndUnorderedAccessViews(
                     UINT(RTVs.size()), RTVs.data(),
                     framebuffer->DSV,
                     D3D11_KEEP_UNORDERED_ACCESS_VIEWS, 0, nullptr, nullptr);
             }
             else
             {
-                m_Context.immediateContext->OMSetRenderTargets(
+                m_DeviceContext->OMSetRenderTargets(
                     UINT(RTVs.size()),RTVs.data(),
                     framebuffer->DSV);
             }
@@ -214,13 +246,13 @@ namespace nvrhi::d3d11
             m_CurrentStencilRefValue = pipeline->desc.renderState.depthStencilState.dynamicStencilRef
                 ? state.dynamicStencilRefValue
                 : pipeline->desc.renderState.depthStencilState.stencilRefValue;
-            m_Context.immediateContext->OMSetDepthStencilState(pipeline->pDepthStencilState, m_CurrentStencilRefValue);
+            m_DeviceContext->OMSetDepthStencilState(pipeline->pDepthStencilState, m_CurrentStencilRefValue);
         }
 
         if (updatePipeline || updateBlendState)
         {
             float blendFactor[4]{ state.blendConstantColor.r, state.blendConstantColor.g, state.blendConstantColor.b, state.blendConstantColor.a };
-            m_Context.immediateContext->OMSetBlendState(pipeline->pBlendState, blendFactor, D3D11_DEFAULT_SAMPLE_MASK);
+            m_DeviceContext->OMSetBlendState(pipeline->pBlendState, blendFactor, D3D11_DEFAULT_SAMPLE_MASK);
         }
 
         if (updateBindings)
@@ -248,7 +280,7 @@ namespace nvrhi::d3d11
                     maxUAVSlot = std::max(maxUAVSlot, bindingSet->maxUAVSlot);
                 }
 
-                m_Context.immediateContext->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr, minUAVSlot, maxUAVSlot - minUAVSlot + 1, UAVs + minUAVSlot, initialCounts);
+                m_DeviceContext->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr, minUAVSlot, maxUAVSlot - minUAVSlot + 1, UAVs + minUAVSlot, initialCounts);
             }
         }
 
@@ -258,12 +290,12 @@ namespace nvrhi::d3d11
 
             if (vpState.numViewports)
             {
-                m_Context.immediateContext->RSSetViewports(vpState.numViewports, vpState.viewports);
+                m_DeviceContext->RSSetViewports(vpState.numViewports, vpState.viewports);
             }
 
             if (vpState.numScissorRects)
             {
-                m_Context.immediateContext->RSSetScissorRects(vpState.numScissorRects, vpState.scissorRects);
+                m_DeviceContext->RSSetScissorRects(vpState.numScissorRects, vpState.scissorRects);
             }
         }
 
@@ -274,7 +306,7 @@ namespace nvrhi::d3d11
         {
             const SinglePassStereoState& spsState = pipeline->desc.renderState.singlePassStereo;
 
-            NvAPI_Status Status = NvAPI_D3D_SetSinglePassStereoMode(m_Context.immediateContext, spsState.enabled ? 2 : 1, spsState.renderTargetIndexOffset, spsState.independentViewportMask);
+            NvAPI_Status Status = NvAPI_D3D_SetSinglePassStereoMode(m_DeviceContext, spsState.enabled ? 2 : 1, spsState.renderTargetIndexOffset, spsState.independentViewportMask);
 
             if (Status != NVAPI_OK)
             {
@@ -318,7 +350,7 @@ namespace nvrhi::d3d11
                 }
             }
 
-            m_Context.immediateContext->IASetVertexBuffers(0, maxVbIndex + 1,
+            m_DeviceContext->IASetVertexBuffers(0, maxVbIndex + 1,
                 pVertexBuffers,
                 pVertexBufferStrides,
                 pVertexBufferOffsets);
@@ -328,13 +360,13 @@ namespace nvrhi::d3d11
         {
             if (state.indexBuffer.buffer)
             {
-                m_Context.immediateContext->IASetIndexBuffer(checked_cast<Buffer*>(state.indexBuffer.buffer)->resource,
+                m_DeviceContext->IASetIndexBuffer(checked_cast<Buffer*>(state.indexBuffer.buffer)->resource,
                     getDxgiFormatMapping(state.indexBuffer.format).srvFormat,
                     state.indexBuffer.offset);
             }
             else
             {
-                m_Context.immediateContext->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN, 0);
+                m_DeviceContext->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN, 0);
             }
         }
 
@@ -364,28 +396,88 @@ namespace nvrhi::d3d11
             }
             m_CurrentIndexBuffer = state.indexBuffer.buffer;
         }
+
+        updateGraphicsVolatileBuffers();
+    }
+
+    void CommandList::updateGraphicsVolatileBuffers()
+    {
+        if (m_AnyVolatileBufferWrites && m_CurrentGraphicsStateValid)
+            updateVolatileConstantBuffers(checked_cast<GraphicsPipeline*>(m_CurrentGraphicsPipeline.Get())->shaderMask);
     }
 
     void CommandList::draw(const DrawArguments& args)
     {
-        m_Context.immediateContext->DrawInstanced(args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
+        updateGraphicsVolatileBuffers();
+
+        m_DeviceContext->DrawInstanced(args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
     }
 
     void CommandList::drawIndexed(const DrawArguments& args)
     {
-        m_Context.immediateContext->DrawIndexedInstanced(args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
+        updateGraphicsVolatileBuffers();
+
+        m_DeviceContext->DrawIndexedInstanced(args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
+    }
+
+    void CommandList::drawMulti(const MultiDrawArguments& multiDraw)
+    {
+        drawMultiInternal(multiDraw, false);
+    }
+
+    void CommandList::drawIndexedMulti(const MultiDrawArguments& multiDraw)
+    {
+        drawMultiInternal(multiDraw, true);
+    }
+
+    void CommandList::drawMultiInternal(const MultiDrawArguments& multiDraw, bool indexed)
+    {
+        const uint8_t* pushConstants = static_cast<const uint8_t*>(multiDraw.pushConstants);
+
+        for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+        {
+            if (multiDraw.bindingSets && multiDraw.bindingSets[drawIndex] != m_CurrentBindings[multiDraw.bindingSetIndex])
+            {
+                BindingSetVector bindings;
+                for (const BindingSetHandle& bindingSet : m_CurrentBindings)
+                    bindings.push_back(bindingSet);
+                bindings[multiDraw.bindingSetIndex] = multiDraw.bindingSets[drawIndex];
+
+                BindingSetVector setsToBind;
+                prepareToBindGraphicsResourceSets(bindings, &m_CurrentBindings, m_CurrentGraphicsPipeline, m_CurrentGraphicsPipeline, false, setsToBind);
+                bindGraphicsResourceSets(setsToBind, m_CurrentGraphicsPipeline);
+
+                m_CurrentBindings[multiDraw.bindingSetIndex] = multiDraw.bindingSets[drawIndex];
+            }
+
+            if (pushConstants)
+            {
+                setPushConstants(pushConstants + size_t(drawIndex) * multiDraw.pushConstantsStride, multiDraw.pushConstantsByteSize);
+            }
+
+            updateGraphicsVolatileBuffers();
+
+            const DrawArguments& args = multiDraw.args[drawIndex];
+
+            if (indexed)
+                m_DeviceContext->DrawIndexedInstanced(args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
+            else
+                m_DeviceContext->DrawInstanced(args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
+        }
     }
 
     void CommandList::drawIndirect(uint32_t offsetBytes, uint32_t drawCount)
     {
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentIndirectBuffer.Get());
         
+        updateGraphicsVolatileBuffers();
+
         if (indirectParams) // validation layer will issue an error otherwise
         {
             // Simulate multi-command D3D12 ExecuteIndirect or Vulkan vkCmdDrawIndirect with a loop
             for (uint32_t drawIndex = 0; drawIndex < drawCount; ++drawIndex)
             {
-                m_Context.immediateContext->DrawInstancedIndirect(indirectParams->resource, offsetBytes);
+                m_DeviceContext->DrawInstancedIndirect(indirectParams->resource, offsetBytes);
                 offsetBytes += sizeof(DrawIndirectArguments);
             }
         }
@@ -395,17 +487,37 @@ namespace nvrhi::d3d11
     {
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentIndirectBuffer.Get());
 
+        updateGraphicsVolatileBuffers();
+
         if (indirectParams)
         {
             // Simulate multi-command D3D12 ExecuteIndirect or Vulkan vkCmdDrawIndirect with a loop
             for (uint32_t drawIndex = 0; drawIndex < drawCount; ++drawIndex)
             {
-                m_Context.immediateContext->DrawIndexedInstancedIndirect(indirectParams->resource, offsetBytes);
+                m_DeviceContext->DrawIndexedInstancedIndirect(indirectParams->resource, offsetBytes);
                 offsetBytes += sizeof(DrawIndexedIndirectArguments);
             }
         }
     }
 
+    void CommandList::drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        (void)offsetBytes;
+        (void)countOffsetBytes;
+        (void)maxDrawCount;
+
+        utils::NotSupported();
+    }
+
+    void CommandList::drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        (void)offsetBytes;
+        (void)countOffsetBytes;
+        (void)maxDrawCount;
+
+        utils::NotSupported();
+    }
+
     namespace
     {
         //Unfortunately we can't memcmp the structs since they have padding bytes in them
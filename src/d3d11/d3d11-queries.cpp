@@ -159,8 +159,8 @@ void CommandList::beginTimerQuery(ITimerQuery* _query)
     TimerQuery* query = checked_cast<TimerQuery*>(_query);
 
     assert(!query->resolved);
-    m_Context.immediateContext->Begin(query->disjoint.Get());
-    m_Context.immediateContext->End(query->start.Get());
+    m_DeviceContext->Begin(query->disjoint.Get());
+    m_DeviceContext->End(query->start.Get());
 }
 
 void CommandList::endTimerQuery(ITimerQuery* _query)
@@ -168,8 +168,8 @@ void CommandList::endTimerQuery(ITimerQuery* _query)
     TimerQuery* query = checked_cast<TimerQuery*>(_query);
 
     assert(!query->resolved);
-    m_Context.immediateContext->End(query->end.Get());
-    m_Context.immediateContext->End(query->disjoint.Get());
+    m_DeviceContext->End(query->end.Get());
+    m_DeviceContext->End(query->disjoint.Get());
 }
 
 bool Device::pollTimerQuery(ITimerQuery* _query)
@@ -243,4 +243,186 @@ void Device::resetTimerQuery(ITimerQuery* _query)
     query->time = 0.f;
 }
 
+static_assert(sizeof(PipelineStatistics) == sizeof(D3D11_QUERY_DATA_PIPELINE_STATISTICS),
+    "PipelineStatistics must match D3D11_QUERY_DATA_PIPELINE_STATISTICS");
+
+OcclusionQueryHandle Device::createOcclusionQuery(const OcclusionQueryDesc& desc)
+{
+    OcclusionQuery *ret = new OcclusionQuery();
+    ret->desc = desc;
+
+    D3D11_QUERY_DESC queryDesc;
+    queryDesc.Query = desc.binary ? D3D11_QUERY_OCCLUSION_PREDICATE : D3D11_QUERY_OCCLUSION;
+    queryDesc.MiscFlags = 0;
+
+    if (!checkedCreateQuery(queryDesc, "OcclusionQuery", m_Context, &ret->query))
+    {
+        delete ret;
+        return nullptr;
+    }
+
+    return OcclusionQueryHandle::Create(ret);
+}
+
+void CommandList::beginOcclusionQuery(IOcclusionQuery* _query)
+{
+    OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+    query->resolved = false;
+    m_DeviceContext->Begin(query->query.Get());
+}
+
+void CommandList::endOcclusionQuery(IOcclusionQuery* _query)
+{
+    OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+    m_DeviceContext->End(query->query.Get());
+    query->started = true;
+}
+
+bool Device::pollOcclusionQuery(IOcclusionQuery* _query)
+{
+    OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+    if (!query->started)
+        return false;
+
+    if (query->resolved)
+        return true;
+
+    HRESULT hr;
+
+    if (query->desc.binary)
+    {
+        BOOL passed = FALSE;
+        hr = m_Context.immediateContext->GetData(query->query.Get(), &passed, sizeof(passed), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        query->result = passed ? 1 : 0;
+    }
+    else
+    {
+        UINT64 samples = 0;
+        hr = m_Context.immediateContext->GetData(query->query.Get(), &samples, sizeof(samples), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        query->result = samples;
+    }
+
+    if (hr == S_OK)
+    {
+        query->resolved = true;
+        return true;
+    }
+
+    return false;
+}
+
+uint64_t Device::getOcclusionQueryResult(IOcclusionQuery* _query)
+{
+    OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+    if (!query->started)
+        return 0;
+
+    if (!query->resolved)
+    {
+        // Flush once, then spin without flushing
+        m_Context.immediateContext->Flush();
+
+        while (!pollOcclusionQuery(query))
+            ;
+    }
+
+    return query->result;
+}
+
+void Device::resetOcclusionQuery(IOcclusionQuery* _query)
+{
+    OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+    query->started = false;
+    query->resolved = false;
+    query->result = 0;
+}
+
+PipelineStatisticsQueryHandle Device::createPipelineStatisticsQuery()
+{
+    PipelineStatisticsQuery *ret = new PipelineStatisticsQuery();
+
+    D3D11_QUERY_DESC queryDesc;
+    queryDesc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+    queryDesc.MiscFlags = 0;
+
+    if (!checkedCreateQuery(queryDesc, "PipelineStatisticsQuery", m_Context, &ret->query))
+    {
+        delete ret;
+        return nullptr;
+    }
+
+    return PipelineStatisticsQueryHandle::Create(ret);
+}
+
+void CommandList::beginPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+{
+    PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+    query->resolved = false;
+    m_DeviceContext->Begin(query->query.Get());
+}
+
+void CommandList::endPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+{
+    PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+    m_DeviceContext->End(query->query.Get());
+    query->started = true;
+}
+
+bool Device::pollPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+{
+    PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+    if (!query->started)
+        return false;
+
+    if (query->resolved)
+        return true;
+
+    D3D11_QUERY_DATA_PIPELINE_STATISTICS data = {};
+    const HRESULT hr = m_Context.immediateContext->GetData(query->query.Get(), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+    if (hr == S_OK)
+    {
+        memcpy(&query->result, &data, sizeof(data));
+        query->resolved = true;
+        return true;
+    }
+
+    return false;
+}
+
+PipelineStatistics Device::getPipelineStatistics(IPipelineStatisticsQuery* _query)
+{
+    PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+    if (!query->started)
+        return PipelineStatistics();
+
+    if (!query->resolved)
+    {
+        m_Context.immediateContext->Flush();
+
+        while (!pollPipelineStatisticsQuery(query))
+            ;
+    }
+
+    return query->result;
+}
+
+void Device::resetPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+{
+    PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+    query->started = false;
+    query->resolved = false;
+    query->result = PipelineStatistics();
+}
+
 } // namespace nvrhi::d3d11
\ No newline at end of file
@@ -26,6 +26,8 @@
 #include <nvrhi/utils.h>
 
 #include <algorithm>
+#include <iterator>
+#include <sstream>
 
 
 namespace nvrhi::d3d11
@@ -44,6 +46,11 @@ BindingLayoutHandle Device::createBindlessLayout(const BindlessLayoutDesc&)
 }
 
 BindingSetHandle Device::createBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+{
+    return m_ObjectCache.getBindingSet(desc, layout, [this, &desc, layout] { return createBindingSetInternal(desc, layout); });
+}
+
+BindingSetHandle Device::createBindingSetInternal(const BindingSetDesc& desc, IBindingLayout* layout)
 {
     BindingSet *ret = new BindingSet();
     ret->desc = desc;
@@ -127,6 +134,10 @@ BindingSetHandle Device::createBindingSet(const BindingSetDesc& desc, IBindingLa
             ret->constantBufferOffsets[slot] = (UINT)range.byteOffset / sizeOfConstantInBytes;
             ret->constantBufferCounts[slot] = align((UINT)range.byteSize, c_ConstantBufferOffsetSizeAlignment) / sizeOfConstantInBytes;
 
+            // The location of the ring versions is only known at bind time
+            if (buffer->inConstantBufferRing)
+                ret->ringConstantBuffers.push_back({ buffer, slot, ret->constantBufferOffsets[slot] });
+
             ret->minConstantBufferSlot = std::min(ret->minConstantBufferSlot, slot);
             ret->maxConstantBufferSlot = std::max(ret->maxConstantBufferSlot, slot);
         }
@@ -191,6 +202,12 @@ bool Device::writeDescriptorTable(IDescriptorTable*, const BindingSetItem&)
     return false;
 }
 
+bool Device::writeDescriptorTable(IDescriptorTable*, const BindingSetItem*, size_t)
+{
+    utils::NotSupported();
+    return false;
+}
+
 static ID3D11Buffer *NullCBs[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = { nullptr };
 static ID3D11ShaderResourceView *NullSRVs[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = { nullptr };
 static ID3D11SamplerState *NullSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT] = { nullptr };
@@ -207,10 +224,10 @@ bool BindingSet::isSupersetOf(const BindingSet& other) const
 
 #define D3D11_SET_ARRAY(method, min, max, array) \
         if ((max) >= (min)) \
-            m_Context.immediateContext->method(min, ((max) - (min) + 1), &(array)[min])
+            m_DeviceContext->method(min, ((max) - (min) + 1), &(array)[min])
 #define D3D11_SET_ARRAY1(method, min, max, array, offsets, counts) \
         if ((max) >= (min)) \
-            m_Context.immediateContext1->method(min, ((max) - (min) + 1), &(array)[min], &(offsets)[min], &(counts)[min])
+            m_DeviceContext1->method(min, ((max) - (min) + 1), &(array)[min], &(offsets)[min], &(counts)[min])
 
 void CommandList::prepareToBindGraphicsResourceSets(
     const BindingSetVector& resourceSets, 
@@ -316,9 +333,103 @@ void CommandList::prepareToBindGraphicsResourceSets(
 }
 
 
+UINT CommandList::getRingConstantBufferOffset(const BindingSet::RingConstantBuffer& ringBuffer)
+{
+    auto found = m_RingConstantBufferVersions.find(ringBuffer.buffer);
+    if (found == m_RingConstantBufferVersions.end())
+    {
+        std::stringstream ss;
+        ss << "Binding volatile constant buffer " << utils::DebugNameToString(ringBuffer.buffer->desc.debugName)
+           << " before writing into it is invalid.";
+        m_Context.error(ss.str());
+        return ringBuffer.rangeOffset;
+    }
+
+    // The ring has been discarded since the version was written, restore it from the CPU copy
+    RingConstantBufferVersion& version = found->second;
+    if (version.generation != m_ConstantBufferRing->getGeneration())
+        writeRingConstantBuffer(ringBuffer.buffer, version.data.data(), version.data.size());
+
+    return version.firstConstant + ringBuffer.rangeOffset;
+}
+
+// The stages that have their own constant buffer slots, in the order of m_BoundRingConstantBufferOffsets
+static const ShaderType c_ConstantBufferStages[] = {
+    ShaderType::Vertex, ShaderType::Hull, ShaderType::Domain, ShaderType::Geometry, ShaderType::Pixel, ShaderType::Compute
+};
+
+void CommandList::resolveConstantBuffers(const BindingSet* set, ShaderType stages, ID3D11Buffer** outBuffers, UINT* outOffsets)
+{
+    for (uint32_t slot = set->minConstantBufferSlot; slot <= set->maxConstantBufferSlot; slot++)
+    {
+        outBuffers[slot] = set->constantBuffers[slot];
+        outOffsets[slot] = set->constantBufferOffsets[slot];
+    }
+
+    for (const BindingSet::RingConstantBuffer& ringBuffer : set->ringConstantBuffers)
+    {
+        const UINT offset = getRingConstantBufferOffset(ringBuffer);
+        outBuffers[ringBuffer.slot] = m_ConstantBufferRing->buffer;
+        outOffsets[ringBuffer.slot] = offset;
+
+        for (uint32_t stageIndex = 0; stageIndex < uint32_t(std::size(c_ConstantBufferStages)); stageIndex++)
+        {
+            if ((stages & c_ConstantBufferStages[stageIndex]) != 0)
+                m_BoundRingConstantBufferOffsets[stageIndex][ringBuffer.slot] = offset;
+        }
+    }
+}
+
+void CommandList::updateVolatileConstantBuffers(ShaderType stages)
+{
+    if (!m_AnyVolatileBufferWrites)
+        return;
+
+    m_AnyVolatileBufferWrites = false;
+
+    for (const BindingSetHandle& _set : m_CurrentBindings)
+    {
+        BindingSet* set = checked_cast<BindingSet*>(_set.Get());
+
+        if (!set)
+            continue;
+
+        const ShaderType stagesToBind = set->visibility & stages;
+
+        // Only touch the slots whose versions have actually changed since they were bound
+        for (const BindingSet::RingConstantBuffer& ringBuffer : set->ringConstantBuffers)
+        {
+            const uint32_t slot = ringBuffer.slot;
+            UINT offset = getRingConstantBufferOffset(ringBuffer);
+            ID3D11Buffer* buffer = m_ConstantBufferRing->buffer;
+            const UINT* count = &set->constantBufferCounts[slot];
+
+            for (uint32_t stageIndex = 0; stageIndex < uint32_t(std::size(c_ConstantBufferStages)); stageIndex++)
+            {
+                const ShaderType stage = c_ConstantBufferStages[stageIndex];
+                if ((stagesToBind & stage) == 0 || offset == m_BoundRingConstantBufferOffsets[stageIndex][slot])
+                    continue;
+
+                m_BoundRingConstantBufferOffsets[stageIndex][slot] = offset;
+
+                switch (stage)
+                {
+                case ShaderType::Vertex:   m_DeviceContext1->VSSetConstantBuffers1(slot, 1, &buffer, &offset, count); break;
+                case ShaderType::Hull:     m_DeviceContext1->HSSetConstantBuffers1(slot, 1, &buffer, &offset, count); break;
+                case ShaderType::Domain:   m_DeviceContext1->DSSetConstantBuffers1(slot, 1, &buffer, &offset, count); break;
+                case ShaderType::Geometry: m_DeviceContext1->GSSetConstantBuffers1(slot, 1, &buffer, &offset, count); break;
+                case ShaderType::Pixel:    m_DeviceContext1->PSSetConstantBuffers1(slot, 1, &buffer, &offset, count); break;
+                case ShaderType::Compute:  m_DeviceContext1->CSSetConstantBuffers1(slot, 1, &buffer, &offset, count); break;
+                default: break;
+                }
+            }
+        }
+    }
+}
+
 void CommandList::bindGraphicsResourceSets(
     const BindingSetVector& setsToBind,
-    const IGraphicsPipeline* newPipeline) const
+    const IGraphicsPipeline* newPipeline)
 {
     for(IBindingSet* _set : setsToBind)
     {
@@ -330,52 +441,56 @@ void CommandList::bindGraphicsResourceSets(
 
         ShaderType stagesToBind = set->visibility & pipeline->shaderMask;
 
+        ID3D11Buffer* constantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+        UINT constantBufferOffsets[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+        resolveConstantBuffers(set, stagesToBind, constantBuffers, constantBufferOffsets);
+
         if ((stagesToBind & ShaderType::Vertex) != 0)
         {
-            if (m_Context.immediateContext1)
-                D3D11_SET_ARRAY1(VSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers, set->constantBufferOffsets, set->constantBufferCounts);
+            if (m_DeviceContext1)
+                D3D11_SET_ARRAY1(VSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers, constantBufferOffsets, set->constantBufferCounts);
             else
-                D3D11_SET_ARRAY(VSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers);
+                D3D11_SET_ARRAY(VSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers);
             D3D11_SET_ARRAY(VSSetShaderResources, set->minSRVSlot, set->maxSRVSlot, set->SRVs);
             D3D11_SET_ARRAY(VSSetSamplers, set->minSamplerSlot, set->maxSamplerSlot, set->samplers);
         }
 
         if ((stagesToBind & ShaderType::Hull) != 0)
         {
-            if (m_Context.immediateContext1)
-                D3D11_SET_ARRAY1(HSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers, set->constantBufferOffsets, set->constantBufferCounts);
+            if (m_DeviceContext1)
+                D3D11_SET_ARRAY1(HSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers, constantBufferOffsets, set->constantBufferCounts);
             else
-                D3D11_SET_ARRAY(HSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers);
+                D3D11_SET_ARRAY(HSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers);
             D3D11_SET_ARRAY(HSSetShaderResources, set->minSRVSlot, set->maxSRVSlot, set->SRVs);
             D3D11_SET_ARRAY(HSSetSamplers, set->minSamplerSlot, set->maxSamplerSlot, set->samplers);
         }
 
         if ((stagesToBind & ShaderType::Domain) != 0)
         {
-            if (m_Context.immediateContext1)
-                D3D11_SET_ARRAY1(DSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers, set->constantBufferOffsets, set->constantBufferCounts);
+            if (m_DeviceContext1)
+                D3D11_SET_ARRAY1(DSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers, constantBufferOffsets, set->constantBufferCounts);
             else
-                D3D11_SET_ARRAY(DSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers);
+                D3D11_SET_ARRAY(DSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers);
             D3D11_SET_ARRAY(DSSetShaderResources, set->minSRVSlot, set->maxSRVSlot, set->SRVs);
             D3D11_SET_ARRAY(DSSetSamplers, set->minSamplerSlot, set->maxSamplerSlot, set->samplers);
         }
 
         if ((stagesToBind & ShaderType::Geometry) != 0)
         {
-            if (m_Context.immediateContext1)
-                D3D11_SET_ARRAY1(GSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers, set->constantBufferOffsets, set->constantBufferCounts);
+            if (m_DeviceContext1)
+                D3D11_SET_ARRAY1(GSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers, constantBufferOffsets, set->constantBufferCounts);
             else
-                D3D11_SET_ARRAY(GSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers);
+                D3D11_SET_ARRAY(GSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers);
             D3D11_SET_ARRAY(GSSetShaderResources, set->minSRVSlot, set->maxSRVSlot, set->SRVs);
             D3D11_SET_ARRAY(GSSetSamplers, set->minSamplerSlot, set->maxSamplerSlot, set->samplers);
         }
 
         if ((stagesToBind & ShaderType::Pixel) != 0)
         {
-            if (m_Context.immediateContext1)
-                D3D11_SET_ARRAY1(PSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers, set->constantBufferOffsets, set->constantBufferCounts);
+            if (m_DeviceContext1)
+                D3D11_SET_ARRAY1(PSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers, constantBufferOffsets, set->constantBufferCounts);
             else
-                D3D11_SET_ARRAY(PSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers);
+                D3D11_SET_ARRAY(PSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers);
             D3D11_SET_ARRAY(PSSetShaderResources, set->minSRVSlot, set->maxSRVSlot, set->SRVs);
             D3D11_SET_ARRAY(PSSetSamplers, set->minSamplerSlot, set->maxSamplerSlot, set->samplers);
         }
@@ -384,7 +499,7 @@ void CommandList::bindGraphicsResourceSets(
 
 void CommandList::bindComputeResourceSets(
     const BindingSetVector& resourceSets,
-    const static_vector<BindingSetHandle,c_MaxBindingLayouts>* currentResourceSets) const
+    const static_vector<BindingSetHandle,c_MaxBindingLayouts>* currentResourceSets)
 {
     BindingSetVector setsToBind = resourceSets;
 
@@ -442,7 +557,7 @@ void CommandList::bindComputeResourceSets(
 
             if (set->maxUAVSlot >= set->minUAVSlot)
             {
-                m_Context.immediateContext->CSSetUnorderedAccessViews(set->minUAVSlot,
+                m_DeviceContext->CSSetUnorderedAccessViews(set->minUAVSlot,
                     set->maxUAVSlot - set->minUAVSlot + 1,
                     NullUAVs,
                     NullUAVInitialCounts);
@@ -457,16 +572,20 @@ void CommandList::bindComputeResourceSets(
         if ((set->visibility & ShaderType::Compute) == 0)
             continue;
 
-        if (m_Context.immediateContext1)
-            D3D11_SET_ARRAY1(CSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers, set->constantBufferOffsets, set->constantBufferCounts);
+        ID3D11Buffer* constantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+        UINT constantBufferOffsets[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+        resolveConstantBuffers(set, ShaderType::Compute, constantBuffers, constantBufferOffsets);
+
+        if (m_DeviceContext1)
+            D3D11_SET_ARRAY1(CSSetConstantBuffers1, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers, constantBufferOffsets, set->constantBufferCounts);
         else
-            D3D11_SET_ARRAY(CSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, set->constantBuffers);
+            D3D11_SET_ARRAY(CSSetConstantBuffers, set->minConstantBufferSlot, set->maxConstantBufferSlot, constantBuffers);
         D3D11_SET_ARRAY(CSSetShaderResources, set->minSRVSlot, set->maxSRVSlot, set->SRVs);
         D3D11_SET_ARRAY(CSSetSamplers, set->minSamplerSlot, set->maxSamplerSlot, set->samplers);
 
         if (set->maxUAVSlot >= set->minUAVSlot)
         {
-            m_Context.immediateContext->CSSetUnorderedAccessViews(set->minUAVSlot,
+            m_DeviceContext->CSSetUnorderedAccessViews(set->minUAVSlot,
                 set->maxUAVSlot - set->minUAVSlot + 1,
                 &set->UAVs[set->minUAVSlot],
                 NullUAVInitialCounts);
@@ -475,5 +594,6 @@ void CommandList::bindComputeResourceSets(
 }
 
 #undef D3D11_SET_ARRAY
+#undef D3D11_SET_ARRAY1
 
 } // namespace nvrhi::d3d11
@@ -241,6 +241,16 @@ namespace nvrhi::d3d11
         utils::NotSupported();
         return false;
     }
+
+    void Device::getTextureTiling(ITexture*, uint32_t*, PackedMipDesc*, TileShape*, uint32_t*, SubresourceTiling*)
+    {
+        utils::NotSupported();
+    }
+
+    void Device::updateTextureTileMappings(ITexture*, const TextureTilesMapping*, uint32_t, CommandQueue)
+    {
+        utils::NotSupported();
+    }
     
     nvrhi::TextureHandle Device::createHandleForNativeTexture(ObjectType objectType, Object _texture, const TextureDesc& desc)
     {
@@ -287,13 +297,13 @@ namespace nvrhi::d3d11
             {
                 ID3D11UnorderedAccessView* uav = texture->getUAV(Format::UNKNOWN, currentMipSlice, TextureDimension::Unknown);
 
-                m_Context.immediateContext->ClearUnorderedAccessViewFloat(uav, &clearColor.r);
+                m_DeviceContext->ClearUnorderedAccessViewFloat(uav, &clearColor.r);
             }
             else if (texture->desc.isRenderTarget)
             {
                 ID3D11RenderTargetView* rtv = texture->getRTV(Format::UNKNOWN, currentMipSlice);
 
-                m_Context.immediateContext->ClearRenderTargetView(rtv, &clearColor.r);
+                m_DeviceContext->ClearRenderTargetView(rtv, &clearColor.r);
             }
             else
             {
@@ -330,7 +340,7 @@ namespace nvrhi::d3d11
                 UINT clearFlags = 0;
                 if (clearDepth)   clearFlags |= D3D11_CLEAR_DEPTH;
                 if (clearStencil) clearFlags |= D3D11_CLEAR_STENCIL;
-                m_Context.immediateContext->ClearDepthStencilView(dsv, clearFlags, depth, stencil);
+                m_DeviceContext->ClearDepthStencilView(dsv, clearFlags, depth, stencil);
             }
         }
     }
@@ -356,14 +366,14 @@ namespace nvrhi::d3d11
                 ID3D11UnorderedAccessView* uav = texture->getUAV(Format::UNKNOWN, currentMipSlice, TextureDimension::Unknown);
 
                 uint32_t clearValues[4] = { clearColor, clearColor, clearColor, clearColor };
-                m_Context.immediateContext->ClearUnorderedAccessViewUint(uav, clearValues);
+                m_DeviceContext->ClearUnorderedAccessViewUint(uav, clearValues);
             }
             else if (texture->desc.isRenderTarget)
             {
                 ID3D11RenderTargetView* rtv = texture->getRTV(Format::UNKNOWN, currentMipSlice);
 
                 float clearValues[4] = { float(clearColor), float(clearColor), float(clearColor), float(clearColor) };
-                m_Context.immediateContext->ClearRenderTargetView(rtv, clearValues);
+                m_DeviceContext->ClearRenderTargetView(rtv, clearValues);
             }
             else
             {
@@ -392,7 +402,7 @@ namespace nvrhi::d3d11
         srcBox.bottom = resolvedSrcSlice.y + resolvedSrcSlice.height;
         srcBox.back = resolvedSrcSlice.z + resolvedSrcSlice.depth;
 
-        m_Context.immediateContext->CopySubresourceRegion(dst,
+        m_DeviceContext->CopySubresourceRegion(dst,
                                        dstSubresource,
                                        resolvedDstSlice.x, resolvedDstSlice.y, resolvedDstSlice.z,
                                        src,
@@ -433,7 +443,20 @@ namespace nvrhi::d3d11
 
         UINT subresource = D3D11CalcSubresource(mipLevel, arraySlice, dest->desc.mipLevels);
 
-        m_Context.immediateContext->UpdateSubresource(dest->resource, subresource, nullptr, data, UINT(rowPitch), UINT(depthPitch));
+        m_DeviceContext->UpdateSubresource(dest->resource, subresource, nullptr, data, UINT(rowPitch), UINT(depthPitch));
+    }
+
+    void CommandList::writeTextureRegions(ITexture* _dest, const TextureUploadRegion* regions, size_t numRegions)
+    {
+        Texture* dest = checked_cast<Texture*>(_dest);
+
+        for (size_t i = 0; i < numRegions; i++)
+        {
+            const TextureUploadRegion& region = regions[i];
+            UINT subresource = D3D11CalcSubresource(region.mipLevel, region.arraySlice, dest->desc.mipLevels);
+
+            m_DeviceContext->UpdateSubresource(dest->resource, subresource, nullptr, region.data, UINT(region.rowPitch), UINT(region.depthPitch));
+        }
     }
 
     void CommandList::resolveTexture(ITexture* _dest, const TextureSubresourceSet& dstSubresources, ITexture* _src, const TextureSubresourceSet& srcSubresources)
@@ -456,7 +479,7 @@ namespace nvrhi::d3d11
             {
                 uint32_t dstSubresource = D3D11CalcSubresource(mipLevel + dstSR.baseMipLevel, arrayIndex + dstSR.baseArraySlice, dest->desc.mipLevels);
                 uint32_t srcSubresource = D3D11CalcSubresource(mipLevel + srcSR.baseMipLevel, arrayIndex + srcSR.baseArraySlice, src->desc.mipLevels);
-                m_Context.immediateContext->ResolveSubresource(dest->resource, dstSubresource, src->resource, srcSubresource, formatMapping.rtvFormat);
+                m_DeviceContext->ResolveSubresource(dest->resource, dstSubresource, src->resource, srcSubresource, formatMapping.rtvFormat);
             }
         }
     }
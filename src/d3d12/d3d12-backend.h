@@ -48,6 +48,21 @@
 #define NVRHI_WITH_NVAPI_DISPLACEMENT_MICROMAP (0)
 #endif
 
+// Enhanced Barriers need ID3D12GraphicsCommandList7 and the D3D12_BARRIER types from a recent Windows SDK or the Agility SDK headers
+#if defined(__ID3D12GraphicsCommandList7_INTERFACE_DEFINED__)
+#define NVRHI_D3D12_WITH_ENHANCED_BARRIERS (1)
+#else
+#define NVRHI_D3D12_WITH_ENHANCED_BARRIERS (0)
+#endif
+
+// GPU upload heaps (D3D12_HEAP_TYPE_GPU_UPLOAD) and D3D12_OPTIONS16 come with the same headers as ID3D12GraphicsCommandList10
+#if defined(__ID3D12GraphicsCommandList10_INTERFACE_DEFINED__)
+#define NVRHI_D3D12_WITH_GPU_UPLOAD_HEAPS (1)
+#else
+#define NVRHI_D3D12_WITH_GPU_UPLOAD_HEAPS (0)
+#endif
+
+#include <atomic>
 #include <bitset>
 #include <memory>
 #include <queue>
@@ -61,6 +76,20 @@
 #include "../common/state-tracking.h"
 #include "../common/dxgi-format.h"
 #include "../common/versioning.h"
+#include "../common/range-allocator.h"
+#include "../common/push-bindings.h"
+#include "../common/command-list-statistics.h"
+#include "../common/trace-recorder.h"
+#include "../common/graphics-state-block.h"
+#include "../common/upload-ring.h"
+#include "../common/gpu-profiler.h"
+#include "../common/memory-counters.h"
+#include "../common/resource-reference-list.h"
+#include "../common/recycling-queue.h"
+#include "../common/garbage-collection-thread.h"
+#include "../common/dxgi-memory.h"
+#include "../common/object-cache.h"
+#include "../common/startup-timer.h"
 
 #ifdef NVRHI_WITH_RTXMU
 #include <rtxmu/D3D12AccelStructManager.h>
@@ -105,14 +134,38 @@ namespace nvrhi::d3d12
         std::unique_ptr<rtxmu::DxAccelStructManager> rtxMemUtil;
 #endif
 
-        RefCountPtr<ID3D12CommandSignature> drawIndirectSignature;
-        RefCountPtr<ID3D12CommandSignature> drawIndexedIndirectSignature;
-        RefCountPtr<ID3D12CommandSignature> dispatchIndirectSignature;
+        // Command signatures for the indirect draws and dispatches, created on first use through getIndirectSignature.
+        // The signature is created under indirectSignatureMutex, then 'published' is read without taking the lock.
+        struct IndirectSignature
+        {
+            RefCountPtr<ID3D12CommandSignature> signature;
+            std::atomic<ID3D12CommandSignature*> published = nullptr;
+        };
+        mutable IndirectSignature drawIndirectSignature;
+        mutable IndirectSignature drawIndexedIndirectSignature;
+        mutable IndirectSignature dispatchIndirectSignature;
+        mutable IndirectSignature dispatchMeshIndirectSignature;
+        mutable std::mutex indirectSignatureMutex;
         RefCountPtr<ID3D12QueryHeap> timerQueryHeap;
         RefCountPtr<Buffer> timerQueryResolveBuffer;
+        RefCountPtr<ID3D12QueryHeap> occlusionQueryHeap;
+        RefCountPtr<Buffer> occlusionQueryResolveBuffer;
+        RefCountPtr<ID3D12QueryHeap> pipelineStatisticsQueryHeap;
+        RefCountPtr<Buffer> pipelineStatisticsQueryResolveBuffer;
+
+        // Set when DeviceDesc::enableEnhancedBarriers is on and the device supports them
+        bool enhancedBarriers = false;
+
+        std::shared_ptr<InternalMemoryCounters> memoryCounters = std::make_shared<InternalMemoryCounters>();
+
+        // See IDevice::setTraceRecorder
+        TraceRecorderSlot traceRecorder;
 
         IMessageCallback* messageCallback = nullptr;
         void error(const std::string& message) const;
+
+        // Returns the command signature for DRAW, DRAW_INDEXED, DISPATCH or DISPATCH_MESH arguments
+        ID3D12CommandSignature* getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE type) const;
     };
 
     class StaticDescriptorHeap : public IDescriptorHeap
@@ -127,16 +180,34 @@ namespace nvrhi::d3d12
         D3D12_GPU_DESCRIPTOR_HANDLE m_StartGpuHandleShaderVisible = { 0 };
         uint32_t m_Stride = 0;
         uint32_t m_NumDescriptors = 0;
-        std::vector<bool> m_AllocatedDescriptors;
-        DescriptorIndex m_SearchStart = 0;
+        // The heaps are created with this size on the first allocation, see allocateResources
+        uint32_t m_InitialNumDescriptors = 0;
+        bool m_ShaderVisible = false;
+        RangeAllocator m_FreeRanges;
         uint32_t m_NumAllocatedDescriptors = 0;
         std::mutex m_Mutex;
+        TrackedAllocation m_MemoryTracking;
+
+        // Optional caches of single descriptors, selected by a hash of the calling thread's ID.
+        // Descriptors in the caches are allocated from m_FreeRanges' point of view.
+        static constexpr uint32_t c_NumThreadCaches = 16;
+        static constexpr uint32_t c_ThreadCacheBatchSize = 32;
+        struct ThreadCache
+        {
+            std::vector<DescriptorIndex> freeDescriptors;
+            std::mutex mutex;
+        };
+        std::unique_ptr<ThreadCache[]> m_ThreadCaches;
 
+        HRESULT createHeaps(uint32_t numDescriptors, bool shaderVisible);
         HRESULT Grow(uint32_t minRequiredSize);
+        DescriptorIndex allocateDescriptorsLocked(uint32_t count);
+        void releaseDescriptorsLocked(DescriptorIndex baseIndex, uint32_t count);
+        ThreadCache& getThreadCache() const;
     public:
         explicit StaticDescriptorHeap(const Context& context);
 
-        HRESULT allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, bool shaderVisible);
+        HRESULT allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, bool shaderVisible, bool enableThreadCaches = false);
         void copyToShaderVisibleHeap(DescriptorIndex index, uint32_t count = 1);
         
         DescriptorIndex allocateDescriptors(uint32_t count) override;
@@ -150,6 +221,147 @@ namespace nvrhi::d3d12
         [[nodiscard]] ID3D12DescriptorHeap* getShaderVisibleHeap() const override;
     };
 
+    class ResidencyManager;
+    class Queue;
+    class CommandListInstance;
+
+    // A heap or committed resource whose residency is managed by the ResidencyManager.
+    // Unregisters itself from the manager when destroyed.
+    struct ResidencyObject
+    {
+        ResidencyManager* manager = nullptr;
+        ID3D12Pageable* pageable = nullptr;
+        uint64_t size = 0;
+        ResidencyPriority priority = ResidencyPriority::Normal;
+        bool resident = true;
+        uint64_t lastUseSubmission = 0;
+        uint64_t lastUseInstances[uint32_t(CommandQueue::Count)] = {};
+        std::list<ResidencyObject*>::iterator lruPosition;
+
+        ResidencyObject() = default;
+        ~ResidencyObject();
+
+        ResidencyObject(const ResidencyObject&) = delete;
+        ResidencyObject& operator=(const ResidencyObject&) = delete;
+    };
+
+    // Implemented by the objects that reference memory managed by the ResidencyManager.
+    // Command lists store their referenced resources as IResource, so the manager finds this interface through dynamic_cast.
+    class ResidencySource
+    {
+    public:
+        virtual void getResidencyObjects(std::vector<ResidencyObject*>& objects) = 0;
+
+    protected:
+        ~ResidencySource() = default;
+    };
+
+    // Makes the objects used by command lists resident before they execute and evicts the least recently used
+    // device-local objects when the video memory budget is exceeded, see DeviceDesc::enableResidencyManagement.
+    class ResidencyManager
+    {
+    public:
+        explicit ResidencyManager(const Context& context)
+            : m_Context(context)
+        { }
+
+        ~ResidencyManager();
+
+        void initialize(const DxgiMemoryBudget* budget);
+        [[nodiscard]] bool isEnabled() const { return m_Budget != nullptr; }
+
+        // Starts tracking a device-local heap or committed resource. Does nothing when residency management is disabled.
+        void track(ResidencyObject& object, ID3D12Pageable* pageable, uint64_t size, ResidencyPriority priority);
+        void trackResource(ResidencyObject& object, ID3D12Resource* resource, const D3D12_RESOURCE_DESC& resourceDesc, ResidencyPriority priority);
+        void untrack(ResidencyObject& object);
+
+        // Makes the objects referenced by the command lists resident on the queue before they are executed,
+        // and records that they are used by the given submission.
+        void prepareSubmission(ICommandList* const* commandLists, size_t numCommandLists, CommandQueue queueType,
+            uint64_t submittedInstance, const std::array<std::unique_ptr<Queue>, (int)CommandQueue::Count>& queues);
+
+    private:
+        const Context& m_Context;
+        const DxgiMemoryBudget* m_Budget = nullptr;
+        RefCountPtr<ID3D12Device3> m_Device3;
+        RefCountPtr<ID3D12Fence> m_Fence;
+        uint64_t m_FenceValue = 0;
+        uint64_t m_SubmissionIndex = 0;
+
+        // Front is the most recently used
+        std::list<ResidencyObject*> m_LRU;
+        std::mutex m_Mutex;
+
+        std::vector<ResidencyObject*> m_ReferencedObjects;
+        std::vector<ID3D12Pageable*> m_PageablesToMakeResident;
+        std::vector<ID3D12Pageable*> m_PageablesToEvict;
+
+        void collectReferencedObjects(const CommandListInstance& instance);
+        void evict(uint64_t bytesToFree, const std::array<std::unique_ptr<Queue>, (int)CommandQueue::Count>& queues);
+    };
+
+    // Sub-allocates placed resources from ID3D12Heap objects owned by the device, see DeviceDesc::enablePlacedResourcePools.
+    // Heaps are split by heap type and resource class, which keeps the pools compatible with resource heap tier 1.
+    class PlacedResourcePool
+    {
+    public:
+        enum class ResourceClass : uint8_t
+        {
+            Buffer,
+            Texture,
+            RenderTargetOrDepthStencil,
+
+            Count
+        };
+
+        struct PoolHeap;
+
+        struct Allocation
+        {
+            PoolHeap* poolHeap = nullptr;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        PlacedResourcePool(const Context& context, ResidencyManager& residencyManager)
+            : m_Context(context)
+            , m_ResidencyManager(residencyManager)
+        { }
+
+        void initialize(uint64_t heapSize) { m_HeapSize = heapSize; }
+        [[nodiscard]] bool isEnabled() const { return m_HeapSize != 0; }
+
+        // Creates a placed resource in one of the pool heaps. Returns false if the resource is not suitable
+        // for pooling or could not be placed, in which case the caller should create a committed resource.
+        bool tryCreateResource(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass, const D3D12_RESOURCE_DESC& resourceDesc,
+            D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue,
+            Allocation& outAllocation, RefCountPtr<ID3D12Resource>& outResource);
+
+        // Must be called after the placed resource has been released.
+        void release(Allocation& allocation);
+
+        void getStatistics(std::vector<PlacedResourceHeapStatistics>& outStatistics);
+
+        struct PoolHeap
+        {
+            HeapHandle heap;
+            RangeAllocator ranges;
+            uint32_t numAllocations = 0;
+            uint32_t bucketIndex = 0;
+        };
+
+    private:
+        static constexpr uint32_t c_NumHeapTypes = 3; // DEFAULT, UPLOAD, READBACK
+
+        const Context& m_Context;
+        ResidencyManager& m_ResidencyManager;
+        uint64_t m_HeapSize = 0;
+        std::vector<std::unique_ptr<PoolHeap>> m_Buckets[c_NumHeapTypes * uint32_t(ResourceClass::Count)];
+        std::mutex m_Mutex;
+
+        PoolHeap* createPoolHeap(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass, uint32_t bucketIndex);
+    };
+
     class DeviceResources
     {
     public:
@@ -157,14 +369,27 @@ namespace nvrhi::d3d12
         StaticDescriptorHeap depthStencilViewHeap;
         StaticDescriptorHeap shaderResourceViewHeap;
         StaticDescriptorHeap samplerHeap;
+        ResidencyManager residencyManager;
+        PlacedResourcePool placedResourcePool;
         utils::BitSetAllocator timerQueries;
+        utils::BitSetAllocator occlusionQueries;
+        utils::BitSetAllocator pipelineStatisticsQueries;
 #ifdef NVRHI_WITH_RTXMU
         std::mutex asListMutex;
         std::vector<uint64_t> asBuildsCompleted;
+#else
+        // BLAS'es built with the AllowCompaction flag whose builds have finished executing,
+        // waiting for compactBottomLevelAccelStructs
+        std::mutex asListMutex;
+        std::vector<rt::AccelStructHandle> asBuildsCompleted;
 #endif
 
-        // The cache does not own the RS objects, so store weak references
-        std::unordered_map<size_t, RootSignature*> rootsigCache;
+        // The cache holds references to the RS objects and releases the ones no pipeline uses anymore
+        // in collectRootSignatureGarbage. Weak references removed by the RS destructor could be handed out
+        // by a lookup while that destructor waits for the lock.
+        // Pipelines can be created from multiple threads, so access is guarded by rootsigCacheMutex.
+        std::unordered_map<size_t, RefCountPtr<RootSignature>> rootsigCache;
+        std::mutex rootsigCacheMutex;
 
         explicit DeviceResources(const Context& context, const DeviceDesc& desc);
 
@@ -219,16 +444,19 @@ namespace nvrhi::d3d12
         ShaderHandle getShader(const char* entryName, ShaderType shaderType) override;
     };
 
-    class Heap : public RefCounter<IHeap>
+    class Heap : public RefCounter<IHeap>, public ResidencySource
     {
     public:
         HeapDesc desc;
         RefCountPtr<ID3D12Heap> heap;
+        ResidencyObject residency;
 
         const HeapDesc& getDesc() override { return desc; }
+
+        void getResidencyObjects(std::vector<ResidencyObject*>& objects) override;
     };
 
-    class Texture : public RefCounter<ITexture>, public TextureStateExtension
+    class Texture : public RefCounter<ITexture>, public TextureStateExtension, public ResidencySource
     {
     public:
         const TextureDesc desc;
@@ -237,6 +465,15 @@ namespace nvrhi::d3d12
         uint8_t planeCount = 1;
         HANDLE sharedHandle = nullptr;
         HeapHandle heap;
+        PlacedResourcePool::Allocation placedAllocation;
+        ResidencyObject residency;
+
+        // Heaps that have been mapped to the tiles of a tiled texture, kept alive while the texture exists
+        std::vector<HeapHandle> tileMappingHeaps;
+
+        // Set for placed render targets and depth-stencil textures, whose memory must be initialized
+        // with DiscardResource before any other use. Cleared by the first command list that uses the texture.
+        std::atomic<bool> needsInitialDiscard = false;
 
         Texture(const Context& context, DeviceResources& resources, TextureDesc desc, const D3D12_RESOURCE_DESC& resourceDesc)
             : TextureStateExtension(this->desc)
@@ -261,6 +498,7 @@ namespace nvrhi::d3d12
         void createRTV(size_t descriptor, Format format, TextureSubresourceSet subresources) const;
         void createDSV(size_t descriptor, TextureSubresourceSet subresources, bool isReadOnly = false) const;
         DescriptorIndex getClearMipLevelUAV(uint32_t mipLevel);
+        void getResidencyObjects(std::vector<ResidencyObject*>& objects) override;
 
     private:
         const Context& m_Context;
@@ -273,7 +511,7 @@ namespace nvrhi::d3d12
         std::vector<DescriptorIndex> m_ClearMipLevelUAVs;
     };
 
-    class Buffer : public RefCounter<IBuffer>, public BufferStateExtension
+    class Buffer : public RefCounter<IBuffer>, public BufferStateExtension, public ResidencySource
     {
     public:
         const BufferDesc desc;
@@ -282,9 +520,13 @@ namespace nvrhi::d3d12
         D3D12_RESOURCE_DESC resourceDesc{};
 
         HeapHandle heap;
+        PlacedResourcePool::Allocation placedAllocation;
+        ResidencyObject residency;
 
+        // For CPU-accessible buffers only, set when a submission that copies to or from the buffer is executed
         RefCountPtr<ID3D12Fence> lastUseFence;
         uint64_t lastUseFenceValue = 0;
+        CommandQueue lastUseQueue = CommandQueue::Graphics;
         HANDLE sharedHandle = nullptr;
 
         Buffer(const Context& context, DeviceResources& resources, BufferDesc desc)
@@ -307,6 +549,7 @@ namespace nvrhi::d3d12
         void createUAV(size_t descriptor, Format format, BufferRange range, ResourceType type) const;
         static void createNullSRV(size_t descriptor, Format format, const Context& context);
         static void createNullUAV(size_t descriptor, Format format, const Context& context);
+        void getResidencyObjects(std::vector<ResidencyObject*>& objects) override;
 
     private:
         const Context& m_Context;
@@ -411,6 +654,74 @@ namespace nvrhi::d3d12
         DeviceResources& m_Resources;
     };
 
+    class GpuProfiler : public GpuProfilerBase
+    {
+    public:
+        RefCountPtr<ID3D12QueryHeap> queryHeap;
+
+        GpuProfiler(IDevice* device, ID3D12CommandQueue* queue, const GpuProfilerDesc& desc)
+            : GpuProfilerBase(device, desc)
+            , m_Queue(queue)
+        { }
+
+    protected:
+        void recordTimestamp(nvrhi::ICommandList* commandList, uint32_t queryIndex) override;
+        void recordResolve(nvrhi::ICommandList* commandList, uint32_t firstQuery, uint32_t numQueries, IBuffer* buffer, uint64_t bufferOffset) override;
+        double getTimestampPeriod() override;
+        bool getClockCalibration(uint64_t& outGpuTimestamp, double& outCpuSeconds) override;
+
+    private:
+        RefCountPtr<ID3D12CommandQueue> m_Queue;
+    };
+
+    class OcclusionQuery : public RefCounter<IOcclusionQuery>
+    {
+    public:
+        OcclusionQueryDesc desc;
+        uint32_t queryIndex = 0;
+
+        RefCountPtr<ID3D12Fence> fence;
+        uint64_t fenceCounter = 0;
+
+        bool started = false;
+        bool resolved = false;
+        uint64_t result = 0;
+
+        OcclusionQuery(DeviceResources& resources)
+            : m_Resources(resources)
+        { }
+
+        ~OcclusionQuery() override;
+
+        const OcclusionQueryDesc& getDesc() const override { return desc; }
+        [[nodiscard]] D3D12_QUERY_TYPE getQueryType() const { return desc.binary ? D3D12_QUERY_TYPE_BINARY_OCCLUSION : D3D12_QUERY_TYPE_OCCLUSION; }
+
+    private:
+        DeviceResources& m_Resources;
+    };
+
+    class PipelineStatisticsQuery : public RefCounter<IPipelineStatisticsQuery>
+    {
+    public:
+        uint32_t queryIndex = 0;
+
+        RefCountPtr<ID3D12Fence> fence;
+        uint64_t fenceCounter = 0;
+
+        bool started = false;
+        bool resolved = false;
+        PipelineStatistics result;
+
+        PipelineStatisticsQuery(DeviceResources& resources)
+            : m_Resources(resources)
+        { }
+
+        ~PipelineStatisticsQuery() override;
+
+    private:
+        DeviceResources& m_Resources;
+    };
+
     class BindingLayout : public RefCounter<IBindingLayout>
     {
     public:
@@ -425,6 +736,7 @@ namespace nvrhi::d3d12
         std::vector<D3D12_DESCRIPTOR_RANGE1> descriptorRangesSamplers;
         std::vector<BindingLayoutItem> bindingLayoutsSRVetc;
         static_vector<std::pair<RootParameterIndex, D3D12_ROOT_DESCRIPTOR1>, c_MaxVolatileConstantBuffersPerLayout> rootParametersVolatileCB;
+        static_vector<std::pair<RootParameterIndex, D3D12_ROOT_CONSTANTS>, c_MaxVolatileConstantBuffersPerLayout> rootParametersPromotedCB;
         static_vector<D3D12_ROOT_PARAMETER1, 32> rootParameters;
 
         BindingLayout(const BindingLayoutDesc& desc);
@@ -450,20 +762,13 @@ namespace nvrhi::d3d12
     {
     public:
         size_t hash = 0;
+        uint64_t serializedHash = 0; // hash of the serialized description, part of the pipeline library keys
         static_vector<std::pair<BindingLayoutHandle, RootParameterIndex>, c_MaxBindingLayouts> pipelineLayouts;
         RefCountPtr<ID3D12RootSignature> handle;
         uint32_t pushConstantByteSize = 0;
         RootParameterIndex rootParameterPushConstants = ~0u;
-        
-        RootSignature(DeviceResources& resources)
-            : m_Resources(resources)
-        { }
 
-        ~RootSignature() override;
         Object getNativeObject(ObjectType objectType) override;
-
-    private:
-        DeviceResources& m_Resources;
     };
 
     class Framebuffer : public RefCounter<IFramebuffer>
@@ -515,6 +820,21 @@ namespace nvrhi::d3d12
         Object getNativeObject(ObjectType objectType) override;
     };
 
+    class GraphicsStateBlock : public nvrhi::GraphicsStateBlock
+    {
+    public:
+        // Native views for the index and vertex buffers, resolved when the block is created
+        D3D12_INDEX_BUFFER_VIEW indexBufferView = {};
+        D3D12_VERTEX_BUFFER_VIEW vertexBufferViews[c_MaxVertexAttributes] = {};
+        uint32_t maxVertexBufferSlot = 0;
+        // Set when any binding set has UAV bindings, which may need UAV barriers every time the state is set
+        bool hasUavBindings = false;
+
+        explicit GraphicsStateBlock(const GraphicsState& _state)
+            : nvrhi::GraphicsStateBlock(_state)
+        { }
+    };
+
     class ComputePipeline : public RefCounter<IComputePipeline>
     {
     public:
@@ -544,8 +864,23 @@ namespace nvrhi::d3d12
         const FramebufferInfo& getFramebufferInfo() const override { return framebufferInfo; }
         Object getNativeObject(ObjectType objectType) override;
     };
+
+    class CommandSignature : public RefCounter<ICommandSignature>
+    {
+    public:
+        CommandSignatureDesc desc;
+        RefCountPtr<ID3D12CommandSignature> handle;
+        // Keeps the root signature alive when the signature has root constant arguments
+        RefCountPtr<RootSignature> rootSignature;
+        bool isDispatch = false;
+        bool changesState = false;
+
+        const CommandSignatureDesc& getDesc() const override { return desc; }
+        uint32_t getNativeIndexFormat(Format format) const override;
+        Object getNativeObject(ObjectType objectType) override;
+    };
     
-    class BindingSet : public RefCounter<IBindingSet>
+    class BindingSet : public RefCounter<IBindingSet>, public ResidencySource
     {
     public:
         RefCountPtr<BindingLayout> layout;
@@ -559,8 +894,10 @@ namespace nvrhi::d3d12
         bool descriptorTableValidSRVetc = false;
         bool descriptorTableValidSamplers = false;
         bool hasUavBindings = false;
+        bool transient = false; // the descriptor tables are preallocated from TransientDescriptorChunk objects
 
         static_vector<std::pair<RootParameterIndex, IBuffer*>, c_MaxVolatileConstantBuffersPerLayout> rootParametersVolatileCB;
+        static_vector<std::pair<RootParameterIndex, IBuffer*>, c_MaxVolatileConstantBuffersPerLayout> rootParametersPromotedCB;
         
         std::vector<RefCountPtr<IResource>> resources;
 
@@ -574,6 +911,7 @@ namespace nvrhi::d3d12
         ~BindingSet() override;
 
         void createDescriptors();
+        void getResidencyObjects(std::vector<ResidencyObject*>& objects) override;
 
         const BindingSetDesc* getDesc() const override { return &desc; }
         IBindingLayout* getLayout() const override { return layout; }
@@ -583,12 +921,42 @@ namespace nvrhi::d3d12
         DeviceResources& m_Resources;
     };
 
+    // A range of static heap descriptors that transient binding sets are linearly sub-allocated from.
+    // Every transient set keeps a reference to its chunk, so the whole range is released at once
+    // when the command list instances that used those sets retire.
+    class TransientDescriptorChunk : public RefCounter<IResource>
+    {
+    public:
+        DescriptorIndex baseIndex;
+        uint32_t capacity;
+        uint32_t numUsed = 0;
+
+        TransientDescriptorChunk(StaticDescriptorHeap& heap, DescriptorIndex baseIndex, uint32_t capacity)
+            : baseIndex(baseIndex)
+            , capacity(capacity)
+            , m_Heap(heap)
+        { }
+
+        ~TransientDescriptorChunk() override
+        {
+            m_Heap.releaseDescriptors(baseIndex, capacity);
+        }
+
+    private:
+        StaticDescriptorHeap& m_Heap;
+    };
+
     class DescriptorTable : public RefCounter<IDescriptorTable>
     {
     public:
+        BindingLayoutHandle layout;
         uint32_t capacity = 0;
         DescriptorIndex firstDescriptor = 0;
 
+        // Number of descriptors allocated at firstDescriptor when the layout has reserveMaxCapacity set,
+        // resizing within this limit doesn't move the table
+        uint32_t reservedCapacity = 0;
+
         DescriptorTable(DeviceResources& resources)
             : m_Resources(resources)
         { }
@@ -596,9 +964,11 @@ namespace nvrhi::d3d12
         ~DescriptorTable() override;
 
         const BindingSetDesc* getDesc() const override { return nullptr; }
-        IBindingLayout* getLayout() const override { return nullptr; }
+        IBindingLayout* getLayout() const override { return layout; }
         uint32_t getCapacity() const override { return capacity; }
 
+        [[nodiscard]] uint32_t getNumAllocatedDescriptors() const { return std::max(capacity, reservedCapacity); }
+
     private:
         DeviceResources& m_Resources;
     };
@@ -630,6 +1000,18 @@ namespace nvrhi::d3d12
     };
 
     D3D12_RESOURCE_STATES convertResourceStates(ResourceStates stateBits);
+    D3D12_RESOURCE_STATES convertInitialTextureState(ResourceStates stateBits, bool enhancedBarriers);
+
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+    struct EnhancedBarrierState
+    {
+        D3D12_BARRIER_SYNC sync = D3D12_BARRIER_SYNC_NONE;
+        D3D12_BARRIER_ACCESS access = D3D12_BARRIER_ACCESS_NO_ACCESS;
+        D3D12_BARRIER_LAYOUT layout = D3D12_BARRIER_LAYOUT_UNDEFINED;
+    };
+
+    EnhancedBarrierState convertEnhancedBarrierState(ResourceStates stateBits);
+#endif
     
     class BufferChunk
     {
@@ -643,6 +1025,7 @@ namespace nvrhi::d3d12
         void* cpuVA = nullptr;
         D3D12_GPU_VIRTUAL_ADDRESS gpuVA = 0;
         uint32_t identifier = 0;
+        TrackedAllocation memoryTracking;
 
         ~BufferChunk();
     };
@@ -650,13 +1033,23 @@ namespace nvrhi::d3d12
     class UploadManager
     {
     public:
-        UploadManager(const Context& context, class Queue* pQueue, size_t defaultChunkSize, uint64_t memoryLimit, bool isScratchBuffer);
+        UploadManager(const Context& context, class Queue* pQueue, size_t defaultChunkSize, uint64_t memoryLimit, bool isScratchBuffer,
+            uint64_t ringSize = 0, uint32_t nodeMask = 0);
+        ~UploadManager();
 
         bool suballocateBuffer(uint64_t size, ID3D12GraphicsCommandList* pCommandList, ID3D12Resource** pBuffer, size_t* pOffset, void** pCpuVA,
             D3D12_GPU_VIRTUAL_ADDRESS* pGpuVA, uint64_t currentVersion, uint32_t alignment = 256);
 
         void submitChunks(uint64_t currentVersion, uint64_t submittedVersion);
 
+        // Releases the ring space of a recording that was closed but never executed, see UploadRing::releaseUnsubmitted
+        void releaseUnsubmitted() { if (m_Ring) m_Ring->releaseUnsubmitted(); }
+
+        [[nodiscard]] UploadStatistics getStatistics() const;
+
+        // Total size of the suballocations made over the lifetime of the manager
+        [[nodiscard]] uint64_t getBytesRequested() const { return m_BytesRequested; }
+
     private:
         const Context& m_Context;
         Queue* m_Queue;
@@ -664,11 +1057,22 @@ namespace nvrhi::d3d12
         uint64_t m_MemoryLimit = 0;
         uint64_t m_AllocatedMemory = 0;
         bool m_IsScratchBuffer = false;
+        uint32_t m_NodeMask = 0; // the chunks are created on and visible to the command list's node
 
         std::list<std::shared_ptr<BufferChunk>> m_ChunkPool;
         std::shared_ptr<BufferChunk> m_CurrentChunk;
 
+        // Ring mode, see CommandListParameters::uploadRingSize
+        std::unique_ptr<UploadRing> m_Ring;
+        std::shared_ptr<BufferChunk> m_RingChunk;
+        HANDLE m_FenceEvent = nullptr;
+        uint64_t m_HighWaterMark = 0;
+        uint64_t m_NumStalls = 0;
+        uint64_t m_BytesRequested = 0;
+
         [[nodiscard]] std::shared_ptr<BufferChunk> createChunk(size_t size) const;
+        bool suballocateFromRing(uint64_t size, ID3D12Resource** pBuffer, size_t* pOffset, void** pCpuVA,
+            D3D12_GPU_VIRTUAL_ADDRESS* pGpuVA, uint64_t currentVersion, uint32_t alignment);
     };
 
     class OpacityMicromap : public RefCounter<rt::IOpacityMicromap>
@@ -693,7 +1097,7 @@ namespace nvrhi::d3d12
         const Context& m_Context;
     };
 
-    class AccelStruct : public RefCounter<rt::IAccelStruct>
+    class AccelStruct : public RefCounter<rt::IAccelStruct>, public ResidencySource
     {
     public:
         RefCountPtr<d3d12::Buffer> dataBuffer;
@@ -705,6 +1109,11 @@ namespace nvrhi::d3d12
         size_t rtxmuId = ~0ull;
 #ifdef NVRHI_WITH_RTXMU
         D3D12_GPU_VIRTUAL_ADDRESS rtxmuGpuVA = 0;
+#else
+        // Readback buffer and index of the compacted size of a BLAS with the AllowCompaction flag
+        RefCountPtr<Buffer> compactedSizeBuffer;
+        uint32_t compactedSizeIndex = 0;
+        TrackedAllocation compactionSavings;
 #endif
 
         AccelStruct(const Context& context)
@@ -714,6 +1123,7 @@ namespace nvrhi::d3d12
         ~AccelStruct() override;
 
         void createSRV(size_t descriptor) const;
+        void getResidencyObjects(std::vector<ResidencyObject*>& objects) override;
 
         Object getNativeObject(ObjectType objectType) override;
 
@@ -774,8 +1184,18 @@ namespace nvrhi::d3d12
         std::vector<Entry> callableShaders;
         std::vector<Entry> hitGroups;
 
+        // Incremented when the table layout changes, i.e. when records are added or cleared
         uint32_t version = 0;
 
+        // Device-local copy of the table, rewritten in full when 'version' or the descriptor heaps change and patched
+        // record by record otherwise. See CommandList::commitShaderTable.
+        BufferHandle buffer;
+        uint32_t bufferVersion = 0;
+        ID3D12DescriptorHeap* descriptorHeapSRV = nullptr;
+        ID3D12DescriptorHeap* descriptorHeapSamplers = nullptr;
+        std::vector<uint32_t> dirtyRecords;
+        std::mutex mutex;
+
         ShaderTable(const Context& context, RayTracingPipeline* _pipeline)
             : pipeline(_pipeline)
             , m_Context(context)
@@ -783,10 +1203,16 @@ namespace nvrhi::d3d12
 
         uint32_t getNumEntries() const;
 
+        // Returns the entry stored in a record, counting records in SBT order
+        const Entry* getEntryForRecord(uint32_t recordIndex) const;
+
         void setRayGenerationShader(const char* exportName, IBindingSet* bindings = nullptr) override;
         int addMissShader(const char* exportName, IBindingSet* bindings = nullptr) override;
         int addHitGroup(const char* exportName, IBindingSet* bindings = nullptr) override;
         int addCallableShader(const char* exportName, IBindingSet* bindings = nullptr) override;
+        bool setMissShader(int index, const char* exportName, IBindingSet* bindings = nullptr) override;
+        bool setHitGroup(int index, const char* exportName, IBindingSet* bindings = nullptr) override;
+        bool setCallableShader(int index, const char* exportName, IBindingSet* bindings = nullptr) override;
         void clearMissShaders() override;
         void clearHitShaders() override;
         void clearCallableShaders() override;
@@ -796,6 +1222,7 @@ namespace nvrhi::d3d12
         const Context& m_Context;
 
         bool verifyExport(const RayTracingPipeline::ExportTableEntry* pExport, IBindingSet* bindings) const;
+        bool setRecord(std::vector<Entry>& records, uint32_t firstRecord, int index, const char* exportName, IBindingSet* bindings);
     };
 
 
@@ -803,8 +1230,7 @@ namespace nvrhi::d3d12
     {
     public:
         uint32_t committedVersion = 0;
-        ID3D12DescriptorHeap* descriptorHeapSRV = nullptr;
-        ID3D12DescriptorHeap* descriptorHeapSamplers = nullptr;
+        IBuffer* buffer = nullptr;
         D3D12_DISPATCH_RAYS_DESC dispatchRaysTemplate = {};
     };
 
@@ -816,13 +1242,65 @@ namespace nvrhi::d3d12
         uint64_t lastSubmittedInstance = 0;
         uint64_t lastCompletedInstance = 0;
         std::atomic<uint64_t> recordingInstance = 1;
-        std::deque<std::shared_ptr<class CommandListInstance>> commandListsInFlight;
+        RecyclingQueue<std::shared_ptr<class CommandListInstance>> commandListsInFlight; // in submission order
+        std::mutex commandListsInFlightMutex; // the background garbage collection retires the instances concurrently
 
         explicit Queue(const Context& context, ID3D12CommandQueue* queue);
         uint64_t updateLastCompletedInstance();
 
+        // Queues the command lists of one executeCommandLists call, which will signal 'instance' when they finish.
+        // The lists are only executed by flush().
+        void submit(ID3D12CommandList* const* commandLists, size_t numCommandLists, uint64_t instance);
+
+        // Makes the next queued command lists wait for 'value' of 'waitFence', or waits right away if nothing is queued
+        void wait(ID3D12Fence* waitFence, uint64_t value);
+
+        // Makes the next submitted command lists wait for 'instance' of another queue. The wait is resolved when they
+        // are flushed: if the instance is still queued on the other queue, that queue is flushed up to it first.
+        void waitForQueue(Queue* executionQueue, uint64_t instance);
+
+        // Signals 'value' of 'signalFence' after the queued command lists, or right away if nothing is queued
+        void signal(ID3D12Fence* signalFence, uint64_t value);
+
+        // Executes the queued command lists up to the submission that signals 'upToInstance', consecutive submissions
+        // without waits go into a single ExecuteCommandLists call. Thread-safe, because the CPU waits for queued instances
+        // and the waits of other queues call it.
+        void flush(uint64_t upToInstance = ~0ull);
+
+        [[nodiscard]] uint64_t getLastFlushedInstance() const { return m_LastFlushedInstance.load(); }
+
     private:
         const Context& m_Context;
+
+        struct PendingWait
+        {
+            RefCountPtr<ID3D12Fence> fence;
+            uint64_t value = 0;
+            Queue* executionQueue = nullptr; // set for the instances of another queue, which may still be queued there
+        };
+
+        // One ExecuteCommandLists call worth of queued command lists, preceded by the waits that were requested before them
+        struct PendingSubmission
+        {
+            std::vector<PendingWait> waits;
+            std::vector<ID3D12CommandList*> commandLists;
+            std::vector<std::pair<RefCountPtr<ID3D12Fence>, uint64_t>> signals; // application fences, signaled after 'fence'
+            uint64_t instance = 0;
+        };
+
+        // Entries before m_FirstPendingSubmission have been flushed, entries past m_NumPendingSubmissions
+        // are kept to reuse their vectors
+        std::vector<PendingSubmission> m_PendingSubmissions;
+        size_t m_FirstPendingSubmission = 0;
+        size_t m_NumPendingSubmissions = 0;
+        std::vector<PendingWait> m_PendingWaits;
+        std::atomic<uint64_t> m_LastFlushedInstance = 0;
+        std::mutex m_SubmitMutex;
+
+        [[nodiscard]] bool hasPendingSubmissions() const { return m_FirstPendingSubmission < m_NumPendingSubmissions; }
+
+        // Flushes the other queues up to the instances that the waits depend on, unlocking the mutex while doing that
+        static bool flushWaitDependencies(const std::vector<PendingWait>& waits, std::unique_lock<std::mutex>& lock);
     };
     
     class InternalCommandList
@@ -832,6 +1310,9 @@ namespace nvrhi::d3d12
         RefCountPtr<ID3D12GraphicsCommandList> commandList;
         RefCountPtr<ID3D12GraphicsCommandList4> commandList4;
         RefCountPtr<ID3D12GraphicsCommandList6> commandList6;
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        RefCountPtr<ID3D12GraphicsCommandList7> commandList7;
+#endif
         uint64_t lastSubmittedInstance = 0;
     };
 
@@ -839,19 +1320,36 @@ namespace nvrhi::d3d12
     {
     public:
         uint64_t submittedInstance = 0;
+        // Set by the device after it has retired the instance and released its references, possibly on the
+        // garbage collection thread. The command list only reuses the instance after that, see acquireInstance.
+        std::atomic<bool> retired = false;
         CommandQueue commandQueue = CommandQueue::Graphics;
         RefCountPtr<ID3D12Fence> fence;
         RefCountPtr<ID3D12CommandAllocator> commandAllocator;
         RefCountPtr<ID3D12CommandList> commandList;
-        std::vector<RefCountPtr<IResource>> referencedResources;
+        ResourceReferenceList referencedResources; // each resource is referenced once
         std::vector<RefCountPtr<IUnknown>> referencedNativeResources;
         std::vector<RefCountPtr<StagingTexture>> referencedStagingTextures;
         std::vector<RefCountPtr<Buffer>> referencedStagingBuffers;
         std::vector<RefCountPtr<TimerQuery>> referencedTimerQueries;
+        std::vector<RefCountPtr<OcclusionQuery>> referencedOcclusionQueries;
+        std::vector<RefCountPtr<PipelineStatisticsQuery>> referencedPipelineStatisticsQueries;
+        std::vector<std::shared_ptr<CommandListInstance>> referencedBundles;
+        // Bound binding sets with trackLiveness = false, only recorded for the residency manager.
+        // The application keeps them alive until the command list finishes executing.
+        std::vector<BindingSet*> untrackedBindingSets;
+        // For bundles: keeps the bundle's D3D12 command list from being reset while other command lists reference it
+        std::shared_ptr<InternalCommandList> bundleCommandList;
 #ifdef NVRHI_WITH_RTXMU
         std::vector<uint64_t> rtxmuBuildIds;
         std::vector<uint64_t> rtxmuCompactionIds;
+#else
+        // BLAS'es whose compacted sizes are written by this command list
+        std::vector<rt::AccelStructHandle> compactableBuilds;
 #endif
+
+        // Releases all references and clears the vectors, keeping their storage for the next recording
+        void reset();
     };
 
     class CommandList final : public RefCounter<nvrhi::d3d12::ICommandList>
@@ -865,6 +1363,8 @@ namespace nvrhi::d3d12
         void requireTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates state);
         void requireBufferState(IBuffer* buffer, ResourceStates state);
         ID3D12CommandList* getD3D12CommandList() const { return m_ActiveCommandList->commandList; }
+        const std::shared_ptr<CommandListInstance>& getInstance() const { return m_Instance; }
+        const CommandListResourceStateTracker& getStateTracker() const { return m_StateTracker; }
 
         // IResource implementation
 
@@ -884,6 +1384,7 @@ namespace nvrhi::d3d12
         void copyTexture(IStagingTexture* dest, const TextureSlice& destSlice, ITexture* src, const TextureSlice& srcSlice) override;
         void copyTexture(ITexture* dest, const TextureSlice& destSlice, IStagingTexture* src, const TextureSlice& srcSlice) override;
         void writeTexture(ITexture* dest, uint32_t arraySlice, uint32_t mipLevel, const void* data, size_t rowPitch, size_t depthPitch) override;
+        void writeTextureRegions(ITexture* dest, const TextureUploadRegion* regions, size_t numRegions) override;
         void resolveTexture(ITexture* dest, const TextureSubresourceSet& dstSubresources, ITexture* src, const TextureSubresourceSet& srcSubresources) override;
 
         void writeBuffer(IBuffer* b, const void* data, size_t dataSize, uint64_t destOffsetBytes = 0) override;
@@ -891,35 +1392,58 @@ namespace nvrhi::d3d12
         void copyBuffer(IBuffer* dest, uint64_t destOffsetBytes, IBuffer* src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes) override;
 
         void setPushConstants(const void* data, size_t byteSize) override;
+        void setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings) override;
+        BindingSetHandle createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout) override;
 
         void setGraphicsState(const GraphicsState& state) override;
+        void setGraphicsStateBlock(IGraphicsStateBlock* block) override;
         void draw(const DrawArguments& args) override;
         void drawIndexed(const DrawArguments& args) override;
+        void drawMulti(const MultiDrawArguments& multiDraw) override;
+        void drawIndexedMulti(const MultiDrawArguments& multiDraw) override;
         void drawIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
         void drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void executeBundles(ICommandList* const* bundles, size_t numBundles) override;
 
         void setComputeState(const ComputeState& state) override;
         void dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
         void dispatchIndirect(uint32_t offsetBytes) override;
+        void executeIndirect(ICommandSignature* signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes) override;
 
         void setMeshletState(const MeshletState& state) override;
         void dispatchMesh(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
+        void dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
 
         void setRayTracingState(const rt::State& state) override;
         void dispatchRays(const rt::DispatchRaysArguments& args) override;
 
         void buildOpacityMicromap(rt::IOpacityMicromap* omm, const rt::OpacityMicromapDesc& desc) override;
         void buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags) override;
+        void buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds) override;
         void compactBottomLevelAccelStructs() override;
         void buildTopLevelAccelStruct(rt::IAccelStruct* as, const rt::InstanceDesc* pInstances, size_t numInstances, rt::AccelStructBuildFlags buildFlags) override;
         void buildTopLevelAccelStructFromBuffer(rt::IAccelStruct* as, nvrhi::IBuffer* instanceBuffer, uint64_t instanceBufferOffset, size_t numInstances,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) override;
+        rt::InstanceDesc* beginTopLevelInstanceWrite(rt::IAccelStruct* as, size_t numInstances) override;
+        void commitTopLevelInstanceWrite(rt::IAccelStruct* as, rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None,
+            rt::IAccelStruct* const* bottomLevelASes = nullptr, size_t numBottomLevelASes = 0) override;
 
         void beginTimerQuery(ITimerQuery* query) override;
         void endTimerQuery(ITimerQuery* query) override;
 
+        void beginOcclusionQuery(IOcclusionQuery* query) override;
+        void endOcclusionQuery(IOcclusionQuery* query) override;
+        void beginPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void endPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* buffer, uint64_t offsetBytes) override;
+        void setPredication(IBuffer* buffer, uint64_t offsetBytes, PredicationOp op) override;
+
         void beginMarker(const char *name) override;
         void endMarker() override;
+        void setGpuProfiler(IGpuProfiler* profiler) override;
 
         void setEnableAutomaticBarriers(bool enable) override;
         void setResourceStatesForBindingSet(IBindingSet* bindingSet) override;
@@ -932,18 +1456,23 @@ namespace nvrhi::d3d12
 
         void setTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override;
         void setBufferState(IBuffer* buffer, ResourceStates stateBits) override;
+        void beginTextureStateTransition(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override;
+        void beginBufferStateTransition(IBuffer* buffer, ResourceStates stateBits) override;
         void setAccelStructState(rt::IAccelStruct* as, ResourceStates stateBits) override;
         
         void setPermanentTextureState(ITexture* texture, ResourceStates stateBits) override;
         void setPermanentBufferState(IBuffer* buffer, ResourceStates stateBits) override;
 
         void commitBarriers() override;
+        void aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter) override;
 
         ResourceStates getTextureSubresourceState(ITexture* texture, ArraySlice arraySlice, MipLevel mipLevel) override;
         ResourceStates getBufferState(IBuffer* buffer) override;
 
         nvrhi::IDevice* getDevice() override;
         const CommandListParameters& getDesc() override { return m_Desc; }
+        UploadStatistics getUploadStatistics() override { return m_UploadManager.getStatistics(); }
+        CommandListStatistics getStatistics() override;
 
         // D3D12 specific methods
 
@@ -954,6 +1483,7 @@ namespace nvrhi::d3d12
 
         void updateGraphicsVolatileBuffers() override;
         void updateComputeVolatileBuffers() override;
+        bool commitShaderTable(ShaderTable* shaderTable);
         void setComputeBindings(const BindingSetVector& bindings, uint32_t bindingUpdateMask, IBuffer* indirectParams, bool updateIndirectParams, const RootSignature* rootSignature);
         void setGraphicsBindings(const BindingSetVector& bindings, uint32_t bindingUpdateMask, IBuffer* indirectParams, bool updateIndirectParams, const RootSignature* rootSignature);
         
@@ -967,6 +1497,33 @@ namespace nvrhi::d3d12
             Buffer* buffer;
             D3D12_GPU_VIRTUAL_ADDRESS address;
         };
+
+        // A volatile CB bound as root constants, see BindingLayoutDesc::promoteSmallVolatileConstantBuffers
+        struct PromotedConstantBufferBinding
+        {
+            uint32_t bindingPoint; // RootParameterIndex
+            Buffer* buffer;
+            uint32_t num32BitValues;
+            uint32_t version;
+        };
+
+        // The last contents of a small volatile CB. The data is only copied into an upload buffer
+        // when the CB is bound as a root CBV, so promoted CBs generate no upload traffic.
+        struct VolatileConstantBufferShadow
+        {
+            uint32_t data[c_MaxPushConstantSize / 4];
+            uint32_t version = 0;
+        };
+
+        // The entries are kept between recordings so that the same buffers don't allocate map nodes every time,
+        // only the entries that were not written in the last recording are erased on close.
+        struct VolatileConstantBufferState
+        {
+            D3D12_GPU_VIRTUAL_ADDRESS address = 0; // zero until the contents are in an upload buffer
+            bool written = false; // in the current recording
+            bool hasShadow = false;
+            VolatileConstantBufferShadow shadow;
+        };
         
         IDevice* m_Device;
         Queue* m_Queue;
@@ -978,8 +1535,16 @@ namespace nvrhi::d3d12
         CommandListParameters m_Desc;
 
         std::shared_ptr<InternalCommandList> m_ActiveCommandList;
-        std::list<std::shared_ptr<InternalCommandList>> m_CommandListPool;
+        std::vector<std::shared_ptr<InternalCommandList>> m_CommandListPool; // in submission order
         std::shared_ptr<CommandListInstance> m_Instance;
+        // Executed instances in submission order, reused once their submission has completed and the device
+        // has retired them, see acquireInstance
+        struct PooledInstance
+        {
+            uint64_t submittedInstance = 0; // CommandListInstance::submittedInstance is cleared when it's retired
+            std::shared_ptr<CommandListInstance> instance;
+        };
+        RecyclingQueue<PooledInstance> m_InstancePool;
         uint64_t m_RecordingVersion = 0;
 
         // Cache for user-provided state
@@ -989,10 +1554,53 @@ namespace nvrhi::d3d12
         MeshletState m_CurrentMeshletState;
         rt::State m_CurrentRayTracingState;
         bool m_CurrentGraphicsStateValid = false;
+        // The block that m_CurrentGraphicsState was set from, or NULL if it was set through setGraphicsState
+        IGraphicsStateBlock* m_CurrentGraphicsStateBlock = nullptr;
         bool m_CurrentComputeStateValid = false;
         bool m_CurrentMeshletStateValid = false;
         bool m_CurrentRayTracingStateValid = false;
 
+        // Bindings recorded with setPushBindings, turned into binding sets by the next set*State call
+        PushBindings m_PushBindings;
+
+        // Trace clock time of the last open, or 0 if there was no trace recorder at that point
+        double m_TraceOpenSeconds = 0.0;
+
+        // Counters for getStatistics, only updated when m_Desc.enableStatistics is set
+        CommandListStatistics m_Statistics;
+        uint64_t m_UploadBytesAtOpen = 0;
+
+        void countDraws(uint64_t count) { if (m_Desc.enableStatistics) m_Statistics.numDraws += count; }
+        void countDispatches(uint64_t count) { if (m_Desc.enableStatistics) m_Statistics.numDispatches += count; }
+        void addBundleStatistics(CommandList* bundle);
+
+        void discardUninitializedTexture(Texture* texture);
+
+        // Profiler set with setGpuProfiler and the scopes opened by beginMarker in the current recording
+        RefCountPtr<GpuProfiler> m_GpuProfiler;
+        std::vector<uint32_t> m_GpuProfilerScopes;
+
+        // Instance data allocated by beginTopLevelInstanceWrite, consumed by commitTopLevelInstanceWrite
+        struct PendingInstanceWrite
+        {
+            AccelStruct* accelStruct = nullptr;
+            D3D12_GPU_VIRTUAL_ADDRESS instanceData = 0;
+            size_t numInstances = 0;
+        } m_PendingInstanceWrite;
+
+        // Queries ended in the current recording, resolved for CPU readback in batches when the command list is closed
+        std::vector<OcclusionQuery*> m_PendingOcclusionResolves;
+        std::vector<uint32_t> m_PendingPipelineStatisticsResolves;
+
+        void resolvePendingQueries();
+
+        // Current chunks for createTransientBindingSet
+        RefCountPtr<TransientDescriptorChunk> m_TransientChunkSRVetc;
+        RefCountPtr<TransientDescriptorChunk> m_TransientChunkSamplers;
+
+        DescriptorIndex allocateTransientDescriptors(StaticDescriptorHeap& heap, RefCountPtr<TransientDescriptorChunk>& chunk,
+            uint32_t count, uint32_t chunkSize);
+
         // Cache for internal state
 
         ID3D12DescriptorHeap* m_CurrentHeapSRVetc = nullptr;
@@ -1000,30 +1608,59 @@ namespace nvrhi::d3d12
         ID3D12Resource* m_CurrentUploadBuffer = nullptr;
         SinglePassStereoState m_CurrentSinglePassStereoState;
         
-        std::unordered_map<IBuffer*, D3D12_GPU_VIRTUAL_ADDRESS> m_VolatileConstantBufferAddresses;
+        std::unordered_map<IBuffer*, VolatileConstantBufferState> m_VolatileConstantBufferStates;
         bool m_AnyVolatileBufferWrites = false;
 
+        D3D12_GPU_VIRTUAL_ADDRESS getVolatileConstantBufferAddress(Buffer* buffer);
+        const VolatileConstantBufferShadow* getVolatileConstantBufferShadow(Buffer* buffer, bool reportErrors) const;
+
         std::vector<D3D12_RESOURCE_BARRIER> m_D3DBarriers; // Used locally in commitBarriers, member to avoid re-allocations
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        std::vector<D3D12_TEXTURE_BARRIER> m_D3DTextureBarriers; // Same, for commitEnhancedBarriers
+        std::vector<D3D12_BUFFER_BARRIER> m_D3DBufferBarriers;
+        // The texture whose contents are discarded by the barriers being committed, see discardUninitializedTexture
+        const Texture* m_InitialDiscardTexture = nullptr;
+
+        void commitEnhancedBarriers();
+#endif
 
         // Bound volatile buffer state. Saves currently bound volatile buffers and their current GPU VAs.
         // Necessary to patch the bound VAs when a buffer is updated between setGraphicsState and draw, or between draws.
 
         static_vector<VolatileConstantBufferBinding, c_MaxVolatileConstantBuffers> m_CurrentGraphicsVolatileCBs;
         static_vector<VolatileConstantBufferBinding, c_MaxVolatileConstantBuffers> m_CurrentComputeVolatileCBs;
+        static_vector<PromotedConstantBufferBinding, c_MaxVolatileConstantBuffers> m_CurrentGraphicsPromotedCBs;
+        static_vector<PromotedConstantBufferBinding, c_MaxVolatileConstantBuffers> m_CurrentComputePromotedCBs;
 
         std::unordered_map<rt::IShaderTable*, std::unique_ptr<ShaderTableState>> m_ShaderTableStates;
         ShaderTableState* getShaderTableStateTracking(rt::IShaderTable* shaderTable);
+
+        // Bundle recording state. Bundles inherit render targets, viewports and descriptor heaps from the command list
+        // that executes them, so those are captured here and applied in executeBundle.
+        BundleResourceStates m_BundleStates;
+        FramebufferHandle m_BundleFramebuffer;
+        DX12_ViewportState m_BundleViewportState;
+        ID3D12DescriptorHeap* m_BundleHeapSRVetc = nullptr;
+        ID3D12DescriptorHeap* m_BundleHeapSamplers = nullptr;
         
         void clearStateCache();
+        std::shared_ptr<CommandListInstance> acquireInstance();
+        void resetVolatileConstantBufferStates();
 
         void bindGraphicsPipeline(GraphicsPipeline* pso, bool updateRootSignature) const;
         void bindMeshletPipeline(MeshletPipeline* pso, bool updateRootSignature) const;
         void bindFramebuffer(Framebuffer* fb);
         void unbindShadingRateState();
+        // Implements setGraphicsState, using the native views baked into the block when it's not NULL
+        void setGraphicsStateInternal(const GraphicsState& state, const GraphicsStateBlock* block);
+        void drawMultiInternal(const MultiDrawArguments& multiDraw, bool indexed);
         
         std::shared_ptr<InternalCommandList> createInternalCommandList() const;
 
         void buildTopLevelAccelStructInternal(AccelStruct* as, D3D12_GPU_VIRTUAL_ADDRESS instanceData, size_t numInstances, rt::AccelStructBuildFlags buildFlags);
+#ifndef NVRHI_WITH_RTXMU
+        void writeCompactedSizes(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds, const std::vector<bool>& buildValid);
+#endif
     };
 
     class Device final : public RefCounter<IDevice>
@@ -1043,6 +1680,10 @@ namespace nvrhi::d3d12
         TextureHandle createTexture(const TextureDesc& d) override;
         MemoryRequirements getTextureMemoryRequirements(ITexture* texture) override;
         bool bindTextureMemory(ITexture* texture, IHeap* heap, uint64_t offset) override;
+        void getTextureTiling(ITexture* texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+            uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings) override;
+        void updateTextureTileMappings(ITexture* texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings,
+            CommandQueue executionQueue = CommandQueue::Graphics) override;
 
         TextureHandle createHandleForNativeTexture(ObjectType objectType, Object texture, const TextureDesc& desc) override;
 
@@ -1053,6 +1694,7 @@ namespace nvrhi::d3d12
         BufferHandle createBuffer(const BufferDesc& d) override;
         void *mapBuffer(IBuffer* b, CpuAccessMode mapFlags) override;
         void unmapBuffer(IBuffer* b) override;
+        void *tryMapBuffer(IBuffer* b, CpuAccessMode mapFlags, SubmissionId* outLastUse) override;
         MemoryRequirements getBufferMemoryRequirements(IBuffer* buffer) override;
         bool bindBufferMemory(IBuffer* buffer, IHeap* heap, uint64_t offset) override;
 
@@ -1076,18 +1718,36 @@ namespace nvrhi::d3d12
         bool pollTimerQuery(ITimerQuery* query) override;
         float getTimerQueryTime(ITimerQuery* query) override;
         void resetTimerQuery(ITimerQuery* query) override;
+        GpuProfilerHandle createGpuProfiler(const GpuProfilerDesc& desc) override;
+
+        OcclusionQueryHandle createOcclusionQuery(const OcclusionQueryDesc& desc) override;
+        bool pollOcclusionQuery(IOcclusionQuery* query) override;
+        uint64_t getOcclusionQueryResult(IOcclusionQuery* query) override;
+        void resetOcclusionQuery(IOcclusionQuery* query) override;
+
+        PipelineStatisticsQueryHandle createPipelineStatisticsQuery() override;
+        bool pollPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        PipelineStatistics getPipelineStatistics(IPipelineStatisticsQuery* query) override;
+        void resetPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
 
         GraphicsAPI getGraphicsAPI() override;
 
         FramebufferHandle createFramebuffer(const FramebufferDesc& desc) override;
         
         GraphicsPipelineHandle createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb) override;
+        GraphicsStateBlockHandle createGraphicsStateBlock(const GraphicsState& state) override;
         
         ComputePipelineHandle createComputePipeline(const ComputePipelineDesc& desc) override;
 
         MeshletPipelineHandle createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb) override;
 
         rt::PipelineHandle createRayTracingPipeline(const rt::PipelineDesc& desc) override;
+        CommandSignatureHandle createCommandSignature(const CommandSignatureDesc& desc) override;
+        bool exportPipelineCache(std::vector<uint8_t>& outData) override;
+        bool importPipelineCache(const void* data, size_t dataSize) override;
+        void setTaskScheduler(ITaskScheduler* scheduler) override { m_TaskScheduler = scheduler; }
+        ITaskScheduler* getTaskScheduler() override { return m_TaskScheduler; }
+        void setTraceRecorder(ITraceRecorder* recorder) override { m_Context.traceRecorder.set(recorder); }
 
         BindingLayoutHandle createBindingLayout(const BindingLayoutDesc& desc) override;
         BindingLayoutHandle createBindlessLayout(const BindlessLayoutDesc& desc) override;
@@ -1097,6 +1757,7 @@ namespace nvrhi::d3d12
 
         void resizeDescriptorTable(IDescriptorTable* descriptorTable, uint32_t newSize, bool keepContents = true) override;
         bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem& item) override;
+        bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem* items, size_t numItems) override;
 
         rt::OpacityMicromapHandle createOpacityMicromap(const rt::OpacityMicromapDesc& desc) override;
         rt::AccelStructHandle createAccelStruct(const rt::AccelStructDesc& desc) override;
@@ -1107,7 +1768,16 @@ namespace nvrhi::d3d12
         uint64_t executeCommandLists(nvrhi::ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue = CommandQueue::Graphics) override;
         void queueWaitForCommandList(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance) override;
         void waitForIdle() override;
+        void setDeferredSubmission(bool enable) override;
+        void flushSubmissions() override;
+        bool waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds) override;
         void runGarbageCollection() override;
+        bool runGarbageCollection(uint32_t maxMicroseconds) override;
+        MemoryStatistics getMemoryStatistics() override;
+        CommandListStatistics getCommandListStatistics(bool reset) override;
+        void setObjectCacheEnabled(bool enable) override { m_ObjectCache.setEnabled(enable); }
+        ObjectCacheStatistics getObjectCacheStatistics(bool reset) override { return m_ObjectCache.getStatistics(reset); }
+        void setMemoryBudgetCallback(IMemoryBudgetCallback* callback) override;
         bool queryFeatureSupport(Feature feature, void* pInfo = nullptr, size_t infoSize = 0) override;
         FormatSupport queryFormatSupport(Format format) override;
         Object getNativeQueue(ObjectType objectType, CommandQueue queue) override;
@@ -1119,9 +1789,23 @@ namespace nvrhi::d3d12
         GraphicsPipelineHandle createHandleForNativeGraphicsPipeline(IRootSignature* rootSignature, ID3D12PipelineState* pipelineState, const GraphicsPipelineDesc& desc, const FramebufferInfo& framebufferInfo) override;
         MeshletPipelineHandle createHandleForNativeMeshletPipeline(IRootSignature* rootSignature, ID3D12PipelineState* pipelineState, const MeshletPipelineDesc& desc, const FramebufferInfo& framebufferInfo) override;
         IDescriptorHeap* getDescriptorHeap(DescriptorHeapType heapType) override;
+        void getPlacedResourceHeapStatistics(std::vector<PlacedResourceHeapStatistics>& outStatistics) override;
+        DirectStorageQueueHandle createDirectStorageQueue(const DirectStorageQueueDesc& desc) override;
+        ID3D12Fence* getQueueFence(CommandQueue queue) override;
+        void queueWaitForFence(CommandQueue waitQueue, ID3D12Fence* fence, uint64_t value) override;
+        void queueSignalFence(CommandQueue executionQueue, ID3D12Fence* fence, uint64_t value) override;
+        uint64_t queueGetCompletedInstance(CommandQueue queue) override;
 
         // Internal interface
         Queue* getQueue(CommandQueue type) { return m_Queues[int(type)].get(); }
+        // Returns the queue of the node selected by CommandListParameters::nodeMask, see DeviceDesc::ppNodeCopyCommandQueues
+        Queue* getNodeQueue(CommandQueue type, uint32_t nodeMask);
+
+        // Waits on the CPU for 'value' of a queue fence, flushing the queue first if the instance is still queued
+        void waitForQueueFence(ID3D12Fence* fence, uint64_t value);
+
+        // Maps the resource of a buffer after the synchronization in mapBuffer or tryMapBuffer
+        void *mapBufferResource(Buffer* b, CpuAccessMode flags);
 
         Context& getContext() { return m_Context; }
 
@@ -1135,11 +1819,45 @@ namespace nvrhi::d3d12
         DeviceResources m_Resources;
 
         std::array<std::unique_ptr<Queue>, (int)CommandQueue::Count> m_Queues;
+        std::vector<std::unique_ptr<Queue>> m_NodeCopyQueues; // index is the node index - 1
+        std::vector<Queue*> m_AllQueues; // every queue of every node, for waiting, flushing and retiring
         HANDLE m_FenceEvent;
 
+        DxgiMemoryBudget m_MemoryBudget;
+        IMemoryBudgetCallback* m_MemoryBudgetCallback = nullptr;
+        ITaskScheduler* m_TaskScheduler = nullptr;
+
         std::mutex m_Mutex;
 
         std::vector<ID3D12CommandList*> m_CommandListsToExecute; // used locally in executeCommandLists, member to avoid re-allocations
+        bool m_DeferredSubmission = false;
+
+        // See DeviceDesc::enableAutomaticQueueSync
+        bool m_AutomaticQueueSync = false;
+        // Set when both the graphics and compute queues exist and ray tracing is supported:
+        // the acceleration structure storage is synchronized between the queues even without m_AutomaticQueueSync
+        bool m_AccelStructQueueSync = false;
+        std::mutex m_QueueSyncMutex;
+        QueueSynchronizer m_QueueSynchronizer;
+
+        // Sum of the statistics of the executed command lists, see IDevice::getCommandListStatistics
+        CommandListStatistics m_CommandListStatistics;
+        std::mutex m_CommandListStatisticsMutex;
+
+        // See IDevice::setObjectCacheEnabled
+        ObjectCache m_ObjectCache;
+
+        SamplerHandle createSamplerInternal(const SamplerDesc& d);
+        GraphicsPipelineHandle createGraphicsPipelineInternal(const GraphicsPipelineDesc& desc, IFramebuffer* fb);
+        ComputePipelineHandle createComputePipelineInternal(const ComputePipelineDesc& desc);
+        MeshletPipelineHandle createMeshletPipelineInternal(const MeshletPipelineDesc& desc, IFramebuffer* fb);
+        BindingSetHandle createBindingSetInternal(const BindingSetDesc& desc, IBindingLayout* layout);
+
+        // Created last and destroyed first, see DeviceDesc::enableBackgroundGarbageCollection
+        std::unique_ptr<GarbageCollectionThread> m_GarbageCollectionThread;
+
+        bool retireCommandLists(std::chrono::steady_clock::time_point deadline);
+        bool runGarbageCollection(std::chrono::steady_clock::time_point deadline);
         
         bool m_NvapiIsInitialized = false;
         bool m_SinglePassStereoSupported = false;
@@ -1148,6 +1866,7 @@ namespace nvrhi::d3d12
         bool m_TraceRayInlineSupported = false;
         bool m_MeshletsSupported = false;
         bool m_VariableRateShadingSupported = false;
+        bool m_GpuUploadHeapsSupported = false;
         bool m_OpacityMicromapSupported = false;
         bool m_ShaderExecutionReorderingSupported = false;
 
@@ -1157,6 +1876,22 @@ namespace nvrhi::d3d12
         D3D12_FEATURE_DATA_D3D12_OPTIONS7 m_Options7 = {};
 
         RefCountPtr<RootSignature> getRootSignature(const static_vector<BindingLayoutHandle, c_MaxBindingLayouts>& pipelineLayouts, bool allowInputLayout);
+        void collectRootSignatureGarbage();
+
+        // Creates the view for one descriptor table item in the non-shader-visible heap
+        bool writeDescriptorTableItem(DescriptorTable* descriptorTable, const BindingSetItem& binding);
+
+        // Pipeline library that caches PSOs created by this device, can be exported and imported by the application.
+        // The library references m_PipelineLibraryData, so that must stay alive as long as the library does.
+        RefCountPtr<ID3D12PipelineLibrary> m_PipelineLibrary;
+        RefCountPtr<ID3D12PipelineLibrary1> m_PipelineLibrary1;
+        std::vector<uint8_t> m_PipelineLibraryData;
+        mutable std::mutex m_PipelineLibraryMutex;
+
+        void createPipelineLibrary();
+        static std::wstring getPipelineLibraryKey(uint64_t hash);
+        void storePipelineInLibrary(const std::wstring& key, ID3D12PipelineState* pipelineState) const;
+
         RefCountPtr<ID3D12PipelineState> createPipelineState(const GraphicsPipelineDesc& desc, RootSignature* pRS, const FramebufferInfo& fbinfo) const;
         RefCountPtr<ID3D12PipelineState> createPipelineState(const ComputePipelineDesc& desc, RootSignature* pRS) const;
         RefCountPtr<ID3D12PipelineState> createPipelineState(const MeshletPipelineDesc& desc, RootSignature* pRS, const FramebufferInfo& fbinfo) const;
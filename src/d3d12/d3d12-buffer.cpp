@@ -50,6 +50,12 @@ namespace nvrhi::d3d12
             m_Resources.shaderResourceViewHeap.releaseDescriptor(m_ClearUAV);
             m_ClearUAV = c_InvalidDescriptorIndex;
         }
+
+        if (placedAllocation.poolHeap)
+        {
+            resource = nullptr;
+            m_Resources.placedResourcePool.release(placedAllocation);
+        }
     }
 
     BufferHandle Device::createBuffer(const BufferDesc& d)
@@ -102,6 +108,8 @@ namespace nvrhi::d3d12
             isShared = true;
         }
 
+        bool useGpuUploadHeap = false;
+
         switch(buffer->desc.cpuAccess)
         {
             case CpuAccessMode::None:
@@ -117,18 +125,50 @@ namespace nvrhi::d3d12
                 break;
 
             case CpuAccessMode::Write:
+            case CpuAccessMode::Discard:
+            case CpuAccessMode::NoOverwrite:
                 heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+#if NVRHI_D3D12_WITH_GPU_UPLOAD_HEAPS
+                useGpuUploadHeap = d.preferDeviceLocal && m_GpuUploadHeapsSupported;
+                if (useGpuUploadHeap)
+                    heapProps.Type = D3D12_HEAP_TYPE_GPU_UPLOAD;
+#endif
                 initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
                 break;
         }
 
-        HRESULT res = m_Context.device->CreateCommittedResource(
-            &heapProps,
-            heapFlags,
-            &resourceDesc,
-            initialState,
-            nullptr,
-            IID_PPV_ARGS(&buffer->resource));
+        heapProps.CreationNodeMask = d.creationNodeMask;
+        heapProps.VisibleNodeMask = d.visibleNodeMask;
+
+        // The pool heaps are created on node 0 only
+        const bool useNodeMasks = d.creationNodeMask > 1 || d.visibleNodeMask > 1;
+
+        HRESULT res = S_OK;
+        // The placed resource pool has no GPU upload heaps
+        if (isShared || useNodeMasks || useGpuUploadHeap || !m_Resources.placedResourcePool.tryCreateResource(heapProps.Type, PlacedResourcePool::ResourceClass::Buffer,
+            resourceDesc, initialState, nullptr, buffer->placedAllocation, buffer->resource))
+        {
+            res = m_Context.device->CreateCommittedResource(
+                &heapProps,
+                heapFlags,
+                &resourceDesc,
+                initialState,
+                nullptr,
+                IID_PPV_ARGS(&buffer->resource));
+
+            // The GPU upload heap is limited by the BAR size, use the regular upload heap when it's full
+            if (FAILED(res) && useGpuUploadHeap)
+            {
+                heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+                res = m_Context.device->CreateCommittedResource(
+                    &heapProps,
+                    heapFlags,
+                    &resourceDesc,
+                    initialState,
+                    nullptr,
+                    IID_PPV_ARGS(&buffer->resource));
+            }
+        }
 
         if (FAILED(res))
         {
@@ -163,6 +203,10 @@ namespace nvrhi::d3d12
             }
         }
 
+        // Residency is only managed for the submissions on node 0
+        if (!isShared && !useNodeMasks && !buffer->placedAllocation.poolHeap && heapProps.Type == D3D12_HEAP_TYPE_DEFAULT)
+            m_Resources.residencyManager.trackResource(buffer->residency, buffer->resource, resourceDesc, d.residencyPriority);
+
         buffer->postCreate();
 
         return BufferHandle::Create(buffer);
@@ -197,12 +241,48 @@ namespace nvrhi::d3d12
     {
         Buffer* b = checked_cast<Buffer*>(_b);
 
-        if (b->lastUseFence)
+        if (b->lastUseFence && flags != CpuAccessMode::NoOverwrite)
+        {
+            waitForQueueFence(b->lastUseFence, b->lastUseFenceValue);
+            b->lastUseFence = nullptr;
+        }
+
+        return mapBufferResource(b, flags);
+    }
+
+    void *Device::tryMapBuffer(IBuffer* _b, CpuAccessMode flags, SubmissionId* outLastUse)
+    {
+        Buffer* b = checked_cast<Buffer*>(_b);
+
+        if (outLastUse)
+        {
+            outLastUse->queue = b->lastUseQueue;
+            outLastUse->instance = b->lastUseFenceValue;
+        }
+
+        if (b->lastUseFence && flags != CpuAccessMode::NoOverwrite)
         {
-            WaitForFence(b->lastUseFence, b->lastUseFenceValue, m_FenceEvent);
+            if (b->lastUseFence->GetCompletedValue() < b->lastUseFenceValue)
+            {
+                // Make sure that the submission is executed so that a later attempt can succeed.
+                // The queue is found by its fence because the buffer may have been used on another node.
+                for (Queue* pQueue : m_AllQueues)
+                {
+                    if (pQueue->fence == b->lastUseFence && b->lastUseFenceValue > pQueue->getLastFlushedInstance())
+                        pQueue->flush();
+                }
+
+                return nullptr;
+            }
+
             b->lastUseFence = nullptr;
         }
 
+        return mapBufferResource(b, flags);
+    }
+
+    void *Device::mapBufferResource(Buffer* b, CpuAccessMode flags)
+    {
         D3D12_RANGE range;
 
         if (flags == CpuAccessMode::Read)
@@ -443,6 +523,22 @@ namespace nvrhi::d3d12
     {
         Buffer* buffer = checked_cast<Buffer*>(_b);
 
+        if (buffer->desc.isVolatile && dataSize <= c_MaxPushConstantSize)
+        {
+            // Keep the contents of small volatile CBs in the command list. They are bound as root constants
+            // when promoted, or copied into an upload buffer when first bound as a root CBV.
+            VolatileConstantBufferState& state = m_VolatileConstantBufferStates[buffer];
+            memcpy(state.shadow.data, data, dataSize);
+            memset(reinterpret_cast<uint8_t*>(state.shadow.data) + dataSize, 0, sizeof(state.shadow.data) - dataSize);
+            ++state.shadow.version;
+
+            state.address = 0;
+            state.written = true;
+            state.hasShadow = true;
+            m_AnyVolatileBufferWrites = true;
+            return;
+        }
+
         void* cpuVA;
         D3D12_GPU_VIRTUAL_ADDRESS gpuVA;
         ID3D12Resource* uploadBuffer;
@@ -464,7 +560,10 @@ namespace nvrhi::d3d12
 
         if (buffer->desc.isVolatile)
         {
-            m_VolatileConstantBufferAddresses[buffer] = gpuVA;
+            VolatileConstantBufferState& state = m_VolatileConstantBufferStates[buffer];
+            state.address = gpuVA;
+            state.written = true;
+            state.hasShadow = false;
             m_AnyVolatileBufferWrites = true;
         }
         else
@@ -481,6 +580,60 @@ namespace nvrhi::d3d12
         }
     }
 
+    D3D12_GPU_VIRTUAL_ADDRESS CommandList::getVolatileConstantBufferAddress(Buffer* buffer)
+    {
+        const auto found = m_VolatileConstantBufferStates.find(buffer);
+        if (found == m_VolatileConstantBufferStates.end() || !found->second.written)
+            return 0;
+
+        VolatileConstantBufferState& state = found->second;
+        if (state.address)
+            return state.address;
+
+        // The buffer may have been written into without being uploaded yet, see writeBuffer
+        if (!state.hasShadow)
+            return 0;
+
+        void* cpuVA;
+        D3D12_GPU_VIRTUAL_ADDRESS gpuVA;
+        ID3D12Resource* uploadBuffer;
+        if (!m_UploadManager.suballocateBuffer(sizeof(state.shadow.data), nullptr, &uploadBuffer, nullptr, &cpuVA, &gpuVA,
+            m_RecordingVersion, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT))
+        {
+            m_Context.error("Couldn't suballocate an upload buffer");
+            return 0;
+        }
+
+        if (uploadBuffer != m_CurrentUploadBuffer)
+        {
+            m_Instance->referencedNativeResources.push_back(uploadBuffer);
+            m_CurrentUploadBuffer = uploadBuffer;
+        }
+
+        memcpy(cpuVA, state.shadow.data, sizeof(state.shadow.data));
+
+        state.address = gpuVA;
+        return state.address;
+    }
+
+    const CommandList::VolatileConstantBufferShadow* CommandList::getVolatileConstantBufferShadow(Buffer* buffer, bool reportErrors) const
+    {
+        const auto found = m_VolatileConstantBufferStates.find(buffer);
+        if (found != m_VolatileConstantBufferStates.end() && found->second.written && found->second.hasShadow)
+            return &found->second.shadow;
+
+        if (reportErrors)
+        {
+            std::stringstream ss;
+            ss << "Attempted use of a volatile constant buffer " << utils::DebugNameToString(buffer->desc.debugName)
+                << " as root constants before it was written into, or after it was written with more than "
+                << c_MaxPushConstantSize << " bytes of data";
+            m_Context.error(ss.str());
+        }
+
+        return nullptr;
+    }
+
     void CommandList::clearBufferUInt(IBuffer* _b, uint32_t clearValue)
     {
         Buffer* b = checked_cast<Buffer*>(_b);
@@ -32,11 +32,12 @@ namespace nvrhi::d3d12
         : m_Context(context)
         , m_Resources(resources)
         , m_Device(device)
-        , m_Queue(device->getQueue(params.queueType))
-        , m_UploadManager(context, m_Queue, params.uploadChunkSize, 0, false)
-        , m_DxrScratchManager(context, m_Queue, params.scratchChunkSize, params.scratchMaxMemory, true)
+        , m_Queue(device->getNodeQueue(params.queueType, params.nodeMask))
+        , m_UploadManager(context, m_Queue, params.uploadChunkSize, 0, false, params.uploadRingSize, params.nodeMask)
+        , m_DxrScratchManager(context, m_Queue, params.scratchChunkSize, params.scratchMaxMemory, true, 0, params.nodeMask)
         , m_StateTracker(context.messageCallback)
         , m_Desc(params)
+        , m_BundleStates(context.messageCallback)
     {
     }
     
@@ -72,7 +73,7 @@ namespace nvrhi::d3d12
         switch (m_Desc.queueType)
         {
         case CommandQueue::Graphics:
-            d3dCommandListType = D3D12_COMMAND_LIST_TYPE_DIRECT;
+            d3dCommandListType = m_Desc.isBundle ? D3D12_COMMAND_LIST_TYPE_BUNDLE : D3D12_COMMAND_LIST_TYPE_DIRECT;
             break;
         case CommandQueue::Compute:
             d3dCommandListType = D3D12_COMMAND_LIST_TYPE_COMPUTE;
@@ -88,10 +89,14 @@ namespace nvrhi::d3d12
         }
 
         m_Context.device->CreateCommandAllocator(d3dCommandListType, IID_PPV_ARGS(&commandList->allocator));
-        m_Context.device->CreateCommandList(0, d3dCommandListType, commandList->allocator, nullptr, IID_PPV_ARGS(&commandList->commandList));
+        m_Context.device->CreateCommandList(m_Desc.nodeMask, d3dCommandListType, commandList->allocator, nullptr, IID_PPV_ARGS(&commandList->commandList));
 
         commandList->commandList->QueryInterface(IID_PPV_ARGS(&commandList->commandList4));
         commandList->commandList->QueryInterface(IID_PPV_ARGS(&commandList->commandList6));
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        if (m_Context.enhancedBarriers)
+            commandList->commandList->QueryInterface(IID_PPV_ARGS(&commandList->commandList7));
+#endif
 
         return commandList;
     }
@@ -103,14 +108,22 @@ namespace nvrhi::d3d12
 
         if (heapSRVetc != m_CurrentHeapSRVetc || heapSamplers != m_CurrentHeapSamplers)
         {
-            ID3D12DescriptorHeap* heaps[2] = { heapSRVetc, heapSamplers };
-            m_ActiveCommandList->commandList->SetDescriptorHeaps(2, heaps);
+            // The heaps are created on first use, so either of them may not exist yet
+            ID3D12DescriptorHeap* heaps[2];
+            uint32_t numHeaps = 0;
+            if (heapSRVetc)
+                heaps[numHeaps++] = heapSRVetc;
+            if (heapSamplers)
+                heaps[numHeaps++] = heapSamplers;
+
+            if (numHeaps > 0)
+                m_ActiveCommandList->commandList->SetDescriptorHeaps(numHeaps, heaps);
 
             m_CurrentHeapSRVetc = heapSRVetc;
             m_CurrentHeapSamplers = heapSamplers;
 
-            m_Instance->referencedNativeResources.push_back(heapSRVetc);
-            m_Instance->referencedNativeResources.push_back(heapSamplers);
+            for (uint32_t i = 0; i < numHeaps; i++)
+                m_Instance->referencedNativeResources.push_back(heaps[i]);
 
             return true;
         }
@@ -139,7 +152,7 @@ namespace nvrhi::d3d12
 
         if (buffer->desc.isVolatile)
         {
-            return m_VolatileConstantBufferAddresses[buffer];
+            return getVolatileConstantBufferAddress(buffer);
         }
 
         return buffer->gpuVA;
@@ -153,13 +166,44 @@ namespace nvrhi::d3d12
     void CommandList::beginMarker(const char* name)
     {
         PIXBeginEvent(m_ActiveCommandList->commandList, 0, name);
+
+        if (m_GpuProfiler)
+        {
+            const uint32_t parent = m_GpuProfilerScopes.empty() ? GpuProfilerBase::c_InvalidScope : m_GpuProfilerScopes.back();
+            const uint32_t scope = m_GpuProfiler->beginScope(name, parent);
+            m_GpuProfilerScopes.push_back(scope);
+
+            if (scope != GpuProfilerBase::c_InvalidScope)
+            {
+                m_Instance->referencedResources.push_back(m_GpuProfiler);
+                m_ActiveCommandList->commandList->EndQuery(m_GpuProfiler->queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GpuProfilerBase::getBeginQuery(scope));
+            }
+        }
     }
 
     void CommandList::endMarker()
     {
+        if (m_GpuProfiler && !m_GpuProfilerScopes.empty())
+        {
+            const uint32_t scope = m_GpuProfilerScopes.back();
+            m_GpuProfilerScopes.pop_back();
+
+            if (scope != GpuProfilerBase::c_InvalidScope)
+            {
+                m_ActiveCommandList->commandList->EndQuery(m_GpuProfiler->queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GpuProfilerBase::getEndQuery(scope));
+                m_GpuProfiler->endScope(scope);
+            }
+        }
+
         PIXEndEvent(m_ActiveCommandList->commandList);
     }
 
+    void CommandList::setGpuProfiler(IGpuProfiler* profiler)
+    {
+        m_GpuProfiler = checked_cast<GpuProfiler*>(profiler);
+        m_GpuProfilerScopes.clear();
+    }
+
     void CommandList::setPushConstants(const void* data, size_t byteSize)
     {
         const RootSignature* rootsig = nullptr;
@@ -194,6 +238,9 @@ namespace nvrhi::d3d12
             return;
 
         assert(byteSize == rootsig->pushConstantByteSize); // the validation error handles the error message
+
+        if (m_Desc.enableStatistics)
+            m_Statistics.pushConstantBytes += byteSize;
         
         if (isGraphics)
             m_ActiveCommandList->commandList->SetGraphicsRoot32BitConstants(rootsig->rootParameterPushConstants, UINT(byteSize / 4), data, 0);
@@ -201,21 +248,56 @@ namespace nvrhi::d3d12
             m_ActiveCommandList->commandList->SetComputeRoot32BitConstants(rootsig->rootParameterPushConstants, UINT(byteSize / 4), data, 0);
     }
 
-    void CommandList::open()
+    void CommandList::setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings)
     {
-        uint64_t completedInstance = m_Queue->updateLastCompletedInstance();
+        m_PushBindings.set(layoutIndex, bindings);
+    }
 
+    void CommandList::open()
+    {
         std::shared_ptr<InternalCommandList> chunk;
 
-        if (!m_CommandListPool.empty())
+        // Uploads of a previous recording that was closed but never executed are not going to be submitted
+        if (!m_Desc.isBundle)
+            m_UploadManager.releaseUnsubmitted();
+
+        if (m_Desc.isBundle)
         {
+            // Bundles are never submitted directly. Their command lists are kept alive by the instances
+            // of the command lists that executed them, so a chunk is free when the pool holds the only reference.
+            m_Instance.reset();
+            if (m_ActiveCommandList)
+            {
+                m_CommandListPool.push_back(std::move(m_ActiveCommandList));
+            }
+
+            for (auto it = m_CommandListPool.begin(); it != m_CommandListPool.end(); ++it)
+            {
+                if (it->use_count() == 1)
+                {
+                    chunk = *it;
+                    chunk->allocator->Reset();
+                    chunk->commandList->Reset(chunk->allocator, nullptr);
+                    m_CommandListPool.erase(it);
+                    break;
+                }
+            }
+
+            m_BundleStates.clear();
+            m_BundleFramebuffer = m_Desc.bundleFramebuffer;
+            m_BundleViewportState = DX12_ViewportState();
+        }
+        else if (!m_CommandListPool.empty())
+        {
+            uint64_t completedInstance = m_Queue->updateLastCompletedInstance();
+
             chunk = m_CommandListPool.front();
 
             if (chunk->lastSubmittedInstance <= completedInstance)
             {
                 chunk->allocator->Reset();
                 chunk->commandList->Reset(chunk->allocator, nullptr);
-                m_CommandListPool.pop_front();
+                m_CommandListPool.erase(m_CommandListPool.begin());
             }
             else
             {
@@ -230,18 +312,55 @@ namespace nvrhi::d3d12
 
         m_ActiveCommandList = chunk;
 
-        m_Instance = std::make_shared<CommandListInstance>();
+        m_Instance = acquireInstance();
         m_Instance->commandAllocator = m_ActiveCommandList->allocator;
         m_Instance->commandList = m_ActiveCommandList->commandList;
         m_Instance->commandQueue = m_Desc.queueType;
+        if (m_Desc.isBundle)
+            m_Instance->bundleCommandList = m_ActiveCommandList;
 
         m_RecordingVersion = MakeVersion(m_Queue->recordingInstance++, m_Desc.queueType, false);
+
+        m_GpuProfilerScopes.clear();
+        m_PendingInstanceWrite = PendingInstanceWrite();
+
+        m_Statistics = CommandListStatistics();
+        m_UploadBytesAtOpen = m_UploadManager.getBytesRequested();
+
+        m_TraceOpenSeconds = m_Context.traceRecorder.get() ? getTraceClockSeconds() : 0.0;
+    }
+
+    CommandListStatistics CommandList::getStatistics()
+    {
+        if (!m_Desc.enableStatistics)
+            return CommandListStatistics();
+
+        CommandListStatistics statistics = m_Statistics;
+        statistics.bytesUploaded += m_UploadManager.getBytesRequested() - m_UploadBytesAtOpen;
+
+        // The instance is released when the command list is executed, the count is kept from that point
+        if (m_Instance)
+            statistics.numReferencedResources = m_Instance->referencedResources.size();
+
+        return statistics;
+    }
+
+    void CommandList::addBundleStatistics(CommandList* bundle)
+    {
+        if (!m_Desc.enableStatistics)
+            return;
+
+        // The bundle's resources are kept alive through the bundle instance and are not counted again
+        CommandListStatistics bundleStatistics = bundle->getStatistics();
+        bundleStatistics.numReferencedResources = 0;
+        m_Statistics += bundleStatistics;
     }
 
     void CommandList::clearStateCache()
     {
         m_AnyVolatileBufferWrites = false;
         m_CurrentGraphicsStateValid = false;
+        m_CurrentGraphicsStateBlock = nullptr;
         m_CurrentComputeStateValid = false;
         m_CurrentMeshletStateValid = false;
         m_CurrentRayTracingStateValid = false;
@@ -249,6 +368,8 @@ namespace nvrhi::d3d12
         m_CurrentHeapSamplers = nullptr;
         m_CurrentGraphicsVolatileCBs.resize(0);
         m_CurrentComputeVolatileCBs.resize(0);
+        m_CurrentGraphicsPromotedCBs.resize(0);
+        m_CurrentComputePromotedCBs.resize(0);
         m_CurrentSinglePassStereoState = SinglePassStereoState();
     }
 
@@ -276,10 +397,32 @@ namespace nvrhi::d3d12
 
     void CommandList::close()
     {
+        TraceRecorderHandle traceRecorder = m_Context.traceRecorder.get();
+        if (traceRecorder && m_TraceOpenSeconds > 0.0)
+        {
+            traceRecorder->recordCpuEvent("Record command list", "CommandList", m_TraceOpenSeconds, getTraceClockSeconds(),
+                "queue", uint64_t(m_Desc.queueType));
+        }
+
+        if (m_Desc.isBundle)
+        {
+            // The bundle must be executed with the same descriptor heaps that it has set
+            m_BundleHeapSRVetc = m_CurrentHeapSRVetc;
+            m_BundleHeapSamplers = m_CurrentHeapSamplers;
+
+            m_ActiveCommandList->commandList->Close();
+
+            clearStateCache();
+            return;
+        }
+
+        m_StateTracker.endSplitTransitions();
         m_StateTracker.keepBufferInitialStates();
         m_StateTracker.keepTextureInitialStates();
         commitBarriers();
 
+        resolvePendingQueries();
+
 #ifdef NVRHI_WITH_RTXMU
         if (!m_Instance->rtxmuBuildIds.empty())
         {
@@ -292,20 +435,82 @@ namespace nvrhi::d3d12
         clearStateCache();
 
         m_CurrentUploadBuffer = nullptr;
-        m_VolatileConstantBufferAddresses.clear();
+        resetVolatileConstantBufferStates();
         m_ShaderTableStates.clear();
     }
 
+    void CommandList::resetVolatileConstantBufferStates()
+    {
+        // Entries of the buffers that were not written in this recording are erased, so the entries of destroyed
+        // buffers go away after one more recording. The keys are never dereferenced.
+        for (auto it = m_VolatileConstantBufferStates.begin(); it != m_VolatileConstantBufferStates.end(); )
+        {
+            VolatileConstantBufferState& state = it->second;
+            if (!state.written)
+            {
+                it = m_VolatileConstantBufferStates.erase(it);
+                continue;
+            }
+
+            state.address = 0;
+            state.written = false;
+            state.hasShadow = false;
+            ++it;
+        }
+    }
+
+    std::shared_ptr<CommandListInstance> CommandList::acquireInstance()
+    {
+        // Bundle instances are kept alive by the instances of the command lists that executed them and have
+        // no submission of their own to wait for, so they are not pooled
+        if (!m_Desc.isBundle && !m_InstancePool.empty() &&
+            m_InstancePool.front().submittedInstance <= m_Queue->updateLastCompletedInstance() &&
+            m_InstancePool.front().instance->retired.load(std::memory_order_acquire))
+        {
+            std::shared_ptr<CommandListInstance> instance = m_InstancePool.pop_front().instance;
+            instance->retired.store(false, std::memory_order_relaxed);
+            return instance;
+        }
+
+        return std::make_shared<CommandListInstance>();
+    }
+
+    void CommandListInstance::reset()
+    {
+        submittedInstance = 0;
+        fence = nullptr;
+        commandAllocator = nullptr;
+        commandList = nullptr;
+        referencedResources.clear();
+        referencedNativeResources.clear();
+        referencedStagingTextures.clear();
+        referencedStagingBuffers.clear();
+        referencedTimerQueries.clear();
+        referencedOcclusionQueries.clear();
+        referencedPipelineStatisticsQueries.clear();
+        referencedBundles.clear();
+        untrackedBindingSets.clear();
+        bundleCommandList.reset();
+#ifdef NVRHI_WITH_RTXMU
+        rtxmuBuildIds.clear();
+        rtxmuCompactionIds.clear();
+#else
+        compactableBuilds.clear();
+#endif
+    }
+
     std::shared_ptr<CommandListInstance> CommandList::executed(Queue* pQueue)
     {
         std::shared_ptr<CommandListInstance> instance = m_Instance;
         instance->fence = pQueue->fence;
         instance->submittedInstance = pQueue->lastSubmittedInstance;
+        m_Statistics.numReferencedResources = instance->referencedResources.size();
         m_Instance.reset();
 
+        m_InstancePool.push_back(PooledInstance{ instance->submittedInstance, instance });
+
         m_ActiveCommandList->lastSubmittedInstance = pQueue->lastSubmittedInstance;
-        m_CommandListPool.push_back(m_ActiveCommandList);
-        m_ActiveCommandList.reset();
+        m_CommandListPool.push_back(std::move(m_ActiveCommandList));
 
         for (const auto& it : instance->referencedStagingTextures)
         {
@@ -317,6 +522,7 @@ namespace nvrhi::d3d12
         {
             it->lastUseFence = pQueue->fence;
             it->lastUseFenceValue = instance->submittedInstance;
+            it->lastUseQueue = m_Desc.queueType;
         }
 
         for (const auto& it : instance->referencedTimerQueries)
@@ -327,6 +533,22 @@ namespace nvrhi::d3d12
             it->fenceCounter = instance->submittedInstance;
         }
 
+        for (const auto& it : instance->referencedOcclusionQueries)
+        {
+            it->started = true;
+            it->resolved = false;
+            it->fence = pQueue->fence;
+            it->fenceCounter = instance->submittedInstance;
+        }
+
+        for (const auto& it : instance->referencedPipelineStatisticsQueries)
+        {
+            it->started = true;
+            it->resolved = false;
+            it->fence = pQueue->fence;
+            it->fenceCounter = instance->submittedInstance;
+        }
+
         m_StateTracker.commandListSubmitted();
 
         uint64_t submittedVersion = MakeVersion(instance->submittedInstance, m_Desc.queueType, true);
@@ -23,6 +23,7 @@
 #include "d3d12-backend.h"
 
 #include <nvrhi/common/misc.h>
+#include "../common/pipeline-cache.h"
 #include <sstream>
 
 namespace nvrhi::d3d12
@@ -67,6 +68,25 @@ namespace nvrhi::d3d12
         }
 #endif
 
+        std::wstring libraryKey;
+        {
+            // importPipelineCache may replace the library concurrently
+            std::lock_guard lockGuard(m_PipelineLibraryMutex);
+            if (m_PipelineLibrary)
+            {
+                // Same as hashPipelineStateDesc for graphics PSOs: every field, with the root signature's serialized hash
+                uint64_t hash = hashPipelineCacheData(&pRS->serializedHash, sizeof(pRS->serializedHash));
+                hash = hashPipelineCacheData(&desc.CS.BytecodeLength, sizeof(desc.CS.BytecodeLength), hash);
+                hash = hashPipelineCacheData(desc.CS.pShaderBytecode, desc.CS.BytecodeLength, hash);
+                hash = hashPipelineCacheData(&desc.NodeMask, sizeof(desc.NodeMask), hash);
+                hash = hashPipelineCacheData(&desc.Flags, sizeof(desc.Flags), hash);
+                libraryKey = getPipelineLibraryKey(hash);
+
+                if (SUCCEEDED(m_PipelineLibrary->LoadComputePipeline(libraryKey.c_str(), &desc, IID_PPV_ARGS(&pipelineState))))
+                    return pipelineState;
+            }
+        }
+
         const HRESULT hr = m_Context.device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pipelineState));
 
         if (FAILED(hr))
@@ -75,12 +95,25 @@ namespace nvrhi::d3d12
             return nullptr;
         }
 
+        if (!libraryKey.empty())
+            storePipelineInLibrary(libraryKey, pipelineState);
+
         return pipelineState;
     }
 
     ComputePipelineHandle Device::createComputePipeline(const ComputePipelineDesc& desc)
     {
+        return m_ObjectCache.getComputePipeline(desc, [this, &desc] { return createComputePipelineInternal(desc); });
+    }
+
+    ComputePipelineHandle Device::createComputePipelineInternal(const ComputePipelineDesc& desc)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createComputePipeline", "Pipeline");
+
         RefCountPtr<RootSignature> pRS = getRootSignature(desc.bindingLayouts, false);
+        if (!pRS)
+            return nullptr;
+
         RefCountPtr<ID3D12PipelineState> pPSO = createPipelineState(desc, pRS);
 
         if (pPSO == nullptr)
@@ -98,6 +131,17 @@ namespace nvrhi::d3d12
 
     void CommandList::setComputeState(const ComputeState& state)
     {
+        if (!m_PushBindings.empty() && state.pipeline)
+        {
+            ComputeState resolvedState = state;
+            if (m_Desc.enableStatistics)
+                m_Statistics.numDescriptorsWritten += m_PushBindings.getNumBindings();
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, &m_Instance->referencedResources))
+                setComputeState(resolvedState);
+            m_PushBindings.clear();
+            return;
+        }
+
         ComputePipeline* pso = checked_cast<ComputePipeline*>(state.pipeline);
 
         const bool updateRootSignature = !m_CurrentComputeStateValid || m_CurrentComputeState.pipeline == nullptr ||
@@ -116,6 +160,9 @@ namespace nvrhi::d3d12
         if (bindingUpdateMask == 0)
             bindingUpdateMask = arrayDifferenceMask(m_CurrentComputeState.bindings, state.bindings);
 
+        if (m_Desc.enableStatistics)
+            countStateChanges(m_Statistics, { updatePipeline, bindingUpdateMask != 0, updateIndirectParams });
+
         if (updateRootSignature)
         {
             m_ActiveCommandList->commandList->SetComputeRootSignature(pso->rootSignature->handle);
@@ -149,7 +196,7 @@ namespace nvrhi::d3d12
 
         for (VolatileConstantBufferBinding& parameter : m_CurrentComputeVolatileCBs)
         {
-            const D3D12_GPU_VIRTUAL_ADDRESS currentGpuVA = m_VolatileConstantBufferAddresses[parameter.buffer];
+            const D3D12_GPU_VIRTUAL_ADDRESS currentGpuVA = getVolatileConstantBufferAddress(parameter.buffer);
 
             if (currentGpuVA != parameter.address)
             {
@@ -159,6 +206,18 @@ namespace nvrhi::d3d12
             }
         }
 
+        for (PromotedConstantBufferBinding& parameter : m_CurrentComputePromotedCBs)
+        {
+            const VolatileConstantBufferShadow* shadow = getVolatileConstantBufferShadow(parameter.buffer, false);
+
+            if (shadow && shadow->version != parameter.version)
+            {
+                m_ActiveCommandList->commandList->SetComputeRoot32BitConstants(parameter.bindingPoint, parameter.num32BitValues, shadow->data, 0);
+
+                parameter.version = shadow->version;
+            }
+        }
+
         m_AnyVolatileBufferWrites = false;
     }
 
@@ -166,6 +225,7 @@ namespace nvrhi::d3d12
     {
         updateComputeVolatileBuffers();
 
+        countDispatches(1);
         m_ActiveCommandList->commandList->Dispatch(groupsX, groupsY, groupsZ);
     }
 
@@ -176,7 +236,8 @@ namespace nvrhi::d3d12
 
         updateComputeVolatileBuffers();
 
-        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.dispatchIndirectSignature, 1, indirectParams->resource, offsetBytes, nullptr, 0);
+        countDispatches(1);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH), 1, indirectParams->resource, offsetBytes, nullptr, 0);
     }
 
 } // namespace nvrhi::d3d12
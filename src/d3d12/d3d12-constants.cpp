@@ -267,10 +267,112 @@ namespace nvrhi::d3d12
         if ((stateBits & ResourceStates::ShadingRateSurface) != 0) result |= D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE;
         if ((stateBits & ResourceStates::OpacityMicromapBuildInput) != 0) result |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
         if ((stateBits & ResourceStates::OpacityMicromapWrite) != 0) result |= D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE;
+        if ((stateBits & ResourceStates::Predication) != 0) result |= D3D12_RESOURCE_STATE_PREDICATION;
 
         return result;
     }
 
+    D3D12_RESOURCE_STATES convertInitialTextureState(ResourceStates stateBits, bool enhancedBarriers)
+    {
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        // The legacy creation state implies the initial layout of the texture,
+        // which has to match the layout that the enhanced barriers assume for the state.
+        if (enhancedBarriers && convertEnhancedBarrierState(stateBits).layout == D3D12_BARRIER_LAYOUT_COMMON)
+            return D3D12_RESOURCE_STATE_COMMON;
+#else
+        (void)enhancedBarriers;
+#endif
+
+        return convertResourceStates(stateBits);
+    }
+
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+    EnhancedBarrierState convertEnhancedBarrierState(ResourceStates stateBits)
+    {
+        EnhancedBarrierState result;
+
+        // Resources in an unknown state are in the layout they were created in, which is COMMON for such states,
+        // see convertInitialTextureState. UNDEFINED would discard the contents, which is only done explicitly
+        // for uninitialized textures, see CommandList::commitEnhancedBarriers.
+        if (stateBits == ResourceStates::Unknown)
+        {
+            result.layout = D3D12_BARRIER_LAYOUT_COMMON;
+            return result;
+        }
+
+        if (stateBits == ResourceStates::Common || stateBits == ResourceStates::Present)
+        {
+            result.sync = D3D12_BARRIER_SYNC_ALL;
+            result.access = D3D12_BARRIER_ACCESS_COMMON;
+            result.layout = (stateBits == ResourceStates::Present) ? D3D12_BARRIER_LAYOUT_PRESENT : D3D12_BARRIER_LAYOUT_COMMON;
+            return result;
+        }
+
+        auto add = [&result, stateBits](ResourceStates state, D3D12_BARRIER_SYNC sync, D3D12_BARRIER_ACCESS access)
+        {
+            if ((stateBits & state) != 0)
+            {
+                result.sync |= sync;
+                result.access |= access;
+            }
+        };
+
+        add(ResourceStates::ConstantBuffer, D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_CONSTANT_BUFFER);
+        add(ResourceStates::VertexBuffer, D3D12_BARRIER_SYNC_VERTEX_SHADING, D3D12_BARRIER_ACCESS_VERTEX_BUFFER);
+        add(ResourceStates::IndexBuffer, D3D12_BARRIER_SYNC_INDEX_INPUT, D3D12_BARRIER_ACCESS_INDEX_BUFFER);
+        add(ResourceStates::IndirectArgument, D3D12_BARRIER_SYNC_EXECUTE_INDIRECT, D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT);
+        add(ResourceStates::ShaderResource, D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+        add(ResourceStates::UnorderedAccess, D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_CLEAR_UNORDERED_ACCESS_VIEW, D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+        add(ResourceStates::RenderTarget, D3D12_BARRIER_SYNC_RENDER_TARGET, D3D12_BARRIER_ACCESS_RENDER_TARGET);
+        add(ResourceStates::DepthWrite, D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE);
+        add(ResourceStates::DepthRead, D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ);
+        add(ResourceStates::StreamOut, D3D12_BARRIER_SYNC_VERTEX_SHADING, D3D12_BARRIER_ACCESS_STREAM_OUTPUT);
+        add(ResourceStates::CopyDest, D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_DEST);
+        add(ResourceStates::CopySource, D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_SOURCE);
+        add(ResourceStates::ResolveDest, D3D12_BARRIER_SYNC_RESOLVE, D3D12_BARRIER_ACCESS_RESOLVE_DEST);
+        add(ResourceStates::ResolveSource, D3D12_BARRIER_SYNC_RESOLVE, D3D12_BARRIER_ACCESS_RESOLVE_SOURCE);
+        add(ResourceStates::AccelStructRead, D3D12_BARRIER_SYNC_RAYTRACING | D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+        add(ResourceStates::AccelStructWrite, D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE);
+        add(ResourceStates::AccelStructBuildInput, D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+        add(ResourceStates::AccelStructBuildBlas, D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+        add(ResourceStates::ShadingRateSurface, D3D12_BARRIER_SYNC_PIXEL_SHADING, D3D12_BARRIER_ACCESS_SHADING_RATE_SOURCE);
+        add(ResourceStates::OpacityMicromapWrite, D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE);
+        add(ResourceStates::OpacityMicromapBuildInput, D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+        add(ResourceStates::Predication, D3D12_BARRIER_SYNC_PREDICATION, D3D12_BARRIER_ACCESS_PREDICATION);
+
+        // Texture layouts. Copies can be done in the COMMON layout on every queue type, so textures that are only
+        // copied or handed over between queues in those states keep the COMMON layout and never need a layout change.
+        const ResourceStates commonCompatibleStates = ResourceStates::Common | ResourceStates::CopyDest | ResourceStates::CopySource | ResourceStates::Present;
+        const ResourceStates readOnlyStates = ResourceStates::ShaderResource | ResourceStates::CopySource | ResourceStates::ResolveSource
+            | ResourceStates::ShadingRateSurface | ResourceStates::DepthRead | ResourceStates::IndirectArgument | ResourceStates::Predication;
+
+        if ((stateBits & ~commonCompatibleStates) == 0)
+            result.layout = D3D12_BARRIER_LAYOUT_COMMON;
+        else if ((stateBits & ResourceStates::UnorderedAccess) != 0)
+            result.layout = D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS;
+        else if ((stateBits & ResourceStates::RenderTarget) != 0)
+            result.layout = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+        else if ((stateBits & ResourceStates::DepthWrite) != 0)
+            result.layout = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE;
+        else if ((stateBits & ResourceStates::DepthRead) != 0 && (stateBits & ~(ResourceStates::DepthRead | ResourceStates::ShaderResource)) == 0)
+            result.layout = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ;
+        else if (stateBits == ResourceStates::ShaderResource)
+            result.layout = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
+        else if (stateBits == ResourceStates::ResolveDest)
+            result.layout = D3D12_BARRIER_LAYOUT_RESOLVE_DEST;
+        else if (stateBits == ResourceStates::ResolveSource)
+            result.layout = D3D12_BARRIER_LAYOUT_RESOLVE_SOURCE;
+        else if (stateBits == ResourceStates::ShadingRateSurface)
+            result.layout = D3D12_BARRIER_LAYOUT_SHADING_RATE_SOURCE;
+        else if ((stateBits & ~readOnlyStates) == 0)
+            result.layout = D3D12_BARRIER_LAYOUT_GENERIC_READ;
+        else
+            result.layout = D3D12_BARRIER_LAYOUT_COMMON;
+
+        return result;
+    }
+#endif
+
     D3D12_SHADING_RATE convertPixelShadingRate(VariableShadingRate shadingRate)
     {
         switch (shadingRate)
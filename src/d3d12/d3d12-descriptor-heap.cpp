@@ -22,6 +22,9 @@
 
 #include "d3d12-backend.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace nvrhi::d3d12
 {
     
@@ -30,13 +33,36 @@ namespace nvrhi::d3d12
     {
     }
     
-    HRESULT StaticDescriptorHeap::allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, bool shaderVisible)
+    HRESULT StaticDescriptorHeap::allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, bool shaderVisible, bool enableThreadCaches)
+    {
+        // The heaps are only created by the first allocation, through Grow, so that devices
+        // which never use some of the heaps don't pay for them
+        m_Heap = nullptr;
+        m_ShaderVisibleHeap = nullptr;
+        m_HeapType = heapType;
+        m_InitialNumDescriptors = numDescriptors;
+        m_ShaderVisible = shaderVisible;
+        m_NumDescriptors = 0;
+        m_MemoryTracking = TrackedAllocation();
+
+        m_FreeRanges.reset(0);
+        m_NumAllocatedDescriptors = 0;
+
+        if (enableThreadCaches)
+            m_ThreadCaches = std::make_unique<ThreadCache[]>(c_NumThreadCaches);
+        else
+            m_ThreadCaches.reset();
+
+        return S_OK;
+    }
+
+    HRESULT StaticDescriptorHeap::createHeaps(uint32_t numDescriptors, bool shaderVisible)
     {
         m_Heap = nullptr;
         m_ShaderVisibleHeap = nullptr;
 
         D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-        heapDesc.Type = heapType;
+        heapDesc.Type = m_HeapType;
         heapDesc.NumDescriptors = numDescriptors;
         heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 
@@ -59,10 +85,11 @@ namespace nvrhi::d3d12
         }
 
         m_NumDescriptors = heapDesc.NumDescriptors;
-        m_HeapType = heapDesc.Type;
         m_StartCpuHandle = m_Heap->GetCPUDescriptorHandleForHeapStart();
         m_Stride = m_Context.device->GetDescriptorHandleIncrementSize(heapDesc.Type);
-        m_AllocatedDescriptors.resize(m_NumDescriptors);
+
+        const uint64_t heapBytes = uint64_t(m_NumDescriptors) * m_Stride * (shaderVisible ? 2 : 1);
+        m_MemoryTracking = TrackedAllocation(m_Context.memoryCounters, &InternalMemoryCounters::descriptorHeapBytes, heapBytes);
 
         return S_OK;
     }
@@ -87,103 +114,144 @@ namespace nvrhi::d3d12
         uint32_t oldSize = m_NumDescriptors;
         uint32_t newSize = nextPowerOf2(minRequiredSize);
 
+        // The first allocation creates the heaps with the size requested in allocateResources
+        if (!m_Heap)
+            newSize = std::max(newSize, m_InitialNumDescriptors);
+
         RefCountPtr<ID3D12DescriptorHeap> oldHeap = m_Heap; 
 
-        HRESULT hr = allocateResources(m_HeapType, newSize, m_ShaderVisibleHeap != nullptr);
+        HRESULT hr = createHeaps(newSize, m_ShaderVisible);
         
         if (FAILED(hr))
             return hr;
 
-        m_Context.device->CopyDescriptorsSimple(oldSize, m_StartCpuHandle, oldHeap->GetCPUDescriptorHandleForHeapStart(), m_HeapType);
-
-        if (m_ShaderVisibleHeap != nullptr)
+        if (oldHeap)
         {
-            m_Context.device->CopyDescriptorsSimple(oldSize, m_StartCpuHandleShaderVisible, oldHeap->GetCPUDescriptorHandleForHeapStart(), m_HeapType);
+            m_Context.device->CopyDescriptorsSimple(oldSize, m_StartCpuHandle, oldHeap->GetCPUDescriptorHandleForHeapStart(), m_HeapType);
+
+            if (m_ShaderVisibleHeap != nullptr)
+            {
+                m_Context.device->CopyDescriptorsSimple(oldSize, m_StartCpuHandleShaderVisible, oldHeap->GetCPUDescriptorHandleForHeapStart(), m_HeapType);
+            }
         }
 
+        // The new space is merged with a free range at the end of the old heap, if there is one
+        m_FreeRanges.grow(m_NumDescriptors);
+
         return S_OK;
     }
 
-    DescriptorIndex StaticDescriptorHeap::allocateDescriptors(uint32_t count)
+    DescriptorIndex StaticDescriptorHeap::allocateDescriptorsLocked(uint32_t count)
     {
-        std::lock_guard lockGuard(m_Mutex);
+        uint64_t foundIndex = 0;
 
-        DescriptorIndex foundIndex = 0;
-        uint32_t freeCount = 0;
-        bool found = false;
-
-        // Find a contiguous range of 'count' indices for which m_AllocatedDescriptors[index] is false
-
-        for (DescriptorIndex index = m_SearchStart; index < m_NumDescriptors; index++)
+        if (!m_FreeRanges.allocate(count, 1, foundIndex))
         {
-            if (m_AllocatedDescriptors[index])
-                freeCount = 0;
-            else
-                freeCount += 1;
-
-            if (freeCount >= count)
-            {
-                foundIndex = index - count + 1;
-                found = true;
-                break;
-            }
-        }
-
-        if (!found)
-        {
-            foundIndex = m_NumDescriptors;
-
             if (FAILED(Grow(m_NumDescriptors + count)))
             {
                 m_Context.error("Failed to grow a descriptor heap!");
                 return c_InvalidDescriptorIndex;
             }
-        }
 
-        for (DescriptorIndex index = foundIndex; index < foundIndex + count; index++)
-        {
-            m_AllocatedDescriptors[index] = true;
+            [[maybe_unused]] const bool allocated = m_FreeRanges.allocate(count, 1, foundIndex);
+            assert(allocated);
         }
 
         m_NumAllocatedDescriptors += count;
 
-        m_SearchStart = foundIndex + count;
-        return foundIndex;
+        return DescriptorIndex(foundIndex);
     }
 
-    DescriptorIndex StaticDescriptorHeap::allocateDescriptor()
+    void StaticDescriptorHeap::releaseDescriptorsLocked(DescriptorIndex baseIndex, uint32_t count)
     {
-        return allocateDescriptors(1);
+        if (count == 0)
+            return;
+
+#ifdef _DEBUG
+        if (baseIndex + count > m_NumDescriptors || count > m_NumAllocatedDescriptors)
+        {
+            m_Context.error("Attempted to release an un-allocated descriptor");
+            return;
+        }
+#endif
+
+        m_FreeRanges.release(baseIndex, count);
+        m_NumAllocatedDescriptors -= count;
     }
 
-    void StaticDescriptorHeap::releaseDescriptors(DescriptorIndex baseIndex, uint32_t count)
+    StaticDescriptorHeap::ThreadCache& StaticDescriptorHeap::getThreadCache() const
+    {
+        const size_t threadHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return m_ThreadCaches[threadHash % c_NumThreadCaches];
+    }
+
+    DescriptorIndex StaticDescriptorHeap::allocateDescriptors(uint32_t count)
     {
         std::lock_guard lockGuard(m_Mutex);
 
-        if (count == 0)
-            return;
+        return allocateDescriptorsLocked(count);
+    }
 
-        for (DescriptorIndex index = baseIndex; index < baseIndex + count; index++)
+    DescriptorIndex StaticDescriptorHeap::allocateDescriptor()
+    {
+        if (!m_ThreadCaches)
+            return allocateDescriptors(1);
+
+        ThreadCache& cache = getThreadCache();
+        std::lock_guard cacheLockGuard(cache.mutex);
+
+        if (cache.freeDescriptors.empty())
         {
-#ifdef _DEBUG
-            if (!m_AllocatedDescriptors[index])
+            // Refill the cache with a contiguous batch of descriptors from the shared heap
+            DescriptorIndex baseIndex;
             {
-                m_Context.error("Attempted to release an un-allocated descriptor");
+                std::lock_guard lockGuard(m_Mutex);
+                baseIndex = allocateDescriptorsLocked(c_ThreadCacheBatchSize);
             }
-#endif
 
-            m_AllocatedDescriptors[index] = false;
+            if (baseIndex == c_InvalidDescriptorIndex)
+                return c_InvalidDescriptorIndex;
+
+            // Push in reverse order so that the descriptors are handed out in ascending order
+            for (uint32_t i = c_ThreadCacheBatchSize; i > 0; i--)
+                cache.freeDescriptors.push_back(baseIndex + i - 1);
         }
 
-        m_NumAllocatedDescriptors -= count;
+        const DescriptorIndex index = cache.freeDescriptors.back();
+        cache.freeDescriptors.pop_back();
+        return index;
+    }
 
-        if (m_SearchStart > baseIndex)
-            m_SearchStart = baseIndex;
+    void StaticDescriptorHeap::releaseDescriptors(DescriptorIndex baseIndex, uint32_t count)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        releaseDescriptorsLocked(baseIndex, count);
     }
 
     void StaticDescriptorHeap::releaseDescriptor(DescriptorIndex index)
     {
-        releaseDescriptors(index, 1);
+        if (!m_ThreadCaches)
+        {
+            releaseDescriptors(index, 1);
+            return;
+        }
+
+        ThreadCache& cache = getThreadCache();
+        std::lock_guard cacheLockGuard(cache.mutex);
+
+        cache.freeDescriptors.push_back(index);
+
+        // Don't let one thread accumulate too many descriptors, return the older half to the shared heap
+        if (cache.freeDescriptors.size() >= 2 * c_ThreadCacheBatchSize)
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            for (uint32_t i = 0; i < c_ThreadCacheBatchSize; i++)
+                releaseDescriptorsLocked(cache.freeDescriptors[i], 1);
+
+            cache.freeDescriptors.erase(cache.freeDescriptors.begin(), cache.freeDescriptors.begin() + c_ThreadCacheBatchSize);
+        }
     }
 
     D3D12_CPU_DESCRIPTOR_HANDLE StaticDescriptorHeap::getCpuHandle(DescriptorIndex index)
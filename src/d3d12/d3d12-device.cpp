@@ -23,6 +23,7 @@
 #include "d3d12-backend.h"
 
 #include <nvrhi/common/misc.h>
+#include "../common/pipeline-cache.h"
 
 #if NVRHI_D3D12_WITH_NVAPI
 #include <nvShaderExtnEnums.h>
@@ -38,6 +39,66 @@ namespace nvrhi::d3d12
         messageCallback->message(MessageSeverity::Error, message.c_str());
     }
 
+    ID3D12CommandSignature* Context::getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE type) const
+    {
+        IndirectSignature* signature = nullptr;
+        UINT byteStride = 0;
+
+        switch (type)
+        {
+        case D3D12_INDIRECT_ARGUMENT_TYPE_DRAW:
+            signature = &drawIndirectSignature;
+            byteStride = sizeof(D3D12_DRAW_ARGUMENTS);
+            break;
+        case D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED:
+            signature = &drawIndexedIndirectSignature;
+            byteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+            break;
+        case D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH:
+            signature = &dispatchIndirectSignature;
+            byteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+            break;
+        case D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_MESH:
+            signature = &dispatchMeshIndirectSignature;
+            byteStride = sizeof(D3D12_DISPATCH_MESH_ARGUMENTS);
+            break;
+        default:
+            utils::InvalidEnum();
+            return nullptr;
+        }
+
+        // Every indirect draw and dispatch gets here, so don't take the lock once the signature exists
+        if (ID3D12CommandSignature* published = signature->published.load(std::memory_order_acquire))
+            return published;
+
+        std::lock_guard lockGuard(indirectSignatureMutex);
+
+        if (!signature->signature)
+        {
+            D3D12_INDIRECT_ARGUMENT_DESC argDesc = {};
+            argDesc.Type = type;
+
+            D3D12_COMMAND_SIGNATURE_DESC csDesc = {};
+            csDesc.ByteStride = byteStride;
+            csDesc.NumArgumentDescs = 1;
+            csDesc.pArgumentDescs = &argDesc;
+
+            const HRESULT hr = device->CreateCommandSignature(&csDesc, nullptr, IID_PPV_ARGS(&signature->signature));
+            if (FAILED(hr))
+            {
+                std::stringstream ss;
+                ss << "Failed to create an indirect command signature, HRESULT = 0x" << std::hex << std::setw(8) << hr;
+                error(ss.str());
+            }
+            else
+            {
+                signature->published.store(signature->signature, std::memory_order_release);
+            }
+        }
+
+        return signature->signature;
+    }
+
     void WaitForFence(ID3D12Fence* fence, uint64_t value, HANDLE event)
     {
         // Test if the fence has been reached
@@ -62,7 +123,11 @@ namespace nvrhi::d3d12
         , depthStencilViewHeap(context)
         , shaderResourceViewHeap(context)
         , samplerHeap(context)
+        , residencyManager(context)
+        , placedResourcePool(context, residencyManager)
         , timerQueries(desc.maxTimerQueries, true)
+        , occlusionQueries(desc.maxOcclusionQueries, true)
+        , pipelineStatisticsQueries(desc.maxPipelineStatisticsQueries, true)
         , m_Context(context)
     {
     }
@@ -84,11 +149,134 @@ namespace nvrhi::d3d12
         return lastCompletedInstance;
     }
 
+    void Queue::submit(ID3D12CommandList* const* commandLists, size_t numCommandLists, uint64_t instance)
+    {
+        std::lock_guard lockGuard(m_SubmitMutex);
+
+        // Don't extend a submission that signals application fences, the signals must not be delayed
+        PendingSubmission* submission = nullptr;
+        if (hasPendingSubmissions() && m_PendingWaits.empty() && m_PendingSubmissions[m_NumPendingSubmissions - 1].signals.empty())
+            submission = &m_PendingSubmissions[m_NumPendingSubmissions - 1];
+
+        if (!submission)
+        {
+            if (m_NumPendingSubmissions == m_PendingSubmissions.size())
+                m_PendingSubmissions.emplace_back();
+
+            submission = &m_PendingSubmissions[m_NumPendingSubmissions++];
+            submission->commandLists.clear();
+            submission->signals.clear();
+            submission->waits.swap(m_PendingWaits);
+            m_PendingWaits.clear();
+        }
+
+        submission->commandLists.insert(submission->commandLists.end(), commandLists, commandLists + numCommandLists);
+        submission->instance = instance;
+    }
+
+    void Queue::wait(ID3D12Fence* waitFence, uint64_t value)
+    {
+        std::lock_guard lockGuard(m_SubmitMutex);
+
+        if (!hasPendingSubmissions() && m_PendingWaits.empty())
+            queue->Wait(waitFence, value);
+        else
+            m_PendingWaits.push_back({ waitFence, value, nullptr });
+    }
+
+    void Queue::waitForQueue(Queue* executionQueue, uint64_t instance)
+    {
+        std::lock_guard lockGuard(m_SubmitMutex);
+
+        m_PendingWaits.push_back({ executionQueue->fence, instance, executionQueue });
+    }
+
+    void Queue::signal(ID3D12Fence* signalFence, uint64_t value)
+    {
+        std::unique_lock lock(m_SubmitMutex);
+
+        // The waits recorded before the signal must be executed before it
+        while (!hasPendingSubmissions() && flushWaitDependencies(m_PendingWaits, lock))
+            ;
+
+        if (hasPendingSubmissions())
+        {
+            m_PendingSubmissions[m_NumPendingSubmissions - 1].signals.emplace_back(signalFence, value);
+            return;
+        }
+
+        for (const PendingWait& wait : m_PendingWaits)
+            queue->Wait(wait.fence, wait.value);
+        m_PendingWaits.clear();
+
+        queue->Signal(signalFence, value);
+    }
+
+    bool Queue::flushWaitDependencies(const std::vector<PendingWait>& waits, std::unique_lock<std::mutex>& lock)
+    {
+        for (const PendingWait& wait : waits)
+        {
+            if (wait.executionQueue && wait.value > wait.executionQueue->getLastFlushedInstance())
+            {
+                Queue* executionQueue = wait.executionQueue;
+                const uint64_t instance = wait.value;
+
+                // The waited instance was submitted before the waiting one, so flushing it never comes back to this queue's
+                // submission, but the other queue's flush may wait for this queue's earlier instances, which takes the lock.
+                lock.unlock();
+                executionQueue->flush(instance);
+                lock.lock();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Queue::flush(uint64_t upToInstance)
+    {
+        std::unique_lock lock(m_SubmitMutex);
+
+        while (hasPendingSubmissions() && m_LastFlushedInstance < upToInstance)
+        {
+            // The vector may have changed while the lock was released, so look the submission up again after that
+            if (flushWaitDependencies(m_PendingSubmissions[m_FirstPendingSubmission].waits, lock))
+                continue;
+
+            const PendingSubmission& submission = m_PendingSubmissions[m_FirstPendingSubmission];
+
+            for (const PendingWait& wait : submission.waits)
+                queue->Wait(wait.fence, wait.value);
+
+            queue->ExecuteCommandLists(uint32_t(submission.commandLists.size()), submission.commandLists.data());
+
+            // Fence values are monotonic, so signaling the last instance of the merged submissions covers all of them
+            queue->Signal(fence, submission.instance);
+            m_LastFlushedInstance = submission.instance;
+
+            for (const auto& [signalFence, value] : submission.signals)
+                queue->Signal(signalFence, value);
+
+            ++m_FirstPendingSubmission;
+        }
+
+        if (!hasPendingSubmissions())
+        {
+            m_FirstPendingSubmission = 0;
+            m_NumPendingSubmissions = 0;
+        }
+
+        // Waits requested after the last queued submission stay recorded until the next submission
+    }
+
     Device::Device(const DeviceDesc& desc)
         : m_Resources(m_Context, desc)
     {
+        StartupTimer startupTimer(desc.reportStartupTimes);
+
         m_Context.device = desc.pDevice;
         m_Context.messageCallback = desc.errorCB;
+        m_AutomaticQueueSync = desc.enableAutomaticQueueSync;
 
         if (desc.pGraphicsCommandQueue)
             m_Queues[int(CommandQueue::Graphics)] = std::make_unique<Queue>(m_Context, desc.pGraphicsCommandQueue);
@@ -97,10 +285,51 @@ namespace nvrhi::d3d12
         if (desc.pCopyCommandQueue)
             m_Queues[int(CommandQueue::Copy)] = std::make_unique<Queue>(m_Context, desc.pCopyCommandQueue);
 
-        m_Resources.depthStencilViewHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, desc.depthStencilViewHeapSize, false);
-        m_Resources.renderTargetViewHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, desc.renderTargetViewHeapSize, false);
-        m_Resources.shaderResourceViewHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, desc.shaderResourceViewHeapSize, true);
-        m_Resources.samplerHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, desc.samplerHeapSize, true);
+        for (uint32_t nodeIndex = 0; nodeIndex < desc.numNodeCopyCommandQueues; nodeIndex++)
+        {
+            ID3D12CommandQueue* pQueue = desc.ppNodeCopyCommandQueues[nodeIndex];
+            m_NodeCopyQueues.push_back(pQueue ? std::make_unique<Queue>(m_Context, pQueue) : nullptr);
+        }
+
+        for (const auto& pQueue : m_Queues)
+        {
+            if (pQueue)
+                m_AllQueues.push_back(pQueue.get());
+        }
+
+        for (const auto& pQueue : m_NodeCopyQueues)
+        {
+            if (pQueue)
+                m_AllQueues.push_back(pQueue.get());
+        }
+
+        startupTimer.mark("Queues");
+
+        m_Resources.depthStencilViewHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, desc.depthStencilViewHeapSize, false, desc.enableDescriptorHeapThreadCaches);
+        m_Resources.renderTargetViewHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, desc.renderTargetViewHeapSize, false, desc.enableDescriptorHeapThreadCaches);
+        m_Resources.shaderResourceViewHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, desc.shaderResourceViewHeapSize, true, desc.enableDescriptorHeapThreadCaches);
+        m_Resources.samplerHeap.allocateResources(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, desc.samplerHeapSize, true, desc.enableDescriptorHeapThreadCaches);
+
+        if (desc.enablePlacedResourcePools)
+            m_Resources.placedResourcePool.initialize(desc.placedResourcePoolHeapSize);
+
+        startupTimer.mark("Descriptor heaps and resource pools");
+
+        {
+            // Find the DXGI adapter of the device to query the memory budget
+            RefCountPtr<IDXGIFactory4> factory;
+            RefCountPtr<IDXGIAdapter> adapter;
+            if (SUCCEEDED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))) &&
+                SUCCEEDED(factory->EnumAdapterByLuid(m_Context.device->GetAdapterLuid(), IID_PPV_ARGS(&adapter))))
+            {
+                m_MemoryBudget.initialize(adapter);
+            }
+        }
+
+        if (desc.enableResidencyManagement)
+            m_Resources.residencyManager.initialize(&m_MemoryBudget);
+
+        startupTimer.mark("Memory budget");
 
         m_Context.device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &m_Options, sizeof(m_Options));
         bool hasOptions5 = SUCCEEDED(m_Context.device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS5, &m_Options5, sizeof(m_Options5)));
@@ -123,39 +352,49 @@ namespace nvrhi::d3d12
 #endif
         }
 
+        // Acceleration structures built on the compute queue are consumed on the graphics queue,
+        // so their storage buffers are synchronized between the queues automatically
+        m_AccelStructQueueSync = m_RayTracingSupported && desc.pGraphicsCommandQueue && desc.pComputeCommandQueue;
+
         if (SUCCEEDED(m_Context.device->QueryInterface(&m_Context.device2)) && hasOptions7)
         {
             m_MeshletsSupported = m_Options7.MeshShaderTier >= D3D12_MESH_SHADER_TIER_1;
         }
 
-        if (hasOptions6)
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        if (desc.enableEnhancedBarriers)
         {
-            m_VariableRateShadingSupported = m_Options6.VariableShadingRateTier >= D3D12_VARIABLE_SHADING_RATE_TIER_2;
+            D3D12_FEATURE_DATA_D3D12_OPTIONS12 options12 = {};
+            if (SUCCEEDED(m_Context.device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS12, &options12, sizeof(options12))))
+                m_Context.enhancedBarriers = options12.EnhancedBarriersSupported;
         }
-        
+#endif
+
+#if NVRHI_D3D12_WITH_GPU_UPLOAD_HEAPS
         {
-            D3D12_INDIRECT_ARGUMENT_DESC argDesc = {};
-            D3D12_COMMAND_SIGNATURE_DESC csDesc = {};
-            csDesc.NumArgumentDescs = 1;
-            csDesc.pArgumentDescs = &argDesc;
+            D3D12_FEATURE_DATA_D3D12_OPTIONS16 options16 = {};
+            if (SUCCEEDED(m_Context.device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS16, &options16, sizeof(options16))))
+                m_GpuUploadHeapsSupported = options16.GPUUploadHeapSupported;
+        }
+#endif
 
-            csDesc.ByteStride = 16;
-            argDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
-            m_Context.device->CreateCommandSignature(&csDesc, nullptr, IID_PPV_ARGS(&m_Context.drawIndirectSignature));
+        if (hasOptions6)
+        {
+            m_VariableRateShadingSupported = m_Options6.VariableShadingRateTier >= D3D12_VARIABLE_SHADING_RATE_TIER_2;
+        }
 
-            csDesc.ByteStride = 20;
-            argDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
-            m_Context.device->CreateCommandSignature(&csDesc, nullptr, IID_PPV_ARGS(&m_Context.drawIndexedIndirectSignature));
+        // The indirect command signatures and the query heaps are created on first use
 
-            csDesc.ByteStride = 12;
-            argDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
-            m_Context.device->CreateCommandSignature(&csDesc, nullptr, IID_PPV_ARGS(&m_Context.dispatchIndirectSignature));
-        }
+        startupTimer.mark("Feature queries");
         
         m_FenceEvent = CreateEvent(nullptr, false, false, nullptr);
 
         m_CommandListsToExecute.reserve(64);
 
+        createPipelineLibrary();
+
+        startupTimer.mark("Pipeline library");
+
 #if NVRHI_D3D12_WITH_NVAPI
         //We need to use NVAPI to set resource hints for SLI
         m_NvapiIsInitialized = NvAPI_Initialize() == NVAPI_OK;
@@ -208,12 +447,29 @@ namespace nvrhi::d3d12
 #endif // #if NVRHI_WITH_NVAPI_OPACITY_MICROMAPS
 
 #endif // #if NVRHI_D3D12_WITH_NVAPI
+
+        startupTimer.mark("NVAPI");
+
+        if (desc.enableBackgroundGarbageCollection)
+        {
+            m_GarbageCollectionThread = std::make_unique<GarbageCollectionThread>(
+                [this] { retireCommandLists(std::chrono::steady_clock::time_point::max()); },
+                std::chrono::microseconds(desc.backgroundGarbageCollectionInterval));
+        }
+
+        startupTimer.mark("Garbage collection thread");
+        startupTimer.report(m_Context.messageCallback, "D3D12");
     }
 
     Device::~Device()
     {
+        m_GarbageCollectionThread.reset();
+
         waitForIdle();
 
+        m_ObjectCache.clear();
+        m_Resources.rootsigCache.clear();
+
         if (m_FenceEvent)
         {
             CloseHandle(m_FenceEvent);
@@ -223,12 +479,11 @@ namespace nvrhi::d3d12
 
     void Device::waitForIdle()
     {
+        flushSubmissions();
+
         // Wait for every queue to reach its last submitted instance
-        for (const auto& pQueue : m_Queues)
+        for (Queue* pQueue : m_AllQueues)
         {
-            if (!pQueue)
-                continue;
-
             if (pQueue->updateLastCompletedInstance() < pQueue->lastSubmittedInstance)
             {
                 WaitForFence(pQueue->fence, pQueue->lastSubmittedInstance, m_FenceEvent);
@@ -289,7 +544,12 @@ namespace nvrhi::d3d12
         m_Context.device->CreateSampler(&m_d3d12desc, { descriptor });
     }
     
-    SamplerHandle Device::createSampler(const SamplerDesc& d)
+    SamplerHandle Device::createSampler(const SamplerDesc& desc)
+    {
+        return m_ObjectCache.getSampler(desc, [this, &desc] { return createSamplerInternal(desc); });
+    }
+
+    SamplerHandle Device::createSamplerInternal(const SamplerDesc& d)
     {
         Sampler* sampler = new Sampler(m_Context, d);
         return SamplerHandle::Create(sampler);
@@ -316,30 +576,123 @@ namespace nvrhi::d3d12
 
     nvrhi::CommandListHandle Device::createCommandList(const CommandListParameters& params)
     {
-        if (!getQueue(params.queueType))
+        if (params.nodeMask > 1)
+        {
+            // Other nodes don't have access to the descriptor heaps, so they can only record copies
+            if ((params.nodeMask & (params.nodeMask - 1)) != 0 || params.queueType != CommandQueue::Copy || params.isBundle)
+            {
+                m_Context.error("Command lists for nodes other than node 0 must select a single node and use the copy queue");
+                return nullptr;
+            }
+        }
+
+        if (!getNodeQueue(params.queueType, params.nodeMask))
             return nullptr;
 
         return CommandListHandle::Create(new CommandList(this, m_Context, m_Resources, params));
     }
+
+    Queue* Device::getNodeQueue(CommandQueue type, uint32_t nodeMask)
+    {
+        if (nodeMask <= 1)
+            return getQueue(type);
+
+        if (type != CommandQueue::Copy)
+            return nullptr;
+
+        uint32_t nodeIndex = 0;
+        while ((nodeMask >> nodeIndex) != 1)
+            ++nodeIndex;
+
+        if (nodeIndex > m_NodeCopyQueues.size())
+            return nullptr;
+
+        return m_NodeCopyQueues[nodeIndex - 1].get();
+    }
     
     uint64_t Device::executeCommandLists(nvrhi::ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue)
     {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "executeCommandLists", "Submission");
+        traceScope.setArg("commandLists", numCommandLists);
+
         m_CommandListsToExecute.resize(numCommandLists);
         for (size_t i = 0; i < numCommandLists; i++)
         {
             m_CommandListsToExecute[i] = checked_cast<CommandList*>(pCommandLists[i])->getD3D12CommandList();
         }
 
-        Queue* pQueue = getQueue(executionQueue);
+        // All command lists in one call execute on the same node, which is checked by the validation layer
+        const uint32_t nodeMask = numCommandLists > 0 ? checked_cast<CommandList*>(pCommandLists[0])->getDesc().nodeMask : 0;
+        Queue* pQueue = getNodeQueue(executionQueue, nodeMask);
+
+        // Resources created for other nodes are not tracked by the residency manager, see createBuffer
+        if (m_Resources.residencyManager.isEnabled() && nodeMask <= 1)
+        {
+            m_Resources.residencyManager.prepareSubmission(pCommandLists, numCommandLists, executionQueue,
+                pQueue->lastSubmittedInstance + 1, m_Queues);
+        }
+
+        // The per-resource queue usage is read and updated under the lock, so that concurrent submissions see each other
+        std::unique_lock queueSyncLock(m_QueueSyncMutex, std::defer_lock);
+        const bool queueSync = (m_AutomaticQueueSync || m_AccelStructQueueSync) && nodeMask <= 1;
+        const bool accelStructsOnly = !m_AutomaticQueueSync;
+        if (queueSync)
+        {
+            queueSyncLock.lock();
+
+            uint64_t waitInstances[uint32_t(CommandQueue::Count)] = {};
+            for (size_t i = 0; i < numCommandLists; i++)
+            {
+                checked_cast<CommandList*>(pCommandLists[i])->getStateTracker().collectQueueDependencies(executionQueue, waitInstances, accelStructsOnly);
+            }
+
+            m_QueueSynchronizer.filterWaits(executionQueue, waitInstances);
+
+            for (uint32_t queueIndex = 0; queueIndex < uint32_t(CommandQueue::Count); queueIndex++)
+            {
+                if (waitInstances[queueIndex] != 0)
+                    pQueue->waitForQueue(m_Queues[queueIndex].get(), waitInstances[queueIndex]);
+            }
+        }
 
-        pQueue->queue->ExecuteCommandLists(uint32_t(m_CommandListsToExecute.size()), m_CommandListsToExecute.data());
         pQueue->lastSubmittedInstance++;
-        pQueue->queue->Signal(pQueue->fence, pQueue->lastSubmittedInstance);
+        pQueue->submit(m_CommandListsToExecute.data(), m_CommandListsToExecute.size(), pQueue->lastSubmittedInstance);
+
+        if (queueSync)
+        {
+            for (size_t i = 0; i < numCommandLists; i++)
+            {
+                checked_cast<CommandList*>(pCommandLists[i])->getStateTracker().recordQueueUsage(executionQueue, pQueue->lastSubmittedInstance, accelStructsOnly);
+            }
+
+            queueSyncLock.unlock();
+        }
+
+        if (!m_DeferredSubmission)
+            pQueue->flush();
+
+        CommandListStatistics executedStatistics;
+        bool anyStatistics = false;
 
         for (size_t i = 0; i < numCommandLists; i++)
         {
-            auto instance = checked_cast<CommandList*>(pCommandLists[i])->executed(pQueue);
-            pQueue->commandListsInFlight.push_front(instance);
+            CommandList* commandList = checked_cast<CommandList*>(pCommandLists[i]);
+            if (commandList->getDesc().enableStatistics)
+            {
+                executedStatistics += commandList->getStatistics();
+                anyStatistics = true;
+            }
+
+            auto instance = commandList->executed(pQueue);
+
+            std::lock_guard lockGuard(pQueue->commandListsInFlightMutex);
+            pQueue->commandListsInFlight.push_back(std::move(instance));
+        }
+
+        if (anyStatistics)
+        {
+            std::lock_guard lockGuard(m_CommandListStatisticsMutex);
+            m_CommandListStatistics += executedStatistics;
         }
 
         HRESULT hr = m_Context.device->GetDeviceRemovedReason();
@@ -357,50 +710,305 @@ namespace nvrhi::d3d12
         Queue* pExecutionQueue = getQueue(executionQueue);
         assert(instanceID <= pExecutionQueue->lastSubmittedInstance);
 
-        pWaitQueue->queue->Wait(pExecutionQueue->fence, instanceID);
+        if (m_AutomaticQueueSync || m_AccelStructQueueSync)
+        {
+            std::lock_guard lockGuard(m_QueueSyncMutex);
+            m_QueueSynchronizer.waitAdded(waitQueue, executionQueue, instanceID);
+        }
+
+        // Recorded without flushing the execution queue, see Queue::waitForQueue
+        pWaitQueue->waitForQueue(pExecutionQueue, instanceID);
     }
 
-    void Device::runGarbageCollection()
+    void Device::waitForQueueFence(ID3D12Fence* fence, uint64_t value)
     {
-        for (const auto& pQueue : m_Queues)
+        for (Queue* pQueue : m_AllQueues)
+        {
+            if (pQueue->fence == fence && value > pQueue->getLastFlushedInstance())
+                pQueue->flush();
+        }
+
+        WaitForFence(fence, value, m_FenceEvent);
+    }
+
+    bool Device::waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds)
+    {
+        std::vector<ID3D12Fence*> fences;
+        std::vector<uint64_t> values;
+
+        for (size_t i = 0; i < numSubmissions; i++)
         {
-            if (!pQueue)
+            Queue* pQueue = getQueue(queues[i]);
+            if (!pQueue || instances[i] > pQueue->lastSubmittedInstance)
+            {
+                m_Context.error("waitForSubmissions: the instance has not been submitted to the queue");
+                return false;
+            }
+
+            // Skip the finished instances, which also decides wait-any without the event
+            if (instances[i] == 0 || pQueue->fence->GetCompletedValue() >= instances[i])
+            {
+                if (!waitAll)
+                    return true;
+
                 continue;
+            }
 
-            pQueue->updateLastCompletedInstance();
+            if (instances[i] > pQueue->getLastFlushedInstance())
+                pQueue->flush();
+
+            fences.push_back(pQueue->fence);
+            values.push_back(instances[i]);
+        }
+
+        if (fences.empty())
+            return true;
+
+        if (timeoutNanoseconds == 0)
+            return false;
+
+        // Round the timeout up to whole milliseconds, values that don't fit into a DWORD wait forever
+        const uint64_t timeoutMilliseconds = (timeoutNanoseconds / 1000000) + ((timeoutNanoseconds % 1000000) != 0 ? 1 : 0);
+        const DWORD timeout = (timeoutMilliseconds >= INFINITE) ? INFINITE : DWORD(timeoutMilliseconds);
+
+        // Separate events for every call, so that multiple threads can wait at the same time
+        RefCountPtr<ID3D12Device1> device1;
+        if (SUCCEEDED(m_Context.device->QueryInterface(IID_PPV_ARGS(&device1))))
+        {
+            HANDLE event = CreateEvent(nullptr, false, false, nullptr);
+            if (!event)
+                return false;
+
+            const HRESULT hr = device1->SetEventOnMultipleFenceCompletion(fences.data(), values.data(), UINT(fences.size()),
+                waitAll ? D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL : D3D12_MULTIPLE_FENCE_WAIT_FLAG_ANY, event);
+
+            if (SUCCEEDED(hr))
+            {
+                const DWORD result = WaitForSingleObject(event, timeout);
+                CloseHandle(event);
+
+                return result == WAIT_OBJECT_0;
+            }
+
+            CloseHandle(event);
+        }
+
+        // Fall back to an event per fence, WaitForMultipleObjects implements the wait-all and wait-any modes.
+        // Only the last (wait-all) or first (wait-any) instance of each queue matters, which keeps the number
+        // of events below MAXIMUM_WAIT_OBJECTS.
+        for (size_t i = 0; i < fences.size(); i++)
+        {
+            for (size_t j = i + 1; j < fences.size(); )
+            {
+                if (fences[j] == fences[i])
+                {
+                    values[i] = waitAll ? std::max(values[i], values[j]) : std::min(values[i], values[j]);
+                    fences.erase(fences.begin() + ptrdiff_t(j));
+                    values.erase(values.begin() + ptrdiff_t(j));
+                }
+                else
+                    ++j;
+            }
+        }
+
+        std::vector<HANDLE> events;
+        bool eventsSet = true;
+        for (size_t i = 0; i < fences.size(); i++)
+        {
+            HANDLE event = CreateEvent(nullptr, false, false, nullptr);
+            if (!event)
+            {
+                eventsSet = false;
+                break;
+            }
+
+            events.push_back(event);
+
+            if (FAILED(fences[i]->SetEventOnCompletion(values[i], event)))
+            {
+                eventsSet = false;
+                break;
+            }
+        }
 
-            // Starting from the back of the queue, i.e. oldest submitted command lists,
+        const DWORD result = eventsSet
+            ? WaitForMultipleObjects(DWORD(events.size()), events.data(), waitAll, timeout)
+            : WAIT_FAILED;
+
+        for (HANDLE event : events)
+            CloseHandle(event);
+
+        return result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + DWORD(events.size());
+    }
+
+    ID3D12Fence* Device::getQueueFence(CommandQueue queue)
+    {
+        Queue* pQueue = getQueue(queue);
+        return pQueue ? pQueue->fence.Get() : nullptr;
+    }
+
+    void Device::queueWaitForFence(CommandQueue waitQueue, ID3D12Fence* fence, uint64_t value)
+    {
+        Queue* pQueue = getQueue(waitQueue);
+        if (pQueue && fence)
+            pQueue->wait(fence, value);
+    }
+
+    void Device::queueSignalFence(CommandQueue executionQueue, ID3D12Fence* fence, uint64_t value)
+    {
+        Queue* pQueue = getQueue(executionQueue);
+        if (pQueue && fence)
+            pQueue->signal(fence, value);
+    }
+
+    uint64_t Device::queueGetCompletedInstance(CommandQueue queue)
+    {
+        Queue* pQueue = getQueue(queue);
+        return pQueue ? pQueue->fence->GetCompletedValue() : 0;
+    }
+
+    void Device::setDeferredSubmission(bool enable)
+    {
+        m_DeferredSubmission = enable;
+
+        if (!enable)
+            flushSubmissions();
+    }
+
+    void Device::flushSubmissions()
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "flushSubmissions", "Submission");
+
+        for (Queue* pQueue : m_AllQueues)
+            pQueue->flush();
+    }
+
+    bool Device::retireCommandLists(std::chrono::steady_clock::time_point deadline)
+    {
+        // Every queue retires at least one instance per call, so that one busy queue can't starve the others
+        bool finished = true;
+
+        for (Queue* pQueue : m_AllQueues)
+        {
+            // Read the fence directly instead of updating lastCompletedInstance, which belongs to the app thread
+            const uint64_t completedInstance = pQueue->fence->GetCompletedValue();
+
+            // Starting from the front of the queue, i.e. oldest submitted command lists,
             // see if those command lists have finished executing.
-            while (!pQueue->commandListsInFlight.empty())
+            // Only the queue operations are done under the lock, the references are released without it.
+            while (true)
             {
-                std::shared_ptr<CommandListInstance> instance = pQueue->commandListsInFlight.back();
-                
-                if (pQueue->lastCompletedInstance >= instance->submittedInstance)
+                std::shared_ptr<CommandListInstance> instance;
                 {
+                    std::lock_guard lockGuard(pQueue->commandListsInFlightMutex);
+
+                    if (pQueue->commandListsInFlight.empty() || pQueue->commandListsInFlight.front()->submittedInstance > completedInstance)
+                        break;
+
+                    instance = pQueue->commandListsInFlight.pop_front();
+                }
+
 #ifdef NVRHI_WITH_RTXMU
-                    if (!instance->rtxmuBuildIds.empty())
-                    {
-                        std::lock_guard lockGuard(m_Resources.asListMutex);
-
-                        m_Resources.asBuildsCompleted.insert(m_Resources.asBuildsCompleted.end(),
-                            instance->rtxmuBuildIds.begin(), instance->rtxmuBuildIds.end());
-
-                        instance->rtxmuBuildIds.clear();
-                    }
-                    if (!instance->rtxmuCompactionIds.empty())
-                    {
-                        m_Context.rtxMemUtil->GarbageCollection(instance->rtxmuCompactionIds);
-                        instance->rtxmuCompactionIds.clear();
-                    }
-#endif
-                    pQueue->commandListsInFlight.pop_back();
+                if (!instance->rtxmuBuildIds.empty())
+                {
+                    std::lock_guard lockGuard(m_Resources.asListMutex);
+
+                    m_Resources.asBuildsCompleted.insert(m_Resources.asBuildsCompleted.end(),
+                        instance->rtxmuBuildIds.begin(), instance->rtxmuBuildIds.end());
+
+                    instance->rtxmuBuildIds.clear();
                 }
-                else
+                if (!instance->rtxmuCompactionIds.empty())
+                {
+                    m_Context.rtxMemUtil->GarbageCollection(instance->rtxmuCompactionIds);
+                    instance->rtxmuCompactionIds.clear();
+                }
+#else
+                if (!instance->compactableBuilds.empty())
+                {
+                    std::lock_guard lockGuard(m_Resources.asListMutex);
+
+                    m_Resources.asBuildsCompleted.insert(m_Resources.asBuildsCompleted.end(),
+                        instance->compactableBuilds.begin(), instance->compactableBuilds.end());
+
+                    instance->compactableBuilds.clear();
+                }
+#endif
+                // Release the references now, the command list reuses the instance and its storage later
+                instance->reset();
+                instance->retired.store(true, std::memory_order_release);
+                instance.reset();
+
+                if (std::chrono::steady_clock::now() >= deadline)
                 {
+                    finished = false;
                     break;
                 }
             }
         }
+
+        return finished;
+    }
+
+    void Device::runGarbageCollection()
+    {
+        runGarbageCollection(std::chrono::steady_clock::time_point::max());
+    }
+
+    bool Device::runGarbageCollection(uint32_t maxMicroseconds)
+    {
+        return runGarbageCollection(std::chrono::steady_clock::now() + std::chrono::microseconds(maxMicroseconds));
+    }
+
+    bool Device::runGarbageCollection(std::chrono::steady_clock::time_point deadline)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "runGarbageCollection", "GarbageCollection");
+
+        for (Queue* pQueue : m_AllQueues)
+            pQueue->updateLastCompletedInstance();
+
+        const bool finished = retireCommandLists(deadline);
+
+        // Pipelines and binding sets are only released from the cache once no command list in flight references them
+        if (finished)
+        {
+            m_ObjectCache.collectGarbage();
+            collectRootSignatureGarbage();
+        }
+
+        if (m_MemoryBudget.pollBudgetChange() && m_MemoryBudgetCallback)
+            m_MemoryBudgetCallback->memoryBudgetChanged(getMemoryStatistics());
+
+        return finished;
+    }
+
+    CommandListStatistics Device::getCommandListStatistics(bool reset)
+    {
+        std::lock_guard lockGuard(m_CommandListStatisticsMutex);
+
+        CommandListStatistics statistics = m_CommandListStatistics;
+        if (reset)
+            m_CommandListStatistics = CommandListStatistics();
+
+        return statistics;
+    }
+
+    MemoryStatistics Device::getMemoryStatistics()
+    {
+        MemoryStatistics statistics;
+        m_MemoryBudget.queryHeaps(statistics);
+
+        statistics.uploadBufferBytes = m_Context.memoryCounters->uploadBufferBytes;
+        statistics.scratchBufferBytes = m_Context.memoryCounters->scratchBufferBytes;
+        statistics.descriptorHeapBytes = m_Context.memoryCounters->descriptorHeapBytes;
+        statistics.compactionSavedBytes = m_Context.memoryCounters->compactionSavedBytes;
+
+        return statistics;
+    }
+
+    void Device::setMemoryBudgetCallback(IMemoryBudgetCallback* callback)
+    {
+        m_MemoryBudgetCallback = callback;
     }
 
     bool Device::queryFeatureSupport(Feature feature, void* pInfo, size_t infoSize)
@@ -439,6 +1047,8 @@ namespace nvrhi::d3d12
             return m_VariableRateShadingSupported;
         case Feature::VirtualResources:
             return true;
+        case Feature::TiledResources:
+            return m_Options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_1;
         case Feature::ComputeQueue:
             return (getQueue(CommandQueue::Compute) != nullptr);
         case Feature::CopyQueue:
@@ -447,6 +1057,34 @@ namespace nvrhi::d3d12
             return true;
         case Feature::ConstantBufferRanges:
             return true;
+        case Feature::CommandListBundles:
+            return true;
+        case Feature::SplitBarriers:
+            return true;
+        case Feature::DrawIndirectCount:
+            return true;
+        case Feature::CommandSignatures:
+            return true;
+        case Feature::PipelineStatisticsQueries:
+            return true;
+        case Feature::Predication:
+            return true;
+        case Feature::RayTracingPipelineLibraries:
+            return m_RayTracingSupported;
+        case Feature::DeviceLocalCpuWrite:
+            return m_GpuUploadHeapsSupported;
+        case Feature::MultiGPU:
+            if (pInfo)
+            {
+                if (infoSize == sizeof(MultiGPUFeatureInfo))
+                {
+                    auto* pMultiGPUInfo = reinterpret_cast<MultiGPUFeatureInfo*>(pInfo);
+                    pMultiGPUInfo->numNodes = m_Context.device->GetNodeCount();
+                }
+                else
+                    utils::NotSupported();
+            }
+            return m_Context.device->GetNodeCount() > 1;
         default:
             return false;
         }
@@ -533,6 +1171,92 @@ namespace nvrhi::d3d12
         return nullptr;
     }
 
+    void Device::createPipelineLibrary()
+    {
+        // Pipeline libraries require ID3D12Device1
+        RefCountPtr<ID3D12Device1> device1;
+        if (FAILED(m_Context.device->QueryInterface(IID_PPV_ARGS(&device1))))
+            return;
+
+        RefCountPtr<ID3D12PipelineLibrary> library;
+        if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library))))
+            return;
+
+        m_PipelineLibrary = library;
+        m_PipelineLibrary->QueryInterface(IID_PPV_ARGS(&m_PipelineLibrary1));
+    }
+
+    std::wstring Device::getPipelineLibraryKey(uint64_t hash)
+    {
+        wchar_t key[32];
+        swprintf(key, std::size(key), L"nvrhi_%016llx", static_cast<unsigned long long>(hash));
+        return key;
+    }
+
+    void Device::storePipelineInLibrary(const std::wstring& key, ID3D12PipelineState* pipelineState) const
+    {
+        std::lock_guard lockGuard(m_PipelineLibraryMutex);
+
+        // StorePipeline fails with E_INVALIDARG if another thread has stored the same PSO already, which is fine
+        if (m_PipelineLibrary)
+            m_PipelineLibrary->StorePipeline(key.c_str(), pipelineState);
+    }
+
+    bool Device::exportPipelineCache(std::vector<uint8_t>& outData)
+    {
+        std::lock_guard lockGuard(m_PipelineLibraryMutex);
+
+        if (!m_PipelineLibrary)
+            return false;
+
+        std::vector<uint8_t> libraryData(m_PipelineLibrary->GetSerializedSize());
+        const HRESULT hr = m_PipelineLibrary->Serialize(libraryData.data(), libraryData.size());
+
+        if (FAILED(hr))
+        {
+            std::stringstream ss;
+            ss << "Failed to serialize the pipeline library, HRESULT = 0x" << std::hex << std::setw(8) << hr;
+            m_Context.error(ss.str());
+            return false;
+        }
+
+        // The library data contains its own adapter and driver version checks, so no device UUID is needed here
+        writePipelineCacheBlob(GraphicsAPI::D3D12, nullptr, libraryData.data(), libraryData.size(), outData);
+
+        return true;
+    }
+
+    bool Device::importPipelineCache(const void* data, size_t dataSize)
+    {
+        const void* libraryData = nullptr;
+        size_t libraryDataSize = 0;
+        if (!readPipelineCacheBlob(GraphicsAPI::D3D12, nullptr, data, dataSize, &libraryData, &libraryDataSize))
+            return false;
+
+        RefCountPtr<ID3D12Device1> device1;
+        if (FAILED(m_Context.device->QueryInterface(IID_PPV_ARGS(&device1))))
+            return false;
+
+        // The library keeps referencing the data it was created from, so make a persistent copy
+        std::vector<uint8_t> ownedData(static_cast<const uint8_t*>(libraryData), static_cast<const uint8_t*>(libraryData) + libraryDataSize);
+
+        RefCountPtr<ID3D12PipelineLibrary> library;
+        const HRESULT hr = device1->CreatePipelineLibrary(ownedData.data(), ownedData.size(), IID_PPV_ARGS(&library));
+
+        // D3D12_ERROR_ADAPTER_NOT_FOUND and D3D12_ERROR_DRIVER_VERSION_MISMATCH mean the data is stale - not an error
+        if (FAILED(hr))
+            return false;
+
+        std::lock_guard lockGuard(m_PipelineLibraryMutex);
+
+        m_PipelineLibrary = library;
+        m_PipelineLibrary1 = nullptr;
+        m_PipelineLibrary->QueryInterface(IID_PPV_ARGS(&m_PipelineLibrary1));
+        m_PipelineLibraryData = std::move(ownedData);
+
+        return true;
+    }
+
     HeapHandle Device::createHeap(const HeapDesc& d)
     {
         D3D12_HEAP_DESC heapDesc;
@@ -586,6 +1310,10 @@ namespace nvrhi::d3d12
         Heap* heap = new Heap();
         heap->heap = d3dHeap;
         heap->desc = d;
+
+        if (d.type == HeapType::DeviceLocal)
+            m_Resources.residencyManager.track(heap->residency, d3dHeap, d.capacity, d.residencyPriority);
+
         return HeapHandle::Create(heap);
     }
 
@@ -0,0 +1,312 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "d3d12-backend.h"
+
+#include <nvrhi/common/misc.h>
+
+#ifndef NVRHI_D3D12_WITH_DIRECTSTORAGE
+#define NVRHI_D3D12_WITH_DIRECTSTORAGE 0
+#endif
+
+#if NVRHI_D3D12_WITH_DIRECTSTORAGE
+#include <dstorage.h>
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <iomanip>
+#endif
+
+namespace nvrhi::d3d12
+{
+#if NVRHI_D3D12_WITH_DIRECTSTORAGE
+
+    class DirectStorageQueue : public RefCounter<IDirectStorageQueue>
+    {
+    public:
+        RefCountPtr<::IDStorageQueue> queue;
+        RefCountPtr<ID3D12Fence> fence;
+        DirectStorageSourceType sourceType = DirectStorageSourceType::File;
+
+        DirectStorageQueue(const Context& context, Device* device)
+            : m_Context(context)
+            , m_Device(device)
+        { }
+
+        ~DirectStorageQueue() override;
+
+        bool enqueueRequest(const DirectStorageRequest& request) override;
+        void enqueueSignal(IEventQuery* query) override;
+        void submit() override;
+        void queueWaitForSignals(CommandQueue waitQueue) override;
+        IDStorageQueue* getNativeQueue() const override { return queue; }
+
+    private:
+        struct SignaledResources
+        {
+            uint64_t fenceValue = 0;
+            std::vector<RefCountPtr<IResource>> resources;
+        };
+
+        const Context& m_Context;
+        RefCountPtr<Device> m_Device;
+        std::mutex m_Mutex;
+
+        uint64_t m_LastSignaledValue = 0;
+
+        // Destination resources of the requests enqueued after the last signal
+        std::vector<RefCountPtr<IResource>> m_PendingResources;
+        // Destination resources waiting for their signal to complete
+        std::deque<SignaledResources> m_SignaledResources;
+
+        void releaseCompletedResources();
+    };
+
+    DirectStorageQueue::~DirectStorageQueue()
+    {
+        if (!queue || !fence)
+            return;
+
+        // The enqueued requests may still be writing to their destination resources, so wait for all of them
+        // before releasing the resources. Requests enqueued after the last signal get a signal of their own.
+        if (!m_PendingResources.empty())
+        {
+            ++m_LastSignaledValue;
+            queue->EnqueueSignal(fence, m_LastSignaledValue);
+        }
+
+        if (fence->GetCompletedValue() < m_LastSignaledValue)
+        {
+            // The signal may not have been submitted yet
+            queue->Submit();
+
+            HANDLE fenceEvent = CreateEvent(nullptr, false, false, nullptr);
+            WaitForFence(fence, m_LastSignaledValue, fenceEvent);
+            CloseHandle(fenceEvent);
+        }
+    }
+
+    void DirectStorageQueue::releaseCompletedResources()
+    {
+        const uint64_t completedValue = fence->GetCompletedValue();
+
+        while (!m_SignaledResources.empty() && m_SignaledResources.front().fenceValue <= completedValue)
+            m_SignaledResources.pop_front();
+    }
+
+    bool DirectStorageQueue::enqueueRequest(const DirectStorageRequest& request)
+    {
+        DSTORAGE_REQUEST dsRequest{};
+
+        if (sourceType == DirectStorageSourceType::File)
+        {
+            if (!request.file)
+            {
+                m_Context.error("DirectStorage requests on a file queue must have a file specified");
+                return false;
+            }
+
+            dsRequest.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+            dsRequest.Source.File.Source = request.file;
+            dsRequest.Source.File.Offset = request.fileOffset;
+            dsRequest.Source.File.Size = request.size;
+        }
+        else
+        {
+            if (!request.memory)
+            {
+                m_Context.error("DirectStorage requests on a memory queue must have a source memory pointer specified");
+                return false;
+            }
+
+            dsRequest.Options.SourceType = DSTORAGE_REQUEST_SOURCE_MEMORY;
+            dsRequest.Source.Memory.Source = request.memory;
+            dsRequest.Source.Memory.Size = request.size;
+        }
+
+        switch (request.compression)
+        {
+        case DirectStorageCompression::None:
+            dsRequest.Options.CompressionFormat = DSTORAGE_COMPRESSION_FORMAT_NONE;
+            dsRequest.UncompressedSize = request.size;
+            break;
+        case DirectStorageCompression::GDeflate:
+            dsRequest.Options.CompressionFormat = DSTORAGE_COMPRESSION_FORMAT_GDEFLATE;
+            dsRequest.UncompressedSize = request.uncompressedSize;
+            break;
+        default:
+            utils::InvalidEnum();
+            return false;
+        }
+
+        if (dsRequest.UncompressedSize == 0)
+        {
+            m_Context.error("DirectStorage requests must have a non-zero size and uncompressed size");
+            return false;
+        }
+
+        if ((request.destBuffer != nullptr) == (request.destTexture != nullptr))
+        {
+            m_Context.error("DirectStorage requests must have exactly one of destBuffer and destTexture specified");
+            return false;
+        }
+
+        if (request.destBuffer)
+        {
+            Buffer* buffer = checked_cast<Buffer*>(request.destBuffer);
+
+            if (request.destOffset + dsRequest.UncompressedSize > buffer->desc.byteSize)
+            {
+                m_Context.error("DirectStorage request writes outside of the destination buffer '"
+                    + utils::DebugNameToString(buffer->desc.debugName) + "'");
+                return false;
+            }
+
+            dsRequest.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_BUFFER;
+            dsRequest.Destination.Buffer.Resource = buffer->resource;
+            dsRequest.Destination.Buffer.Offset = request.destOffset;
+            dsRequest.Destination.Buffer.Size = dsRequest.UncompressedSize;
+        }
+        else
+        {
+            Texture* texture = checked_cast<Texture*>(request.destTexture);
+
+            if (request.mipLevel >= texture->desc.mipLevels || request.arraySlice >= texture->desc.arraySize)
+            {
+                m_Context.error("DirectStorage request subresource is outside of the destination texture '"
+                    + utils::DebugNameToString(texture->desc.debugName) + "'");
+                return false;
+            }
+
+            dsRequest.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_MULTIPLE_SUBRESOURCES;
+            dsRequest.Destination.MultipleSubresources.Resource = texture->resource;
+            dsRequest.Destination.MultipleSubresources.FirstSubresource = calcSubresource(request.mipLevel, request.arraySlice, 0,
+                texture->desc.mipLevels, texture->desc.arraySize);
+        }
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        queue->EnqueueRequest(&dsRequest);
+
+        m_PendingResources.push_back(request.destBuffer
+            ? RefCountPtr<IResource>(request.destBuffer)
+            : RefCountPtr<IResource>(request.destTexture));
+
+        return true;
+    }
+
+    void DirectStorageQueue::enqueueSignal(IEventQuery* _query)
+    {
+        EventQuery* query = checked_cast<EventQuery*>(_query);
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        releaseCompletedResources();
+
+        ++m_LastSignaledValue;
+        queue->EnqueueSignal(fence, m_LastSignaledValue);
+
+        if (!m_PendingResources.empty())
+        {
+            SignaledResources& signaled = m_SignaledResources.emplace_back();
+            signaled.fenceValue = m_LastSignaledValue;
+            signaled.resources = std::move(m_PendingResources);
+            m_PendingResources.clear();
+        }
+
+        query->started = true;
+        query->fence = fence;
+        query->fenceCounter = m_LastSignaledValue;
+        query->resolved = false;
+    }
+
+    void DirectStorageQueue::submit()
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        queue->Submit();
+    }
+
+    void DirectStorageQueue::queueWaitForSignals(CommandQueue waitQueue)
+    {
+        Queue* pQueue = m_Device->getQueue(waitQueue);
+        if (!pQueue)
+        {
+            m_Context.error("Cannot wait for DirectStorage signals on a queue that doesn't exist");
+            return;
+        }
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (m_LastSignaledValue != 0)
+            pQueue->wait(fence, m_LastSignaledValue);
+    }
+
+#endif // NVRHI_D3D12_WITH_DIRECTSTORAGE
+
+    DirectStorageQueueHandle Device::createDirectStorageQueue(const DirectStorageQueueDesc& desc)
+    {
+#if NVRHI_D3D12_WITH_DIRECTSTORAGE
+        if (!desc.factory)
+        {
+            m_Context.error("DirectStorageQueueDesc::factory must be specified");
+            return nullptr;
+        }
+
+        DSTORAGE_QUEUE_DESC queueDesc{};
+        queueDesc.SourceType = desc.sourceType == DirectStorageSourceType::File
+            ? DSTORAGE_REQUEST_SOURCE_FILE
+            : DSTORAGE_REQUEST_SOURCE_MEMORY;
+        queueDesc.Capacity = std::clamp<uint16_t>(desc.capacity, DSTORAGE_MIN_QUEUE_CAPACITY, DSTORAGE_MAX_QUEUE_CAPACITY);
+        queueDesc.Priority = DSTORAGE_PRIORITY_NORMAL;
+        queueDesc.Name = desc.debugName;
+        queueDesc.Device = m_Context.device;
+
+        RefCountPtr<DirectStorageQueue> queue = RefCountPtr<DirectStorageQueue>::Create(new DirectStorageQueue(m_Context, this));
+        queue->sourceType = desc.sourceType;
+
+        HRESULT hr = desc.factory->CreateQueue(&queueDesc, IID_PPV_ARGS(&queue->queue));
+        if (FAILED(hr))
+        {
+            std::stringstream ss;
+            ss << "Failed to create a DirectStorage queue, error code = 0x" << std::hex << std::setw(8) << hr;
+            m_Context.error(ss.str());
+            return nullptr;
+        }
+
+        hr = m_Context.device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&queue->fence));
+        if (FAILED(hr))
+        {
+            m_Context.error("Failed to create a fence for the DirectStorage queue");
+            return nullptr;
+        }
+
+        return queue;
+#else
+        (void)desc;
+        m_Context.error("NVRHI was built without DirectStorage support, see NVRHI_WITH_DIRECTSTORAGE");
+        return nullptr;
+#endif
+    }
+
+} // namespace nvrhi::d3d12
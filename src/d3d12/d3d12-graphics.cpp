@@ -23,6 +23,7 @@
 #include "d3d12-backend.h"
 
 #include <nvrhi/common/misc.h>
+#include "../common/pipeline-cache.h"
 #include <sstream>
 
 namespace nvrhi::d3d12
@@ -41,6 +42,62 @@ namespace nvrhi::d3d12
         }
     }
     
+    static uint64_t hashShaderBytecode(uint64_t hash, const D3D12_SHADER_BYTECODE& bytecode)
+    {
+        hash = hashPipelineCacheData(&bytecode.BytecodeLength, sizeof(bytecode.BytecodeLength), hash);
+        return hashPipelineCacheData(bytecode.pShaderBytecode, bytecode.BytecodeLength, hash);
+    }
+
+    // Computes a key for the pipeline library that is stable across runs, i.e. doesn't include any pointers.
+    // The root signature is represented by the hash of its serialized description, and every other field of the
+    // description is included, because LoadGraphicsPipeline fails with E_INVALIDARG if any of them differs.
+    static uint64_t hashPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+    {
+        uint64_t hash = hashPipelineCacheData(&rootSignatureHash, sizeof(rootSignatureHash));
+        hash = hashShaderBytecode(hash, desc.VS);
+        hash = hashShaderBytecode(hash, desc.HS);
+        hash = hashShaderBytecode(hash, desc.DS);
+        hash = hashShaderBytecode(hash, desc.GS);
+        hash = hashShaderBytecode(hash, desc.PS);
+        hash = hashPipelineCacheData(&desc.BlendState, sizeof(desc.BlendState), hash);
+        hash = hashPipelineCacheData(&desc.SampleMask, sizeof(desc.SampleMask), hash);
+        hash = hashPipelineCacheData(&desc.RasterizerState, sizeof(desc.RasterizerState), hash);
+        hash = hashPipelineCacheData(&desc.DepthStencilState, sizeof(desc.DepthStencilState), hash);
+        hash = hashPipelineCacheData(&desc.PrimitiveTopologyType, sizeof(desc.PrimitiveTopologyType), hash);
+        hash = hashPipelineCacheData(&desc.NumRenderTargets, sizeof(desc.NumRenderTargets), hash);
+        hash = hashPipelineCacheData(desc.RTVFormats, sizeof(desc.RTVFormats), hash);
+        hash = hashPipelineCacheData(&desc.DSVFormat, sizeof(desc.DSVFormat), hash);
+        hash = hashPipelineCacheData(&desc.SampleDesc, sizeof(desc.SampleDesc), hash);
+        hash = hashPipelineCacheData(&desc.IBStripCutValue, sizeof(desc.IBStripCutValue), hash);
+        hash = hashPipelineCacheData(&desc.NodeMask, sizeof(desc.NodeMask), hash);
+        hash = hashPipelineCacheData(&desc.Flags, sizeof(desc.Flags), hash);
+
+        hash = hashPipelineCacheData(&desc.InputLayout.NumElements, sizeof(desc.InputLayout.NumElements), hash);
+        for (UINT i = 0; i < desc.InputLayout.NumElements; i++)
+        {
+            const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+            hash = hashPipelineCacheData(element.SemanticName, strlen(element.SemanticName) + 1, hash);
+            hash = hashPipelineCacheData(&element.SemanticIndex, sizeof(element) - offsetof(D3D12_INPUT_ELEMENT_DESC, SemanticIndex), hash);
+        }
+
+        const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+        hash = hashPipelineCacheData(&streamOutput.NumEntries, sizeof(streamOutput.NumEntries), hash);
+        for (UINT i = 0; i < streamOutput.NumEntries; i++)
+        {
+            const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+            hash = hashPipelineCacheData(&entry.Stream, sizeof(entry.Stream), hash);
+            if (entry.SemanticName)
+                hash = hashPipelineCacheData(entry.SemanticName, strlen(entry.SemanticName) + 1, hash);
+            hash = hashPipelineCacheData(&entry.SemanticIndex, sizeof(entry) - offsetof(D3D12_SO_DECLARATION_ENTRY, SemanticIndex), hash);
+        }
+        hash = hashPipelineCacheData(&streamOutput.NumStrides, sizeof(streamOutput.NumStrides), hash);
+        if (streamOutput.NumStrides)
+            hash = hashPipelineCacheData(streamOutput.pBufferStrides, sizeof(UINT) * streamOutput.NumStrides, hash);
+        hash = hashPipelineCacheData(&streamOutput.RasterizedStream, sizeof(streamOutput.RasterizedStream), hash);
+
+        return hash;
+    }
+
     RefCountPtr<ID3D12PipelineState> Device::createPipelineState(const GraphicsPipelineDesc & state, RootSignature* pRS, const FramebufferInfo& fbinfo) const
     {
         if (state.renderState.singlePassStereo.enabled && !m_SinglePassStereoSupported)
@@ -163,6 +220,19 @@ namespace nvrhi::d3d12
         }
 #endif
 
+        std::wstring libraryKey;
+        {
+            // importPipelineCache may replace the library concurrently
+            std::lock_guard lockGuard(m_PipelineLibraryMutex);
+            if (m_PipelineLibrary)
+            {
+                libraryKey = getPipelineLibraryKey(hashPipelineStateDesc(desc, pRS->serializedHash));
+
+                if (SUCCEEDED(m_PipelineLibrary->LoadGraphicsPipeline(libraryKey.c_str(), &desc, IID_PPV_ARGS(&pipelineState))))
+                    return pipelineState;
+            }
+        }
+
         const HRESULT hr = m_Context.device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState));
 
         if (FAILED(hr))
@@ -171,13 +241,25 @@ namespace nvrhi::d3d12
             return nullptr;
         }
 
+        if (!libraryKey.empty())
+            storePipelineInLibrary(libraryKey, pipelineState);
+
         return pipelineState;
     }
 
     
     GraphicsPipelineHandle Device::createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb)
     {
+        return m_ObjectCache.getGraphicsPipeline(desc, fb, [this, &desc, fb] { return createGraphicsPipelineInternal(desc, fb); });
+    }
+
+    GraphicsPipelineHandle Device::createGraphicsPipelineInternal(const GraphicsPipelineDesc& desc, IFramebuffer* fb)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createGraphicsPipeline", "Pipeline");
+
         RefCountPtr<RootSignature> pRS = getRootSignature(desc.bindingLayouts, desc.inputLayout != nullptr);
+        if (!pRS)
+            return nullptr;
 
         RefCountPtr<ID3D12PipelineState> pPSO = createPipelineState(desc, pRS, fb->getFramebufferInfo());
 
@@ -284,7 +366,99 @@ namespace nvrhi::d3d12
         m_ActiveCommandList->commandList->OMSetRenderTargets(UINT(RTVs.size()), RTVs.data(), false, fb->desc.depthAttachment.valid() ? &DSV : nullptr);
     }
 
+    GraphicsStateBlockHandle Device::createGraphicsStateBlock(const GraphicsState& state)
+    {
+        if (!state.pipeline || !state.framebuffer)
+        {
+            m_Context.error("createGraphicsStateBlock: pipeline or framebuffer is NULL");
+            return nullptr;
+        }
+
+        GraphicsStateBlock* block = new GraphicsStateBlock(state);
+
+        for (IBindingSet* bindingSet : state.bindings)
+        {
+            if (bindingSet && bindingSet->getDesc() && checked_cast<BindingSet*>(bindingSet)->hasUavBindings)
+                block->hasUavBindings = true;
+        }
+
+        if (state.indexBuffer.buffer)
+        {
+            Buffer* buffer = checked_cast<Buffer*>(state.indexBuffer.buffer);
+
+            block->indexBufferView.Format = getDxgiFormatMapping(state.indexBuffer.format).srvFormat;
+            block->indexBufferView.SizeInBytes = (UINT)(buffer->desc.byteSize - state.indexBuffer.offset);
+            block->indexBufferView.BufferLocation = buffer->gpuVA + state.indexBuffer.offset;
+        }
+
+        InputLayout* inputLayout = checked_cast<InputLayout*>(state.pipeline->getDesc().inputLayout.Get());
+
+        for (const VertexBufferBinding& binding : state.vertexBuffers)
+        {
+            Buffer* buffer = checked_cast<Buffer*>(binding.buffer);
+
+            if (!buffer || binding.slot >= c_MaxVertexAttributes)
+                continue;
+
+            D3D12_VERTEX_BUFFER_VIEW& view = block->vertexBufferViews[binding.slot];
+            view.StrideInBytes = inputLayout ? inputLayout->elementStrides[binding.slot] : 0;
+            view.SizeInBytes = (UINT)(std::min(buffer->desc.byteSize - binding.offset, (uint64_t)ULONG_MAX));
+            view.BufferLocation = buffer->gpuVA + binding.offset;
+            block->maxVertexBufferSlot = std::max(block->maxVertexBufferSlot, binding.slot);
+        }
+
+        return GraphicsStateBlockHandle::Create(block);
+    }
+
+    void CommandList::setGraphicsStateBlock(IGraphicsStateBlock* _block)
+    {
+        GraphicsStateBlock* block = checked_cast<GraphicsStateBlock*>(_block);
+
+        const bool heapsChanged = m_Resources.shaderResourceViewHeap.getShaderVisibleHeap() != m_CurrentHeapSRVetc
+            || m_Resources.samplerHeap.getShaderVisibleHeap() != m_CurrentHeapSamplers;
+
+        const bool anyBarriers = !m_StateTracker.getTextureBarriers().empty() || !m_StateTracker.getBufferBarriers().empty();
+
+        // Binding sets with UAVs go through the full path, which places the UAV barriers between draws
+        if (block == m_CurrentGraphicsStateBlock && m_CurrentGraphicsStateValid && m_PushBindings.empty() && !heapsChanged
+            && !anyBarriers && !(block->hasUavBindings && m_EnableAutomaticBarriers))
+        {
+            // Nothing in the state has changed since the block was bound, and the volatile buffers are
+            // updated by the draw calls
+            return;
+        }
+
+        if (!m_PushBindings.empty())
+        {
+            // The pushed bindings turn into new binding sets, so the baked state doesn't apply
+            setGraphicsState(block->state);
+            return;
+        }
+
+        setGraphicsStateInternal(block->state, block);
+        m_CurrentGraphicsStateBlock = block;
+        m_Instance->referencedResources.push_back(block);
+    }
+
     void CommandList::setGraphicsState(const GraphicsState& state)
+    {
+        if (!m_PushBindings.empty() && state.pipeline)
+        {
+            // There are no push descriptors in D3D12, so the pushed bindings become regular binding sets.
+            // They are released after the state is set, when the command list already references them.
+            GraphicsState resolvedState = state;
+            if (m_Desc.enableStatistics)
+                m_Statistics.numDescriptorsWritten += m_PushBindings.getNumBindings();
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, &m_Instance->referencedResources))
+                setGraphicsStateInternal(resolvedState, nullptr);
+            m_PushBindings.clear();
+            return;
+        }
+
+        setGraphicsStateInternal(state, nullptr);
+    }
+
+    void CommandList::setGraphicsStateInternal(const GraphicsState& state, const GraphicsStateBlock* block)
     {
         GraphicsPipeline* pso = checked_cast<GraphicsPipeline*>(state.pipeline);
         Framebuffer* framebuffer = checked_cast<Framebuffer*>(state.framebuffer);
@@ -295,6 +469,7 @@ namespace nvrhi::d3d12
 
         const bool updatePipeline = !m_CurrentGraphicsStateValid || m_CurrentGraphicsState.pipeline != state.pipeline;
         const bool updateIndirectParams = !m_CurrentGraphicsStateValid || m_CurrentGraphicsState.indirectParams != state.indirectParams;
+        const bool updateIndirectCountBuffer = !m_CurrentGraphicsStateValid || m_CurrentGraphicsState.indirectCountBuffer != state.indirectCountBuffer;
 
         const bool updateViewports = !m_CurrentGraphicsStateValid ||
             arraysAreDifferent(m_CurrentGraphicsState.viewport.viewports, state.viewport.viewports) ||
@@ -322,6 +497,12 @@ namespace nvrhi::d3d12
         if (bindingUpdateMask == 0)
             bindingUpdateMask = arrayDifferenceMask(m_CurrentGraphicsState.bindings, state.bindings);
 
+        if (m_Desc.enableStatistics)
+        {
+            countStateChanges(m_Statistics, { updatePipeline, updateFramebuffer, bindingUpdateMask != 0, updateIndexBuffer,
+                updateVertexBuffers, updateViewports, updateBlendFactor, updateStencilRef, updateShadingRate });
+        }
+
         if (updatePipeline)
         {
             bindGraphicsPipeline(pso, updateRootSignature);
@@ -340,12 +521,24 @@ namespace nvrhi::d3d12
 
         if (updateFramebuffer)
         {
-            bindFramebuffer(framebuffer);
+            // Bundles cannot set render targets, they are bound by the command list that executes the bundle
+            if (!m_Desc.isBundle)
+                bindFramebuffer(framebuffer);
+
             m_Instance->referencedResources.push_back(framebuffer);
         }
 
         setGraphicsBindings(state.bindings, bindingUpdateMask, state.indirectParams, updateIndirectParams, pso->rootSignature);
 
+        if (state.indirectCountBuffer && updateIndirectCountBuffer)
+        {
+            if (m_EnableAutomaticBarriers)
+            {
+                requireBufferState(state.indirectCountBuffer, ResourceStates::IndirectArgument);
+            }
+            m_Instance->referencedResources.push_back(state.indirectCountBuffer);
+        }
+
         if (updateIndexBuffer)
         {
             D3D12_INDEX_BUFFER_VIEW IBV = {};
@@ -359,9 +552,16 @@ namespace nvrhi::d3d12
                     requireBufferState(buffer, ResourceStates::IndexBuffer);
                 }
 
-                IBV.Format = getDxgiFormatMapping(state.indexBuffer.format).srvFormat;
-                IBV.SizeInBytes = (UINT)(buffer->desc.byteSize - state.indexBuffer.offset);
-                IBV.BufferLocation = buffer->gpuVA + state.indexBuffer.offset;
+                if (block)
+                {
+                    IBV = block->indexBufferView;
+                }
+                else
+                {
+                    IBV.Format = getDxgiFormatMapping(state.indexBuffer.format).srvFormat;
+                    IBV.SizeInBytes = (UINT)(buffer->desc.byteSize - state.indexBuffer.offset);
+                    IBV.BufferLocation = buffer->gpuVA + state.indexBuffer.offset;
+                }
 
                 m_Instance->referencedResources.push_back(state.indexBuffer.buffer);
             }
@@ -372,7 +572,7 @@ namespace nvrhi::d3d12
         if (updateVertexBuffers)
         {
             D3D12_VERTEX_BUFFER_VIEW VBVs[c_MaxVertexAttributes] = {};
-            uint32_t maxVbIndex = 0;
+            uint32_t maxVbIndex = block ? block->maxVertexBufferSlot : 0;
             InputLayout* inputLayout = checked_cast<InputLayout*>(pso->desc.inputLayout.Get());
 
             for (const VertexBufferBinding& binding : state.vertexBuffers)
@@ -384,16 +584,16 @@ namespace nvrhi::d3d12
                     requireBufferState(buffer, ResourceStates::VertexBuffer);
                 }
 
+                m_Instance->referencedResources.push_back(buffer);
+
                 // This is tested by the validation layer, skip invalid slots here if VL is not used.
-                if (binding.slot >= c_MaxVertexAttributes)
+                if (block || binding.slot >= c_MaxVertexAttributes)
                     continue;
 
                 VBVs[binding.slot].StrideInBytes = inputLayout->elementStrides[binding.slot];
                 VBVs[binding.slot].SizeInBytes = (UINT)(std::min(buffer->desc.byteSize - binding.offset, (uint64_t)ULONG_MAX));
                 VBVs[binding.slot].BufferLocation = buffer->gpuVA + binding.offset;
                 maxVbIndex = std::max(maxVbIndex, binding.slot);
-
-                m_Instance->referencedResources.push_back(buffer);
             }
 
             if (m_CurrentGraphicsStateValid)
@@ -405,10 +605,10 @@ namespace nvrhi::d3d12
                 }
             }
 
-            m_ActiveCommandList->commandList->IASetVertexBuffers(0, maxVbIndex + 1, VBVs);
+            m_ActiveCommandList->commandList->IASetVertexBuffers(0, maxVbIndex + 1, block ? block->vertexBufferViews : VBVs);
         }
 
-        if (updateShadingRate || updateFramebuffer)
+        if ((updateShadingRate || updateFramebuffer) && !m_Desc.isBundle)
         {
             auto framebufferDesc = framebuffer->getDesc();
             bool shouldEnableVariableRateShading = framebufferDesc.shadingRateAttachment.valid() && state.shadingRateState.enabled;
@@ -451,6 +651,13 @@ namespace nvrhi::d3d12
         {
             DX12_ViewportState vpState = convertViewportState(pso->desc.renderState.rasterState, framebuffer->framebufferInfo, state.viewport);
 
+            if (m_Desc.isBundle)
+            {
+                // Same as render targets, viewports and scissors are inherited from the executing command list
+                m_BundleViewportState = vpState;
+                vpState = DX12_ViewportState();
+            }
+
             if (vpState.numViewports)
             {
                 m_ActiveCommandList->commandList->RSSetViewports(vpState.numViewports, vpState.viewports);
@@ -463,7 +670,7 @@ namespace nvrhi::d3d12
         }
 
 #if NVRHI_D3D12_WITH_NVAPI
-        bool updateSPS = m_CurrentSinglePassStereoState != pso->desc.renderState.singlePassStereo;
+        bool updateSPS = !m_Desc.isBundle && m_CurrentSinglePassStereoState != pso->desc.renderState.singlePassStereo;
 
         if (updateSPS)
         {
@@ -486,6 +693,7 @@ namespace nvrhi::d3d12
         m_CurrentRayTracingStateValid = false;
         m_CurrentGraphicsState = state;
         m_CurrentGraphicsState.dynamicStencilRefValue = effectiveStencilRefValue;
+        m_CurrentGraphicsStateBlock = nullptr;
     }
 
     void CommandList::unbindShadingRateState()
@@ -496,6 +704,7 @@ namespace nvrhi::d3d12
             m_ActiveCommandList->commandList6->RSSetShadingRate(D3D12_SHADING_RATE_1X1, nullptr);
             m_CurrentGraphicsState.shadingRateState.enabled = false;
             m_CurrentGraphicsState.framebuffer = nullptr;
+            m_CurrentGraphicsStateBlock = nullptr;
         }
     }
 
@@ -508,7 +717,7 @@ namespace nvrhi::d3d12
 
         for (VolatileConstantBufferBinding& parameter : m_CurrentGraphicsVolatileCBs)
         {
-            D3D12_GPU_VIRTUAL_ADDRESS currentGpuVA = m_VolatileConstantBufferAddresses[parameter.buffer];
+            D3D12_GPU_VIRTUAL_ADDRESS currentGpuVA = getVolatileConstantBufferAddress(parameter.buffer);
 
             if (currentGpuVA != parameter.address)
             {
@@ -518,6 +727,18 @@ namespace nvrhi::d3d12
             }
         }
 
+        for (PromotedConstantBufferBinding& parameter : m_CurrentGraphicsPromotedCBs)
+        {
+            const VolatileConstantBufferShadow* shadow = getVolatileConstantBufferShadow(parameter.buffer, false);
+
+            if (shadow && shadow->version != parameter.version)
+            {
+                m_ActiveCommandList->commandList->SetGraphicsRoot32BitConstants(parameter.bindingPoint, parameter.num32BitValues, shadow->data, 0);
+
+                parameter.version = shadow->version;
+            }
+        }
+
         m_AnyVolatileBufferWrites = false;
     }
 
@@ -539,6 +760,7 @@ namespace nvrhi::d3d12
     {
         updateGraphicsVolatileBuffers();
 
+        countDraws(1);
         m_ActiveCommandList->commandList->DrawInstanced(args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
     }
 
@@ -546,9 +768,64 @@ namespace nvrhi::d3d12
     {
         updateGraphicsVolatileBuffers();
 
+        countDraws(1);
         m_ActiveCommandList->commandList->DrawIndexedInstanced(args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
     }
 
+    void CommandList::drawMulti(const MultiDrawArguments& multiDraw)
+    {
+        drawMultiInternal(multiDraw, false);
+    }
+
+    void CommandList::drawIndexedMulti(const MultiDrawArguments& multiDraw)
+    {
+        drawMultiInternal(multiDraw, true);
+    }
+
+    void CommandList::drawMultiInternal(const MultiDrawArguments& multiDraw, bool indexed)
+    {
+        GraphicsPipeline* pso = checked_cast<GraphicsPipeline*>(m_CurrentGraphicsState.pipeline);
+        const RootSignature* rootSignature = pso->rootSignature;
+
+        const uint8_t* pushConstants = rootSignature->pushConstantByteSize ? static_cast<const uint8_t*>(multiDraw.pushConstants) : nullptr;
+        const uint32_t bindingUpdateMask = 1u << multiDraw.bindingSetIndex;
+
+        if (multiDraw.bindingSets)
+        {
+            // The bindings no longer match the block
+            m_CurrentGraphicsStateBlock = nullptr;
+        }
+
+        countDraws(multiDraw.drawCount);
+        if (pushConstants && m_Desc.enableStatistics)
+            m_Statistics.pushConstantBytes += uint64_t(multiDraw.pushConstantsByteSize) * multiDraw.drawCount;
+
+        for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+        {
+            if (multiDraw.bindingSets && multiDraw.bindingSets[drawIndex] != m_CurrentGraphicsState.bindings[multiDraw.bindingSetIndex])
+            {
+                m_CurrentGraphicsState.bindings[multiDraw.bindingSetIndex] = multiDraw.bindingSets[drawIndex];
+                setGraphicsBindings(m_CurrentGraphicsState.bindings, bindingUpdateMask, nullptr, false, rootSignature);
+                commitBarriers();
+            }
+
+            if (pushConstants)
+            {
+                m_ActiveCommandList->commandList->SetGraphicsRoot32BitConstants(rootSignature->rootParameterPushConstants,
+                    multiDraw.pushConstantsByteSize / 4, pushConstants + size_t(drawIndex) * multiDraw.pushConstantsStride, 0);
+            }
+
+            updateGraphicsVolatileBuffers();
+
+            const DrawArguments& args = multiDraw.args[drawIndex];
+
+            if (indexed)
+                m_ActiveCommandList->commandList->DrawIndexedInstanced(args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
+            else
+                m_ActiveCommandList->commandList->DrawInstanced(args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
+        }
+    }
+
     void CommandList::drawIndirect(uint32_t offsetBytes, uint32_t drawCount)
     {
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
@@ -556,7 +833,8 @@ namespace nvrhi::d3d12
 
         updateGraphicsVolatileBuffers();
 
-        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.drawIndirectSignature, drawCount, indirectParams->resource, offsetBytes, nullptr, 0);
+        countDraws(drawCount);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW), drawCount, indirectParams->resource, offsetBytes, nullptr, 0);
     }
 
     void CommandList::drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount)
@@ -566,7 +844,107 @@ namespace nvrhi::d3d12
 
         updateGraphicsVolatileBuffers();
 
-        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.drawIndexedIndirectSignature, drawCount, indirectParams->resource, offsetBytes, nullptr, 0);
+        countDraws(drawCount);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED), drawCount, indirectParams->resource, offsetBytes, nullptr, 0);
+    }
+
+    void CommandList::drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
+        Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectCountBuffer);
+        assert(indirectParams && countBuffer);
+
+        updateGraphicsVolatileBuffers();
+
+        countDraws(1);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW), maxDrawCount, indirectParams->resource, offsetBytes, countBuffer->resource, countOffsetBytes);
+    }
+
+    void CommandList::drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
+        Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectCountBuffer);
+        assert(indirectParams && countBuffer);
+
+        updateGraphicsVolatileBuffers();
+
+        countDraws(1);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED), maxDrawCount, indirectParams->resource, offsetBytes, countBuffer->resource, countOffsetBytes);
+    }
+    
+    void CommandList::executeBundles(ICommandList* const* bundles, size_t numBundles)
+    {
+        if (numBundles == 0)
+            return;
+
+        for (size_t index = 0; index < numBundles; index++)
+        {
+            CommandList* bundle = checked_cast<CommandList*>(bundles[index]);
+
+            if ((bundle->m_BundleHeapSRVetc && bundle->m_BundleHeapSRVetc != m_Resources.shaderResourceViewHeap.getShaderVisibleHeap()) ||
+                (bundle->m_BundleHeapSamplers && bundle->m_BundleHeapSamplers != m_Resources.samplerHeap.getShaderVisibleHeap()))
+            {
+                m_Context.error("Cannot execute a bundle that was recorded before the descriptor heaps were resized, it must be recorded again");
+                return;
+            }
+        }
+
+        unbindShadingRateState();
+
+        if (m_EnableAutomaticBarriers)
+        {
+            // Merge the requirements of all bundles first: they all execute after the same set of barriers
+            m_BundleStates.clear();
+            for (size_t index = 0; index < numBundles; index++)
+                m_BundleStates.merge(checked_cast<CommandList*>(bundles[index])->m_BundleStates);
+
+            for (const auto& requirement : m_BundleStates.getTextureRequirements())
+                requireTextureState(requirement.texture, requirement.subresources, requirement.state);
+
+            for (const auto& requirement : m_BundleStates.getBufferRequirements())
+                requireBufferState(requirement.buffer, requirement.state);
+        }
+
+        // All bundles in one call render into the same framebuffer, which is checked by the validation layer
+        Framebuffer* framebuffer = checked_cast<Framebuffer*>(checked_cast<CommandList*>(bundles[0])->m_BundleFramebuffer.Get());
+        if (framebuffer)
+        {
+            bindFramebuffer(framebuffer);
+            m_Instance->referencedResources.push_back(framebuffer);
+        }
+
+        commitBarriers();
+        commitDescriptorHeaps();
+
+        for (size_t index = 0; index < numBundles; index++)
+        {
+            CommandList* bundle = checked_cast<CommandList*>(bundles[index]);
+
+            if (!bundle->m_Instance || !bundle->m_ActiveCommandList)
+                continue;
+
+            const DX12_ViewportState& vpState = bundle->m_BundleViewportState;
+            if (vpState.numViewports)
+                m_ActiveCommandList->commandList->RSSetViewports(vpState.numViewports, vpState.viewports);
+            if (vpState.numScissorRects)
+                m_ActiveCommandList->commandList->RSSetScissorRects(vpState.numScissorRects, vpState.scissorRects);
+
+            m_ActiveCommandList->commandList->ExecuteBundle(bundle->m_ActiveCommandList->commandList);
+
+            m_Instance->referencedBundles.push_back(bundle->m_Instance);
+
+            addBundleStatistics(bundle);
+        }
+
+        // The pipeline, root signature and root arguments set by the bundles remain set after they execute
+        m_CurrentGraphicsStateValid = false;
+        m_CurrentComputeStateValid = false;
+        m_CurrentMeshletStateValid = false;
+        m_CurrentRayTracingStateValid = false;
+        m_CurrentGraphicsVolatileCBs.resize(0);
+        m_CurrentComputeVolatileCBs.resize(0);
+        m_CurrentGraphicsPromotedCBs.resize(0);
+        m_CurrentComputePromotedCBs.resize(0);
     }
     
     DX12_ViewportState convertViewportState(const RasterState& rasterState, const FramebufferInfoEx& framebufferInfo, const ViewportState& vpState)
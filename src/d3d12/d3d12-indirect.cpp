@@ -0,0 +1,190 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "d3d12-backend.h"
+
+#include <nvrhi/common/misc.h>
+#include <sstream>
+#include <iomanip>
+
+namespace nvrhi::d3d12
+{
+    // IndirectArgumentDesc::getByteSize must match the sizes of the native arguments
+    static_assert(sizeof(DrawIndirectArguments) == sizeof(D3D12_DRAW_ARGUMENTS));
+    static_assert(sizeof(DrawIndexedIndirectArguments) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+    static_assert(sizeof(IndirectVertexBufferArguments) == sizeof(D3D12_VERTEX_BUFFER_VIEW));
+    static_assert(sizeof(IndirectIndexBufferArguments) == sizeof(D3D12_INDEX_BUFFER_VIEW));
+
+    Object CommandSignature::getNativeObject(ObjectType objectType)
+    {
+        switch (objectType)
+        {
+        case ObjectTypes::D3D12_CommandSignature:
+            return Object(handle.Get());
+        default:
+            return nullptr;
+        }
+    }
+
+    uint32_t CommandSignature::getNativeIndexFormat(Format format) const
+    {
+        switch (format)
+        {
+        case Format::R16_UINT:
+            return DXGI_FORMAT_R16_UINT;
+        case Format::R32_UINT:
+            return DXGI_FORMAT_R32_UINT;
+        default:
+            return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    CommandSignatureHandle Device::createCommandSignature(const CommandSignatureDesc& desc)
+    {
+        RootSignature* rootSignature = nullptr;
+        if (desc.graphicsPipeline)
+            rootSignature = checked_cast<GraphicsPipeline*>(desc.graphicsPipeline)->rootSignature;
+        else if (desc.computePipeline)
+            rootSignature = checked_cast<ComputePipeline*>(desc.computePipeline)->rootSignature;
+
+        RefCountPtr<CommandSignature> signature = RefCountPtr<CommandSignature>::Create(new CommandSignature());
+        signature->desc = desc;
+
+        std::vector<D3D12_INDIRECT_ARGUMENT_DESC> argumentDescs;
+        argumentDescs.reserve(desc.arguments.size());
+
+        bool usesRootArguments = false;
+
+        for (const IndirectArgumentDesc& argument : desc.arguments)
+        {
+            D3D12_INDIRECT_ARGUMENT_DESC& argumentDesc = argumentDescs.emplace_back();
+
+            switch (argument.type)
+            {
+            case IndirectArgumentType::Draw:
+                argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+                break;
+
+            case IndirectArgumentType::DrawIndexed:
+                argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+                break;
+
+            case IndirectArgumentType::Dispatch:
+                argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+                signature->isDispatch = true;
+                break;
+
+            case IndirectArgumentType::VertexBuffer:
+                argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+                argumentDesc.VertexBuffer.Slot = argument.vertexBufferSlot;
+                signature->changesState = true;
+                break;
+
+            case IndirectArgumentType::IndexBuffer:
+                argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+                signature->changesState = true;
+                break;
+
+            case IndirectArgumentType::PushConstants:
+                if (!rootSignature || rootSignature->rootParameterPushConstants == ~0u)
+                {
+                    m_Context.error("Command signatures with PushConstants arguments require a pipeline that uses push constants");
+                    return nullptr;
+                }
+
+                argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+                argumentDesc.Constant.RootParameterIndex = rootSignature->rootParameterPushConstants;
+                argumentDesc.Constant.DestOffsetIn32BitValues = argument.pushConstantOffset;
+                argumentDesc.Constant.Num32BitValuesToSet = argument.numPushConstantValues;
+                usesRootArguments = true;
+                signature->changesState = true;
+                break;
+
+            default:
+                utils::InvalidEnum();
+                return nullptr;
+            }
+        }
+
+        D3D12_COMMAND_SIGNATURE_DESC csDesc = {};
+        csDesc.ByteStride = desc.getCommandByteStride();
+        csDesc.NumArgumentDescs = UINT(argumentDescs.size());
+        csDesc.pArgumentDescs = argumentDescs.data();
+
+        // The root signature must only be specified when the signature changes root arguments
+        ID3D12RootSignature* d3dRootSignature = nullptr;
+        if (usesRootArguments)
+        {
+            signature->rootSignature = rootSignature;
+            d3dRootSignature = rootSignature->handle;
+        }
+
+        const HRESULT res = m_Context.device->CreateCommandSignature(&csDesc, d3dRootSignature, IID_PPV_ARGS(&signature->handle));
+        if (FAILED(res))
+        {
+            std::stringstream ss;
+            ss << "CreateCommandSignature call failed, HRESULT = 0x" << std::hex << std::setw(8) << res;
+            m_Context.error(ss.str());
+            return nullptr;
+        }
+
+        return signature;
+    }
+
+    void CommandList::executeIndirect(ICommandSignature* _signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes)
+    {
+        CommandSignature* signature = checked_cast<CommandSignature*>(_signature);
+
+        if (signature->isDispatch)
+        {
+            Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentComputeState.indirectParams);
+            assert(indirectParams); // validation layer handles this
+
+            updateComputeVolatileBuffers();
+
+            m_ActiveCommandList->commandList->ExecuteIndirect(signature->handle, maxCommandCount, indirectParams->resource, offsetBytes, nullptr, 0);
+
+            // The root constants changed by the commands are undefined after ExecuteIndirect
+            if (signature->changesState)
+                m_CurrentComputeStateValid = false;
+        }
+        else
+        {
+            Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
+            Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectCountBuffer);
+            assert(indirectParams);
+
+            updateGraphicsVolatileBuffers();
+
+            m_ActiveCommandList->commandList->ExecuteIndirect(signature->handle, maxCommandCount, indirectParams->resource, offsetBytes,
+                countBuffer ? countBuffer->resource.Get() : nullptr, countBuffer ? countOffsetBytes : 0);
+
+            // The vertex buffers, index buffer and root constants changed by the commands are undefined after ExecuteIndirect
+            if (signature->changesState)
+                m_CurrentGraphicsStateValid = false;
+        }
+
+        m_Instance->referencedResources.push_back(signature);
+    }
+
+} // namespace nvrhi::d3d12
@@ -23,6 +23,7 @@
 #include "d3d12-backend.h"
 
 #include <nvrhi/common/misc.h>
+#include "../common/pipeline-cache.h"
 #include <sstream>
 
 namespace nvrhi::d3d12
@@ -145,6 +146,34 @@ namespace nvrhi::d3d12
         streamDesc.pPipelineStateSubobjectStream = &psoDesc;
         streamDesc.SizeInBytes = sizeof(psoDesc);
 
+        std::wstring libraryKey;
+        {
+            // importPipelineCache may replace the library concurrently
+            std::lock_guard lockGuard(m_PipelineLibraryMutex);
+            if (m_PipelineLibrary1)
+            {
+                // Hash every subobject, with the root signature's serialized hash, see hashPipelineStateDesc for graphics PSOs
+                uint64_t hash = hashPipelineCacheData(&pRS->serializedHash, sizeof(pRS->serializedHash));
+                for (const D3D12_SHADER_BYTECODE* bytecode : { &psoDesc.AmplificationShader, &psoDesc.MeshShader, &psoDesc.PixelShader })
+                {
+                    hash = hashPipelineCacheData(&bytecode->BytecodeLength, sizeof(bytecode->BytecodeLength), hash);
+                    hash = hashPipelineCacheData(bytecode->pShaderBytecode, bytecode->BytecodeLength, hash);
+                }
+                hash = hashPipelineCacheData(&psoDesc.PrimitiveTopologyType, sizeof(psoDesc.PrimitiveTopologyType), hash);
+                hash = hashPipelineCacheData(&psoDesc.RasterizerState, sizeof(psoDesc.RasterizerState), hash);
+                hash = hashPipelineCacheData(&psoDesc.DepthStencilState, sizeof(psoDesc.DepthStencilState), hash);
+                hash = hashPipelineCacheData(&psoDesc.BlendState, sizeof(psoDesc.BlendState), hash);
+                hash = hashPipelineCacheData(&psoDesc.SampleDesc, sizeof(psoDesc.SampleDesc), hash);
+                hash = hashPipelineCacheData(&psoDesc.RenderTargets, sizeof(psoDesc.RenderTargets), hash);
+                hash = hashPipelineCacheData(&psoDesc.DSVFormat, sizeof(psoDesc.DSVFormat), hash);
+                hash = hashPipelineCacheData(&psoDesc.SampleMask, sizeof(psoDesc.SampleMask), hash);
+                libraryKey = getPipelineLibraryKey(hash);
+
+                if (SUCCEEDED(m_PipelineLibrary1->LoadPipeline(libraryKey.c_str(), &streamDesc, IID_PPV_ARGS(&pipelineState))))
+                    return pipelineState;
+            }
+        }
+
         HRESULT hr = m_Context.device2->CreatePipelineState(&streamDesc, IID_PPV_ARGS(&pipelineState));
         if (FAILED(hr))
         {
@@ -152,12 +181,24 @@ namespace nvrhi::d3d12
             return nullptr;
         }
 
+        if (!libraryKey.empty())
+            storePipelineInLibrary(libraryKey, pipelineState);
+
         return pipelineState;
     }
 
     MeshletPipelineHandle Device::createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb)
     {
+        return m_ObjectCache.getMeshletPipeline(desc, fb, [this, &desc, fb] { return createMeshletPipelineInternal(desc, fb); });
+    }
+
+    MeshletPipelineHandle Device::createMeshletPipelineInternal(const MeshletPipelineDesc& desc, IFramebuffer* fb)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createMeshletPipeline", "Pipeline");
+
         RefCountPtr<RootSignature> pRS = getRootSignature(desc.bindingLayouts, false);
+        if (!pRS)
+            return nullptr;
 
         RefCountPtr<ID3D12PipelineState> pPSO = createPipelineState(desc, pRS, fb->getFramebufferInfo());
 
@@ -210,6 +251,17 @@ namespace nvrhi::d3d12
 
     void CommandList::setMeshletState(const MeshletState& state)
     {
+        if (!m_PushBindings.empty() && state.pipeline)
+        {
+            MeshletState resolvedState = state;
+            if (m_Desc.enableStatistics)
+                m_Statistics.numDescriptorsWritten += m_PushBindings.getNumBindings();
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, &m_Instance->referencedResources))
+                setMeshletState(resolvedState);
+            m_PushBindings.clear();
+            return;
+        }
+
         MeshletPipeline* pso = checked_cast<MeshletPipeline*>(state.pipeline);
         Framebuffer* framebuffer = checked_cast<Framebuffer*>(state.framebuffer);
 
@@ -221,6 +273,7 @@ namespace nvrhi::d3d12
 
         const bool updatePipeline = !m_CurrentMeshletStateValid || m_CurrentMeshletState.pipeline != state.pipeline;
         const bool updateIndirectParams = !m_CurrentMeshletStateValid || m_CurrentMeshletState.indirectParams != state.indirectParams;
+        const bool updateIndirectCountBuffer = !m_CurrentMeshletStateValid || m_CurrentMeshletState.indirectCountBuffer != state.indirectCountBuffer;
 
         const bool updateViewports = !m_CurrentMeshletStateValid ||
             arraysAreDifferent(m_CurrentMeshletState.viewport.viewports, state.viewport.viewports) ||
@@ -243,6 +296,12 @@ namespace nvrhi::d3d12
         if (bindingUpdateMask == 0)
             bindingUpdateMask = arrayDifferenceMask(m_CurrentMeshletState.bindings, state.bindings);
 
+        if (m_Desc.enableStatistics)
+        {
+            countStateChanges(m_Statistics, { updatePipeline, updateFramebuffer, bindingUpdateMask != 0, updateViewports,
+                updateBlendFactor, updateStencilRef });
+        }
+
         if (updatePipeline)
         {
             bindMeshletPipeline(pso, updateRootSignature);
@@ -266,6 +325,15 @@ namespace nvrhi::d3d12
         }
 
         setGraphicsBindings(state.bindings, bindingUpdateMask, state.indirectParams, updateIndirectParams, pso->rootSignature);
+
+        if (state.indirectCountBuffer && updateIndirectCountBuffer)
+        {
+            if (m_EnableAutomaticBarriers)
+            {
+                requireBufferState(state.indirectCountBuffer, ResourceStates::IndirectArgument);
+            }
+            m_Instance->referencedResources.push_back(state.indirectCountBuffer);
+        }
         
         commitBarriers();
 
@@ -298,6 +366,30 @@ namespace nvrhi::d3d12
     {
         updateGraphicsVolatileBuffers();
 
+        countDraws(1);
         m_ActiveCommandList->commandList6->DispatchMesh(groupsX, groupsY, groupsZ);
     }
+
+    void CommandList::dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount)
+    {
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentMeshletState.indirectParams);
+        assert(indirectParams); // validation layer handles this
+
+        updateGraphicsVolatileBuffers();
+
+        countDraws(drawCount);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_MESH), drawCount, indirectParams->resource, offsetBytes, nullptr, 0);
+    }
+
+    void CommandList::dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentMeshletState.indirectParams);
+        Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentMeshletState.indirectCountBuffer);
+        assert(indirectParams && countBuffer);
+
+        updateGraphicsVolatileBuffers();
+
+        countDraws(1);
+        m_ActiveCommandList->commandList->ExecuteIndirect(m_Context.getIndirectSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_MESH), maxDrawCount, indirectParams->resource, offsetBytes, countBuffer->resource, countOffsetBytes);
+    }
 } // namespace nvrhi::d3d12
@@ -0,0 +1,235 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "d3d12-backend.h"
+
+#include <nvrhi/common/misc.h>
+#include <sstream>
+#include <iomanip>
+
+namespace nvrhi::d3d12
+{
+
+    static uint32_t getHeapTypeIndex(D3D12_HEAP_TYPE heapType)
+    {
+        switch (heapType)
+        {
+        case D3D12_HEAP_TYPE_DEFAULT:  return 0;
+        case D3D12_HEAP_TYPE_UPLOAD:   return 1;
+        case D3D12_HEAP_TYPE_READBACK: return 2;
+        default:
+            utils::InvalidEnum();
+            return 0;
+        }
+    }
+
+    PlacedResourcePool::PoolHeap* PlacedResourcePool::createPoolHeap(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass, uint32_t bucketIndex)
+    {
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = m_HeapSize;
+        heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Properties.Type = heapType;
+        heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        heapDesc.Properties.CreationNodeMask = 1;
+        heapDesc.Properties.VisibleNodeMask = 1;
+
+        HeapDesc desc;
+        desc.capacity = m_HeapSize;
+
+        switch (resourceClass)
+        {
+        case ResourceClass::Buffer:
+            heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+            desc.debugName = "PlacedResourcePool (Buffers)";
+            break;
+        case ResourceClass::Texture:
+            heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+            desc.debugName = "PlacedResourcePool (Textures)";
+            break;
+        case ResourceClass::RenderTargetOrDepthStencil:
+            heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+            desc.debugName = "PlacedResourcePool (RT/DS Textures)";
+            break;
+        default:
+            utils::InvalidEnum();
+            return nullptr;
+        }
+
+        switch (heapType)
+        {
+        case D3D12_HEAP_TYPE_UPLOAD:
+            desc.type = HeapType::Upload;
+            break;
+        case D3D12_HEAP_TYPE_READBACK:
+            desc.type = HeapType::Readback;
+            break;
+        default:
+            desc.type = HeapType::DeviceLocal;
+            break;
+        }
+
+        RefCountPtr<ID3D12Heap> d3dHeap;
+        const HRESULT res = m_Context.device->CreateHeap(&heapDesc, IID_PPV_ARGS(&d3dHeap));
+
+        if (FAILED(res))
+        {
+            std::stringstream ss;
+            ss << "CreateHeap call failed for heap " << desc.debugName
+                << ", HRESULT = 0x" << std::hex << std::setw(8) << res;
+            m_Context.error(ss.str());
+
+            return nullptr;
+        }
+
+        std::wstring wname(desc.debugName.begin(), desc.debugName.end());
+        d3dHeap->SetName(wname.c_str());
+
+        Heap* heap = new Heap();
+        heap->heap = d3dHeap;
+        heap->desc = desc;
+
+        if (heapType == D3D12_HEAP_TYPE_DEFAULT)
+            m_ResidencyManager.track(heap->residency, d3dHeap, m_HeapSize, desc.residencyPriority);
+
+        auto poolHeap = std::make_unique<PoolHeap>();
+        poolHeap->heap = HeapHandle::Create(heap);
+        poolHeap->ranges.reset(m_HeapSize);
+        poolHeap->bucketIndex = bucketIndex;
+
+        PoolHeap* result = poolHeap.get();
+        m_Buckets[bucketIndex].push_back(std::move(poolHeap));
+        return result;
+    }
+
+    bool PlacedResourcePool::tryCreateResource(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass, const D3D12_RESOURCE_DESC& resourceDesc,
+        D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue,
+        Allocation& outAllocation, RefCountPtr<ID3D12Resource>& outResource)
+    {
+        if (!isEnabled())
+            return false;
+
+        const D3D12_RESOURCE_ALLOCATION_INFO allocInfo = m_Context.device->GetResourceAllocationInfo(1, 1, &resourceDesc);
+
+        // Large resources don't benefit from pooling and would fragment the heaps
+        if (allocInfo.SizeInBytes == UINT64_MAX || allocInfo.SizeInBytes > m_HeapSize / 2)
+            return false;
+
+        const uint32_t bucketIndex = getHeapTypeIndex(heapType) * uint32_t(ResourceClass::Count) + uint32_t(resourceClass);
+
+        Allocation allocation;
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            for (auto& poolHeap : m_Buckets[bucketIndex])
+            {
+                if (poolHeap->ranges.allocate(allocInfo.SizeInBytes, allocInfo.Alignment, allocation.offset))
+                {
+                    allocation.poolHeap = poolHeap.get();
+                    break;
+                }
+            }
+
+            if (!allocation.poolHeap)
+            {
+                PoolHeap* poolHeap = createPoolHeap(heapType, resourceClass, bucketIndex);
+                if (!poolHeap)
+                    return false;
+
+                [[maybe_unused]] const bool allocated = poolHeap->ranges.allocate(allocInfo.SizeInBytes, allocInfo.Alignment, allocation.offset);
+                assert(allocated);
+                allocation.poolHeap = poolHeap;
+            }
+
+            allocation.size = allocInfo.SizeInBytes;
+            ++allocation.poolHeap->numAllocations;
+        }
+
+        Heap* heap = checked_cast<Heap*>(allocation.poolHeap->heap.Get());
+
+        const HRESULT hr = m_Context.device->CreatePlacedResource(
+            heap->heap, allocation.offset,
+            &resourceDesc,
+            initialState,
+            pClearValue,
+            IID_PPV_ARGS(&outResource));
+
+        if (FAILED(hr))
+        {
+            // Not an error: the caller falls back to a committed resource
+            release(allocation);
+            return false;
+        }
+
+        outAllocation = allocation;
+        return true;
+    }
+
+    void PlacedResourcePool::release(Allocation& allocation)
+    {
+        if (!allocation.poolHeap)
+            return;
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        PoolHeap* poolHeap = allocation.poolHeap;
+        poolHeap->ranges.release(allocation.offset, allocation.size);
+        --poolHeap->numAllocations;
+
+        // Release empty heaps, but keep one per bucket to avoid re-creating it for the next resource
+        auto& bucket = m_Buckets[poolHeap->bucketIndex];
+        if (poolHeap->numAllocations == 0 && bucket.size() > 1)
+        {
+            bucket.erase(std::find_if(bucket.begin(), bucket.end(),
+                [poolHeap](const std::unique_ptr<PoolHeap>& h) { return h.get() == poolHeap; }));
+        }
+
+        allocation = Allocation();
+    }
+
+    void PlacedResourcePool::getStatistics(std::vector<PlacedResourceHeapStatistics>& outStatistics)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        outStatistics.clear();
+
+        for (const auto& bucket : m_Buckets)
+        {
+            for (const auto& poolHeap : bucket)
+            {
+                PlacedResourceHeapStatistics stats;
+                stats.heap = poolHeap->heap;
+                stats.usedBytes = poolHeap->ranges.getUsedSize();
+                stats.largestFreeRange = poolHeap->ranges.getLargestFreeRange();
+                stats.numAllocations = poolHeap->numAllocations;
+                stats.numFreeRanges = uint32_t(poolHeap->ranges.getNumFreeRanges());
+                outStatistics.push_back(stats);
+            }
+        }
+    }
+
+    void Device::getPlacedResourceHeapStatistics(std::vector<PlacedResourceHeapStatistics>& outStatistics)
+    {
+        m_Resources.placedResourcePool.getStatistics(outStatistics);
+    }
+
+} // namespace nvrhi::d3d12
@@ -24,6 +24,8 @@
 
 #include <nvrhi/common/misc.h>
 
+#include <algorithm>
+
 namespace nvrhi::d3d12
 {
     TimerQuery::~TimerQuery()
@@ -78,7 +80,7 @@ namespace nvrhi::d3d12
 
         assert(query->fence);
 
-        WaitForFence(query->fence, query->fenceCounter, m_FenceEvent);
+        waitForQueueFence(query->fence, query->fenceCounter);
     }
 
     void Device::resetEventQuery(IEventQuery* _query)
@@ -153,7 +155,7 @@ namespace nvrhi::d3d12
         {
             if (query->fence)
             {
-                WaitForFence(query->fence, query->fenceCounter, m_FenceEvent);
+                waitForQueueFence(query->fence, query->fenceCounter);
                 query->fence = nullptr;
             }
 
@@ -220,4 +222,449 @@ namespace nvrhi::d3d12
     }
 
 
+    static_assert(sizeof(PipelineStatistics) == sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS),
+        "PipelineStatistics must match D3D12_QUERY_DATA_PIPELINE_STATISTICS");
+
+    OcclusionQuery::~OcclusionQuery()
+    {
+        m_Resources.occlusionQueries.release(static_cast<int>(queryIndex));
+    }
+
+    PipelineStatisticsQuery::~PipelineStatisticsQuery()
+    {
+        m_Resources.pipelineStatisticsQueries.release(static_cast<int>(queryIndex));
+    }
+
+    OcclusionQueryHandle Device::createOcclusionQuery(const OcclusionQueryDesc& desc)
+    {
+        if (!m_Context.occlusionQueryHeap)
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            if (!m_Context.occlusionQueryHeap)
+            {
+                D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+                queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_OCCLUSION;
+                queryHeapDesc.Count = uint32_t(m_Resources.occlusionQueries.getCapacity());
+                m_Context.device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_Context.occlusionQueryHeap));
+
+                BufferDesc qbDesc;
+                qbDesc.byteSize = queryHeapDesc.Count * sizeof(uint64_t);
+                qbDesc.cpuAccess = CpuAccessMode::Read;
+
+                BufferHandle resolveBuffer = createBuffer(qbDesc);
+                m_Context.occlusionQueryResolveBuffer = checked_cast<Buffer*>(resolveBuffer.Get());
+            }
+        }
+
+        int queryIndex = m_Resources.occlusionQueries.allocate();
+
+        if (queryIndex < 0)
+        {
+            m_Context.error("Insufficient occlusion query heap space, increase DeviceDesc::maxOcclusionQueries");
+            return nullptr;
+        }
+
+        OcclusionQuery* query = new OcclusionQuery(m_Resources);
+        query->desc = desc;
+        query->queryIndex = uint32_t(queryIndex);
+
+        return OcclusionQueryHandle::Create(query);
+    }
+
+    bool Device::pollOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        if (!query->started)
+            return false;
+
+        if (!query->fence)
+            return true;
+
+        if (query->fence->GetCompletedValue() >= query->fenceCounter)
+        {
+            query->fence = nullptr;
+            return true;
+        }
+
+        return false;
+    }
+
+    uint64_t Device::getOcclusionQueryResult(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        if (!query->started)
+            return 0;
+
+        if (!query->resolved)
+        {
+            if (query->fence)
+            {
+                waitForQueueFence(query->fence, query->fenceCounter);
+                query->fence = nullptr;
+            }
+
+            D3D12_RANGE bufferReadRange = {
+                query->queryIndex * sizeof(uint64_t),
+                (query->queryIndex + 1) * sizeof(uint64_t) };
+            uint64_t *data;
+            const HRESULT res = m_Context.occlusionQueryResolveBuffer->resource->Map(0, &bufferReadRange, (void**)&data);
+
+            if (FAILED(res))
+            {
+                m_Context.error("getOcclusionQueryResult: Map() failed");
+                return 0;
+            }
+
+            query->resolved = true;
+            query->result = data[query->queryIndex];
+
+            m_Context.occlusionQueryResolveBuffer->resource->Unmap(0, nullptr);
+        }
+
+        return query->result;
+    }
+
+    void Device::resetOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        query->started = false;
+        query->resolved = false;
+        query->result = 0;
+        query->fence = nullptr;
+    }
+
+    PipelineStatisticsQueryHandle Device::createPipelineStatisticsQuery()
+    {
+        if (!m_Context.pipelineStatisticsQueryHeap)
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            if (!m_Context.pipelineStatisticsQueryHeap)
+            {
+                D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+                queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+                queryHeapDesc.Count = uint32_t(m_Resources.pipelineStatisticsQueries.getCapacity());
+                m_Context.device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_Context.pipelineStatisticsQueryHeap));
+
+                BufferDesc qbDesc;
+                qbDesc.byteSize = queryHeapDesc.Count * sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS);
+                qbDesc.cpuAccess = CpuAccessMode::Read;
+
+                BufferHandle resolveBuffer = createBuffer(qbDesc);
+                m_Context.pipelineStatisticsQueryResolveBuffer = checked_cast<Buffer*>(resolveBuffer.Get());
+            }
+        }
+
+        int queryIndex = m_Resources.pipelineStatisticsQueries.allocate();
+
+        if (queryIndex < 0)
+        {
+            m_Context.error("Insufficient pipeline statistics query heap space, increase DeviceDesc::maxPipelineStatisticsQueries");
+            return nullptr;
+        }
+
+        PipelineStatisticsQuery* query = new PipelineStatisticsQuery(m_Resources);
+        query->queryIndex = uint32_t(queryIndex);
+
+        return PipelineStatisticsQueryHandle::Create(query);
+    }
+
+    bool Device::pollPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        if (!query->started)
+            return false;
+
+        if (!query->fence)
+            return true;
+
+        if (query->fence->GetCompletedValue() >= query->fenceCounter)
+        {
+            query->fence = nullptr;
+            return true;
+        }
+
+        return false;
+    }
+
+    PipelineStatistics Device::getPipelineStatistics(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        if (!query->started)
+            return PipelineStatistics();
+
+        if (!query->resolved)
+        {
+            if (query->fence)
+            {
+                waitForQueueFence(query->fence, query->fenceCounter);
+                query->fence = nullptr;
+            }
+
+            constexpr size_t stride = sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS);
+            D3D12_RANGE bufferReadRange = {
+                query->queryIndex * stride,
+                (query->queryIndex + 1) * stride };
+            uint8_t *data;
+            const HRESULT res = m_Context.pipelineStatisticsQueryResolveBuffer->resource->Map(0, &bufferReadRange, (void**)&data);
+
+            if (FAILED(res))
+            {
+                m_Context.error("getPipelineStatistics: Map() failed");
+                return PipelineStatistics();
+            }
+
+            query->resolved = true;
+            memcpy(&query->result, data + query->queryIndex * stride, stride);
+
+            m_Context.pipelineStatisticsQueryResolveBuffer->resource->Unmap(0, nullptr);
+        }
+
+        return query->result;
+    }
+
+    void Device::resetPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        query->started = false;
+        query->resolved = false;
+        query->result = PipelineStatistics();
+        query->fence = nullptr;
+    }
+
+    void CommandList::beginOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        m_Instance->referencedOcclusionQueries.push_back(query);
+
+        m_ActiveCommandList->commandList->BeginQuery(m_Context.occlusionQueryHeap, query->getQueryType(), query->queryIndex);
+    }
+
+    void CommandList::endOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        m_Instance->referencedOcclusionQueries.push_back(query);
+
+        m_ActiveCommandList->commandList->EndQuery(m_Context.occlusionQueryHeap, query->getQueryType(), query->queryIndex);
+
+        m_PendingOcclusionResolves.push_back(query);
+    }
+
+    void CommandList::beginPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        m_Instance->referencedPipelineStatisticsQueries.push_back(query);
+
+        m_ActiveCommandList->commandList->BeginQuery(m_Context.pipelineStatisticsQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query->queryIndex);
+    }
+
+    void CommandList::endPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        m_Instance->referencedPipelineStatisticsQueries.push_back(query);
+
+        m_ActiveCommandList->commandList->EndQuery(m_Context.pipelineStatisticsQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query->queryIndex);
+
+        m_PendingPipelineStatisticsResolves.push_back(query->queryIndex);
+    }
+
+    void CommandList::resolvePendingQueries()
+    {
+        // Resolve runs of consecutive query indices of the same type with one ResolveQueryData call each.
+        // The pending queries are referenced by the instance, so the raw pointers are valid here.
+
+        if (!m_PendingOcclusionResolves.empty())
+        {
+            std::vector<OcclusionQuery*>& pending = m_PendingOcclusionResolves;
+            std::sort(pending.begin(), pending.end(),
+                [](const OcclusionQuery* a, const OcclusionQuery* b) { return a->queryIndex < b->queryIndex; });
+            pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+            size_t runStart = 0;
+            for (size_t i = 1; i <= pending.size(); ++i)
+            {
+                const OcclusionQuery* first = pending[runStart];
+
+                if (i < pending.size() && pending[i]->queryIndex == pending[i - 1]->queryIndex + 1
+                    && pending[i]->getQueryType() == first->getQueryType())
+                    continue;
+
+                m_ActiveCommandList->commandList->ResolveQueryData(m_Context.occlusionQueryHeap,
+                    first->getQueryType(),
+                    first->queryIndex,
+                    uint32_t(i - runStart),
+                    m_Context.occlusionQueryResolveBuffer->resource,
+                    first->queryIndex * sizeof(uint64_t));
+
+                runStart = i;
+            }
+
+            pending.clear();
+        }
+
+        if (!m_PendingPipelineStatisticsResolves.empty())
+        {
+            std::vector<uint32_t>& indices = m_PendingPipelineStatisticsResolves;
+            std::sort(indices.begin(), indices.end());
+            indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+            size_t runStart = 0;
+            for (size_t i = 1; i <= indices.size(); ++i)
+            {
+                if (i < indices.size() && indices[i] == indices[i - 1] + 1)
+                    continue;
+
+                m_ActiveCommandList->commandList->ResolveQueryData(m_Context.pipelineStatisticsQueryHeap,
+                    D3D12_QUERY_TYPE_PIPELINE_STATISTICS,
+                    indices[runStart],
+                    uint32_t(i - runStart),
+                    m_Context.pipelineStatisticsQueryResolveBuffer->resource,
+                    indices[runStart] * sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS));
+
+                runStart = i;
+            }
+
+            indices.clear();
+        }
+    }
+
+    void CommandList::resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* _buffer, uint64_t offsetBytes)
+    {
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireBufferState(buffer, ResourceStates::CopyDest);
+        }
+        commitBarriers();
+
+        m_Instance->referencedResources.push_back(buffer);
+        for (size_t i = 0; i < numQueries; ++i)
+            m_Instance->referencedResources.push_back(queries[i]);
+
+        // Consecutive queries that also occupy consecutive heap slots are resolved with one call
+        size_t runStart = 0;
+        for (size_t i = 1; i <= numQueries; ++i)
+        {
+            const OcclusionQuery* first = checked_cast<OcclusionQuery*>(queries[runStart]);
+
+            if (i < numQueries)
+            {
+                const OcclusionQuery* prev = checked_cast<OcclusionQuery*>(queries[i - 1]);
+                const OcclusionQuery* current = checked_cast<OcclusionQuery*>(queries[i]);
+
+                if (current->queryIndex == prev->queryIndex + 1 && current->getQueryType() == first->getQueryType())
+                    continue;
+            }
+
+            m_ActiveCommandList->commandList->ResolveQueryData(m_Context.occlusionQueryHeap,
+                first->getQueryType(),
+                first->queryIndex,
+                uint32_t(i - runStart),
+                buffer->resource,
+                offsetBytes + runStart * sizeof(uint64_t));
+
+            runStart = i;
+        }
+    }
+
+    void CommandList::setPredication(IBuffer* _buffer, uint64_t offsetBytes, PredicationOp op)
+    {
+        if (!_buffer)
+        {
+            m_ActiveCommandList->commandList->SetPredication(nullptr, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+            return;
+        }
+
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireBufferState(buffer, ResourceStates::Predication);
+        }
+        commitBarriers();
+
+        m_Instance->referencedResources.push_back(buffer);
+
+        // D3D12 skips the commands when the predicate matches the op, e.g. EQUAL_ZERO skips them when the value is zero
+        m_ActiveCommandList->commandList->SetPredication(buffer->resource, offsetBytes,
+            (op == PredicationOp::SkipIfZero) ? D3D12_PREDICATION_OP_EQUAL_ZERO : D3D12_PREDICATION_OP_NOT_EQUAL_ZERO);
+    }
+
+    GpuProfilerHandle Device::createGpuProfiler(const GpuProfilerDesc& desc)
+    {
+        Queue* queue = getQueue(desc.queue);
+
+        if (desc.queue == CommandQueue::Copy || !queue)
+        {
+            m_Context.error("GPU profiler can only be created for an existing graphics or compute queue");
+            return nullptr;
+        }
+
+        GpuProfiler* profiler = new GpuProfiler(this, queue->queue, desc);
+        GpuProfilerHandle handle = GpuProfilerHandle::Create(profiler);
+
+        D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+        queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        queryHeapDesc.Count = profiler->getTotalQueryCount();
+        const HRESULT res = m_Context.device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&profiler->queryHeap));
+
+        if (FAILED(res) || !profiler->initialize())
+        {
+            m_Context.error("Failed to create the GPU profiler resources");
+            return nullptr;
+        }
+
+        return handle;
+    }
+
+    void GpuProfiler::recordTimestamp(nvrhi::ICommandList* commandList, uint32_t queryIndex)
+    {
+        ID3D12GraphicsCommandList* d3dCommandList = commandList->getNativeObject(ObjectTypes::D3D12_GraphicsCommandList);
+
+        d3dCommandList->EndQuery(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, queryIndex);
+    }
+
+    void GpuProfiler::recordResolve(nvrhi::ICommandList* commandList, uint32_t firstQuery, uint32_t numQueries, IBuffer* buffer, uint64_t bufferOffset)
+    {
+        ID3D12GraphicsCommandList* d3dCommandList = commandList->getNativeObject(ObjectTypes::D3D12_GraphicsCommandList);
+
+        // The readback buffer is owned by the profiler and stays in COPY_DEST, so it's not tracked by the command list.
+        // Tracking it would also make mapBuffer wait for the latest frame instead of the one being read.
+        d3dCommandList->ResolveQueryData(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, numQueries,
+            checked_cast<Buffer*>(buffer)->resource, bufferOffset);
+    }
+
+    double GpuProfiler::getTimestampPeriod()
+    {
+        uint64_t frequency = 0;
+        m_Queue->GetTimestampFrequency(&frequency);
+
+        return frequency ? 1.0 / double(frequency) : 0.0;
+    }
+
+    bool GpuProfiler::getClockCalibration(uint64_t& outGpuTimestamp, double& outCpuSeconds)
+    {
+        uint64_t cpuTimestamp = 0;
+        if (FAILED(m_Queue->GetClockCalibration(&outGpuTimestamp, &cpuTimestamp)))
+            return false;
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+
+        outCpuSeconds = double(cpuTimestamp) / double(frequency.QuadPart);
+        return true;
+    }
+
 } // namespace nvrhi::d3d12
@@ -220,6 +220,26 @@ namespace nvrhi::d3d12
             uint32_t(callableShaders.size());
     }
 
+    const ShaderTable::Entry* ShaderTable::getEntryForRecord(uint32_t recordIndex) const
+    {
+        if (recordIndex == 0)
+            return &rayGenerationShader;
+        recordIndex -= 1;
+
+        if (recordIndex < missShaders.size())
+            return &missShaders[recordIndex];
+        recordIndex -= uint32_t(missShaders.size());
+
+        if (recordIndex < hitGroups.size())
+            return &hitGroups[recordIndex];
+        recordIndex -= uint32_t(hitGroups.size());
+
+        if (recordIndex < callableShaders.size())
+            return &callableShaders[recordIndex];
+
+        return nullptr;
+    }
+
     bool ShaderTable::verifyExport(const RayTracingPipeline::ExportTableEntry* pExport, IBindingSet* bindings) const
     {
         if (!pExport)
@@ -258,7 +278,7 @@ namespace nvrhi::d3d12
             rayGenerationShader.pShaderIdentifier = pipelineExport->pShaderIdentifier;
             rayGenerationShader.localBindings = bindings;
 
-            ++version;
+            dirtyRecords.push_back(0);
         }
     }
 
@@ -319,6 +339,45 @@ namespace nvrhi::d3d12
         return -1;
     }
 
+    bool ShaderTable::setRecord(std::vector<Entry>& records, uint32_t firstRecord, int index, const char* exportName, IBindingSet* bindings)
+    {
+        if (index < 0 || size_t(index) >= records.size())
+        {
+            std::stringstream ss;
+            ss << "Shader table record index " << index << " is out of range, the table has " << records.size() << " records of this type";
+            m_Context.error(ss.str());
+            return false;
+        }
+
+        const RayTracingPipeline::ExportTableEntry* pipelineExport = pipeline->getExport(exportName);
+
+        if (!verifyExport(pipelineExport, bindings))
+            return false;
+
+        Entry& entry = records[index];
+        entry.pShaderIdentifier = pipelineExport->pShaderIdentifier;
+        entry.localBindings = bindings;
+
+        dirtyRecords.push_back(firstRecord + uint32_t(index));
+
+        return true;
+    }
+
+    bool ShaderTable::setMissShader(int index, const char* exportName, IBindingSet* bindings /*= nullptr*/)
+    {
+        return setRecord(missShaders, 1, index, exportName, bindings);
+    }
+
+    bool ShaderTable::setHitGroup(int index, const char* exportName, IBindingSet* bindings /*= nullptr*/)
+    {
+        return setRecord(hitGroups, 1 + uint32_t(missShaders.size()), index, exportName, bindings);
+    }
+
+    bool ShaderTable::setCallableShader(int index, const char* exportName, IBindingSet* bindings /*= nullptr*/)
+    {
+        return setRecord(callableShaders, 1 + uint32_t(missShaders.size() + hitGroups.size()), index, exportName, bindings);
+    }
+
     void ShaderTable::clearMissShaders()
     {
         missShaders.clear();
@@ -356,6 +415,12 @@ namespace nvrhi::d3d12
 
     rt::ShaderTableHandle RayTracingPipeline::createShaderTable()
     { 
+        if (desc.isLibrary)
+        {
+            m_Context.error("Cannot create a shader table for a ray tracing pipeline library");
+            return nullptr;
+        }
+
         return rt::ShaderTableHandle::Create(new ShaderTable(m_Context, this));
     }
 
@@ -732,10 +797,29 @@ namespace nvrhi::d3d12
     
     rt::PipelineHandle Device::createRayTracingPipeline(const rt::PipelineDesc& desc)
     {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createRayTracingPipeline", "Pipeline");
+
+        for (const rt::PipelineHandle& library : desc.libraries)
+        {
+            if (!library || !library->getDesc().isLibrary)
+            {
+                m_Context.error("Pipelines linked into a ray tracing pipeline must be created with isLibrary = true");
+                return nullptr;
+            }
+        }
+
         RayTracingPipeline* pso = new RayTracingPipeline(m_Context);
         pso->desc = desc;
         pso->maxLocalRootParameters = 0;
 
+        // Local root signatures of the library exports live in the collections, but the SBT records must fit them too
+
+        for (const rt::PipelineHandle& _library : desc.libraries)
+        {
+            RayTracingPipeline* library = checked_cast<RayTracingPipeline*>(_library.Get());
+            pso->maxLocalRootParameters = std::max(pso->maxLocalRootParameters, library->maxLocalRootParameters);
+        }
+
         // Collect all DXIL libraries that are referenced in `desc`, and enumerate their exports.
         // Build local root signatures for all referenced local binding layouts.
         // Convert the export names to wstring.
@@ -935,14 +1019,44 @@ namespace nvrhi::d3d12
             d3dSubobjects.push_back(d3dSubobject);
         }
 
+        // Subobjects: existing collections, all of their exports are imported
+
+        std::vector<D3D12_EXISTING_COLLECTION_DESC> d3dCollections;
+        d3dCollections.reserve(desc.libraries.size());
+
+        for (const rt::PipelineHandle& _library : desc.libraries)
+        {
+            RayTracingPipeline* library = checked_cast<RayTracingPipeline*>(_library.Get());
+
+            D3D12_EXISTING_COLLECTION_DESC d3dCollectionDesc = {};
+            d3dCollectionDesc.pExistingCollection = library->pipelineState;
+            d3dCollections.push_back(d3dCollectionDesc);
+
+            d3dSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_EXISTING_COLLECTION;
+            d3dSubobject.pDesc = &d3dCollections[d3dCollections.size() - 1];
+            d3dSubobjects.push_back(d3dSubobject);
+        }
+
         // Subobject: global root signature
 
         D3D12_GLOBAL_ROOT_SIGNATURE d3dGlobalRootSignature = {};
 
         if (!desc.globalBindingLayouts.empty())
         {
-            RootSignatureHandle rootSignature = buildRootSignature(desc.globalBindingLayouts, false, false);
-            pso->globalRootSignature = checked_cast<RootSignature*>(rootSignature.Get());
+            if (!desc.libraries.empty())
+            {
+                // The collections must use the same global root signature as the pipeline they're linked into,
+                // and their binding layouts match this pipeline's, so reuse the root signature object.
+                pso->globalRootSignature = checked_cast<RayTracingPipeline*>(desc.libraries[0].Get())->globalRootSignature;
+            }
+            else
+            {
+                RootSignatureHandle rootSignature = buildRootSignature(desc.globalBindingLayouts, false, false);
+                if (!rootSignature)
+                    return nullptr;
+
+                pso->globalRootSignature = checked_cast<RootSignature*>(rootSignature.Get());
+            }
             d3dGlobalRootSignature.pGlobalRootSignature = pso->globalRootSignature->getNativeObject(ObjectTypes::D3D12_RootSignature);
 
             d3dSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_GLOBAL_ROOT_SIGNATURE;
@@ -1010,7 +1124,7 @@ namespace nvrhi::d3d12
         // Top-level PSO descriptor structure
 
         D3D12_STATE_OBJECT_DESC pipelineDesc = {};
-        pipelineDesc.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
+        pipelineDesc.Type = desc.isLibrary ? D3D12_STATE_OBJECT_TYPE_COLLECTION : D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
         pipelineDesc.NumSubobjects = static_cast<UINT>(d3dSubobjects.size());
         pipelineDesc.pSubobjects = d3dSubobjects.data();
 
@@ -1044,13 +1158,16 @@ namespace nvrhi::d3d12
             return nullptr;
         }
 
+        // Collections don't provide shader identifiers, those are obtained from the pipelines they're linked into.
+        // Still record the exports with their binding layouts so that linking pipelines can enumerate them.
+
         for (const rt::PipelineShaderDesc& shaderDesc : desc.shaders)
         {
             std::string exportName = !shaderDesc.exportName.empty() ? shaderDesc.exportName : shaderDesc.shader->getDesc().entryName;
             std::wstring exportNameW = std::wstring(exportName.begin(), exportName.end());
-            const void* pShaderIdentifier = pso->pipelineInfo->GetShaderIdentifier(exportNameW.c_str());
+            const void* pShaderIdentifier = desc.isLibrary ? nullptr : pso->pipelineInfo->GetShaderIdentifier(exportNameW.c_str());
 
-            if (pShaderIdentifier == nullptr)
+            if (pShaderIdentifier == nullptr && !desc.isLibrary)
             {
                 m_Context.error("Failed to get an identifier for a shader in a fresh DXR PSO");
                 return nullptr;
@@ -1062,9 +1179,9 @@ namespace nvrhi::d3d12
         for(const rt::PipelineHitGroupDesc& hitGroupDesc : desc.hitGroups)
         { 
             std::wstring exportNameW = std::wstring(hitGroupDesc.exportName.begin(), hitGroupDesc.exportName.end());
-            const void* pShaderIdentifier = pso->pipelineInfo->GetShaderIdentifier(exportNameW.c_str());
+            const void* pShaderIdentifier = desc.isLibrary ? nullptr : pso->pipelineInfo->GetShaderIdentifier(exportNameW.c_str());
 
-            if (pShaderIdentifier == nullptr)
+            if (pShaderIdentifier == nullptr && !desc.isLibrary)
             {
                 m_Context.error("Failed to get an identifier for a hit group in a fresh DXR PSO");
                 return nullptr;
@@ -1073,6 +1190,25 @@ namespace nvrhi::d3d12
             pso->exports[hitGroupDesc.exportName] = RayTracingPipeline::ExportTableEntry{ hitGroupDesc.bindingLayout, pShaderIdentifier };
         }
 
+        for (const rt::PipelineHandle& _library : desc.libraries)
+        {
+            RayTracingPipeline* library = checked_cast<RayTracingPipeline*>(_library.Get());
+
+            for (const auto& [exportName, libraryExport] : library->exports)
+            {
+                std::wstring exportNameW = std::wstring(exportName.begin(), exportName.end());
+                const void* pShaderIdentifier = desc.isLibrary ? nullptr : pso->pipelineInfo->GetShaderIdentifier(exportNameW.c_str());
+
+                if (pShaderIdentifier == nullptr && !desc.isLibrary)
+                {
+                    m_Context.error("Failed to get an identifier for a library export in a fresh DXR PSO");
+                    return nullptr;
+                }
+
+                pso->exports[exportName] = RayTracingPipeline::ExportTableEntry{ libraryExport.bindingLayout, pShaderIdentifier };
+            }
+        }
+
         return rt::PipelineHandle::Create(pso);
     }
 
@@ -1081,76 +1217,31 @@ namespace nvrhi::d3d12
         ShaderTable* shaderTable = checked_cast<ShaderTable*>(state.shaderTable);
         RayTracingPipeline* pso = shaderTable->pipeline;
 
+        if (!commitShaderTable(shaderTable))
+            return;
+
         ShaderTableState* shaderTableState = getShaderTableStateTracking(shaderTable);
 
-        bool rebuildShaderTable = shaderTableState->committedVersion != shaderTable->version ||
-            shaderTableState->descriptorHeapSRV != m_Resources.shaderResourceViewHeap.getShaderVisibleHeap() ||
-            shaderTableState->descriptorHeapSamplers != m_Resources.samplerHeap.getShaderVisibleHeap();
+        // Rebuild the dispatch template if the table layout has changed or the table has moved to a new buffer
 
-        if (rebuildShaderTable)
+        if (shaderTableState->committedVersion != shaderTable->version || shaderTableState->buffer != shaderTable->buffer.Get())
         {
-            uint32_t entrySize = pso->getShaderTableEntrySize();
-            uint32_t sbtSize = shaderTable->getNumEntries() * entrySize;
-
-            unsigned char* cpuVA;
-            D3D12_GPU_VIRTUAL_ADDRESS gpuVA;
-            if (!m_UploadManager.suballocateBuffer(sbtSize, nullptr, nullptr, nullptr, 
-                (void**)&cpuVA, &gpuVA, m_RecordingVersion, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT))
-            {
-                m_Context.error("Couldn't suballocate an upload buffer");
-                return;
-            }
-
-            uint32_t entryIndex = 0;
-
-            auto writeEntry = [this, entrySize, &cpuVA, &gpuVA, &entryIndex](const ShaderTable::Entry& entry) 
-            {
-                memcpy(cpuVA, entry.pShaderIdentifier, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-
-                if (entry.localBindings)
-                {
-                    d3d12::BindingSet* bindingSet = checked_cast<d3d12::BindingSet*>(entry.localBindings.Get());
-                    d3d12::BindingLayout* layout = bindingSet->layout;
-
-                    if (layout->descriptorTableSizeSamplers > 0)
-                    {
-                        auto pTable = reinterpret_cast<D3D12_GPU_DESCRIPTOR_HANDLE*>(cpuVA + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + layout->rootParameterSamplers * sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
-                        *pTable = m_Resources.samplerHeap.getGpuHandle(bindingSet->descriptorTableSamplers);
-                    }
-
-                    if (layout->descriptorTableSizeSRVetc > 0)
-                    {
-                        auto pTable = reinterpret_cast<D3D12_GPU_DESCRIPTOR_HANDLE*>(cpuVA + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + layout->rootParameterSRVetc * sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
-                        *pTable = m_Resources.shaderResourceViewHeap.getGpuHandle(bindingSet->descriptorTableSRVetc);
-                    }
-
-                    if (!layout->rootParametersVolatileCB.empty())
-                    {
-                        m_Context.error("Cannot use Volatile CBs in a shader binding table");
-                        return;
-                    }
-                }
-
-                cpuVA += entrySize;
-                gpuVA += entrySize;
-                entryIndex += 1;
-            };
+            const uint32_t entrySize = pso->getShaderTableEntrySize();
+            D3D12_GPU_VIRTUAL_ADDRESS gpuVA = checked_cast<Buffer*>(shaderTable->buffer.Get())->gpuVA;
 
             D3D12_DISPATCH_RAYS_DESC& drd = shaderTableState->dispatchRaysTemplate;
             memset(&drd, 0, sizeof(D3D12_DISPATCH_RAYS_DESC));
 
             drd.RayGenerationShaderRecord.StartAddress = gpuVA;
             drd.RayGenerationShaderRecord.SizeInBytes = entrySize;
-            writeEntry(shaderTable->rayGenerationShader);
+            gpuVA += entrySize;
             
             if (!shaderTable->missShaders.empty())
             {
                 drd.MissShaderTable.StartAddress = gpuVA;
                 drd.MissShaderTable.StrideInBytes = (shaderTable->missShaders.size() == 1) ? 0 : entrySize;
                 drd.MissShaderTable.SizeInBytes = uint32_t(shaderTable->missShaders.size()) * entrySize;
-
-                for (auto& entry : shaderTable->missShaders)
-                    writeEntry(entry);
+                gpuVA += drd.MissShaderTable.SizeInBytes;
             }
 
             if (!shaderTable->hitGroups.empty())
@@ -1158,9 +1249,7 @@ namespace nvrhi::d3d12
                 drd.HitGroupTable.StartAddress = gpuVA;
                 drd.HitGroupTable.StrideInBytes = (shaderTable->hitGroups.size() == 1) ? 0 : entrySize;
                 drd.HitGroupTable.SizeInBytes = uint32_t(shaderTable->hitGroups.size()) * entrySize;
-
-                for (auto& entry : shaderTable->hitGroups)
-                    writeEntry(entry);
+                gpuVA += drd.HitGroupTable.SizeInBytes;
             }
 
             if (!shaderTable->callableShaders.empty())
@@ -1168,19 +1257,18 @@ namespace nvrhi::d3d12
                 drd.CallableShaderTable.StartAddress = gpuVA;
                 drd.CallableShaderTable.StrideInBytes = (shaderTable->callableShaders.size() == 1) ? 0 : entrySize;
                 drd.CallableShaderTable.SizeInBytes = uint32_t(shaderTable->callableShaders.size()) * entrySize;
-
-                for (auto& entry : shaderTable->callableShaders)
-                    writeEntry(entry);
             }
 
             shaderTableState->committedVersion = shaderTable->version;
-            shaderTableState->descriptorHeapSRV = m_Resources.shaderResourceViewHeap.getShaderVisibleHeap();
-            shaderTableState->descriptorHeapSamplers = m_Resources.samplerHeap.getShaderVisibleHeap();
+            shaderTableState->buffer = shaderTable->buffer.Get();
 
-            // AddRef the shaderTable only on the first use / build because build happens at least once per CL anyway
+            // AddRef the shaderTable and its buffer only when the template changes because that happens at least once per CL anyway
             m_Instance->referencedResources.push_back(shaderTable);
+            m_Instance->referencedResources.push_back(shaderTable->buffer.Get());
         }
 
+        requireBufferState(shaderTable->buffer, ResourceStates::ShaderResource);
+
         const bool updateRootSignature = !m_CurrentRayTracingStateValid || m_CurrentRayTracingState.shaderTable == nullptr ||
             checked_cast<ShaderTable*>(m_CurrentRayTracingState.shaderTable)->pipeline->globalRootSignature != pso->globalRootSignature;
 
@@ -1196,6 +1284,9 @@ namespace nvrhi::d3d12
         if (bindingUpdateMask == 0)
             bindingUpdateMask = arrayDifferenceMask(m_CurrentRayTracingState.bindings, state.bindings);
 
+        if (m_Desc.enableStatistics)
+            countStateChanges(m_Statistics, { updatePipeline, bindingUpdateMask != 0 });
+
         if (updateRootSignature)
         {   
             m_ActiveCommandList->commandList4->SetComputeRootSignature(pso->globalRootSignature->handle);
@@ -1220,6 +1311,131 @@ namespace nvrhi::d3d12
         commitBarriers();
     }
 
+    bool CommandList::commitShaderTable(ShaderTable* shaderTable)
+    {
+        RayTracingPipeline* pso = shaderTable->pipeline;
+
+        const uint32_t entrySize = pso->getShaderTableEntrySize();
+        const uint32_t numEntries = shaderTable->getNumEntries();
+        const uint64_t shaderTableSize = uint64_t(numEntries) * entrySize;
+
+        ID3D12DescriptorHeap* descriptorHeapSRV = m_Resources.shaderResourceViewHeap.getShaderVisibleHeap();
+        ID3D12DescriptorHeap* descriptorHeapSamplers = m_Resources.samplerHeap.getShaderVisibleHeap();
+
+        std::lock_guard lockGuard(shaderTable->mutex);
+
+        // The records contain GPU descriptor handles, so they have to be rewritten when the heaps are reallocated
+        bool fullRewrite = shaderTable->bufferVersion != shaderTable->version ||
+            shaderTable->descriptorHeapSRV != descriptorHeapSRV ||
+            shaderTable->descriptorHeapSamplers != descriptorHeapSamplers;
+
+        // (Re)create the device-local table if it doesn't fit the current layout. Leave some room for growth
+        // so that adding a few records doesn't reallocate the buffer every time.
+
+        if (!shaderTable->buffer || shaderTable->buffer->getDesc().byteSize < shaderTableSize)
+        {
+            BufferDesc bufferDesc;
+            bufferDesc.byteSize = align(shaderTableSize + shaderTableSize / 2, uint64_t(D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT));
+            bufferDesc.debugName = "ShaderTable";
+            bufferDesc.isShaderBindingTable = true;
+            bufferDesc.initialState = ResourceStates::ShaderResource;
+            bufferDesc.keepInitialState = true;
+
+            shaderTable->buffer = m_Device->createBuffer(bufferDesc);
+
+            if (!shaderTable->buffer)
+            {
+                m_Context.error("Failed to create a buffer for the shader table");
+                return false;
+            }
+
+            fullRewrite = true;
+        }
+
+        if (!fullRewrite && shaderTable->dirtyRecords.empty())
+            return true;
+
+        std::vector<uint8_t> recordData;
+        bool success = true;
+
+        auto writeRecords = [this, shaderTable, entrySize, &recordData, &success](uint32_t firstRecord, uint32_t numRecords)
+        {
+            recordData.assign(size_t(numRecords) * entrySize, 0);
+
+            for (uint32_t i = 0; i < numRecords; i++)
+            {
+                const ShaderTable::Entry* entry = shaderTable->getEntryForRecord(firstRecord + i);
+                if (!entry || !entry->pShaderIdentifier)
+                    continue;
+
+                uint8_t* cpuVA = recordData.data() + size_t(i) * entrySize;
+                memcpy(cpuVA, entry->pShaderIdentifier, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+
+                if (entry->localBindings)
+                {
+                    d3d12::BindingSet* bindingSet = checked_cast<d3d12::BindingSet*>(entry->localBindings.Get());
+                    d3d12::BindingLayout* layout = bindingSet->layout;
+
+                    if (layout->descriptorTableSizeSamplers > 0)
+                    {
+                        auto pTable = reinterpret_cast<D3D12_GPU_DESCRIPTOR_HANDLE*>(cpuVA + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + layout->rootParameterSamplers * sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
+                        *pTable = m_Resources.samplerHeap.getGpuHandle(bindingSet->descriptorTableSamplers);
+                    }
+
+                    if (layout->descriptorTableSizeSRVetc > 0)
+                    {
+                        auto pTable = reinterpret_cast<D3D12_GPU_DESCRIPTOR_HANDLE*>(cpuVA + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + layout->rootParameterSRVetc * sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
+                        *pTable = m_Resources.shaderResourceViewHeap.getGpuHandle(bindingSet->descriptorTableSRVetc);
+                    }
+
+                    if (!layout->rootParametersVolatileCB.empty() || !layout->rootParametersPromotedCB.empty())
+                    {
+                        m_Context.error("Cannot use Volatile CBs in a shader binding table");
+                        success = false;
+                        return;
+                    }
+                }
+            }
+
+            requireBufferState(shaderTable->buffer, ResourceStates::CopyDest);
+            writeBuffer(shaderTable->buffer, recordData.data(), recordData.size(), uint64_t(firstRecord) * entrySize);
+        };
+
+        if (fullRewrite)
+        {
+            writeRecords(0, numEntries);
+        }
+        else
+        {
+            // Patch the modified records, merging adjacent ones into a single write
+
+            std::vector<uint32_t>& dirtyRecords = shaderTable->dirtyRecords;
+            std::sort(dirtyRecords.begin(), dirtyRecords.end());
+            dirtyRecords.erase(std::unique(dirtyRecords.begin(), dirtyRecords.end()), dirtyRecords.end());
+
+            size_t rangeStart = 0;
+            while (rangeStart < dirtyRecords.size() && dirtyRecords[rangeStart] < numEntries)
+            {
+                size_t rangeEnd = rangeStart + 1;
+                while (rangeEnd < dirtyRecords.size() && dirtyRecords[rangeEnd] == dirtyRecords[rangeEnd - 1] + 1 && dirtyRecords[rangeEnd] < numEntries)
+                    ++rangeEnd;
+
+                writeRecords(dirtyRecords[rangeStart], uint32_t(rangeEnd - rangeStart));
+                rangeStart = rangeEnd;
+            }
+        }
+
+        if (!success)
+            return false;
+
+        shaderTable->dirtyRecords.clear();
+        shaderTable->bufferVersion = shaderTable->version;
+        shaderTable->descriptorHeapSRV = descriptorHeapSRV;
+        shaderTable->descriptorHeapSamplers = descriptorHeapSamplers;
+
+        return true;
+    }
+
     void CommandList::dispatchRays(const rt::DispatchRaysArguments& args)
     {
         updateComputeVolatileBuffers();
@@ -1237,6 +1453,7 @@ namespace nvrhi::d3d12
         desc.Height = args.height;
         desc.Depth = args.depth;
 
+        countDispatches(1);
         m_ActiveCommandList->commandList4->DispatchRays(&desc);
     }
 
@@ -1308,186 +1525,365 @@ namespace nvrhi::d3d12
 #endif
     }
 
-    void CommandList::buildBottomLevelAccelStruct(rt::IAccelStruct* _as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags)
+    void CommandList::buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags)
     {
-        AccelStruct* as = checked_cast<AccelStruct*>(_as);
+        rt::BottomLevelAccelStructBuild build;
+        build.accelStruct = as;
+        build.geometries = pGeometries;
+        build.numGeometries = numGeometries;
+        build.buildFlags = buildFlags;
 
-        const bool performUpdate = (buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
-        if (performUpdate)
-        {
-            assert(as->allowUpdate);
-        }
+        buildBottomLevelAccelStructs(&build, 1);
+    }
+
+    void CommandList::buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds)
+    {
+        if (numBuilds == 0)
+            return;
+
+        // The inputs hold pointers into their own geometry arrays, so this vector must not be reallocated
+        std::vector<D3D12BuildRaytracingAccelerationStructureInputs> buildInputs(numBuilds);
+        std::vector<uint64_t> scratchSizes(numBuilds, 0);
+        std::vector<bool> buildValid(numBuilds, true);
 
-        for (uint32_t i = 0; i < numGeometries; i++)
+        for (size_t buildIndex = 0; buildIndex < numBuilds; buildIndex++)
         {
-            const auto& geometryDesc = pGeometries[i];
-            if (geometryDesc.geometryType == rt::GeometryType::Triangles)
-            {
-                const auto& triangles = geometryDesc.geometryData.triangles;
+            const rt::BottomLevelAccelStructBuild& build = builds[buildIndex];
+            AccelStruct* as = checked_cast<AccelStruct*>(build.accelStruct);
 
-                OpacityMicromap* om = triangles.opacityMicromap ? checked_cast<OpacityMicromap*>(triangles.opacityMicromap) : nullptr;
+            const bool performUpdate = (build.buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
+            if (performUpdate)
+            {
+                assert(as->allowUpdate);
+            }
 
-                if (m_EnableAutomaticBarriers)
+            for (uint32_t i = 0; i < build.numGeometries; i++)
+            {
+                const auto& geometryDesc = build.geometries[i];
+                if (geometryDesc.geometryType == rt::GeometryType::Triangles)
                 {
-                    requireBufferState(triangles.indexBuffer, ResourceStates::AccelStructBuildInput);
-                    requireBufferState(triangles.vertexBuffer, ResourceStates::AccelStructBuildInput);
-                    if (om)
-                        requireBufferState(om->dataBuffer, ResourceStates::AccelStructBuildInput);
+                    const auto& triangles = geometryDesc.geometryData.triangles;
+
+                    OpacityMicromap* om = triangles.opacityMicromap ? checked_cast<OpacityMicromap*>(triangles.opacityMicromap) : nullptr;
+
+                    if (m_EnableAutomaticBarriers)
+                    {
+                        requireBufferState(triangles.indexBuffer, ResourceStates::AccelStructBuildInput);
+                        requireBufferState(triangles.vertexBuffer, ResourceStates::AccelStructBuildInput);
+                        if (om)
+                            requireBufferState(om->dataBuffer, ResourceStates::AccelStructBuildInput);
+                        if (triangles.ommIndexBuffer)
+                            requireBufferState(triangles.ommIndexBuffer, ResourceStates::AccelStructBuildInput);
+                    }
+
+                    m_Instance->referencedResources.push_back(triangles.indexBuffer);
+                    m_Instance->referencedResources.push_back(triangles.vertexBuffer);
+                    if (om && om->desc.trackLiveness)
+                        m_Instance->referencedResources.push_back(om);
                     if (triangles.ommIndexBuffer)
-                        requireBufferState(triangles.ommIndexBuffer, ResourceStates::AccelStructBuildInput);
+                        m_Instance->referencedResources.push_back(triangles.ommIndexBuffer);
                 }
+                else
+                {
+                    const auto& aabbs = geometryDesc.geometryData.aabbs;
 
-                m_Instance->referencedResources.push_back(triangles.indexBuffer);
-                m_Instance->referencedResources.push_back(triangles.vertexBuffer);
-                if (om && om->desc.trackLiveness)
-                    m_Instance->referencedResources.push_back(om);
-                if (triangles.ommIndexBuffer)
-                    m_Instance->referencedResources.push_back(triangles.ommIndexBuffer);
+                    if (m_EnableAutomaticBarriers)
+                    {
+                        requireBufferState(aabbs.buffer, ResourceStates::AccelStructBuildInput);
+                    }
+
+                    m_Instance->referencedResources.push_back(aabbs.buffer);
+                }
             }
+
+            D3D12BuildRaytracingAccelerationStructureInputs& inputs = buildInputs[buildIndex];
+            inputs.SetType(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL);
+            if (as->allowUpdate)
+                inputs.SetFlags((D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS)build.buildFlags | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE);
             else
+                inputs.SetFlags((D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS)build.buildFlags);
+
+            inputs.SetGeometryDescCount((UINT)build.numGeometries);
+            for (uint32_t i = 0; i < build.numGeometries; i++)
             {
-                const auto& aabbs = geometryDesc.geometryData.aabbs;
+                const auto& geometryDesc = build.geometries[i];
 
-                if (m_EnableAutomaticBarriers)
+                D3D12_GPU_VIRTUAL_ADDRESS gpuVA = 0;
+                if (geometryDesc.useTransform)
                 {
-                    requireBufferState(aabbs.buffer, ResourceStates::AccelStructBuildInput);
+                    void* cpuVA = nullptr;
+                    if (!m_UploadManager.suballocateBuffer(sizeof(rt::AffineTransform), nullptr, nullptr, nullptr,
+                        &cpuVA, &gpuVA, m_RecordingVersion, D3D12_RAYTRACING_TRANSFORM3X4_BYTE_ALIGNMENT))
+                    {
+                        m_Context.error("Couldn't suballocate an upload buffer");
+                        return;
+                    }
+
+                    memcpy(cpuVA, &geometryDesc.transform, sizeof(rt::AffineTransform));
                 }
 
-                m_Instance->referencedResources.push_back(aabbs.buffer);
+                D3D12RaytracingGeometryDesc& geomDesc = inputs.GetGeometryDesc(i);
+                fillD3dGeometryDesc(geomDesc, geometryDesc, gpuVA);
             }
-        }
-
-        commitBarriers();
 
-        D3D12BuildRaytracingAccelerationStructureInputs inputs;
-        inputs.SetType(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL);
-        if (as->allowUpdate)
-            inputs.SetFlags((D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS)buildFlags | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE);
-        else
-            inputs.SetFlags((D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS)buildFlags);
+#ifndef NVRHI_WITH_RTXMU
+            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
 
-        inputs.SetGeometryDescCount((UINT)numGeometries);
-        for (uint32_t i = 0; i < numGeometries; i++)
-        {
-            const auto& geometryDesc = pGeometries[i];
+            if (!checked_cast<d3d12::Device*>(m_Device)->GetAccelStructPreBuildInfo(ASPreBuildInfo, as->getDesc()))
+            {
+                buildValid[buildIndex] = false;
+                continue;
+            }
 
-            D3D12_GPU_VIRTUAL_ADDRESS gpuVA = 0;
-            if (geometryDesc.useTransform)
+            if (as->compacted && !performUpdate)
             {
-                void* cpuVA = nullptr;
-                if (!m_UploadManager.suballocateBuffer(sizeof(rt::AffineTransform), nullptr, nullptr, nullptr,
-                    &cpuVA, &gpuVA, m_RecordingVersion, D3D12_RAYTRACING_TRANSFORM3X4_BYTE_ALIGNMENT))
+                // A full rebuild can need more than the compacted storage, go back to storage of the original size.
+                // The compacted storage is kept alive until this command list completes.
+                BufferDesc bufferDesc = as->dataBuffer->desc;
+                bufferDesc.byteSize = ASPreBuildInfo.ResultDataMaxSizeInBytes;
+                BufferHandle uncompactedBuffer = m_Device->createBuffer(bufferDesc);
+
+                if (uncompactedBuffer)
                 {
-                    m_Context.error("Couldn't suballocate an upload buffer");
-                    return;
+                    m_Instance->referencedResources.push_back(as->dataBuffer);
+                    as->dataBuffer = checked_cast<Buffer*>(uncompactedBuffer.Get());
+                    as->compacted = false;
+                    as->compactionSavings.reset();
                 }
+            }
 
-                memcpy(cpuVA, &geometryDesc.transform, sizeof(rt::AffineTransform));
+            if (ASPreBuildInfo.ResultDataMaxSizeInBytes > as->dataBuffer->desc.byteSize)
+            {
+                std::stringstream ss;
+                ss << "BLAS " << utils::DebugNameToString(as->desc.debugName) << " build requires at least "
+                    << ASPreBuildInfo.ResultDataMaxSizeInBytes << " bytes in the data buffer, while the allocated buffer is only "
+                    << as->dataBuffer->desc.byteSize << " bytes";
+
+                m_Context.error(ss.str());
+                buildValid[buildIndex] = false;
+                continue;
             }
 
-            D3D12RaytracingGeometryDesc& geomDesc = inputs.GetGeometryDesc(i);
-            fillD3dGeometryDesc(geomDesc, geometryDesc, gpuVA);
+            scratchSizes[buildIndex] = performUpdate
+                ? ASPreBuildInfo.UpdateScratchDataSizeInBytes
+                : ASPreBuildInfo.ScratchDataSizeInBytes;
+
+            if (m_EnableAutomaticBarriers)
+            {
+                requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
+            }
+#endif
         }
 
-#ifdef NVRHI_WITH_RTXMU
-        std::vector<uint64_t> accelStructsToBuild;
-        std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> buildInputs;
-        buildInputs.push_back(inputs.GetAs<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS>());
+        // All state transitions for the batch are committed at once
+        commitBarriers();
 
-        if(as->rtxmuId == ~0ull)
+#ifdef NVRHI_WITH_RTXMU
+        // RTXMU manages the scratch memory by itself, pass the builds to it one by one
+        for (size_t buildIndex = 0; buildIndex < numBuilds; buildIndex++)
         {
-            m_Context.rtxMemUtil->PopulateBuildCommandList(m_ActiveCommandList->commandList4.Get(),
-                                                           buildInputs.data(),
-                                                           buildInputs.size(),
-                                                           accelStructsToBuild);
+            AccelStruct* as = checked_cast<AccelStruct*>(builds[buildIndex].accelStruct);
 
-            as->rtxmuId = accelStructsToBuild[0];
+            std::vector<uint64_t> accelStructsToBuild;
+            std::vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> rtxmuInputs;
+            rtxmuInputs.push_back(buildInputs[buildIndex].GetAs<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS>());
 
-            as->rtxmuGpuVA = m_Context.rtxMemUtil->GetAccelStructGPUVA(as->rtxmuId);
+            if(as->rtxmuId == ~0ull)
+            {
+                m_Context.rtxMemUtil->PopulateBuildCommandList(m_ActiveCommandList->commandList4.Get(),
+                                                               rtxmuInputs.data(),
+                                                               rtxmuInputs.size(),
+                                                               accelStructsToBuild);
 
-            m_Instance->rtxmuBuildIds.push_back(as->rtxmuId);
+                as->rtxmuId = accelStructsToBuild[0];
 
-        }
-        else
-        {
-            std::vector<uint64_t> buildsToUpdate(1, as->rtxmuId);
+                as->rtxmuGpuVA = m_Context.rtxMemUtil->GetAccelStructGPUVA(as->rtxmuId);
+
+                m_Instance->rtxmuBuildIds.push_back(as->rtxmuId);
 
-            m_Context.rtxMemUtil->PopulateUpdateCommandList(m_ActiveCommandList->commandList4.Get(),
-                                                            buildInputs.data(),
-                                                            uint32_t(buildInputs.size()),
-                                                            buildsToUpdate);
+            }
+            else
+            {
+                std::vector<uint64_t> buildsToUpdate(1, as->rtxmuId);
+
+                m_Context.rtxMemUtil->PopulateUpdateCommandList(m_ActiveCommandList->commandList4.Get(),
+                                                                rtxmuInputs.data(),
+                                                                uint32_t(rtxmuInputs.size()),
+                                                                buildsToUpdate);
+            }
         }
 #else
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
+        const uint64_t scratchAlignment = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT;
+        const uint64_t batchScratchLimit = std::max<uint64_t>(m_Desc.scratchBatchSize, scratchAlignment);
 
-        if (!checked_cast<d3d12::Device*>(m_Device)->GetAccelStructPreBuildInfo(ASPreBuildInfo, as->getDesc()))
-            return;
-
-        if (ASPreBuildInfo.ResultDataMaxSizeInBytes > as->dataBuffer->desc.byteSize)
+        size_t buildIndex = 0;
+        while (buildIndex < numBuilds)
         {
-            std::stringstream ss;
-            ss << "BLAS " << utils::DebugNameToString(as->desc.debugName) << " build requires at least "
-                << ASPreBuildInfo.ResultDataMaxSizeInBytes << " bytes in the data buffer, while the allocated buffer is only "
-                << as->dataBuffer->desc.byteSize << " bytes";
+            // Collect the builds that fit into the scratch limit, but always take at least one build
+            size_t batchEnd = buildIndex;
+            uint64_t batchScratchSize = 0;
+            while (batchEnd < numBuilds)
+            {
+                uint64_t newScratchSize = align(batchScratchSize, scratchAlignment) + scratchSizes[batchEnd];
+                if (newScratchSize > batchScratchLimit && batchEnd > buildIndex)
+                    break;
 
-            m_Context.error(ss.str());
-            return;
+                if (buildValid[batchEnd])
+                    batchScratchSize = newScratchSize;
+                ++batchEnd;
+            }
+
+            D3D12_GPU_VIRTUAL_ADDRESS scratchGpuVA = 0;
+            if (batchScratchSize > 0)
+            {
+                if (!m_DxrScratchManager.suballocateBuffer(batchScratchSize, m_ActiveCommandList->commandList, nullptr, nullptr, nullptr,
+                    &scratchGpuVA, m_RecordingVersion, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT))
+                {
+                    std::stringstream ss;
+                    ss << "Couldn't suballocate a scratch buffer for " << (batchEnd - buildIndex) << " BLAS build(s) starting with "
+                        << utils::DebugNameToString(builds[buildIndex].accelStruct->getDesc().debugName) << ". "
+                        "The builds require " << batchScratchSize << " bytes of scratch space.";
+
+                    m_Context.error(ss.str());
+                    buildIndex = batchEnd;
+                    continue;
+                }
+            }
+
+            // The builds in one batch use disjoint scratch ranges, so they are recorded back to back without barriers
+            uint64_t batchScratchOffset = 0;
+            for (size_t index = buildIndex; index < batchEnd; index++)
+            {
+                if (!buildValid[index])
+                    continue;
+
+                AccelStruct* as = checked_cast<AccelStruct*>(builds[index].accelStruct);
+                const bool performUpdate = (builds[index].buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
+
+                batchScratchOffset = align(batchScratchOffset, scratchAlignment);
+                const D3D12_GPU_VIRTUAL_ADDRESS buildScratchGpuVA = scratchSizes[index] ? scratchGpuVA + batchScratchOffset : 0;
+                batchScratchOffset += scratchSizes[index];
+
+#if NVRHI_WITH_NVAPI_OPACITY_MICROMAP
+                if (checked_cast<d3d12::Device*>(m_Device)->GetNvapiIsInitialized())
+                {
+                    NVAPI_D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC_EX buildDesc = {};
+                    buildDesc.inputs = buildInputs[index].GetAs<NVAPI_D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS_EX>();
+                    buildDesc.scratchAccelerationStructureData = buildScratchGpuVA;
+                    buildDesc.destAccelerationStructureData = as->dataBuffer->gpuVA;
+                    buildDesc.sourceAccelerationStructureData = performUpdate ? as->dataBuffer->gpuVA : 0;
+
+                    NVAPI_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_EX_PARAMS params = {};
+                    params.version = NVAPI_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_EX_PARAMS_VER;
+                    params.pDesc = &buildDesc;
+                    params.numPostbuildInfoDescs = 0;
+                    params.pPostbuildInfoDescs = nullptr;
+                    [[maybe_unused]] NvAPI_Status status = NvAPI_D3D12_BuildRaytracingAccelerationStructureEx(m_ActiveCommandList->commandList4, &params);
+                    assert(status == S_OK);
+                }
+                else
+#endif
+                {
+                    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+                    buildDesc.Inputs = buildInputs[index].GetAs<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS>();
+                    buildDesc.ScratchAccelerationStructureData = buildScratchGpuVA;
+                    buildDesc.DestAccelerationStructureData = as->dataBuffer->gpuVA;
+                    buildDesc.SourceAccelerationStructureData = performUpdate ? as->dataBuffer->gpuVA : 0;
+                    m_ActiveCommandList->commandList4->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+                }
+            }
+
+            buildIndex = batchEnd;
         }
 
-        uint64_t scratchSize = performUpdate
-            ? ASPreBuildInfo.UpdateScratchDataSizeInBytes
-            : ASPreBuildInfo.ScratchDataSizeInBytes;
+        writeCompactedSizes(builds, numBuilds, buildValid);
+#endif // NVRHI_WITH_RTXMU
 
-        D3D12_GPU_VIRTUAL_ADDRESS scratchGpuVA = 0;
-        if (!m_DxrScratchManager.suballocateBuffer(scratchSize, m_ActiveCommandList->commandList, nullptr, nullptr, nullptr,
-            &scratchGpuVA, m_RecordingVersion, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT))
+        for (size_t index = 0; index < numBuilds; index++)
         {
-            std::stringstream ss;
-            ss << "Couldn't suballocate a scratch buffer for BLAS " << utils::DebugNameToString(as->desc.debugName) << " build. "
-                "The build requires " << scratchSize << " bytes of scratch space.";
-
-            m_Context.error(ss.str());
-            return;
+            if (builds[index].accelStruct->getDesc().trackLiveness)
+                m_Instance->referencedResources.push_back(builds[index].accelStruct);
         }
+    }
 
-        if (m_EnableAutomaticBarriers)
+#ifndef NVRHI_WITH_RTXMU
+    void CommandList::writeCompactedSizes(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds, const std::vector<bool>& buildValid)
+    {
+        std::vector<AccelStruct*> compactable;
+        std::vector<D3D12_GPU_VIRTUAL_ADDRESS> compactableAddresses;
+
+        for (size_t index = 0; index < numBuilds; index++)
         {
-            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
+            AccelStruct* as = checked_cast<AccelStruct*>(builds[index].accelStruct);
+            const bool performUpdate = (builds[index].buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
+            const bool allowCompaction = (as->desc.buildFlags & rt::AccelStructBuildFlags::AllowCompaction) != 0;
+
+            if (!buildValid[index] || !allowCompaction || as->desc.isVirtual || as->compacted || performUpdate)
+                continue;
+
+            compactable.push_back(as);
+            compactableAddresses.push_back(as->dataBuffer->gpuVA);
         }
+
+        if (compactable.empty())
+            return;
+
+        const uint64_t sizesByteSize = compactable.size() * sizeof(uint64_t);
+
+        BufferDesc sizeBufferDesc;
+        sizeBufferDesc.byteSize = sizesByteSize;
+        sizeBufferDesc.canHaveUAVs = true;
+        sizeBufferDesc.initialState = ResourceStates::UnorderedAccess;
+        sizeBufferDesc.keepInitialState = true;
+        sizeBufferDesc.debugName = "BLAS compacted sizes";
+        BufferHandle sizeBuffer = m_Device->createBuffer(sizeBufferDesc);
+
+        BufferDesc readbackBufferDesc;
+        readbackBufferDesc.byteSize = sizesByteSize;
+        readbackBufferDesc.cpuAccess = CpuAccessMode::Read;
+        readbackBufferDesc.initialState = ResourceStates::CopyDest;
+        readbackBufferDesc.keepInitialState = true;
+        readbackBufferDesc.debugName = "BLAS compacted sizes readback";
+        BufferHandle readbackBuffer = m_Device->createBuffer(readbackBufferDesc);
+
+        if (!sizeBuffer || !readbackBuffer)
+            return;
+
+        Buffer* sizeBufferImpl = checked_cast<Buffer*>(sizeBuffer.Get());
+        Buffer* readbackBufferImpl = checked_cast<Buffer*>(readbackBuffer.Get());
+
+        // The builds must finish before their sizes are written. These buffers are internal,
+        // so the barriers are placed even when automatic barriers are disabled.
+        for (AccelStruct* as : compactable)
+            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructBuildBlas);
+        requireBufferState(sizeBufferImpl, ResourceStates::UnorderedAccess);
         commitBarriers();
 
-#if NVRHI_WITH_NVAPI_OPACITY_MICROMAP
-        if (checked_cast<d3d12::Device*>(m_Device)->GetNvapiIsInitialized())
-        {
-            NVAPI_D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC_EX buildDesc = {};
-            buildDesc.inputs = inputs.GetAs<NVAPI_D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS_EX>();
-            buildDesc.scratchAccelerationStructureData = scratchGpuVA;
-            buildDesc.destAccelerationStructureData = as->dataBuffer->gpuVA;
-            buildDesc.sourceAccelerationStructureData = performUpdate ? as->dataBuffer->gpuVA : 0;
-
-            NVAPI_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_EX_PARAMS params = {};
-            params.version = NVAPI_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_EX_PARAMS_VER;
-            params.pDesc = &buildDesc;
-            params.numPostbuildInfoDescs = 0;
-            params.pPostbuildInfoDescs = nullptr;
-            [[maybe_unused]] NvAPI_Status status = NvAPI_D3D12_BuildRaytracingAccelerationStructureEx(m_ActiveCommandList->commandList4, &params);
-            assert(status == S_OK);
-        }
-        else
-#endif
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildDesc = {};
+        postbuildDesc.DestBuffer = sizeBufferImpl->gpuVA;
+        postbuildDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+        m_ActiveCommandList->commandList4->EmitRaytracingAccelerationStructurePostbuildInfo(&postbuildDesc,
+            UINT(compactableAddresses.size()), compactableAddresses.data());
+
+        requireBufferState(sizeBufferImpl, ResourceStates::CopySource);
+        requireBufferState(readbackBufferImpl, ResourceStates::CopyDest);
+        commitBarriers();
+
+        m_ActiveCommandList->commandList->CopyBufferRegion(readbackBufferImpl->resource, 0, sizeBufferImpl->resource, 0, sizesByteSize);
+
+        m_Instance->referencedResources.push_back(sizeBuffer);
+        m_Instance->referencedStagingBuffers.push_back(readbackBufferImpl);
+
+        for (size_t index = 0; index < compactable.size(); index++)
         {
-            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
-            buildDesc.Inputs = inputs.GetAs<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS>();
-            buildDesc.ScratchAccelerationStructureData = scratchGpuVA;
-            buildDesc.DestAccelerationStructureData = as->dataBuffer->gpuVA;
-            buildDesc.SourceAccelerationStructureData = performUpdate ? as->dataBuffer->gpuVA : 0;
-            m_ActiveCommandList->commandList4->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
-        }
-#endif // NVRHI_WITH_RTXMU
+            AccelStruct* as = compactable[index];
+            as->compactedSizeBuffer = readbackBufferImpl;
+            as->compactedSizeIndex = uint32_t(index);
 
-        if (as->desc.trackLiveness)
-            m_Instance->referencedResources.push_back(as);
+            m_Instance->compactableBuilds.push_back(as);
+        }
     }
+#endif
 
     void CommandList::compactBottomLevelAccelStructs()
     {
@@ -1506,6 +1902,84 @@ namespace nvrhi::d3d12
                 m_Resources.asBuildsCompleted.clear();
             }
         }
+#else
+        std::vector<rt::AccelStructHandle> completedBuilds;
+        {
+            std::lock_guard lockGuard(m_Resources.asListMutex);
+            completedBuilds.swap(m_Resources.asBuildsCompleted);
+        }
+
+        if (completedBuilds.empty())
+            return;
+
+        struct CompactionCopy
+        {
+            AccelStruct* as;
+            RefCountPtr<Buffer> compactedBuffer;
+            uint64_t originalSize;
+            uint64_t compactedSize;
+        };
+
+        std::vector<CompactionCopy> copies;
+
+        for (const rt::AccelStructHandle& handle : completedBuilds)
+        {
+            AccelStruct* as = checked_cast<AccelStruct*>(handle.Get());
+
+            if (as->compacted || !as->compactedSizeBuffer)
+                continue;
+
+            RefCountPtr<Buffer> sizeBuffer = std::move(as->compactedSizeBuffer);
+
+            const uint64_t* compactedSizes = static_cast<const uint64_t*>(m_Device->mapBuffer(sizeBuffer, CpuAccessMode::Read));
+            if (!compactedSizes)
+                continue;
+
+            const uint64_t compactedSize = compactedSizes[as->compactedSizeIndex];
+            m_Device->unmapBuffer(sizeBuffer);
+
+            const uint64_t originalSize = as->dataBuffer->desc.byteSize;
+            if (compactedSize == 0 || compactedSize >= originalSize)
+                continue;
+
+            BufferDesc bufferDesc = as->dataBuffer->desc;
+            bufferDesc.byteSize = compactedSize;
+            BufferHandle compactedBuffer = m_Device->createBuffer(bufferDesc);
+
+            if (!compactedBuffer)
+                continue;
+
+            Buffer* compactedBufferImpl = checked_cast<Buffer*>(compactedBuffer.Get());
+
+            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructBuildBlas);
+            requireBufferState(compactedBufferImpl, nvrhi::ResourceStates::AccelStructWrite);
+
+            copies.push_back({ as, compactedBufferImpl, originalSize, compactedSize });
+        }
+
+        if (copies.empty())
+            return;
+
+        commitBarriers();
+
+        for (CompactionCopy& copy : copies)
+        {
+            AccelStruct* as = copy.as;
+
+            m_ActiveCommandList->commandList4->CopyRaytracingAccelerationStructure(copy.compactedBuffer->gpuVA,
+                as->dataBuffer->gpuVA, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+
+            // Keep the original storage alive until this command list completes
+            m_Instance->referencedResources.push_back(as->dataBuffer);
+
+            as->dataBuffer = copy.compactedBuffer;
+            as->compacted = true;
+            as->compactionSavings = TrackedAllocation(m_Context.memoryCounters, &InternalMemoryCounters::compactionSavedBytes,
+                copy.originalSize - copy.compactedSize);
+
+            if (as->desc.trackLiveness)
+                m_Instance->referencedResources.push_back(as);
+        }
 #endif
     }
 
@@ -1519,7 +1993,8 @@ namespace nvrhi::d3d12
         if (performUpdate)
         {
             assert(as->allowUpdate);
-            assert(as->dxrInstances.size() == numInstances); // DXR doesn't allow updating to a different instance count
+            // DXR doesn't allow updating to a different instance count. The array is empty when built from a buffer.
+            assert(as->dxrInstances.empty() || as->dxrInstances.size() == numInstances);
         }
 
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS ASInputs;
@@ -1661,4 +2136,85 @@ namespace nvrhi::d3d12
         if (as->desc.trackLiveness)
             m_Instance->referencedResources.push_back(as);
     }
+
+    rt::InstanceDesc* CommandList::beginTopLevelInstanceWrite(rt::IAccelStruct* _as, size_t numInstances)
+    {
+        AccelStruct* as = checked_cast<AccelStruct*>(_as);
+
+        static_assert(sizeof(rt::InstanceDesc) == sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+
+        void* cpuVA = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS gpuVA = 0;
+        size_t uploadSize = sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * std::max<size_t>(numInstances, 1);
+        if (!m_UploadManager.suballocateBuffer(uploadSize, nullptr, nullptr, nullptr, &cpuVA, &gpuVA,
+            m_RecordingVersion, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT))
+        {
+            std::stringstream ss;
+            ss << "Couldn't suballocate an upload buffer for " << numInstances << " instances of TLAS "
+                << utils::DebugNameToString(as->desc.debugName);
+
+            m_Context.error(ss.str());
+            return nullptr;
+        }
+
+        m_PendingInstanceWrite.accelStruct = as;
+        m_PendingInstanceWrite.instanceData = gpuVA;
+        m_PendingInstanceWrite.numInstances = numInstances;
+
+        return static_cast<rt::InstanceDesc*>(cpuVA);
+    }
+
+    void CommandList::commitTopLevelInstanceWrite(rt::IAccelStruct* _as, rt::AccelStructBuildFlags buildFlags, rt::IAccelStruct* const* bottomLevelASes, size_t numBottomLevelASes)
+    {
+        AccelStruct* as = checked_cast<AccelStruct*>(_as);
+
+        if (m_PendingInstanceWrite.accelStruct != as)
+        {
+            std::stringstream ss;
+            ss << "commitTopLevelInstanceWrite called for TLAS " << utils::DebugNameToString(as->desc.debugName)
+                << " without a matching beginTopLevelInstanceWrite";
+
+            m_Context.error(ss.str());
+            return;
+        }
+
+        const PendingInstanceWrite pending = m_PendingInstanceWrite;
+        m_PendingInstanceWrite = PendingInstanceWrite();
+
+        as->bottomLevelASes.clear();
+        as->dxrInstances.clear();
+
+        for (size_t i = 0; i < numBottomLevelASes; i++)
+        {
+            if (!bottomLevelASes[i])
+                continue;
+
+            AccelStruct* blas = checked_cast<AccelStruct*>(bottomLevelASes[i]);
+
+            if (blas->desc.trackLiveness)
+                as->bottomLevelASes.push_back(blas);
+
+#ifndef NVRHI_WITH_RTXMU
+            if (m_EnableAutomaticBarriers)
+            {
+                requireBufferState(blas->dataBuffer, nvrhi::ResourceStates::AccelStructBuildBlas);
+            }
+#endif
+        }
+
+#ifdef NVRHI_WITH_RTXMU
+        m_Context.rtxMemUtil->PopulateUAVBarriersCommandList(m_ActiveCommandList->commandList4, m_Instance->rtxmuBuildIds);
+#endif
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
+        }
+        commitBarriers();
+
+        buildTopLevelAccelStructInternal(as, pending.instanceData, pending.numInstances, buildFlags);
+
+        if (as->desc.trackLiveness)
+            m_Instance->referencedResources.push_back(as);
+    }
 } // namespace nvrhi::d3d12
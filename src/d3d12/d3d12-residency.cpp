@@ -0,0 +1,316 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "d3d12-backend.h"
+
+#include <nvrhi/common/misc.h>
+#include <sstream>
+#include <iomanip>
+
+namespace nvrhi::d3d12
+{
+    static D3D12_RESIDENCY_PRIORITY convertResidencyPriority(ResidencyPriority priority)
+    {
+        switch (priority)
+        {
+        case ResidencyPriority::Minimum: return D3D12_RESIDENCY_PRIORITY_MINIMUM;
+        case ResidencyPriority::Low:     return D3D12_RESIDENCY_PRIORITY_LOW;
+        case ResidencyPriority::Normal:  return D3D12_RESIDENCY_PRIORITY_NORMAL;
+        case ResidencyPriority::High:    return D3D12_RESIDENCY_PRIORITY_HIGH;
+        case ResidencyPriority::Maximum: return D3D12_RESIDENCY_PRIORITY_MAXIMUM;
+        default:
+            utils::InvalidEnum();
+            return D3D12_RESIDENCY_PRIORITY_NORMAL;
+        }
+    }
+
+    ResidencyObject::~ResidencyObject()
+    {
+        if (manager)
+            manager->untrack(*this);
+    }
+
+    ResidencyManager::~ResidencyManager()
+    {
+        // Resources that are still alive must not call back into the destroyed manager
+        for (ResidencyObject* object : m_LRU)
+            object->manager = nullptr;
+    }
+
+    void ResidencyManager::initialize(const DxgiMemoryBudget* budget)
+    {
+        m_Budget = budget;
+
+        // EnqueueMakeResident lets the GPU wait for paging instead of blocking the CPU in MakeResident
+        if (SUCCEEDED(m_Context.device->QueryInterface(IID_PPV_ARGS(&m_Device3))))
+        {
+            const HRESULT hr = m_Context.device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence));
+            if (FAILED(hr))
+                m_Device3 = nullptr;
+        }
+    }
+
+    void ResidencyManager::track(ResidencyObject& object, ID3D12Pageable* pageable, uint64_t size, ResidencyPriority priority)
+    {
+        if (!isEnabled())
+            return;
+
+        assert(!object.manager);
+
+        if (m_Context.device2)
+        {
+            const D3D12_RESIDENCY_PRIORITY d3dPriority = convertResidencyPriority(priority);
+            m_Context.device2->SetResidencyPriority(1, &pageable, &d3dPriority);
+        }
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        object.manager = this;
+        object.pageable = pageable;
+        object.size = size;
+        object.priority = priority;
+        object.resident = true;
+        object.lruPosition = m_LRU.insert(m_LRU.begin(), &object);
+    }
+
+    void ResidencyManager::trackResource(ResidencyObject& object, ID3D12Resource* resource, const D3D12_RESOURCE_DESC& resourceDesc, ResidencyPriority priority)
+    {
+        if (!isEnabled())
+            return;
+
+        const D3D12_RESOURCE_ALLOCATION_INFO allocInfo = m_Context.device->GetResourceAllocationInfo(1, 1, &resourceDesc);
+        track(object, resource, allocInfo.SizeInBytes, priority);
+    }
+
+    void ResidencyManager::untrack(ResidencyObject& object)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        m_LRU.erase(object.lruPosition);
+        object.manager = nullptr;
+        object.pageable = nullptr;
+    }
+
+    void ResidencyManager::collectReferencedObjects(const CommandListInstance& instance)
+    {
+        for (const auto& resource : instance.referencedResources)
+        {
+            if (auto source = dynamic_cast<ResidencySource*>(resource.Get()))
+                source->getResidencyObjects(m_ReferencedObjects);
+        }
+
+        for (BindingSet* bindingSet : instance.untrackedBindingSets)
+        {
+            bindingSet->getResidencyObjects(m_ReferencedObjects);
+        }
+
+        for (const auto& bundle : instance.referencedBundles)
+        {
+            collectReferencedObjects(*bundle);
+        }
+    }
+
+    void ResidencyManager::prepareSubmission(ICommandList* const* commandLists, size_t numCommandLists, CommandQueue queueType,
+        uint64_t submittedInstance, const std::array<std::unique_ptr<Queue>, (int)CommandQueue::Count>& queues)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        ++m_SubmissionIndex;
+
+        m_ReferencedObjects.clear();
+        for (size_t i = 0; i < numCommandLists; i++)
+        {
+            collectReferencedObjects(*checked_cast<CommandList*>(commandLists[i])->getInstance());
+        }
+
+        m_PageablesToMakeResident.clear();
+        uint64_t bytesToMakeResident = 0;
+
+        for (ResidencyObject* object : m_ReferencedObjects)
+        {
+            if (object->lastUseSubmission == m_SubmissionIndex)
+                continue;
+
+            object->lastUseSubmission = m_SubmissionIndex;
+            object->lastUseInstances[uint32_t(queueType)] = submittedInstance;
+            m_LRU.splice(m_LRU.begin(), m_LRU, object->lruPosition);
+
+            if (!object->resident)
+            {
+                m_PageablesToMakeResident.push_back(object->pageable);
+                bytesToMakeResident += object->size;
+                object->resident = true;
+            }
+        }
+
+        MemoryStatistics statistics;
+        m_Budget->queryHeaps(statistics);
+
+        for (const MemoryHeapStatistics& heap : statistics.heaps)
+        {
+            if (!heap.deviceLocal)
+                continue;
+
+            if (heap.usage + bytesToMakeResident > heap.budget)
+                evict(heap.usage + bytesToMakeResident - heap.budget, queues);
+        }
+
+        if (m_PageablesToMakeResident.empty())
+            return;
+
+        HRESULT hr;
+        if (m_Device3)
+        {
+            ++m_FenceValue;
+            hr = m_Device3->EnqueueMakeResident(D3D12_RESIDENCY_FLAG_NONE, uint32_t(m_PageablesToMakeResident.size()),
+                m_PageablesToMakeResident.data(), m_Fence, m_FenceValue);
+
+            if (SUCCEEDED(hr))
+                queues[int(queueType)]->wait(m_Fence, m_FenceValue);
+        }
+        else
+        {
+            hr = m_Context.device->MakeResident(uint32_t(m_PageablesToMakeResident.size()), m_PageablesToMakeResident.data());
+        }
+
+        if (FAILED(hr))
+        {
+            std::stringstream ss;
+            ss << "Failed to make " << m_PageablesToMakeResident.size() << " objects resident, HRESULT = 0x"
+                << std::hex << std::setw(8) << hr;
+            m_Context.error(ss.str());
+        }
+    }
+
+    void ResidencyManager::evict(uint64_t bytesToFree, const std::array<std::unique_ptr<Queue>, (int)CommandQueue::Count>& queues)
+    {
+        uint64_t completedInstances[uint32_t(CommandQueue::Count)] = {};
+        for (uint32_t queueIndex = 0; queueIndex < uint32_t(CommandQueue::Count); ++queueIndex)
+        {
+            if (queues[queueIndex])
+                completedInstances[queueIndex] = queues[queueIndex]->updateLastCompletedInstance();
+        }
+
+        m_PageablesToEvict.clear();
+        uint64_t bytesFreed = 0;
+
+        // Evict the least recently used objects with the lowest priority first, skipping the ones that
+        // the GPU may still be using and the ones that are needed by the current submission.
+        for (uint32_t priority = uint32_t(ResidencyPriority::Minimum); priority < uint32_t(ResidencyPriority::Maximum) && bytesFreed < bytesToFree; ++priority)
+        {
+            for (auto it = m_LRU.rbegin(); it != m_LRU.rend() && bytesFreed < bytesToFree; ++it)
+            {
+                ResidencyObject* object = *it;
+
+                if (!object->resident || uint32_t(object->priority) != priority || object->lastUseSubmission == m_SubmissionIndex)
+                    continue;
+
+                bool idle = true;
+                for (uint32_t queueIndex = 0; queueIndex < uint32_t(CommandQueue::Count); ++queueIndex)
+                {
+                    if (object->lastUseInstances[queueIndex] > completedInstances[queueIndex])
+                        idle = false;
+                }
+
+                if (!idle)
+                    continue;
+
+                m_PageablesToEvict.push_back(object->pageable);
+                bytesFreed += object->size;
+                object->resident = false;
+            }
+        }
+
+        if (!m_PageablesToEvict.empty())
+        {
+            const HRESULT hr = m_Context.device->Evict(uint32_t(m_PageablesToEvict.size()), m_PageablesToEvict.data());
+            if (FAILED(hr))
+            {
+                std::stringstream ss;
+                ss << "Failed to evict " << m_PageablesToEvict.size() << " objects, HRESULT = 0x"
+                    << std::hex << std::setw(8) << hr;
+                m_Context.error(ss.str());
+            }
+        }
+    }
+
+    void Heap::getResidencyObjects(std::vector<ResidencyObject*>& objects)
+    {
+        if (residency.manager)
+            objects.push_back(&residency);
+    }
+
+    void Buffer::getResidencyObjects(std::vector<ResidencyObject*>& objects)
+    {
+        if (residency.manager)
+            objects.push_back(&residency);
+        else if (heap)
+            checked_cast<Heap*>(heap.Get())->getResidencyObjects(objects);
+        else if (placedAllocation.poolHeap)
+            checked_cast<Heap*>(placedAllocation.poolHeap->heap.Get())->getResidencyObjects(objects);
+    }
+
+    void Texture::getResidencyObjects(std::vector<ResidencyObject*>& objects)
+    {
+        for (const auto& tileHeap : tileMappingHeaps)
+            checked_cast<Heap*>(tileHeap.Get())->getResidencyObjects(objects);
+
+        if (residency.manager)
+            objects.push_back(&residency);
+        else if (heap)
+            checked_cast<Heap*>(heap.Get())->getResidencyObjects(objects);
+        else if (placedAllocation.poolHeap)
+            checked_cast<Heap*>(placedAllocation.poolHeap->heap.Get())->getResidencyObjects(objects);
+    }
+
+    void BindingSet::getResidencyObjects(std::vector<ResidencyObject*>& objects)
+    {
+        for (const auto& resource : resources)
+        {
+            if (auto source = dynamic_cast<ResidencySource*>(resource.Get()))
+                source->getResidencyObjects(objects);
+        }
+
+        // Without liveness tracking, the resources are not in the list above,
+        // and the application guarantees that the ones in the description are alive
+        if (!desc.trackLiveness)
+        {
+            for (const BindingSetItem& item : desc.bindings)
+            {
+                if (auto source = dynamic_cast<ResidencySource*>(item.resourceHandle))
+                    source->getResidencyObjects(objects);
+            }
+        }
+    }
+
+    void AccelStruct::getResidencyObjects(std::vector<ResidencyObject*>& objects)
+    {
+        if (dataBuffer)
+            dataBuffer->getResidencyObjects(objects);
+
+        // Instances of a TLAS reference the BLAS memory directly
+        for (const auto& blas : bottomLevelASes)
+            checked_cast<AccelStruct*>(blas.Get())->getResidencyObjects(objects);
+    }
+
+} // namespace nvrhi::d3d12
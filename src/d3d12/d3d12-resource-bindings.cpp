@@ -21,10 +21,12 @@
 */
 
 #include "d3d12-backend.h"
+#include "../common/pipeline-cache.h"
 
 #include <nvrhi/common/misc.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 namespace nvrhi::d3d12
 {
@@ -93,9 +95,31 @@ namespace nvrhi::d3d12
             rootParametersVolatileCB.push_back(std::make_pair(rootParameterIndex, foundBuffer));
         }
 
+        // Same for the volatile constant buffers that are promoted to root constants
+        for (const std::pair<RootParameterIndex, D3D12_ROOT_CONSTANTS>& parameter : layout->rootParametersPromotedCB)
+        {
+            IBuffer* foundBuffer = nullptr;
+
+            for (const auto& binding : desc.bindings)
+            {
+                if (binding.type == ResourceType::VolatileConstantBuffer && binding.slot == parameter.second.ShaderRegister)
+                {
+                    Buffer* buffer = checked_cast<Buffer*>(binding.resourceHandle);
+                    resources.push_back(buffer);
+
+                    foundBuffer = buffer;
+                    break;
+                }
+            }
+
+            rootParametersPromotedCB.push_back(std::make_pair(parameter.first, foundBuffer));
+        }
+
         if (layout->descriptorTableSizeSamplers > 0)
         {
-            DescriptorIndex descriptorTableBaseIndex = m_Resources.samplerHeap.allocateDescriptors(layout->descriptorTableSizeSamplers);
+            DescriptorIndex descriptorTableBaseIndex = transient
+                ? descriptorTableSamplers
+                : m_Resources.samplerHeap.allocateDescriptors(layout->descriptorTableSizeSamplers);
             descriptorTableSamplers = descriptorTableBaseIndex;
             rootParameterIndexSamplers = layout->rootParameterSamplers;
             descriptorTableValidSamplers = true;
@@ -136,7 +160,9 @@ namespace nvrhi::d3d12
 
         if (layout->descriptorTableSizeSRVetc > 0)
         {
-            DescriptorIndex descriptorTableBaseIndex = m_Resources.shaderResourceViewHeap.allocateDescriptors(layout->descriptorTableSizeSRVetc);
+            DescriptorIndex descriptorTableBaseIndex = transient
+                ? descriptorTableSRVetc
+                : m_Resources.shaderResourceViewHeap.allocateDescriptors(layout->descriptorTableSizeSRVetc);
             descriptorTableSRVetc = descriptorTableBaseIndex;
             rootParameterIndexSRVetc = layout->rootParameterSRVetc;
             descriptorTableValidSRVetc = true;
@@ -335,7 +361,12 @@ namespace nvrhi::d3d12
         return BindingLayoutHandle::Create(ret);
     }
 
-    BindingSetHandle Device::createBindingSet(const BindingSetDesc& desc, IBindingLayout* _layout)
+    BindingSetHandle Device::createBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+    {
+        return m_ObjectCache.getBindingSet(desc, layout, [this, &desc, layout] { return createBindingSetInternal(desc, layout); });
+    }
+
+    BindingSetHandle Device::createBindingSetInternal(const BindingSetDesc& desc, IBindingLayout* _layout)
     {
         BindingSet *ret = new BindingSet(m_Context, m_Resources);
         ret->desc = desc;
@@ -348,19 +379,88 @@ namespace nvrhi::d3d12
         return BindingSetHandle::Create(ret);
     }
 
-    DescriptorTableHandle Device::createDescriptorTable(IBindingLayout* layout)
+    DescriptorIndex CommandList::allocateTransientDescriptors(StaticDescriptorHeap& heap, RefCountPtr<TransientDescriptorChunk>& chunk,
+        uint32_t count, uint32_t chunkSize)
     {
-        (void)layout; // not necessary on DX12
+        if (!chunk || chunk->numUsed + count > chunk->capacity)
+        {
+            // Start a new chunk. The previous one stays alive as long as the binding sets allocated from it.
+            const uint32_t capacity = std::max(count, chunkSize);
+            const DescriptorIndex baseIndex = heap.allocateDescriptors(capacity);
+            if (baseIndex == c_InvalidDescriptorIndex)
+                return c_InvalidDescriptorIndex;
 
+            chunk = RefCountPtr<TransientDescriptorChunk>::Create(new TransientDescriptorChunk(heap, baseIndex, capacity));
+        }
+
+        const DescriptorIndex index = chunk->baseIndex + chunk->numUsed;
+        chunk->numUsed += count;
+        return index;
+    }
+
+    BindingSetHandle CommandList::createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* _layout)
+    {
+        constexpr uint32_t c_TransientChunkSizeSRVetc = 1024;
+        constexpr uint32_t c_TransientChunkSizeSamplers = 128;
+
+        BindingLayout* layout = checked_cast<BindingLayout*>(_layout);
+
+        BindingSet* ret = new BindingSet(m_Context, m_Resources);
+        ret->desc = desc;
+        ret->layout = layout;
+        ret->transient = true;
+
+        if (layout->descriptorTableSizeSRVetc > 0)
+        {
+            ret->descriptorTableSRVetc = allocateTransientDescriptors(m_Resources.shaderResourceViewHeap, m_TransientChunkSRVetc,
+                layout->descriptorTableSizeSRVetc, c_TransientChunkSizeSRVetc);
+            if (ret->descriptorTableSRVetc == c_InvalidDescriptorIndex)
+            {
+                delete ret;
+                return nullptr;
+            }
+            ret->resources.push_back(m_TransientChunkSRVetc);
+        }
+
+        if (layout->descriptorTableSizeSamplers > 0)
+        {
+            ret->descriptorTableSamplers = allocateTransientDescriptors(m_Resources.samplerHeap, m_TransientChunkSamplers,
+                layout->descriptorTableSizeSamplers, c_TransientChunkSizeSamplers);
+            if (ret->descriptorTableSamplers == c_InvalidDescriptorIndex)
+            {
+                delete ret;
+                return nullptr;
+            }
+            ret->resources.push_back(m_TransientChunkSamplers);
+        }
+
+        ret->createDescriptors();
+
+        return BindingSetHandle::Create(ret);
+    }
+
+    DescriptorTableHandle Device::createDescriptorTable(IBindingLayout* layout)
+    {
         DescriptorTable* ret = new DescriptorTable(m_Resources);
+        ret->layout = layout;
         ret->capacity = 0;
         ret->firstDescriptor = 0;
+
+        const BindlessLayoutDesc* bindlessDesc = layout ? layout->getBindlessDesc() : nullptr;
+        if (bindlessDesc && bindlessDesc->reserveMaxCapacity && bindlessDesc->maxCapacity > 0)
+        {
+            ret->firstDescriptor = m_Resources.shaderResourceViewHeap.allocateDescriptors(bindlessDesc->maxCapacity);
+            ret->reservedCapacity = bindlessDesc->maxCapacity;
+        }
         
         return DescriptorTableHandle::Create(ret);
     }
 
     BindingSet::~BindingSet()
     {
+        if (transient)
+            return; // the descriptors are released with their chunks
+
         m_Resources.shaderResourceViewHeap.releaseDescriptors(descriptorTableSRVetc, layout->descriptorTableSizeSRVetc);
     
         m_Resources.samplerHeap.releaseDescriptors(descriptorTableSamplers, layout->descriptorTableSizeSamplers);
@@ -368,7 +468,7 @@ namespace nvrhi::d3d12
 
     DescriptorTable::~DescriptorTable()
     {
-        m_Resources.shaderResourceViewHeap.releaseDescriptors(firstDescriptor, capacity);
+        m_Resources.shaderResourceViewHeap.releaseDescriptors(firstDescriptor, getNumAllocatedDescriptors());
     }
 
     BindingLayout::BindingLayout(const BindingLayoutDesc& _desc)
@@ -380,9 +480,28 @@ namespace nvrhi::d3d12
 
         D3D12_ROOT_CONSTANTS rootConstants = {};
 
+        // Volatile CBs promoted to root constants share the push constant budget with the push constants
+        uint32_t rootConstantBytes = 0;
         for (const BindingLayoutItem& binding : desc.bindings)
         {
-            if (binding.type == ResourceType::VolatileConstantBuffer)
+            if (binding.type == ResourceType::PushConstants)
+                rootConstantBytes += binding.size;
+        }
+
+        for (const BindingLayoutItem& binding : desc.bindings)
+        {
+            if (binding.type == ResourceType::VolatileConstantBuffer && desc.promoteSmallVolatileConstantBuffers &&
+                binding.size > 0 && (binding.size % 4) == 0 && rootConstantBytes + binding.size <= c_MaxPushConstantSize)
+            {
+                D3D12_ROOT_CONSTANTS promotedConstants = {};
+                promotedConstants.ShaderRegister = binding.slot;
+                promotedConstants.RegisterSpace = desc.registerSpace;
+                promotedConstants.Num32BitValues = binding.size / 4;
+
+                rootParametersPromotedCB.push_back(std::make_pair(-1, promotedConstants));
+                rootConstantBytes += binding.size;
+            }
+            else if (binding.type == ResourceType::VolatileConstantBuffer)
             {
                 D3D12_ROOT_DESCRIPTOR1 rootDescriptor;
                 rootDescriptor.ShaderRegister = binding.slot;
@@ -516,6 +635,17 @@ namespace nvrhi::d3d12
             rootParameterPushConstants = RootParameterIndex(rootParameters.size() - 1);
         }
 
+        for (std::pair<RootParameterIndex, D3D12_ROOT_CONSTANTS>& rootParameterPromotedCB : rootParametersPromotedCB)
+        {
+            D3D12_ROOT_PARAMETER1& param = rootParameters.emplace_back();
+
+            param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+            param.ShaderVisibility = convertShaderStage(desc.visibility);
+            param.Constants = rootParameterPromotedCB.second;
+
+            rootParameterPromotedCB.first = RootParameterIndex(rootParameters.size() - 1);
+        }
+
         for (std::pair<RootParameterIndex, D3D12_ROOT_DESCRIPTOR1>& rootParameterVolatileCB : rootParametersVolatileCB)
         {
             rootParameters.resize(rootParameters.size() + 1);
@@ -618,7 +748,7 @@ namespace nvrhi::d3d12
     {
         HRESULT res;
 
-        RootSignature* rootsig = new RootSignature(m_Resources);
+        RefCountPtr<RootSignature> rootsig = RefCountPtr<RootSignature>::Create(new RootSignature());
         
         // Assemble the root parameter table from the pipeline binding layouts
         // Also attach the root parameter offsets to the pipeline layouts
@@ -659,6 +789,40 @@ namespace nvrhi::d3d12
             }
         }
 
+        // Root constants cost one DWORD per value, root descriptors two and descriptor tables one.
+        // The promoted volatile CBs fit into each layout's push constant budget, but the layouts together
+        // may still exceed the limit of a global root signature.
+        if (!isLocal)
+        {
+            uint32_t rootSignatureCost = 0;
+            for (const D3D12_ROOT_PARAMETER1& param : rootParameters)
+            {
+                switch (param.ParameterType)
+                {
+                case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+                    rootSignatureCost += param.Constants.Num32BitValues;
+                    break;
+                case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+                    rootSignatureCost += 1;
+                    break;
+                default:
+                    rootSignatureCost += 2;
+                    break;
+                }
+            }
+
+            if (rootSignatureCost > D3D12_MAX_ROOT_COST)
+            {
+                std::stringstream ss;
+                ss << "The binding layouts of the pipeline need " << rootSignatureCost << " DWORDs of root signature space, "
+                    "which exceeds the limit of " << D3D12_MAX_ROOT_COST << ". Reduce the push constants or the volatile "
+                    "constant buffers promoted to root constants (BindingLayoutDesc::promoteSmallVolatileConstantBuffers).";
+                m_Context.error(ss.str());
+
+                return nullptr;
+            }
+        }
+
         // Build the description structure
 
         D3D12_VERSIONED_ROOT_SIGNATURE_DESC rsDesc = {};
@@ -697,6 +861,8 @@ namespace nvrhi::d3d12
             return nullptr;
         }
 
+        rootsig->serializedHash = hashPipelineCacheData(rsBlob->GetBufferPointer(), rsBlob->GetBufferSize());
+
         // Create the RS object
 
         res = m_Context.device->CreateRootSignature(0, rsBlob->GetBufferPointer(), rsBlob->GetBufferSize(), IID_PPV_ARGS(&rootsig->handle));
@@ -710,7 +876,7 @@ namespace nvrhi::d3d12
             return nullptr;
         }
 
-        return RootSignatureHandle::Create(rootsig);
+        return rootsig;
     }
 
     RefCountPtr<RootSignature> Device::getRootSignature(const static_vector<BindingLayoutHandle, c_MaxBindingLayouts>& pipelineLayouts, bool allowInputLayout)
@@ -721,29 +887,47 @@ namespace nvrhi::d3d12
             hash_combine(hash, pipelineLayout.Get());
         
         hash_combine(hash, allowInputLayout ? 1u : 0u);
+
+        std::lock_guard lockGuard(m_Resources.rootsigCacheMutex);
         
-        // Get a cached RS and AddRef it (if it exists)
-        RefCountPtr<RootSignature> rootsig = m_Resources.rootsigCache[hash];
+        // Get a cached RS (if it exists)
+        const auto it = m_Resources.rootsigCache.find(hash);
+        if (it != m_Resources.rootsigCache.end())
+            return it->second;
 
+        // Does not exist - build a new one and share it with the cache
+        RefCountPtr<RootSignature> rootsig = checked_cast<RootSignature*>(buildRootSignature(pipelineLayouts, allowInputLayout, false).Get());
         if (!rootsig)
-        {
-            // Does not exist - build a new one, take ownership
-            rootsig = checked_cast<RootSignature*>(buildRootSignature(pipelineLayouts, allowInputLayout, false).Get());
-            rootsig->hash = hash;
+            return nullptr;
 
-            m_Resources.rootsigCache[hash] = rootsig;
-        }
+        rootsig->hash = hash;
+
+        m_Resources.rootsigCache[hash] = rootsig;
 
-        // Pass ownership of the RS to caller
         return rootsig;
     }
 
-    RootSignature::~RootSignature()
+    void Device::collectRootSignatureGarbage()
     {
-        // Remove the root signature from the cache
-        const auto it = m_Resources.rootsigCache.find(hash);
-        if (it != m_Resources.rootsigCache.end())
-            m_Resources.rootsigCache.erase(it);
+        std::vector<RefCountPtr<RootSignature>> released;
+        {
+            std::lock_guard lockGuard(m_Resources.rootsigCacheMutex);
+
+            for (auto it = m_Resources.rootsigCache.begin(); it != m_Resources.rootsigCache.end(); )
+            {
+                // The cache holds the only reference when no pipeline or command signature uses the RS
+                it->second->AddRef();
+                if (it->second->Release() == 1)
+                {
+                    released.push_back(std::move(it->second));
+                    it = m_Resources.rootsigCache.erase(it);
+                }
+                else
+                    ++it;
+            }
+        }
+
+        // The root signatures are destroyed here, outside of the lock
     }
 
     bool Device::writeDescriptorTable(IDescriptorTable* _descriptorTable, const BindingSetItem& binding)
@@ -753,6 +937,72 @@ namespace nvrhi::d3d12
         if (binding.slot >= descriptorTable->capacity)
             return false;
 
+        if (!writeDescriptorTableItem(descriptorTable, binding))
+            return false;
+
+        m_Resources.shaderResourceViewHeap.copyToShaderVisibleHeap(descriptorTable->firstDescriptor + binding.slot, 1);
+        return true;
+    }
+
+    bool Device::writeDescriptorTable(IDescriptorTable* _descriptorTable, const BindingSetItem* bindings, size_t numBindings)
+    {
+        DescriptorTable* descriptorTable = checked_cast<DescriptorTable*>(_descriptorTable);
+
+        if (numBindings == 0)
+            return true;
+
+        std::vector<uint32_t> slots;
+        slots.reserve(numBindings);
+
+        for (size_t index = 0; index < numBindings; index++)
+        {
+            if (bindings[index].slot >= descriptorTable->capacity)
+                return false;
+
+            slots.push_back(bindings[index].slot);
+        }
+
+        // Create all views in the non-shader-visible heap first. Writing different descriptors
+        // from several threads is safe, so there is no lock here.
+        for (size_t index = 0; index < numBindings; index++)
+        {
+            if (!writeDescriptorTableItem(descriptorTable, bindings[index]))
+                return false;
+        }
+
+        // Coalesce the written slots into contiguous ranges and copy them all with one call
+        std::sort(slots.begin(), slots.end());
+
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> destRangeStarts;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> srcRangeStarts;
+        std::vector<UINT> rangeSizes;
+
+        for (size_t index = 0; index < slots.size(); )
+        {
+            const uint32_t first = slots[index];
+            uint32_t last = first;
+            while (index < slots.size() && slots[index] <= last + 1)
+            {
+                last = slots[index];
+                ++index;
+            }
+
+            const DescriptorIndex descriptorIndex = descriptorTable->firstDescriptor + first;
+            destRangeStarts.push_back(m_Resources.shaderResourceViewHeap.getCpuHandleShaderVisible(descriptorIndex));
+            srcRangeStarts.push_back(m_Resources.shaderResourceViewHeap.getCpuHandle(descriptorIndex));
+            rangeSizes.push_back(last - first + 1);
+        }
+
+        m_Context.device->CopyDescriptors(
+            UINT(rangeSizes.size()), destRangeStarts.data(), rangeSizes.data(),
+            UINT(rangeSizes.size()), srcRangeStarts.data(), rangeSizes.data(),
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        return true;
+    }
+
+    bool Device::writeDescriptorTableItem(DescriptorTable* descriptorTable, const BindingSetItem& binding)
+    {
         D3D12_CPU_DESCRIPTOR_HANDLE descriptorHandle = m_Resources.shaderResourceViewHeap.getCpuHandle(descriptorTable->firstDescriptor + binding.slot);
 
         switch (binding.type)
@@ -807,7 +1057,6 @@ namespace nvrhi::d3d12
             return false;
         }
 
-        m_Resources.shaderResourceViewHeap.copyToShaderVisibleHeap(descriptorTable->firstDescriptor + binding.slot, 1);
         return true;
     }
 
@@ -818,6 +1067,13 @@ namespace nvrhi::d3d12
         if (newSize == descriptorTable->capacity)
             return;
 
+        // Reserved tables grow and shrink in place, the new slots just become writable
+        if (newSize <= descriptorTable->reservedCapacity)
+        {
+            descriptorTable->capacity = newSize;
+            return;
+        }
+
         if (newSize < descriptorTable->capacity)
         {
             m_Resources.shaderResourceViewHeap.releaseDescriptors(descriptorTable->firstDescriptor + newSize, descriptorTable->capacity - newSize);
@@ -826,9 +1082,10 @@ namespace nvrhi::d3d12
         }
 
         uint32_t originalFirst = descriptorTable->firstDescriptor;
-        if (!keepContents && descriptorTable->capacity > 0)
+        const uint32_t originalAllocated = descriptorTable->getNumAllocatedDescriptors();
+        if (!keepContents && originalAllocated > 0)
         {
-            m_Resources.shaderResourceViewHeap.releaseDescriptors(descriptorTable->firstDescriptor, descriptorTable->capacity);
+            m_Resources.shaderResourceViewHeap.releaseDescriptors(descriptorTable->firstDescriptor, originalAllocated);
         }
 
         descriptorTable->firstDescriptor = m_Resources.shaderResourceViewHeap.allocateDescriptors(newSize);
@@ -844,11 +1101,15 @@ namespace nvrhi::d3d12
                 m_Resources.shaderResourceViewHeap.getCpuHandleShaderVisible(descriptorTable->firstDescriptor),
                 m_Resources.shaderResourceViewHeap.getCpuHandle(originalFirst),
                 D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        }
 
-            m_Resources.shaderResourceViewHeap.releaseDescriptors(originalFirst, descriptorTable->capacity);
+        if (keepContents && originalAllocated > 0)
+        {
+            m_Resources.shaderResourceViewHeap.releaseDescriptors(originalFirst, originalAllocated);
         }
 
         descriptorTable->capacity = newSize;
+        descriptorTable->reservedCapacity = 0;
     }
 
     void CommandList::setComputeBindings(
@@ -859,6 +1120,7 @@ namespace nvrhi::d3d12
         if (bindingUpdateMask)
         {
             static_vector<VolatileConstantBufferBinding, c_MaxVolatileConstantBuffers> newVolatileCBs;
+            static_vector<PromotedConstantBufferBinding, c_MaxVolatileConstantBuffers> newPromotedCBs;
 
             for (uint32_t bindingSetIndex = 0; bindingSetIndex < uint32_t(bindings.size()); bindingSetIndex++)
             {
@@ -890,7 +1152,7 @@ namespace nvrhi::d3d12
 
                             if (buffer->desc.isVolatile)
                             {
-                                D3D12_GPU_VIRTUAL_ADDRESS volatileData = m_VolatileConstantBufferAddresses[buffer];
+                                D3D12_GPU_VIRTUAL_ADDRESS volatileData = getVolatileConstantBufferAddress(buffer);
 
                                 if (!volatileData)
                                 {
@@ -924,6 +1186,35 @@ namespace nvrhi::d3d12
                         }
                     }
 
+                    // Bind the volatile constant buffers that are promoted to root constants
+                    for (size_t promotedCbIndex = 0; promotedCbIndex < bindingSet->rootParametersPromotedCB.size(); promotedCbIndex++)
+                    {
+                        const auto& parameter = bindingSet->rootParametersPromotedCB[promotedCbIndex];
+                        const uint32_t num32BitValues = bindingSet->layout->rootParametersPromotedCB[promotedCbIndex].second.Num32BitValues;
+                        RootParameterIndex rootParameterIndex = rootParameterOffset + parameter.first;
+
+                        if (!parameter.second)
+                            continue;
+
+                        Buffer* buffer = checked_cast<Buffer*>(parameter.second);
+                        const VolatileConstantBufferShadow* shadow = getVolatileConstantBufferShadow(buffer, true);
+
+                        if (!shadow)
+                            continue;
+
+                        const size_t currentIndex = newPromotedCBs.size();
+                        const bool constantsChanged = updateThisSet || currentIndex >= m_CurrentComputePromotedCBs.size() ||
+                            m_CurrentComputePromotedCBs[currentIndex].buffer != buffer ||
+                            m_CurrentComputePromotedCBs[currentIndex].version != shadow->version;
+
+                        if (constantsChanged)
+                        {
+                            m_ActiveCommandList->commandList->SetComputeRoot32BitConstants(rootParameterIndex, num32BitValues, shadow->data, 0);
+                        }
+
+                        newPromotedCBs.push_back(PromotedConstantBufferBinding{ rootParameterIndex, buffer, num32BitValues, shadow->version });
+                    }
+
                     if (updateThisSet)
                     {
                         if (bindingSet->descriptorTableValidSamplers)
@@ -942,6 +1233,8 @@ namespace nvrhi::d3d12
 
                         if (bindingSet->desc.trackLiveness)
                             m_Instance->referencedResources.push_back(bindingSet);
+                        else if (m_Resources.residencyManager.isEnabled())
+                            m_Instance->untrackedBindingSets.push_back(bindingSet);
                     }
 
                     if (m_EnableAutomaticBarriers && (updateThisSet || bindingSet->hasUavBindings)) // UAV bindings may place UAV barriers on the same binding set
@@ -958,6 +1251,7 @@ namespace nvrhi::d3d12
             }
 
             m_CurrentComputeVolatileCBs = newVolatileCBs;
+            m_CurrentComputePromotedCBs = newPromotedCBs;
         }
 
         if (indirectParams && updateIndirectParams)
@@ -985,6 +1279,7 @@ namespace nvrhi::d3d12
         if (bindingUpdateMask)
         {
             static_vector<VolatileConstantBufferBinding, c_MaxVolatileConstantBuffers> newVolatileCBs;
+            static_vector<PromotedConstantBufferBinding, c_MaxVolatileConstantBuffers> newPromotedCBs;
 
             for (uint32_t bindingSetIndex = 0; bindingSetIndex < uint32_t(bindings.size()); bindingSetIndex++)
             {
@@ -1016,7 +1311,7 @@ namespace nvrhi::d3d12
 
                             if (buffer->desc.isVolatile)
                             {
-                                const D3D12_GPU_VIRTUAL_ADDRESS volatileData = m_VolatileConstantBufferAddresses[buffer];
+                                const D3D12_GPU_VIRTUAL_ADDRESS volatileData = getVolatileConstantBufferAddress(buffer);
 
                                 if (!volatileData)
                                 {
@@ -1050,6 +1345,35 @@ namespace nvrhi::d3d12
                         }
                     }
 
+                    // Bind the volatile constant buffers that are promoted to root constants
+                    for (size_t promotedCbIndex = 0; promotedCbIndex < bindingSet->rootParametersPromotedCB.size(); promotedCbIndex++)
+                    {
+                        const auto& parameter = bindingSet->rootParametersPromotedCB[promotedCbIndex];
+                        const uint32_t num32BitValues = bindingSet->layout->rootParametersPromotedCB[promotedCbIndex].second.Num32BitValues;
+                        RootParameterIndex rootParameterIndex = rootParameterOffset + parameter.first;
+
+                        if (!parameter.second)
+                            continue;
+
+                        Buffer* buffer = checked_cast<Buffer*>(parameter.second);
+                        const VolatileConstantBufferShadow* shadow = getVolatileConstantBufferShadow(buffer, true);
+
+                        if (!shadow)
+                            continue;
+
+                        const size_t currentIndex = newPromotedCBs.size();
+                        const bool constantsChanged = updateThisSet || currentIndex >= m_CurrentGraphicsPromotedCBs.size() ||
+                            m_CurrentGraphicsPromotedCBs[currentIndex].buffer != buffer ||
+                            m_CurrentGraphicsPromotedCBs[currentIndex].version != shadow->version;
+
+                        if (constantsChanged)
+                        {
+                            m_ActiveCommandList->commandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, shadow->data, 0);
+                        }
+
+                        newPromotedCBs.push_back(PromotedConstantBufferBinding{ rootParameterIndex, buffer, num32BitValues, shadow->version });
+                    }
+
                     if (updateThisSet)
                     {
                         if (bindingSet->descriptorTableValidSamplers)
@@ -1068,6 +1392,8 @@ namespace nvrhi::d3d12
 
                         if (bindingSet->desc.trackLiveness)
                             m_Instance->referencedResources.push_back(bindingSet);
+                        else if (m_Resources.residencyManager.isEnabled())
+                            m_Instance->untrackedBindingSets.push_back(bindingSet);
                     }
 
                     if (m_EnableAutomaticBarriers && (updateThisSet || bindingSet->hasUavBindings)) // UAV bindings may place UAV barriers on the same binding set
@@ -1084,6 +1410,7 @@ namespace nvrhi::d3d12
             }
 
             m_CurrentGraphicsVolatileCBs = newVolatileCBs;
+            m_CurrentGraphicsPromotedCBs = newPromotedCBs;
         }
 
         if (indirectParams && updateIndirectParams)
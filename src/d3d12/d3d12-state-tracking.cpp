@@ -77,18 +77,96 @@ namespace nvrhi::d3d12
     
     void CommandList::requireTextureState(ITexture* _texture, TextureSubresourceSet subresources, ResourceStates state)
     {
+        if (m_Desc.isBundle)
+        {
+            m_BundleStates.requireTextureState(_texture, subresources, state);
+            return;
+        }
+
         Texture* texture = checked_cast<Texture*>(_texture);
 
+        if (texture->needsInitialDiscard.load(std::memory_order_relaxed))
+            discardUninitializedTexture(texture);
+
         m_StateTracker.requireTextureState(texture, subresources, state);
     }
+
+    void CommandList::discardUninitializedTexture(Texture* texture)
+    {
+        if (!texture->needsInitialDiscard.exchange(false))
+            return;
+
+        // DiscardResource on render targets and depth-stencil textures is only allowed on graphics queues,
+        // and it needs the resource in the RT or DSV state which a permanent state may not allow.
+        if (m_Desc.queueType != CommandQueue::Graphics || texture->permanentState != ResourceStates::Unknown)
+            return;
+
+        const FormatInfo& formatInfo = getFormatInfo(texture->desc.format);
+        const ResourceStates discardState = (formatInfo.hasDepth || formatInfo.hasStencil)
+            ? ResourceStates::DepthWrite
+            : ResourceStates::RenderTarget;
+
+        m_StateTracker.requireTextureState(texture, AllSubresources, discardState);
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        m_InitialDiscardTexture = texture;
+        commitBarriers();
+        m_InitialDiscardTexture = nullptr;
+#else
+        commitBarriers();
+#endif
+
+        m_ActiveCommandList->commandList->DiscardResource(texture->resource, nullptr);
+    }
     
     void CommandList::requireBufferState(IBuffer* _buffer, ResourceStates state)
     {
+        if (m_Desc.isBundle)
+        {
+            m_BundleStates.requireBufferState(_buffer, state);
+            return;
+        }
+
         Buffer* buffer = checked_cast<Buffer*>(_buffer);
 
         m_StateTracker.requireBufferState(buffer, state);
     }
 
+    static D3D12_RESOURCE_BARRIER_FLAGS convertBarrierSplit(BarrierSplit split)
+    {
+        switch (split)
+        {
+        case BarrierSplit::Begin:
+            return D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        case BarrierSplit::End:
+            return D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+        case BarrierSplit::None:
+        default:
+            return D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        }
+    }
+
+    void CommandList::aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter)
+    {
+        commitBarriers();
+
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+
+        if (resourceBefore)
+        {
+            barrier.Aliasing.pResourceBefore = resourceBefore->getNativeObject(ObjectTypes::D3D12_Resource);
+            m_Instance->referencedResources.push_back(resourceBefore);
+        }
+
+        if (resourceAfter)
+        {
+            barrier.Aliasing.pResourceAfter = resourceAfter->getNativeObject(ObjectTypes::D3D12_Resource);
+            m_Instance->referencedResources.push_back(resourceAfter);
+        }
+
+        m_ActiveCommandList->commandList->ResourceBarrier(1, &barrier);
+    }
+
     void CommandList::commitBarriers()
     {
         const auto& textureBarriers = m_StateTracker.getTextureBarriers();
@@ -97,6 +175,17 @@ namespace nvrhi::d3d12
         if (barrierCount == 0)
             return;
 
+        if (m_Desc.enableStatistics)
+            countBarriers(m_StateTracker, m_Statistics);
+
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+        if (m_ActiveCommandList->commandList7)
+        {
+            commitEnhancedBarriers();
+            return;
+        }
+#endif
+
         // Allocate vector space for the barriers assuming 1:1 translation.
         // For partial transitions on multi-plane textures, original barriers may translate
         // into more than 1 barrier each, but that's relatively rare.
@@ -114,6 +203,7 @@ namespace nvrhi::d3d12
             if (stateBefore != stateAfter)
             {
                 d3dbarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                d3dbarrier.Flags = convertBarrierSplit(barrier.split);
                 d3dbarrier.Transition.StateBefore = stateBefore;
                 d3dbarrier.Transition.StateAfter = stateAfter;
                 d3dbarrier.Transition.pResource = texture->resource;
@@ -124,15 +214,23 @@ namespace nvrhi::d3d12
                 }
                 else
                 {
+                    // Legacy barriers address one subresource each, expand the merged range
                     for (uint8_t plane = 0; plane < texture->planeCount; plane++)
                     {
-                        d3dbarrier.Transition.Subresource = calcSubresource(barrier.mipLevel, barrier.arraySlice, plane, texture->desc.mipLevels, texture->desc.arraySize);
-                        m_D3DBarriers.push_back(d3dbarrier);
+                        for (ArraySlice arraySlice = barrier.arraySlice; arraySlice < barrier.arraySlice + barrier.numArraySlices; arraySlice++)
+                        {
+                            for (MipLevel mipLevel = barrier.mipLevel; mipLevel < barrier.mipLevel + barrier.numMipLevels; mipLevel++)
+                            {
+                                d3dbarrier.Transition.Subresource = calcSubresource(mipLevel, arraySlice, plane, texture->desc.mipLevels, texture->desc.arraySize);
+                                m_D3DBarriers.push_back(d3dbarrier);
+                            }
+                        }
                     }
                 }
             }
-            else if (stateAfter & D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+            else if ((stateAfter & D3D12_RESOURCE_STATE_UNORDERED_ACCESS) && barrier.split != BarrierSplit::End)
             {
+                // UAV barriers cannot be split, the Begin half of a split barrier places the whole UAV barrier
                 d3dbarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
                 d3dbarrier.UAV.pResource = texture->resource;
                 m_D3DBarriers.push_back(d3dbarrier);
@@ -152,12 +250,17 @@ namespace nvrhi::d3d12
                 (stateAfter & D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE) == 0)
             {
                 d3dbarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                d3dbarrier.Flags = convertBarrierSplit(barrier.split);
                 d3dbarrier.Transition.StateBefore = stateBefore;
                 d3dbarrier.Transition.StateAfter = stateAfter;
                 d3dbarrier.Transition.pResource = buffer->resource;
                 d3dbarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
                 m_D3DBarriers.push_back(d3dbarrier);
             }
+            else if (barrier.split == BarrierSplit::End)
+            {
+                // The Begin half has placed the UAV barrier, if any
+            }
             else if ((barrier.stateBefore == ResourceStates::AccelStructWrite && (barrier.stateAfter & (ResourceStates::AccelStructRead | ResourceStates::AccelStructBuildBlas)) != 0) ||
                 (barrier.stateAfter == ResourceStates::AccelStructWrite && (barrier.stateBefore & (ResourceStates::AccelStructRead | ResourceStates::AccelStructBuildBlas)) != 0) ||
                 (barrier.stateBefore == ResourceStates::OpacityMicromapWrite && (barrier.stateAfter & (ResourceStates::AccelStructBuildInput)) != 0) ||
@@ -175,6 +278,120 @@ namespace nvrhi::d3d12
         m_StateTracker.clearBarriers();
     }
 
+#if NVRHI_D3D12_WITH_ENHANCED_BARRIERS
+    void CommandList::commitEnhancedBarriers()
+    {
+        m_D3DTextureBarriers.clear();
+        m_D3DBufferBarriers.clear();
+
+        for (const auto& barrier : m_StateTracker.getTextureBarriers())
+        {
+            const Texture* texture = static_cast<const Texture*>(barrier.texture);
+
+            EnhancedBarrierState before = convertEnhancedBarrierState(barrier.stateBefore);
+            EnhancedBarrierState after = convertEnhancedBarrierState(barrier.stateAfter);
+
+            // The first use of an uninitialized texture doesn't need its previous contents
+            const bool discard = texture == m_InitialDiscardTexture;
+            if (discard)
+                before = EnhancedBarrierState();
+
+            // Transitions between states that share a layout, such as Common and the copy states, only need to
+            // synchronize and flush caches. Barriers without a layout change and without writes are redundant.
+            const bool layoutChange = before.layout != after.layout;
+            const bool uavBarrier = (barrier.stateAfter & ResourceStates::UnorderedAccess) != 0;
+            if (!layoutChange && !uavBarrier && before.access == after.access)
+                continue;
+
+            if (barrier.split == BarrierSplit::Begin)
+                after.sync = D3D12_BARRIER_SYNC_SPLIT;
+            else if (barrier.split == BarrierSplit::End)
+                before.sync = D3D12_BARRIER_SYNC_SPLIT;
+
+            D3D12_TEXTURE_BARRIER d3dbarrier{};
+            d3dbarrier.SyncBefore = before.sync;
+            d3dbarrier.SyncAfter = after.sync;
+            d3dbarrier.AccessBefore = before.access;
+            d3dbarrier.AccessAfter = after.access;
+            d3dbarrier.LayoutBefore = before.layout;
+            d3dbarrier.LayoutAfter = after.layout;
+            d3dbarrier.pResource = texture->resource;
+            d3dbarrier.Flags = discard ? D3D12_TEXTURE_BARRIER_FLAG_DISCARD : D3D12_TEXTURE_BARRIER_FLAG_NONE;
+
+            if (barrier.entireTexture)
+            {
+                // 0xffffffff in IndexOrFirstMipLevel with NumMipLevels = 0 selects all subresources
+                d3dbarrier.Subresources.IndexOrFirstMipLevel = 0xffffffff;
+                d3dbarrier.Subresources.NumMipLevels = 0;
+            }
+            else
+            {
+                d3dbarrier.Subresources.IndexOrFirstMipLevel = barrier.mipLevel;
+                d3dbarrier.Subresources.NumMipLevels = barrier.numMipLevels;
+                d3dbarrier.Subresources.FirstArraySlice = barrier.arraySlice;
+                d3dbarrier.Subresources.NumArraySlices = barrier.numArraySlices;
+                d3dbarrier.Subresources.FirstPlane = 0;
+                d3dbarrier.Subresources.NumPlanes = texture->planeCount;
+            }
+
+            m_D3DTextureBarriers.push_back(d3dbarrier);
+        }
+
+        for (const auto& barrier : m_StateTracker.getBufferBarriers())
+        {
+            const Buffer* buffer = static_cast<const Buffer*>(barrier.buffer);
+
+            EnhancedBarrierState before = convertEnhancedBarrierState(barrier.stateBefore);
+            EnhancedBarrierState after = convertEnhancedBarrierState(barrier.stateAfter);
+
+            const bool uavBarrier = (barrier.stateAfter & ResourceStates::UnorderedAccess) != 0;
+            const bool accelStructWrite = ((barrier.stateBefore | barrier.stateAfter) & (ResourceStates::AccelStructWrite | ResourceStates::OpacityMicromapWrite)) != 0;
+            if (!uavBarrier && !accelStructWrite && before.access == after.access)
+                continue;
+
+            if (barrier.split == BarrierSplit::Begin)
+                after.sync = D3D12_BARRIER_SYNC_SPLIT;
+            else if (barrier.split == BarrierSplit::End)
+                before.sync = D3D12_BARRIER_SYNC_SPLIT;
+
+            D3D12_BUFFER_BARRIER d3dbarrier{};
+            d3dbarrier.SyncBefore = before.sync;
+            d3dbarrier.SyncAfter = after.sync;
+            d3dbarrier.AccessBefore = before.access;
+            d3dbarrier.AccessAfter = after.access;
+            d3dbarrier.pResource = buffer->resource;
+            d3dbarrier.Offset = 0;
+            d3dbarrier.Size = UINT64_MAX;
+
+            m_D3DBufferBarriers.push_back(d3dbarrier);
+        }
+
+        D3D12_BARRIER_GROUP barrierGroups[2] = {};
+        uint32_t numBarrierGroups = 0;
+
+        if (!m_D3DTextureBarriers.empty())
+        {
+            barrierGroups[numBarrierGroups].Type = D3D12_BARRIER_TYPE_TEXTURE;
+            barrierGroups[numBarrierGroups].NumBarriers = uint32_t(m_D3DTextureBarriers.size());
+            barrierGroups[numBarrierGroups].pTextureBarriers = m_D3DTextureBarriers.data();
+            ++numBarrierGroups;
+        }
+
+        if (!m_D3DBufferBarriers.empty())
+        {
+            barrierGroups[numBarrierGroups].Type = D3D12_BARRIER_TYPE_BUFFER;
+            barrierGroups[numBarrierGroups].NumBarriers = uint32_t(m_D3DBufferBarriers.size());
+            barrierGroups[numBarrierGroups].pBufferBarriers = m_D3DBufferBarriers.data();
+            ++numBarrierGroups;
+        }
+
+        if (numBarrierGroups > 0)
+            m_ActiveCommandList->commandList7->Barrier(numBarrierGroups, barrierGroups);
+
+        m_StateTracker.clearBarriers();
+    }
+#endif
+
     void CommandList::setEnableAutomaticBarriers(bool enable)
     {
         m_EnableAutomaticBarriers = enable;
@@ -245,6 +462,26 @@ namespace nvrhi::d3d12
             m_Instance->referencedResources.push_back(buffer);
     }
 
+    void CommandList::beginTextureStateTransition(ITexture* _texture, TextureSubresourceSet subresources, ResourceStates stateBits)
+    {
+        Texture* texture = checked_cast<Texture*>(_texture);
+
+        m_StateTracker.beginTextureStateTransition(texture, subresources, stateBits);
+
+        if (m_Instance)
+            m_Instance->referencedResources.push_back(texture);
+    }
+
+    void CommandList::beginBufferStateTransition(IBuffer* _buffer, ResourceStates stateBits)
+    {
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        m_StateTracker.beginBufferStateTransition(buffer, stateBits);
+
+        if (m_Instance)
+            m_Instance->referencedResources.push_back(buffer);
+    }
+
     void CommandList::setAccelStructState(rt::IAccelStruct* _as, ResourceStates stateBits)
     {
         AccelStruct* as = checked_cast<AccelStruct*>(_as);
@@ -24,6 +24,7 @@
 
 #include <nvrhi/common/misc.h>
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
@@ -153,6 +154,12 @@ namespace nvrhi::d3d12
 
         for (auto pair : m_CustomUAVs)
             m_Resources.shaderResourceViewHeap.releaseDescriptor(pair.second);
+
+        if (placedAllocation.poolHeap)
+        {
+            resource = nullptr;
+            m_Resources.placedResourcePool.release(placedAllocation);
+        }
     }
 
     StagingTexture::SliceRegion StagingTexture::getSliceRegion(ID3D12Device *device, const TextureSlice& slice)
@@ -270,6 +277,9 @@ namespace nvrhi::d3d12
         if (d.isUAV)
             desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
+        if (d.isTiled)
+            desc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+
         return desc;
     }
 
@@ -312,6 +322,20 @@ namespace nvrhi::d3d12
             isShared = true;
         }
 
+        const bool isRenderTargetOrDepthStencil = (rd.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+        // The pool heaps are created on node 0 only
+        const bool useNodeMasks = d.creationNodeMask > 1 || d.visibleNodeMask > 1;
+        const bool usePlacedResourcePool = !d.isVirtual && !d.isTiled && !isShared && !useNodeMasks && m_Resources.placedResourcePool.isEnabled();
+
+        if (usePlacedResourcePool && !isRenderTargetOrDepthStencil && rd.SampleDesc.Count == 1)
+        {
+            // Small textures can be placed at 4 KB alignment instead of 64 KB, if the driver agrees
+            rd.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+            const D3D12_RESOURCE_ALLOCATION_INFO allocInfo = m_Context.device->GetResourceAllocationInfo(1, 1, &rd);
+            if (allocInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+                rd.Alignment = 0;
+        }
+
         Texture* texture = new Texture(m_Context, m_Resources, d, rd);
 
         if (d.isVirtual)
@@ -321,16 +345,33 @@ namespace nvrhi::d3d12
         }
 
         heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+        heapProps.CreationNodeMask = d.creationNodeMask;
+        heapProps.VisibleNodeMask = d.visibleNodeMask;
 
         D3D12_CLEAR_VALUE clearValue = convertTextureClearValue(d);
 
-        HRESULT hr = m_Context.device->CreateCommittedResource(
-            &heapProps,
-            heapFlags,
-            &texture->resourceDesc,
-            convertResourceStates(d.initialState),
-            d.useClearValue ? &clearValue : nullptr,
-            IID_PPV_ARGS(&texture->resource));
+        HRESULT hr = S_OK;
+        if (d.isTiled)
+        {
+            hr = m_Context.device->CreateReservedResource(
+                &texture->resourceDesc,
+                convertInitialTextureState(d.initialState, m_Context.enhancedBarriers),
+                d.useClearValue ? &clearValue : nullptr,
+                IID_PPV_ARGS(&texture->resource));
+        }
+        else if (!usePlacedResourcePool || !m_Resources.placedResourcePool.tryCreateResource(heapProps.Type,
+            isRenderTargetOrDepthStencil ? PlacedResourcePool::ResourceClass::RenderTargetOrDepthStencil : PlacedResourcePool::ResourceClass::Texture,
+            texture->resourceDesc, convertInitialTextureState(d.initialState, m_Context.enhancedBarriers), d.useClearValue ? &clearValue : nullptr,
+            texture->placedAllocation, texture->resource))
+        {
+            hr = m_Context.device->CreateCommittedResource(
+                &heapProps,
+                heapFlags,
+                &texture->resourceDesc,
+                convertInitialTextureState(d.initialState, m_Context.enhancedBarriers),
+                d.useClearValue ? &clearValue : nullptr,
+                IID_PPV_ARGS(&texture->resource));
+        }
 
         if (FAILED(hr))
         {
@@ -366,6 +407,13 @@ namespace nvrhi::d3d12
             }
         }
 
+        if (texture->placedAllocation.poolHeap && isRenderTargetOrDepthStencil)
+            texture->needsInitialDiscard = true;
+
+        // Residency is only managed for the submissions on node 0
+        if (!isShared && !d.isTiled && !useNodeMasks && !texture->placedAllocation.poolHeap)
+            m_Resources.residencyManager.trackResource(texture->residency, texture->resource, texture->resourceDesc, d.residencyPriority);
+
         texture->postCreate();
 
         return TextureHandle::Create(texture);
@@ -400,7 +448,7 @@ namespace nvrhi::d3d12
         HRESULT hr = m_Context.device->CreatePlacedResource(
             heap->heap, offset,
             &texture->resourceDesc,
-            convertResourceStates(texture->desc.initialState),
+            convertInitialTextureState(texture->desc.initialState, m_Context.enhancedBarriers),
             texture->desc.useClearValue ? &clearValue : nullptr,
             IID_PPV_ARGS(&texture->resource));
 
@@ -416,11 +464,122 @@ namespace nvrhi::d3d12
         }
 
         texture->heap = heap;
+        texture->needsInitialDiscard = (texture->resourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
         texture->postCreate();
 
         return true;
     }
     
+    void Device::getTextureTiling(ITexture* _texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+        uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings)
+    {
+        Texture* texture = checked_cast<Texture*>(_texture);
+
+        UINT numTilesD3D = 0;
+        D3D12_PACKED_MIP_INFO packedMipInfo = {};
+        D3D12_TILE_SHAPE tileShapeD3D = {};
+        UINT numSubresourceTilingsD3D = numSubresourceTilings ? *numSubresourceTilings : 0;
+        std::vector<D3D12_SUBRESOURCE_TILING> subresourceTilingsD3D(numSubresourceTilingsD3D);
+
+        m_Context.device->GetResourceTiling(texture->resource, &numTilesD3D, &packedMipInfo, &tileShapeD3D,
+            &numSubresourceTilingsD3D, 0, subresourceTilingsD3D.data());
+
+        if (numTiles)
+            *numTiles = numTilesD3D;
+
+        if (packedMipDesc)
+        {
+            packedMipDesc->numStandardMips = packedMipInfo.NumStandardMips;
+            packedMipDesc->numPackedMips = packedMipInfo.NumPackedMips;
+            packedMipDesc->numTilesForPackedMips = packedMipInfo.NumTilesForPackedMips;
+            packedMipDesc->startTileIndexInOverallResource = packedMipInfo.StartTileIndexInOverallResource;
+        }
+
+        if (tileShape)
+        {
+            tileShape->widthInTexels = tileShapeD3D.WidthInTexels;
+            tileShape->heightInTexels = tileShapeD3D.HeightInTexels;
+            tileShape->depthInTexels = tileShapeD3D.DepthInTexels;
+        }
+
+        if (numSubresourceTilings)
+        {
+            // GetResourceTiling returns the packed mips as tilings with an invalid start index, skip them
+            numSubresourceTilingsD3D = std::min(numSubresourceTilingsD3D, UINT(packedMipInfo.NumStandardMips));
+
+            for (UINT i = 0; i < numSubresourceTilingsD3D; ++i)
+            {
+                subresourceTilings[i].widthInTiles = subresourceTilingsD3D[i].WidthInTiles;
+                subresourceTilings[i].heightInTiles = subresourceTilingsD3D[i].HeightInTiles;
+                subresourceTilings[i].depthInTiles = subresourceTilingsD3D[i].DepthInTiles;
+                subresourceTilings[i].startTileIndexInOverallResource = subresourceTilingsD3D[i].StartTileIndexInOverallResource;
+            }
+
+            *numSubresourceTilings = numSubresourceTilingsD3D;
+        }
+    }
+
+    void Device::updateTextureTileMappings(ITexture* _texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings, CommandQueue executionQueue)
+    {
+        Texture* texture = checked_cast<Texture*>(_texture);
+        Queue* queue = getQueue(executionQueue);
+
+        std::vector<D3D12_TILED_RESOURCE_COORDINATE> resourceCoordinates;
+        std::vector<D3D12_TILE_REGION_SIZE> regionSizes;
+        std::vector<D3D12_TILE_RANGE_FLAGS> rangeFlags;
+        std::vector<UINT> heapStartOffsets;
+        std::vector<UINT> rangeTileCounts;
+
+        for (uint32_t mappingIndex = 0; mappingIndex < numTileMappings; ++mappingIndex)
+        {
+            const TextureTilesMapping& mapping = tileMappings[mappingIndex];
+            Heap* heap = mapping.heap ? checked_cast<Heap*>(mapping.heap) : nullptr;
+            const uint32_t numRegions = mapping.numTextureRegions;
+
+            resourceCoordinates.resize(numRegions);
+            regionSizes.resize(numRegions);
+            rangeFlags.assign(numRegions, heap ? D3D12_TILE_RANGE_FLAG_NONE : D3D12_TILE_RANGE_FLAG_NULL);
+            heapStartOffsets.resize(numRegions);
+            rangeTileCounts.resize(numRegions);
+
+            for (uint32_t i = 0; i < numRegions; ++i)
+            {
+                const TiledTextureCoordinate& coordinate = mapping.tiledTextureCoordinates[i];
+                const TiledTextureRegion& region = mapping.tiledTextureRegions[i];
+
+                resourceCoordinates[i].X = coordinate.x;
+                resourceCoordinates[i].Y = coordinate.y;
+                resourceCoordinates[i].Z = coordinate.z;
+                resourceCoordinates[i].Subresource = calcSubresource(coordinate.mipLevel, coordinate.arraySlice, 0,
+                    texture->desc.mipLevels, texture->desc.arraySize);
+
+                if (region.numTiles != 0)
+                {
+                    regionSizes[i].UseBox = FALSE;
+                    regionSizes[i].NumTiles = region.numTiles;
+                }
+                else
+                {
+                    regionSizes[i].UseBox = TRUE;
+                    regionSizes[i].Width = region.width;
+                    regionSizes[i].Height = UINT16(region.height);
+                    regionSizes[i].Depth = UINT16(region.depth);
+                    regionSizes[i].NumTiles = region.width * region.height * region.depth;
+                }
+
+                heapStartOffsets[i] = heap ? UINT(mapping.byteOffsets[i] / D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES) : 0;
+                rangeTileCounts[i] = regionSizes[i].NumTiles;
+            }
+
+            queue->queue->UpdateTileMappings(texture->resource, numRegions, resourceCoordinates.data(), regionSizes.data(),
+                heap ? heap->heap.Get() : nullptr, numRegions, rangeFlags.data(), heapStartOffsets.data(), rangeTileCounts.data(),
+                D3D12_TILE_MAPPING_FLAG_NONE);
+
+            if (heap && std::find(texture->tileMappingHeaps.begin(), texture->tileMappingHeaps.end(), mapping.heap) == texture->tileMappingHeaps.end())
+                texture->tileMappingHeaps.push_back(mapping.heap);
+        }
+    }
+
     TextureHandle Device::createHandleForNativeTexture(ObjectType objectType, Object _texture, const TextureDesc& desc)
     {
         if (_texture.pointer == nullptr)
@@ -791,7 +950,7 @@ namespace nvrhi::d3d12
 
         if (tex->lastUseFence)
         {
-            WaitForFence(tex->lastUseFence, tex->lastUseFenceValue, m_FenceEvent);
+            waitForQueueFence(tex->lastUseFence, tex->lastUseFenceValue);
             tex->lastUseFence = nullptr;
         }
 
@@ -1205,6 +1364,109 @@ namespace nvrhi::d3d12
         m_ActiveCommandList->commandList->CopyTextureRegion(&destCopyLocation, 0, 0, 0, &srcCopyLocation, nullptr);
     }
 
+    void CommandList::writeTextureRegions(ITexture* _dest, const TextureUploadRegion* regions, size_t numRegions)
+    {
+        Texture* dest = checked_cast<Texture*>(_dest);
+
+        if (numRegions == 0)
+            return;
+
+        // Transition the smallest subresource range that covers all regions with a single barrier
+        MipLevel minMip = regions[0].mipLevel, maxMip = regions[0].mipLevel;
+        ArraySlice minSlice = regions[0].arraySlice, maxSlice = regions[0].arraySlice;
+        for (size_t i = 1; i < numRegions; i++)
+        {
+            minMip = std::min(minMip, regions[i].mipLevel);
+            maxMip = std::max(maxMip, regions[i].mipLevel);
+            minSlice = std::min(minSlice, regions[i].arraySlice);
+            maxSlice = std::max(maxSlice, regions[i].arraySlice);
+        }
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireTextureState(dest, TextureSubresourceSet(minMip, maxMip - minMip + 1, minSlice, maxSlice - minSlice + 1), ResourceStates::CopyDest);
+        }
+        commitBarriers();
+
+        D3D12_RESOURCE_DESC resourceDesc = dest->resource->GetDesc();
+
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(numRegions);
+        std::vector<uint32_t> numRows(numRegions);
+        std::vector<uint64_t> rowSizes(numRegions);
+        std::vector<uint32_t> subresources(numRegions);
+
+        for (size_t i = 0; i < numRegions; i++)
+            subresources[i] = calcSubresource(regions[i].mipLevel, regions[i].arraySlice, 0, dest->desc.mipLevels, dest->desc.arraySize);
+
+        // Compute the packed layout of all regions. Runs of consecutive subresources, such as all mips of a slice,
+        // are laid out by a single GetCopyableFootprints call.
+        uint64_t totalBytes = 0;
+        for (size_t first = 0; first < numRegions; )
+        {
+            size_t count = 1;
+            while (first + count < numRegions && subresources[first + count] == subresources[first] + count)
+                ++count;
+
+            uint64_t runBytes = 0;
+            m_Context.device->GetCopyableFootprints(&resourceDesc, subresources[first], uint32_t(count), totalBytes,
+                &footprints[first], &numRows[first], &rowSizes[first], &runBytes);
+
+            totalBytes = align(totalBytes + runBytes, uint64_t(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT));
+            first += count;
+        }
+
+        void* cpuVA;
+        ID3D12Resource* uploadBuffer;
+        size_t offsetInUploadBuffer;
+        if (!m_UploadManager.suballocateBuffer(totalBytes, nullptr, &uploadBuffer, &offsetInUploadBuffer, &cpuVA, nullptr,
+            m_RecordingVersion, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT))
+        {
+            m_Context.error("Couldn't suballocate an upload buffer");
+            return;
+        }
+
+        m_Instance->referencedResources.push_back(dest);
+
+        if (uploadBuffer != m_CurrentUploadBuffer)
+        {
+            m_Instance->referencedNativeResources.push_back(uploadBuffer);
+            m_CurrentUploadBuffer = uploadBuffer;
+        }
+
+        for (size_t i = 0; i < numRegions; i++)
+        {
+            const TextureUploadRegion& region = regions[i];
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = footprints[i];
+
+            assert(numRows[i] <= footprint.Footprint.Height);
+
+            char* regionVA = (char*)cpuVA + footprint.Offset;
+            for (uint32_t depthSlice = 0; depthSlice < footprint.Footprint.Depth; depthSlice++)
+            {
+                for (uint32_t row = 0; row < numRows[i]; row++)
+                {
+                    void* destAddress = regionVA + footprint.Footprint.RowPitch * (row + depthSlice * numRows[i]);
+                    const void* srcAddress = (const char*)region.data + region.rowPitch * row + region.depthPitch * depthSlice;
+                    memcpy(destAddress, srcAddress, std::min(region.rowPitch, size_t(rowSizes[i])));
+                }
+            }
+
+            footprint.Offset += uint64_t(offsetInUploadBuffer);
+
+            D3D12_TEXTURE_COPY_LOCATION destCopyLocation;
+            destCopyLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            destCopyLocation.SubresourceIndex = subresources[i];
+            destCopyLocation.pResource = dest->resource;
+
+            D3D12_TEXTURE_COPY_LOCATION srcCopyLocation;
+            srcCopyLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            srcCopyLocation.PlacedFootprint = footprint;
+            srcCopyLocation.pResource = uploadBuffer;
+
+            m_ActiveCommandList->commandList->CopyTextureRegion(&destCopyLocation, 0, 0, 0, &srcCopyLocation, nullptr);
+        }
+    }
+
     void CommandList::resolveTexture(ITexture* _dest, const TextureSubresourceSet& dstSubresources, ITexture* _src, const TextureSubresourceSet& srcSubresources)
     {
         Texture* dest = checked_cast<Texture*>(_dest);
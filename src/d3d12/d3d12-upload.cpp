@@ -37,14 +37,30 @@ namespace nvrhi::d3d12
         }
     }
     
-    UploadManager::UploadManager(const Context& context, class Queue* pQueue, size_t defaultChunkSize, uint64_t memoryLimit, bool isScratchBuffer)
+    UploadManager::UploadManager(const Context& context, class Queue* pQueue, size_t defaultChunkSize, uint64_t memoryLimit, bool isScratchBuffer,
+        uint64_t ringSize, uint32_t nodeMask)
         : m_Context(context)
         , m_Queue(pQueue)
         , m_DefaultChunkSize(defaultChunkSize)
         , m_MemoryLimit(memoryLimit)
         , m_IsScratchBuffer(isScratchBuffer)
+        , m_NodeMask(nodeMask)
     {
         assert(pQueue);
+
+        if (ringSize > 0 && !isScratchBuffer)
+        {
+            m_Ring = std::make_unique<UploadRing>(align(ringSize, BufferChunk::c_sizeAlignment));
+        }
+    }
+
+    UploadManager::~UploadManager()
+    {
+        if (m_FenceEvent)
+        {
+            CloseHandle(m_FenceEvent);
+            m_FenceEvent = nullptr;
+        }
     }
 
     std::shared_ptr<BufferChunk> UploadManager::createChunk(size_t size) const
@@ -53,8 +69,13 @@ namespace nvrhi::d3d12
 
         size = align(size, BufferChunk::c_sizeAlignment);
 
+        TraceScope traceScope(m_Context.traceRecorder.get(), m_IsScratchBuffer ? "Create scratch chunk" : "Create upload chunk", "Upload");
+        traceScope.setArg("bytes", size);
+
         D3D12_HEAP_PROPERTIES heapProps = {};
         heapProps.Type = m_IsScratchBuffer ? D3D12_HEAP_TYPE_DEFAULT : D3D12_HEAP_TYPE_UPLOAD;
+        heapProps.CreationNodeMask = m_NodeMask;
+        heapProps.VisibleNodeMask = m_NodeMask;
 
         D3D12_RESOURCE_DESC bufferDesc = {};
         bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
@@ -88,6 +109,8 @@ namespace nvrhi::d3d12
         chunk->bufferSize = size;
         chunk->gpuVA = chunk->buffer->GetGPUVirtualAddress();
         chunk->identifier = uint32_t(m_ChunkPool.size());
+        chunk->memoryTracking = TrackedAllocation(m_Context.memoryCounters,
+            m_IsScratchBuffer ? &InternalMemoryCounters::scratchBufferBytes : &InternalMemoryCounters::uploadBufferBytes, size);
 
         std::wstringstream wss;
         if (m_IsScratchBuffer)
@@ -105,6 +128,11 @@ namespace nvrhi::d3d12
         // Scratch allocations need a command list, upload ones don't
         assert(!m_IsScratchBuffer || pCommandList);
 
+        m_BytesRequested += size;
+
+        if (m_Ring)
+            return suballocateFromRing(size, pBuffer, pOffset, pCpuVA, pGpuVA, currentVersion, alignment);
+
         std::shared_ptr<BufferChunk> chunkToRetire;
 
         // Try to allocate from the current chunk first
@@ -224,6 +252,8 @@ namespace nvrhi::d3d12
             else
             {
                 m_CurrentChunk = createChunk(sizeToAllocate);
+                if (!m_CurrentChunk)
+                    return false;
             }
         }
 
@@ -238,6 +268,57 @@ namespace nvrhi::d3d12
         return true;
     }
 
+    bool UploadManager::suballocateFromRing(uint64_t size, ID3D12Resource** pBuffer, size_t* pOffset, void** pCpuVA,
+        D3D12_GPU_VIRTUAL_ADDRESS* pGpuVA, uint64_t currentVersion, uint32_t alignment)
+    {
+        if (!m_RingChunk)
+        {
+            m_RingChunk = createChunk(m_Ring->getSize());
+            if (!m_RingChunk)
+                return false;
+        }
+
+        m_Ring->retire(m_Queue->lastCompletedInstance);
+
+        uint64_t offset = 0;
+        while (!m_Ring->allocate(size, alignment, currentVersion, offset))
+        {
+            m_Ring->retire(m_Queue->updateLastCompletedInstance());
+            if (m_Ring->allocate(size, alignment, currentVersion, offset))
+                break;
+
+            const uint64_t oldestVersion = m_Ring->getOldestSubmittedVersion();
+            if (oldestVersion == 0)
+            {
+                std::stringstream ss;
+                ss << "Cannot allocate " << size << " bytes from the upload ring of " << m_Ring->getSize() << " bytes, "
+                    "increase CommandListParameters::uploadRingSize or execute the command list more often";
+                m_Context.error(ss.str());
+                return false;
+            }
+
+            // The ring is full, wait until the GPU is done with the oldest uploads
+            if (!m_FenceEvent)
+                m_FenceEvent = CreateEvent(nullptr, false, false, nullptr);
+
+            if (VersionGetInstance(oldestVersion) > m_Queue->getLastFlushedInstance())
+                m_Queue->flush();
+
+            WaitForFence(m_Queue->fence, VersionGetInstance(oldestVersion), m_FenceEvent);
+            m_Ring->retire(m_Queue->updateLastCompletedInstance());
+            ++m_NumStalls;
+        }
+
+        m_HighWaterMark = std::max(m_HighWaterMark, m_Ring->getBytesInFlight());
+
+        if (pBuffer) *pBuffer = m_RingChunk->buffer;
+        if (pOffset) *pOffset = size_t(offset);
+        if (pCpuVA) *pCpuVA = (char*)m_RingChunk->cpuVA + offset;
+        if (pGpuVA) *pGpuVA = m_RingChunk->gpuVA + offset;
+
+        return true;
+    }
+
     void UploadManager::submitChunks(uint64_t currentVersion, uint64_t submittedVersion)
     {
         if (m_CurrentChunk)
@@ -251,5 +332,43 @@ namespace nvrhi::d3d12
             if (chunk->version == currentVersion)
                 chunk->version = submittedVersion;
         }
+
+        if (m_Ring)
+        {
+            m_Ring->submit(currentVersion, submittedVersion);
+        }
+    }
+
+    UploadStatistics UploadManager::getStatistics() const
+    {
+        UploadStatistics statistics;
+        statistics.numStalls = m_NumStalls;
+
+        if (m_Ring)
+        {
+            statistics.capacity = m_Ring->getSize();
+            statistics.bytesInFlight = m_Ring->getBytesInFlight();
+            statistics.highWaterMark = m_HighWaterMark;
+        }
+        else
+        {
+            // Chunks that are in the pool but not yet known to be completed are counted as in flight
+            for (const auto& chunk : m_ChunkPool)
+            {
+                statistics.capacity += chunk->bufferSize;
+                if (chunk->version != 0)
+                    statistics.bytesInFlight += chunk->bufferSize;
+            }
+            if (m_CurrentChunk)
+            {
+                statistics.capacity += m_CurrentChunk->bufferSize;
+                statistics.bytesInFlight += m_CurrentChunk->bufferSize;
+            }
+
+            // Chunks are never released, so the capacity is also the peak
+            statistics.highWaterMark = statistics.capacity;
+        }
+
+        return statistics;
     }
 } // namespace nvrhi::d3d12
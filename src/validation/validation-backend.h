@@ -24,6 +24,10 @@
 
 #include <nvrhi/validation.h>
 #include "../common/sparse-bitset.h"
+#include "../common/push-bindings.h"
+
+#include <array>
+#include <unordered_set>
 
 namespace nvrhi::validation
 {
@@ -102,13 +106,16 @@ namespace nvrhi::validation
     public:
         friend class DeviceWrapper;
 
-        CommandListWrapper(DeviceWrapper* device, ICommandList* commandList, bool isImmediate, CommandQueue queueType);
+        CommandListWrapper(DeviceWrapper* device, ICommandList* commandList, bool isImmediate, bool isBundle, CommandQueue queueType);
+
+        void setFullValidationRequested(bool enable) { m_FullValidationRequested = enable; }
 
     protected:
         CommandListHandle m_CommandList;
         RefCountPtr<DeviceWrapper> m_Device;
         IMessageCallback* m_MessageCallback;
         bool m_IsImmediate;
+        bool m_IsBundle;
         CommandQueue m_type;
 
         CommandListState m_State = CommandListState::INITIAL;
@@ -117,6 +124,7 @@ namespace nvrhi::validation
         bool m_MeshletStateSet = false;
         bool m_RayTracingStateSet = false;
         GraphicsState m_CurrentGraphicsState;
+        IGraphicsStateBlock* m_CurrentGraphicsStateBlock = nullptr;
         ComputeState m_CurrentComputeState;
         MeshletState m_CurrentMeshletState;
         rt::State m_CurrentRayTracingState;
@@ -124,18 +132,81 @@ namespace nvrhi::validation
         size_t m_PipelinePushConstantSize = 0;
         bool m_PushConstantsSet = false;
 
+        // Bindings provided with setPushBindings since the last set*State call, with the original resource handles
+        PushBindings m_PushBindings;
+
+        // TLAS and instance count from beginTopLevelInstanceWrite, waiting for commitTopLevelInstanceWrite
+        rt::IAccelStruct* m_PendingInstanceWriteAS = nullptr;
+        size_t m_PendingInstanceWriteCount = 0;
+
+        // All graphics states in a bundle must use the same viewports
+        bool m_BundleViewportSet = false;
+        ViewportState m_BundleViewport;
+
+        // Validation level of the current recording, chosen in open()
+        bool m_FullValidation = true;
+        bool m_FullValidationRequested = false;
+
+        // Combinations of a pipeline, framebuffer, and binding set layouts that passed the compatibility checks
+        // in the current recording. Only used with lightweight validation.
+        struct BindingCompatibilityKey
+        {
+            const void* pipeline = nullptr;
+            IFramebuffer* framebuffer = nullptr;
+            uint32_t numLayouts = 0;
+            uint32_t numSets = 0;
+            std::array<IBindingLayout*, c_MaxBindingLayouts> setLayouts{};
+
+            bool operator==(const BindingCompatibilityKey& other) const
+            {
+                return pipeline == other.pipeline
+                    && framebuffer == other.framebuffer
+                    && numLayouts == other.numLayouts
+                    && numSets == other.numSets
+                    && setLayouts == other.setLayouts;
+            }
+        };
+
+        struct BindingCompatibilityKeyHash
+        {
+            size_t operator()(const BindingCompatibilityKey& key) const
+            {
+                size_t hash = 0;
+                hash_combine(hash, key.pipeline);
+                hash_combine(hash, key.framebuffer);
+                hash_combine(hash, key.numSets);
+                for (uint32_t index = 0; index < key.numSets; index++)
+                    hash_combine(hash, key.setLayouts[index]);
+                return hash;
+            }
+        };
+
+        std::unordered_set<BindingCompatibilityKey, BindingCompatibilityKeyHash> m_CompatibleBindings;
+
         void error(const std::string& messageText) const;
         void warning(const std::string& messageText) const;
 
         bool requireOpenState() const;
         bool requireExecuteState();
         bool requireType(CommandQueue queueType, const char* operation) const;
+        bool requireNotBundle(const char* operation) const;
+        bool requireNodeAccess(uint32_t creationNodeMask, uint32_t visibleNodeMask, const std::string& debugName, const char* operation) const;
         ICommandList* getUnderlyingCommandList() const { return m_CommandList; }
 
         void evaluatePushConstantSize(const nvrhi::BindingLayoutVector& bindingLayouts);
         bool validatePushConstants(const char* pipelineType, const char* stateFunctionName) const;
+        bool validateDrawIndirectCount(uint32_t countOffsetBytes, const char* operation);
+        bool validateIndirectArgumentBuffer(IBuffer* buffer, const CommandSignatureDesc& signatureDesc, uint32_t offsetBytes, uint32_t maxCommandCount);
+        bool validateGraphicsState(const GraphicsState& state);
+        bool validateMultiDraw(const MultiDrawArguments& multiDraw, bool indexed, const char* operation);
+        void updateStateAfterMultiDraw(const MultiDrawArguments& multiDraw);
+        bool validateDispatchMeshIndirect(bool useCountBuffer, uint32_t countOffsetBytes, const char* operation);
         bool validateBindingSetsAgainstLayouts(const static_vector<BindingLayoutHandle, c_MaxBindingLayouts>& layouts, const static_vector<IBindingSet*, c_MaxBindingLayouts>& sets) const;
+        bool getBindingCompatibilityKey(const void* pipeline, IFramebuffer* framebuffer, const BindingLayoutVector& layouts,
+            const static_vector<IBindingSet*, c_MaxBindingLayouts>& sets, BindingCompatibilityKey& key) const;
+        bool validateBindingSetsCached(const void* pipeline, const BindingLayoutVector& layouts, const static_vector<IBindingSet*, c_MaxBindingLayouts>& sets);
 
+        bool validateBuildBottomLevelAccelStruct(AccelStructWrapper* wrapper, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags, const char* functionName) const;
         bool validateBuildTopLevelAccelStruct(AccelStructWrapper* wrapper, size_t numInstances, rt::AccelStructBuildFlags buildFlags) const;
 
     public:
@@ -158,6 +229,7 @@ namespace nvrhi::validation
         void copyTexture(IStagingTexture* dest, const TextureSlice& destSlice, ITexture* src, const TextureSlice& srcSlice) override;
         void copyTexture(ITexture* dest, const TextureSlice& destSlice, IStagingTexture* src, const TextureSlice& srcSlice) override;
         void writeTexture(ITexture* dest, uint32_t arraySlice, uint32_t mipLevel, const void* data, size_t rowPitch, size_t depthPitch) override;
+        void writeTextureRegions(ITexture* dest, const TextureUploadRegion* regions, size_t numRegions) override;
         void resolveTexture(ITexture* dest, const TextureSubresourceSet& dstSubresources, ITexture* src, const TextureSubresourceSet& srcSubresources) override;
 
         void writeBuffer(IBuffer* b, const void* data, size_t dataSize, uint64_t destOffsetBytes) override;
@@ -165,35 +237,57 @@ namespace nvrhi::validation
         void copyBuffer(IBuffer* dest, uint64_t destOffsetBytes, IBuffer* src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes) override;
 
         void setPushConstants(const void* data, size_t byteSize) override;
+        void setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings) override;
+        BindingSetHandle createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout) override;
 
         void setGraphicsState(const GraphicsState& state) override;
+        void setGraphicsStateBlock(IGraphicsStateBlock* block) override;
         void draw(const DrawArguments& args) override;
         void drawIndexed(const DrawArguments& args) override;
+        void drawMulti(const MultiDrawArguments& multiDraw) override;
+        void drawIndexedMulti(const MultiDrawArguments& multiDraw) override;
         void drawIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
         void drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void executeBundles(ICommandList* const* bundles, size_t numBundles) override;
 
         void setComputeState(const ComputeState& state) override;
         void dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
         void dispatchIndirect(uint32_t offsetBytes)  override;
+        void executeIndirect(ICommandSignature* signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes) override;
 
         void setMeshletState(const MeshletState& state) override;
         void dispatchMesh(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
+        void dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
 
         void setRayTracingState(const rt::State& state) override;
         void dispatchRays(const rt::DispatchRaysArguments& args) override;
 
         void buildOpacityMicromap(rt::IOpacityMicromap* omm, const rt::OpacityMicromapDesc& desc) override;
         void buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags) override;
+        void buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds) override;
         void compactBottomLevelAccelStructs() override;
         void buildTopLevelAccelStruct(rt::IAccelStruct* as, const rt::InstanceDesc* pInstances, size_t numInstances, rt::AccelStructBuildFlags buildFlags) override;
         void buildTopLevelAccelStructFromBuffer(rt::IAccelStruct* as, nvrhi::IBuffer* instanceBuffer, uint64_t instanceBufferOffset, size_t numInstances,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) override;
+        rt::InstanceDesc* beginTopLevelInstanceWrite(rt::IAccelStruct* as, size_t numInstances) override;
+        void commitTopLevelInstanceWrite(rt::IAccelStruct* as, rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None,
+            rt::IAccelStruct* const* bottomLevelASes = nullptr, size_t numBottomLevelASes = 0) override;
 
         void beginTimerQuery(ITimerQuery* query) override;
         void endTimerQuery(ITimerQuery* query) override;
+        void beginOcclusionQuery(IOcclusionQuery* query) override;
+        void endOcclusionQuery(IOcclusionQuery* query) override;
+        void beginPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void endPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* buffer, uint64_t offsetBytes) override;
+        void setPredication(IBuffer* buffer, uint64_t offsetBytes, PredicationOp op) override;
 
         void beginMarker(const char* name) override;
         void endMarker() override;
+        void setGpuProfiler(IGpuProfiler* profiler) override;
 
         void setEnableAutomaticBarriers(bool enable) override;
         void setResourceStatesForBindingSet(IBindingSet* bindingSet) override;
@@ -206,18 +300,23 @@ namespace nvrhi::validation
 
         void setTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override;
         void setBufferState(IBuffer* buffer, ResourceStates stateBits) override;
+        void beginTextureStateTransition(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override;
+        void beginBufferStateTransition(IBuffer* buffer, ResourceStates stateBits) override;
         void setAccelStructState(rt::IAccelStruct* as, ResourceStates stateBits) override;
 
         void setPermanentTextureState(ITexture* texture, ResourceStates stateBits) override;
         void setPermanentBufferState(IBuffer* buffer, ResourceStates stateBits) override;
 
         void commitBarriers() override;
+        void aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter) override;
         
         ResourceStates getTextureSubresourceState(ITexture* texture, ArraySlice arraySlice, MipLevel mipLevel) override;
         ResourceStates getBufferState(IBuffer* buffer) override;
 
         IDevice* getDevice() override;
         const CommandListParameters& getDesc() override;
+        UploadStatistics getUploadStatistics() override;
+        CommandListStatistics getStatistics() override;
     };
 
     class DeviceWrapper : public RefCounter<IDevice>
@@ -225,20 +324,27 @@ namespace nvrhi::validation
     public:
         friend class CommandListWrapper;
 
-        DeviceWrapper(IDevice* device);
+        DeviceWrapper(IDevice* device, const ValidationLayerDesc& desc);
         
     protected:
         DeviceHandle m_Device;
         IMessageCallback* m_MessageCallback;
         std::atomic<unsigned int> m_NumOpenImmediateCommandLists = 0;
+        ValidationLayerDesc m_Desc;
+        std::atomic<uint64_t> m_FrameIndex = 0;
+
+        [[nodiscard]] bool isFullValidationFrame() const;
 
         void error(const std::string& messageText) const;
         void warning(const std::string& messageText) const;
 
         bool validateBindingSetItem(const BindingSetItem& binding, bool isDescriptorTable, std::stringstream& errorStream);
+        bool validateBindingSetDesc(const BindingSetDesc& desc, IBindingLayout* layout);
         bool validatePipelineBindingLayouts(const static_vector<BindingLayoutHandle, c_MaxBindingLayouts>& bindingLayouts, const std::vector<IShader*>& shaders) const;
         bool validateShaderType(ShaderType expected, const ShaderDesc& shaderDesc, const char* function) const;
         bool validateRenderState(const RenderState& renderState, IFramebuffer* fb) const;
+        bool validateMapBuffer(IBuffer* buffer, CpuAccessMode cpuAccess, const char* function) const;
+        bool validateNodeMask(uint32_t nodeMask, const std::string& objectName, const char* maskName) const;
 
     public:
 
@@ -253,6 +359,10 @@ namespace nvrhi::validation
         TextureHandle createTexture(const TextureDesc& d) override;
         MemoryRequirements getTextureMemoryRequirements(ITexture* texture) override;
         bool bindTextureMemory(ITexture* texture, IHeap* heap, uint64_t offset) override;
+        void getTextureTiling(ITexture* texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+            uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings) override;
+        void updateTextureTileMappings(ITexture* texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings,
+            CommandQueue executionQueue = CommandQueue::Graphics) override;
 
         TextureHandle createHandleForNativeTexture(ObjectType objectType, Object texture, const TextureDesc& desc) override;
 
@@ -263,6 +373,7 @@ namespace nvrhi::validation
         BufferHandle createBuffer(const BufferDesc& d) override;
         void *mapBuffer(IBuffer* b, CpuAccessMode mapFlags) override;
         void unmapBuffer(IBuffer* b) override;
+        void *tryMapBuffer(IBuffer* b, CpuAccessMode mapFlags, SubmissionId* outLastUse) override;
         MemoryRequirements getBufferMemoryRequirements(IBuffer* buffer) override;
         bool bindBufferMemory(IBuffer* buffer, IHeap* heap, uint64_t offset) override;
 
@@ -288,18 +399,34 @@ namespace nvrhi::validation
         bool pollTimerQuery(ITimerQuery* query) override;
         float getTimerQueryTime(ITimerQuery* query) override;
         void resetTimerQuery(ITimerQuery* query) override;
+        GpuProfilerHandle createGpuProfiler(const GpuProfilerDesc& desc) override;
+        OcclusionQueryHandle createOcclusionQuery(const OcclusionQueryDesc& desc) override;
+        bool pollOcclusionQuery(IOcclusionQuery* query) override;
+        uint64_t getOcclusionQueryResult(IOcclusionQuery* query) override;
+        void resetOcclusionQuery(IOcclusionQuery* query) override;
+        PipelineStatisticsQueryHandle createPipelineStatisticsQuery() override;
+        bool pollPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        PipelineStatistics getPipelineStatistics(IPipelineStatisticsQuery* query) override;
+        void resetPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
 
         GraphicsAPI getGraphicsAPI() override;
 
         FramebufferHandle createFramebuffer(const FramebufferDesc& desc) override;
 
         GraphicsPipelineHandle createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb) override;
+        GraphicsStateBlockHandle createGraphicsStateBlock(const GraphicsState& state) override;
 
         ComputePipelineHandle createComputePipeline(const ComputePipelineDesc& desc) override;
 
         MeshletPipelineHandle createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb) override;
 
         rt::PipelineHandle createRayTracingPipeline(const rt::PipelineDesc& desc) override;
+        CommandSignatureHandle createCommandSignature(const CommandSignatureDesc& desc) override;
+        bool exportPipelineCache(std::vector<uint8_t>& outData) override;
+        bool importPipelineCache(const void* data, size_t dataSize) override;
+        void setTaskScheduler(ITaskScheduler* scheduler) override;
+        void setTraceRecorder(ITraceRecorder* recorder) override;
+        ITaskScheduler* getTaskScheduler() override;
 
         BindingLayoutHandle createBindingLayout(const BindingLayoutDesc& desc) override;
         BindingLayoutHandle createBindlessLayout(const BindlessLayoutDesc& desc) override;
@@ -309,6 +436,7 @@ namespace nvrhi::validation
 
         void resizeDescriptorTable(IDescriptorTable* descriptorTable, uint32_t newSize, bool keepContents = true) override;
         bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem& item) override;
+        bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem* items, size_t numItems) override;
 
         rt::OpacityMicromapHandle createOpacityMicromap(const rt::OpacityMicromapDesc& desc)  override;
         rt::AccelStructHandle createAccelStruct(const rt::AccelStructDesc& desc) override;
@@ -319,7 +447,16 @@ namespace nvrhi::validation
         uint64_t executeCommandLists(ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue = CommandQueue::Graphics) override;
         void queueWaitForCommandList(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance) override;
         void waitForIdle() override;
+        void setDeferredSubmission(bool enable) override;
+        void flushSubmissions() override;
+        bool waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds) override;
         void runGarbageCollection() override;
+        bool runGarbageCollection(uint32_t maxMicroseconds) override;
+        MemoryStatistics getMemoryStatistics() override;
+        CommandListStatistics getCommandListStatistics(bool reset) override;
+        void setObjectCacheEnabled(bool enable) override;
+        ObjectCacheStatistics getObjectCacheStatistics(bool reset) override;
+        void setMemoryBudgetCallback(IMemoryBudgetCallback* callback) override;
         bool queryFeatureSupport(Feature feature, void* pInfo = nullptr, size_t infoSize = 0) override;
         FormatSupport queryFormatSupport(Format format) override;
         Object getNativeQueue(ObjectType objectType, CommandQueue queue) override;
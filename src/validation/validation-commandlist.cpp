@@ -31,11 +31,12 @@
 namespace nvrhi::validation
 {
 
-    CommandListWrapper::CommandListWrapper(DeviceWrapper* device, ICommandList* commandList, bool isImmediate, CommandQueue queueType)
+    CommandListWrapper::CommandListWrapper(DeviceWrapper* device, ICommandList* commandList, bool isImmediate, bool isBundle, CommandQueue queueType)
         : m_CommandList(commandList)
         , m_Device(device)
         , m_MessageCallback(device->getMessageCallback())
         , m_IsImmediate(isImmediate)
+        , m_IsBundle(isBundle)
         , m_type(queueType)
     {
     }
@@ -81,6 +82,22 @@ namespace nvrhi::validation
         }
     }
 
+    // Extended dynamic state can only change the primitive type within one of these classes
+    static int GetPrimitiveTopologyClass(PrimitiveType type)
+    {
+        switch (type)
+        {
+        case PrimitiveType::PointList:
+            return 0;
+        case PrimitiveType::LineList:
+            return 1;
+        case PrimitiveType::PatchList:
+            return 3;
+        default:
+            return 2;
+        }
+    }
+
     bool CommandListWrapper::requireOpenState() const
     {
         if (m_State == CommandListState::OPEN)
@@ -128,6 +145,48 @@ namespace nvrhi::validation
         return true;
     }
 
+    bool CommandListWrapper::requireNotBundle(const char* operation) const
+    {
+        if (m_IsBundle)
+        {
+            std::stringstream ss;
+            ss << "The '" << operation << "' operation cannot be recorded into a bundle command list";
+            error(ss.str());
+
+            return false;
+        }
+
+        return true;
+    }
+
+    bool CommandListWrapper::requireNodeAccess(uint32_t creationNodeMask, uint32_t visibleNodeMask, const std::string& debugName, const char* operation) const
+    {
+        const uint32_t listNodeMask = m_CommandList->getDesc().nodeMask;
+        if (listNodeMask <= 1 && creationNodeMask <= 1 && visibleNodeMask <= 1)
+            return true;
+
+        // DX12 resources are accessible from the nodes in their visible mask, node 0 by default.
+        // Vulkan resources have memory only on the devices in their creation mask, all devices by default,
+        // and there is no peer memory binding for access from the other devices.
+        uint32_t accessibleMask;
+        if (m_Device->getGraphicsAPI() == GraphicsAPI::VULKAN)
+            accessibleMask = creationNodeMask ? creationNodeMask : ~0u;
+        else
+            accessibleMask = (creationNodeMask | visibleNodeMask) ? (creationNodeMask | visibleNodeMask) : 1u;
+
+        const uint32_t executingMask = listNodeMask ? listNodeMask : 1u;
+        if ((executingMask & ~accessibleMask) != 0)
+        {
+            std::stringstream ss;
+            ss << operation << ": Resource " << debugName << " is not accessible from all nodes of the command list (nodeMask = 0x"
+               << std::hex << executingMask << ", resource nodes = 0x" << accessibleMask << std::dec << ")";
+            error(ss.str());
+            return false;
+        }
+
+        return true;
+    }
+
     Object CommandListWrapper::getNativeObject(ObjectType objectType)
     {
         return m_CommandList->getNativeObject(objectType);
@@ -148,7 +207,8 @@ namespace nvrhi::validation
             }
             else
             {
-                warning("A command list should be executed before it is reopened");
+                if (!m_IsBundle)
+                    warning("A command list should be executed before it is reopened");
                 break;
             }
         case CommandListState::INITIAL:
@@ -169,9 +229,13 @@ namespace nvrhi::validation
         m_CommandList->open();
 
         m_State = CommandListState::OPEN;
+        m_FullValidation = m_FullValidationRequested || m_Device->isFullValidationFrame();
+        m_CompatibleBindings.clear();
+        m_BundleViewportSet = false;
         m_GraphicsStateSet = false;
         m_ComputeStateSet = false;
         m_MeshletStateSet = false;
+        m_PendingInstanceWriteAS = nullptr;
     }
 
     void CommandListWrapper::close()
@@ -189,6 +253,15 @@ namespace nvrhi::validation
             break;
         }
 
+        if (m_PendingInstanceWriteAS)
+        {
+            std::stringstream ss;
+            ss << "The instance write for TLAS " << utils::DebugNameToString(m_PendingInstanceWriteAS->getDesc().debugName)
+                << " started with beginTopLevelInstanceWrite was never committed";
+            error(ss.str());
+            m_PendingInstanceWriteAS = nullptr;
+        }
+
         if (m_IsImmediate)
         {
             --m_Device->m_NumOpenImmediateCommandLists;
@@ -207,6 +280,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("clearTextureFloat"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "clearTextureFloat"))
             return;
 
@@ -248,6 +324,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("clearDepthStencilTexture"))
+            return;
+
         if (!requireType(CommandQueue::Graphics, "clearDepthStencilTexture"))
             return;
 
@@ -278,6 +357,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("clearTextureUInt"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "clearTextureUInt"))
             return;
 
@@ -318,7 +400,20 @@ namespace nvrhi::validation
     {
         if (!requireOpenState())
             return;
-        
+
+        if (!requireNotBundle("copyTexture"))
+            return;
+
+        if (!dest || !src)
+        {
+            error("copyTexture: dest or src is NULL");
+            return;
+        }
+
+        if (!requireNodeAccess(dest->getDesc().creationNodeMask, dest->getDesc().visibleNodeMask, utils::DebugNameToString(dest->getDesc().debugName), "copyTexture") ||
+            !requireNodeAccess(src->getDesc().creationNodeMask, src->getDesc().visibleNodeMask, utils::DebugNameToString(src->getDesc().debugName), "copyTexture"))
+            return;
+
         m_CommandList->copyTexture(dest, destSlice, src, srcSlice);
     }
 
@@ -327,6 +422,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("copyTexture"))
+            return;
+
         m_CommandList->copyTexture(dest, destSlice, src, srcSlice);
     }
 
@@ -335,6 +433,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("copyTexture"))
+            return;
+
         m_CommandList->copyTexture(dest, destSlice, src, srcSlice);
     }
 
@@ -343,6 +444,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("writeTexture"))
+            return;
+
         if (dest->getDesc().height > 1 && rowPitch == 0)
         {
             error("writeTexture: rowPitch is 0 but dest has multiple rows");
@@ -351,11 +455,70 @@ namespace nvrhi::validation
         m_CommandList->writeTexture(dest, arraySlice, mipLevel, data, rowPitch, depthPitch);
     }
 
+    void CommandListWrapper::writeTextureRegions(ITexture* dest, const TextureUploadRegion* regions, size_t numRegions)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("writeTextureRegions"))
+            return;
+
+        if (!dest)
+        {
+            error("writeTextureRegions: dest is NULL");
+            return;
+        }
+
+        if (numRegions != 0 && !regions)
+        {
+            error("writeTextureRegions: regions is NULL");
+            return;
+        }
+
+        const TextureDesc& desc = dest->getDesc();
+
+        for (size_t i = 0; i < numRegions; i++)
+        {
+            const TextureUploadRegion& region = regions[i];
+
+            if (region.mipLevel >= desc.mipLevels || region.arraySlice >= desc.arraySize)
+            {
+                std::stringstream ss;
+                ss << "writeTextureRegions: region " << i << " refers to mip level " << region.mipLevel << ", array slice " << region.arraySlice
+                   << ", which does not exist in texture " << utils::DebugNameToString(desc.debugName)
+                   << " (mipLevels = " << desc.mipLevels << ", arraySize = " << desc.arraySize << ")";
+                error(ss.str());
+                return;
+            }
+
+            if (!region.data)
+            {
+                std::stringstream ss;
+                ss << "writeTextureRegions: region " << i << " has no data";
+                error(ss.str());
+                return;
+            }
+
+            if (desc.height > 1 && region.rowPitch == 0)
+            {
+                std::stringstream ss;
+                ss << "writeTextureRegions: region " << i << " has rowPitch = 0 but dest has multiple rows";
+                error(ss.str());
+                return;
+            }
+        }
+
+        m_CommandList->writeTextureRegions(dest, regions, numRegions);
+    }
+
     void CommandListWrapper::resolveTexture(ITexture* dest, const TextureSubresourceSet& dstSubresources, ITexture* src, const TextureSubresourceSet& srcSubresources)
     {
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("resolveTexture"))
+            return;
+
         if (!requireType(CommandQueue::Graphics, "resolveTexture"))
             return;
 
@@ -427,6 +590,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("writeBuffer"))
+            return;
+
         if (dataSize + destOffsetBytes > b->getDesc().byteSize)
         {
             error("writeBuffer: dataSize + destOffsetBytes is greater than the buffer size");
@@ -453,6 +619,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("clearBufferUInt"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "clearBufferUInt"))
             return;
 
@@ -464,6 +633,19 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("copyBuffer"))
+            return;
+
+        if (!dest || !src)
+        {
+            error("copyBuffer: dest or src is NULL");
+            return;
+        }
+
+        if (!requireNodeAccess(dest->getDesc().creationNodeMask, dest->getDesc().visibleNodeMask, utils::DebugNameToString(dest->getDesc().debugName), "copyBuffer") ||
+            !requireNodeAccess(src->getDesc().creationNodeMask, src->getDesc().visibleNodeMask, utils::DebugNameToString(src->getDesc().debugName), "copyBuffer"))
+            return;
+
         m_CommandList->copyBuffer(dest, destOffsetBytes, src, srcOffsetBytes, dataSizeBytes);
     }
 
@@ -482,6 +664,41 @@ namespace nvrhi::validation
 
         for (int index = 0; index < int(layouts.size()); index++)
         {
+            const BindingLayoutDesc* expectedDesc = layouts[index]->getDesc();
+            if (expectedDesc && expectedDesc->usePushDescriptors)
+            {
+                const BindingSetDesc* pushedDesc = m_PushBindings.get(uint32_t(index));
+                std::stringstream ss;
+
+                if (sets[index] != nullptr)
+                    ss << "Binding set in slot " << index << " must be NULL because the layout uses push descriptors";
+                else if (!pushedDesc)
+                    ss << "No push bindings are provided for slot " << index << ", call setPushBindings before setting the state";
+                else if (pushedDesc->bindings.size() != expectedDesc->bindings.size())
+                    ss << "Push bindings for slot " << index << " contain " << pushedDesc->bindings.size()
+                       << " items while the layout declares " << expectedDesc->bindings.size();
+                else
+                {
+                    for (size_t item = 0; item < pushedDesc->bindings.size(); item++)
+                    {
+                        const BindingSetItem& binding = pushedDesc->bindings[item];
+                        const BindingLayoutItem& layoutItem = expectedDesc->bindings[item];
+                        if (binding.type != layoutItem.type || binding.slot != layoutItem.slot)
+                        {
+                            ss << "Push binding " << item << " for slot " << index << " does not match the layout item";
+                            break;
+                        }
+                    }
+                }
+
+                if (ss.tellp() > 0)
+                {
+                    error(ss.str());
+                    anyErrors = true;
+                }
+                continue;
+            }
+
             if (sets[index] == nullptr)
             {
                 std::stringstream ss;
@@ -516,6 +733,46 @@ namespace nvrhi::validation
         return !anyErrors;
     }
 
+    bool CommandListWrapper::getBindingCompatibilityKey(const void* pipeline, IFramebuffer* framebuffer, const BindingLayoutVector& layouts,
+        const static_vector<IBindingSet*, c_MaxBindingLayouts>& sets, BindingCompatibilityKey& key) const
+    {
+        // Push descriptor slots are validated against the bindings provided with setPushBindings, which change between calls
+        for (IBindingLayout* layout : layouts)
+        {
+            const BindingLayoutDesc* layoutDesc = layout ? layout->getDesc() : nullptr;
+            if (layoutDesc && layoutDesc->usePushDescriptors)
+                return false;
+        }
+
+        key.pipeline = pipeline;
+        key.framebuffer = framebuffer;
+        key.numLayouts = uint32_t(layouts.size());
+        key.numSets = uint32_t(sets.size());
+
+        for (size_t index = 0; index < sets.size(); index++)
+            key.setLayouts[index] = sets[index] ? sets[index]->getLayout() : nullptr;
+
+        return true;
+    }
+
+    bool CommandListWrapper::validateBindingSetsCached(const void* pipeline, const BindingLayoutVector& layouts,
+        const static_vector<IBindingSet*, c_MaxBindingLayouts>& sets)
+    {
+        BindingCompatibilityKey key;
+        const bool cacheable = !m_FullValidation && getBindingCompatibilityKey(pipeline, nullptr, layouts, sets, key);
+
+        if (cacheable && m_CompatibleBindings.find(key) != m_CompatibleBindings.end())
+            return true;
+
+        if (!validateBindingSetsAgainstLayouts(layouts, sets))
+            return false;
+
+        if (cacheable)
+            m_CompatibleBindings.insert(key);
+
+        return true;
+    }
+
     void CommandListWrapper::setPushConstants(const void* data, size_t byteSize)
     {
         if (!requireOpenState())
@@ -553,118 +810,316 @@ namespace nvrhi::validation
         m_CommandList->setPushConstants(data, byteSize);
     }
 
-    void CommandListWrapper::setGraphicsState(const GraphicsState& state)
+    void CommandListWrapper::setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings)
     {
         if (!requireOpenState())
             return;
 
-        if (!requireType(CommandQueue::Graphics, "setGraphicsState"))
+        if (layoutIndex >= c_MaxBindingLayouts)
+        {
+            std::stringstream ss;
+            ss << "Push bindings layout index (" << layoutIndex << ") must be less than " << c_MaxBindingLayouts;
+            error(ss.str());
             return;
+        }
 
-        bool anyErrors = false;
-        std::stringstream ss;
-        ss << "setGraphicsState: " << std::endl;
+        m_PushBindings.set(layoutIndex, bindings);
 
-        if (!state.pipeline)
+        // Unwrap the resources
+        BindingSetDesc patchedDesc = bindings;
+        for (auto& binding : patchedDesc.bindings)
         {
-            ss << "pipeline is NULL." << std::endl;
-            anyErrors = true;
+            binding.resourceHandle = unwrapResource(binding.resourceHandle);
         }
 
-        if (!state.framebuffer)
+        m_CommandList->setPushBindings(layoutIndex, patchedDesc);
+    }
+
+    BindingSetHandle CommandListWrapper::createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+    {
+        if (!requireOpenState())
+            return nullptr;
+
+        if (m_FullValidation)
         {
-            ss << "framebuffer is NULL." << std::endl;
-            anyErrors = true;
+            if (!m_Device->validateBindingSetDesc(desc, layout))
+                return nullptr;
+        }
+        else if (!layout)
+        {
+            error("createTransientBindingSet: layout is NULL");
+            return nullptr;
         }
 
-        if (state.indexBuffer.buffer && !state.indexBuffer.buffer->getDesc().isIndexBuffer)
+        // Unwrap the resources
+        BindingSetDesc patchedDesc = desc;
+        for (auto& binding : patchedDesc.bindings)
         {
-            ss << "Cannot use buffer '" << utils::DebugNameToString(state.indexBuffer.buffer->getDesc().debugName) << "' as an index buffer because it does not have the isIndexBuffer flag set." << std::endl;
-            anyErrors = true;
+            binding.resourceHandle = unwrapResource(binding.resourceHandle);
         }
 
-        for (size_t index = 0; index < state.vertexBuffers.size(); index++)
+        return m_CommandList->createTransientBindingSet(patchedDesc, layout);
+    }
+
+    bool CommandListWrapper::validateGraphicsState(const GraphicsState& state)
+    {
+        if (m_FullValidation)
         {
-            const VertexBufferBinding& vb = state.vertexBuffers[index];
+            bool anyErrors = false;
+            std::stringstream ss;
+            ss << "setGraphicsState: " << std::endl;
 
-            if (!vb.buffer)
+            if (!state.pipeline)
             {
-                ss << "Vertex buffer at index " << index << " is NULL." << std::endl;
+                ss << "pipeline is NULL." << std::endl;
                 anyErrors = true;
             }
-            else if (!vb.buffer->getDesc().isVertexBuffer)
+
+            if (!state.framebuffer)
             {
-                ss << "Buffer '" << utils::DebugNameToString(vb.buffer->getDesc().debugName) << "' bound to vertex buffer slot " << index << " cannot be used as a vertex buffer because it does not have the isVertexBuffer flag set." << std::endl;
+                ss << "framebuffer is NULL." << std::endl;
                 anyErrors = true;
             }
 
-            if (vb.slot >= c_MaxVertexAttributes)
+            if (state.indexBuffer.buffer && !state.indexBuffer.buffer->getDesc().isIndexBuffer)
             {
-                ss << "Vertex buffer binding at index " << index << " uses an invalid slot " << vb.slot << "." << std::endl;
+                ss << "Cannot use buffer '" << utils::DebugNameToString(state.indexBuffer.buffer->getDesc().debugName) << "' as an index buffer because it does not have the isIndexBuffer flag set." << std::endl;
                 anyErrors = true;
             }
-        }
 
-        if (state.indirectParams && !state.indirectParams->getDesc().isDrawIndirectArgs)
-        {
-            ss << "Cannot use buffer '" << utils::DebugNameToString(state.indirectParams->getDesc().debugName) << "' as a DrawIndirect argument buffer because it does not have the isDrawIndirectArgs flag set." << std::endl;
-            anyErrors = true;
-        }
+            if (state.pipeline && state.pipeline->getDesc().renderState.extendedDynamicState &&
+                GetPrimitiveTopologyClass(state.dynamicRenderState.primType) != GetPrimitiveTopologyClass(state.pipeline->getDesc().primType))
+            {
+                ss << "The primitive type in dynamicRenderState must be in the same topology class as the primitive type of the pipeline." << std::endl;
+                anyErrors = true;
+            }
 
-        if (anyErrors)
-        {
-            error(ss.str());
-            return;
-        }
+            for (size_t index = 0; index < state.vertexBuffers.size(); index++)
+            {
+                const VertexBufferBinding& vb = state.vertexBuffers[index];
 
-        if (!validateBindingSetsAgainstLayouts(state.pipeline->getDesc().bindingLayouts, state.bindings))
-            anyErrors = true;
+                if (!vb.buffer)
+                {
+                    ss << "Vertex buffer at index " << index << " is NULL." << std::endl;
+                    anyErrors = true;
+                }
+                else if (!vb.buffer->getDesc().isVertexBuffer)
+                {
+                    ss << "Buffer '" << utils::DebugNameToString(vb.buffer->getDesc().debugName) << "' bound to vertex buffer slot " << index << " cannot be used as a vertex buffer because it does not have the isVertexBuffer flag set." << std::endl;
+                    anyErrors = true;
+                }
 
-        if (state.framebuffer->getFramebufferInfo() != state.pipeline->getFramebufferInfo())
-        {
-            ss << "The framebuffer used in the draw call does not match the framebuffer used to create the pipeline." << std::endl <<
-                "Formats and sample counts of the framebuffers must match." << std::endl;
-            anyErrors = true;
-        }
+                if (vb.slot >= c_MaxVertexAttributes)
+                {
+                    ss << "Vertex buffer binding at index " << index << " uses an invalid slot " << vb.slot << "." << std::endl;
+                    anyErrors = true;
+                }
+            }
 
-        if (anyErrors)
-        {
-            error(ss.str());
-            return;
-        }
+            if (state.indirectParams && !state.indirectParams->getDesc().isDrawIndirectArgs)
+            {
+                ss << "Cannot use buffer '" << utils::DebugNameToString(state.indirectParams->getDesc().debugName) << "' as a DrawIndirect argument buffer because it does not have the isDrawIndirectArgs flag set." << std::endl;
+                anyErrors = true;
+            }
 
-        evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+            if (state.indirectCountBuffer && !state.indirectCountBuffer->getDesc().isDrawIndirectArgs)
+            {
+                ss << "Cannot use buffer '" << utils::DebugNameToString(state.indirectCountBuffer->getDesc().debugName) << "' as a DrawIndirect count buffer because it does not have the isDrawIndirectArgs flag set." << std::endl;
+                anyErrors = true;
+            }
 
-        m_CommandList->setGraphicsState(state);
+            if (m_IsBundle)
+            {
+                if (state.framebuffer != m_CommandList->getDesc().bundleFramebuffer)
+                {
+                    ss << "All graphics states in a bundle must use the framebuffer specified in CommandListParameters::bundleFramebuffer." << std::endl;
+                    anyErrors = true;
+                }
 
-        m_GraphicsStateSet = true;
-        m_ComputeStateSet = false;
-        m_MeshletStateSet = false;
-        m_RayTracingStateSet = false;
-        m_PushConstantsSet = false;
-        m_CurrentGraphicsState = state;
-    }
+                if (m_BundleViewportSet && (arraysAreDifferent(state.viewport.viewports, m_BundleViewport.viewports) ||
+                    arraysAreDifferent(state.viewport.scissorRects, m_BundleViewport.scissorRects)))
+                {
+                    ss << "All graphics states in a bundle must use the same viewports and scissor rects." << std::endl;
+                    anyErrors = true;
+                }
 
-    void CommandListWrapper::draw(const DrawArguments& args)
-    {
-        if (!requireOpenState())
-            return;
+                if (state.shadingRateState.enabled)
+                {
+                    ss << "Variable rate shading cannot be used in a bundle." << std::endl;
+                    anyErrors = true;
+                }
 
-        if (!requireType(CommandQueue::Graphics, "draw"))
-            return;
+                for (IBindingSet* bindingSet : state.bindings)
+                {
+                    const BindingSetDesc* bindingSetDesc = bindingSet ? bindingSet->getDesc() : nullptr;
+                    if (!bindingSetDesc)
+                        continue;
 
-        if (!m_GraphicsStateSet)
-        {
-            error("Graphics state is not set before a draw call.\n"
-                "Note that setting compute state invalidates the graphics state.");
-            return;
-        }
+                    for (const BindingSetItem& item : bindingSetDesc->bindings)
+                    {
+                        if (item.type == ResourceType::ConstantBuffer && item.resourceHandle &&
+                            checked_cast<IBuffer*>(item.resourceHandle)->getDesc().isVolatile)
+                        {
+                            ss << "Volatile constant buffer '" << utils::DebugNameToString(checked_cast<IBuffer*>(item.resourceHandle)->getDesc().debugName)
+                                << "' cannot be used in a bundle." << std::endl;
+                            anyErrors = true;
+                        }
+                    }
+                }
+            }
 
-        if (!validatePushConstants("graphics", "setGraphicsState"))
-            return;
+            if (anyErrors)
+            {
+                error(ss.str());
+                return false;
+            }
+        }
+        else
+        {
+            if (!state.pipeline || !state.framebuffer)
+            {
+                error("setGraphicsState: pipeline or framebuffer is NULL.");
+                return false;
+            }
 
-        m_CommandList->draw(args);
-    }
+            // The backends dereference the vertex buffers, so NULL ones are reported at every validation level
+            for (size_t index = 0; index < state.vertexBuffers.size(); index++)
+            {
+                if (!state.vertexBuffers[index].buffer)
+                {
+                    std::stringstream ss;
+                    ss << "setGraphicsState: Vertex buffer at index " << index << " is NULL.";
+                    error(ss.str());
+                    return false;
+                }
+            }
+        }
+
+        BindingCompatibilityKey compatibilityKey;
+        const bool cacheable = !m_FullValidation && getBindingCompatibilityKey(state.pipeline, state.framebuffer,
+            state.pipeline->getDesc().bindingLayouts, state.bindings, compatibilityKey);
+
+        if (!cacheable || m_CompatibleBindings.find(compatibilityKey) == m_CompatibleBindings.end())
+        {
+            bool incompatible = !validateBindingSetsAgainstLayouts(state.pipeline->getDesc().bindingLayouts, state.bindings);
+
+            if (state.framebuffer->getFramebufferInfo() != state.pipeline->getFramebufferInfo())
+            {
+                error("setGraphicsState: The framebuffer used in the draw call does not match the framebuffer used to create the pipeline.\n"
+                    "Formats and sample counts of the framebuffers must match.");
+                incompatible = true;
+            }
+
+            if (incompatible)
+                return false;
+
+            if (cacheable)
+                m_CompatibleBindings.insert(compatibilityKey);
+        }
+
+        return true;
+    }
+
+    void CommandListWrapper::setGraphicsState(const GraphicsState& state)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "setGraphicsState"))
+            return;
+
+        if (!validateGraphicsState(state))
+            return;
+
+        evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+
+        m_CommandList->setGraphicsState(state);
+        m_PushBindings.clear();
+
+        m_GraphicsStateSet = true;
+        m_ComputeStateSet = false;
+        m_MeshletStateSet = false;
+        m_RayTracingStateSet = false;
+        m_PushConstantsSet = false;
+        m_CurrentGraphicsState = state;
+        m_CurrentGraphicsStateBlock = nullptr;
+
+        if (m_IsBundle)
+        {
+            m_BundleViewport = state.viewport;
+            m_BundleViewportSet = true;
+        }
+    }
+
+    void CommandListWrapper::setGraphicsStateBlock(IGraphicsStateBlock* block)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "setGraphicsStateBlock"))
+            return;
+
+        if (!block)
+        {
+            error("setGraphicsStateBlock: block is NULL");
+            return;
+        }
+
+        const GraphicsState& state = block->getState();
+
+        // The block is immutable, so rebinding the current block only needs validation when something else changed
+        const bool rebinding = block == m_CurrentGraphicsStateBlock && m_GraphicsStateSet && m_PushBindings.empty();
+
+        if (!rebinding)
+        {
+            if (!validateGraphicsState(state))
+                return;
+
+            evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+        }
+
+        m_CommandList->setGraphicsStateBlock(block);
+        m_PushBindings.clear();
+
+        m_GraphicsStateSet = true;
+        m_ComputeStateSet = false;
+        m_MeshletStateSet = false;
+        m_RayTracingStateSet = false;
+        m_PushConstantsSet = false;
+
+        if (!rebinding)
+        {
+            m_CurrentGraphicsState = state;
+            m_CurrentGraphicsStateBlock = block;
+
+            if (m_IsBundle)
+            {
+                m_BundleViewport = state.viewport;
+                m_BundleViewportSet = true;
+            }
+        }
+    }
+
+    void CommandListWrapper::draw(const DrawArguments& args)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "draw"))
+            return;
+
+        if (!m_GraphicsStateSet)
+        {
+            error("Graphics state is not set before a draw call.\n"
+                "Note that setting compute state invalidates the graphics state.");
+            return;
+        }
+
+        if (!validatePushConstants("graphics", "setGraphicsState"))
+            return;
+
+        m_CommandList->draw(args);
+    }
 
     void CommandListWrapper::drawIndexed(const DrawArguments& args)
     {
@@ -693,6 +1148,146 @@ namespace nvrhi::validation
         m_CommandList->drawIndexed(args);
     }
 
+    bool CommandListWrapper::validateMultiDraw(const MultiDrawArguments& multiDraw, bool indexed, const char* operation)
+    {
+        if (!requireOpenState())
+            return false;
+
+        if (!requireType(CommandQueue::Graphics, operation))
+            return false;
+
+        if (!m_GraphicsStateSet)
+        {
+            std::stringstream ss;
+            ss << "Graphics state is not set before a " << operation << " call.\n"
+                "Note that setting compute state invalidates the graphics state.";
+            error(ss.str());
+            return false;
+        }
+
+        if (indexed && m_CurrentGraphicsState.indexBuffer.buffer == nullptr)
+        {
+            std::stringstream ss;
+            ss << "Index buffer is not set before a " << operation << " call";
+            error(ss.str());
+            return false;
+        }
+
+        if (multiDraw.drawCount != 0 && !multiDraw.args)
+        {
+            std::stringstream ss;
+            ss << operation << ": args is NULL";
+            error(ss.str());
+            return false;
+        }
+
+        if (multiDraw.pushConstants)
+        {
+            if (multiDraw.pushConstantsByteSize != m_PipelinePushConstantSize)
+            {
+                std::stringstream ss;
+                ss << operation << ": Push constant size (" << multiDraw.pushConstantsByteSize
+                    << " bytes) doesn't match the size expected by the pipeline (" << m_PipelinePushConstantSize << " bytes)";
+                error(ss.str());
+                return false;
+            }
+
+            if (multiDraw.drawCount > 1 && multiDraw.pushConstantsStride < multiDraw.pushConstantsByteSize)
+            {
+                std::stringstream ss;
+                ss << operation << ": Push constant stride (" << multiDraw.pushConstantsStride
+                    << " bytes) is smaller than the push constant size (" << multiDraw.pushConstantsByteSize << " bytes)";
+                error(ss.str());
+                return false;
+            }
+        }
+        else if (!validatePushConstants("graphics", "setGraphicsState"))
+            return false;
+
+        if (multiDraw.bindingSets)
+        {
+            const BindingLayoutVector& layouts = m_CurrentGraphicsState.pipeline->getDesc().bindingLayouts;
+            const uint32_t index = multiDraw.bindingSetIndex;
+
+            if (index >= layouts.size() || index >= m_CurrentGraphicsState.bindings.size() || !m_CurrentGraphicsState.bindings[index])
+            {
+                std::stringstream ss;
+                ss << operation << ": bindingSetIndex (" << index << ") must refer to a binding set "
+                    "in the current graphics state, and cannot be a slot that uses push bindings";
+                error(ss.str());
+                return false;
+            }
+
+            if (m_FullValidation)
+            {
+                for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+                {
+                    IBindingSet* bindingSet = multiDraw.bindingSets[drawIndex];
+
+                    if (!bindingSet || bindingSet->getLayout() != layouts[index])
+                    {
+                        std::stringstream ss;
+                        ss << operation << ": The binding set for draw " << drawIndex << " is NULL or doesn't use "
+                            "the binding layout at index " << index << " of the pipeline";
+                        error(ss.str());
+                        return false;
+                    }
+
+                    const BindingSetDesc* bindingSetDesc = bindingSet->getDesc();
+                    if (!bindingSetDesc)
+                        continue;
+
+                    for (const BindingSetItem& item : bindingSetDesc->bindings)
+                    {
+                        if (item.type == ResourceType::Texture_UAV || item.type == ResourceType::TypedBuffer_UAV ||
+                            item.type == ResourceType::StructuredBuffer_UAV || item.type == ResourceType::RawBuffer_UAV)
+                        {
+                            std::stringstream ss;
+                            ss << operation << ": The binding set for draw " << drawIndex << " contains UAVs, "
+                                "which are not supported in per-draw binding sets";
+                            error(ss.str());
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void CommandListWrapper::updateStateAfterMultiDraw(const MultiDrawArguments& multiDraw)
+    {
+        if (multiDraw.pushConstants && multiDraw.drawCount != 0)
+            m_PushConstantsSet = true;
+
+        if (multiDraw.bindingSets && multiDraw.drawCount != 0)
+        {
+            m_CurrentGraphicsState.bindings[multiDraw.bindingSetIndex] = multiDraw.bindingSets[multiDraw.drawCount - 1];
+            m_CurrentGraphicsStateBlock = nullptr;
+        }
+    }
+
+    void CommandListWrapper::drawMulti(const MultiDrawArguments& multiDraw)
+    {
+        if (!validateMultiDraw(multiDraw, false, "drawMulti"))
+            return;
+
+        m_CommandList->drawMulti(multiDraw);
+
+        updateStateAfterMultiDraw(multiDraw);
+    }
+
+    void CommandListWrapper::drawIndexedMulti(const MultiDrawArguments& multiDraw)
+    {
+        if (!validateMultiDraw(multiDraw, true, "drawIndexedMulti"))
+            return;
+
+        m_CommandList->drawIndexedMulti(multiDraw);
+
+        updateStateAfterMultiDraw(multiDraw);
+    }
+
     void CommandListWrapper::drawIndirect(uint32_t offsetBytes, uint32_t drawCount)
     {
         if (!requireOpenState())
@@ -747,192 +1342,785 @@ namespace nvrhi::validation
         m_CommandList->drawIndexedIndirect(offsetBytes, drawCount);
     }
 
-    void CommandListWrapper::setComputeState(const ComputeState& state)
+    bool CommandListWrapper::validateDrawIndirectCount(uint32_t countOffsetBytes, const char* operation)
     {
         if (!requireOpenState())
-            return;
+            return false;
 
-        if (!requireType(CommandQueue::Compute, "setComputeState"))
-            return;
+        if (!requireType(CommandQueue::Graphics, operation))
+            return false;
 
-        bool anyErrors = false;
-        std::stringstream ss;
-        ss << "setComputeState: " << std::endl;
+        if (!m_Device->queryFeatureSupport(Feature::DrawIndirectCount))
+        {
+            std::stringstream ss;
+            ss << operation << " is not supported by the device (Feature::DrawIndirectCount).";
+            error(ss.str());
+            return false;
+        }
 
-        if (!state.pipeline)
+        if (!m_GraphicsStateSet)
         {
-            ss << "pipeline is NULL." << std::endl;
-            anyErrors = true;
+            std::stringstream ss;
+            ss << "Graphics state is not set before a " << operation << " call.\n"
+                "Note that setting compute state invalidates the graphics state.";
+            error(ss.str());
+            return false;
         }
 
-        if (state.indirectParams && !state.indirectParams->getDesc().isDrawIndirectArgs)
+        if (!m_CurrentGraphicsState.indirectParams)
         {
-            ss << "Cannot use buffer '" << utils::DebugNameToString(state.indirectParams->getDesc().debugName) << "' as a DispatchIndirect argument buffer because it does not have the isDrawIndirectArgs flag set." << std::endl;
-            anyErrors = true;
+            std::stringstream ss;
+            ss << "Indirect params buffer is not set before a " << operation << " call.";
+            error(ss.str());
+            return false;
         }
 
-        if (anyErrors)
+        if (!m_CurrentGraphicsState.indirectCountBuffer)
         {
+            std::stringstream ss;
+            ss << "Indirect count buffer is not set before a " << operation << " call.";
             error(ss.str());
-            return;
+            return false;
         }
 
-        if (anyErrors)
-            return;
+        if ((countOffsetBytes & 3) != 0 || uint64_t(countOffsetBytes) + sizeof(uint32_t) > m_CurrentGraphicsState.indirectCountBuffer->getDesc().byteSize)
+        {
+            std::stringstream ss;
+            ss << operation << ": count offset " << countOffsetBytes << " must be a multiple of 4 and inside the count buffer '"
+                << utils::DebugNameToString(m_CurrentGraphicsState.indirectCountBuffer->getDesc().debugName) << "'.";
+            error(ss.str());
+            return false;
+        }
 
-        if (!validateBindingSetsAgainstLayouts(state.pipeline->getDesc().bindingLayouts, state.bindings))
-            anyErrors = true;
+        if (!validatePushConstants("graphics", "setGraphicsState"))
+            return false;
 
-        if (anyErrors)
+        return true;
+    }
+
+    void CommandListWrapper::drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        if (!validateDrawIndirectCount(countOffsetBytes, "drawIndirectCount"))
             return;
 
-        evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+        m_CommandList->drawIndirectCount(offsetBytes, countOffsetBytes, maxDrawCount);
+    }
 
-        m_CommandList->setComputeState(state);
+    void CommandListWrapper::drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        if (!validateDrawIndirectCount(countOffsetBytes, "drawIndexedIndirectCount"))
+            return;
 
-        m_GraphicsStateSet = false;
-        m_ComputeStateSet = true;
-        m_MeshletStateSet = false;
-        m_RayTracingStateSet = false;
-        m_PushConstantsSet = false;
-        m_CurrentComputeState = state;
+        m_CommandList->drawIndexedIndirectCount(offsetBytes, countOffsetBytes, maxDrawCount);
     }
 
-    void CommandListWrapper::dispatch(uint32_t groupsX, uint32_t groupsY /*= 1*/, uint32_t groupsZ /*= 1*/)
+    void CommandListWrapper::executeBundles(ICommandList* const* bundles, size_t numBundles)
     {
         if (!requireOpenState())
             return;
 
-        if (!requireType(CommandQueue::Compute, "dispatch"))
+        if (!requireType(CommandQueue::Graphics, "executeBundles"))
             return;
 
-        if (!m_ComputeStateSet)
+        if (!requireNotBundle("executeBundles"))
+            return;
+
+        if (numBundles == 0)
+            return;
+
+        if (!bundles)
         {
-            error("Compute state is not set before a dispatch call.\n"
-                "Note that setting graphics state invalidates the compute state.");
+            error("executeBundles: bundles is NULL");
             return;
         }
 
-        if (!validatePushConstants("compute", "setComputeState"))
+        std::vector<ICommandList*> underlyingBundles;
+        underlyingBundles.reserve(numBundles);
+
+        IFramebuffer* framebuffer = nullptr;
+
+        for (size_t index = 0; index < numBundles; index++)
+        {
+            ICommandList* bundle = bundles[index];
+
+            if (!bundle)
+            {
+                std::stringstream ss;
+                ss << "executeBundles: bundles[" << index << "] is NULL";
+                error(ss.str());
+                return;
+            }
+
+            if (!bundle->getDesc().isBundle)
+            {
+                std::stringstream ss;
+                ss << "executeBundles: bundles[" << index << "] is not a bundle, it must be created with CommandListParameters::isBundle = true";
+                error(ss.str());
+                return;
+            }
+
+            if (index == 0)
+                framebuffer = bundle->getDesc().bundleFramebuffer;
+            else if (bundle->getDesc().bundleFramebuffer != framebuffer)
+            {
+                std::stringstream ss;
+                ss << "executeBundles: bundles[" << index << "] uses a different bundleFramebuffer than bundles[0], "
+                    "all bundles executed in one call must render into the same framebuffer";
+                error(ss.str());
+                return;
+            }
+
+            ICommandList* underlyingBundle = bundle;
+            CommandListWrapper* wrapper = dynamic_cast<CommandListWrapper*>(bundle);
+            if (wrapper)
+            {
+                if (wrapper->m_State != CommandListState::CLOSED)
+                {
+                    std::stringstream ss;
+                    ss << "executeBundles: bundles[" << index << "] must be recorded and closed before it can be executed";
+                    error(ss.str());
+                    return;
+                }
+
+                underlyingBundle = wrapper->getUnderlyingCommandList();
+            }
+
+            underlyingBundles.push_back(underlyingBundle);
+        }
+
+        m_CommandList->executeBundles(underlyingBundles.data(), underlyingBundles.size());
+
+        m_GraphicsStateSet = false;
+        m_ComputeStateSet = false;
+        m_MeshletStateSet = false;
+        m_RayTracingStateSet = false;
+        m_PushConstantsSet = false;
+    }
+
+    void CommandListWrapper::setComputeState(const ComputeState& state)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("setComputeState"))
+            return;
+
+        if (!requireType(CommandQueue::Compute, "setComputeState"))
+            return;
+
+        if (m_FullValidation)
+        {
+            bool anyErrors = false;
+            std::stringstream ss;
+            ss << "setComputeState: " << std::endl;
+
+            if (!state.pipeline)
+            {
+                ss << "pipeline is NULL." << std::endl;
+                anyErrors = true;
+            }
+
+            if (state.indirectParams && !state.indirectParams->getDesc().isDrawIndirectArgs)
+            {
+                ss << "Cannot use buffer '" << utils::DebugNameToString(state.indirectParams->getDesc().debugName) << "' as a DispatchIndirect argument buffer because it does not have the isDrawIndirectArgs flag set." << std::endl;
+                anyErrors = true;
+            }
+
+            if (anyErrors)
+            {
+                error(ss.str());
+                return;
+            }
+        }
+        else if (!state.pipeline)
+        {
+            error("setComputeState: pipeline is NULL.");
+            return;
+        }
+
+        if (!validateBindingSetsCached(state.pipeline, state.pipeline->getDesc().bindingLayouts, state.bindings))
+            return;
+
+        evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+
+        m_CommandList->setComputeState(state);
+        m_PushBindings.clear();
+
+        m_GraphicsStateSet = false;
+        m_ComputeStateSet = true;
+        m_MeshletStateSet = false;
+        m_RayTracingStateSet = false;
+        m_PushConstantsSet = false;
+        m_CurrentComputeState = state;
+    }
+
+    void CommandListWrapper::dispatch(uint32_t groupsX, uint32_t groupsY /*= 1*/, uint32_t groupsZ /*= 1*/)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("dispatch"))
+            return;
+
+        if (!requireType(CommandQueue::Compute, "dispatch"))
+            return;
+
+        if (!m_ComputeStateSet)
+        {
+            error("Compute state is not set before a dispatch call.\n"
+                "Note that setting graphics state invalidates the compute state.");
+            return;
+        }
+
+        if (!validatePushConstants("compute", "setComputeState"))
+            return;
+
+        m_CommandList->dispatch(groupsX, groupsY, groupsZ);
+    }
+
+    void CommandListWrapper::dispatchIndirect(uint32_t offsetBytes)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("dispatchIndirect"))
+            return;
+
+        if (!requireType(CommandQueue::Compute, "dispatchIndirect"))
+            return;
+
+        if (!m_ComputeStateSet)
+        {
+            error("Compute state is not set before a dispatchIndirect call.\n"
+                "Note that setting graphics state invalidates the compute state.");
+            return;
+        }
+
+        if (!m_CurrentComputeState.indirectParams)
+        {
+            error("Indirect params buffer is not set before a dispatchIndirect call.");
+            return;
+        }
+
+        if (!validatePushConstants("compute", "setComputeState"))
+            return;
+
+        m_CommandList->dispatchIndirect(offsetBytes);
+    }
+
+    void CommandListWrapper::executeIndirect(ICommandSignature* signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!signature)
+        {
+            error("executeIndirect: signature is NULL");
+            return;
+        }
+
+        if (!m_Device->queryFeatureSupport(Feature::CommandSignatures))
+        {
+            error("executeIndirect is not supported by the device (Feature::CommandSignatures).");
+            return;
+        }
+
+        const CommandSignatureDesc& signatureDesc = signature->getDesc();
+        const IndirectArgumentType finalType = signatureDesc.arguments.back().type;
+
+        bool changesState = false;
+        for (const IndirectArgumentDesc& argument : signatureDesc.arguments)
+        {
+            if (argument.type == IndirectArgumentType::VertexBuffer || argument.type == IndirectArgumentType::IndexBuffer
+                || argument.type == IndirectArgumentType::PushConstants)
+                changesState = true;
+        }
+
+        if (finalType == IndirectArgumentType::Dispatch)
+        {
+            if (!requireNotBundle("executeIndirect"))
+                return;
+
+            if (!requireType(CommandQueue::Compute, "executeIndirect"))
+                return;
+
+            if (!m_ComputeStateSet)
+            {
+                error("Compute state is not set before an executeIndirect call with a dispatch signature.\n"
+                    "Note that setting graphics state invalidates the compute state.");
+                return;
+            }
+
+            if (!m_CurrentComputeState.indirectParams)
+            {
+                error("Indirect params buffer is not set before an executeIndirect call.");
+                return;
+            }
+
+            if (!validateIndirectArgumentBuffer(m_CurrentComputeState.indirectParams, signatureDesc, offsetBytes, maxCommandCount))
+                return;
+
+            if (!validatePushConstants("compute", "setComputeState"))
+                return;
+
+            m_CommandList->executeIndirect(signature, offsetBytes, maxCommandCount, countOffsetBytes);
+
+            if (changesState)
+                m_ComputeStateSet = false;
+        }
+        else
+        {
+            if (!requireType(CommandQueue::Graphics, "executeIndirect"))
+                return;
+
+            if (!m_GraphicsStateSet)
+            {
+                error("Graphics state is not set before an executeIndirect call with a draw signature.\n"
+                    "Note that setting compute state invalidates the graphics state.");
+                return;
+            }
+
+            if (!m_CurrentGraphicsState.indirectParams)
+            {
+                error("Indirect params buffer is not set before an executeIndirect call.");
+                return;
+            }
+
+            if (!validateIndirectArgumentBuffer(m_CurrentGraphicsState.indirectParams, signatureDesc, offsetBytes, maxCommandCount))
+                return;
+
+            if (m_CurrentGraphicsState.indirectCountBuffer && ((countOffsetBytes & 3) != 0
+                || uint64_t(countOffsetBytes) + sizeof(uint32_t) > m_CurrentGraphicsState.indirectCountBuffer->getDesc().byteSize))
+            {
+                std::stringstream ss;
+                ss << "executeIndirect: count offset " << countOffsetBytes << " must be a multiple of 4 and inside the count buffer '"
+                    << utils::DebugNameToString(m_CurrentGraphicsState.indirectCountBuffer->getDesc().debugName) << "'.";
+                error(ss.str());
+                return;
+            }
+
+            if (!validatePushConstants("graphics", "setGraphicsState"))
+                return;
+
+            m_CommandList->executeIndirect(signature, offsetBytes, maxCommandCount, countOffsetBytes);
+
+            if (changesState)
+                m_GraphicsStateSet = false;
+        }
+    }
+
+    bool CommandListWrapper::validateIndirectArgumentBuffer(IBuffer* buffer, const CommandSignatureDesc& signatureDesc,
+        uint32_t offsetBytes, uint32_t maxCommandCount)
+    {
+        const BufferDesc& bufferDesc = buffer->getDesc();
+
+        if ((offsetBytes & 3) != 0)
+        {
+            std::stringstream ss;
+            ss << "executeIndirect: argument offset " << offsetBytes << " must be a multiple of 4.";
+            error(ss.str());
+            return false;
+        }
+
+        if (maxCommandCount == 0)
+            return true;
+
+        uint32_t commandSize = 0;
+        for (const IndirectArgumentDesc& argument : signatureDesc.arguments)
+            commandSize += argument.getByteSize();
+
+        const uint64_t endBytes = uint64_t(offsetBytes) + uint64_t(maxCommandCount - 1) * signatureDesc.getCommandByteStride() + commandSize;
+        if (endBytes > bufferDesc.byteSize)
+        {
+            std::stringstream ss;
+            ss << "executeIndirect: " << maxCommandCount << " commands starting at offset " << offsetBytes << " need "
+                << endBytes << " bytes, but the indirect params buffer '" << utils::DebugNameToString(bufferDesc.debugName)
+                << "' is only " << bufferDesc.byteSize << " bytes.";
+            error(ss.str());
+            return false;
+        }
+
+        return true;
+    }
+
+    void CommandListWrapper::setMeshletState(const MeshletState& state)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("setMeshletState"))
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "setMeshletState"))
+            return;
+
+        if (!state.pipeline)
+        {
+            error("MeshletState::pipeline is NULL");
+            return;
+        }
+
+        if (!validateBindingSetsCached(state.pipeline, state.pipeline->getDesc().bindingLayouts, state.bindings))
+            return;
+
+        evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+
+        m_CommandList->setMeshletState(state);
+        m_PushBindings.clear();
+
+        m_GraphicsStateSet = false;
+        m_ComputeStateSet = false;
+        m_MeshletStateSet = true;
+        m_RayTracingStateSet = false;
+        m_PushConstantsSet = false;
+        m_CurrentMeshletState = state;
+    }
+
+    void CommandListWrapper::dispatchMesh(uint32_t groupsX, uint32_t groupsY /*= 1*/, uint32_t groupsZ /*= 1*/)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("dispatchMesh"))
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "dispatchMesh"))
+            return;
+
+        if (!m_MeshletStateSet)
+        {
+            error("Meshlet state is not set before a dispatchMesh call.\n"
+                "Note that setting graphics or compute state invalidates the meshlet state.");
+            return;
+        }
+
+        if (!validatePushConstants("meshlet", "setMeshletState"))
+            return;
+
+        m_CommandList->dispatchMesh(groupsX, groupsY, groupsZ);
+    }
+
+    bool CommandListWrapper::validateDispatchMeshIndirect(bool useCountBuffer, uint32_t countOffsetBytes, const char* operation)
+    {
+        if (!requireOpenState())
+            return false;
+
+        if (!requireNotBundle(operation))
+            return false;
+
+        if (!requireType(CommandQueue::Graphics, operation))
+            return false;
+
+        if (!m_MeshletStateSet)
+        {
+            std::stringstream ss;
+            ss << "Meshlet state is not set before a " << operation << " call.\n"
+                "Note that setting graphics or compute state invalidates the meshlet state.";
+            error(ss.str());
+            return false;
+        }
+
+        IBuffer* indirectParams = m_CurrentMeshletState.indirectParams;
+        if (!indirectParams)
+        {
+            std::stringstream ss;
+            ss << "Indirect params buffer is not set before a " << operation << " call.";
+            error(ss.str());
+            return false;
+        }
+
+        if (!indirectParams->getDesc().isDrawIndirectArgs)
+        {
+            std::stringstream ss;
+            ss << "Cannot use buffer '" << utils::DebugNameToString(indirectParams->getDesc().debugName) << "' as a "
+                << operation << " argument buffer because it does not have the isDrawIndirectArgs flag set.";
+            error(ss.str());
+            return false;
+        }
+
+        if (useCountBuffer)
+        {
+            if (!m_Device->queryFeatureSupport(Feature::DrawIndirectCount))
+            {
+                std::stringstream ss;
+                ss << operation << " is not supported by the device (Feature::DrawIndirectCount).";
+                error(ss.str());
+                return false;
+            }
+
+            IBuffer* countBuffer = m_CurrentMeshletState.indirectCountBuffer;
+            if (!countBuffer)
+            {
+                std::stringstream ss;
+                ss << "Indirect count buffer is not set before a " << operation << " call.";
+                error(ss.str());
+                return false;
+            }
+
+            if (!countBuffer->getDesc().isDrawIndirectArgs
+                || (countOffsetBytes & 3) != 0 || uint64_t(countOffsetBytes) + sizeof(uint32_t) > countBuffer->getDesc().byteSize)
+            {
+                std::stringstream ss;
+                ss << operation << ": count buffer '" << utils::DebugNameToString(countBuffer->getDesc().debugName)
+                    << "' must have the isDrawIndirectArgs flag set, and count offset " << countOffsetBytes
+                    << " must be a multiple of 4 and inside the buffer.";
+                error(ss.str());
+                return false;
+            }
+        }
+
+        if (!validatePushConstants("meshlet", "setMeshletState"))
+            return false;
+
+        return true;
+    }
+
+    void CommandListWrapper::dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount)
+    {
+        if (!validateDispatchMeshIndirect(false, 0, "dispatchMeshIndirect"))
+            return;
+
+        m_CommandList->dispatchMeshIndirect(offsetBytes, drawCount);
+    }
+
+    void CommandListWrapper::dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        if (!validateDispatchMeshIndirect(true, countOffsetBytes, "dispatchMeshIndirectCount"))
+            return;
+
+        m_CommandList->dispatchMeshIndirectCount(offsetBytes, countOffsetBytes, maxDrawCount);
+    }
+
+    void CommandListWrapper::beginTimerQuery(ITimerQuery* query)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("beginTimerQuery"))
+            return;
+
+        m_CommandList->beginTimerQuery(query);
+    }
+
+    void CommandListWrapper::endTimerQuery(ITimerQuery* query)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("endTimerQuery"))
+            return;
+
+        m_CommandList->endTimerQuery(query);
+    }
+
+    void CommandListWrapper::beginOcclusionQuery(IOcclusionQuery* query)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "beginOcclusionQuery"))
+            return;
+
+        if (!requireNotBundle("beginOcclusionQuery"))
+            return;
+
+        if (!query)
+        {
+            error("beginOcclusionQuery: query is NULL");
+            return;
+        }
+
+        m_CommandList->beginOcclusionQuery(query);
+    }
+
+    void CommandListWrapper::endOcclusionQuery(IOcclusionQuery* query)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "endOcclusionQuery"))
+            return;
+
+        if (!requireNotBundle("endOcclusionQuery"))
+            return;
+
+        if (!query)
+        {
+            error("endOcclusionQuery: query is NULL");
+            return;
+        }
+
+        m_CommandList->endOcclusionQuery(query);
+    }
+
+    void CommandListWrapper::beginPipelineStatisticsQuery(IPipelineStatisticsQuery* query)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireType(CommandQueue::Graphics, "beginPipelineStatisticsQuery"))
+            return;
+
+        if (!requireNotBundle("beginPipelineStatisticsQuery"))
+            return;
+
+        if (!query)
+        {
+            error("beginPipelineStatisticsQuery: query is NULL");
             return;
+        }
 
-        m_CommandList->dispatch(groupsX, groupsY, groupsZ);
+        m_CommandList->beginPipelineStatisticsQuery(query);
     }
 
-    void CommandListWrapper::dispatchIndirect(uint32_t offsetBytes)
+    void CommandListWrapper::endPipelineStatisticsQuery(IPipelineStatisticsQuery* query)
     {
         if (!requireOpenState())
             return;
 
-        if (!requireType(CommandQueue::Compute, "dispatchIndirect"))
+        if (!requireType(CommandQueue::Graphics, "endPipelineStatisticsQuery"))
             return;
 
-        if (!m_ComputeStateSet)
-        {
-            error("Compute state is not set before a dispatchIndirect call.\n"
-                "Note that setting graphics state invalidates the compute state.");
+        if (!requireNotBundle("endPipelineStatisticsQuery"))
             return;
-        }
 
-        if (!m_CurrentComputeState.indirectParams)
+        if (!query)
         {
-            error("Indirect params buffer is not set before a dispatchIndirect call.");
+            error("endPipelineStatisticsQuery: query is NULL");
             return;
         }
 
-        if (!validatePushConstants("compute", "setComputeState"))
-            return;
-
-        m_CommandList->dispatchIndirect(offsetBytes);
+        m_CommandList->endPipelineStatisticsQuery(query);
     }
 
-    void CommandListWrapper::setMeshletState(const MeshletState& state)
+    void CommandListWrapper::resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* buffer, uint64_t offsetBytes)
     {
         if (!requireOpenState())
             return;
 
-        if (!requireType(CommandQueue::Graphics, "setMeshletState"))
+        if (!requireType(CommandQueue::Graphics, "resolveOcclusionQueries"))
             return;
 
-        bool anyErrors = false;
-        if (!state.pipeline)
-        {
-            error("MeshletState::pipeline is NULL");
-            anyErrors = true;
-        }
+        if (!requireNotBundle("resolveOcclusionQueries"))
+            return;
 
-        if (anyErrors)
+        if (numQueries == 0)
             return;
 
-        if (!validateBindingSetsAgainstLayouts(state.pipeline->getDesc().bindingLayouts, state.bindings))
-            anyErrors = true;
+        if (!queries)
+        {
+            error("resolveOcclusionQueries: queries is NULL");
+            return;
+        }
 
-        if (anyErrors)
+        for (size_t i = 0; i < numQueries; ++i)
+        {
+            if (!queries[i])
+            {
+                std::stringstream ss;
+                ss << "resolveOcclusionQueries: queries[" << i << "] is NULL";
+                error(ss.str());
+                return;
+            }
+        }
+
+        if (!buffer)
+        {
+            error("resolveOcclusionQueries: buffer is NULL");
             return;
+        }
 
-        evaluatePushConstantSize(state.pipeline->getDesc().bindingLayouts);
+        if (offsetBytes % sizeof(uint64_t) != 0)
+        {
+            error("resolveOcclusionQueries: offsetBytes must be a multiple of 8");
+            return;
+        }
 
-        m_CommandList->setMeshletState(state);
+        const BufferDesc& bufferDesc = buffer->getDesc();
+        if (offsetBytes + numQueries * sizeof(uint64_t) > bufferDesc.byteSize)
+        {
+            std::stringstream ss;
+            ss << "resolveOcclusionQueries: writing " << numQueries << " results at offset " << offsetBytes
+               << " overflows buffer " << utils::DebugNameToString(bufferDesc.debugName)
+               << " of size " << bufferDesc.byteSize;
+            error(ss.str());
+            return;
+        }
 
-        m_GraphicsStateSet = false;
-        m_ComputeStateSet = false;
-        m_MeshletStateSet = true;
-        m_RayTracingStateSet = false;
-        m_PushConstantsSet = false;
-        m_CurrentMeshletState = state;
+        m_CommandList->resolveOcclusionQueries(queries, numQueries, buffer, offsetBytes);
     }
 
-    void CommandListWrapper::dispatchMesh(uint32_t groupsX, uint32_t groupsY /*= 1*/, uint32_t groupsZ /*= 1*/)
+    void CommandListWrapper::setPredication(IBuffer* buffer, uint64_t offsetBytes, PredicationOp op)
     {
         if (!requireOpenState())
             return;
 
-        if (!requireType(CommandQueue::Graphics, "dispatchMesh"))
+        if (!requireType(CommandQueue::Compute, "setPredication"))
             return;
 
-        if (!m_MeshletStateSet)
+        if (!requireNotBundle("setPredication"))
+            return;
+
+        if (!m_Device->queryFeatureSupport(Feature::Predication))
         {
-            error("Meshlet state is not set before a dispatchMesh call.\n"
-                "Note that setting graphics or compute state invalidates the meshlet state.");
+            error("setPredication: predication is not supported by this device (Feature::Predication)");
             return;
         }
 
-        if (!validatePushConstants("meshlet", "setMeshletState"))
-            return;
+        if (buffer)
+        {
+            const BufferDesc& bufferDesc = buffer->getDesc();
 
-        m_CommandList->dispatchMesh(groupsX, groupsY, groupsZ);
-    }
+            if (offsetBytes % sizeof(uint64_t) != 0 || offsetBytes + sizeof(uint64_t) > bufferDesc.byteSize)
+            {
+                std::stringstream ss;
+                ss << "setPredication: offsetBytes (" << offsetBytes << ") must be a multiple of 8 and leave room for a 64-bit value"
+                   << " in buffer " << utils::DebugNameToString(bufferDesc.debugName);
+                error(ss.str());
+                return;
+            }
 
-    void CommandListWrapper::beginTimerQuery(ITimerQuery* query)
-    {
-        if (!requireOpenState())
-            return;
+            if (m_Device->getGraphicsAPI() == GraphicsAPI::VULKAN && !bufferDesc.isDrawIndirectArgs)
+            {
+                std::stringstream ss;
+                ss << "setPredication: buffer " << utils::DebugNameToString(bufferDesc.debugName)
+                   << " must be created with isDrawIndirectArgs = true to be used as a predicate on Vulkan";
+                error(ss.str());
+                return;
+            }
+        }
 
-        m_CommandList->beginTimerQuery(query);
+        m_CommandList->setPredication(buffer, offsetBytes, op);
     }
 
-    void CommandListWrapper::endTimerQuery(ITimerQuery* query)
+    void CommandListWrapper::beginMarker(const char *name)
     {
         if (!requireOpenState())
             return;
 
-        m_CommandList->endTimerQuery(query);
+        m_CommandList->beginMarker(name);
     }
 
-    void CommandListWrapper::beginMarker(const char *name)
+    void CommandListWrapper::endMarker()
     {
         if (!requireOpenState())
             return;
 
-        m_CommandList->beginMarker(name);
+        m_CommandList->endMarker();
     }
 
-    void CommandListWrapper::endMarker()
+    void CommandListWrapper::setGpuProfiler(IGpuProfiler* profiler)
     {
         if (!requireOpenState())
             return;
 
-        m_CommandList->endMarker();
+        if (profiler && m_CommandList->getDesc().queueType == CommandQueue::Copy)
+        {
+            error("GPU profiler cannot be used with copy command lists");
+            return;
+        }
+
+        m_CommandList->setGpuProfiler(profiler);
     }
 
     void CommandListWrapper::setEnableAutomaticBarriers(bool enable)
@@ -956,6 +2144,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setEnableUavBarriersForTexture"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "setEnableUavBarriersForTexture"))
             return;
 
@@ -967,6 +2158,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setEnableUavBarriersForBuffer"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "setEnableUavBarriersForBuffer"))
             return;
 
@@ -978,6 +2172,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("beginTrackingTextureState"))
+            return;
+
         m_CommandList->beginTrackingTextureState(texture, subresources, stateBits);
     }
 
@@ -986,6 +2183,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("beginTrackingBufferState"))
+            return;
+
         m_CommandList->beginTrackingBufferState(buffer, stateBits);
     }
 
@@ -994,6 +2194,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setTextureState"))
+            return;
+
         m_CommandList->setTextureState(texture, subresources, stateBits);
     }
 
@@ -1002,14 +2205,42 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setBufferState"))
+            return;
+
         m_CommandList->setBufferState(buffer, stateBits);
     }
 
+    void CommandListWrapper::beginTextureStateTransition(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("beginTextureStateTransition"))
+            return;
+
+        m_CommandList->beginTextureStateTransition(texture, subresources, stateBits);
+    }
+
+    void CommandListWrapper::beginBufferStateTransition(IBuffer* buffer, ResourceStates stateBits)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("beginBufferStateTransition"))
+            return;
+
+        m_CommandList->beginBufferStateTransition(buffer, stateBits);
+    }
+
     void CommandListWrapper::setAccelStructState(rt::IAccelStruct* as, ResourceStates stateBits)
     {
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setAccelStructState"))
+            return;
+
         m_CommandList->setAccelStructState(checked_cast<rt::IAccelStruct*>(unwrapResource(as)), stateBits);
     }
 
@@ -1018,6 +2249,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setPermanentTextureState"))
+            return;
+
         m_CommandList->setPermanentTextureState(texture, stateBits);
     }
 
@@ -1026,6 +2260,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setPermanentBufferState"))
+            return;
+
         m_CommandList->setPermanentBufferState(buffer, stateBits);
     }
 
@@ -1037,6 +2274,17 @@ namespace nvrhi::validation
         m_CommandList->commitBarriers();
     }
 
+    void CommandListWrapper::aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("aliasingBarrier"))
+            return;
+
+        m_CommandList->aliasingBarrier(resourceBefore, resourceAfter);
+    }
+
     ResourceStates CommandListWrapper::getTextureSubresourceState(ITexture* texture, ArraySlice arraySlice, MipLevel mipLevel)
     {
         if (!requireOpenState())
@@ -1058,6 +2306,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("clearState"))
+            return;
+
         m_GraphicsStateSet = false;
         m_ComputeStateSet = false;
         m_MeshletStateSet = false;
@@ -1077,11 +2328,24 @@ namespace nvrhi::validation
         return m_CommandList->getDesc();
     }
 
+    UploadStatistics CommandListWrapper::getUploadStatistics()
+    {
+        return m_CommandList->getUploadStatistics();
+    }
+
+    CommandListStatistics CommandListWrapper::getStatistics()
+    {
+        return m_CommandList->getStatistics();
+    }
+
     void CommandListWrapper::setRayTracingState(const rt::State& state)
     {
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("setRayTracingState"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "setRayTracingState"))
             return;
 
@@ -1102,6 +2366,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("dispatchRays"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "dispatchRays"))
             return;
 
@@ -1123,6 +2390,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("compactBottomLevelAccelStructs"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "compactBottomLevelAccelStructs"))
             return;
 
@@ -1134,363 +2404,442 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("buildOpacityMicromap"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "buildOpacityMicromap"))
             return;
 
         m_CommandList->buildOpacityMicromap(omm, desc);
     }
 
-    void CommandListWrapper::buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags)
+    bool CommandListWrapper::validateBuildBottomLevelAccelStruct(AccelStructWrapper* wrapper, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags, const char* functionName) const
     {
-        if (!requireOpenState())
-            return;
-
-        if (!requireType(CommandQueue::Compute, "buildBottomLevelAccelStruct"))
-            return;
-
-        rt::IAccelStruct* underlyingAS = as;
-
-        AccelStructWrapper* wrapper = dynamic_cast<AccelStructWrapper*>(as);
-        if (wrapper)
+        if (wrapper->isTopLevel)
         {
-            underlyingAS = wrapper->getUnderlyingObject();
+            error(std::string("Cannot perform ") + functionName + " on a top-level AS");
+            return false;
+        }
+        
+        for (size_t i = 0; i < numGeometries; i++)
+        {
+            const auto& geom = pGeometries[i];
 
-            if (wrapper->isTopLevel)
-            {
-                error("Cannot perform buildBottomLevelAccelStruct on a top-level AS");
-                return;
-            }
-            
-            for (size_t i = 0; i < numGeometries; i++)
+            if (geom.geometryType == rt::GeometryType::Triangles)
             {
-                const auto& geom = pGeometries[i];
+                const auto& triangles = geom.geometryData.triangles;
 
-                if (geom.geometryType == rt::GeometryType::Triangles)
+                if (triangles.indexFormat != Format::UNKNOWN)
                 {
-                    const auto& triangles = geom.geometryData.triangles;
-
-                    if (triangles.indexFormat != Format::UNKNOWN)
-                    {
-                        switch (triangles.indexFormat)  // NOLINT(clang-diagnostic-switch-enum)
-                        {
-                        case Format::R8_UINT:
-                            if (m_Device->getGraphicsAPI() != GraphicsAPI::VULKAN)
-                            {
-                                std::stringstream ss;
-                                ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                    << " has index format R8_UINT which is only supported on Vulkan";
-                                error(ss.str());
-                                return;
-                            }
-                            break;
-                        case Format::R16_UINT:
-                        case Format::R32_UINT:
-                            break;
-                        default: {
-                            std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " has unsupported index format: " << utils::FormatToString(triangles.indexFormat);
-                            error(ss.str());
-                            return;
-                        }
-                        }
-
-                        if (triangles.indexBuffer == nullptr)
-                        {
-                            std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " has a NULL index buffer but indexFormat is " << utils::FormatToString(triangles.indexFormat);
-                            error(ss.str());
-                            return;
-                        }
-
-                        const BufferDesc& indexBufferDesc = triangles.indexBuffer->getDesc();
-                        if (!indexBufferDesc.isAccelStructBuildInput)
-                        {
-                            std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " has index buffer = " << utils::DebugNameToString(indexBufferDesc.debugName)
-                                << " which does not have the isAccelStructBuildInput flag set";
-                            error(ss.str());
-                            return;
-                        }
-
-                        const size_t indexSize = triangles.indexCount * getFormatInfo(triangles.indexFormat).bytesPerBlock;
-                        if (triangles.indexOffset + indexSize > indexBufferDesc.byteSize)
-                        {
-                            std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " points at " << indexSize << " bytes of index data at offset " << triangles.indexOffset
-                                << " in buffer " << utils::DebugNameToString(indexBufferDesc.debugName) << " whose size is " << indexBufferDesc.byteSize
-                                << ", which will result in a buffer overrun";
-                            error(ss.str());
-                            return;
-                        }
-
-                        if ((triangles.indexCount % 3) != 0)
-                        {
-                            std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " has indexCount = " << triangles.indexCount
-                                << ", which is not a multiple of 3";
-                            error(ss.str());
-                            return;
-                        }
-                    }
-                    else
+                    switch (triangles.indexFormat)  // NOLINT(clang-diagnostic-switch-enum)
                     {
-                        if (triangles.indexCount != 0 || triangles.indexBuffer != nullptr)
-                        {
-                            std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " has indexFormat = UNKNOWN but nonzero indexCount = " << triangles.indexCount;
-                            error(ss.str());
-                            return;
-                        }
-
-                        if (triangles.indexBuffer != nullptr)
+                    case Format::R8_UINT:
+                        if (m_Device->getGraphicsAPI() != GraphicsAPI::VULKAN)
                         {
                             std::stringstream ss;
-                            ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                                << " has indexFormat = UNKNOWN but non-NULL indexBuffer = "
-                                << utils::DebugNameToString(triangles.indexBuffer->getDesc().debugName);
+                            ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                                << " has index format R8_UINT which is only supported on Vulkan";
                             error(ss.str());
-                            return;
+                            return false;
                         }
-                    }
-
-                    switch (triangles.vertexFormat)  // NOLINT(clang-diagnostic-switch-enum)
-                    {
-                    case Format::RG32_FLOAT:
-                    case Format::RGB32_FLOAT:
-                    case Format::RG16_FLOAT:
-                    case Format::RGBA16_FLOAT:
-                    case Format::RG16_SNORM:
-                    case Format::RGBA16_SNORM:
-                    case Format::RGBA16_UNORM:
-                    case Format::RG16_UNORM:
-                    case Format::R10G10B10A2_UNORM:
-                    case Format::RGBA8_UNORM:
-                    case Format::RG8_UNORM:
-                    case Format::RGBA8_SNORM:
-                    case Format::RG8_SNORM:
+                        break;
+                    case Format::R16_UINT:
+                    case Format::R32_UINT:
                         break;
                     default: {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has unsupported vertex format: " << utils::FormatToString(triangles.indexFormat);
-                        error(ss.str());
-                        return;
-                    }
-                    }
-
-                    if (triangles.vertexBuffer == nullptr)
-                    {
-                        std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has NULL vertex buffer";
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " has unsupported index format: " << utils::FormatToString(triangles.indexFormat);
                         error(ss.str());
-                        return;
+                        return false;
                     }
-
-                    if (triangles.vertexStride == 0)
-                    {
-                        std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has vertexStride = 0";
-                        error(ss.str());
-                        return;
                     }
 
-                    if ((triangles.indexFormat == Format::UNKNOWN) && (triangles.vertexCount % 3) != 0)
+                    if (triangles.indexBuffer == nullptr)
                     {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has indexFormat = UNKNOWN and vertexCount = " << triangles.vertexCount
-                            << ", which is not a multiple of 3";
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " has a NULL index buffer but indexFormat is " << utils::FormatToString(triangles.indexFormat);
                         error(ss.str());
-                        return;
+                        return false;
                     }
 
-                    const BufferDesc& vertexBufferDesc = triangles.vertexBuffer->getDesc();
-                    if (!vertexBufferDesc.isAccelStructBuildInput)
+                    const BufferDesc& indexBufferDesc = triangles.indexBuffer->getDesc();
+                    if (!indexBufferDesc.isAccelStructBuildInput)
                     {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has vertex buffer = " << utils::DebugNameToString(vertexBufferDesc.debugName)
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " has index buffer = " << utils::DebugNameToString(indexBufferDesc.debugName)
                             << " which does not have the isAccelStructBuildInput flag set";
                         error(ss.str());
-                        return;
+                        return false;
                     }
 
-                    const size_t vertexDataSize = triangles.vertexCount * triangles.vertexStride;
-                    if (triangles.vertexOffset + vertexDataSize > vertexBufferDesc.byteSize)
+                    const size_t indexSize = triangles.indexCount * getFormatInfo(triangles.indexFormat).bytesPerBlock;
+                    if (triangles.indexOffset + indexSize > indexBufferDesc.byteSize)
                     {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " points at " << vertexDataSize << " bytes of vertex data at offset " << triangles.vertexOffset
-                            << " in buffer " << utils::DebugNameToString(vertexBufferDesc.debugName) << " whose size is " << vertexBufferDesc.byteSize
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " points at " << indexSize << " bytes of index data at offset " << triangles.indexOffset
+                            << " in buffer " << utils::DebugNameToString(indexBufferDesc.debugName) << " whose size is " << indexBufferDesc.byteSize
                             << ", which will result in a buffer overrun";
                         error(ss.str());
-                        return;
-                    }
-                }
-                else // AABBs
-                {
-                    const auto& aabbs = geom.geometryData.aabbs;
-
-                    if (aabbs.buffer== nullptr)
-                    {
-                        std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has NULL AABB data buffer";
-                        error(ss.str());
-                        return;
-                    }
-
-                    const BufferDesc& aabbBufferDesc = aabbs.buffer->getDesc();
-                    if (!aabbBufferDesc.isAccelStructBuildInput)
-                    {
-                        std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has AABB data buffer = " << utils::DebugNameToString(aabbBufferDesc.debugName)
-                            << " which does not have the isAccelStructBuildInput flag set";
-                        error(ss.str());
-                        return;
+                        return false;
                     }
 
-                    if (aabbs.count > 1 && aabbs.stride < sizeof(rt::GeometryAABB))
+                    if ((triangles.indexCount % 3) != 0)
                     {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " has AABB stride = " << aabbs.stride
-                            << " which is less than the size of one AABB (" << sizeof(rt::GeometryAABB) << " bytes)";
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " has indexCount = " << triangles.indexCount
+                            << ", which is not a multiple of 3";
                         error(ss.str());
-                        return;
+                        return false;
                     }
-
-                    const size_t aabbDataSize = aabbs.count * aabbs.stride;
-                    if (aabbs.offset + aabbDataSize > aabbBufferDesc.byteSize)
+                }
+                else
+                {
+                    if (triangles.indexCount != 0 || triangles.indexBuffer != nullptr)
                     {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " points at " << aabbDataSize << " bytes of AABB data at offset " << aabbs.offset
-                            << " in buffer " << utils::DebugNameToString(aabbBufferDesc.debugName) << " whose size is " << aabbBufferDesc.byteSize
-                            << ", which will result in a buffer overrun";
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " has indexFormat = UNKNOWN but nonzero indexCount = " << triangles.indexCount;
                         error(ss.str());
-                        return;
+                        return false;
                     }
 
-                    if (geom.useTransform)
+                    if (triangles.indexBuffer != nullptr)
                     {
                         std::stringstream ss;
-                        ss << "BLAS " << utils::DebugNameToString(as->getDesc().debugName) << " build geometry " << i
-                            << " is of type AABB but has useTransform = true, "
-                            "which is unsupported, and the transform will be ignored";
-                        m_MessageCallback->message(MessageSeverity::Warning, ss.str().c_str());
+                        ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                            << " has indexFormat = UNKNOWN but non-NULL indexBuffer = "
+                            << utils::DebugNameToString(triangles.indexBuffer->getDesc().debugName);
+                        error(ss.str());
+                        return false;
                     }
                 }
-            }
 
-            if ((buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0)
+                switch (triangles.vertexFormat)  // NOLINT(clang-diagnostic-switch-enum)
+                {
+                case Format::RG32_FLOAT:
+                case Format::RGB32_FLOAT:
+                case Format::RG16_FLOAT:
+                case Format::RGBA16_FLOAT:
+                case Format::RG16_SNORM:
+                case Format::RGBA16_SNORM:
+                case Format::RGBA16_UNORM:
+                case Format::RG16_UNORM:
+                case Format::R10G10B10A2_UNORM:
+                case Format::RGBA8_UNORM:
+                case Format::RG8_UNORM:
+                case Format::RGBA8_SNORM:
+                case Format::RG8_SNORM:
+                    break;
+                default: {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has unsupported vertex format: " << utils::FormatToString(triangles.indexFormat);
+                    error(ss.str());
+                    return false;
+                }
+                }
+
+                if (triangles.vertexBuffer == nullptr)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has NULL vertex buffer";
+                    error(ss.str());
+                    return false;
+                }
+
+                if (triangles.vertexStride == 0)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has vertexStride = 0";
+                    error(ss.str());
+                    return false;
+                }
+
+                if ((triangles.indexFormat == Format::UNKNOWN) && (triangles.vertexCount % 3) != 0)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has indexFormat = UNKNOWN and vertexCount = " << triangles.vertexCount
+                        << ", which is not a multiple of 3";
+                    error(ss.str());
+                    return false;
+                }
+
+                const BufferDesc& vertexBufferDesc = triangles.vertexBuffer->getDesc();
+                if (!vertexBufferDesc.isAccelStructBuildInput)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has vertex buffer = " << utils::DebugNameToString(vertexBufferDesc.debugName)
+                        << " which does not have the isAccelStructBuildInput flag set";
+                    error(ss.str());
+                    return false;
+                }
+
+                const size_t vertexDataSize = triangles.vertexCount * triangles.vertexStride;
+                if (triangles.vertexOffset + vertexDataSize > vertexBufferDesc.byteSize)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " points at " << vertexDataSize << " bytes of vertex data at offset " << triangles.vertexOffset
+                        << " in buffer " << utils::DebugNameToString(vertexBufferDesc.debugName) << " whose size is " << vertexBufferDesc.byteSize
+                        << ", which will result in a buffer overrun";
+                    error(ss.str());
+                    return false;
+                }
+            }
+            else // AABBs
             {
-                if (!wrapper->allowUpdate)
+                const auto& aabbs = geom.geometryData.aabbs;
+
+                if (aabbs.buffer== nullptr)
                 {
                     std::stringstream ss;
-                    ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                        << " that was not created with the AllowUpdate flag";
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has NULL AABB data buffer";
                     error(ss.str());
-                    return;
+                    return false;
                 }
 
-                if (!wrapper->wasBuilt)
+                const BufferDesc& aabbBufferDesc = aabbs.buffer->getDesc();
+                if (!aabbBufferDesc.isAccelStructBuildInput)
                 {
                     std::stringstream ss;
-                    ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                        << " before the same BLAS was initially built";
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has AABB data buffer = " << utils::DebugNameToString(aabbBufferDesc.debugName)
+                        << " which does not have the isAccelStructBuildInput flag set";
                     error(ss.str());
-                    return;
+                    return false;
                 }
 
-                if (numGeometries != wrapper->buildGeometries.size())
+                if (aabbs.count > 1 && aabbs.stride < sizeof(rt::GeometryAABB))
                 {
                     std::stringstream ss;
-                    ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                        << " with " << numGeometries << " geometries "
-                        "when this BLAS was built with " << wrapper->buildGeometries.size() << " geometries";
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " has AABB stride = " << aabbs.stride
+                        << " which is less than the size of one AABB (" << sizeof(rt::GeometryAABB) << " bytes)";
                     error(ss.str());
-                    return;
+                    return false;
+                }
+
+                const size_t aabbDataSize = aabbs.count * aabbs.stride;
+                if (aabbs.offset + aabbDataSize > aabbBufferDesc.byteSize)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " points at " << aabbDataSize << " bytes of AABB data at offset " << aabbs.offset
+                        << " in buffer " << utils::DebugNameToString(aabbBufferDesc.debugName) << " whose size is " << aabbBufferDesc.byteSize
+                        << ", which will result in a buffer overrun";
+                    error(ss.str());
+                    return false;
+                }
+
+                if (geom.useTransform)
+                {
+                    std::stringstream ss;
+                    ss << "BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName) << " build geometry " << i
+                        << " is of type AABB but has useTransform = true, "
+                        "which is unsupported, and the transform will be ignored";
+                    m_MessageCallback->message(MessageSeverity::Warning, ss.str().c_str());
+                }
+            }
+        }
+
+        if ((buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0)
+        {
+            if (!wrapper->allowUpdate)
+            {
+                std::stringstream ss;
+                ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                    << " that was not created with the AllowUpdate flag";
+                error(ss.str());
+                return false;
+            }
+
+            if (!wrapper->wasBuilt)
+            {
+                std::stringstream ss;
+                ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                    << " before the same BLAS was initially built";
+                error(ss.str());
+                return false;
+            }
+
+            if (numGeometries != wrapper->buildGeometries.size())
+            {
+                std::stringstream ss;
+                ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                    << " with " << numGeometries << " geometries "
+                    "when this BLAS was built with " << wrapper->buildGeometries.size() << " geometries";
+                error(ss.str());
+                return false;
+            }
+            
+            for (size_t i = 0; i < numGeometries; i++)
+            {
+                const auto& before = wrapper->buildGeometries[i];
+                const auto& after = pGeometries[i];
+
+                if (before.geometryType != after.geometryType)
+                {
+                    std::stringstream ss;
+                    ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                        << " with mismatching geometry types in slot " << i;
+                    error(ss.str());
+                    return false;
                 }
-                
-                for (size_t i = 0; i < numGeometries; i++)
+
+                if (before.geometryType == rt::GeometryType::Triangles)
                 {
-                    const auto& before = wrapper->buildGeometries[i];
-                    const auto& after = pGeometries[i];
+                    uint32_t primitivesBefore = (before.geometryData.triangles.vertexFormat == Format::UNKNOWN)
+                        ? before.geometryData.triangles.vertexCount
+                        : before.geometryData.triangles.indexCount;
+
+                    uint32_t primitivesAfter = (after.geometryData.triangles.vertexFormat == Format::UNKNOWN)
+                        ? after.geometryData.triangles.vertexCount
+                        : after.geometryData.triangles.indexCount;
+
+                    primitivesBefore /= 3;
+                    primitivesAfter /= 3;
 
-                    if (before.geometryType != after.geometryType)
+                    if (primitivesBefore != primitivesAfter)
                     {
                         std::stringstream ss;
-                        ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                            << " with mismatching geometry types in slot " << i;
+                        ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                            << " with mismatching triangle counts in geometry slot " << i << ": "
+                            "built with " << primitivesBefore << " triangles, updating with " << primitivesAfter << " triangles";
                         error(ss.str());
-                        return;
+                        return false;
                     }
+                }
+                else // AABBs
+                {
+                    uint32_t aabbsBefore = before.geometryData.aabbs.count;
+                    uint32_t aabbsAfter = after.geometryData.aabbs.count;
 
-                    if (before.geometryType == rt::GeometryType::Triangles)
+                    if (aabbsBefore != aabbsAfter)
                     {
-                        uint32_t primitivesBefore = (before.geometryData.triangles.vertexFormat == Format::UNKNOWN)
-                            ? before.geometryData.triangles.vertexCount
-                            : before.geometryData.triangles.indexCount;
+                        std::stringstream ss;
+                        ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                            << " with mismatching AABB counts in geometry slot " << i << ": "
+                            "built with " << aabbsBefore << " AABBs, updating with " << aabbsAfter << " AABBs";
+                        error(ss.str());
+                        return false;
+                    }
+                }
+            }
+        }
+
+        if (wrapper->allowCompaction && wrapper->wasBuilt)
+        {
+            std::stringstream ss;
+            ss << "Cannot rebuild BLAS " << utils::DebugNameToString(wrapper->getDesc().debugName)
+                << " that has the AllowCompaction flag set";
+            error(ss.str());
+            return false;
+        }
 
-                        uint32_t primitivesAfter = (after.geometryData.triangles.vertexFormat == Format::UNKNOWN)
-                            ? after.geometryData.triangles.vertexCount
-                            : after.geometryData.triangles.indexCount;
+        return true;
+    }
 
-                        primitivesBefore /= 3;
-                        primitivesAfter /= 3;
+    void CommandListWrapper::buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags)
+    {
+        if (!requireOpenState())
+            return;
 
-                        if (primitivesBefore != primitivesAfter)
-                        {
-                            std::stringstream ss;
-                            ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                                << " with mismatching triangle counts in geometry slot " << i << ": "
-                                "built with " << primitivesBefore << " triangles, updating with " << primitivesAfter << " triangles";
-                            error(ss.str());
-                            return;
-                        }
-                    }
-                    else // AABBs
-                    {
-                        uint32_t aabbsBefore = before.geometryData.aabbs.count;
-                        uint32_t aabbsAfter = after.geometryData.aabbs.count;
+        if (!requireNotBundle("buildBottomLevelAccelStruct"))
+            return;
 
-                        if (aabbsBefore != aabbsAfter)
-                        {
-                            std::stringstream ss;
-                            ss << "Cannot perform an update on BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                                << " with mismatching AABB counts in geometry slot " << i << ": "
-                                "built with " << aabbsBefore << " AABBs, updating with " << aabbsAfter << " AABBs";
-                            error(ss.str());
-                            return;
-                        }
-                    }
-                }
+        if (!requireType(CommandQueue::Compute, "buildBottomLevelAccelStruct"))
+            return;
+
+        rt::IAccelStruct* underlyingAS = as;
+
+        AccelStructWrapper* wrapper = dynamic_cast<AccelStructWrapper*>(as);
+        if (wrapper)
+        {
+            underlyingAS = wrapper->getUnderlyingObject();
+
+            if (!validateBuildBottomLevelAccelStruct(wrapper, pGeometries, numGeometries, buildFlags, "buildBottomLevelAccelStruct"))
+                return;
+
+            wrapper->wasBuilt = true;
+            wrapper->buildGeometries.assign(pGeometries, pGeometries + numGeometries);
+        }
+
+        m_CommandList->buildBottomLevelAccelStruct(underlyingAS, pGeometries, numGeometries, buildFlags);
+    }
+
+    void CommandListWrapper::buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!requireNotBundle("buildBottomLevelAccelStructs"))
+            return;
+
+        if (!requireType(CommandQueue::Compute, "buildBottomLevelAccelStructs"))
+            return;
+
+        if (numBuilds > 0 && !builds)
+        {
+            error("buildBottomLevelAccelStructs: 'builds' is NULL");
+            return;
+        }
+
+        std::vector<rt::BottomLevelAccelStructBuild> underlyingBuilds(builds, builds + numBuilds);
+        std::vector<AccelStructWrapper*> wrappers(numBuilds, nullptr);
+        std::unordered_set<rt::IAccelStruct*> uniqueAccelStructs;
+
+        for (size_t index = 0; index < numBuilds; index++)
+        {
+            const rt::BottomLevelAccelStructBuild& build = builds[index];
+
+            if (!build.accelStruct)
+            {
+                std::stringstream ss;
+                ss << "buildBottomLevelAccelStructs: build " << index << " has NULL accelStruct";
+                error(ss.str());
+                return;
             }
 
-            if (wrapper->allowCompaction && wrapper->wasBuilt)
+            if (!uniqueAccelStructs.insert(build.accelStruct).second)
             {
                 std::stringstream ss;
-                ss << "Cannot rebuild BLAS " << utils::DebugNameToString(as->getDesc().debugName)
-                    << " that has the AllowCompaction flag set";
+                ss << "buildBottomLevelAccelStructs: BLAS " << utils::DebugNameToString(build.accelStruct->getDesc().debugName)
+                    << " is referenced by more than one build in the same call";
                 error(ss.str());
                 return;
             }
 
-            wrapper->wasBuilt = true;
-            wrapper->buildGeometries.assign(pGeometries, pGeometries + numGeometries);
+            AccelStructWrapper* wrapper = dynamic_cast<AccelStructWrapper*>(build.accelStruct);
+            if (wrapper)
+            {
+                if (!validateBuildBottomLevelAccelStruct(wrapper, build.geometries, build.numGeometries, build.buildFlags, "buildBottomLevelAccelStructs"))
+                    return;
+
+                underlyingBuilds[index].accelStruct = wrapper->getUnderlyingObject();
+                wrappers[index] = wrapper;
+            }
         }
 
-        m_CommandList->buildBottomLevelAccelStruct(underlyingAS, pGeometries, numGeometries, buildFlags);
+        for (size_t index = 0; index < numBuilds; index++)
+        {
+            if (AccelStructWrapper* wrapper = wrappers[index])
+            {
+                wrapper->wasBuilt = true;
+                wrapper->buildGeometries.assign(builds[index].geometries, builds[index].geometries + builds[index].numGeometries);
+            }
+        }
+
+        m_CommandList->buildBottomLevelAccelStructs(underlyingBuilds.data(), underlyingBuilds.size());
     }
 
     bool CommandListWrapper::validateBuildTopLevelAccelStruct(AccelStructWrapper* wrapper, size_t numInstances, rt::AccelStructBuildFlags buildFlags) const
@@ -1554,6 +2903,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("buildTopLevelAccelStruct"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "buildTopLevelAccelStruct"))
             return;
 
@@ -1646,6 +2998,9 @@ namespace nvrhi::validation
         if (!requireOpenState())
             return;
 
+        if (!requireNotBundle("buildTopLevelAccelStructFromBuffer"))
+            return;
+
         if (!requireType(CommandQueue::Compute, "buildTopLevelAccelStruct"))
             return;
 
@@ -1696,6 +3051,130 @@ namespace nvrhi::validation
         m_CommandList->buildTopLevelAccelStructFromBuffer(underlyingAS, instanceBuffer, instanceBufferOffset, numInstances, buildFlags);
     }
 
+    rt::InstanceDesc* CommandListWrapper::beginTopLevelInstanceWrite(rt::IAccelStruct* as, size_t numInstances)
+    {
+        if (!requireOpenState())
+            return nullptr;
+
+        if (!requireNotBundle("beginTopLevelInstanceWrite"))
+            return nullptr;
+
+        if (!requireType(CommandQueue::Compute, "beginTopLevelInstanceWrite"))
+            return nullptr;
+
+        if (!as)
+        {
+            error("beginTopLevelInstanceWrite: 'as' is NULL");
+            return nullptr;
+        }
+
+        if (m_PendingInstanceWriteAS)
+        {
+            std::stringstream ss;
+            ss << "beginTopLevelInstanceWrite called for TLAS " << utils::DebugNameToString(as->getDesc().debugName)
+                << " while the instance write for TLAS " << utils::DebugNameToString(m_PendingInstanceWriteAS->getDesc().debugName)
+                << " is not committed yet";
+            error(ss.str());
+            return nullptr;
+        }
+
+        rt::IAccelStruct* underlyingAS = as;
+
+        AccelStructWrapper* wrapper = dynamic_cast<AccelStructWrapper*>(as);
+        if (wrapper)
+        {
+            underlyingAS = wrapper->getUnderlyingObject();
+
+            if (!validateBuildTopLevelAccelStruct(wrapper, numInstances, rt::AccelStructBuildFlags::None))
+                return nullptr;
+        }
+
+        rt::InstanceDesc* instances = m_CommandList->beginTopLevelInstanceWrite(underlyingAS, numInstances);
+
+        if (instances)
+        {
+            m_PendingInstanceWriteAS = as;
+            m_PendingInstanceWriteCount = numInstances;
+        }
+
+        return instances;
+    }
+
+    void CommandListWrapper::commitTopLevelInstanceWrite(rt::IAccelStruct* as, rt::AccelStructBuildFlags buildFlags, rt::IAccelStruct* const* bottomLevelASes, size_t numBottomLevelASes)
+    {
+        if (!requireOpenState())
+            return;
+
+        if (!as)
+        {
+            error("commitTopLevelInstanceWrite: 'as' is NULL");
+            return;
+        }
+
+        if (m_PendingInstanceWriteAS != as)
+        {
+            std::stringstream ss;
+            ss << "commitTopLevelInstanceWrite called for TLAS " << utils::DebugNameToString(as->getDesc().debugName)
+                << " without a matching beginTopLevelInstanceWrite";
+            error(ss.str());
+            return;
+        }
+
+        if (numBottomLevelASes > 0 && !bottomLevelASes)
+        {
+            error("commitTopLevelInstanceWrite: 'bottomLevelASes' is NULL");
+            return;
+        }
+
+        const size_t numInstances = m_PendingInstanceWriteCount;
+        m_PendingInstanceWriteAS = nullptr;
+
+        std::vector<rt::IAccelStruct*> underlyingBLASes(numBottomLevelASes);
+
+        for (size_t i = 0; i < numBottomLevelASes; i++)
+        {
+            underlyingBLASes[i] = checked_cast<rt::IAccelStruct*>(unwrapResource(bottomLevelASes[i]));
+
+            AccelStructWrapper* blasWrapper = dynamic_cast<AccelStructWrapper*>(bottomLevelASes[i]);
+            if (blasWrapper)
+            {
+                if (blasWrapper->isTopLevel)
+                {
+                    std::stringstream ss;
+                    ss << "TLAS " << utils::DebugNameToString(as->getDesc().debugName) << " instance write refers to another TLAS "
+                        << utils::DebugNameToString(blasWrapper->getDesc().debugName) << ", which is unsupported";
+                    error(ss.str());
+                    return;
+                }
+
+                if (!blasWrapper->wasBuilt)
+                {
+                    std::stringstream ss;
+                    ss << "TLAS " << utils::DebugNameToString(as->getDesc().debugName) << " instance write refers to BLAS "
+                        << utils::DebugNameToString(blasWrapper->getDesc().debugName) << " which was never built";
+                    error(ss.str());
+                    return;
+                }
+            }
+        }
+
+        rt::IAccelStruct* underlyingAS = as;
+
+        AccelStructWrapper* wrapper = dynamic_cast<AccelStructWrapper*>(as);
+        if (wrapper)
+        {
+            underlyingAS = wrapper->getUnderlyingObject();
+
+            if (!validateBuildTopLevelAccelStruct(wrapper, numInstances, buildFlags))
+                return;
+
+            wrapper->wasBuilt = true;
+            wrapper->buildInstances = numInstances;
+        }
+
+        m_CommandList->commitTopLevelInstanceWrite(underlyingAS, buildFlags, underlyingBLASes.data(), underlyingBLASes.size());
+    }
+
     void CommandListWrapper::evaluatePushConstantSize(const nvrhi::BindingLayoutVector& bindingLayouts)
     {
         m_PipelinePushConstantSize = 0;
@@ -29,15 +29,22 @@
 
 namespace nvrhi::validation
 {
-    DeviceHandle createValidationLayer(IDevice* underlyingDevice)
+    DeviceHandle createValidationLayer(IDevice* underlyingDevice, const ValidationLayerDesc& desc)
     {
-        DeviceWrapper* wrapper = new DeviceWrapper(underlyingDevice);
+        DeviceWrapper* wrapper = new DeviceWrapper(underlyingDevice, desc);
         return DeviceHandle::Create(wrapper);
     }
 
-    DeviceWrapper::DeviceWrapper(IDevice* device)
+    void setFullValidation(ICommandList* commandList, bool enable)
+    {
+        if (CommandListWrapper* wrapper = dynamic_cast<CommandListWrapper*>(commandList))
+            wrapper->setFullValidationRequested(enable);
+    }
+
+    DeviceWrapper::DeviceWrapper(IDevice* device, const ValidationLayerDesc& desc)
         : m_Device(device)
         , m_MessageCallback(device->getMessageCallback())
+        , m_Desc(desc)
     {
 
     }
@@ -223,6 +230,28 @@ namespace nvrhi::validation
             anyErrors = true;
         }
 
+        if (d.isTiled && !m_Device->queryFeatureSupport(Feature::TiledResources))
+        {
+            std::stringstream ss;
+            ss << dimensionStr << " " << debugName << ": The device does not support tiled resources";
+            error(ss.str());
+            anyErrors = true;
+        }
+
+        if (!validateNodeMask(d.creationNodeMask, std::string(dimensionStr) + " " + debugName, "creationNodeMask") ||
+            !validateNodeMask(d.visibleNodeMask, std::string(dimensionStr) + " " + debugName, "visibleNodeMask"))
+        {
+            anyErrors = true;
+        }
+
+        if (d.isTiled && (d.isVirtual || d.sharedResourceFlags != SharedResourceFlags::None))
+        {
+            std::stringstream ss;
+            ss << dimensionStr << " " << debugName << ": tiled textures cannot be virtual or shared";
+            error(ss.str());
+            anyErrors = true;
+        }
+
         if (d.keepInitialState && d.initialState == ResourceStates::Unknown)
         {
             std::stringstream ss;
@@ -318,6 +347,112 @@ namespace nvrhi::validation
 
         return m_Device->bindTextureMemory(texture, heap, offset);
     }
+
+    void DeviceWrapper::getTextureTiling(ITexture* texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+        uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings)
+    {
+        if (texture == nullptr)
+        {
+            error("getTextureTiling: texture is NULL");
+            return;
+        }
+
+        if (!texture->getDesc().isTiled)
+        {
+            std::stringstream ss;
+            ss << "Cannot perform getTextureTiling on texture " << utils::DebugNameToString(texture->getDesc().debugName)
+                << " because it was created with isTiled = false";
+
+            error(ss.str());
+            return;
+        }
+
+        if (numSubresourceTilings && *numSubresourceTilings != 0 && !subresourceTilings)
+        {
+            error("getTextureTiling: numSubresourceTilings is nonzero and subresourceTilings is NULL");
+            return;
+        }
+
+        m_Device->getTextureTiling(texture, numTiles, packedMipDesc, tileShape, numSubresourceTilings, subresourceTilings);
+    }
+
+    void DeviceWrapper::updateTextureTileMappings(ITexture* texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings, CommandQueue executionQueue)
+    {
+        if (texture == nullptr)
+        {
+            error("updateTextureTileMappings: texture is NULL");
+            return;
+        }
+
+        const TextureDesc& textureDesc = texture->getDesc();
+
+        if (!textureDesc.isTiled)
+        {
+            std::stringstream ss;
+            ss << "Cannot perform updateTextureTileMappings on texture " << utils::DebugNameToString(textureDesc.debugName)
+                << " because it was created with isTiled = false";
+
+            error(ss.str());
+            return;
+        }
+
+        if (numTileMappings != 0 && !tileMappings)
+        {
+            error("updateTextureTileMappings: numTileMappings is nonzero and tileMappings is NULL");
+            return;
+        }
+
+        for (uint32_t mappingIndex = 0; mappingIndex < numTileMappings; ++mappingIndex)
+        {
+            const TextureTilesMapping& mapping = tileMappings[mappingIndex];
+
+            if (mapping.numTextureRegions == 0)
+                continue;
+
+            if (!mapping.tiledTextureCoordinates || !mapping.tiledTextureRegions || (mapping.heap && !mapping.byteOffsets))
+            {
+                std::stringstream ss;
+                ss << "updateTextureTileMappings: tileMappings[" << mappingIndex << "] has NULL coordinate, region or offset arrays";
+                error(ss.str());
+                return;
+            }
+
+            if (mapping.heap && mapping.heap->getDesc().type != HeapType::DeviceLocal)
+            {
+                std::stringstream ss;
+                ss << "updateTextureTileMappings: heap " << utils::DebugNameToString(mapping.heap->getDesc().debugName)
+                    << " mapped to texture " << utils::DebugNameToString(textureDesc.debugName) << " must be device-local";
+                error(ss.str());
+                return;
+            }
+
+            for (uint32_t i = 0; i < mapping.numTextureRegions; ++i)
+            {
+                const TiledTextureCoordinate& coordinate = mapping.tiledTextureCoordinates[i];
+
+                if (coordinate.mipLevel >= textureDesc.mipLevels || coordinate.arraySlice >= textureDesc.arraySize)
+                {
+                    std::stringstream ss;
+                    ss << "updateTextureTileMappings: tileMappings[" << mappingIndex << "] region " << i << " addresses mip level "
+                        << coordinate.mipLevel << ", array slice " << coordinate.arraySlice << " that is outside of texture "
+                        << utils::DebugNameToString(textureDesc.debugName);
+                    error(ss.str());
+                    return;
+                }
+
+                if (mapping.heap && (mapping.byteOffsets[i] % (64 * 1024)) != 0)
+                {
+                    std::stringstream ss;
+                    ss << "updateTextureTileMappings: tileMappings[" << mappingIndex << "] byteOffsets[" << i << "] = "
+                        << mapping.byteOffsets[i] << " is not aligned to 64 KB";
+                    error(ss.str());
+                    return;
+                }
+            }
+        }
+
+        m_Device->updateTextureTileMappings(texture, tileMappings, numTileMappings, executionQueue);
+    }
     
     TextureHandle DeviceWrapper::createHandleForNativeTexture(ObjectType objectType, Object texture, const TextureDesc& desc)
     {
@@ -330,11 +465,25 @@ namespace nvrhi::validation
         if (patchedDesc.debugName.empty())
             patchedDesc.debugName = utils::GenerateTextureDebugName(patchedDesc);
 
+        if (cpuAccess != CpuAccessMode::Read && cpuAccess != CpuAccessMode::Write)
+        {
+            std::stringstream ss;
+            ss << "Staging texture " << patchedDesc.debugName << " must have cpuAccess set to Read or Write.";
+            error(ss.str());
+            return nullptr;
+        }
+
         return m_Device->createStagingTexture(patchedDesc, cpuAccess);
     }
 
     void * DeviceWrapper::mapStagingTexture(IStagingTexture* tex, const TextureSlice& slice, CpuAccessMode cpuAccess, size_t *outRowPitch)
     {
+        if (cpuAccess != CpuAccessMode::Read && cpuAccess != CpuAccessMode::Write)
+        {
+            error("mapStagingTexture: cpuAccess must be Read or Write, the Discard and NoOverwrite modes only apply to buffers");
+            return nullptr;
+        }
+
         return m_Device->mapStagingTexture(tex, slice, cpuAccess, outRowPitch);
     }
 
@@ -357,14 +506,6 @@ namespace nvrhi::validation
             return nullptr;
         }
 
-        if (d.isVolatile && d.maxVersions == 0)
-        {
-            std::stringstream ss;
-            ss << "Volatile constant buffer " << patchedDesc.debugName << " has maxVersions = 0";
-            error(ss.str());
-            return nullptr;
-        }
-
         if (d.isVolatile && (d.isVertexBuffer || d.isIndexBuffer || d.isDrawIndirectArgs || d.canHaveUAVs || d.isAccelStructBuildInput || d.isAccelStructStorage || d.isShaderBindingTable || d.isVirtual))
         {
             std::stringstream ss;
@@ -382,6 +523,22 @@ namespace nvrhi::validation
             return nullptr;
         }
 
+        if (d.cpuAccess == CpuAccessMode::Discard || d.cpuAccess == CpuAccessMode::NoOverwrite)
+        {
+            std::stringstream ss;
+            ss << "Buffer " << patchedDesc.debugName << " has cpuAccess = " << (d.cpuAccess == CpuAccessMode::Discard ? "Discard" : "NoOverwrite")
+               << ", which is only valid for mapBuffer. Use CpuAccessMode::Write to create the buffer.";
+            error(ss.str());
+            return nullptr;
+        }
+
+        if (d.preferDeviceLocal && (d.cpuAccess == CpuAccessMode::None || d.cpuAccess == CpuAccessMode::Read))
+        {
+            std::stringstream ss;
+            ss << "Buffer " << patchedDesc.debugName << " has preferDeviceLocal = true, which only has an effect with cpuAccess = Write.";
+            warning(ss.str());
+        }
+
         if (d.isVolatile && d.cpuAccess != CpuAccessMode::None)
         {
             std::stringstream ss;
@@ -396,6 +553,12 @@ namespace nvrhi::validation
             return nullptr;
         }
 
+        if (!validateNodeMask(d.creationNodeMask, "Buffer " + patchedDesc.debugName, "creationNodeMask") ||
+            !validateNodeMask(d.visibleNodeMask, "Buffer " + patchedDesc.debugName, "visibleNodeMask"))
+        {
+            return nullptr;
+        }
+
         if (d.keepInitialState && d.initialState == ResourceStates::Unknown)
         {
             std::stringstream ss;
@@ -407,11 +570,67 @@ namespace nvrhi::validation
         return m_Device->createBuffer(patchedDesc);
     }
 
+    bool DeviceWrapper::validateNodeMask(uint32_t nodeMask, const std::string& objectName, const char* maskName) const
+    {
+        if (nodeMask == 0)
+            return true;
+
+        MultiGPUFeatureInfo info;
+        m_Device->queryFeatureSupport(Feature::MultiGPU, &info, sizeof(info));
+
+        if (info.numNodes < 32 && (nodeMask >> info.numNodes) != 0)
+        {
+            std::stringstream ss;
+            ss << objectName << ": " << maskName << " (0x" << std::hex << nodeMask << std::dec
+               << ") selects nodes that don't exist, the device has " << info.numNodes << " node(s)";
+            error(ss.str());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool DeviceWrapper::validateMapBuffer(IBuffer* buffer, CpuAccessMode cpuAccess, const char* function) const
+    {
+        if (!buffer)
+        {
+            std::stringstream ss;
+            ss << function << ": buffer is NULL";
+            error(ss.str());
+            return false;
+        }
+
+        const BufferDesc& desc = buffer->getDesc();
+        const CpuAccessMode requiredAccess = (cpuAccess == CpuAccessMode::Read) ? CpuAccessMode::Read : CpuAccessMode::Write;
+
+        if (cpuAccess == CpuAccessMode::None || desc.cpuAccess != requiredAccess)
+        {
+            std::stringstream ss;
+            ss << function << ": buffer " << utils::DebugNameToString(desc.debugName) << " cannot be mapped with this cpuAccess mode. "
+               << "Read requires a buffer created with CpuAccessMode::Read, and Write, Discard or NoOverwrite require CpuAccessMode::Write.";
+            error(ss.str());
+            return false;
+        }
+
+        return true;
+    }
+
     void * DeviceWrapper::mapBuffer(IBuffer* b, CpuAccessMode mapFlags)
     {
+        if (!validateMapBuffer(b, mapFlags, "mapBuffer"))
+            return nullptr;
+
         return m_Device->mapBuffer(b, mapFlags);
     }
 
+    void * DeviceWrapper::tryMapBuffer(IBuffer* b, CpuAccessMode mapFlags, SubmissionId* outLastUse)
+    {
+        if (!validateMapBuffer(b, mapFlags, "tryMapBuffer"))
+            return nullptr;
+
+        return m_Device->tryMapBuffer(b, mapFlags, outLastUse);
+    }
+
     void DeviceWrapper::unmapBuffer(IBuffer* b)
     {
         m_Device->unmapBuffer(b);
@@ -591,6 +810,69 @@ namespace nvrhi::validation
         return m_Device->resetTimerQuery(query);
     }
 
+    GpuProfilerHandle DeviceWrapper::createGpuProfiler(const GpuProfilerDesc& desc)
+    {
+        if (desc.queue == CommandQueue::Copy)
+        {
+            error("GPU profiler cannot be created for the copy queue");
+            return nullptr;
+        }
+
+        if (desc.maxScopesPerFrame == 0 || desc.maxFramesInFlight == 0)
+        {
+            error("GpuProfilerDesc::maxScopesPerFrame and maxFramesInFlight must be nonzero");
+            return nullptr;
+        }
+
+        return m_Device->createGpuProfiler(desc);
+    }
+
+    OcclusionQueryHandle DeviceWrapper::createOcclusionQuery(const OcclusionQueryDesc& desc)
+    {
+        return m_Device->createOcclusionQuery(desc);
+    }
+
+    bool DeviceWrapper::pollOcclusionQuery(IOcclusionQuery* query)
+    {
+        return m_Device->pollOcclusionQuery(query);
+    }
+
+    uint64_t DeviceWrapper::getOcclusionQueryResult(IOcclusionQuery* query)
+    {
+        return m_Device->getOcclusionQueryResult(query);
+    }
+
+    void DeviceWrapper::resetOcclusionQuery(IOcclusionQuery* query)
+    {
+        m_Device->resetOcclusionQuery(query);
+    }
+
+    PipelineStatisticsQueryHandle DeviceWrapper::createPipelineStatisticsQuery()
+    {
+        if (!m_Device->queryFeatureSupport(Feature::PipelineStatisticsQueries))
+        {
+            error("Pipeline statistics queries are not supported by this device (Feature::PipelineStatisticsQueries)");
+            return nullptr;
+        }
+
+        return m_Device->createPipelineStatisticsQuery();
+    }
+
+    bool DeviceWrapper::pollPipelineStatisticsQuery(IPipelineStatisticsQuery* query)
+    {
+        return m_Device->pollPipelineStatisticsQuery(query);
+    }
+
+    PipelineStatistics DeviceWrapper::getPipelineStatistics(IPipelineStatisticsQuery* query)
+    {
+        return m_Device->getPipelineStatistics(query);
+    }
+
+    void DeviceWrapper::resetPipelineStatisticsQuery(IPipelineStatisticsQuery* query)
+    {
+        m_Device->resetPipelineStatisticsQuery(query);
+    }
+
     GraphicsAPI DeviceWrapper::getGraphicsAPI()
     {
         return m_Device->getGraphicsAPI();
@@ -1022,6 +1304,12 @@ namespace nvrhi::validation
             return false;
         }
 
+        if (renderState.extendedDynamicState && !m_Device->queryFeatureSupport(Feature::ExtendedDynamicState))
+        {
+            error("Extended dynamic state is not supported by this device (Feature::ExtendedDynamicState)");
+            return false;
+        }
+
         return true;
     }
 
@@ -1050,6 +1338,24 @@ namespace nvrhi::validation
         return m_Device->createGraphicsPipeline(pipelineDesc, fb);
     }
 
+    GraphicsStateBlockHandle DeviceWrapper::createGraphicsStateBlock(const GraphicsState& state)
+    {
+        if (!state.pipeline || !state.framebuffer)
+        {
+            error("createGraphicsStateBlock: pipeline or framebuffer is NULL");
+            return nullptr;
+        }
+
+        if (state.framebuffer->getFramebufferInfo() != state.pipeline->getFramebufferInfo())
+        {
+            error("createGraphicsStateBlock: The framebuffer does not match the framebuffer used to create the pipeline.\n"
+                "Formats and sample counts of the framebuffers must match.");
+            return nullptr;
+        }
+
+        return m_Device->createGraphicsStateBlock(state);
+    }
+
     ComputePipelineHandle DeviceWrapper::createComputePipeline(const ComputePipelineDesc& pipelineDesc)
     {
         if (!pipelineDesc.CS)
@@ -1091,14 +1397,229 @@ namespace nvrhi::validation
         if (!validateRenderState(pipelineDesc.renderState, fb))
             return nullptr;
 
+        if (pipelineDesc.renderState.extendedDynamicState)
+        {
+            error("createMeshletPipeline: extended dynamic state is only supported for graphics pipelines");
+            return nullptr;
+        }
+
         return m_Device->createMeshletPipeline(pipelineDesc, fb);
     }
 
     nvrhi::rt::PipelineHandle DeviceWrapper::createRayTracingPipeline(const rt::PipelineDesc& desc)
     {
+        if ((desc.isLibrary || !desc.libraries.empty()) && !m_Device->queryFeatureSupport(Feature::RayTracingPipelineLibraries))
+        {
+            error("createRayTracingPipeline: pipeline libraries are not supported by this device (Feature::RayTracingPipelineLibraries)");
+            return nullptr;
+        }
+
+        if (desc.isLibrary && !desc.libraries.empty())
+        {
+            error("createRayTracingPipeline: a pipeline library cannot link other libraries");
+            return nullptr;
+        }
+
+        for (size_t index = 0; index < desc.libraries.size(); index++)
+        {
+            const rt::PipelineHandle& library = desc.libraries[index];
+
+            if (!library)
+            {
+                std::stringstream ss;
+                ss << "createRayTracingPipeline: libraries[" << index << "] is NULL";
+                error(ss.str());
+                return nullptr;
+            }
+
+            const rt::PipelineDesc& libraryDesc = library->getDesc();
+
+            if (!libraryDesc.isLibrary)
+            {
+                std::stringstream ss;
+                ss << "createRayTracingPipeline: libraries[" << index << "] was not created with isLibrary = true";
+                error(ss.str());
+                return nullptr;
+            }
+
+            if (arraysAreDifferent(libraryDesc.globalBindingLayouts, desc.globalBindingLayouts) ||
+                libraryDesc.maxPayloadSize != desc.maxPayloadSize ||
+                libraryDesc.maxAttributeSize != desc.maxAttributeSize ||
+                libraryDesc.maxRecursionDepth != desc.maxRecursionDepth)
+            {
+                std::stringstream ss;
+                ss << "createRayTracingPipeline: libraries[" << index << "] has different global binding layouts, "
+                    "payload size, attribute size or recursion depth than the pipeline it is linked into";
+                error(ss.str());
+                return nullptr;
+            }
+        }
+
         return m_Device->createRayTracingPipeline(desc);
     }
 
+    CommandSignatureHandle DeviceWrapper::createCommandSignature(const CommandSignatureDesc& desc)
+    {
+        if (!m_Device->queryFeatureSupport(Feature::CommandSignatures))
+        {
+            error("Command signatures are not supported by this device (Feature::CommandSignatures)");
+            return nullptr;
+        }
+
+        if (desc.arguments.empty())
+        {
+            error("CommandSignatureDesc must have at least one argument");
+            return nullptr;
+        }
+
+        const IndirectArgumentType finalType = desc.arguments.back().type;
+        if (finalType != IndirectArgumentType::Draw && finalType != IndirectArgumentType::DrawIndexed && finalType != IndirectArgumentType::Dispatch)
+        {
+            error("The last argument of a command signature must be Draw, DrawIndexed or Dispatch");
+            return nullptr;
+        }
+
+        bool anyErrors = false;
+        std::stringstream ss;
+
+        for (size_t index = 0; index < desc.arguments.size(); index++)
+        {
+            const IndirectArgumentDesc& argument = desc.arguments[index];
+
+            switch (argument.type)
+            {
+            case IndirectArgumentType::Draw:
+            case IndirectArgumentType::DrawIndexed:
+            case IndirectArgumentType::Dispatch:
+                if (index != desc.arguments.size() - 1)
+                {
+                    ss << "Command signature argument " << index << " is a draw or dispatch, but it is not the last argument." << std::endl;
+                    anyErrors = true;
+                }
+                break;
+
+            case IndirectArgumentType::VertexBuffer:
+            case IndirectArgumentType::IndexBuffer:
+                if (finalType == IndirectArgumentType::Dispatch)
+                {
+                    ss << "Command signature argument " << index << " changes vertex or index buffers, which is invalid in a dispatch signature." << std::endl;
+                    anyErrors = true;
+                }
+                if (argument.type == IndirectArgumentType::VertexBuffer && argument.vertexBufferSlot >= c_MaxVertexAttributes)
+                {
+                    ss << "Command signature argument " << index << " uses an invalid vertex buffer slot " << argument.vertexBufferSlot << "." << std::endl;
+                    anyErrors = true;
+                }
+                break;
+
+            case IndirectArgumentType::PushConstants: {
+                const bool isDispatch = finalType == IndirectArgumentType::Dispatch;
+                if (isDispatch ? !desc.computePipeline : !desc.graphicsPipeline)
+                {
+                    ss << "Command signature argument " << index << " changes push constants, which requires the "
+                        << (isDispatch ? "computePipeline" : "graphicsPipeline") << " to be specified." << std::endl;
+                    anyErrors = true;
+                    break;
+                }
+                if (argument.numPushConstantValues == 0)
+                {
+                    ss << "Command signature argument " << index << " has zero push constant values." << std::endl;
+                    anyErrors = true;
+                    break;
+                }
+
+                const BindingLayoutVector& bindingLayouts = isDispatch
+                    ? desc.computePipeline->getDesc().bindingLayouts
+                    : desc.graphicsPipeline->getDesc().bindingLayouts;
+
+                uint32_t pushConstantSize = 0;
+                for (const BindingLayoutHandle& layout : bindingLayouts)
+                {
+                    const BindingLayoutDesc* layoutDesc = layout->getDesc();
+                    if (!layoutDesc) // bindless layouts have null desc
+                        continue;
+
+                    for (const BindingLayoutItem& item : layoutDesc->bindings)
+                    {
+                        if (item.type == ResourceType::PushConstants)
+                            pushConstantSize = item.size;
+                    }
+                }
+
+                const uint64_t endBytes = (uint64_t(argument.pushConstantOffset) + argument.numPushConstantValues) * sizeof(uint32_t);
+                if (endBytes > pushConstantSize)
+                {
+                    ss << "Command signature argument " << index << " writes push constant bytes up to " << endBytes
+                        << ", but the pipeline's binding layouts declare " << pushConstantSize << " bytes of push constants." << std::endl;
+                    anyErrors = true;
+                }
+                break;
+            }
+
+            default:
+                ss << "Command signature argument " << index << " has an invalid type." << std::endl;
+                anyErrors = true;
+                break;
+            }
+        }
+
+        if (desc.byteStride % 4 != 0)
+        {
+            ss << "Command signature byte stride (" << desc.byteStride << ") must be a multiple of 4." << std::endl;
+            anyErrors = true;
+        }
+
+        uint32_t packedSize = 0;
+        for (const IndirectArgumentDesc& argument : desc.arguments)
+            packedSize += argument.getByteSize();
+
+        if (desc.byteStride != 0 && desc.byteStride < packedSize)
+        {
+            ss << "Command signature byte stride (" << desc.byteStride << ") is smaller than the size of its arguments ("
+                << packedSize << ")." << std::endl;
+            anyErrors = true;
+        }
+
+        if (anyErrors)
+        {
+            error("Cannot create a command signature:\n" + ss.str());
+            return nullptr;
+        }
+
+        return m_Device->createCommandSignature(desc);
+    }
+
+    bool DeviceWrapper::exportPipelineCache(std::vector<uint8_t>& outData)
+    {
+        return m_Device->exportPipelineCache(outData);
+    }
+
+    bool DeviceWrapper::importPipelineCache(const void* data, size_t dataSize)
+    {
+        if (!data || dataSize == 0)
+        {
+            error("importPipelineCache: data is NULL or empty");
+            return false;
+        }
+
+        return m_Device->importPipelineCache(data, dataSize);
+    }
+
+    void DeviceWrapper::setTaskScheduler(ITaskScheduler* scheduler)
+    {
+        m_Device->setTaskScheduler(scheduler);
+    }
+
+    void DeviceWrapper::setTraceRecorder(ITraceRecorder* recorder)
+    {
+        m_Device->setTraceRecorder(recorder);
+    }
+
+    ITaskScheduler* DeviceWrapper::getTaskScheduler()
+    {
+        return m_Device->getTaskScheduler();
+    }
+
     BindingLayoutHandle DeviceWrapper::createBindingLayout(const BindingLayoutDesc& desc)
     {
         std::stringstream errorStream;
@@ -1156,6 +1677,16 @@ namespace nvrhi::validation
 
                 pushConstantCount++;
             }
+
+            if (item.type == ResourceType::VolatileConstantBuffer && desc.promoteSmallVolatileConstantBuffers && item.size != 0)
+            {
+                if (item.size > c_MaxPushConstantSize || (item.size % 4) != 0)
+                {
+                    errorStream << "Volatile constant buffer at slot " << item.slot << " has size " << item.size
+                        << ", which must be a multiple of 4 and not exceed " << c_MaxPushConstantSize << " bytes to be promoted to root constants" << std::endl;
+                    anyErrors = true;
+                }
+            }
         }
 
         if (noneItemCount)
@@ -1501,19 +2032,26 @@ namespace nvrhi::validation
         return true;
     }
 
-    BindingSetHandle DeviceWrapper::createBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+    bool DeviceWrapper::validateBindingSetDesc(const BindingSetDesc& desc, IBindingLayout* layout)
     {
         if (layout == nullptr)
         {
             error("Cannot create a binding set without a valid layout");
-            return nullptr;
+            return false;
         }
 
         const BindingLayoutDesc* layoutDesc = layout->getDesc();
         if (!layoutDesc)
         {
             error("Cannot create a binding set from a bindless layout");
-            return nullptr;
+            return false;
+        }
+
+        if (layoutDesc->usePushDescriptors)
+        {
+            error("Cannot create a binding set from a layout that uses push descriptors, "
+                "use ICommandList::setPushBindings instead");
+            return false;
         }
 
         std::stringstream errorStream;
@@ -1590,9 +2128,17 @@ namespace nvrhi::validation
         if (anyErrors)
         {
             error(errorStream.str());
-            return nullptr;
+            return false;
         }
 
+        return true;
+    }
+
+    BindingSetHandle DeviceWrapper::createBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+    {
+        if (!validateBindingSetDesc(desc, layout))
+            return nullptr;
+
         // Unwrap the resources
         BindingSetDesc patchedDesc = desc;
         for (auto& binding : patchedDesc.bindings)
@@ -1616,6 +2162,18 @@ namespace nvrhi::validation
 
     void DeviceWrapper::resizeDescriptorTable(IDescriptorTable* descriptorTable, uint32_t newSize, bool keepContents)
     {
+        IBindingLayout* layout = descriptorTable ? descriptorTable->getLayout() : nullptr;
+        const BindlessLayoutDesc* bindlessDesc = layout ? layout->getBindlessDesc() : nullptr;
+
+        if (bindlessDesc && bindlessDesc->maxCapacity != 0 && newSize > bindlessDesc->maxCapacity)
+        {
+            std::stringstream ss;
+            ss << "resizeDescriptorTable: newSize (" << newSize << ") exceeds the layout's maxCapacity ("
+               << bindlessDesc->maxCapacity << ")";
+            error(ss.str());
+            return;
+        }
+
         m_Device->resizeDescriptorTable(descriptorTable, newSize, keepContents);
     }
 
@@ -1635,6 +2193,36 @@ namespace nvrhi::validation
         return m_Device->writeDescriptorTable(descriptorTable, patchedItem);
     }
 
+    bool DeviceWrapper::writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem* items, size_t numItems)
+    {
+        if (numItems != 0 && !items)
+        {
+            error("writeDescriptorTable: items is NULL");
+            return false;
+        }
+
+        std::vector<BindingSetItem> patchedItems;
+        patchedItems.reserve(numItems);
+
+        for (size_t index = 0; index < numItems; index++)
+        {
+            std::stringstream errorStream;
+
+            if (!validateBindingSetItem(items[index], true, errorStream))
+            {
+                std::stringstream ss;
+                ss << "writeDescriptorTable: item " << index << ": " << errorStream.str();
+                error(ss.str());
+                return false;
+            }
+
+            BindingSetItem& patchedItem = patchedItems.emplace_back(items[index]);
+            patchedItem.resourceHandle = unwrapResource(patchedItem.resourceHandle);
+        }
+
+        return m_Device->writeDescriptorTable(descriptorTable, patchedItems.data(), patchedItems.size());
+    }
+
     rt::OpacityMicromapHandle DeviceWrapper::createOpacityMicromap(const rt::OpacityMicromapDesc& desc)
     {
         if (desc.inputBuffer == nullptr)
@@ -1801,12 +2389,47 @@ namespace nvrhi::validation
             return nullptr;
         }
 
+        if (params.isBundle)
+        {
+            if (!m_Device->queryFeatureSupport(Feature::CommandListBundles))
+            {
+                error("Bundle command lists are not supported by this device");
+                return nullptr;
+            }
+
+            if (params.queueType != CommandQueue::Graphics)
+            {
+                error("Bundle command lists can only be created for the graphics queue");
+                return nullptr;
+            }
+
+            if (!params.bundleFramebuffer)
+            {
+                error("Bundle command lists require a non-NULL bundleFramebuffer");
+                return nullptr;
+            }
+        }
+
+        if (!validateNodeMask(params.nodeMask, "createCommandList", "nodeMask"))
+            return nullptr;
+
+        if (params.nodeMask > 1 && m_Device->getGraphicsAPI() == GraphicsAPI::D3D12)
+        {
+            // The shader-visible descriptor heaps and the queue synchronization only exist on node 0
+            if ((params.nodeMask & (params.nodeMask - 1)) != 0 || params.queueType != CommandQueue::Copy || params.isBundle)
+            {
+                error("createCommandList: On DX12, command lists for nodes other than node 0 must select exactly one node "
+                    "and use the copy queue, and they cannot be bundles");
+                return nullptr;
+            }
+        }
+
         CommandListHandle commandList = m_Device->createCommandList(params);
 
         if (commandList == nullptr)
             return nullptr;
 
-        CommandListWrapper* wrapper = new CommandListWrapper(this, commandList, params.enableImmediateExecution, params.queueType);
+        CommandListWrapper* wrapper = new CommandListWrapper(this, commandList, params.enableImmediateExecution && !params.isBundle, params.isBundle, params.queueType);
         return CommandListHandle::Create(wrapper);
     }
     
@@ -1835,6 +2458,24 @@ namespace nvrhi::validation
             }
 
             const CommandListParameters& desc = pCommandLists[i]->getDesc();
+            if (desc.isBundle)
+            {
+                std::stringstream ss;
+                ss << "executeCommandLists: The command list [" << i << "] is a bundle, which can only be executed "
+                    "through ICommandList::executeBundle";
+                error(ss.str());
+                return 0;
+            }
+
+            if (desc.nodeMask != pCommandLists[0]->getDesc().nodeMask)
+            {
+                std::stringstream ss;
+                ss << "executeCommandLists: The command list [" << i << "] has a different nodeMask than the command list [0], "
+                    "all command lists in one call must execute on the same nodes";
+                error(ss.str());
+                return 0;
+            }
+
             if (desc.queueType != executionQueue)
             {
                 std::stringstream ss;
@@ -1869,11 +2510,86 @@ namespace nvrhi::validation
         m_Device->waitForIdle();
     }
 
+    void DeviceWrapper::setDeferredSubmission(bool enable)
+    {
+        m_Device->setDeferredSubmission(enable);
+    }
+
+    void DeviceWrapper::flushSubmissions()
+    {
+        m_Device->flushSubmissions();
+    }
+
+    bool DeviceWrapper::waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds)
+    {
+        if (numSubmissions == 0)
+            return true;
+
+        if (!queues || !instances)
+        {
+            error("waitForSubmissions: queues or instances is NULL");
+            return false;
+        }
+
+        for (size_t i = 0; i < numSubmissions; i++)
+        {
+            if (queues[i] >= CommandQueue::Count)
+            {
+                std::stringstream ss;
+                ss << "waitForSubmissions: queues[" << i << "] is not a valid queue";
+                error(ss.str());
+                return false;
+            }
+        }
+
+        return m_Device->waitForSubmissions(queues, instances, numSubmissions, waitAll, timeoutNanoseconds);
+    }
+
+    bool DeviceWrapper::isFullValidationFrame() const
+    {
+        if (m_Desc.level == ValidationLevel::Full)
+            return true;
+
+        return m_Desc.fullValidationFrameInterval != 0 && (m_FrameIndex % m_Desc.fullValidationFrameInterval) == 0;
+    }
+
     void DeviceWrapper::runGarbageCollection()
     {
+        ++m_FrameIndex;
         m_Device->runGarbageCollection();
     }
 
+    bool DeviceWrapper::runGarbageCollection(uint32_t maxMicroseconds)
+    {
+        ++m_FrameIndex;
+        return m_Device->runGarbageCollection(maxMicroseconds);
+    }
+
+    MemoryStatistics DeviceWrapper::getMemoryStatistics()
+    {
+        return m_Device->getMemoryStatistics();
+    }
+
+    CommandListStatistics DeviceWrapper::getCommandListStatistics(bool reset)
+    {
+        return m_Device->getCommandListStatistics(reset);
+    }
+
+    void DeviceWrapper::setObjectCacheEnabled(bool enable)
+    {
+        m_Device->setObjectCacheEnabled(enable);
+    }
+
+    ObjectCacheStatistics DeviceWrapper::getObjectCacheStatistics(bool reset)
+    {
+        return m_Device->getObjectCacheStatistics(reset);
+    }
+
+    void DeviceWrapper::setMemoryBudgetCallback(IMemoryBudgetCallback* callback)
+    {
+        m_Device->setMemoryBudgetCallback(callback);
+    }
+
     bool DeviceWrapper::queryFeatureSupport(Feature feature, void* pInfo, size_t infoSize)
     {
         return m_Device->queryFeatureSupport(feature, pInfo, infoSize);
@@ -25,7 +25,7 @@
 namespace nvrhi::vulkan
 {
 
-    static vk::MemoryPropertyFlags pickBufferMemoryProperties(const BufferDesc& d)
+    static vk::MemoryPropertyFlags pickBufferMemoryProperties(const BufferDesc& d, bool deviceLocalHostVisible)
     {
         vk::MemoryPropertyFlags flags{};
 
@@ -38,82 +38,310 @@ namespace nvrhi::vulkan
             flags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached;
             break;
         case CpuAccessMode::Write:
+        case CpuAccessMode::Discard:
+        case CpuAccessMode::NoOverwrite:
             flags = vk::MemoryPropertyFlagBits::eHostVisible;
+            if (d.preferDeviceLocal && deviceLocalHostVisible)
+                flags |= vk::MemoryPropertyFlagBits::eDeviceLocal;
             break;
         }
 
         return flags;
     }
 
-    vk::Result VulkanAllocator::allocateBufferMemory(Buffer *buffer, bool enableDeviceAddress) const
+    VulkanAllocator::~VulkanAllocator()
     {
-        // figure out memory requirements
-        vk::MemoryRequirements memRequirements;
-        m_Context.device.getBufferMemoryRequirements(buffer->buffer, &memRequirements);
+        for (auto& pool : m_Pools)
+        {
+            for (auto& block : pool.blocks)
+            {
+                if (!block->ranges.isEmpty())
+                    m_Context.warning("VulkanAllocator is destroyed while some resources still use its memory");
+
+                if (block->mappedMemory)
+                    m_Context.device.unmapMemory(block->memory);
+
+                m_Context.device.freeMemory(block->memory, m_Context.allocationCallbacks);
+            }
+        }
+    }
+
+    vk::Result VulkanAllocator::allocateBufferMemory(Buffer *buffer, bool enableDeviceAddress)
+    {
+        // figure out memory requirements, and whether the driver wants this buffer to have its own allocation
+        const auto requirementsChain = m_Context.device.getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+            vk::BufferMemoryRequirementsInfo2().setBuffer(buffer->buffer));
+        const vk::MemoryRequirements& memRequirements = requirementsChain.get<vk::MemoryRequirements2>().memoryRequirements;
+        const auto& dedicatedRequirements = requirementsChain.get<vk::MemoryDedicatedRequirements>();
 
-        // allocate memory
         const bool enableMemoryExport = (buffer->desc.sharedResourceFlags & SharedResourceFlags::Shared) != 0;
-        const vk::Result res = allocateMemory(buffer, memRequirements, pickBufferMemoryProperties(buffer->desc), enableDeviceAddress, enableMemoryExport, nullptr, buffer->buffer);
+        // The sub-allocation blocks have instances on every device of the group
+        const uint32_t deviceMask = (m_Context.deviceGroupSize > 1) ? buffer->desc.creationNodeMask : 0;
+        const bool useDedicatedAllocation = enableMemoryExport
+            || deviceMask != 0
+            || dedicatedRequirements.prefersDedicatedAllocation
+            || dedicatedRequirements.requiresDedicatedAllocation
+            || memRequirements.size >= c_MaxSubAllocationSize;
+
+        auto allocate = [&](vk::MemoryPropertyFlags memProperties)
+        {
+            if (useDedicatedAllocation)
+                return allocateMemory(buffer, memRequirements, memProperties, enableDeviceAddress, enableMemoryExport, nullptr, buffer->buffer, deviceMask);
+
+            return subAllocateMemory(buffer, memRequirements, memProperties, true, enableDeviceAddress);
+        };
+
+        // allocate memory
+        const vk::MemoryPropertyFlags memProperties = pickBufferMemoryProperties(buffer->desc, m_Context.deviceLocalHostVisibleMemory);
+        vk::Result res = allocate(memProperties);
+
+        // The BAR heap can run out before the system memory does
+        if (res != vk::Result::eSuccess && buffer->desc.preferDeviceLocal && (memProperties & vk::MemoryPropertyFlagBits::eDeviceLocal))
+            res = allocate(pickBufferMemoryProperties(buffer->desc, false));
         CHECK_VK_RETURN(res)
 
-        m_Context.device.bindBufferMemory(buffer->buffer, buffer->memory, 0);
+        m_Context.device.bindBufferMemory(buffer->buffer, buffer->memory, buffer->memoryOffset);
 
         return vk::Result::eSuccess;
     }
 
-    void VulkanAllocator::freeBufferMemory(Buffer *buffer) const
+    void VulkanAllocator::freeBufferMemory(Buffer *buffer)
     {
         freeMemory(buffer);
     }
 
-    vk::Result VulkanAllocator::allocateTextureMemory(Texture *texture) const
+    vk::Result VulkanAllocator::allocateTextureMemory(Texture *texture)
     {
-        // grab the image memory requirements
-        vk::MemoryRequirements memRequirements;
-        m_Context.device.getImageMemoryRequirements(texture->image, &memRequirements);
+        // grab the image memory requirements, and whether the driver wants this image to have its own allocation
+        const auto requirementsChain = m_Context.device.getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+            vk::ImageMemoryRequirementsInfo2().setImage(texture->image));
+        const vk::MemoryRequirements& memRequirements = requirementsChain.get<vk::MemoryRequirements2>().memoryRequirements;
+        const auto& dedicatedRequirements = requirementsChain.get<vk::MemoryDedicatedRequirements>();
 
-        // allocate memory
         const vk::MemoryPropertyFlags memProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
         const bool enableDeviceAddress = false;
         const bool enableMemoryExport = (texture->desc.sharedResourceFlags & SharedResourceFlags::Shared) != 0;
-        const vk::Result res = allocateMemory(texture, memRequirements, memProperties, enableDeviceAddress, enableMemoryExport, texture->image, nullptr);
+        const uint32_t deviceMask = (m_Context.deviceGroupSize > 1) ? texture->desc.creationNodeMask : 0;
+        const bool useDedicatedAllocation = enableMemoryExport
+            || deviceMask != 0
+            || dedicatedRequirements.prefersDedicatedAllocation
+            || dedicatedRequirements.requiresDedicatedAllocation
+            || memRequirements.size >= c_MaxSubAllocationSize;
+
+        // allocate memory
+        vk::Result res;
+        if (useDedicatedAllocation)
+            res = allocateMemory(texture, memRequirements, memProperties, enableDeviceAddress, enableMemoryExport, texture->image, nullptr, deviceMask);
+        else
+            res = subAllocateMemory(texture, memRequirements, memProperties, texture->imageInfo.tiling == vk::ImageTiling::eLinear, enableDeviceAddress);
         CHECK_VK_RETURN(res)
 
-        m_Context.device.bindImageMemory(texture->image, texture->memory, 0);
+        m_Context.device.bindImageMemory(texture->image, texture->memory, texture->memoryOffset);
 
         return vk::Result::eSuccess;
     }
 
-    void VulkanAllocator::freeTextureMemory(Texture *texture) const
+    void VulkanAllocator::freeTextureMemory(Texture *texture)
     {
         freeMemory(texture);
     }
 
-    vk::Result VulkanAllocator::allocateMemory(MemoryResource *res,
-                                               vk::MemoryRequirements memRequirements,
-                                               vk::MemoryPropertyFlags memPropertyFlags,
-                                                bool enableDeviceAddress,
-                                                bool enableExportMemory,
-                                                VkImage dedicatedImage,
-                                                VkBuffer dedicatedBuffer) const
+    bool VulkanAllocator::findMemoryType(uint32_t memoryTypeBits, vk::MemoryPropertyFlags memPropertyFlags, uint32_t& outMemTypeIndex, vk::MemoryPropertyFlags* outTypeFlags) const
     {
-        res->managed = true;
-
-        // find a memory space that satisfies the requirements
         vk::PhysicalDeviceMemoryProperties memProperties;
         m_Context.physicalDevice.getMemoryProperties(&memProperties);
 
-        uint32_t memTypeIndex;
-        for(memTypeIndex = 0; memTypeIndex < memProperties.memoryTypeCount; memTypeIndex++)
+        for (uint32_t memTypeIndex = 0; memTypeIndex < memProperties.memoryTypeCount; memTypeIndex++)
         {
-            if ((memRequirements.memoryTypeBits & (1 << memTypeIndex)) &&
+            if ((memoryTypeBits & (1 << memTypeIndex)) &&
                 ((memProperties.memoryTypes[memTypeIndex].propertyFlags & memPropertyFlags) == memPropertyFlags))
             {
+                outMemTypeIndex = memTypeIndex;
+                if (outTypeFlags)
+                    *outTypeFlags = memProperties.memoryTypes[memTypeIndex].propertyFlags;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    vk::Result VulkanAllocator::subAllocateMemory(MemoryResource* res,
+                                                  vk::MemoryRequirements memRequirements,
+                                                  vk::MemoryPropertyFlags memPropertyFlags,
+                                                  bool linear,
+                                                  bool enableDeviceAddress)
+    {
+        res->managed = true;
+
+        uint32_t memTypeIndex;
+        vk::MemoryPropertyFlags memTypeFlags;
+        if (!findMemoryType(memRequirements.memoryTypeBits, memPropertyFlags, memTypeIndex, &memTypeFlags))
+        {
+            // xxxnsubtil: this is incorrect; need better error reporting
+            return vk::Result::eErrorOutOfDeviceMemory;
+        }
+
+        // blocks are pooled by memory type, so mapping and alignment must follow the type's flags rather than
+        // the requested ones: a device-local request may land in a host-visible type (UMA, resizable BAR)
+        // and share its blocks with later host-visible requests
+        vk::DeviceSize alignment = memRequirements.alignment;
+        const bool hostVisible = (memTypeFlags & vk::MemoryPropertyFlagBits::eHostVisible) != vk::MemoryPropertyFlags(0);
+        if (hostVisible)
+        {
+            // mapped ranges of non-coherent memory are flushed with nonCoherentAtomSize granularity
+            alignment = std::max(alignment, m_Context.physicalDeviceProperties.limits.nonCoherentAtomSize);
+        }
+
+        std::lock_guard lockGuard(m_Mutex);
+
+        uint32_t poolIndex;
+        for (poolIndex = 0; poolIndex < uint32_t(m_Pools.size()); poolIndex++)
+        {
+            const MemoryPool& pool = m_Pools[poolIndex];
+            if (pool.memoryTypeIndex == memTypeIndex && pool.linear == linear && pool.enableDeviceAddress == enableDeviceAddress)
                 break;
+        }
+
+        if (poolIndex == uint32_t(m_Pools.size()))
+        {
+            MemoryPool pool;
+            pool.memoryTypeIndex = memTypeIndex;
+            pool.linear = linear;
+            pool.enableDeviceAddress = enableDeviceAddress;
+            m_Pools.push_back(std::move(pool));
+        }
+
+        MemoryPool& pool = m_Pools[poolIndex];
+
+        for (auto& block : pool.blocks)
+        {
+            vk::DeviceSize offset;
+            if (block->ranges.allocate(memRequirements.size, alignment, offset))
+            {
+                res->memory = block->memory;
+                res->memoryOffset = offset;
+                res->memorySize = memRequirements.size;
+                res->memoryBlock = block.get();
+                return vk::Result::eSuccess;
             }
         }
 
-        if (memTypeIndex == memProperties.memoryTypeCount)
+        // no space in the existing blocks, create a new one
+        auto block = std::make_unique<MemoryBlock>();
+        block->poolIndex = poolIndex;
+        vk::DeviceSize blockSize = c_DefaultBlockSize;
+
+        auto allocFlags = vk::MemoryAllocateFlagsInfo();
+        if (enableDeviceAddress)
+            allocFlags.flags |= vk::MemoryAllocateFlagBits::eDeviceAddress;
+
+        auto allocInfo = vk::MemoryAllocateInfo()
+            .setMemoryTypeIndex(memTypeIndex)
+            .setPNext(&allocFlags);
+
+        // small memory heaps (such as the host-visible part of VRAM) may not fit a default block,
+        // so retry with smaller blocks that can still hold the requested resource
+        vk::Result result;
+        while (true)
+        {
+            allocInfo.setAllocationSize(blockSize);
+            result = m_Context.device.allocateMemory(&allocInfo, m_Context.allocationCallbacks, &block->memory);
+
+            if (result == vk::Result::eSuccess || blockSize / 2 < memRequirements.size + alignment)
+                break;
+
+            blockSize /= 2;
+        }
+        CHECK_VK_RETURN(result)
+
+        if (hostVisible)
+        {
+            result = m_Context.device.mapMemory(block->memory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags(), &block->mappedMemory);
+            if (result != vk::Result::eSuccess)
+            {
+                m_Context.device.freeMemory(block->memory, m_Context.allocationCallbacks);
+                return result;
+            }
+        }
+
+        block->ranges.reset(blockSize);
+
+        vk::DeviceSize offset = 0;
+        [[maybe_unused]] const bool allocated = block->ranges.allocate(memRequirements.size, alignment, offset);
+        assert(allocated);
+
+        res->memory = block->memory;
+        res->memoryOffset = offset;
+        res->memorySize = memRequirements.size;
+        res->memoryBlock = block.get();
+
+        pool.blocks.push_back(std::move(block));
+
+        return vk::Result::eSuccess;
+    }
+
+    void VulkanAllocator::releaseSubAllocation(MemoryResource* res)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        MemoryBlock* block = res->memoryBlock;
+        block->ranges.release(res->memoryOffset, res->memorySize);
+
+        MemoryPool& pool = m_Pools[block->poolIndex];
+
+        // release empty blocks back to the driver, but keep one per pool to avoid thrashing
+        if (block->ranges.isEmpty() && pool.blocks.size() > 1)
+        {
+            if (block->mappedMemory)
+                m_Context.device.unmapMemory(block->memory);
+
+            m_Context.device.freeMemory(block->memory, m_Context.allocationCallbacks);
+
+            pool.blocks.erase(std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; }));
+        }
+    }
+
+    void* VulkanAllocator::mapMemory(MemoryResource* res, vk::DeviceSize offset, vk::DeviceSize size) const
+    {
+        if (res->memoryBlock)
+        {
+            assert(res->memoryBlock->mappedMemory);
+            return static_cast<uint8_t*>(res->memoryBlock->mappedMemory) + res->memoryOffset + offset;
+        }
+
+        void* ptr = nullptr;
+        [[maybe_unused]] const vk::Result result = m_Context.device.mapMemory(res->memory, offset, size, vk::MemoryMapFlags(), &ptr);
+        assert(result == vk::Result::eSuccess);
+
+        return ptr;
+    }
+
+    void VulkanAllocator::unmapMemory(MemoryResource* res) const
+    {
+        // sub-allocated blocks remain mapped for their whole lifetime
+        if (!res->memoryBlock)
+            m_Context.device.unmapMemory(res->memory);
+    }
+
+    vk::Result VulkanAllocator::allocateMemory(MemoryResource *res,
+                                               vk::MemoryRequirements memRequirements,
+                                               vk::MemoryPropertyFlags memPropertyFlags,
+                                                bool enableDeviceAddress,
+                                                bool enableExportMemory,
+                                                VkImage dedicatedImage,
+                                                VkBuffer dedicatedBuffer,
+                                                uint32_t deviceMask) const
+    {
+        res->managed = true;
+        res->memoryOffset = 0;
+        res->memorySize = memRequirements.size;
+        res->memoryBlock = nullptr;
+
+        // find a memory space that satisfies the requirements
+        uint32_t memTypeIndex;
+        if (!findMemoryType(memRequirements.memoryTypeBits, memPropertyFlags, memTypeIndex))
         {
             // xxxnsubtil: this is incorrect; need better error reporting
             return vk::Result::eErrorOutOfDeviceMemory;
@@ -123,6 +351,12 @@ namespace nvrhi::vulkan
         auto allocFlags = vk::MemoryAllocateFlagsInfo();
         if (enableDeviceAddress)
             allocFlags.flags |= vk::MemoryAllocateFlagBits::eDeviceAddress;
+        if (deviceMask != 0)
+        {
+            // Allocate instances of the memory only on the selected devices of the group
+            allocFlags.flags |= vk::MemoryAllocateFlagBits::eDeviceMask;
+            allocFlags.deviceMask = deviceMask;
+        }
         const void* pNext = &allocFlags;
 
         auto dedicatedAllocation = vk::MemoryDedicatedAllocateInfo()
@@ -159,12 +393,19 @@ namespace nvrhi::vulkan
         return m_Context.device.allocateMemory(&allocInfo, m_Context.allocationCallbacks, &res->memory);
     }
 
-    void VulkanAllocator::freeMemory(MemoryResource *res) const
+    void VulkanAllocator::freeMemory(MemoryResource *res)
     {
         assert(res->managed);
 
-        m_Context.device.freeMemory(res->memory, m_Context.allocationCallbacks);
+        if (res->memoryBlock)
+            releaseSubAllocation(res);
+        else
+            m_Context.device.freeMemory(res->memory, m_Context.allocationCallbacks);
+
         res->memory = vk::DeviceMemory(nullptr);
+        res->memoryOffset = 0;
+        res->memorySize = 0;
+        res->memoryBlock = nullptr;
     }
 
 } // namespace nvrhi::vulkan
@@ -26,6 +26,21 @@
 #include <nvrhi/utils.h>
 #include "../common/state-tracking.h"
 #include "../common/versioning.h"
+#include "../common/range-allocator.h"
+#include "../common/push-bindings.h"
+#include "../common/command-list-statistics.h"
+#include "../common/trace-recorder.h"
+#include "../common/graphics-state-block.h"
+#include "../common/upload-ring.h"
+#include "../common/gpu-profiler.h"
+#include "../common/memory-counters.h"
+#include "../common/resource-reference-list.h"
+#include "../common/recycling-queue.h"
+#include "../common/garbage-collection-thread.h"
+#include "../common/object-cache.h"
+#include "../common/startup-timer.h"
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <list>
 
@@ -46,8 +61,10 @@ namespace std
     {
         std::size_t operator()(std::pair<vk::PipelineStageFlags, vk::PipelineStageFlags> const& s) const noexcept
         {
-            return (std::hash<uint32_t>()(uint32_t(s.first))
-                ^ (std::hash<uint32_t>()(uint32_t(s.second)) << 16));
+            size_t hash = 0;
+            nvrhi::hash_combine(hash, uint32_t(s.first));
+            nvrhi::hash_combine(hash, uint32_t(s.second));
+            return hash;
         }
     };
 }
@@ -72,6 +89,7 @@ namespace nvrhi::vulkan
     class GraphicsPipeline;
     class ComputePipeline;
     class BindingSet;
+    class DescriptorBuffer;
     class EvenetQuery;
     class TimerQuery;
     class Marker;
@@ -100,8 +118,9 @@ namespace nvrhi::vulkan
     vk::SamplerAddressMode convertSamplerAddressMode(SamplerAddressMode mode);
     vk::PipelineStageFlagBits2 convertShaderTypeToPipelineStageFlagBits(ShaderType shaderType);
     vk::ShaderStageFlagBits convertShaderTypeToShaderStageFlagBits(ShaderType shaderType);
-    ResourceStateMapping convertResourceState(ResourceStates state);
-    ResourceStateMapping2 convertResourceState2(ResourceStates state);
+    // The stages and accesses are limited to the ones supported by the queue that records the barrier
+    ResourceStateMapping convertResourceState(ResourceStates state, CommandQueue queue);
+    ResourceStateMapping2 convertResourceState2(ResourceStates state, CommandQueue queue);
     vk::PrimitiveTopology convertPrimitiveTopology(PrimitiveType topology);
     vk::PolygonMode convertFillMode(RasterFillMode mode);
     vk::CullModeFlagBits convertCullMode(RasterCullMode mode);
@@ -135,6 +154,14 @@ namespace nvrhi::vulkan
         std::vector<uint64_t> asBuildsCompleted;
         std::mutex asListMutex;
     };
+#else
+    // BLAS'es built with the AllowCompaction flag whose builds have finished executing,
+    // waiting for compactBottomLevelAccelStructs
+    struct AccelStructCompactionResources
+    {
+        std::vector<rt::AccelStructHandle> asBuildsCompleted;
+        std::mutex asListMutex;
+    };
 #endif
 
     // underlying vulkan context
@@ -155,10 +182,14 @@ namespace nvrhi::vulkan
         vk::PhysicalDevice physicalDevice;
         vk::Device device;
         vk::AllocationCallbacks *allocationCallbacks;
-        vk::PipelineCache pipelineCache;
+
+        // Created on first use, see getPipelineCache
+        mutable vk::PipelineCache pipelineCache;
+        mutable std::mutex pipelineCacheMutex;
 
         struct {
             bool KHR_synchronization2 = false;
+            bool KHR_push_descriptor = false;
             bool KHR_maintenance1 = false;
             bool EXT_debug_report = false;
             bool EXT_debug_marker = false;
@@ -166,11 +197,22 @@ namespace nvrhi::vulkan
             bool buffer_device_address = false; // either KHR_ or Vulkan 1.2 versions
             bool KHR_ray_query = false;
             bool KHR_ray_tracing_pipeline = false;
+            bool KHR_pipeline_library = false;
             bool NV_mesh_shader = false;
+            bool EXT_mesh_shader = false;
             bool KHR_fragment_shading_rate = false;
             bool EXT_conservative_rasterization = false;
             bool EXT_opacity_micromap = false;
             bool NV_ray_tracing_invocation_reorder = false;
+            bool KHR_deferred_host_operations = false;
+            bool KHR_draw_indirect_count = false;
+            bool EXT_calibrated_timestamps = false;
+            bool EXT_conditional_rendering = false;
+            bool EXT_memory_budget = false;
+            bool EXT_multi_draw = false;
+            bool KHR_dynamic_rendering = false; // the KHR_ extension or Vulkan 1.3, see DeviceDesc::dynamicRenderingSupported
+            bool EXT_extended_dynamic_state = false; // the EXT_ extension or Vulkan 1.3, see DeviceDesc::extendedDynamicStateSupported
+            bool EXT_descriptor_buffer = false; // see DeviceDesc::descriptorBufferSupported
         } extensions;
 
         vk::PhysicalDeviceProperties physicalDeviceProperties;
@@ -181,15 +223,40 @@ namespace nvrhi::vulkan
         vk::PhysicalDeviceOpacityMicromapPropertiesEXT opacityMicromapProperties;
         vk::PhysicalDeviceRayTracingInvocationReorderPropertiesNV nvRayTracingInvocationReorderProperties;
         vk::PhysicalDeviceFragmentShadingRateFeaturesKHR shadingRateFeatures;
+        vk::PhysicalDeviceMultiDrawPropertiesEXT multiDrawProperties;
+        vk::PhysicalDeviceMultiDrawFeaturesEXT multiDrawFeatures;
+        vk::PhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties;
+        vk::PhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProperties;
         IMessageCallback* messageCallback = nullptr;
+        bool descriptorUpdateAfterBindSupported = false; // see DeviceDesc::descriptorUpdateAfterBindSupported
+        uint32_t deviceGroupSize = 1; // see DeviceDesc::deviceGroupSize
+        bool deviceLocalHostVisibleMemory = false; // resizable BAR, see BufferDesc::preferDeviceLocal
+        DescriptorBuffer* descriptorBuffer = nullptr; // owned by the Device, only exists with EXT_descriptor_buffer
+        // Queue families that share buffers and textures concurrently, see DeviceDesc::enableAutomaticQueueSync.
+        // Empty when resources use exclusive sharing.
+        std::vector<uint32_t> concurrentQueueFamilies;
+        // Graphics and compute queue families that share the acceleration structure and micromap storage and
+        // build input buffers, so that they can be built on the compute queue without ownership transfers.
+        // Empty with a single family.
+        std::vector<uint32_t> accelStructQueueFamilies;
+
+        std::shared_ptr<InternalMemoryCounters> memoryCounters = std::make_shared<InternalMemoryCounters>();
+
+        // See IDevice::setTraceRecorder
+        TraceRecorderSlot traceRecorder;
 #ifdef NVRHI_WITH_RTXMU
         std::unique_ptr<rtxmu::VkAccelStructManager> rtxMemUtil;
         std::unique_ptr<RtxMuResources> rtxMuResources;
+#else
+        std::unique_ptr<AccelStructCompactionResources> compactionResources = std::make_unique<AccelStructCompactionResources>();
 #endif
 
         void nameVKObject(const void* handle, vk::DebugReportObjectTypeEXT objtype, const char* name) const;
         void error(const std::string& message) const;
         void warning(const std::string& message) const;
+
+        // Returns the pipeline cache, creating it if necessary. Returns a null handle if the cache can't be created.
+        vk::PipelineCache getPipelineCache() const;
     };
 
     // command buffer with resource tracking
@@ -201,8 +268,14 @@ namespace nvrhi::vulkan
         vk::CommandBuffer cmdBuf = vk::CommandBuffer();
         vk::CommandPool cmdPool = vk::CommandPool();
 
-        std::vector<RefCountPtr<IResource>> referencedResources; // to keep them alive
+        ResourceReferenceList referencedResources; // to keep them alive, each resource is referenced once
         std::vector<RefCountPtr<Buffer>> referencedStagingBuffers; // to allow synchronous mapBuffer
+        std::vector<std::shared_ptr<TrackedCommandBuffer>> referencedBundles; // secondary command buffers executed by this one
+
+        // Events used by split barriers. Each event is reset by the command buffer after the wait,
+        // and the events are reused after the command buffer is retired.
+        std::vector<vk::Event> splitBarrierEvents;
+        size_t usedSplitBarrierEvents = 0;
 
         uint64_t recordingID = 0;
         uint64_t submissionID = 0;
@@ -210,6 +283,9 @@ namespace nvrhi::vulkan
 #ifdef NVRHI_WITH_RTXMU
         std::vector<uint64_t> rtxmuBuildIds;
         std::vector<uint64_t> rtxmuCompactionIds;
+#else
+        // BLAS'es whose compacted sizes are written by this command buffer
+        std::vector<rt::AccelStructHandle> compactableBuilds;
 #endif
 
         explicit TrackedCommandBuffer(const VulkanContext& context)
@@ -217,6 +293,8 @@ namespace nvrhi::vulkan
         { }
 
         ~TrackedCommandBuffer();
+
+        vk::Event acquireSplitBarrierEvent();
     
     private:
         const VulkanContext& m_Context;
@@ -234,24 +312,36 @@ namespace nvrhi::vulkan
         ~Queue();
 
         // creates a command buffer and its synchronization resources
-        TrackedCommandBufferPtr createCommandBuffer();
+        TrackedCommandBufferPtr createCommandBuffer(vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
 
         TrackedCommandBufferPtr getOrCreateCommandBuffer();
 
-        void addWaitSemaphore(vk::Semaphore semaphore, uint64_t value);
+        // executionQueue is the queue that signals the semaphore, if it is one of the device's queues
+        void addWaitSemaphore(vk::Semaphore semaphore, uint64_t value, Queue* executionQueue = nullptr);
         void addSignalSemaphore(vk::Semaphore semaphore, uint64_t value);
 
-        // submits a command buffer to this queue, returns submissionID
+        // submits sparse binding operations to this queue, ordered with the submissions before and after it
+        void bindSparse(vk::BindSparseInfo bindInfo);
+
+        // queues the command buffers for submission to this queue, returns submissionID.
+        // the command buffers are only submitted to Vulkan by flush().
         uint64_t submit(ICommandList* const* ppCmd, size_t numCmd);
 
-        // retire any command buffers that have finished execution from the pending execution list
-        void retireCommandBuffers();
+        // submits the queued command buffers up to submission 'upToID' with a single vkQueueSubmit2 (or vkQueueSubmit) call,
+        // after flushing the other queues up to the submissions they wait for
+        void flush(uint64_t upToID = ~0ull);
+
+        // retire any command buffers that have finished execution from the pending execution list.
+        // stops after the first command buffer that is retired past 'deadline' and returns false in that case.
+        // thread-safe, so that the background garbage collection can call it.
+        bool retireCommandBuffers(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
 
         TrackedCommandBufferPtr getCommandBufferInFlight(uint64_t submissionID);
 
         uint64_t updateLastFinishedID();
         uint64_t getLastSubmittedID() const { return m_LastSubmittedID; }
-        uint64_t getLastFinishedID() const { return m_LastFinishedID; }
+        uint64_t getLastFlushedID() const { return m_LastFlushedID.load(); }
+        uint64_t getLastFinishedID() const { return m_LastFinishedID.load(std::memory_order_relaxed); }
         CommandQueue getQueueID() const { return m_QueueID; }
         vk::Queue getVkQueue() const { return m_Queue; }
 
@@ -268,23 +358,67 @@ namespace nvrhi::vulkan
         std::mutex m_Mutex;
         std::vector<vk::Semaphore> m_WaitSemaphores;
         std::vector<uint64_t> m_WaitSemaphoreValues;
+        std::vector<Queue*> m_WaitSemaphoreQueues;
         std::vector<vk::Semaphore> m_SignalSemaphores;
         std::vector<uint64_t> m_SignalSemaphoreValues;
 
         uint64_t m_LastRecordingID = 0;
         uint64_t m_LastSubmittedID = 0;
-        uint64_t m_LastFinishedID = 0;
+        std::atomic<uint64_t> m_LastFlushedID = 0; // read by the other queues' flush()
+        std::atomic<uint64_t> m_LastFinishedID = 0; // updated by the background garbage collection too
+
+        // One VkSubmitInfo worth of queued command buffers. Consecutive submissions without waits or extra signals
+        // are merged into one entry, which signals the tracking semaphore with the last submission ID only.
+        struct PendingSubmission
+        {
+            std::vector<vk::CommandBuffer> commandBuffers;
+            std::vector<uint32_t> commandBufferDeviceMasks; // only used with device groups
+            std::vector<vk::Semaphore> waitSemaphores;
+            std::vector<uint64_t> waitSemaphoreValues;
+            std::vector<Queue*> waitSemaphoreQueues;
+            std::vector<vk::Semaphore> signalSemaphores;
+            std::vector<uint64_t> signalSemaphoreValues;
+            uint64_t submissionID = 0;
+        };
 
-        // tracks the list of command buffers in flight on this queue
-        std::list<TrackedCommandBufferPtr> m_CommandBuffersInFlight;
-        std::list<TrackedCommandBufferPtr> m_CommandBuffersPool;
+        // Entries before m_FirstPendingSubmission are flushed already, entries past m_NumPendingSubmissions
+        // are kept to reuse their vectors
+        std::vector<PendingSubmission> m_PendingSubmissions;
+        size_t m_FirstPendingSubmission = 0;
+        size_t m_NumPendingSubmissions = 0;
+        void submitPendingEntries(size_t first, size_t count);
+        std::mutex m_SubmitMutex; // protects the pending submissions and m_CommandBuffersInFlight, see flush() and retireCommandBuffers()
+
+        // tracks the list of command buffers in flight on this queue, in submission order.
+        // Neither container allocates once it has grown to the peak number of command buffers in flight.
+        RecyclingQueue<TrackedCommandBufferPtr> m_CommandBuffersInFlight;
+        std::vector<TrackedCommandBufferPtr> m_CommandBuffersPool;
     };
 
+    struct MemoryBlock;
+
     class MemoryResource
     {
     public:
         bool managed = true;
         vk::DeviceMemory memory;
+
+        // Offset and size of this resource's range within 'memory'.
+        // For dedicated allocations, the offset is always 0.
+        vk::DeviceSize memoryOffset = 0;
+        vk::DeviceSize memorySize = 0;
+
+        // The block that 'memory' was sub-allocated from, or nullptr for dedicated allocations
+        MemoryBlock* memoryBlock = nullptr;
+    };
+
+    // A large vk::DeviceMemory allocation that is shared by multiple resources
+    struct MemoryBlock
+    {
+        vk::DeviceMemory memory;
+        void* mappedMemory = nullptr; // persistently mapped for host-visible memory types
+        uint32_t poolIndex = 0;
+        RangeAllocator ranges;
     };
 
     class VulkanAllocator
@@ -294,23 +428,51 @@ namespace nvrhi::vulkan
             : m_Context(context)
         { }
 
-        vk::Result allocateBufferMemory(Buffer* buffer, bool enableBufferAddress = false) const;
-        void freeBufferMemory(Buffer* buffer) const;
+        ~VulkanAllocator();
+
+        vk::Result allocateBufferMemory(Buffer* buffer, bool enableBufferAddress = false);
+        void freeBufferMemory(Buffer* buffer);
 
-        vk::Result allocateTextureMemory(Texture* texture) const;
-        void freeTextureMemory(Texture* texture) const;
+        vk::Result allocateTextureMemory(Texture* texture);
+        void freeTextureMemory(Texture* texture);
 
+        // Creates a dedicated vk::DeviceMemory object for the resource
         vk::Result allocateMemory(MemoryResource* res,
             vk::MemoryRequirements memRequirements,
             vk::MemoryPropertyFlags memPropertyFlags,
             bool enableDeviceAddress = false,
             bool enableExportMemory = false,
             VkImage dedicatedImage = nullptr,
-            VkBuffer dedicatedBuffer = nullptr) const;
-        void freeMemory(MemoryResource* res) const;
+            VkBuffer dedicatedBuffer = nullptr,
+            uint32_t deviceMask = 0) const;
+        void freeMemory(MemoryResource* res);
+
+        // Maps a range of the resource's memory. Sub-allocated resources share persistently mapped blocks,
+        // so these functions must be used instead of calling vkMapMemory on MemoryResource::memory directly.
+        void* mapMemory(MemoryResource* res, vk::DeviceSize offset, vk::DeviceSize size) const;
+        void unmapMemory(MemoryResource* res) const;
 
     private:
+        // Resources at least this large always get their own vk::DeviceMemory
+        static constexpr vk::DeviceSize c_MaxSubAllocationSize = 32 * 1024 * 1024;
+        static constexpr vk::DeviceSize c_DefaultBlockSize = 256 * 1024 * 1024;
+
+        struct MemoryPool
+        {
+            uint32_t memoryTypeIndex = 0;
+            bool linear = false; // buffers and optimal-tiling images never share a block, which satisfies bufferImageGranularity
+            bool enableDeviceAddress = false;
+            std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        };
+
         const VulkanContext& m_Context;
+        std::vector<MemoryPool> m_Pools;
+        std::mutex m_Mutex;
+
+        bool findMemoryType(uint32_t memoryTypeBits, vk::MemoryPropertyFlags memPropertyFlags, uint32_t& outMemTypeIndex, vk::MemoryPropertyFlags* outTypeFlags = nullptr) const;
+        vk::Result subAllocateMemory(MemoryResource* res, vk::MemoryRequirements memRequirements, vk::MemoryPropertyFlags memPropertyFlags,
+            bool linear, bool enableDeviceAddress);
+        void releaseSubAllocation(MemoryResource* res);
     };
 
     class Heap : public MemoryResource, public RefCounter<IHeap>
@@ -398,23 +560,38 @@ namespace nvrhi::vulkan
 
         HeapHandle heap;
 
+        // Heaps that have been mapped to the tiles of a tiled texture, kept alive while the texture exists
+        std::vector<HeapHandle> tileMappingHeaps;
+
         void* sharedHandle = nullptr;
 
         // contains subresource views for this texture
         // note that we only create the views that the app uses, and that multiple views may map to the same subresources
-        std::unordered_map<SubresourceViewKey, TextureSubresourceView, Texture::Hash> subresourceViews;
+        typedef std::unordered_map<SubresourceViewKey, TextureSubresourceView, Texture::Hash> SubresourceViewMap;
+        SubresourceViewMap subresourceViews;
 
         Texture(const VulkanContext& context, VulkanAllocator& allocator)
             : TextureStateExtension(desc)
             , m_Context(context)
             , m_Allocator(allocator)
-        { }
+        {
+            for (auto& slot : m_ViewTable)
+                slot.store(nullptr, std::memory_order_relaxed);
+        }
+
+        // Returns the view type that a binding with the given format needs, i.e. which aspect of a depth-stencil texture it reads
+        static TextureSubresourceViewType getTextureViewType(Format bindingFormat, Format textureFormat);
 
         // returns a subresource view for an arbitrary range of mip levels and array layers.
         // 'viewtype' only matters when asking for a depthstencil view; in situations where only depth or stencil can be bound
         // (such as an SRV with ImageLayout::eShaderReadOnlyOptimal), but not both, then this specifies which of the two aspect bits is to be set.
+        // Views that already exist are usually found without locking, see m_ViewTable.
         TextureSubresourceView& getSubresourceView(const TextureSubresourceSet& subresources, TextureDimension dimension,
             Format format, vk::ImageUsageFlags usage, TextureSubresourceViewType viewtype = TextureSubresourceViewType::AllAspects);
+
+        // Creates the views that binding sets use most often: the SRV of the whole texture and the UAV of its first mip level.
+        // Must be called after the image memory is bound.
+        void createDefaultViews();
         
         uint32_t getNumSubresources() const;
         uint32_t getSubresourceIndex(uint32_t mipLevel, uint32_t arrayLayer) const;
@@ -428,6 +605,15 @@ namespace nvrhi::vulkan
         const VulkanContext& m_Context;
         VulkanAllocator& m_Allocator;
         std::mutex m_Mutex;
+
+        // Open-addressing table that points at the entries of subresourceViews. Slots are only written under m_Mutex,
+        // once, after the view is created, and never change afterwards, so readers can probe it without locking.
+        // When the table is full, the remaining views are only found in the map.
+        static constexpr uint32_t c_ViewTableSize = 16;
+        std::array<std::atomic<SubresourceViewMap::value_type*>, c_ViewTableSize> m_ViewTable;
+
+        TextureSubresourceView* findViewLockFree(const SubresourceViewKey& key, size_t hash) const;
+        void publishView(SubresourceViewMap::value_type* entry, size_t hash);
     };
 
     /* ----------------------------------------------------------------------------
@@ -474,6 +660,14 @@ namespace nvrhi::vulkan
     avoid using volatile CBs in that fashion and switch to push constants or maybe
     structured buffers.
 
+    Buffers created with maxVersions = 0 have no storage of their own. Their versions
+    are suballocated from a ring shared by the whole device, see Device::getVolatileBufferRing.
+    The ring is itself a volatile buffer whose versions are fixed-size chunks, and each
+    command list fills the chunk it has acquired linearly before acquiring the next one.
+    The chunks are tracked exactly like the versions described below, so the ring
+    has the same properties when command lists are recorded and submitted out of order.
+    The versions of such adaptive buffers are addressed with VolatileBufferState::ringOffset.
+
     For each version of a buffer, a tracking object is stored in the Buffer::versionTracking
     array. The object is just a 64-bit word, which contains a bitfield: 
 
@@ -509,6 +703,8 @@ namespace nvrhi::vulkan
         int minVersion = 0;
         int maxVersion = 0;
         bool initialized = false;
+        // Offset of the latest version in the shared ring, for buffers created with maxVersions = 0
+        uint64_t ringOffset = 0;
     };
     
     // A copyable version of std::atomic to be used in an std::vector
@@ -542,12 +738,17 @@ namespace nvrhi::vulkan
         HeapHandle heap;
         
         std::unordered_map<uint64_t, vk::BufferView> viewCache;
+        std::mutex viewCacheMutex;
 
         std::vector<BufferVersionItem> versionTracking;
         void* mappedMemory = nullptr;
         void* sharedHandle = nullptr;
         uint32_t versionSearchStart = 0;
 
+        // For volatile buffers with maxVersions = 0: the shared ring that stores the versions, see Device::getVolatileBufferRing.
+        // The 'buffer' member refers to the ring's buffer and is not owned.
+        RefCountPtr<Buffer> volatileRing;
+
         // For staging buffers only
         CommandQueue lastUseQueue = CommandQueue::Graphics;
         uint64_t lastUseCommandListID = 0;
@@ -689,6 +890,7 @@ namespace nvrhi::vulkan
 
         bool started = false;
         bool resolved = false;
+        bool hostReset = false; // reset on the host and not begun since
         float time = 0.f;
 
         explicit TimerQuery(utils::BitSetAllocator& allocator)
@@ -701,6 +903,73 @@ namespace nvrhi::vulkan
         utils::BitSetAllocator& m_QueryAllocator;
     };
 
+    class GpuProfiler : public GpuProfilerBase
+    {
+    public:
+        vk::QueryPool queryPool;
+
+        GpuProfiler(const VulkanContext& context, IDevice* device, const GpuProfilerDesc& desc)
+            : GpuProfilerBase(device, desc)
+            , m_Context(context)
+        { }
+
+        ~GpuProfiler() override;
+
+    protected:
+        void recordTimestamp(nvrhi::ICommandList* commandList, uint32_t queryIndex) override;
+        void recordResolve(nvrhi::ICommandList* commandList, uint32_t firstQuery, uint32_t numQueries, IBuffer* buffer, uint64_t bufferOffset) override;
+        double getTimestampPeriod() override;
+        bool getClockCalibration(uint64_t& outGpuTimestamp, double& outCpuSeconds) override;
+
+    private:
+        const VulkanContext& m_Context;
+    };
+
+    class OcclusionQuery : public RefCounter<IOcclusionQuery>
+    {
+    public:
+        OcclusionQueryDesc desc;
+        int queryIndex = -1;
+
+        bool started = false;
+        bool resolved = false;
+        bool hostReset = false; // reset on the host and not begun since
+        bool beganInRenderPass = false;
+        uint64_t result = 0;
+
+        explicit OcclusionQuery(utils::BitSetAllocator& allocator)
+            : m_QueryAllocator(allocator)
+        { }
+
+        ~OcclusionQuery() override;
+
+        const OcclusionQueryDesc& getDesc() const override { return desc; }
+
+    private:
+        utils::BitSetAllocator& m_QueryAllocator;
+    };
+
+    class PipelineStatisticsQuery : public RefCounter<IPipelineStatisticsQuery>
+    {
+    public:
+        int queryIndex = -1;
+
+        bool started = false;
+        bool resolved = false;
+        bool hostReset = false; // reset on the host and not begun since
+        bool beganInRenderPass = false;
+        PipelineStatistics result;
+
+        explicit PipelineStatisticsQuery(utils::BitSetAllocator& allocator)
+            : m_QueryAllocator(allocator)
+        { }
+
+        ~PipelineStatisticsQuery() override;
+
+    private:
+        utils::BitSetAllocator& m_QueryAllocator;
+    };
+
     class Framebuffer : public RefCounter<IFramebuffer>
     {
     public:
@@ -710,6 +979,23 @@ namespace nvrhi::vulkan
         vk::RenderPass renderPass = vk::RenderPass();
         vk::Framebuffer framebuffer = vk::Framebuffer();
 
+        // Set when the framebuffer is rendered with VK_KHR_dynamic_rendering, see DeviceDesc::dynamicRenderingSupported.
+        // Such framebuffers have no render pass and framebuffer objects, only the attachment views below.
+        bool dynamicRendering = false;
+        static_vector<vk::ImageView, c_MaxRenderTargets> colorViews;
+        vk::ImageView depthView;
+        vk::ImageLayout depthLayout = vk::ImageLayout::eUndefined;
+        bool depthHasStencil = false;
+        vk::ImageView shadingRateView;
+        vk::Extent2D shadingRateTexelSize;
+        uint32_t numArraySlices = 1;
+
+        // Attachment formats for VkPipelineRenderingCreateInfo and VkCommandBufferInheritanceRenderingInfo,
+        // derived from framebufferInfo only, so that pipelines work with any framebuffer with the same formats
+        static_vector<vk::Format, c_MaxRenderTargets> colorFormats;
+        vk::Format depthFormat = vk::Format::eUndefined;
+        vk::Format stencilFormat = vk::Format::eUndefined;
+
         std::vector<ResourceHandle> resources;
 
         bool managed = true;
@@ -727,12 +1013,71 @@ namespace nvrhi::vulkan
         const VulkanContext& m_Context;
     };
 
+    class DescriptorBufferRange;
+
+    // The buffer that holds the binding sets and descriptor tables with EXT_descriptor_buffer.
+    // It is persistently mapped, and the descriptors are written into it directly with vkGetDescriptorEXT.
+    class DescriptorBuffer : public MemoryResource
+    {
+    public:
+        vk::Buffer buffer;
+        vk::DeviceAddress deviceAddress = 0;
+        uint8_t* mappedMemory = nullptr;
+
+        DescriptorBuffer(const VulkanContext& context, VulkanAllocator& allocator)
+            : m_Context(context)
+            , m_Allocator(allocator)
+        { }
+
+        ~DescriptorBuffer();
+
+        vk::Result create(vk::DeviceSize size);
+
+        // Returns nullptr when there is no free range of that size
+        RefCountPtr<DescriptorBufferRange> allocate(vk::DeviceSize size);
+        void release(vk::DeviceSize offset, vk::DeviceSize size);
+
+    private:
+        const VulkanContext& m_Context;
+        VulkanAllocator& m_Allocator;
+        RangeAllocator m_Ranges;
+        std::mutex m_Mutex;
+    };
+
+    // A range of the descriptor buffer that is returned to it when the last reference is released
+    class DescriptorBufferRange : public RefCounter<IResource>
+    {
+    public:
+        DescriptorBuffer& descriptorBuffer;
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+
+        DescriptorBufferRange(DescriptorBuffer& _descriptorBuffer, vk::DeviceSize _offset, vk::DeviceSize _size)
+            : descriptorBuffer(_descriptorBuffer)
+            , offset(_offset)
+            , size(_size)
+        { }
+
+        ~DescriptorBufferRange() override { descriptorBuffer.release(offset, size); }
+
+        [[nodiscard]] uint8_t* getData() const { return descriptorBuffer.mappedMemory + offset; }
+    };
+
+    // Location of a volatile constant buffer descriptor in a set in the descriptor buffer
+    struct VolatileBufferDescriptor
+    {
+        vk::DeviceSize descriptorOffset = 0;
+        vk::DeviceSize rangeOffset = 0;
+        vk::DeviceSize rangeSize = 0;
+    };
+
     class BindingLayout : public RefCounter<IBindingLayout>
     {
     public:
         BindingLayoutDesc desc;
         BindlessLayoutDesc bindlessDesc;
         bool isBindless;
+        bool pushDescriptors; // the layout was created with ePushDescriptorKHR, no sets are allocated for it
 
         std::vector<vk::DescriptorSetLayoutBinding> vulkanLayoutBindings;
 
@@ -741,6 +1086,15 @@ namespace nvrhi::vulkan
         // descriptor pool size information per binding set
         std::vector<vk::DescriptorPoolSize> descriptorPoolSizeInfo;
 
+        // With EXT_descriptor_buffer: the size of one set in the descriptor buffer,
+        // and the offset of each element of vulkanLayoutBindings within the set
+        vk::DeviceSize descriptorBufferSize = 0;
+        std::vector<vk::DeviceSize> descriptorBufferBindingOffsets;
+
+        // With EXT_descriptor_buffer: the size of the range that holds the first 'capacity' elements
+        // of every binding of a bindless layout
+        [[nodiscard]] vk::DeviceSize getDescriptorTableSize(uint32_t capacity) const;
+
         BindingLayout(const VulkanContext& context, const BindingLayoutDesc& desc);
         BindingLayout(const VulkanContext& context, const BindlessLayoutDesc& desc);
         ~BindingLayout() override;
@@ -751,8 +1105,20 @@ namespace nvrhi::vulkan
         // generate the descriptor set layout
         vk::Result bake();
 
+        // Descriptor sets for this layout are allocated from a list of shared pools that grows as needed.
+        // Released sets are kept in a free list and reused by later allocations, so pools are never destroyed
+        // until the layout is. Callers must only release a set when the GPU no longer uses it.
+        vk::Result allocateDescriptorSet(vk::DescriptorSet& outSet, vk::DescriptorPool& outPool);
+        void releaseDescriptorSet(vk::DescriptorSet set, vk::DescriptorPool pool);
+
     private:
         const VulkanContext& m_Context;
+
+        std::vector<vk::DescriptorPool> m_DescriptorPools;
+        std::vector<std::pair<vk::DescriptorSet, vk::DescriptorPool>> m_FreeDescriptorSets;
+        uint32_t m_FreeSetsInCurrentPool = 0;
+        uint32_t m_SetsPerPool = 0;
+        std::mutex m_DescriptorSetMutex;
     };
 
     // contains a vk::DescriptorSet
@@ -762,20 +1128,34 @@ namespace nvrhi::vulkan
         BindingSetDesc desc;
         BindingLayoutHandle layout;
 
-        // TODO: move pool to the context instead
+        // the pool is shared with other binding sets that use the same layout
         vk::DescriptorPool descriptorPool;
         vk::DescriptorSet descriptorSet;
 
+        // With EXT_descriptor_buffer, the descriptors are stored at this offset in the descriptor buffer instead of a set.
+        // Transient sets are stored in a chunk of the command list, which is referenced through 'resources'.
+        vk::DeviceSize descriptorBufferOffset = 0;
+        RefCountPtr<DescriptorBufferRange> descriptorBufferRange;
+
         std::vector<ResourceHandle> resources;
         static_vector<Buffer*, c_MaxVolatileConstantBuffersPerLayout> volatileConstantBuffers;
+        // With EXT_descriptor_buffer, the descriptors of volatileConstantBuffers are rewritten with the current version
+        // into a transient copy of the set whenever it is bound, see CommandList::bindBindingSets
+        static_vector<VolatileBufferDescriptor, c_MaxVolatileConstantBuffersPerLayout> volatileBufferDescriptors;
 
         std::vector<uint16_t> bindingsThatNeedTransitions;
 
+        // created with ICommandList::createTransientBindingSet, the set is owned by a TransientDescriptorPool
+        bool transient = false;
+
         explicit BindingSet(const VulkanContext& context)
             : m_Context(context)
         { }
 
         ~BindingSet() override;
+
+        // fills the allocated descriptor set or descriptor buffer range with the resources from desc
+        void writeDescriptors();
         const BindingSetDesc* getDesc() const override { return &desc; }
         IBindingLayout* getLayout() const override { return layout; }
         Object getNativeObject(ObjectType objectType) override;
@@ -784,15 +1164,65 @@ namespace nvrhi::vulkan
         const VulkanContext& m_Context;
     };
 
+    // Descriptor writes generated from a BindingSetDesc, shared by binding sets and push descriptors.
+    // The writes point into the info arrays, so the structure must not be copied.
+    struct DescriptorWriteData
+    {
+        static_vector<vk::DescriptorImageInfo, c_MaxBindingsPerLayout> imageInfo;
+        static_vector<vk::DescriptorBufferInfo, c_MaxBindingsPerLayout> bufferInfo;
+        static_vector<vk::WriteDescriptorSetAccelerationStructureKHR, c_MaxBindingsPerLayout> accelStructInfo;
+        static_vector<vk::WriteDescriptorSet, c_MaxBindingsPerLayout> writes;
+        // Index of the layout binding for each write, and the buffer ranges which descriptor buffers use instead of views
+        static_vector<uint16_t, c_MaxBindingsPerLayout> writeLayoutBindings;
+        static_vector<vk::DescriptorAddressInfoEXT, c_MaxBindingsPerLayout> addressInfo;
+
+        std::vector<uint16_t> bindingsThatNeedTransitions;
+        static_vector<Buffer*, c_MaxVolatileConstantBuffersPerLayout> volatileConstantBuffers;
+        static_vector<VolatileBufferDescriptor, c_MaxVolatileConstantBuffersPerLayout> volatileBufferDescriptors;
+    };
+
+    // Writes the descriptors from generateDescriptorWrites into the memory of a set in the descriptor buffer
+    void writeDescriptorBufferSet(const VulkanContext& context, const BindingLayout* layout, const DescriptorWriteData& writeData, uint8_t* setData);
+
+    void generateDescriptorWrites(const VulkanContext& context, const BindingSetDesc& desc, const BindingLayout* layout,
+        vk::DescriptorSet descriptorSet, DescriptorWriteData& outData);
+
+    // Descriptor pool for transient binding sets. The sets are never freed individually: each of them keeps
+    // a reference to its pool, which is destroyed when the command buffers using those sets are retired.
+    class TransientDescriptorPool : public RefCounter<IResource>
+    {
+    public:
+        vk::DescriptorPool pool;
+
+        explicit TransientDescriptorPool(const VulkanContext& context)
+            : m_Context(context)
+        { }
+
+        ~TransientDescriptorPool() override;
+
+    private:
+        const VulkanContext& m_Context;
+    };
+
     class DescriptorTable : public RefCounter<IDescriptorTable>
     {
     public:
         BindingLayoutHandle layout;
         uint32_t capacity = 0;
 
+        // the pool is shared with other descriptor tables that use the same layout
         vk::DescriptorPool descriptorPool;
         vk::DescriptorSet descriptorSet;
 
+        // With EXT_descriptor_buffer, the table is a range of the descriptor buffer that holds 'descriptorBufferCapacity'
+        // elements of every binding. It's sized for the layout's maximum capacity with reserveMaxCapacity,
+        // and reallocated when the table grows otherwise.
+        RefCountPtr<DescriptorBufferRange> descriptorBufferRange;
+        uint32_t descriptorBufferCapacity = 0;
+
+        // serializes the updates of descriptorSet, see Device::writeDescriptorTable
+        std::mutex mutex;
+
         explicit DescriptorTable(const VulkanContext& context)
             : m_Context(context)
         { }
@@ -835,6 +1265,23 @@ namespace nvrhi::vulkan
         const VulkanContext& m_Context;
     };
 
+    class GraphicsStateBlock : public nvrhi::GraphicsStateBlock
+    {
+    public:
+        // Native handles and viewports, resolved when the block is created
+        vk::Buffer vertexBuffers[c_MaxVertexAttributes];
+        vk::DeviceSize vertexBufferOffsets[c_MaxVertexAttributes] = {};
+        uint32_t maxVertexBufferSlot = 0;
+        vk::Buffer indexBuffer;
+        vk::IndexType indexType = vk::IndexType::eUint32;
+        static_vector<vk::Viewport, c_MaxViewports> viewports;
+        static_vector<vk::Rect2D, c_MaxViewports> scissorRects;
+
+        explicit GraphicsStateBlock(const GraphicsState& _state)
+            : nvrhi::GraphicsStateBlock(_state)
+        { }
+    };
+
     class ComputePipeline : public RefCounter<IComputePipeline>
     {
     public:
@@ -893,6 +1340,7 @@ namespace nvrhi::vulkan
 
         std::unordered_map<std::string, uint32_t> shaderGroups; // name -> index
         std::vector<uint8_t> shaderGroupHandles;
+        uint32_t numShaderGroups = 0; // including the groups linked from libraries
 
         explicit RayTracingPipeline(const VulkanContext& context)
             : m_Context(context)
@@ -919,8 +1367,17 @@ namespace nvrhi::vulkan
         std::vector<uint32_t> callableShaders;
         std::vector<uint32_t> hitGroups;
 
+        // Incremented when the table layout changes, i.e. when records are added or cleared
         uint32_t version = 0;
 
+        // Device-local copy of the table, rewritten in full when 'version' changes and patched
+        // record by record otherwise. See CommandList::commitShaderTable.
+        BufferHandle buffer;
+        uint64_t bufferOffset = 0;
+        uint32_t bufferVersion = 0;
+        std::vector<uint32_t> dirtyRecords;
+        std::mutex mutex;
+
         ShaderTable(const VulkanContext& context, RayTracingPipeline* _pipeline)
             : pipeline(_pipeline)
             , m_Context(context)
@@ -930,16 +1387,23 @@ namespace nvrhi::vulkan
         int addMissShader(const char* exportName, IBindingSet* bindings = nullptr) override;
         int addHitGroup(const char* exportName, IBindingSet* bindings = nullptr) override;
         int addCallableShader(const char* exportName, IBindingSet* bindings = nullptr) override;
+        bool setMissShader(int index, const char* exportName, IBindingSet* bindings = nullptr) override;
+        bool setHitGroup(int index, const char* exportName, IBindingSet* bindings = nullptr) override;
+        bool setCallableShader(int index, const char* exportName, IBindingSet* bindings = nullptr) override;
         void clearMissShaders() override;
         void clearHitShaders() override;
         void clearCallableShaders() override;
         rt::IPipeline* getPipeline() override { return pipeline; }
         uint32_t getNumEntries() const;
 
+        // Returns the shader group index stored in a record, counting records in SBT order, or -1 if it's not set
+        int getShaderGroupForRecord(uint32_t recordIndex) const;
+
     private:
         const VulkanContext& m_Context;
 
         bool verifyShaderGroupExists(const char* exportName, int shaderGroupIndex) const;
+        bool setRecord(std::vector<uint32_t>& records, uint32_t firstRecord, int index, const char* exportName, IBindingSet* bindings);
     };
 
     struct BufferChunk
@@ -949,6 +1413,7 @@ namespace nvrhi::vulkan
         uint64_t bufferSize = 0;
         uint64_t writePointer = 0;
         void* mappedMemory = nullptr;
+        TrackedAllocation memoryTracking;
 
         static constexpr uint64_t c_sizeAlignment = 4096; // GPU page size
     };
@@ -956,18 +1421,29 @@ namespace nvrhi::vulkan
     class UploadManager
     {
     public:
-        UploadManager(Device* pParent, uint64_t defaultChunkSize, uint64_t memoryLimit, bool isScratchBuffer)
+        UploadManager(Device* pParent, uint64_t defaultChunkSize, uint64_t memoryLimit, bool isScratchBuffer, uint64_t ringSize = 0)
             : m_Device(pParent)
             , m_DefaultChunkSize(defaultChunkSize)
             , m_MemoryLimit(memoryLimit)
             , m_IsScratchBuffer(isScratchBuffer)
-        { }
+        {
+            if (ringSize > 0 && !isScratchBuffer)
+                m_Ring = std::make_unique<UploadRing>(align(ringSize, BufferChunk::c_sizeAlignment));
+        }
 
         std::shared_ptr<BufferChunk> CreateChunk(uint64_t size);
 
         bool suballocateBuffer(uint64_t size, Buffer** pBuffer, uint64_t* pOffset, void** pCpuVA, uint64_t currentVersion, uint32_t alignment = 256);
         void submitChunks(uint64_t currentVersion, uint64_t submittedVersion);
 
+        // Releases the ring space of a recording that was closed but never executed, see UploadRing::releaseUnsubmitted
+        void releaseUnsubmitted() { if (m_Ring) m_Ring->releaseUnsubmitted(); }
+
+        [[nodiscard]] UploadStatistics getStatistics() const;
+
+        // Total size of the suballocations made over the lifetime of the manager
+        [[nodiscard]] uint64_t getBytesRequested() const { return m_BytesRequested; }
+
     private:
         Device* m_Device;
         uint64_t m_DefaultChunkSize = 0;
@@ -977,6 +1453,15 @@ namespace nvrhi::vulkan
 
         std::list<std::shared_ptr<BufferChunk>> m_ChunkPool;
         std::shared_ptr<BufferChunk> m_CurrentChunk;
+
+        // Ring mode, see CommandListParameters::uploadRingSize
+        std::unique_ptr<UploadRing> m_Ring;
+        std::shared_ptr<BufferChunk> m_RingChunk;
+        uint64_t m_HighWaterMark = 0;
+        uint64_t m_NumStalls = 0;
+        uint64_t m_BytesRequested = 0;
+
+        bool suballocateFromRing(uint64_t size, Buffer** pBuffer, uint64_t* pOffset, void** pCpuVA, uint64_t currentVersion, uint32_t alignment);
     };
 
     class AccelStruct : public RefCounter<rt::IAccelStruct>
@@ -992,6 +1477,10 @@ namespace nvrhi::vulkan
         size_t rtxmuId = ~0ull;
         vk::Buffer rtxmuBuffer;
 
+        // Query for the compacted size of a BLAS with the AllowCompaction flag, when not using RTXMU
+        vk::QueryPool compactedSizeQueryPool;
+        TrackedAllocation compactionSavings;
+        uint64_t uncompactedSize = 0; // storage size before compaction, restored by a full rebuild
 
         explicit AccelStruct(const VulkanContext& context)
             : m_Context(context)
@@ -1041,7 +1530,15 @@ namespace nvrhi::vulkan
         ~Device() override;
 
         Queue* getQueue(CommandQueue queue) const { return m_Queues[int(queue)].get(); }
+        const VulkanContext& getContext() const { return m_Context; }
         vk::QueryPool getTimerQueryPool() const { return m_TimerQueryPool; }
+        vk::QueryPool getOcclusionQueryPool() const { return m_OcclusionQueryPool; }
+        vk::QueryPool getPipelineStatisticsQueryPool() const { return m_PipelineStatisticsQueryPool; }
+        [[nodiscard]] bool isOcclusionQueryPreciseSupported() const { return m_OcclusionQueryPreciseSupported; }
+        [[nodiscard]] bool isHostQueryResetSupported() const { return m_HostQueryResetSupported; }
+
+        // Creates the data buffer and the AS object of the given size for 'as', using its desc
+        void createAccelStructStorage(AccelStruct* as, uint64_t byteSize);
 
         // IResource implementation
 
@@ -1055,6 +1552,10 @@ namespace nvrhi::vulkan
         TextureHandle createTexture(const TextureDesc& d) override;
         MemoryRequirements getTextureMemoryRequirements(ITexture* texture) override;
         bool bindTextureMemory(ITexture* texture, IHeap* heap, uint64_t offset) override;
+        void getTextureTiling(ITexture* texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+            uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings) override;
+        void updateTextureTileMappings(ITexture* texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings,
+            CommandQueue executionQueue = CommandQueue::Graphics) override;
 
         TextureHandle createHandleForNativeTexture(ObjectType objectType, Object texture, const TextureDesc& desc) override;
 
@@ -1065,6 +1566,7 @@ namespace nvrhi::vulkan
         BufferHandle createBuffer(const BufferDesc& d) override;
         void *mapBuffer(IBuffer* b, CpuAccessMode mapFlags) override;
         void unmapBuffer(IBuffer* b) override;
+        void *tryMapBuffer(IBuffer* b, CpuAccessMode mapFlags, SubmissionId* outLastUse) override;
         MemoryRequirements getBufferMemoryRequirements(IBuffer* buffer) override;
         bool bindBufferMemory(IBuffer* buffer, IHeap* heap, uint64_t offset) override;
 
@@ -1090,27 +1592,48 @@ namespace nvrhi::vulkan
         bool pollTimerQuery(ITimerQuery* query) override;
         float getTimerQueryTime(ITimerQuery* query) override;
         void resetTimerQuery(ITimerQuery* query) override;
+        GpuProfilerHandle createGpuProfiler(const GpuProfilerDesc& desc) override;
+
+        OcclusionQueryHandle createOcclusionQuery(const OcclusionQueryDesc& desc) override;
+        bool pollOcclusionQuery(IOcclusionQuery* query) override;
+        uint64_t getOcclusionQueryResult(IOcclusionQuery* query) override;
+        void resetOcclusionQuery(IOcclusionQuery* query) override;
+
+        PipelineStatisticsQueryHandle createPipelineStatisticsQuery() override;
+        bool pollPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        PipelineStatistics getPipelineStatistics(IPipelineStatisticsQuery* query) override;
+        void resetPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
 
         GraphicsAPI getGraphicsAPI() override;
 
         FramebufferHandle createFramebuffer(const FramebufferDesc& desc) override;
 
         GraphicsPipelineHandle createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb) override;
+        GraphicsStateBlockHandle createGraphicsStateBlock(const GraphicsState& state) override;
 
         ComputePipelineHandle createComputePipeline(const ComputePipelineDesc& desc) override;
 
         MeshletPipelineHandle createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb) override;
 
         rt::PipelineHandle createRayTracingPipeline(const rt::PipelineDesc& desc) override;
+        CommandSignatureHandle createCommandSignature(const CommandSignatureDesc& desc) override;
+        bool exportPipelineCache(std::vector<uint8_t>& outData) override;
+        bool importPipelineCache(const void* data, size_t dataSize) override;
+        void setTaskScheduler(ITaskScheduler* scheduler) override { m_TaskScheduler = scheduler; }
+        ITaskScheduler* getTaskScheduler() override { return m_TaskScheduler; }
+        void setTraceRecorder(ITraceRecorder* recorder) override { m_Context.traceRecorder.set(recorder); }
 
         BindingLayoutHandle createBindingLayout(const BindingLayoutDesc& desc) override;
         BindingLayoutHandle createBindlessLayout(const BindlessLayoutDesc& desc) override;
+        // Vulkan allows only one push descriptor set layout per pipeline layout
+        bool validatePushDescriptorLayouts(const BindingLayoutVector& layouts, const char* operation) const;
 
         BindingSetHandle createBindingSet(const BindingSetDesc& desc, IBindingLayout* layout) override;
         DescriptorTableHandle createDescriptorTable(IBindingLayout* layout) override;
 
         void resizeDescriptorTable(IDescriptorTable* descriptorTable, uint32_t newSize, bool keepContents = true) override;
         bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem& item) override;
+        bool writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem* items, size_t numItems) override;
         
         rt::OpacityMicromapHandle createOpacityMicromap(const rt::OpacityMicromapDesc& desc) override;
         rt::AccelStructHandle createAccelStruct(const rt::AccelStructDesc& desc) override;
@@ -1121,7 +1644,16 @@ namespace nvrhi::vulkan
         uint64_t executeCommandLists(ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue = CommandQueue::Graphics) override;
         void queueWaitForCommandList(CommandQueue waitQueue, CommandQueue executionQueue, uint64_t instance) override;
         void waitForIdle() override;
+        void setDeferredSubmission(bool enable) override;
+        void flushSubmissions() override;
+        bool waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds) override;
         void runGarbageCollection() override;
+        bool runGarbageCollection(uint32_t maxMicroseconds) override;
+        MemoryStatistics getMemoryStatistics() override;
+        CommandListStatistics getCommandListStatistics(bool reset) override;
+        void setObjectCacheEnabled(bool enable) override { m_ObjectCache.setEnabled(enable); }
+        ObjectCacheStatistics getObjectCacheStatistics(bool reset) override { return m_ObjectCache.getStatistics(reset); }
+        void setMemoryBudgetCallback(IMemoryBudgetCallback* callback) override;
         bool queryFeatureSupport(Feature feature, void* pInfo = nullptr, size_t infoSize = 0) override;
         FormatSupport queryFormatSupport(Format format) override;
         Object getNativeQueue(ObjectType objectType, CommandQueue queue) override;
@@ -1138,16 +1670,70 @@ namespace nvrhi::vulkan
     private:
         VulkanContext m_Context;
         VulkanAllocator m_Allocator;
+        std::unique_ptr<DescriptorBuffer> m_DescriptorBuffer;
         
         vk::QueryPool m_TimerQueryPool = nullptr;
         utils::BitSetAllocator m_TimerQueryAllocator;
 
+        vk::QueryPool m_OcclusionQueryPool = nullptr;
+        utils::BitSetAllocator m_OcclusionQueryAllocator;
+        vk::QueryPool m_PipelineStatisticsQueryPool = nullptr;
+        utils::BitSetAllocator m_PipelineStatisticsQueryAllocator;
+        bool m_OcclusionQueryPreciseSupported = false;
+        bool m_PipelineStatisticsQuerySupported = false;
+        bool m_HostQueryResetSupported = false;
+        bool m_SparseResidencySupported = false;
+
+        // Budgets reported at the last check, used to detect changes for the callback
+        IMemoryBudgetCallback* m_MemoryBudgetCallback = nullptr;
+        std::vector<uint64_t> m_LastMemoryBudgets;
+
         std::mutex m_Mutex;
 
         // array of submission queues
         std::array<std::unique_ptr<Queue>, uint32_t(CommandQueue::Count)> m_Queues;
+        ITaskScheduler* m_TaskScheduler = nullptr;
+        bool m_DeferredSubmission = false;
+
+        // See DeviceDesc::enableAutomaticQueueSync
+        bool m_AutomaticQueueSync = false;
+        // Set when both the graphics and compute queues exist and ray tracing is supported:
+        // the acceleration structure storage is synchronized between the queues even without m_AutomaticQueueSync
+        bool m_AccelStructQueueSync = false;
+        std::mutex m_QueueSyncMutex;
+        QueueSynchronizer m_QueueSynchronizer;
+
+        // Sum of the statistics of the executed command lists, see IDevice::getCommandListStatistics
+        CommandListStatistics m_CommandListStatistics;
+        std::mutex m_CommandListStatisticsMutex;
+
+        // See IDevice::setObjectCacheEnabled
+        ObjectCache m_ObjectCache;
+
+        SamplerHandle createSamplerInternal(const SamplerDesc& desc);
+        GraphicsPipelineHandle createGraphicsPipelineInternal(const GraphicsPipelineDesc& desc, IFramebuffer* fb);
+        ComputePipelineHandle createComputePipelineInternal(const ComputePipelineDesc& desc);
+        MeshletPipelineHandle createMeshletPipelineInternal(const MeshletPipelineDesc& desc, IFramebuffer* fb);
+        BindingSetHandle createBindingSetInternal(const BindingSetDesc& desc, IBindingLayout* layout);
+
+        // Created last and destroyed first, see DeviceDesc::enableBackgroundGarbageCollection
+        std::unique_ptr<GarbageCollectionThread> m_GarbageCollectionThread;
+
+        bool retireCommandBuffers(std::chrono::steady_clock::time_point deadline);
+        void pollMemoryBudget();
         
         void *mapBuffer(IBuffer* b, CpuAccessMode flags, uint64_t offset, size_t size) const;
+
+        // Shared storage for the volatile buffers with maxVersions = 0, created on first use
+        RefCountPtr<Buffer> m_VolatileBufferRing;
+        uint64_t m_VolatileBufferRingSize = 0;
+        Buffer* getVolatileBufferRing();
+
+        // Creates a ray tracing pipeline through VK_KHR_deferred_host_operations, sharing the work with the task scheduler.
+        vk::Result createDeferredRayTracingPipeline(const vk::RayTracingPipelineCreateInfoKHR& pipelineInfo, vk::Pipeline& outPipeline);
+
+        // Gives the descriptor table a new range of the descriptor buffer for 'capacity' slots, see DescriptorTable
+        bool allocateDescriptorTableRange(DescriptorTable* descriptorTable, uint32_t capacity, bool keepContents);
     };
 
     class CommandList : public RefCounter<ICommandList>
@@ -1177,6 +1763,7 @@ namespace nvrhi::vulkan
         void copyTexture(IStagingTexture* dest, const TextureSlice& dstSlice, ITexture* src, const TextureSlice& srcSlice) override;
         void copyTexture(ITexture* dest, const TextureSlice& dstSlice, IStagingTexture* src, const TextureSlice& srcSlice) override;
         void writeTexture(ITexture* dest, uint32_t arraySlice, uint32_t mipLevel, const void* data, size_t rowPitch, size_t depthPitch) override;
+        void writeTextureRegions(ITexture* dest, const TextureUploadRegion* regions, size_t numRegions) override;
         void resolveTexture(ITexture* dest, const TextureSubresourceSet& dstSubresources, ITexture* src, const TextureSubresourceSet& srcSubresources) override;
 
         void writeBuffer(IBuffer* b, const void* data, size_t dataSize, uint64_t destOffsetBytes = 0) override;
@@ -1184,35 +1771,58 @@ namespace nvrhi::vulkan
         void copyBuffer(IBuffer* dest, uint64_t destOffsetBytes, IBuffer* src, uint64_t srcOffsetBytes, uint64_t dataSizeBytes) override;
 
         void setPushConstants(const void* data, size_t byteSize) override;
+        void setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings) override;
+        BindingSetHandle createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* layout) override;
 
         void setGraphicsState(const GraphicsState& state) override;
+        void setGraphicsStateBlock(IGraphicsStateBlock* block) override;
         void draw(const DrawArguments& args) override;
         void drawIndexed(const DrawArguments& args) override;
+        void drawMulti(const MultiDrawArguments& multiDraw) override;
+        void drawIndexedMulti(const MultiDrawArguments& multiDraw) override;
         void drawIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
         void drawIndexedIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
+        void executeBundles(ICommandList* const* bundles, size_t numBundles) override;
 
         void setComputeState(const ComputeState& state) override;
         void dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
         void dispatchIndirect(uint32_t offsetBytes)  override;
+        void executeIndirect(ICommandSignature* signature, uint32_t offsetBytes, uint32_t maxCommandCount, uint32_t countOffsetBytes) override;
 
         void setMeshletState(const MeshletState& state) override;
         void dispatchMesh(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) override;
+        void dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount) override;
+        void dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount) override;
 
         void setRayTracingState(const rt::State& state) override;
         void dispatchRays(const rt::DispatchRaysArguments& args) override;
         
         void buildOpacityMicromap(rt::IOpacityMicromap* omm, const rt::OpacityMicromapDesc& desc) override;
         void buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags) override;
+        void buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds) override;
         void compactBottomLevelAccelStructs() override;
         void buildTopLevelAccelStruct(rt::IAccelStruct* as, const rt::InstanceDesc* pInstances, size_t numInstances, rt::AccelStructBuildFlags buildFlags) override;
         void buildTopLevelAccelStructFromBuffer(rt::IAccelStruct* as, nvrhi::IBuffer* instanceBuffer, uint64_t instanceBufferOffset, size_t numInstances,
             rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None) override;
+        rt::InstanceDesc* beginTopLevelInstanceWrite(rt::IAccelStruct* as, size_t numInstances) override;
+        void commitTopLevelInstanceWrite(rt::IAccelStruct* as, rt::AccelStructBuildFlags buildFlags = rt::AccelStructBuildFlags::None,
+            rt::IAccelStruct* const* bottomLevelASes = nullptr, size_t numBottomLevelASes = 0) override;
 
         void beginTimerQuery(ITimerQuery* query) override;
         void endTimerQuery(ITimerQuery* query) override;
 
+        void beginOcclusionQuery(IOcclusionQuery* query) override;
+        void endOcclusionQuery(IOcclusionQuery* query) override;
+        void beginPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void endPipelineStatisticsQuery(IPipelineStatisticsQuery* query) override;
+        void resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* buffer, uint64_t offsetBytes) override;
+        void setPredication(IBuffer* buffer, uint64_t offsetBytes, PredicationOp op) override;
+
         void beginMarker(const char* name) override;
         void endMarker() override;
+        void setGpuProfiler(IGpuProfiler* profiler) override;
 
         void setEnableAutomaticBarriers(bool enable) override;
         void setResourceStatesForBindingSet(IBindingSet* bindingSet) override;
@@ -1225,20 +1835,29 @@ namespace nvrhi::vulkan
 
         void setTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override;
         void setBufferState(IBuffer* buffer, ResourceStates stateBits) override;
+        void beginTextureStateTransition(ITexture* texture, TextureSubresourceSet subresources, ResourceStates stateBits) override;
+        void beginBufferStateTransition(IBuffer* buffer, ResourceStates stateBits) override;
         void setAccelStructState(rt::IAccelStruct* _as, ResourceStates stateBits) override;
 
         void setPermanentTextureState(ITexture* texture, ResourceStates stateBits) override;
         void setPermanentBufferState(IBuffer* buffer, ResourceStates stateBits) override;
 
         void commitBarriers() override;
+        void aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter) override;
 
         ResourceStates getTextureSubresourceState(ITexture* texture, ArraySlice arraySlice, MipLevel mipLevel) override;
         ResourceStates getBufferState(IBuffer* buffer) override;
 
         IDevice* getDevice() override { return m_Device; }
         const CommandListParameters& getDesc() override { return m_CommandListParameters; }
+        UploadStatistics getUploadStatistics() override { return m_UploadManager->getStatistics(); }
+        CommandListStatistics getStatistics() override;
 
         TrackedCommandBufferPtr getCurrentCmdBuf() const { return m_CurrentCmdBuf; }
+        const CommandListResourceStateTracker& getStateTracker() const { return m_StateTracker; }
+
+        // Devices of the group that execute the command list, a zero nodeMask selects device 0
+        [[nodiscard]] uint32_t getDeviceMask() const { return m_CommandListParameters.nodeMask ? m_CommandListParameters.nodeMask : 1u; }
 
     private:
         Device* m_Device;
@@ -1255,6 +1874,12 @@ namespace nvrhi::vulkan
         vk::PipelineLayout m_CurrentPipelineLayout;
         vk::ShaderStageFlags m_CurrentPushConstantsVisibility;
         GraphicsState m_CurrentGraphicsState{};
+        // The block that m_CurrentGraphicsState was set from, or NULL if it was set through setGraphicsState
+        IGraphicsStateBlock* m_CurrentGraphicsStateBlock = nullptr;
+
+        // Scratch arrays for drawMulti and drawIndexedMulti with EXT_multi_draw
+        std::vector<vk::MultiDrawInfoEXT> m_MultiDrawInfos;
+        std::vector<vk::MultiDrawIndexedInfoEXT> m_MultiDrawIndexedInfos;
         ComputeState m_CurrentComputeState{};
         MeshletState m_CurrentMeshletState{};
         rt::State m_CurrentRayTracingState;
@@ -1266,37 +1891,151 @@ namespace nvrhi::vulkan
             vk::StridedDeviceAddressRegionKHR miss;
             vk::StridedDeviceAddressRegionKHR hitGroups;
             vk::StridedDeviceAddressRegionKHR callable;
+            Buffer* buffer = nullptr;
             uint32_t version = 0;
         } m_CurrentShaderTablePointers;
 
+        // Entries with initialized = false are not used in the current recording, see resetVolatileBufferStates
         std::unordered_map<Buffer*, VolatileBufferState> m_VolatileBufferStates;
+        std::vector<vk::MappedMemoryRange> m_VolatileFlushRanges; // kept to reuse the storage
+        // Space left in the chunk of the shared volatile buffer ring that this command list is currently filling
+        uint64_t m_VolatileRingBytesLeft = 0;
 
         std::unique_ptr<UploadManager> m_UploadManager;
         std::unique_ptr<UploadManager> m_ScratchManager;
+
+        // Bundle recording state: the resource states required by the draws, and the secondary command buffers
+        // that have been recorded. A secondary buffer is referenced by the primaries that executed it until they retire.
+        BundleResourceStates m_BundleStates;
+        std::list<TrackedCommandBufferPtr> m_BundleCommandBuffers;
         
-        void clearTexture(ITexture* texture, TextureSubresourceSet subresources, const vk::ClearColorValue& clearValue);
+        void openBundle();
+
+        // Split barriers whose Begin half has been recorded with vkCmdSetEvent2, waiting for the End half.
+        // Either imageBarrier or bufferBarrier is used, and the wait must repeat the same dependency as the set.
+        struct PendingSplitBarrier
+        {
+            const void* resource = nullptr;
+            MipLevel mipLevel = 0;
+            ArraySlice arraySlice = 0;
+            bool entireTexture = false;
+            vk::Event event;
+            vk::ImageMemoryBarrier2 imageBarrier;
+            vk::BufferMemoryBarrier2 bufferBarrier;
+        };
+        std::vector<PendingSplitBarrier> m_PendingSplitBarriers;
+
+        void beginSplitBarrier(PendingSplitBarrier& pending);
+        void endSplitBarrier(const void* resource, MipLevel mipLevel, ArraySlice arraySlice, bool entireTexture);
+
+        // Clears that are recorded outside of a render pass: the caller ends the render pass and resolves the subresources
+        void clearColorImage(Texture* texture, const TextureSubresourceSet& subresources, const vk::ClearColorValue& clearValue);
+        void clearDepthStencilImage(Texture* texture, const TextureSubresourceSet& subresources, vk::ImageAspectFlags aspects,
+            const vk::ClearDepthStencilValue& clearValue);
+
+        // Clears recorded with CommandListParameters::enableDeferredClears. While m_DeferredClears is not empty,
+        // no render pass is active: recording a clear ends it, and prepareRenderPassClears empties the list before
+        // the next render pass begins. m_RenderPassClears holds the clears taken over by that render pass.
+        struct DeferredClear
+        {
+            Texture* texture = nullptr;
+            TextureSubresourceSet subresources;
+            vk::ImageAspectFlags aspects;
+            vk::ClearValue value;
+            uint32_t attachment = 0; // color attachment index, or c_MaxRenderTargets for the depth attachment
+        };
+        std::vector<DeferredClear> m_DeferredClears;
+        std::vector<DeferredClear> m_RenderPassClears;
+
+        bool deferClear(Texture* texture, const TextureSubresourceSet& subresources, vk::ImageAspectFlags aspects, const vk::ClearValue& value);
+        void executeDeferredClears();
+        void prepareRenderPassClears(Framebuffer* fb);
 
         void bindBindingSets(vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, const BindingSetVector& bindings);
+        void bindDescriptorBufferSets(vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, const BindingSetVector& bindings);
+        uint64_t getVolatileConstantBufferOffset(Buffer* constantBuffer);
+
+        // Bindings recorded with setPushBindings, consumed by the next set*State call
+        PushBindings m_PushBindings;
+
+        // Trace clock time of the last open, or 0 if there was no trace recorder at that point
+        double m_TraceOpenSeconds = 0.0;
+
+        // Counters for getStatistics, only updated when m_CommandListParameters.enableStatistics is set
+        CommandListStatistics m_Statistics;
+        uint64_t m_UploadBytesAtOpen = 0;
+
+        void countDraws(uint64_t count) { if (m_CommandListParameters.enableStatistics) m_Statistics.numDraws += count; }
+        void countDispatches(uint64_t count) { if (m_CommandListParameters.enableStatistics) m_Statistics.numDispatches += count; }
+        void addBundleStatistics(CommandList* bundle);
 
+        // Profiler set with setGpuProfiler and the scopes opened by beginMarker in the current recording
+        RefCountPtr<GpuProfiler> m_GpuProfiler;
+        std::vector<uint32_t> m_GpuProfilerScopes;
+
+        // Set while conditional rendering is active, see setPredication
+        bool m_PredicationActive = false;
+
+        // Occlusion and pipeline statistics queries begun inside the current render pass and not ended yet
+        uint32_t m_RenderPassQueries = 0;
+
+        // Instance data allocated by beginTopLevelInstanceWrite, consumed by commitTopLevelInstanceWrite
+        struct PendingInstanceWrite
+        {
+            AccelStruct* accelStruct = nullptr;
+            VkDeviceAddress instanceData = 0;
+            size_t numInstances = 0;
+        } m_PendingInstanceWrite;
+
+        // Current pool for createTransientBindingSet
+        RefCountPtr<TransientDescriptorPool> m_TransientDescriptorPool;
+        vk::Result createTransientDescriptorPool();
+
+        // With EXT_descriptor_buffer: the chunk of the descriptor buffer that holds the transient binding sets
+        // and the patched copies of sets with volatile constant buffers, reset when the command list is opened
+        RefCountPtr<DescriptorBufferRange> m_TransientDescriptorChunk;
+        vk::DeviceSize m_TransientDescriptorChunkOffset = 0;
+        bool m_DescriptorBufferBound = false;
+        uint8_t* allocateTransientDescriptors(vk::DeviceSize size, vk::DeviceSize& outOffset);
+
+        bool usePushDescriptors() const { return m_Context.extensions.KHR_push_descriptor; }
+        void setResourceStatesForBindingItem(const BindingSetItem& binding);
+        void setResourceStatesForPushBindings();
+        void commitPushBindings(vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, const BindingLayoutVector& layouts);
+
+        // Begins a render pass instance for the framebuffer, using dynamic rendering when the framebuffer was created for it
+        void beginRenderPass(Framebuffer* fb, bool secondaryCommandBuffers);
         void endRenderPass();
+        [[nodiscard]] bool isInsideRenderPass() const { return m_CurrentGraphicsState.framebuffer || m_CurrentMeshletState.framebuffer; }
+        void resetQueries(vk::QueryPool pool, uint32_t firstQuery, uint32_t queryCount);
+        // Implements setGraphicsState, using the native handles baked into the block when it's not NULL
+        void setGraphicsStateInternal(const GraphicsState& state, const GraphicsStateBlock* block);
+        void drawMultiInternal(const MultiDrawArguments& multiDraw, bool indexed);
 
         void trackResourcesAndBarriers(const GraphicsState& state);
         void trackResourcesAndBarriers(const MeshletState& state);
         
         void writeVolatileBuffer(Buffer* buffer, const void* data, size_t dataSize);
+        void writeAdaptiveVolatileBuffer(Buffer* buffer, const void* data, size_t dataSize);
+        bool acquireVolatileBufferVersion(Buffer* buffer, VolatileBufferState& state);
         void flushVolatileBufferWrites();
         void submitVolatileBuffers(uint64_t recordingID, uint64_t submittedID);
+        void resetVolatileBufferStates();
 
         void updateGraphicsVolatileBuffers();
         void updateComputeVolatileBuffers();
         void updateMeshletVolatileBuffers();
         void updateRayTracingVolatileBuffers();
+        bool commitShaderTable(ShaderTable* shaderTable);
 
         void requireTextureState(ITexture* texture, TextureSubresourceSet subresources, ResourceStates state);
         void requireBufferState(IBuffer* buffer, ResourceStates state);
         bool anyBarriers() const;
 
         void buildTopLevelAccelStructInternal(AccelStruct* as, VkDeviceAddress instanceData, size_t numInstances, rt::AccelStructBuildFlags buildFlags, uint64_t currentVersion);
+#ifndef NVRHI_WITH_RTXMU
+        void writeCompactedSizes(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds, const std::vector<bool>& buildValid);
+#endif
 
         void commitBarriersInternal();
         void commitBarriersInternal_synchronization2();
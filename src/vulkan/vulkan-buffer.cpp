@@ -27,20 +27,93 @@
 
 namespace nvrhi::vulkan
 {
+    // Size of the chunks that command lists acquire from the shared volatile buffer ring
+    static constexpr uint64_t c_VolatileBufferRingChunkSize = 64 * 1024;
+
+    static uint64_t getVolatileBufferAlignment(const VulkanContext& context)
+    {
+        uint64_t alignment = context.physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+
+        uint64_t atomSize = context.physicalDeviceProperties.limits.nonCoherentAtomSize;
+        alignment = std::max(alignment, atomSize);
+
+        assert((alignment & (alignment - 1)) == 0); // check if it's a power of 2
+
+        return alignment;
+    }
+
+    Buffer* Device::getVolatileBufferRing()
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        if (!m_VolatileBufferRing)
+        {
+            // The ring is a regular volatile buffer where each version is one chunk,
+            // so that the chunks get the same completion tracking as any other version.
+            BufferDesc ringDesc;
+            ringDesc.byteSize = c_VolatileBufferRingChunkSize;
+            ringDesc.maxVersions = uint32_t(std::max<uint64_t>(m_VolatileBufferRingSize / c_VolatileBufferRingChunkSize, 1));
+            ringDesc.isVolatile = true;
+            ringDesc.isConstantBuffer = true;
+            ringDesc.debugName = "VolatileBufferRing";
+
+            BufferHandle ring = createBuffer(ringDesc);
+            if (!ring)
+            {
+                m_Context.error("Failed to create the shared volatile buffer ring");
+                return nullptr;
+            }
+
+            m_VolatileBufferRing = checked_cast<Buffer*>(ring.Get());
+        }
+
+        return m_VolatileBufferRing;
+    }
 
     BufferHandle Device::createBuffer(const BufferDesc& desc)
     {
         // Check some basic constraints first - the validation layer is expected to handle them too
 
-        if (desc.isVolatile && desc.maxVersions == 0)
-            return nullptr;
-
         if (desc.isVolatile && !desc.isConstantBuffer)
             return nullptr;
 
         if (desc.byteSize == 0)
             return nullptr;
 
+        if (desc.isVolatile && desc.maxVersions == 0)
+        {
+            // Adaptive volatile buffer: no storage of its own, the versions are placed into the shared ring,
+            // and the descriptors that reference this buffer point at the ring with a dynamic offset.
+
+            Buffer* ring = getVolatileBufferRing();
+            if (!ring)
+                return nullptr;
+
+            uint64_t alignment = getVolatileBufferAlignment(m_Context);
+            uint64_t size = align(desc.byteSize, alignment);
+
+            if (size > ring->desc.byteSize)
+            {
+                std::stringstream ss;
+                ss << "Volatile constant buffer " << utils::DebugNameToString(desc.debugName) << " has byteSize = "
+                   << desc.byteSize << ", which exceeds the " << ring->desc.byteSize << " byte chunks of the"
+                   " shared volatile buffer ring. Use a nonzero maxVersions for such buffers.";
+                m_Context.error(ss.str());
+                return nullptr;
+            }
+
+            Buffer* buffer = new Buffer(m_Context, m_Allocator);
+            buffer->desc = desc;
+            buffer->desc.byteSize = size;
+            buffer->desc.cpuAccess = CpuAccessMode::Write;
+            buffer->buffer = ring->buffer;
+            buffer->deviceAddress = ring->deviceAddress;
+            buffer->managed = false;
+            buffer->volatileRing = ring;
+
+            return BufferHandle::Create(buffer);
+        }
+
 
         Buffer *buffer = new Buffer(m_Context, m_Allocator);
         buffer->desc = desc;
@@ -55,7 +128,13 @@ namespace nvrhi::vulkan
             usageFlags |= vk::BufferUsageFlagBits::eIndexBuffer;
         
         if (desc.isDrawIndirectArgs)
+        {
             usageFlags |= vk::BufferUsageFlagBits::eIndirectBuffer;
+
+            // Indirect argument buffers can also hold predicates for setPredication
+            if (m_Context.extensions.EXT_conditional_rendering)
+                usageFlags |= vk::BufferUsageFlagBits::eConditionalRenderingEXT;
+        }
         
         if (desc.isConstantBuffer)
             usageFlags |= vk::BufferUsageFlagBits::eUniformBuffer;
@@ -87,12 +166,7 @@ namespace nvrhi::vulkan
         {
             assert(!desc.isVirtual);
 
-            uint64_t alignment = m_Context.physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
-
-            uint64_t atomSize = m_Context.physicalDeviceProperties.limits.nonCoherentAtomSize;
-            alignment = std::max(alignment, atomSize);
-
-            assert((alignment & (alignment - 1)) == 0); // check if it's a power of 2
+            uint64_t alignment = getVolatileBufferAlignment(m_Context);
             
             size = (size + alignment - 1) & ~(alignment - 1);
             buffer->desc.byteSize = size;
@@ -117,6 +191,19 @@ namespace nvrhi::vulkan
             .setUsage(usageFlags)
             .setSharingMode(vk::SharingMode::eExclusive);
 
+        // Build inputs are shared like the storage, because they are usually written on the graphics queue
+        // and read by builds on the compute queue
+        const bool isAccelStructResource = desc.isAccelStructStorage || desc.isAccelStructBuildInput;
+        const std::vector<uint32_t>& sharingQueueFamilies = (isAccelStructResource && m_Context.concurrentQueueFamilies.empty())
+            ? m_Context.accelStructQueueFamilies
+            : m_Context.concurrentQueueFamilies;
+
+        if (!sharingQueueFamilies.empty())
+        {
+            bufferInfo.setSharingMode(vk::SharingMode::eConcurrent)
+                .setQueueFamilyIndices(sharingQueueFamilies);
+        }
+
 #if _WIN32
         const auto handleType = vk::ExternalMemoryHandleTypeFlagBits::eOpaqueWin32;
 #else
@@ -136,11 +223,12 @@ namespace nvrhi::vulkan
             res = m_Allocator.allocateBufferMemory(buffer, (usageFlags & vk::BufferUsageFlagBits::eShaderDeviceAddress) != vk::BufferUsageFlags(0));
             CHECK_VK_FAIL(res)
 
-            m_Context.nameVKObject(buffer->memory, vk::DebugReportObjectTypeEXT::eDeviceMemory, desc.debugName.c_str());
+            if (!buffer->memoryBlock)
+                m_Context.nameVKObject(buffer->memory, vk::DebugReportObjectTypeEXT::eDeviceMemory, desc.debugName.c_str());
 
             if (desc.isVolatile)
             {
-                buffer->mappedMemory = m_Context.device.mapMemory(buffer->memory, 0, size);
+                buffer->mappedMemory = m_Allocator.mapMemory(buffer, 0, size);
                 assert(buffer->mappedMemory);
             }
 
@@ -225,10 +313,8 @@ namespace nvrhi::vulkan
         return 0;
     }
 
-    void CommandList::writeVolatileBuffer(Buffer* buffer, const void* data, size_t dataSize)
+    bool CommandList::acquireVolatileBufferVersion(Buffer* buffer, VolatileBufferState& state)
     {
-        VolatileBufferState& state = m_VolatileBufferStates[buffer];
-
         if (!state.initialized)
         {
             state.minVersion = int(buffer->desc.maxVersions);
@@ -301,19 +387,7 @@ namespace nvrhi::vulkan
             }
 
             if (!found)
-            {
-                // Not enough versions - need to relay this information to the developer.
-                // This has to be a real message and not assert, because asserts only happen in the
-                // debug mode, and buffer versioning will behave differently in debug vs. release,
-                // or validation on vs. off, because it is timing related.
-
-                std::stringstream ss;
-                ss << "Volatile constant buffer " << utils::DebugNameToString(buffer->desc.debugName) <<
-                    " has maxVersions = " << buffer->desc.maxVersions << ", which is insufficient.";
-
-                m_Context.error(ss.str());
-                return;
-            }
+                return false;
 
             // Encode the current CL ID for this version of the buffer, in a "pending" state
             uint64_t newVersionInfo = (uint64_t(m_CommandListParameters.queueType) << c_VersionQueueShift) | (m_CurrentCmdBuf->recordingID);
@@ -330,8 +404,79 @@ namespace nvrhi::vulkan
         state.minVersion = std::min(int(version), state.minVersion);
         state.maxVersion = std::max(int(version), state.maxVersion);
 
+        return true;
+    }
+
+    void CommandList::writeVolatileBuffer(Buffer* buffer, const void* data, size_t dataSize)
+    {
+        if (buffer->volatileRing)
+        {
+            writeAdaptiveVolatileBuffer(buffer, data, dataSize);
+            return;
+        }
+
+        VolatileBufferState& state = m_VolatileBufferStates[buffer];
+
+        if (!acquireVolatileBufferVersion(buffer, state))
+        {
+            // Not enough versions - need to relay this information to the developer.
+            // This has to be a real message and not assert, because asserts only happen in the
+            // debug mode, and buffer versioning will behave differently in debug vs. release,
+            // or validation on vs. off, because it is timing related.
+
+            std::stringstream ss;
+            ss << "Volatile constant buffer " << utils::DebugNameToString(buffer->desc.debugName) <<
+                " has maxVersions = " << buffer->desc.maxVersions << ", which is insufficient.";
+
+            m_Context.error(ss.str());
+            return;
+        }
+
         // Finally, write the actual data
-        void* hostData = (char*)buffer->mappedMemory + version * buffer->desc.byteSize;
+        void* hostData = (char*)buffer->mappedMemory + state.latestVersion * buffer->desc.byteSize;
+        memcpy(hostData, data, dataSize);
+
+        m_AnyVolatileBufferWrites = true;
+    }
+
+    void CommandList::writeAdaptiveVolatileBuffer(Buffer* buffer, const void* data, size_t dataSize)
+    {
+        // The versions of adaptive buffers are placed into the chunks of the shared ring, which is tracked
+        // like any other volatile buffer, so flushVolatileBufferWrites and submitVolatileBuffers handle it.
+
+        Buffer* ring = buffer->volatileRing;
+        VolatileBufferState& ringState = m_VolatileBufferStates[ring];
+        const uint64_t chunkSize = ring->desc.byteSize;
+
+        if (buffer->desc.byteSize > m_VolatileRingBytesLeft)
+        {
+            if (!acquireVolatileBufferVersion(ring, ringState))
+            {
+                std::stringstream ss;
+                ss << "Cannot write into volatile constant buffer " << utils::DebugNameToString(buffer->desc.debugName)
+                   << " because the shared volatile buffer ring is full. All of its " << ring->desc.maxVersions
+                   << " chunks are used by command lists that are still being recorded or executed. "
+                   "Increase DeviceDesc::volatileBufferRingSize from " << (chunkSize * ring->desc.maxVersions)
+                   << " bytes, or create the buffer with a nonzero maxVersions.";
+
+                m_Context.error(ss.str());
+                return;
+            }
+
+            m_VolatileRingBytesLeft = chunkSize;
+        }
+
+        const uint64_t ringOffset = uint64_t(ringState.latestVersion) * chunkSize + (chunkSize - m_VolatileRingBytesLeft);
+        m_VolatileRingBytesLeft -= buffer->desc.byteSize;
+
+        // The buffer has no versions of its own, keep the range empty so that flush and submit skip it
+        VolatileBufferState& state = m_VolatileBufferStates[buffer];
+        state.minVersion = 0;
+        state.maxVersion = -1;
+        state.initialized = true;
+        state.ringOffset = ringOffset;
+
+        void* hostData = (char*)ring->mappedMemory + ringOffset;
         memcpy(hostData, data, dataSize);
 
         m_AnyVolatileBufferWrites = true;
@@ -343,7 +488,8 @@ namespace nvrhi::vulkan
         // so before using the data on the GPU, we need to make sure it's available there.
         // Go over all the volatile CBs that were used in this CL and flush their written versions.
 
-        std::vector<vk::MappedMemoryRange> ranges;
+        std::vector<vk::MappedMemoryRange>& ranges = m_VolatileFlushRanges;
+        ranges.clear();
 
         for (auto& iter : m_VolatileBufferStates)
         {
@@ -359,7 +505,7 @@ namespace nvrhi::vulkan
 
             auto range = vk::MappedMemoryRange()
                 .setMemory(buffer->memory)
-                .setOffset(state.minVersion * buffer->desc.byteSize)
+                .setOffset(buffer->memoryOffset + state.minVersion * buffer->desc.byteSize)
                 .setSize(numVersions * buffer->desc.byteSize);
 
             ranges.push_back(range);
@@ -414,6 +560,9 @@ namespace nvrhi::vulkan
         {
             assert(destOffsetBytes == 0);
 
+            if (m_CommandListParameters.enableStatistics)
+                m_Statistics.bytesUploaded += dataSize;
+
             writeVolatileBuffer(buffer, data, dataSize);
             
             return;
@@ -435,6 +584,9 @@ namespace nvrhi::vulkan
             // Round up the write size to a multiple of 4
             const size_t sizeToWrite = (dataSize + 3) & ~3ull;
 
+            if (m_CommandListParameters.enableStatistics)
+                m_Statistics.bytesUploaded += sizeToWrite;
+
             m_CurrentCmdBuf->cmdBuf.updateBuffer(buffer->buffer, destOffsetBytes, sizeToWrite, data);
         }
         else
@@ -480,7 +632,7 @@ namespace nvrhi::vulkan
     {
         if (mappedMemory)
         {
-            m_Context.device.unmapMemory(memory);
+            m_Allocator.unmapMemory(this);
             mappedMemory = nullptr;
         }
 
@@ -528,7 +680,7 @@ namespace nvrhi::vulkan
         assert(flags != CpuAccessMode::None);
 
         // If the buffer has been used in a command list before, wait for that CL to complete
-        if (buffer->lastUseCommandListID != 0)
+        if (buffer->lastUseCommandListID != 0 && flags != CpuAccessMode::NoOverwrite)
         {
             auto& queue = m_Queues[uint32_t(buffer->lastUseQueue)];
             queue->waitCommandList(buffer->lastUseCommandListID, ~0ull);
@@ -543,6 +695,8 @@ namespace nvrhi::vulkan
                 break;
 
             case CpuAccessMode::Write:
+            case CpuAccessMode::Discard:
+            case CpuAccessMode::NoOverwrite:
                 accessFlags = vk::AccessFlagBits::eHostWrite;
                 break;
                 
@@ -555,11 +709,7 @@ namespace nvrhi::vulkan
         // TODO: there should be a barrier... But there can't be a command list here
         // buffer->barrier(cmd, vk::PipelineStageFlagBits::eHost, accessFlags);
 
-        void* ptr = nullptr;
-        [[maybe_unused]] const vk::Result res = m_Context.device.mapMemory(buffer->memory, offset, size, vk::MemoryMapFlags(), &ptr);
-        assert(res == vk::Result::eSuccess);
-
-        return ptr;
+        return m_Allocator.mapMemory(buffer, offset, size);
     }
 
     void *Device::mapBuffer(IBuffer* _buffer, CpuAccessMode flags)
@@ -569,11 +719,39 @@ namespace nvrhi::vulkan
         return mapBuffer(buffer, flags, 0, buffer->desc.byteSize);
     }
 
+    void *Device::tryMapBuffer(IBuffer* _buffer, CpuAccessMode flags, SubmissionId* outLastUse)
+    {
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        if (outLastUse)
+        {
+            outLastUse->queue = buffer->lastUseQueue;
+            outLastUse->instance = buffer->lastUseCommandListID;
+        }
+
+        if (buffer->lastUseCommandListID != 0 && flags != CpuAccessMode::NoOverwrite)
+        {
+            auto& queue = m_Queues[uint32_t(buffer->lastUseQueue)];
+
+            if (!queue->pollCommandList(buffer->lastUseCommandListID))
+            {
+                // Make sure that the submission is executed so that a later attempt can succeed
+                if (buffer->lastUseCommandListID > queue->getLastFlushedID())
+                    queue->flush();
+
+                return nullptr;
+            }
+        }
+
+        // The submission has finished, so this doesn't wait
+        return mapBuffer(buffer, flags, 0, buffer->desc.byteSize);
+    }
+
     void Device::unmapBuffer(IBuffer* _buffer)
     {
         Buffer* buffer = checked_cast<Buffer*>(_buffer);
 
-        m_Context.device.unmapMemory(buffer->memory);
+        m_Allocator.unmapMemory(buffer);
 
         // TODO: there should be a barrier
         // buffer->barrier(cmd, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
@@ -30,7 +30,8 @@ namespace nvrhi::vulkan
         , m_Context(context)
         , m_CommandListParameters(parameters)
         , m_StateTracker(context.messageCallback)
-        , m_UploadManager(std::make_unique<UploadManager>(device, parameters.uploadChunkSize, 0, false))
+        , m_BundleStates(context.messageCallback)
+        , m_UploadManager(std::make_unique<UploadManager>(device, parameters.uploadChunkSize, 0, false, parameters.uploadRingSize))
         , m_ScratchManager(std::make_unique<UploadManager>(device, parameters.scratchChunkSize, parameters.scratchMaxMemory, true))
     {
     }
@@ -48,21 +49,136 @@ namespace nvrhi::vulkan
 
     void CommandList::open()
     {
+        m_Statistics = CommandListStatistics();
+        m_UploadBytesAtOpen = m_UploadManager->getBytesRequested();
+        m_TraceOpenSeconds = m_Context.traceRecorder.get() ? getTraceClockSeconds() : 0.0;
+
+        if (m_CommandListParameters.isBundle)
+        {
+            openBundle();
+            return;
+        }
+
+        // Uploads of a previous recording that was closed but never executed are not going to be submitted
+        m_UploadManager->releaseUnsubmitted();
+
         m_CurrentCmdBuf = m_Device->getQueue(m_CommandListParameters.queueType)->getOrCreateCommandBuffer();
+        m_PendingSplitBarriers.clear();
 
         auto beginInfo = vk::CommandBufferBeginInfo()
             .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 
+        // Select the devices that execute the commands, the same mask is used when the command buffer is submitted
+        auto deviceGroupBeginInfo = vk::DeviceGroupCommandBufferBeginInfo()
+            .setDeviceMask(getDeviceMask());
+
+        if (m_Context.deviceGroupSize > 1)
+            beginInfo.setPNext(&deviceGroupBeginInfo);
+
         (void)m_CurrentCmdBuf->cmdBuf.begin(&beginInfo);
         m_CurrentCmdBuf->referencedResources.push_back(this); // prevent deletion of e.g. UploadManager
+        m_GpuProfilerScopes.clear();
+        m_PredicationActive = false;
+        m_RenderPassQueries = 0;
+        m_PendingInstanceWrite = PendingInstanceWrite();
+        m_TransientDescriptorChunk = nullptr;
+        m_TransientDescriptorChunkOffset = 0;
+
+        clearState();
+    }
+
+    void CommandList::openBundle()
+    {
+        m_CurrentCmdBuf = nullptr;
+
+        for (const TrackedCommandBufferPtr& cmdBuf : m_BundleCommandBuffers)
+        {
+            if (cmdBuf.use_count() == 1)
+            {
+                m_CurrentCmdBuf = cmdBuf;
+                break;
+            }
+        }
+
+        if (!m_CurrentCmdBuf)
+        {
+            m_CurrentCmdBuf = m_Device->getQueue(m_CommandListParameters.queueType)->createCommandBuffer(vk::CommandBufferLevel::eSecondary);
+            if (!m_CurrentCmdBuf)
+                return;
+
+            m_BundleCommandBuffers.push_back(m_CurrentCmdBuf);
+        }
+
+        m_CurrentCmdBuf->referencedResources.clear();
+        m_BundleStates.clear();
+        m_TransientDescriptorChunk = nullptr;
+        m_TransientDescriptorChunkOffset = 0;
+
+        // The bundle is executed inside a render pass for bundleFramebuffer, possibly by several command lists at once
+        Framebuffer* fb = checked_cast<Framebuffer*>(m_CommandListParameters.bundleFramebuffer);
+
+        auto inheritanceInfo = vk::CommandBufferInheritanceInfo();
+        auto renderingInheritanceInfo = vk::CommandBufferInheritanceRenderingInfo();
+        auto beginInfo = vk::CommandBufferBeginInfo()
+            .setFlags(vk::CommandBufferUsageFlagBits::eSimultaneousUse)
+            .setPInheritanceInfo(&inheritanceInfo);
+
+        if (fb)
+        {
+            if (fb->dynamicRendering)
+            {
+                renderingInheritanceInfo
+                    .setColorAttachmentCount(uint32_t(fb->colorFormats.size()))
+                    .setPColorAttachmentFormats(fb->colorFormats.data())
+                    .setDepthAttachmentFormat(fb->depthFormat)
+                    .setStencilAttachmentFormat(fb->stencilFormat)
+                    .setRasterizationSamples(vk::SampleCountFlagBits(fb->framebufferInfo.sampleCount));
+
+                inheritanceInfo.setPNext(&renderingInheritanceInfo);
+            }
+            else
+            {
+                inheritanceInfo
+                    .setRenderPass(fb->renderPass)
+                    .setSubpass(0)
+                    .setFramebuffer(fb->framebuffer);
+            }
+
+            beginInfo.flags |= vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+
+            m_CurrentCmdBuf->referencedResources.push_back(fb);
+        }
+
+        (void)m_CurrentCmdBuf->cmdBuf.begin(&beginInfo);
 
         clearState();
     }
 
     void CommandList::close()
     {
+        TraceRecorderHandle traceRecorder = m_Context.traceRecorder.get();
+        if (traceRecorder && m_TraceOpenSeconds > 0.0)
+        {
+            traceRecorder->recordCpuEvent("Record command list", "CommandList", m_TraceOpenSeconds, getTraceClockSeconds(),
+                "queue", uint64_t(m_CommandListParameters.queueType));
+        }
+
+        if (m_CommandListParameters.isBundle)
+        {
+            m_CurrentCmdBuf->cmdBuf.end();
+            clearState();
+            return;
+        }
+
         endRenderPass();
 
+        if (m_PredicationActive)
+        {
+            m_CurrentCmdBuf->cmdBuf.endConditionalRenderingEXT();
+            m_PredicationActive = false;
+        }
+
+        m_StateTracker.endSplitTransitions();
         m_StateTracker.keepBufferInitialStates();
         m_StateTracker.keepTextureInitialStates();
         commitBarriers();
@@ -87,8 +203,10 @@ namespace nvrhi::vulkan
 
         m_CurrentPipelineLayout = vk::PipelineLayout();
         m_CurrentPushConstantsVisibility = vk::ShaderStageFlagBits();
+        m_DescriptorBufferBound = false;
 
         m_CurrentGraphicsState = GraphicsState();
+        m_CurrentGraphicsStateBlock = nullptr;
         m_CurrentComputeState = ComputeState();
         m_CurrentMeshletState = MeshletState();
         m_CurrentRayTracingState = rt::State();
@@ -103,18 +221,48 @@ namespace nvrhi::vulkan
     {
         assert(m_CurrentCmdBuf);
 
+        if (m_CommandListParameters.enableStatistics)
+            m_Statistics.pushConstantBytes += byteSize;
+
         m_CurrentCmdBuf->cmdBuf.pushConstants(m_CurrentPipelineLayout, m_CurrentPushConstantsVisibility, 0, uint32_t(byteSize), data);
     }
 
+    CommandListStatistics CommandList::getStatistics()
+    {
+        if (!m_CommandListParameters.enableStatistics)
+            return CommandListStatistics();
+
+        CommandListStatistics statistics = m_Statistics;
+        statistics.bytesUploaded += m_UploadManager->getBytesRequested() - m_UploadBytesAtOpen;
+
+        // The command buffer is released when the command list is executed, the count is kept from that point
+        if (m_CurrentCmdBuf)
+            statistics.numReferencedResources = m_CurrentCmdBuf->referencedResources.size();
+
+        return statistics;
+    }
+
+    void CommandList::addBundleStatistics(CommandList* bundle)
+    {
+        if (!m_CommandListParameters.enableStatistics)
+            return;
+
+        // The bundle's resources are kept alive through the bundle command buffer and are not counted again
+        CommandListStatistics bundleStatistics = bundle->getStatistics();
+        bundleStatistics.numReferencedResources = 0;
+        m_Statistics += bundleStatistics;
+    }
+
     void CommandList::executed(Queue& queue, const uint64_t submissionID)
     {
         assert(m_CurrentCmdBuf);
 
-        m_CurrentCmdBuf->submissionID = submissionID;
+        // m_CurrentCmdBuf->submissionID is set by Queue::submit
 
         const CommandQueue queueID = queue.getQueueID();
         const uint64_t recordingID = m_CurrentCmdBuf->recordingID;
 
+        m_Statistics.numReferencedResources = m_CurrentCmdBuf->referencedResources.size();
         m_CurrentCmdBuf = nullptr;
 
         submitVolatileBuffers(recordingID, submissionID);
@@ -129,7 +277,26 @@ namespace nvrhi::vulkan
             MakeVersion(recordingID, queueID, false),
             MakeVersion(submissionID, queueID, true));
 
-        m_VolatileBufferStates.clear();
+        resetVolatileBufferStates();
+        m_VolatileRingBytesLeft = 0;
+    }
+
+    void CommandList::resetVolatileBufferStates()
+    {
+        // The entries are kept for the next recording, which likely uses the same buffers, so that it doesn't
+        // allocate map nodes for them again. Entries of the buffers that were not written in this recording
+        // are erased, so the entries of destroyed buffers go away after one more recording.
+        for (auto it = m_VolatileBufferStates.begin(); it != m_VolatileBufferStates.end(); )
+        {
+            if (!it->second.initialized)
+            {
+                it = m_VolatileBufferStates.erase(it);
+                continue;
+            }
+
+            it->second = VolatileBufferState();
+            ++it;
+        }
     }
     
 }
\ No newline at end of file
@@ -28,9 +28,19 @@ namespace nvrhi::vulkan
 
     ComputePipelineHandle Device::createComputePipeline(const ComputePipelineDesc& desc)
     {
+        return m_ObjectCache.getComputePipeline(desc, [this, &desc] { return createComputePipelineInternal(desc); });
+    }
+
+    ComputePipelineHandle Device::createComputePipelineInternal(const ComputePipelineDesc& desc)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createComputePipeline", "Pipeline");
+
         vk::Result res;
 
         assert(desc.CS);
+
+        if (!validatePushDescriptorLayouts(desc.bindingLayouts, "createComputePipeline"))
+            return nullptr;
         
         ComputePipeline *pso = new ComputePipeline(m_Context);
         pso->desc = desc;
@@ -109,7 +119,11 @@ namespace nvrhi::vulkan
                                 .setStage(shaderStageInfo)
                                 .setLayout(pso->pipelineLayout);
 
-        res = m_Context.device.createComputePipelines(m_Context.pipelineCache,
+        // Pipelines must be created for the binding model the device uses
+        if (m_Context.descriptorBuffer)
+            pipelineInfo.flags |= vk::PipelineCreateFlagBits::eDescriptorBufferEXT;
+
+        res = m_Context.device.createComputePipelines(m_Context.getPipelineCache(),
                                                     1, &pipelineInfo,
                                                     m_Context.allocationCallbacks,
                                                     &pso->pipeline);
@@ -149,6 +163,18 @@ namespace nvrhi::vulkan
 
     void CommandList::setComputeState(const ComputeState& state)
     {
+        if (!m_PushBindings.empty() && !usePushDescriptors() && state.pipeline)
+        {
+            // Without VK_KHR_push_descriptor, the pushed bindings become regular binding sets
+            ComputeState resolvedState = state;
+            if (m_CommandListParameters.enableStatistics)
+                m_Statistics.numDescriptorsWritten += m_PushBindings.getNumBindings();
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, &m_CurrentCmdBuf->referencedResources))
+                setComputeState(resolvedState);
+            m_PushBindings.clear();
+            return;
+        }
+
         endRenderPass();
 
         assert(m_CurrentCmdBuf);
@@ -171,6 +197,19 @@ namespace nvrhi::vulkan
             }
         }
 
+        if (m_EnableAutomaticBarriers)
+        {
+            setResourceStatesForPushBindings();
+        }
+
+        if (m_CommandListParameters.enableStatistics)
+        {
+            countStateChanges(m_Statistics, {
+                m_CurrentComputeState.pipeline != state.pipeline,
+                arraysAreDifferent(m_CurrentComputeState.bindings, state.bindings) || m_AnyVolatileBufferWrites,
+                state.indirectParams && state.indirectParams != m_CurrentComputeState.indirectParams });
+        }
+
         if (m_CurrentComputeState.pipeline != state.pipeline)
         {
             m_CurrentCmdBuf->cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, pso->pipeline);
@@ -183,6 +222,11 @@ namespace nvrhi::vulkan
             bindBindingSets(vk::PipelineBindPoint::eCompute, pso->pipelineLayout, state.bindings);
         }
 
+        if (!m_PushBindings.empty())
+        {
+            commitPushBindings(vk::PipelineBindPoint::eCompute, pso->pipelineLayout, pso->desc.bindingLayouts);
+        }
+
         m_CurrentPipelineLayout = pso->pipelineLayout;
         m_CurrentPushConstantsVisibility = pso->pushConstantVisibility;
 
@@ -225,6 +269,7 @@ namespace nvrhi::vulkan
 
         updateComputeVolatileBuffers();
 
+        countDispatches(1);
         m_CurrentCmdBuf->cmdBuf.dispatch(groupsX, groupsY, groupsZ);
     }
 
@@ -237,7 +282,15 @@ namespace nvrhi::vulkan
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentComputeState.indirectParams);
         assert(indirectParams);
 
+        countDispatches(1);
         m_CurrentCmdBuf->cmdBuf.dispatchIndirect(indirectParams->buffer, offsetBytes);
     }
 
+    void CommandList::executeIndirect(ICommandSignature*, uint32_t, uint32_t, uint32_t)
+    {
+        // Signatures cannot be created on Vulkan, see Device::createCommandSignature
+        m_Context.error("executeIndirect: Command signatures are not supported by the Vulkan backend "
+            "(Feature::CommandSignatures)");
+    }
+
 } // namespace nvrhi::vulkan
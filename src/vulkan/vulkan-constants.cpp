@@ -329,6 +329,10 @@ namespace nvrhi::vulkan
             vk::PipelineStageFlagBits2::eMicromapBuildEXT,
             vk::AccessFlagBits2::eShaderRead,
             vk::ImageLayout::eUndefined },
+        { ResourceStates::Predication,
+            vk::PipelineStageFlagBits2::eConditionalRenderingEXT,
+            vk::AccessFlagBits2::eConditionalRenderingReadEXT,
+            vk::ImageLayout::eUndefined },
     };
 
     ResourceStateMappingInternal convertResourceStateInternal(ResourceStates state)
@@ -368,15 +372,69 @@ namespace nvrhi::vulkan
         return result;
     }
 
-    ResourceStateMapping convertResourceState(ResourceStates state)
+    // Compute and transfer queues don't support the graphics pipeline stages, so their barriers drop those stages
+    // and the accesses that only happen in them. The graphics work that used the resource ran on another queue
+    // and is ordered with the queue semaphores, not with this barrier.
+    static void restrictResourceStateToQueue(ResourceStateMappingInternal& mapping, CommandQueue queue)
+    {
+        if (queue == CommandQueue::Graphics)
+            return;
+
+        if (queue == CommandQueue::Compute)
+        {
+            constexpr vk::PipelineStageFlags2 graphicsStages =
+                vk::PipelineStageFlagBits2::eVertexInput |
+                vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits2::eLateFragmentTests |
+                vk::PipelineStageFlagBits2::eColorAttachmentOutput |
+                vk::PipelineStageFlagBits2::eTransformFeedbackEXT |
+                vk::PipelineStageFlagBits2::eFragmentShadingRateAttachmentKHR;
+
+            constexpr vk::AccessFlags2 graphicsAccess =
+                vk::AccessFlagBits2::eIndexRead |
+                vk::AccessFlagBits2::eVertexAttributeRead |
+                vk::AccessFlagBits2::eColorAttachmentRead |
+                vk::AccessFlagBits2::eColorAttachmentWrite |
+                vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+                vk::AccessFlagBits2::eTransformFeedbackWriteEXT |
+                vk::AccessFlagBits2::eFragmentShadingRateAttachmentReadKHR;
+
+            mapping.stageFlags &= ~graphicsStages;
+            mapping.accessMask &= ~graphicsAccess;
+        }
+        else
+        {
+            constexpr vk::PipelineStageFlags2 transferStages =
+                vk::PipelineStageFlagBits2::eTopOfPipe |
+                vk::PipelineStageFlagBits2::eTransfer |
+                vk::PipelineStageFlagBits2::eAllCommands;
+
+            constexpr vk::AccessFlags2 transferAccess =
+                vk::AccessFlagBits2::eTransferRead |
+                vk::AccessFlagBits2::eTransferWrite |
+                vk::AccessFlagBits2::eMemoryRead;
+
+            mapping.stageFlags &= transferStages;
+            mapping.accessMask &= transferAccess;
+        }
+
+        // Nothing on this queue used the resource in the remaining stages: order the barrier against everything
+        if (!mapping.stageFlags)
+            mapping.stageFlags = vk::PipelineStageFlagBits2::eAllCommands;
+    }
+
+    ResourceStateMapping convertResourceState(ResourceStates state, CommandQueue queue)
     {
-        const ResourceStateMappingInternal mapping = convertResourceStateInternal(state);
+        ResourceStateMappingInternal mapping = convertResourceStateInternal(state);
+        restrictResourceStateToQueue(mapping, queue);
         return mapping.AsResourceStateMapping();
     }
 
-    ResourceStateMapping2 convertResourceState2(ResourceStates state)
+    ResourceStateMapping2 convertResourceState2(ResourceStates state, CommandQueue queue)
     {
-        const ResourceStateMappingInternal mapping = convertResourceStateInternal(state);
+        ResourceStateMappingInternal mapping = convertResourceStateInternal(state);
+        restrictResourceStateToQueue(mapping, queue);
         return mapping.AsResourceStateMapping2();
     }
 
@@ -21,9 +21,11 @@
 */
 
 #include "vulkan-backend.h"
+#include <algorithm>
 #include <unordered_map>
 
 #include <nvrhi/common/misc.h>
+#include "../common/pipeline-cache.h"
 
 #if defined(NVRHI_SHARED_LIBRARY_BUILD)
 // Define the Vulkan dynamic dispatcher - this needs to occur in exactly one cpp file in the program.
@@ -35,7 +37,8 @@ namespace nvrhi::vulkan
     DeviceHandle createDevice(const DeviceDesc& desc)
     {
 #if defined(NVRHI_SHARED_LIBRARY_BUILD)
-        const vk::DynamicLoader dl;
+        // Load the Vulkan library once per process instead of once per device
+        static const vk::DynamicLoader dl;
         const PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr =   // NOLINT(misc-misplaced-const)
             dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
         VULKAN_HPP_DEFAULT_DISPATCHER.init(desc.instance, vkGetInstanceProcAddr, desc.device);
@@ -49,7 +52,17 @@ namespace nvrhi::vulkan
         : m_Context(desc.instance, desc.physicalDevice, desc.device, reinterpret_cast<vk::AllocationCallbacks*>(desc.allocationCallbacks))
         , m_Allocator(m_Context)
         , m_TimerQueryAllocator(desc.maxTimerQueries, true)
+        , m_OcclusionQueryAllocator(desc.maxOcclusionQueries, true)
+        , m_PipelineStatisticsQueryAllocator(desc.maxPipelineStatisticsQueries, true)
+        , m_OcclusionQueryPreciseSupported(desc.occlusionQueryPreciseSupported)
+        , m_PipelineStatisticsQuerySupported(desc.pipelineStatisticsQuerySupported)
+        , m_HostQueryResetSupported(desc.hostQueryResetSupported)
+        , m_SparseResidencySupported(desc.sparseResidencySupported)
+        , m_VolatileBufferRingSize(desc.volatileBufferRingSize)
+        , m_AutomaticQueueSync(desc.enableAutomaticQueueSync)
     {
+        StartupTimer startupTimer(desc.reportStartupTimes);
+
         if (desc.graphicsQueue)
         {
             m_Queues[uint32_t(CommandQueue::Graphics)] = std::make_unique<Queue>(m_Context,
@@ -68,21 +81,32 @@ namespace nvrhi::vulkan
                 CommandQueue::Copy, desc.transferQueue, desc.transferQueueIndex);
         }
 
-        // maps Vulkan extension strings into the corresponding boolean flags in Device
-        const std::unordered_map<std::string, bool*> extensionStringMap = {
-            { VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, &m_Context.extensions.KHR_synchronization2 },
-            { VK_KHR_MAINTENANCE1_EXTENSION_NAME, &m_Context.extensions.KHR_maintenance1 },
-            { VK_EXT_DEBUG_REPORT_EXTENSION_NAME, &m_Context.extensions.EXT_debug_report },
-            { VK_EXT_DEBUG_MARKER_EXTENSION_NAME, &m_Context.extensions.EXT_debug_marker },
-            { VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, &m_Context.extensions.KHR_acceleration_structure },
-            { VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME, &m_Context.extensions.buffer_device_address },
-            { VK_KHR_RAY_QUERY_EXTENSION_NAME,&m_Context.extensions.KHR_ray_query },
-            { VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, &m_Context.extensions.KHR_ray_tracing_pipeline },
-            { VK_NV_MESH_SHADER_EXTENSION_NAME, &m_Context.extensions.NV_mesh_shader },
-            { VK_EXT_CONSERVATIVE_RASTERIZATION_EXTENSION_NAME, &m_Context.extensions.EXT_conservative_rasterization},
-            { VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME, &m_Context.extensions.KHR_fragment_shading_rate },
-            { VK_EXT_OPACITY_MICROMAP_EXTENSION_NAME, &m_Context.extensions.EXT_opacity_micromap },
-            { VK_NV_RAY_TRACING_INVOCATION_REORDER_EXTENSION_NAME, &m_Context.extensions.NV_ray_tracing_invocation_reorder },
+        // maps Vulkan extension strings into the corresponding boolean flags in Device.
+        // The map doesn't depend on the device, so it is built once and shared by all devices.
+        using Extensions = decltype(m_Context.extensions);
+        static const std::unordered_map<std::string, bool Extensions::*> extensionStringMap = {
+            { VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, &Extensions::KHR_synchronization2 },
+            { VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME, &Extensions::KHR_push_descriptor },
+            { VK_KHR_MAINTENANCE1_EXTENSION_NAME, &Extensions::KHR_maintenance1 },
+            { VK_EXT_DEBUG_REPORT_EXTENSION_NAME, &Extensions::EXT_debug_report },
+            { VK_EXT_DEBUG_MARKER_EXTENSION_NAME, &Extensions::EXT_debug_marker },
+            { VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, &Extensions::KHR_acceleration_structure },
+            { VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME, &Extensions::buffer_device_address },
+            { VK_KHR_RAY_QUERY_EXTENSION_NAME,&Extensions::KHR_ray_query },
+            { VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, &Extensions::KHR_ray_tracing_pipeline },
+            { VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, &Extensions::KHR_pipeline_library },
+            { VK_NV_MESH_SHADER_EXTENSION_NAME, &Extensions::NV_mesh_shader },
+            { VK_EXT_MESH_SHADER_EXTENSION_NAME, &Extensions::EXT_mesh_shader },
+            { VK_EXT_CONSERVATIVE_RASTERIZATION_EXTENSION_NAME, &Extensions::EXT_conservative_rasterization},
+            { VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME, &Extensions::KHR_fragment_shading_rate },
+            { VK_EXT_OPACITY_MICROMAP_EXTENSION_NAME, &Extensions::EXT_opacity_micromap },
+            { VK_NV_RAY_TRACING_INVOCATION_REORDER_EXTENSION_NAME, &Extensions::NV_ray_tracing_invocation_reorder },
+            { VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME, &Extensions::KHR_deferred_host_operations },
+            { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, &Extensions::KHR_draw_indirect_count },
+            { VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, &Extensions::EXT_calibrated_timestamps },
+            { VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME, &Extensions::EXT_conditional_rendering },
+            { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, &Extensions::EXT_memory_budget },
+            { VK_EXT_MULTI_DRAW_EXTENSION_NAME, &Extensions::EXT_multi_draw },
         };
 
         // parse the extension/layer lists and figure out which extensions are enabled
@@ -91,7 +115,7 @@ namespace nvrhi::vulkan
             auto ext = extensionStringMap.find(desc.instanceExtensions[i]);
             if (ext != extensionStringMap.end())
             {
-                *(ext->second) = true;
+                m_Context.extensions.*(ext->second) = true;
             }
         }
         
@@ -100,14 +124,24 @@ namespace nvrhi::vulkan
             auto ext = extensionStringMap.find(desc.deviceExtensions[i]);
             if (ext != extensionStringMap.end())
             {
-                *(ext->second) = true;
+                m_Context.extensions.*(ext->second) = true;
             }
         }
 
+        startupTimer.mark("Extensions");
+
         // The Vulkan 1.2 way of enabling bufferDeviceAddress
         if (desc.bufferDeviceAddressSupported)
             m_Context.extensions.buffer_device_address = true;
 
+        // The extension alone doesn't enable the feature, so only the flag in the descriptor is used
+        m_Context.extensions.KHR_dynamic_rendering = desc.dynamicRenderingSupported;
+        m_Context.extensions.EXT_extended_dynamic_state = desc.extendedDynamicStateSupported;
+        m_Context.extensions.EXT_descriptor_buffer = desc.descriptorBufferSupported && m_Context.extensions.buffer_device_address;
+
+        if (desc.descriptorBufferSupported && !m_Context.extensions.buffer_device_address)
+            m_Context.warning("Descriptor buffers require buffer device addresses, descriptor sets are used instead");
+
         void* pNext = nullptr;
         vk::PhysicalDeviceAccelerationStructurePropertiesKHR accelStructProperties;
         vk::PhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingPipelineProperties;
@@ -115,6 +149,9 @@ namespace nvrhi::vulkan
         vk::PhysicalDeviceFragmentShadingRatePropertiesKHR shadingRateProperties;
         vk::PhysicalDeviceOpacityMicromapPropertiesEXT opacityMicromapProperties;
         vk::PhysicalDeviceRayTracingInvocationReorderPropertiesNV nvRayTracingInvocationReorderProperties;
+        vk::PhysicalDeviceMultiDrawPropertiesEXT multiDrawProperties;
+        vk::PhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties;
+        vk::PhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProperties;
         
         vk::PhysicalDeviceProperties2 deviceProperties2;
 
@@ -154,6 +191,24 @@ namespace nvrhi::vulkan
             pNext = &nvRayTracingInvocationReorderProperties;
         }
 
+        if (m_Context.extensions.EXT_multi_draw)
+        {
+            multiDrawProperties.pNext = pNext;
+            pNext = &multiDrawProperties;
+        }
+
+        if (m_Context.extensions.EXT_descriptor_buffer)
+        {
+            descriptorBufferProperties.pNext = pNext;
+            pNext = &descriptorBufferProperties;
+        }
+
+        if (m_Context.extensions.KHR_push_descriptor)
+        {
+            pushDescriptorProperties.pNext = pNext;
+            pNext = &pushDescriptorProperties;
+        }
+
         deviceProperties2.pNext = pNext;
 
         m_Context.physicalDevice.getProperties2(&deviceProperties2);
@@ -165,7 +220,61 @@ namespace nvrhi::vulkan
         m_Context.shadingRateProperties = shadingRateProperties;
         m_Context.opacityMicromapProperties = opacityMicromapProperties;
         m_Context.nvRayTracingInvocationReorderProperties = nvRayTracingInvocationReorderProperties;
+        m_Context.multiDrawProperties = multiDrawProperties;
+        m_Context.descriptorBufferProperties = descriptorBufferProperties;
+        m_Context.pushDescriptorProperties = pushDescriptorProperties;
+
+        startupTimer.mark("Device properties");
+
         m_Context.messageCallback = desc.errorCB;
+        m_Context.descriptorUpdateAfterBindSupported = desc.descriptorUpdateAfterBindSupported;
+        m_Context.deviceGroupSize = std::max(desc.deviceGroupSize, 1u);
+
+        {
+            // Without resizable BAR, the device-local host-visible heap is only a 256 MB window that drivers use themselves
+            constexpr vk::DeviceSize c_MaxNonResizableBarSize = 256 * 1024 * 1024;
+            const vk::MemoryPropertyFlags barFlags = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+
+            const vk::PhysicalDeviceMemoryProperties memoryProperties = m_Context.physicalDevice.getMemoryProperties();
+            for (uint32_t memTypeIndex = 0; memTypeIndex < memoryProperties.memoryTypeCount; memTypeIndex++)
+            {
+                const vk::MemoryType& memoryType = memoryProperties.memoryTypes[memTypeIndex];
+                if ((memoryType.propertyFlags & barFlags) == barFlags &&
+                    memoryProperties.memoryHeaps[memoryType.heapIndex].size > c_MaxNonResizableBarSize)
+                {
+                    m_Context.deviceLocalHostVisibleMemory = true;
+                    break;
+                }
+            }
+        }
+
+        if (desc.enableAutomaticQueueSync)
+        {
+            for (int queueFamily : { desc.graphicsQueueIndex, desc.computeQueueIndex, desc.transferQueueIndex })
+            {
+                if (queueFamily >= 0 && std::find(m_Context.concurrentQueueFamilies.begin(),
+                    m_Context.concurrentQueueFamilies.end(), uint32_t(queueFamily)) == m_Context.concurrentQueueFamilies.end())
+                {
+                    m_Context.concurrentQueueFamilies.push_back(uint32_t(queueFamily));
+                }
+            }
+
+            // Concurrent sharing requires at least two distinct queue families
+            if (m_Context.concurrentQueueFamilies.size() < 2)
+                m_Context.concurrentQueueFamilies.clear();
+        }
+
+        if (m_Context.extensions.KHR_acceleration_structure)
+        {
+            // Acceleration structures built on the compute queue are consumed on the graphics queue,
+            // so their storage is shared between the two families and synchronized automatically
+            if (desc.graphicsQueue && desc.computeQueue && desc.graphicsQueueIndex != desc.computeQueueIndex)
+            {
+                m_Context.accelStructQueueFamilies = { uint32_t(desc.graphicsQueueIndex), uint32_t(desc.computeQueueIndex) };
+            }
+
+            m_AccelStructQueueSync = desc.graphicsQueue && desc.computeQueue;
+        }
 
         if (m_Context.extensions.EXT_opacity_micromap && !m_Context.extensions.KHR_synchronization2)
         {
@@ -181,6 +290,15 @@ namespace nvrhi::vulkan
             m_Context.physicalDevice.getFeatures2(&deviceFeatures2);
             m_Context.shadingRateFeatures = shadingRateFeatures;
         }
+
+        if (m_Context.extensions.EXT_multi_draw)
+        {
+            vk::PhysicalDeviceFeatures2 deviceFeatures2;
+            vk::PhysicalDeviceMultiDrawFeaturesEXT multiDrawFeatures;
+            deviceFeatures2.setPNext(&multiDrawFeatures);
+            m_Context.physicalDevice.getFeatures2(&deviceFeatures2);
+            m_Context.multiDrawFeatures = multiDrawFeatures;
+        }
 #ifdef NVRHI_WITH_RTXMU
         if (m_Context.extensions.KHR_acceleration_structure)
         {
@@ -197,25 +315,66 @@ namespace nvrhi::vulkan
             m_Context.warning("Opacity micro-maps are not currently supported by RTXMU.");
         }
 #endif
-        auto pipelineInfo = vk::PipelineCacheCreateInfo();
-        vk::Result res = m_Context.device.createPipelineCache(&pipelineInfo,
-            m_Context.allocationCallbacks,
-            &m_Context.pipelineCache);
+        // The pipeline cache is created on first use, see VulkanContext::getPipelineCache
 
-        if (res != vk::Result::eSuccess)
+        startupTimer.mark("Memory properties and features");
+
+        if (m_Context.extensions.EXT_descriptor_buffer)
         {
-            m_Context.error("Failed to create the pipeline cache");
+            m_DescriptorBuffer = std::make_unique<DescriptorBuffer>(m_Context, m_Allocator);
+            if (m_DescriptorBuffer->create(desc.descriptorBufferSize) == vk::Result::eSuccess)
+            {
+                m_Context.descriptorBuffer = m_DescriptorBuffer.get();
+            }
+            else
+            {
+                m_Context.error("Failed to create the descriptor buffer, descriptor sets are used instead");
+                m_DescriptorBuffer.reset();
+                m_Context.extensions.EXT_descriptor_buffer = false;
+            }
         }
+
+        startupTimer.mark("Descriptor buffer");
+
+        if (desc.enableBackgroundGarbageCollection)
+        {
+            m_GarbageCollectionThread = std::make_unique<GarbageCollectionThread>(
+                [this] { retireCommandBuffers(std::chrono::steady_clock::time_point::max()); },
+                std::chrono::microseconds(desc.backgroundGarbageCollectionInterval));
+        }
+
+        startupTimer.mark("Garbage collection thread");
+        startupTimer.report(m_Context.messageCallback, "Vulkan");
     }
 
     Device::~Device()
     {
+        m_GarbageCollectionThread.reset();
+
+        m_ObjectCache.clear();
+
+#ifndef NVRHI_WITH_RTXMU
+        m_Context.compactionResources->asBuildsCompleted.clear();
+#endif
+
         if (m_TimerQueryPool)
         {
             m_Context.device.destroyQueryPool(m_TimerQueryPool);
             m_TimerQueryPool = vk::QueryPool();
         }
 
+        if (m_OcclusionQueryPool)
+        {
+            m_Context.device.destroyQueryPool(m_OcclusionQueryPool);
+            m_OcclusionQueryPool = vk::QueryPool();
+        }
+
+        if (m_PipelineStatisticsQueryPool)
+        {
+            m_Context.device.destroyQueryPool(m_PipelineStatisticsQueryPool);
+            m_PipelineStatisticsQueryPool = vk::QueryPool();
+        }
+
         if (m_Context.pipelineCache)
         {
             m_Context.device.destroyPipelineCache(m_Context.pipelineCache);
@@ -223,6 +382,64 @@ namespace nvrhi::vulkan
         }
     }
 
+    CommandSignatureHandle Device::createCommandSignature(const CommandSignatureDesc&)
+    {
+        // Command signatures are DX12-only, see Feature::CommandSignatures
+        m_Context.error("createCommandSignature: Command signatures are not supported by the Vulkan backend "
+            "(Feature::CommandSignatures)");
+        return nullptr;
+    }
+
+    bool Device::exportPipelineCache(std::vector<uint8_t>& outData)
+    {
+        const vk::PipelineCache pipelineCache = m_Context.getPipelineCache();
+        if (!pipelineCache)
+            return false;
+
+        std::vector<uint8_t> cacheData = m_Context.device.getPipelineCacheData(pipelineCache);
+
+        writePipelineCacheBlob(GraphicsAPI::VULKAN, m_Context.physicalDeviceProperties.pipelineCacheUUID.data(),
+            cacheData.data(), cacheData.size(), outData);
+
+        return true;
+    }
+
+    bool Device::importPipelineCache(const void* data, size_t dataSize)
+    {
+        const vk::PipelineCache pipelineCache = m_Context.getPipelineCache();
+        if (!pipelineCache)
+            return false;
+
+        // The implementation is supposed to validate the data too, but not every driver handles
+        // foreign caches gracefully, so check the pipelineCacheUUID before passing the data on
+        const void* cacheData = nullptr;
+        size_t cacheDataSize = 0;
+        if (!readPipelineCacheBlob(GraphicsAPI::VULKAN, m_Context.physicalDeviceProperties.pipelineCacheUUID.data(),
+            data, dataSize, &cacheData, &cacheDataSize))
+        {
+            m_Context.warning("The pipeline cache data is not compatible with this device or driver, ignoring it");
+            return false;
+        }
+
+        auto cacheInfo = vk::PipelineCacheCreateInfo()
+            .setInitialDataSize(cacheDataSize)
+            .setPInitialData(cacheData);
+
+        vk::PipelineCache importedCache;
+        vk::Result res = m_Context.device.createPipelineCache(&cacheInfo, m_Context.allocationCallbacks, &importedCache);
+        if (res != vk::Result::eSuccess)
+        {
+            m_Context.warning("Failed to create a pipeline cache from the imported data");
+            return false;
+        }
+
+        // Merge instead of replacing the cache so that pipelines created before the import stay cached
+        res = m_Context.device.mergePipelineCaches(pipelineCache, 1, &importedCache);
+        m_Context.device.destroyPipelineCache(importedCache, m_Context.allocationCallbacks);
+
+        return res == vk::Result::eSuccess;
+    }
+
     Object Device::getNativeObject(ObjectType objectType)
     {
         switch (objectType)
@@ -247,20 +464,177 @@ namespace nvrhi::vulkan
 
     void Device::waitForIdle()
     {
+        flushSubmissions();
+
         m_Context.device.waitIdle();
     }
 
+    void Device::setDeferredSubmission(bool enable)
+    {
+        m_DeferredSubmission = enable;
+
+        if (!enable)
+            flushSubmissions();
+    }
+
+    bool Device::waitForSubmissions(const CommandQueue* queues, const uint64_t* instances, size_t numSubmissions, bool waitAll, uint64_t timeoutNanoseconds)
+    {
+        std::vector<vk::Semaphore> semaphores;
+        std::vector<uint64_t> values;
+
+        for (size_t i = 0; i < numSubmissions; i++)
+        {
+            Queue* queue = getQueue(queues[i]);
+            if (!queue || instances[i] > queue->getLastSubmittedID())
+            {
+                m_Context.error("waitForSubmissions: the instance has not been submitted to the queue");
+                return false;
+            }
+
+            if (instances[i] == 0)
+            {
+                if (!waitAll)
+                    return true;
+
+                continue;
+            }
+
+            if (instances[i] > queue->getLastFlushedID())
+                queue->flush();
+
+            semaphores.push_back(queue->trackingSemaphore);
+            values.push_back(instances[i]);
+        }
+
+        if (semaphores.empty())
+            return true;
+
+        auto waitInfo = vk::SemaphoreWaitInfo()
+            .setFlags(waitAll ? vk::SemaphoreWaitFlags() : vk::SemaphoreWaitFlagBits::eAny)
+            .setSemaphores(semaphores)
+            .setValues(values);
+
+        const vk::Result result = m_Context.device.waitSemaphores(waitInfo, timeoutNanoseconds);
+
+        return result == vk::Result::eSuccess;
+    }
+
+    void Device::flushSubmissions()
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "flushSubmissions", "Submission");
+
+        for (const auto& queue : m_Queues)
+        {
+            if (queue)
+                queue->flush();
+        }
+    }
+
     void Device::runGarbageCollection()
     {
-        for (auto& m_Queue : m_Queues)
+        TraceScope traceScope(m_Context.traceRecorder.get(), "runGarbageCollection", "GarbageCollection");
+
+        retireCommandBuffers(std::chrono::steady_clock::time_point::max());
+        m_ObjectCache.collectGarbage();
+        pollMemoryBudget();
+    }
+
+    bool Device::runGarbageCollection(uint32_t maxMicroseconds)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "runGarbageCollection", "GarbageCollection");
+
+        const bool finished = retireCommandBuffers(std::chrono::steady_clock::now() + std::chrono::microseconds(maxMicroseconds));
+        if (finished)
+            m_ObjectCache.collectGarbage();
+        pollMemoryBudget();
+        return finished;
+    }
+
+    bool Device::retireCommandBuffers(std::chrono::steady_clock::time_point deadline)
+    {
+        // Every queue retires at least one command buffer per call, so that one busy queue can't starve the others
+        bool finished = true;
+        for (const auto& queue : m_Queues)
+        {
+            if (queue && !queue->retireCommandBuffers(deadline))
+                finished = false;
+        }
+
+        return finished;
+    }
+
+    void Device::pollMemoryBudget()
+    {
+        // There is no budget change notification in Vulkan, so compare the budgets with the last reported ones
+        if (m_MemoryBudgetCallback && m_Context.extensions.EXT_memory_budget)
         {
-            if (m_Queue)
+            MemoryStatistics statistics = getMemoryStatistics();
+
+            bool changed = statistics.heaps.size() != m_LastMemoryBudgets.size();
+            for (size_t heapIndex = 0; !changed && heapIndex < statistics.heaps.size(); ++heapIndex)
+                changed = statistics.heaps[heapIndex].budget != m_LastMemoryBudgets[heapIndex];
+
+            if (changed)
             {
-                m_Queue->retireCommandBuffers();
+                m_LastMemoryBudgets.clear();
+                for (const MemoryHeapStatistics& heap : statistics.heaps)
+                    m_LastMemoryBudgets.push_back(heap.budget);
+
+                m_MemoryBudgetCallback->memoryBudgetChanged(statistics);
             }
         }
     }
 
+    CommandListStatistics Device::getCommandListStatistics(bool reset)
+    {
+        std::lock_guard lockGuard(m_CommandListStatisticsMutex);
+
+        CommandListStatistics statistics = m_CommandListStatistics;
+        if (reset)
+            m_CommandListStatistics = CommandListStatistics();
+
+        return statistics;
+    }
+
+    MemoryStatistics Device::getMemoryStatistics()
+    {
+        MemoryStatistics statistics;
+
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties;
+        vk::PhysicalDeviceMemoryProperties2 memoryProperties;
+        if (m_Context.extensions.EXT_memory_budget)
+            memoryProperties.pNext = &budgetProperties;
+
+        m_Context.physicalDevice.getMemoryProperties2(&memoryProperties);
+
+        const vk::PhysicalDeviceMemoryProperties& properties = memoryProperties.memoryProperties;
+        for (uint32_t heapIndex = 0; heapIndex < properties.memoryHeapCount; ++heapIndex)
+        {
+            MemoryHeapStatistics& heap = statistics.heaps.emplace_back();
+            heap.deviceLocal = (properties.memoryHeaps[heapIndex].flags & vk::MemoryHeapFlagBits::eDeviceLocal) != vk::MemoryHeapFlags();
+            heap.size = properties.memoryHeaps[heapIndex].size;
+
+            if (m_Context.extensions.EXT_memory_budget)
+            {
+                heap.usage = budgetProperties.heapUsage[heapIndex];
+                heap.budget = budgetProperties.heapBudget[heapIndex];
+            }
+        }
+
+        statistics.budgetAvailable = m_Context.extensions.EXT_memory_budget;
+        statistics.uploadBufferBytes = m_Context.memoryCounters->uploadBufferBytes;
+        statistics.scratchBufferBytes = m_Context.memoryCounters->scratchBufferBytes;
+        statistics.compactionSavedBytes = m_Context.memoryCounters->compactionSavedBytes;
+
+        return statistics;
+    }
+
+    void Device::setMemoryBudgetCallback(IMemoryBudgetCallback* callback)
+    {
+        m_MemoryBudgetCallback = callback;
+        m_LastMemoryBudgets.clear();
+    }
+
     bool Device::queryFeatureSupport(Feature feature, void* pInfo, size_t infoSize)
     {
         switch (feature)  // NOLINT(clang-diagnostic-switch-enum)
@@ -290,7 +664,7 @@ namespace nvrhi::vulkan
         case Feature::ShaderSpecializations:
             return true;
         case Feature::Meshlets:
-            return m_Context.extensions.NV_mesh_shader;
+            return m_Context.extensions.EXT_mesh_shader || m_Context.extensions.NV_mesh_shader;
         case Feature::VariableRateShading:
             if (pInfo)
             {
@@ -314,6 +688,39 @@ namespace nvrhi::vulkan
             return (m_Queues[uint32_t(CommandQueue::Copy)] != nullptr);
         case Feature::ConstantBufferRanges:
             return true;
+        case Feature::CommandListBundles:
+            return true;
+        case Feature::SplitBarriers:
+            return m_Context.extensions.KHR_synchronization2;
+        case Feature::DrawIndirectCount:
+            return m_Context.extensions.KHR_draw_indirect_count;
+        case Feature::PipelineStatisticsQueries:
+            return m_PipelineStatisticsQuerySupported;
+        case Feature::Predication:
+            return m_Context.extensions.EXT_conditional_rendering;
+        case Feature::TiledResources:
+            return m_SparseResidencySupported;
+        case Feature::RayTracingPipelineLibraries:
+            return m_Context.extensions.KHR_ray_tracing_pipeline && m_Context.extensions.KHR_pipeline_library;
+        case Feature::MultiGPU:
+            if (pInfo)
+            {
+                if (infoSize == sizeof(MultiGPUFeatureInfo))
+                {
+                    auto* pMultiGPUInfo = reinterpret_cast<MultiGPUFeatureInfo*>(pInfo);
+                    pMultiGPUInfo->numNodes = m_Context.deviceGroupSize;
+                }
+                else
+                    utils::NotSupported();
+            }
+            return m_Context.deviceGroupSize > 1;
+        case Feature::ExtendedDynamicState:
+            return m_Context.extensions.EXT_extended_dynamic_state;
+        case Feature::DeviceLocalCpuWrite:
+            return m_Context.deviceLocalHostVisibleMemory;
+        case Feature::CommandSignatures:
+            // Command signatures are DX12-only, VK_EXT_device_generated_commands is not used
+            return false;
         default:
             return false;
         }
@@ -399,15 +806,71 @@ namespace nvrhi::vulkan
     
     uint64_t Device::executeCommandLists(ICommandList* const* pCommandLists, size_t numCommandLists, CommandQueue executionQueue)
     {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "executeCommandLists", "Submission");
+        traceScope.setArg("commandLists", numCommandLists);
+
         Queue& queue = *m_Queues[uint32_t(executionQueue)];
 
+        // The per-resource queue usage is read and updated under the lock, so that concurrent submissions see each other
+        std::unique_lock queueSyncLock(m_QueueSyncMutex, std::defer_lock);
+        const bool queueSync = m_AutomaticQueueSync || m_AccelStructQueueSync;
+        const bool accelStructsOnly = !m_AutomaticQueueSync;
+        if (queueSync)
+        {
+            queueSyncLock.lock();
+
+            uint64_t waitInstances[uint32_t(CommandQueue::Count)] = {};
+            for (size_t i = 0; i < numCommandLists; i++)
+            {
+                checked_cast<CommandList*>(pCommandLists[i])->getStateTracker().collectQueueDependencies(executionQueue, waitInstances, accelStructsOnly);
+            }
+
+            m_QueueSynchronizer.filterWaits(executionQueue, waitInstances);
+
+            // The other queues are flushed up to the waited submissions when this queue is flushed, see Queue::flush
+            for (uint32_t queueIndex = 0; queueIndex < uint32_t(CommandQueue::Count); queueIndex++)
+            {
+                if (waitInstances[queueIndex] != 0)
+                    queue.addWaitSemaphore(getQueueSemaphore(CommandQueue(queueIndex)), waitInstances[queueIndex], m_Queues[queueIndex].get());
+            }
+        }
+
         uint64_t submissionID = queue.submit(pCommandLists, numCommandLists);
 
+        if (queueSync)
+        {
+            for (size_t i = 0; i < numCommandLists; i++)
+            {
+                checked_cast<CommandList*>(pCommandLists[i])->getStateTracker().recordQueueUsage(executionQueue, submissionID, accelStructsOnly);
+            }
+
+            queueSyncLock.unlock();
+        }
+
+        CommandListStatistics executedStatistics;
+        bool anyStatistics = false;
+
         for (size_t i = 0; i < numCommandLists; i++)
         {
-            checked_cast<CommandList*>(pCommandLists[i])->executed(queue, submissionID);
+            CommandList* commandList = checked_cast<CommandList*>(pCommandLists[i]);
+            if (commandList->getDesc().enableStatistics)
+            {
+                executedStatistics += commandList->getStatistics();
+                anyStatistics = true;
+            }
+
+            commandList->executed(queue, submissionID);
         }
 
+        if (anyStatistics)
+        {
+            std::lock_guard lockGuard(m_CommandListStatisticsMutex);
+            m_CommandListStatistics += executedStatistics;
+        }
+
+        if (!m_DeferredSubmission)
+            queue.flush();
+
         return submissionID;
     }
 
@@ -486,6 +949,25 @@ namespace nvrhi::vulkan
         }
     }
 
+    vk::PipelineCache VulkanContext::getPipelineCache() const
+    {
+        std::lock_guard lockGuard(pipelineCacheMutex);
+
+        if (!pipelineCache)
+        {
+            auto pipelineInfo = vk::PipelineCacheCreateInfo();
+            const vk::Result res = device.createPipelineCache(&pipelineInfo, allocationCallbacks, &pipelineCache);
+
+            if (res != vk::Result::eSuccess)
+            {
+                error("Failed to create the pipeline cache");
+                pipelineCache = vk::PipelineCache();
+            }
+        }
+
+        return pipelineCache;
+    }
+
     void VulkanContext::error(const std::string& message) const
     {
         messageCallback->message(MessageSeverity::Error, message.c_str());
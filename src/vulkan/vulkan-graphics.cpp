@@ -62,6 +62,17 @@ namespace nvrhi::vulkan
         Framebuffer *fb = new Framebuffer(m_Context);
         fb->desc = desc;
         fb->framebufferInfo = FramebufferInfoEx(desc);
+        fb->dynamicRendering = m_Context.extensions.KHR_dynamic_rendering;
+
+        for (Format format : fb->framebufferInfo.colorFormats)
+            fb->colorFormats.push_back(vk::Format(convertFormat(format)));
+
+        if (fb->framebufferInfo.depthFormat != Format::UNKNOWN)
+        {
+            fb->depthFormat = vk::Format(convertFormat(fb->framebufferInfo.depthFormat));
+            if (getFormatInfo(fb->framebufferInfo.depthFormat).hasStencil)
+                fb->stencilFormat = fb->depthFormat;
+        }
 
         attachment_vector<vk::AttachmentDescription2> attachmentDescs(desc.colorAttachments.size());
         attachment_vector<vk::AttachmentReference2> colorAttachmentRefs(desc.colorAttachments.size());
@@ -86,7 +97,7 @@ namespace nvrhi::vulkan
                                         .setFormat(attachmentFormat)
                                         .setSamples(t->imageInfo.samples)
                                         .setLoadOp(vk::AttachmentLoadOp::eLoad)
-                                        .setStoreOp(vk::AttachmentStoreOp::eStore)
+                                        .setStoreOp(rt.discardAfterPass ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore)
                                         .setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
                                         .setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
@@ -100,6 +111,7 @@ namespace nvrhi::vulkan
 
             const auto& view = t->getSubresourceView(subresources, dimension, rt.format, vk::ImageUsageFlagBits::eColorAttachment);
             attachmentViews[i] = view.view;
+            fb->colorViews.push_back(view.view);
 
             fb->resources.push_back(rt.texture);
 
@@ -129,7 +141,8 @@ namespace nvrhi::vulkan
                                         .setFormat(texture->imageInfo.format)
                                         .setSamples(texture->imageInfo.samples)
                                         .setLoadOp(vk::AttachmentLoadOp::eLoad)
-                                        .setStoreOp(vk::AttachmentStoreOp::eStore)
+                                        .setStoreOp(att.discardAfterPass ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore)
+                                        .setStencilStoreOp(att.discardAfterPass ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore)
                                         .setInitialLayout(depthLayout)
                                         .setFinalLayout(depthLayout));
 
@@ -143,6 +156,9 @@ namespace nvrhi::vulkan
 
             const auto& view = texture->getSubresourceView(subresources, dimension, att.format, vk::ImageUsageFlagBits::eDepthStencilAttachment);
             attachmentViews.push_back(view.view);
+            fb->depthView = view.view;
+            fb->depthLayout = depthLayout;
+            fb->depthHasStencil = fb->stencilFormat != vk::Format::eUndefined;
 
             fb->resources.push_back(att.texture);
 
@@ -184,6 +200,7 @@ namespace nvrhi::vulkan
 
             const auto& view = vrsTexture->getSubresourceView(subresources, dimension, vrsAttachment.format, vk::ImageUsageFlagBits::eFragmentShadingRateAttachmentKHR);
             attachmentViews.push_back(view.view);
+            fb->shadingRateView = view.view;
 
             fb->resources.push_back(vrsAttachment.texture);
 
@@ -206,8 +223,15 @@ namespace nvrhi::vulkan
                 .setShadingRateAttachmentTexelSize(rateProps.minFragmentShadingRateAttachmentTexelSize);
 
             subpass.setPNext(&shadingRateAttachmentInfo);
+            fb->shadingRateTexelSize = rateProps.minFragmentShadingRateAttachmentTexelSize;
         }
 
+        fb->numArraySlices = std::max(numArraySlices, 1u);
+
+        // With dynamic rendering, the views are all that the command lists need
+        if (fb->dynamicRendering)
+            return FramebufferHandle::Create(fb);
+
         auto renderPassInfo = vk::RenderPassCreateInfo2()
                     .setAttachmentCount(uint32_t(attachmentDescs.size()))
                     .setPAttachments(attachmentDescs.data())
@@ -354,14 +378,47 @@ namespace nvrhi::vulkan
         return shaderStageCreateInfo;
     }
 
-    GraphicsPipelineHandle Device::createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* _fb)
+    // Resets the fields that come from DynamicRenderState, so that pipelines which only differ in those fields
+    // produce identical create infos and can share the driver's pipeline cache entries
+    static RenderState getStaticRenderState(const RenderState& renderState)
+    {
+        RenderState result = renderState;
+        const DynamicRenderState defaults;
+        result.rasterState.cullMode = defaults.cullMode;
+        result.rasterState.frontCounterClockwise = defaults.frontCounterClockwise;
+        result.depthStencilState.depthTestEnable = defaults.depthTestEnable;
+        result.depthStencilState.depthWriteEnable = defaults.depthWriteEnable;
+        result.depthStencilState.depthFunc = defaults.depthFunc;
+        result.depthStencilState.stencilEnable = defaults.stencilEnable;
+        result.depthStencilState.frontFaceStencil = defaults.frontFaceStencil;
+        result.depthStencilState.backFaceStencil = defaults.backFaceStencil;
+        return result;
+    }
+
+    GraphicsPipelineHandle Device::createGraphicsPipeline(const GraphicsPipelineDesc& desc, IFramebuffer* fb)
     {
+        return m_ObjectCache.getGraphicsPipeline(desc, fb, [this, &desc, fb] { return createGraphicsPipelineInternal(desc, fb); });
+    }
+
+    GraphicsPipelineHandle Device::createGraphicsPipelineInternal(const GraphicsPipelineDesc& desc, IFramebuffer* _fb)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createGraphicsPipeline", "Pipeline");
+
         if (desc.renderState.singlePassStereo.enabled)
         {
             m_Context.error("Single-pass stereo is not supported by the Vulkan backend");
             return nullptr;
         }
 
+        if (desc.renderState.extendedDynamicState && !m_Context.extensions.EXT_extended_dynamic_state)
+        {
+            m_Context.error("Extended dynamic state is not supported by this device");
+            return nullptr;
+        }
+
+        if (!validatePushDescriptorLayouts(desc.bindingLayouts, "createGraphicsPipeline"))
+            return nullptr;
+
         vk::Result res;
 
         Framebuffer* fb = checked_cast<Framebuffer*>(_fb);
@@ -458,9 +515,12 @@ namespace nvrhi::vulkan
                                 .setTopology(convertPrimitiveTopology(desc.primType));
 
         // fixed function state
-        const auto& rasterState = desc.renderState.rasterState;
-        const auto& depthStencilState = desc.renderState.depthStencilState;
-        const auto& blendState = desc.renderState.blendState;
+        const RenderState renderState = desc.renderState.extendedDynamicState
+            ? getStaticRenderState(desc.renderState)
+            : desc.renderState;
+        const auto& rasterState = renderState.rasterState;
+        const auto& depthStencilState = renderState.depthStencilState;
+        const auto& blendState = renderState.blendState;
 
         auto viewportState = vk::PipelineViewportStateCreateInfo()
             .setViewportCount(1)
@@ -557,7 +617,7 @@ namespace nvrhi::vulkan
 
         pso->usesBlendConstants = blendState.usesConstantColor(uint32_t(fb->desc.colorAttachments.size()));
 
-        static_vector<vk::DynamicState, 5> dynamicStates = {
+        static_vector<vk::DynamicState, 13> dynamicStates = {
             vk::DynamicState::eViewport,
             vk::DynamicState::eScissor
         };
@@ -567,6 +627,17 @@ namespace nvrhi::vulkan
             dynamicStates.push_back(vk::DynamicState::eStencilReference);
         if (pso->desc.shadingRateState.enabled)
             dynamicStates.push_back(vk::DynamicState::eFragmentShadingRateKHR);
+        if (pso->desc.renderState.extendedDynamicState)
+        {
+            dynamicStates.push_back(vk::DynamicState::ePrimitiveTopology);
+            dynamicStates.push_back(vk::DynamicState::eCullMode);
+            dynamicStates.push_back(vk::DynamicState::eFrontFace);
+            dynamicStates.push_back(vk::DynamicState::eDepthTestEnable);
+            dynamicStates.push_back(vk::DynamicState::eDepthWriteEnable);
+            dynamicStates.push_back(vk::DynamicState::eDepthCompareOp);
+            dynamicStates.push_back(vk::DynamicState::eStencilTestEnable);
+            dynamicStates.push_back(vk::DynamicState::eStencilOp);
+        }
 
         auto dynamicStateInfo = vk::PipelineDynamicStateCreateInfo()
             .setDynamicStateCount(uint32_t(dynamicStates.size()))
@@ -593,6 +664,26 @@ namespace nvrhi::vulkan
         if (pso->desc.shadingRateState.enabled)
             pipelineInfo.setPNext(&shadingRateState);
 
+        // Pipelines must be created for the binding model the device uses
+        if (m_Context.descriptorBuffer)
+            pipelineInfo.flags |= vk::PipelineCreateFlagBits::eDescriptorBufferEXT;
+
+        // With dynamic rendering, fb->renderPass is null and the attachment formats are provided instead
+        auto renderingInfo = vk::PipelineRenderingCreateInfo()
+            .setColorAttachmentCount(uint32_t(fb->colorFormats.size()))
+            .setPColorAttachmentFormats(fb->colorFormats.data())
+            .setDepthAttachmentFormat(fb->depthFormat)
+            .setStencilAttachmentFormat(fb->stencilFormat);
+
+        if (fb->dynamicRendering)
+        {
+            renderingInfo.setPNext(pipelineInfo.pNext);
+            pipelineInfo.setPNext(&renderingInfo);
+
+            if (fb->shadingRateView)
+                pipelineInfo.flags |= vk::PipelineCreateFlagBits::eRenderingFragmentShadingRateAttachmentKHR;
+        }
+
         auto tessellationState = vk::PipelineTessellationStateCreateInfo();
 
         if (desc.primType == PrimitiveType::PatchList)
@@ -601,7 +692,7 @@ namespace nvrhi::vulkan
             pipelineInfo.setPTessellationState(&tessellationState);
         }
 
-        res = m_Context.device.createGraphicsPipelines(m_Context.pipelineCache,
+        res = m_Context.device.createGraphicsPipelines(m_Context.getPipelineCache(),
                                                      1, &pipelineInfo,
                                                      m_Context.allocationCallbacks,
                                                      &pso->pipeline);
@@ -639,14 +730,193 @@ namespace nvrhi::vulkan
         }
     }
 
+    static void setDynamicRenderState(vk::CommandBuffer cmdBuf, const DynamicRenderState& state)
+    {
+        cmdBuf.setPrimitiveTopology(convertPrimitiveTopology(state.primType));
+        cmdBuf.setCullMode(convertCullMode(state.cullMode));
+        cmdBuf.setFrontFace(state.frontCounterClockwise ? vk::FrontFace::eCounterClockwise : vk::FrontFace::eClockwise);
+        cmdBuf.setDepthTestEnable(state.depthTestEnable);
+        cmdBuf.setDepthWriteEnable(state.depthWriteEnable);
+        cmdBuf.setDepthCompareOp(convertCompareOp(state.depthFunc));
+        cmdBuf.setStencilTestEnable(state.stencilEnable);
+
+        const DepthStencilState::StencilOpDesc& front = state.frontFaceStencil;
+        const DepthStencilState::StencilOpDesc& back = state.backFaceStencil;
+        cmdBuf.setStencilOp(vk::StencilFaceFlagBits::eFront, convertStencilOp(front.failOp), convertStencilOp(front.passOp),
+            convertStencilOp(front.depthFailOp), convertCompareOp(front.stencilFunc));
+        cmdBuf.setStencilOp(vk::StencilFaceFlagBits::eBack, convertStencilOp(back.failOp), convertStencilOp(back.passOp),
+            convertStencilOp(back.depthFailOp), convertCompareOp(back.stencilFunc));
+    }
+
+    void CommandList::prepareRenderPassClears(Framebuffer* fb)
+    {
+        m_RenderPassClears.clear();
+
+        if (m_DeferredClears.empty())
+            return;
+
+        // Take over the clears of the exact subresources of the attachments, and execute the others
+        // right away, before the states of the attachments are set for the render pass
+        size_t numRemaining = 0;
+        for (const DeferredClear& clear : m_DeferredClears)
+        {
+            uint32_t attachment = ~0u;
+
+            for (uint32_t index = 0; index < fb->desc.colorAttachments.size(); index++)
+            {
+                const FramebufferAttachment& rt = fb->desc.colorAttachments[index];
+                if (rt.texture == clear.texture && rt.subresources.resolve(clear.texture->desc, true) == clear.subresources)
+                    attachment = index;
+            }
+
+            const FramebufferAttachment& depth = fb->desc.depthAttachment;
+            if (depth.texture == clear.texture && !depth.isReadOnly && depth.subresources.resolve(clear.texture->desc, true) == clear.subresources)
+                attachment = c_MaxRenderTargets;
+
+            if (attachment != ~0u)
+            {
+                m_RenderPassClears.push_back(clear);
+                m_RenderPassClears.back().attachment = attachment;
+            }
+            else
+                m_DeferredClears[numRemaining++] = clear;
+        }
+        m_DeferredClears.resize(numRemaining);
+
+        if (!m_DeferredClears.empty())
+            executeDeferredClears();
+    }
+
+    void CommandList::beginRenderPass(Framebuffer* fb, bool secondaryCommandBuffers)
+    {
+        const vk::Rect2D renderArea = vk::Rect2D()
+            .setOffset(vk::Offset2D(0, 0))
+            .setExtent(vk::Extent2D(fb->framebufferInfo.width, fb->framebufferInfo.height));
+
+        if (!fb->dynamicRendering)
+        {
+            m_CurrentCmdBuf->cmdBuf.beginRenderPass(vk::RenderPassBeginInfo()
+                .setRenderPass(fb->renderPass)
+                .setFramebuffer(fb->framebuffer)
+                .setRenderArea(renderArea)
+                .setClearValueCount(0),
+                secondaryCommandBuffers ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+
+            if (!m_RenderPassClears.empty())
+            {
+                // The load operations are baked into the render pass object, so clear the attachments
+                // at the start of the pass instead, which tilers handle the same way
+                static_vector<vk::ClearAttachment, c_MaxRenderTargets + 1> clearAttachments;
+                for (const DeferredClear& clear : m_RenderPassClears)
+                {
+                    clearAttachments.push_back(vk::ClearAttachment()
+                        .setAspectMask(clear.aspects)
+                        .setColorAttachment(clear.attachment == c_MaxRenderTargets ? 0 : clear.attachment)
+                        .setClearValue(clear.value));
+                }
+
+                const auto clearRect = vk::ClearRect()
+                    .setRect(renderArea)
+                    .setBaseArrayLayer(0)
+                    .setLayerCount(fb->numArraySlices);
+
+                m_CurrentCmdBuf->cmdBuf.clearAttachments(uint32_t(clearAttachments.size()), clearAttachments.data(), 1, &clearRect);
+                m_RenderPassClears.clear();
+            }
+            return;
+        }
+
+        static_vector<vk::RenderingAttachmentInfo, c_MaxRenderTargets> colorAttachments;
+        for (uint32_t index = 0; index < fb->colorViews.size(); index++)
+        {
+            colorAttachments.push_back(vk::RenderingAttachmentInfo()
+                .setImageView(fb->colorViews[index])
+                .setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                .setLoadOp(vk::AttachmentLoadOp::eLoad)
+                .setStoreOp(fb->desc.colorAttachments[index].discardAfterPass ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore));
+        }
+
+        const vk::AttachmentStoreOp depthStoreOp = fb->desc.depthAttachment.discardAfterPass
+            ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore;
+
+        auto depthAttachment = vk::RenderingAttachmentInfo()
+            .setImageView(fb->depthView)
+            .setImageLayout(fb->depthLayout)
+            .setLoadOp(vk::AttachmentLoadOp::eLoad)
+            .setStoreOp(depthStoreOp);
+
+        auto stencilAttachment = depthAttachment;
+
+        for (const DeferredClear& clear : m_RenderPassClears)
+        {
+            if (clear.attachment < colorAttachments.size())
+            {
+                colorAttachments[clear.attachment]
+                    .setLoadOp(vk::AttachmentLoadOp::eClear)
+                    .setClearValue(clear.value);
+            }
+            else if (clear.attachment == c_MaxRenderTargets)
+            {
+                if (clear.aspects & vk::ImageAspectFlagBits::eDepth)
+                    depthAttachment.setLoadOp(vk::AttachmentLoadOp::eClear).setClearValue(clear.value);
+                if (clear.aspects & vk::ImageAspectFlagBits::eStencil)
+                    stencilAttachment.setLoadOp(vk::AttachmentLoadOp::eClear).setClearValue(clear.value);
+            }
+        }
+        m_RenderPassClears.clear();
+
+        auto renderingInfo = vk::RenderingInfo()
+            .setRenderArea(renderArea)
+            .setLayerCount(fb->numArraySlices)
+            .setColorAttachmentCount(uint32_t(colorAttachments.size()))
+            .setPColorAttachments(colorAttachments.data())
+            .setPDepthAttachment(fb->depthView ? &depthAttachment : nullptr)
+            .setPStencilAttachment(fb->depthHasStencil ? &stencilAttachment : nullptr);
+
+        if (secondaryCommandBuffers)
+            renderingInfo.setFlags(vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+
+        const auto shadingRateAttachment = vk::RenderingFragmentShadingRateAttachmentInfoKHR()
+            .setImageView(fb->shadingRateView)
+            .setImageLayout(vk::ImageLayout::eFragmentShadingRateAttachmentOptimalKHR)
+            .setShadingRateAttachmentTexelSize(fb->shadingRateTexelSize);
+
+        if (fb->shadingRateView)
+            renderingInfo.setPNext(&shadingRateAttachment);
+
+        m_CurrentCmdBuf->cmdBuf.beginRendering(renderingInfo);
+    }
+
     void CommandList::endRenderPass()
     {
-        if (m_CurrentGraphicsState.framebuffer || m_CurrentMeshletState.framebuffer)
+        if (isInsideRenderPass())
         {
-            m_CurrentCmdBuf->cmdBuf.endRenderPass();
+            if (m_RenderPassQueries != 0)
+            {
+                m_Context.error("Occlusion or pipeline statistics queries begun inside a render pass must be ended "
+                    "before the render pass ends, i.e. before the framebuffer changes or a non-draw command is recorded");
+                m_RenderPassQueries = 0;
+            }
+
+            // Bundles are recorded inside a render pass that is begun and ended by the executing command list
+            if (!m_CommandListParameters.isBundle)
+            {
+                Framebuffer* fb = checked_cast<Framebuffer*>(m_CurrentGraphicsState.framebuffer
+                    ? m_CurrentGraphicsState.framebuffer : m_CurrentMeshletState.framebuffer);
+
+                if (fb->dynamicRendering)
+                    m_CurrentCmdBuf->cmdBuf.endRendering();
+                else
+                    m_CurrentCmdBuf->cmdBuf.endRenderPass();
+            }
+
             m_CurrentGraphicsState.framebuffer = nullptr;
             m_CurrentMeshletState.framebuffer = nullptr;
         }
+
+        // Deferred clears that were not taken over by a render pass happen before the command that ends the pass
+        if (!m_DeferredClears.empty())
+            executeDeferredClears();
     }
 
     static vk::Viewport VKViewportWithDXCoords(const Viewport& v)
@@ -655,21 +925,120 @@ namespace nvrhi::vulkan
         return vk::Viewport(v.minX, v.maxY, v.maxX - v.minX, -(v.maxY - v.minY), v.minZ, v.maxZ);
     }
 
+    GraphicsStateBlockHandle Device::createGraphicsStateBlock(const GraphicsState& state)
+    {
+        if (!state.pipeline || !state.framebuffer)
+        {
+            m_Context.error("createGraphicsStateBlock: pipeline or framebuffer is NULL");
+            return nullptr;
+        }
+
+        GraphicsStateBlock* block = new GraphicsStateBlock(state);
+
+        if (state.indexBuffer.buffer)
+        {
+            block->indexBuffer = checked_cast<Buffer*>(state.indexBuffer.buffer)->buffer;
+            block->indexType = state.indexBuffer.format == Format::R16_UINT ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+        }
+
+        for (const VertexBufferBinding& binding : state.vertexBuffers)
+        {
+            if (!binding.buffer || binding.slot >= c_MaxVertexAttributes)
+                continue;
+
+            block->vertexBuffers[binding.slot] = checked_cast<Buffer*>(binding.buffer)->buffer;
+            block->vertexBufferOffsets[binding.slot] = vk::DeviceSize(binding.offset);
+            block->maxVertexBufferSlot = std::max(block->maxVertexBufferSlot, binding.slot);
+        }
+
+        for (const auto& vp : state.viewport.viewports)
+        {
+            block->viewports.push_back(VKViewportWithDXCoords(vp));
+        }
+
+        for (const auto& sc : state.viewport.scissorRects)
+        {
+            block->scissorRects.push_back(vk::Rect2D(vk::Offset2D(sc.minX, sc.minY),
+                vk::Extent2D(std::abs(sc.maxX - sc.minX), std::abs(sc.maxY - sc.minY))));
+        }
+
+        return GraphicsStateBlockHandle::Create(block);
+    }
+
+    void CommandList::setGraphicsStateBlock(IGraphicsStateBlock* _block)
+    {
+        assert(m_CurrentCmdBuf);
+
+        GraphicsStateBlock* block = checked_cast<GraphicsStateBlock*>(_block);
+
+        // Any command that has to end the render pass, or setting a different state, resets the current framebuffer
+        if (block == m_CurrentGraphicsStateBlock && m_CurrentGraphicsState.framebuffer && m_PushBindings.empty() && !anyBarriers())
+        {
+            // Volatile buffer writes are handled by the draw calls
+            return;
+        }
+
+        if (!m_PushBindings.empty())
+        {
+            // The pushed bindings are applied on top of, or turn into new binding sets for, the baked state
+            setGraphicsState(block->state);
+            return;
+        }
+
+        setGraphicsStateInternal(block->state, block);
+        m_CurrentGraphicsStateBlock = block;
+        m_CurrentCmdBuf->referencedResources.push_back(block);
+    }
+
     void CommandList::setGraphicsState(const GraphicsState& state)
     {
         assert(m_CurrentCmdBuf);
 
+        if (!m_PushBindings.empty() && !usePushDescriptors() && state.pipeline)
+        {
+            // Without VK_KHR_push_descriptor, the pushed bindings become regular binding sets
+            GraphicsState resolvedState = state;
+            if (m_CommandListParameters.enableStatistics)
+                m_Statistics.numDescriptorsWritten += m_PushBindings.getNumBindings();
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, &m_CurrentCmdBuf->referencedResources))
+                setGraphicsStateInternal(resolvedState, nullptr);
+            m_PushBindings.clear();
+            return;
+        }
+
+        setGraphicsStateInternal(state, nullptr);
+    }
+
+    void CommandList::setGraphicsStateInternal(const GraphicsState& state, const GraphicsStateBlock* block)
+    {
         GraphicsPipeline* pso = checked_cast<GraphicsPipeline*>(state.pipeline);
         Framebuffer* fb = checked_cast<Framebuffer*>(state.framebuffer);
 
+        prepareRenderPassClears(fb);
+
         if (m_EnableAutomaticBarriers)
         {
             trackResourcesAndBarriers(state);
+            setResourceStatesForPushBindings();
         }
 
         bool anyBarriers = this->anyBarriers();
         bool updatePipeline = false;
 
+        if (m_CommandListParameters.enableStatistics)
+        {
+            countStateChanges(m_Statistics, {
+                m_CurrentGraphicsState.pipeline != state.pipeline,
+                m_CurrentGraphicsState.framebuffer != state.framebuffer,
+                arraysAreDifferent(m_CurrentComputeState.bindings, state.bindings) || m_AnyVolatileBufferWrites,
+                state.indexBuffer.buffer && m_CurrentGraphicsState.indexBuffer != state.indexBuffer,
+                !state.vertexBuffers.empty() && arraysAreDifferent(state.vertexBuffers, m_CurrentGraphicsState.vertexBuffers),
+                arraysAreDifferent(state.viewport.viewports, m_CurrentGraphicsState.viewport.viewports)
+                    || arraysAreDifferent(state.viewport.scissorRects, m_CurrentGraphicsState.viewport.scissorRects),
+                m_CurrentGraphicsState.blendConstantColor != state.blendConstantColor,
+                m_CurrentGraphicsState.dynamicStencilRefValue != state.dynamicStencilRefValue });
+        }
+
         if (m_CurrentGraphicsState.pipeline != state.pipeline)
         {
             m_CurrentCmdBuf->cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, pso->pipeline);
@@ -684,23 +1053,20 @@ namespace nvrhi::vulkan
         }
 
         auto desc = state.framebuffer->getDesc();
-        if (desc.shadingRateAttachment.valid())
+        if (desc.shadingRateAttachment.valid() && !m_CommandListParameters.isBundle)
         {
             setTextureState(desc.shadingRateAttachment.texture, nvrhi::TextureSubresourceSet(0, 1, 0, 1), nvrhi::ResourceStates::ShadingRateSurface);
         }
 
         commitBarriers();
 
-        if(!m_CurrentGraphicsState.framebuffer)
+        if (!m_CurrentGraphicsState.framebuffer && m_CommandListParameters.isBundle)
         {
-            m_CurrentCmdBuf->cmdBuf.beginRenderPass(vk::RenderPassBeginInfo()
-                .setRenderPass(fb->renderPass)
-                .setFramebuffer(fb->framebuffer)
-                .setRenderArea(vk::Rect2D()
-                    .setOffset(vk::Offset2D(0, 0))
-                    .setExtent(vk::Extent2D(fb->framebufferInfo.width, fb->framebufferInfo.height)))
-                .setClearValueCount(0),
-                vk::SubpassContents::eInline);
+            m_CurrentCmdBuf->referencedResources.push_back(state.framebuffer);
+        }
+        else if(!m_CurrentGraphicsState.framebuffer)
+        {
+            beginRenderPass(fb, false);
 
             m_CurrentCmdBuf->referencedResources.push_back(state.framebuffer);
         }
@@ -713,7 +1079,16 @@ namespace nvrhi::vulkan
             bindBindingSets(vk::PipelineBindPoint::eGraphics, pso->pipelineLayout, state.bindings);
         }
 
-        if (!state.viewport.viewports.empty() && arraysAreDifferent(state.viewport.viewports, m_CurrentGraphicsState.viewport.viewports))
+        if (!m_PushBindings.empty())
+        {
+            commitPushBindings(vk::PipelineBindPoint::eGraphics, pso->pipelineLayout, pso->desc.bindingLayouts);
+        }
+
+        if (!state.viewport.viewports.empty() && block && arraysAreDifferent(state.viewport.viewports, m_CurrentGraphicsState.viewport.viewports))
+        {
+            m_CurrentCmdBuf->cmdBuf.setViewport(0, uint32_t(block->viewports.size()), block->viewports.data());
+        }
+        else if (!state.viewport.viewports.empty() && arraysAreDifferent(state.viewport.viewports, m_CurrentGraphicsState.viewport.viewports))
         {
             nvrhi::static_vector<vk::Viewport, c_MaxViewports> viewports;
             for (const auto& vp : state.viewport.viewports)
@@ -724,7 +1099,11 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->cmdBuf.setViewport(0, uint32_t(viewports.size()), viewports.data());
         }
 
-        if (!state.viewport.scissorRects.empty() && arraysAreDifferent(state.viewport.scissorRects, m_CurrentGraphicsState.viewport.scissorRects))
+        if (!state.viewport.scissorRects.empty() && block && arraysAreDifferent(state.viewport.scissorRects, m_CurrentGraphicsState.viewport.scissorRects))
+        {
+            m_CurrentCmdBuf->cmdBuf.setScissor(0, uint32_t(block->scissorRects.size()), block->scissorRects.data());
+        }
+        else if (!state.viewport.scissorRects.empty() && arraysAreDifferent(state.viewport.scissorRects, m_CurrentGraphicsState.viewport.scissorRects))
         {
             nvrhi::static_vector<vk::Rect2D, c_MaxViewports> scissors;
             for (const auto& sc : state.viewport.scissorRects)
@@ -746,7 +1125,18 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->cmdBuf.setBlendConstants(&state.blendConstantColor.r);
         }
 
-        if (state.indexBuffer.buffer && m_CurrentGraphicsState.indexBuffer != state.indexBuffer)
+        if (pso->desc.renderState.extendedDynamicState && (updatePipeline || m_CurrentGraphicsState.dynamicRenderState != state.dynamicRenderState))
+        {
+            setDynamicRenderState(m_CurrentCmdBuf->cmdBuf, state.dynamicRenderState);
+        }
+
+        if (state.indexBuffer.buffer && m_CurrentGraphicsState.indexBuffer != state.indexBuffer && block)
+        {
+            m_CurrentCmdBuf->cmdBuf.bindIndexBuffer(block->indexBuffer, state.indexBuffer.offset, block->indexType);
+
+            m_CurrentCmdBuf->referencedResources.push_back(state.indexBuffer.buffer);
+        }
+        else if (state.indexBuffer.buffer && m_CurrentGraphicsState.indexBuffer != state.indexBuffer)
         {
             m_CurrentCmdBuf->cmdBuf.bindIndexBuffer(checked_cast<Buffer*>(state.indexBuffer.buffer)->buffer,
                 state.indexBuffer.offset,
@@ -756,7 +1146,16 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->referencedResources.push_back(state.indexBuffer.buffer);
         }
 
-        if (!state.vertexBuffers.empty() && arraysAreDifferent(state.vertexBuffers, m_CurrentGraphicsState.vertexBuffers))
+        if (!state.vertexBuffers.empty() && block && arraysAreDifferent(state.vertexBuffers, m_CurrentGraphicsState.vertexBuffers))
+        {
+            for (const auto& binding : state.vertexBuffers)
+            {
+                m_CurrentCmdBuf->referencedResources.push_back(binding.buffer);
+            }
+
+            m_CurrentCmdBuf->cmdBuf.bindVertexBuffers(0, block->maxVertexBufferSlot + 1, block->vertexBuffers, block->vertexBufferOffsets);
+        }
+        else if (!state.vertexBuffers.empty() && arraysAreDifferent(state.vertexBuffers, m_CurrentGraphicsState.vertexBuffers))
         {
             vk::Buffer vertexBuffers[c_MaxVertexAttributes];
             vk::DeviceSize vertexBufferOffsets[c_MaxVertexAttributes];
@@ -783,6 +1182,11 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->referencedResources.push_back(state.indirectParams);
         }
 
+        if (state.indirectCountBuffer)
+        {
+            m_CurrentCmdBuf->referencedResources.push_back(state.indirectCountBuffer);
+        }
+
         if (state.shadingRateState.enabled)
         {
             vk::FragmentShadingRateCombinerOpKHR combiners[2] = { convertShadingRateCombiner(state.shadingRateState.pipelinePrimitiveCombiner), convertShadingRateCombiner(state.shadingRateState.imageCombiner) };
@@ -791,6 +1195,7 @@ namespace nvrhi::vulkan
         }
 
         m_CurrentGraphicsState = state;
+        m_CurrentGraphicsStateBlock = nullptr;
         m_CurrentComputeState = ComputeState();
         m_CurrentMeshletState = MeshletState();
         m_CurrentRayTracingState = rt::State();
@@ -815,6 +1220,7 @@ namespace nvrhi::vulkan
 
         updateGraphicsVolatileBuffers();
 
+        countDraws(1);
         m_CurrentCmdBuf->cmdBuf.draw(args.vertexCount,
             args.instanceCount,
             args.startVertexLocation,
@@ -827,6 +1233,7 @@ namespace nvrhi::vulkan
 
         updateGraphicsVolatileBuffers();
 
+        countDraws(1);
         m_CurrentCmdBuf->cmdBuf.drawIndexed(args.vertexCount,
             args.instanceCount,
             args.startIndexLocation,
@@ -834,6 +1241,132 @@ namespace nvrhi::vulkan
             args.startInstanceLocation);
     }
 
+    void CommandList::drawMulti(const MultiDrawArguments& multiDraw)
+    {
+        drawMultiInternal(multiDraw, false);
+    }
+
+    void CommandList::drawIndexedMulti(const MultiDrawArguments& multiDraw)
+    {
+        drawMultiInternal(multiDraw, true);
+    }
+
+    void CommandList::drawMultiInternal(const MultiDrawArguments& multiDraw, bool indexed)
+    {
+        assert(m_CurrentCmdBuf);
+
+        countDraws(multiDraw.drawCount);
+
+        if (multiDraw.bindingSets)
+        {
+            if (m_EnableAutomaticBarriers)
+            {
+                for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+                {
+                    if (drawIndex == 0 || multiDraw.bindingSets[drawIndex] != multiDraw.bindingSets[drawIndex - 1])
+                        setResourceStatesForBindingSet(multiDraw.bindingSets[drawIndex]);
+                }
+
+                if (anyBarriers())
+                {
+                    // Barriers cannot be placed inside a render pass, so restart it with the same state
+                    GraphicsState state = m_CurrentGraphicsState;
+                    endRenderPass();
+                    setGraphicsStateInternal(state, nullptr);
+                }
+            }
+
+            // The bindings no longer match the block
+            m_CurrentGraphicsStateBlock = nullptr;
+        }
+
+        updateGraphicsVolatileBuffers();
+
+        if (m_Context.extensions.EXT_multi_draw && m_Context.multiDrawFeatures.multiDraw && !multiDraw.bindingSets && !multiDraw.pushConstants)
+        {
+            if (indexed)
+            {
+                m_MultiDrawIndexedInfos.resize(multiDraw.drawCount);
+                for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+                {
+                    const DrawArguments& args = multiDraw.args[drawIndex];
+                    m_MultiDrawIndexedInfos[drawIndex] = vk::MultiDrawIndexedInfoEXT(args.startIndexLocation, args.vertexCount, int32_t(args.startVertexLocation));
+                }
+            }
+            else
+            {
+                m_MultiDrawInfos.resize(multiDraw.drawCount);
+                for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+                {
+                    const DrawArguments& args = multiDraw.args[drawIndex];
+                    m_MultiDrawInfos[drawIndex] = vk::MultiDrawInfoEXT(args.startVertexLocation, args.vertexCount);
+                }
+            }
+
+            // All draws in one vkCmdDrawMulti*EXT call share the instance parameters
+            const uint32_t maxBatchSize = std::max(m_Context.multiDrawProperties.maxMultiDrawCount, 1u);
+            uint32_t batchStart = 0;
+
+            while (batchStart < multiDraw.drawCount)
+            {
+                const DrawArguments& first = multiDraw.args[batchStart];
+                uint32_t batchEnd = batchStart + 1;
+
+                while (batchEnd < multiDraw.drawCount && batchEnd - batchStart < maxBatchSize
+                    && multiDraw.args[batchEnd].instanceCount == first.instanceCount
+                    && multiDraw.args[batchEnd].startInstanceLocation == first.startInstanceLocation)
+                {
+                    ++batchEnd;
+                }
+
+                if (indexed)
+                {
+                    m_CurrentCmdBuf->cmdBuf.drawMultiIndexedEXT(batchEnd - batchStart, m_MultiDrawIndexedInfos.data() + batchStart,
+                        first.instanceCount, first.startInstanceLocation, sizeof(vk::MultiDrawIndexedInfoEXT), nullptr);
+                }
+                else
+                {
+                    m_CurrentCmdBuf->cmdBuf.drawMultiEXT(batchEnd - batchStart, m_MultiDrawInfos.data() + batchStart,
+                        first.instanceCount, first.startInstanceLocation, sizeof(vk::MultiDrawInfoEXT));
+                }
+
+                batchStart = batchEnd;
+            }
+
+            return;
+        }
+
+        GraphicsPipeline* pso = checked_cast<GraphicsPipeline*>(m_CurrentGraphicsState.pipeline);
+        const uint8_t* pushConstants = static_cast<const uint8_t*>(multiDraw.pushConstants);
+
+        if (pushConstants && m_CommandListParameters.enableStatistics)
+            m_Statistics.pushConstantBytes += uint64_t(multiDraw.pushConstantsByteSize) * multiDraw.drawCount;
+
+        for (uint32_t drawIndex = 0; drawIndex < multiDraw.drawCount; drawIndex++)
+        {
+            if (multiDraw.bindingSets && multiDraw.bindingSets[drawIndex] != m_CurrentGraphicsState.bindings[multiDraw.bindingSetIndex])
+            {
+                m_CurrentGraphicsState.bindings[multiDraw.bindingSetIndex] = multiDraw.bindingSets[drawIndex];
+                bindBindingSets(vk::PipelineBindPoint::eGraphics, pso->pipelineLayout, m_CurrentGraphicsState.bindings);
+            }
+
+            if (pushConstants)
+            {
+                m_CurrentCmdBuf->cmdBuf.pushConstants(m_CurrentPipelineLayout, m_CurrentPushConstantsVisibility, 0,
+                    multiDraw.pushConstantsByteSize, pushConstants + size_t(drawIndex) * multiDraw.pushConstantsStride);
+            }
+
+            updateGraphicsVolatileBuffers();
+
+            const DrawArguments& args = multiDraw.args[drawIndex];
+
+            if (indexed)
+                m_CurrentCmdBuf->cmdBuf.drawIndexed(args.vertexCount, args.instanceCount, args.startIndexLocation, args.startVertexLocation, args.startInstanceLocation);
+            else
+                m_CurrentCmdBuf->cmdBuf.draw(args.vertexCount, args.instanceCount, args.startVertexLocation, args.startInstanceLocation);
+        }
+    }
+
     void CommandList::drawIndirect(uint32_t offsetBytes, uint32_t drawCount)
     {
         assert(m_CurrentCmdBuf);
@@ -843,6 +1376,7 @@ namespace nvrhi::vulkan
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
         assert(indirectParams);
 
+        countDraws(drawCount);
         m_CurrentCmdBuf->cmdBuf.drawIndirect(indirectParams->buffer, offsetBytes, drawCount, sizeof(DrawIndirectArguments));
     }
 
@@ -855,7 +1389,113 @@ namespace nvrhi::vulkan
         Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
         assert(indirectParams);
 
+        countDraws(drawCount);
         m_CurrentCmdBuf->cmdBuf.drawIndexedIndirect(indirectParams->buffer, offsetBytes, drawCount, sizeof(DrawIndexedIndirectArguments));
     }
 
+    void CommandList::drawIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        assert(m_CurrentCmdBuf);
+
+        updateGraphicsVolatileBuffers();
+
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
+        Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectCountBuffer);
+        assert(indirectParams && countBuffer);
+
+        countDraws(1);
+        m_CurrentCmdBuf->cmdBuf.drawIndirectCountKHR(indirectParams->buffer, offsetBytes, countBuffer->buffer, countOffsetBytes,
+            maxDrawCount, sizeof(DrawIndirectArguments));
+    }
+
+    void CommandList::drawIndexedIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        assert(m_CurrentCmdBuf);
+
+        updateGraphicsVolatileBuffers();
+
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectParams);
+        Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentGraphicsState.indirectCountBuffer);
+        assert(indirectParams && countBuffer);
+
+        countDraws(1);
+        m_CurrentCmdBuf->cmdBuf.drawIndexedIndirectCountKHR(indirectParams->buffer, offsetBytes, countBuffer->buffer, countOffsetBytes,
+            maxDrawCount, sizeof(DrawIndexedIndirectArguments));
+    }
+
+    void CommandList::executeBundles(ICommandList* const* bundles, size_t numBundles)
+    {
+        assert(m_CurrentCmdBuf);
+
+        if (numBundles == 0)
+            return;
+
+        // All bundles in one call render into the same framebuffer, which is checked by the validation layer
+        Framebuffer* fb = checked_cast<Framebuffer*>(checked_cast<CommandList*>(bundles[0])->m_CommandListParameters.bundleFramebuffer);
+
+        // Secondary command buffers can only be executed in a render pass instance that was begun for them
+        endRenderPass();
+
+        if (m_EnableAutomaticBarriers)
+        {
+            // Merge the requirements of all bundles first: they all execute after the same set of barriers
+            m_BundleStates.clear();
+            for (size_t index = 0; index < numBundles; index++)
+                m_BundleStates.merge(checked_cast<CommandList*>(bundles[index])->m_BundleStates);
+
+            for (const auto& requirement : m_BundleStates.getTextureRequirements())
+                requireTextureState(requirement.texture, requirement.subresources, requirement.state);
+
+            for (const auto& requirement : m_BundleStates.getBufferRequirements())
+                requireBufferState(requirement.buffer, requirement.state);
+
+            if (fb)
+                setResourceStatesForFramebuffer(fb);
+        }
+
+        commitBarriers();
+
+        static_vector<vk::CommandBuffer, 16> secondaryBuffers;
+        auto flushSecondaryBuffers = [this, &secondaryBuffers]()
+        {
+            if (!secondaryBuffers.empty())
+                m_CurrentCmdBuf->cmdBuf.executeCommands(uint32_t(secondaryBuffers.size()), secondaryBuffers.data());
+            secondaryBuffers.resize(0);
+        };
+
+        if (fb)
+            beginRenderPass(fb, true);
+
+        for (size_t index = 0; index < numBundles; index++)
+        {
+            CommandList* bundle = checked_cast<CommandList*>(bundles[index]);
+            TrackedCommandBufferPtr bundleCmdBuf = bundle->m_CurrentCmdBuf;
+            if (!bundleCmdBuf)
+                continue;
+
+            addBundleStatistics(bundle);
+
+            if (secondaryBuffers.size() == secondaryBuffers.max_size())
+                flushSecondaryBuffers();
+
+            secondaryBuffers.push_back(bundleCmdBuf->cmdBuf);
+            m_CurrentCmdBuf->referencedBundles.push_back(bundleCmdBuf);
+        }
+
+        flushSecondaryBuffers();
+
+        if (fb)
+        {
+            if (fb->dynamicRendering)
+                m_CurrentCmdBuf->cmdBuf.endRendering();
+            else
+                m_CurrentCmdBuf->cmdBuf.endRenderPass();
+
+            m_CurrentCmdBuf->referencedResources.push_back(fb);
+        }
+
+        // The pipeline, descriptor set and dynamic state bindings are undefined after vkCmdExecuteCommands
+        clearState();
+    }
+
 } // namespace nvrhi::vulkan
@@ -29,11 +29,27 @@ namespace nvrhi::vulkan
     template <typename T>
     using attachment_vector = nvrhi::static_vector<T, c_MaxRenderTargets + 1>; // render targets + depth
 
-    MeshletPipelineHandle Device::createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* _fb)
+    MeshletPipelineHandle Device::createMeshletPipeline(const MeshletPipelineDesc& desc, IFramebuffer* fb)
     {
-        if (!m_Context.extensions.NV_mesh_shader)
+        return m_ObjectCache.getMeshletPipeline(desc, fb, [this, &desc, fb] { return createMeshletPipelineInternal(desc, fb); });
+    }
+
+    MeshletPipelineHandle Device::createMeshletPipelineInternal(const MeshletPipelineDesc& desc, IFramebuffer* _fb)
+    {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createMeshletPipeline", "Pipeline");
+
+        if (!m_Context.extensions.EXT_mesh_shader && !m_Context.extensions.NV_mesh_shader)
             utils::NotSupported();
 
+        if (desc.renderState.extendedDynamicState)
+        {
+            m_Context.error("Extended dynamic state is only supported for graphics pipelines");
+            return nullptr;
+        }
+
+        if (!validatePushDescriptorLayouts(desc.bindingLayouts, "createMeshletPipeline"))
+            return nullptr;
+
         vk::Result res;
 
         Framebuffer* fb = checked_cast<Framebuffer*>(_fb);
@@ -215,7 +231,26 @@ namespace nvrhi::vulkan
             .setBasePipelineHandle(nullptr)
             .setBasePipelineIndex(-1);
 
-        res = m_Context.device.createGraphicsPipelines(m_Context.pipelineCache,
+        // Pipelines must be created for the binding model the device uses
+        if (m_Context.descriptorBuffer)
+            pipelineInfo.flags |= vk::PipelineCreateFlagBits::eDescriptorBufferEXT;
+
+        // With dynamic rendering, fb->renderPass is null and the attachment formats are provided instead
+        auto renderingInfo = vk::PipelineRenderingCreateInfo()
+            .setColorAttachmentCount(uint32_t(fb->colorFormats.size()))
+            .setPColorAttachmentFormats(fb->colorFormats.data())
+            .setDepthAttachmentFormat(fb->depthFormat)
+            .setStencilAttachmentFormat(fb->stencilFormat);
+
+        if (fb->dynamicRendering)
+        {
+            pipelineInfo.setPNext(&renderingInfo);
+
+            if (fb->shadingRateView)
+                pipelineInfo.flags |= vk::PipelineCreateFlagBits::eRenderingFragmentShadingRateAttachmentKHR;
+        }
+
+        res = m_Context.device.createGraphicsPipelines(m_Context.getPipelineCache(),
                                                      1, &pipelineInfo,
                                                      m_Context.allocationCallbacks,
                                                      &pso->pipeline);
@@ -263,17 +298,42 @@ namespace nvrhi::vulkan
     {
         assert(m_CurrentCmdBuf);
 
+        if (!m_PushBindings.empty() && !usePushDescriptors() && state.pipeline)
+        {
+            // Without VK_KHR_push_descriptor, the pushed bindings become regular binding sets
+            MeshletState resolvedState = state;
+            if (m_PushBindings.createBindingSets(m_Device, state.pipeline->getDesc().bindingLayouts, resolvedState.bindings, &m_CurrentCmdBuf->referencedResources))
+                setMeshletState(resolvedState);
+            m_PushBindings.clear();
+            return;
+        }
+
         MeshletPipeline* pso = checked_cast<MeshletPipeline*>(state.pipeline);
         Framebuffer* fb = checked_cast<Framebuffer*>(state.framebuffer);
 
+        prepareRenderPassClears(fb);
+
         if (m_EnableAutomaticBarriers)
         {
             trackResourcesAndBarriers(state);
+            setResourceStatesForPushBindings();
         }
 
         bool anyBarriers = this->anyBarriers();
         bool updatePipeline = false;
 
+        if (m_CommandListParameters.enableStatistics)
+        {
+            countStateChanges(m_Statistics, {
+                m_CurrentMeshletState.pipeline != state.pipeline,
+                m_CurrentMeshletState.framebuffer != state.framebuffer,
+                arraysAreDifferent(m_CurrentComputeState.bindings, state.bindings) || m_AnyVolatileBufferWrites,
+                arraysAreDifferent(state.viewport.viewports, m_CurrentMeshletState.viewport.viewports)
+                    || arraysAreDifferent(state.viewport.scissorRects, m_CurrentMeshletState.viewport.scissorRects),
+                m_CurrentMeshletState.blendConstantColor != state.blendConstantColor,
+                m_CurrentMeshletState.dynamicStencilRefValue != state.dynamicStencilRefValue });
+        }
+
         if (m_CurrentMeshletState.pipeline != state.pipeline)
         {
             m_CurrentCmdBuf->cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, pso->pipeline);
@@ -291,14 +351,7 @@ namespace nvrhi::vulkan
 
         if(!m_CurrentMeshletState.framebuffer)
         {
-            m_CurrentCmdBuf->cmdBuf.beginRenderPass(vk::RenderPassBeginInfo()
-                .setRenderPass(fb->renderPass)
-                .setFramebuffer(fb->framebuffer)
-                .setRenderArea(vk::Rect2D()
-                    .setOffset(vk::Offset2D(0, 0))
-                    .setExtent(vk::Extent2D(fb->framebufferInfo.width, fb->framebufferInfo.height)))
-                .setClearValueCount(0),
-                vk::SubpassContents::eInline);
+            beginRenderPass(fb, false);
 
             m_CurrentCmdBuf->referencedResources.push_back(state.framebuffer);
         }
@@ -311,6 +364,11 @@ namespace nvrhi::vulkan
             bindBindingSets(vk::PipelineBindPoint::eGraphics, pso->pipelineLayout, state.bindings);
         }
 
+        if (!m_PushBindings.empty())
+        {
+            commitPushBindings(vk::PipelineBindPoint::eGraphics, pso->pipelineLayout, pso->desc.bindingLayouts);
+        }
+
         if (!state.viewport.viewports.empty() && arraysAreDifferent(state.viewport.viewports, m_CurrentMeshletState.viewport.viewports))
         {
             nvrhi::static_vector<vk::Viewport, c_MaxViewports> viewports;
@@ -349,6 +407,11 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->referencedResources.push_back(state.indirectParams);
         }
 
+        if (state.indirectCountBuffer)
+        {
+            m_CurrentCmdBuf->referencedResources.push_back(state.indirectCountBuffer);
+        }
+
         m_CurrentComputeState = ComputeState();
         m_CurrentGraphicsState = GraphicsState();
         m_CurrentMeshletState = state;
@@ -372,16 +435,58 @@ namespace nvrhi::vulkan
     {
         assert(m_CurrentCmdBuf);
 
-        if (groupsY > 1 || groupsZ > 1)
+        if (!m_Context.extensions.EXT_mesh_shader && (groupsY > 1 || groupsZ > 1))
         {
-            // only 1D dispatches are supported by Vulkan
+            // only 1D dispatches are supported by NV_mesh_shader
             utils::NotSupported();
             return;
         }
 
         updateMeshletVolatileBuffers();
 
-        m_CurrentCmdBuf->cmdBuf.drawMeshTasksNV(groupsX, 0);
+        countDraws(1);
+        if (m_Context.extensions.EXT_mesh_shader)
+            m_CurrentCmdBuf->cmdBuf.drawMeshTasksEXT(groupsX, groupsY, groupsZ);
+        else
+            m_CurrentCmdBuf->cmdBuf.drawMeshTasksNV(groupsX, 0);
+    }
+
+    void CommandList::dispatchMeshIndirect(uint32_t offsetBytes, uint32_t drawCount)
+    {
+        assert(m_CurrentCmdBuf);
+
+        updateMeshletVolatileBuffers();
+
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentMeshletState.indirectParams);
+        assert(indirectParams);
+
+        // VkDrawMeshTasksIndirectCommandEXT has the layout of D3D12_DISPATCH_MESH_ARGUMENTS, so argument buffers
+        // can be shared between backends. NV_mesh_shader reads each entry as (taskCount, firstTask) instead,
+        // with the same stride so that the entries stay at the documented offsets.
+        countDraws(drawCount);
+        if (m_Context.extensions.EXT_mesh_shader)
+            m_CurrentCmdBuf->cmdBuf.drawMeshTasksIndirectEXT(indirectParams->buffer, offsetBytes, drawCount, sizeof(uint32_t) * 3);
+        else
+            m_CurrentCmdBuf->cmdBuf.drawMeshTasksIndirectNV(indirectParams->buffer, offsetBytes, drawCount, sizeof(uint32_t) * 3);
+    }
+
+    void CommandList::dispatchMeshIndirectCount(uint32_t offsetBytes, uint32_t countOffsetBytes, uint32_t maxDrawCount)
+    {
+        assert(m_CurrentCmdBuf);
+
+        updateMeshletVolatileBuffers();
+
+        Buffer* indirectParams = checked_cast<Buffer*>(m_CurrentMeshletState.indirectParams);
+        Buffer* countBuffer = checked_cast<Buffer*>(m_CurrentMeshletState.indirectCountBuffer);
+        assert(indirectParams && countBuffer);
+
+        countDraws(1);
+        if (m_Context.extensions.EXT_mesh_shader)
+            m_CurrentCmdBuf->cmdBuf.drawMeshTasksIndirectCountEXT(indirectParams->buffer, offsetBytes, countBuffer->buffer, countOffsetBytes,
+                maxDrawCount, sizeof(uint32_t) * 3);
+        else
+            m_CurrentCmdBuf->cmdBuf.drawMeshTasksIndirectCountNV(indirectParams->buffer, offsetBytes, countBuffer->buffer, countOffsetBytes,
+                maxDrawCount, sizeof(uint32_t) * 3);
     }
 
 } // namespace nvrhi::vulkan
@@ -23,6 +23,10 @@
 #include "vulkan-backend.h"
 #include <nvrhi/common/misc.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 namespace nvrhi::vulkan
 {
 
@@ -103,6 +107,12 @@ namespace nvrhi::vulkan
         query->beginQueryIndex = queryIndex * 2;
         query->endQueryIndex = queryIndex * 2 + 1;
 
+        if (m_HostQueryResetSupported)
+        {
+            m_Context.device.resetQueryPool(m_TimerQueryPool, query->beginQueryIndex, 2);
+            query->hostReset = true;
+        }
+
         return TimerQueryHandle::Create(query);
     }
 
@@ -113,10 +123,16 @@ namespace nvrhi::vulkan
         endQueryIndex = -1;
     }
 
-    void CommandList::beginTimerQuery(ITimerQuery* _query)
+    void CommandList::resetQueries(vk::QueryPool pool, uint32_t firstQuery, uint32_t queryCount)
     {
+        // vkCmdResetQueryPool is not allowed inside a render pass
         endRenderPass();
 
+        m_CurrentCmdBuf->cmdBuf.resetQueryPool(pool, firstQuery, queryCount);
+    }
+
+    void CommandList::beginTimerQuery(ITimerQuery* _query)
+    {
         TimerQuery* query = checked_cast<TimerQuery*>(_query);
 
         assert(query->beginQueryIndex >= 0);
@@ -125,14 +141,15 @@ namespace nvrhi::vulkan
 
         query->resolved = false;
 
-        m_CurrentCmdBuf->cmdBuf.resetQueryPool(m_Device->getTimerQueryPool(), query->beginQueryIndex, 2);
+        if (!query->hostReset)
+            resetQueries(m_Device->getTimerQueryPool(), query->beginQueryIndex, 2);
+        query->hostReset = false;
+
         m_CurrentCmdBuf->cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_Device->getTimerQueryPool(), query->beginQueryIndex);
     }
 
     void CommandList::endTimerQuery(ITimerQuery* _query)
     {
-        endRenderPass();
-
         TimerQuery* query = checked_cast<TimerQuery*>(_query);
 
         assert(query->endQueryIndex >= 0);
@@ -204,9 +221,383 @@ namespace nvrhi::vulkan
         query->started = false;
         query->resolved = false;
         query->time = 0.f;
+
+        if (m_HostQueryResetSupported && !query->hostReset)
+        {
+            m_Context.device.resetQueryPool(m_TimerQueryPool, query->beginQueryIndex, 2);
+            query->hostReset = true;
+        }
     }
 
 
+    static constexpr vk::QueryPipelineStatisticFlags c_AllPipelineStatistics =
+        vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+        vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eGeometryShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eGeometryShaderPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
+        vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eTessellationControlShaderPatches |
+        vk::QueryPipelineStatisticFlagBits::eTessellationEvaluationShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+
+    // With all statistics enabled, Vulkan writes them in the same order as the fields of PipelineStatistics
+    static_assert(sizeof(PipelineStatistics) == 11 * sizeof(uint64_t));
+
+    OcclusionQuery::~OcclusionQuery()
+    {
+        m_QueryAllocator.release(queryIndex);
+        queryIndex = -1;
+    }
+
+    PipelineStatisticsQuery::~PipelineStatisticsQuery()
+    {
+        m_QueryAllocator.release(queryIndex);
+        queryIndex = -1;
+    }
+
+    OcclusionQueryHandle Device::createOcclusionQuery(const OcclusionQueryDesc& desc)
+    {
+        if (!m_OcclusionQueryPool)
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            if (!m_OcclusionQueryPool)
+            {
+                auto poolInfo = vk::QueryPoolCreateInfo()
+                    .setQueryType(vk::QueryType::eOcclusion)
+                    .setQueryCount(uint32_t(m_OcclusionQueryAllocator.getCapacity()));
+
+                const vk::Result res = m_Context.device.createQueryPool(&poolInfo, m_Context.allocationCallbacks, &m_OcclusionQueryPool);
+                CHECK_VK_FAIL(res)
+            }
+        }
+
+        int queryIndex = m_OcclusionQueryAllocator.allocate();
+
+        if (queryIndex < 0)
+        {
+            m_Context.error("Insufficient query pool space, increase DeviceDesc::maxOcclusionQueries");
+            return nullptr;
+        }
+
+        OcclusionQuery* query = new OcclusionQuery(m_OcclusionQueryAllocator);
+        query->desc = desc;
+        query->queryIndex = queryIndex;
+
+        if (m_HostQueryResetSupported)
+        {
+            m_Context.device.resetQueryPool(m_OcclusionQueryPool, queryIndex, 1);
+            query->hostReset = true;
+        }
+
+        return OcclusionQueryHandle::Create(query);
+    }
+
+    bool Device::pollOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        if (!query->started)
+            return false;
+
+        if (query->resolved)
+            return true;
+
+        uint64_t result = 0;
+        const vk::Result res = m_Context.device.getQueryPoolResults(m_OcclusionQueryPool,
+            query->queryIndex, 1,
+            sizeof(result), &result,
+            sizeof(result), vk::QueryResultFlagBits::e64);
+        assert(res == vk::Result::eSuccess || res == vk::Result::eNotReady);
+
+        if (res == vk::Result::eNotReady)
+            return false;
+
+        query->result = result;
+        query->resolved = true;
+        return true;
+    }
+
+    uint64_t Device::getOcclusionQueryResult(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        if (!query->started)
+            return 0;
+
+        while (!pollOcclusionQuery(query))
+            ;
+
+        return query->result;
+    }
+
+    void Device::resetOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        query->started = false;
+        query->resolved = false;
+        query->result = 0;
+
+        if (m_HostQueryResetSupported && !query->hostReset)
+        {
+            m_Context.device.resetQueryPool(m_OcclusionQueryPool, query->queryIndex, 1);
+            query->hostReset = true;
+        }
+    }
+
+    PipelineStatisticsQueryHandle Device::createPipelineStatisticsQuery()
+    {
+        if (!m_PipelineStatisticsQuerySupported)
+        {
+            m_Context.error("Pipeline statistics queries are not supported, see DeviceDesc::pipelineStatisticsQuerySupported");
+            return nullptr;
+        }
+
+        if (!m_PipelineStatisticsQueryPool)
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            if (!m_PipelineStatisticsQueryPool)
+            {
+                auto poolInfo = vk::QueryPoolCreateInfo()
+                    .setQueryType(vk::QueryType::ePipelineStatistics)
+                    .setQueryCount(uint32_t(m_PipelineStatisticsQueryAllocator.getCapacity()))
+                    .setPipelineStatistics(c_AllPipelineStatistics);
+
+                const vk::Result res = m_Context.device.createQueryPool(&poolInfo, m_Context.allocationCallbacks, &m_PipelineStatisticsQueryPool);
+                CHECK_VK_FAIL(res)
+            }
+        }
+
+        int queryIndex = m_PipelineStatisticsQueryAllocator.allocate();
+
+        if (queryIndex < 0)
+        {
+            m_Context.error("Insufficient query pool space, increase DeviceDesc::maxPipelineStatisticsQueries");
+            return nullptr;
+        }
+
+        PipelineStatisticsQuery* query = new PipelineStatisticsQuery(m_PipelineStatisticsQueryAllocator);
+        query->queryIndex = queryIndex;
+
+        if (m_HostQueryResetSupported)
+        {
+            m_Context.device.resetQueryPool(m_PipelineStatisticsQueryPool, queryIndex, 1);
+            query->hostReset = true;
+        }
+
+        return PipelineStatisticsQueryHandle::Create(query);
+    }
+
+    bool Device::pollPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        if (!query->started)
+            return false;
+
+        if (query->resolved)
+            return true;
+
+        PipelineStatistics result;
+        const vk::Result res = m_Context.device.getQueryPoolResults(m_PipelineStatisticsQueryPool,
+            query->queryIndex, 1,
+            sizeof(result), &result,
+            sizeof(result), vk::QueryResultFlagBits::e64);
+        assert(res == vk::Result::eSuccess || res == vk::Result::eNotReady);
+
+        if (res == vk::Result::eNotReady)
+            return false;
+
+        query->result = result;
+        query->resolved = true;
+        return true;
+    }
+
+    PipelineStatistics Device::getPipelineStatistics(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        if (!query->started)
+            return PipelineStatistics();
+
+        while (!pollPipelineStatisticsQuery(query))
+            ;
+
+        return query->result;
+    }
+
+    void Device::resetPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        query->started = false;
+        query->resolved = false;
+        query->result = PipelineStatistics();
+
+        if (m_HostQueryResetSupported && !query->hostReset)
+        {
+            m_Context.device.resetQueryPool(m_PipelineStatisticsQueryPool, query->queryIndex, 1);
+            query->hostReset = true;
+        }
+    }
+
+    void CommandList::beginOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        assert(query->queryIndex >= 0);
+        assert(m_CurrentCmdBuf);
+
+        query->resolved = false;
+
+        const vk::QueryControlFlags flags = (!query->desc.binary && m_Device->isOcclusionQueryPreciseSupported())
+            ? vk::QueryControlFlagBits::ePrecise
+            : vk::QueryControlFlags();
+
+        // Queries that were reset on the host can be begun inside the current render pass,
+        // and then they must also end inside of it.
+        if (!query->hostReset)
+            resetQueries(m_Device->getOcclusionQueryPool(), query->queryIndex, 1);
+        query->hostReset = false;
+
+        query->beganInRenderPass = isInsideRenderPass();
+        if (query->beganInRenderPass)
+            ++m_RenderPassQueries;
+
+        m_CurrentCmdBuf->cmdBuf.beginQuery(m_Device->getOcclusionQueryPool(), query->queryIndex, flags);
+    }
+
+    void CommandList::endOcclusionQuery(IOcclusionQuery* _query)
+    {
+        OcclusionQuery* query = checked_cast<OcclusionQuery*>(_query);
+
+        assert(m_CurrentCmdBuf);
+
+        // A query begun outside of a render pass must also end outside of it
+        if (!query->beganInRenderPass)
+            endRenderPass();
+        else if (m_RenderPassQueries > 0)
+            --m_RenderPassQueries;
+
+        m_CurrentCmdBuf->cmdBuf.endQuery(m_Device->getOcclusionQueryPool(), query->queryIndex);
+        m_CurrentCmdBuf->referencedResources.push_back(query);
+        query->started = true;
+    }
+
+    void CommandList::beginPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        assert(query->queryIndex >= 0);
+        assert(m_CurrentCmdBuf);
+
+        query->resolved = false;
+
+        if (!query->hostReset)
+            resetQueries(m_Device->getPipelineStatisticsQueryPool(), query->queryIndex, 1);
+        query->hostReset = false;
+
+        query->beganInRenderPass = isInsideRenderPass();
+        if (query->beganInRenderPass)
+            ++m_RenderPassQueries;
+
+        m_CurrentCmdBuf->cmdBuf.beginQuery(m_Device->getPipelineStatisticsQueryPool(), query->queryIndex, vk::QueryControlFlags());
+    }
+
+    void CommandList::endPipelineStatisticsQuery(IPipelineStatisticsQuery* _query)
+    {
+        PipelineStatisticsQuery* query = checked_cast<PipelineStatisticsQuery*>(_query);
+
+        assert(m_CurrentCmdBuf);
+
+        if (!query->beganInRenderPass)
+            endRenderPass();
+        else if (m_RenderPassQueries > 0)
+            --m_RenderPassQueries;
+
+        m_CurrentCmdBuf->cmdBuf.endQuery(m_Device->getPipelineStatisticsQueryPool(), query->queryIndex);
+        m_CurrentCmdBuf->referencedResources.push_back(query);
+        query->started = true;
+    }
+
+    void CommandList::resolveOcclusionQueries(IOcclusionQuery* const* queries, size_t numQueries, IBuffer* _buffer, uint64_t offsetBytes)
+    {
+        endRenderPass();
+
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        assert(m_CurrentCmdBuf);
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireBufferState(buffer, ResourceStates::CopyDest);
+        }
+        commitBarriers();
+
+        m_CurrentCmdBuf->referencedResources.push_back(buffer);
+
+        // Consecutive queries that also occupy consecutive pool slots are copied with one command
+        size_t runStart = 0;
+        for (size_t i = 1; i <= numQueries; ++i)
+        {
+            const OcclusionQuery* first = checked_cast<OcclusionQuery*>(queries[runStart]);
+
+            if (i < numQueries && checked_cast<OcclusionQuery*>(queries[i])->queryIndex == checked_cast<OcclusionQuery*>(queries[i - 1])->queryIndex + 1)
+                continue;
+
+            m_CurrentCmdBuf->cmdBuf.copyQueryPoolResults(m_Device->getOcclusionQueryPool(),
+                first->queryIndex, uint32_t(i - runStart),
+                buffer->buffer, offsetBytes + runStart * sizeof(uint64_t),
+                sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+            runStart = i;
+        }
+
+        for (size_t i = 0; i < numQueries; ++i)
+            m_CurrentCmdBuf->referencedResources.push_back(queries[i]);
+    }
+
+    void CommandList::setPredication(IBuffer* _buffer, uint64_t offsetBytes, PredicationOp op)
+    {
+        // Conditional rendering that begins outside of a render pass must also end outside of it
+        endRenderPass();
+
+        assert(m_CurrentCmdBuf);
+
+        if (m_PredicationActive)
+        {
+            m_CurrentCmdBuf->cmdBuf.endConditionalRenderingEXT();
+            m_PredicationActive = false;
+        }
+
+        if (!_buffer)
+            return;
+
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireBufferState(buffer, ResourceStates::Predication);
+        }
+        commitBarriers();
+
+        m_CurrentCmdBuf->referencedResources.push_back(buffer);
+
+        // Vulkan discards the commands when the value is zero, or when it's nonzero with the inverted flag
+        auto conditionalRenderingInfo = vk::ConditionalRenderingBeginInfoEXT()
+            .setBuffer(buffer->buffer)
+            .setOffset(offsetBytes)
+            .setFlags((op == PredicationOp::SkipIfNotZero) ? vk::ConditionalRenderingFlagBitsEXT::eInverted : vk::ConditionalRenderingFlagsEXT());
+
+        m_CurrentCmdBuf->cmdBuf.beginConditionalRenderingEXT(conditionalRenderingInfo);
+        m_PredicationActive = true;
+    }
+
     void CommandList::beginMarker(const char* name)
     {
         if (m_Context.extensions.EXT_debug_marker)
@@ -217,10 +608,40 @@ namespace nvrhi::vulkan
                                 .setPMarkerName(name);
             m_CurrentCmdBuf->cmdBuf.debugMarkerBeginEXT(&markerInfo);
         }
+
+        if (m_GpuProfiler)
+        {
+            assert(m_CurrentCmdBuf);
+
+            const uint32_t parent = m_GpuProfilerScopes.empty() ? GpuProfilerBase::c_InvalidScope : m_GpuProfilerScopes.back();
+            const uint32_t scope = m_GpuProfiler->beginScope(name, parent);
+            m_GpuProfilerScopes.push_back(scope);
+
+            if (scope != GpuProfilerBase::c_InvalidScope)
+            {
+                // Timestamp writes are allowed inside render passes, so unlike beginTimerQuery this doesn't end the pass
+                m_CurrentCmdBuf->referencedResources.push_back(m_GpuProfiler);
+                m_CurrentCmdBuf->cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_GpuProfiler->queryPool, GpuProfilerBase::getBeginQuery(scope));
+            }
+        }
     }
 
     void CommandList::endMarker()
     {
+        if (m_GpuProfiler && !m_GpuProfilerScopes.empty())
+        {
+            assert(m_CurrentCmdBuf);
+
+            const uint32_t scope = m_GpuProfilerScopes.back();
+            m_GpuProfilerScopes.pop_back();
+
+            if (scope != GpuProfilerBase::c_InvalidScope)
+            {
+                m_CurrentCmdBuf->cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_GpuProfiler->queryPool, GpuProfilerBase::getEndQuery(scope));
+                m_GpuProfiler->endScope(scope);
+            }
+        }
+
         if (m_Context.extensions.EXT_debug_marker)
         {
             assert(m_CurrentCmdBuf);
@@ -229,4 +650,121 @@ namespace nvrhi::vulkan
         }
     }
 
+    void CommandList::setGpuProfiler(IGpuProfiler* profiler)
+    {
+        m_GpuProfiler = checked_cast<GpuProfiler*>(profiler);
+        m_GpuProfilerScopes.clear();
+    }
+
+    GpuProfilerHandle Device::createGpuProfiler(const GpuProfilerDesc& desc)
+    {
+        if (desc.queue == CommandQueue::Copy || !getQueue(desc.queue))
+        {
+            m_Context.error("GPU profiler can only be created for an existing graphics or compute queue");
+            return nullptr;
+        }
+
+        GpuProfiler* profiler = new GpuProfiler(m_Context, this, desc);
+        GpuProfilerHandle handle = GpuProfilerHandle::Create(profiler);
+
+        auto poolInfo = vk::QueryPoolCreateInfo()
+            .setQueryType(vk::QueryType::eTimestamp)
+            .setQueryCount(profiler->getTotalQueryCount());
+
+        const vk::Result res = m_Context.device.createQueryPool(&poolInfo, m_Context.allocationCallbacks, &profiler->queryPool);
+        CHECK_VK_FAIL(res)
+
+        if (!profiler->initialize())
+        {
+            m_Context.error("Failed to create the GPU profiler resources");
+            return nullptr;
+        }
+
+        // Queries must be reset before their first use; after that, every resolve resets the range it has copied
+        CommandListHandle commandList = createCommandList(CommandListParameters()
+            .setEnableImmediateExecution(false)
+            .setQueueType(desc.queue));
+        commandList->open();
+        vk::CommandBuffer cmdBuf = VkCommandBuffer(commandList->getNativeObject(ObjectTypes::VK_CommandBuffer));
+        cmdBuf.resetQueryPool(profiler->queryPool, 0, profiler->getTotalQueryCount());
+        commandList->close();
+        executeCommandList(commandList, desc.queue);
+
+        return handle;
+    }
+
+    GpuProfiler::~GpuProfiler()
+    {
+        if (queryPool)
+        {
+            m_Context.device.destroyQueryPool(queryPool, m_Context.allocationCallbacks);
+            queryPool = vk::QueryPool();
+        }
+    }
+
+    void GpuProfiler::recordTimestamp(nvrhi::ICommandList* commandList, uint32_t queryIndex)
+    {
+        vk::CommandBuffer cmdBuf = VkCommandBuffer(commandList->getNativeObject(ObjectTypes::VK_CommandBuffer));
+
+        cmdBuf.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, queryIndex);
+    }
+
+    void GpuProfiler::recordResolve(nvrhi::ICommandList* commandList, uint32_t firstQuery, uint32_t numQueries, IBuffer* buffer, uint64_t bufferOffset)
+    {
+        vk::CommandBuffer cmdBuf = VkCommandBuffer(commandList->getNativeObject(ObjectTypes::VK_CommandBuffer));
+
+        // The readback buffer is owned by the profiler and is not tracked by the command list,
+        // so that mapBuffer doesn't wait for the latest frame instead of the one being read.
+        cmdBuf.copyQueryPoolResults(queryPool, firstQuery, numQueries, checked_cast<Buffer*>(buffer)->buffer, bufferOffset,
+            sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+        auto barrier = vk::MemoryBarrier()
+            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eHostRead);
+        cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+            vk::DependencyFlags(), { barrier }, {}, {});
+
+        cmdBuf.resetQueryPool(queryPool, firstQuery, numQueries);
+    }
+
+    double GpuProfiler::getTimestampPeriod()
+    {
+        return double(m_Context.physicalDeviceProperties.limits.timestampPeriod) * 1e-9; // timestampPeriod is in nanoseconds
+    }
+
+    bool GpuProfiler::getClockCalibration(uint64_t& outGpuTimestamp, double& outCpuSeconds)
+    {
+        if (!m_Context.extensions.EXT_calibrated_timestamps)
+            return false;
+
+#ifdef _WIN32
+        const vk::TimeDomainEXT hostDomain = vk::TimeDomainEXT::eQueryPerformanceCounter;
+#else
+        const vk::TimeDomainEXT hostDomain = vk::TimeDomainEXT::eClockMonotonic;
+#endif
+
+        const vk::CalibratedTimestampInfoEXT timestampInfos[2] = {
+            vk::CalibratedTimestampInfoEXT().setTimeDomain(vk::TimeDomainEXT::eDevice),
+            vk::CalibratedTimestampInfoEXT().setTimeDomain(hostDomain)
+        };
+
+        uint64_t timestamps[2] = { 0, 0 };
+        uint64_t maxDeviation = 0;
+        const vk::Result res = m_Context.device.getCalibratedTimestampsEXT(2, timestampInfos, timestamps, &maxDeviation);
+        if (res != vk::Result::eSuccess)
+            return false;
+
+        outGpuTimestamp = timestamps[0];
+
+#ifdef _WIN32
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        outCpuSeconds = double(timestamps[1]) / double(frequency.QuadPart);
+#else
+        outCpuSeconds = double(timestamps[1]) * 1e-9; // CLOCK_MONOTONIC is in nanoseconds
+#endif
+
+        return true;
+    }
+
 } // namespace nvrhi::vulkan
\ No newline at end of file
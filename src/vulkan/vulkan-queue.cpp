@@ -28,9 +28,29 @@ namespace nvrhi::vulkan
 
     TrackedCommandBuffer::~TrackedCommandBuffer()
     {
+        for (vk::Event event : splitBarrierEvents)
+            m_Context.device.destroyEvent(event, m_Context.allocationCallbacks);
+
         m_Context.device.destroyCommandPool(cmdPool, m_Context.allocationCallbacks);
     }
 
+    vk::Event TrackedCommandBuffer::acquireSplitBarrierEvent()
+    {
+        if (usedSplitBarrierEvents < splitBarrierEvents.size())
+            return splitBarrierEvents[usedSplitBarrierEvents++];
+
+        auto eventInfo = vk::EventCreateInfo()
+            .setFlags(vk::EventCreateFlagBits::eDeviceOnly);
+
+        vk::Event event;
+        const vk::Result res = m_Context.device.createEvent(&eventInfo, m_Context.allocationCallbacks, &event);
+        CHECK_VK_FAIL(res)
+
+        splitBarrierEvents.push_back(event);
+        usedSplitBarrierEvents = splitBarrierEvents.size();
+        return event;
+    }
+
     Queue::Queue(const VulkanContext& context, CommandQueue queueID, vk::Queue queue, uint32_t queueFamilyIndex)
         : m_Context(context)
         , m_Queue(queue)
@@ -52,7 +72,7 @@ namespace nvrhi::vulkan
         trackingSemaphore = vk::Semaphore();
     }
 
-    TrackedCommandBufferPtr Queue::createCommandBuffer()
+    TrackedCommandBufferPtr Queue::createCommandBuffer(vk::CommandBufferLevel level)
     {
         vk::Result res;
 
@@ -68,7 +88,7 @@ namespace nvrhi::vulkan
         
         // allocate command buffer
         auto allocInfo = vk::CommandBufferAllocateInfo()
-                            .setLevel(vk::CommandBufferLevel::ePrimary)
+                            .setLevel(level)
                             .setCommandPool(ret->cmdPool)
                             .setCommandBufferCount(1);
 
@@ -91,21 +111,22 @@ namespace nvrhi::vulkan
         }
         else
         {
-            cmdBuf = m_CommandBuffersPool.front();
-            m_CommandBuffersPool.pop_front();
+            cmdBuf = std::move(m_CommandBuffersPool.back());
+            m_CommandBuffersPool.pop_back();
         }
 
         cmdBuf->recordingID = recordingID;
         return cmdBuf;
     }
 
-    void Queue::addWaitSemaphore(vk::Semaphore semaphore, uint64_t value)
+    void Queue::addWaitSemaphore(vk::Semaphore semaphore, uint64_t value, Queue* executionQueue)
     {
         if (!semaphore)
             return;
 
         m_WaitSemaphores.push_back(semaphore);
         m_WaitSemaphoreValues.push_back(value);
+        m_WaitSemaphoreQueues.push_back(executionQueue);
     }
 
     void Queue::addSignalSemaphore(vk::Semaphore semaphore, uint64_t value)
@@ -117,24 +138,92 @@ namespace nvrhi::vulkan
         m_SignalSemaphoreValues.push_back(value);
     }
 
-    uint64_t Queue::submit(ICommandList* const* ppCmd, size_t numCmd)
+    void Queue::bindSparse(vk::BindSparseInfo bindInfo)
     {
-        std::vector<vk::PipelineStageFlags> waitStageArray(m_WaitSemaphores.size());
-        std::vector<vk::CommandBuffer> commandBuffers(numCmd);
+        // The queued command buffers must be submitted before the binding to keep the order,
+        // and so must the other queues' submissions that the binding waits for
+        flush();
 
         for (size_t i = 0; i < m_WaitSemaphores.size(); i++)
         {
-            waitStageArray[i] = vk::PipelineStageFlagBits::eTopOfPipe;
+            if (m_WaitSemaphoreQueues[i])
+                m_WaitSemaphoreQueues[i]->flush(m_WaitSemaphoreValues[i]);
         }
 
+        // Sparse binding is not ordered with command buffer execution on the same queue,
+        // so wait for the previous submissions and make the next one wait for the binding.
+        addWaitSemaphore(trackingSemaphore, m_LastSubmittedID);
+
         m_LastSubmittedID++;
 
+        m_SignalSemaphores.push_back(trackingSemaphore);
+        m_SignalSemaphoreValues.push_back(m_LastSubmittedID);
+
+        auto timelineSemaphoreInfo = vk::TimelineSemaphoreSubmitInfo()
+            .setWaitSemaphoreValueCount(uint32_t(m_WaitSemaphoreValues.size()))
+            .setPWaitSemaphoreValues(m_WaitSemaphoreValues.data())
+            .setSignalSemaphoreValueCount(uint32_t(m_SignalSemaphoreValues.size()))
+            .setPSignalSemaphoreValues(m_SignalSemaphoreValues.data());
+
+        bindInfo.setPNext(&timelineSemaphoreInfo)
+            .setWaitSemaphoreCount(uint32_t(m_WaitSemaphores.size()))
+            .setPWaitSemaphores(m_WaitSemaphores.data())
+            .setSignalSemaphoreCount(uint32_t(m_SignalSemaphores.size()))
+            .setPSignalSemaphores(m_SignalSemaphores.data());
+
+        m_Queue.bindSparse(bindInfo);
+
+        m_WaitSemaphores.clear();
+        m_WaitSemaphoreValues.clear();
+        m_WaitSemaphoreQueues.clear();
+        m_SignalSemaphores.clear();
+        m_SignalSemaphoreValues.clear();
+
+        addWaitSemaphore(trackingSemaphore, m_LastSubmittedID);
+
+        m_LastFlushedID = m_LastSubmittedID;
+    }
+
+    uint64_t Queue::submit(ICommandList* const* ppCmd, size_t numCmd)
+    {
+        std::lock_guard lockGuard(m_SubmitMutex);
+
+        m_LastSubmittedID++;
+
+        // A wait starts a new entry, so that it doesn't delay the command buffers queued before it.
+        // An entry with extra signals is not extended either: they must not be delayed, and a semaphore
+        // can only be signaled once per entry.
+        PendingSubmission* submission = nullptr;
+        if (m_NumPendingSubmissions > m_FirstPendingSubmission && m_WaitSemaphores.empty())
+        {
+            PendingSubmission& last = m_PendingSubmissions[m_NumPendingSubmissions - 1];
+            if (last.signalSemaphores.empty())
+                submission = &last;
+        }
+
+        if (!submission)
+        {
+            if (m_NumPendingSubmissions == m_PendingSubmissions.size())
+                m_PendingSubmissions.emplace_back();
+
+            submission = &m_PendingSubmissions[m_NumPendingSubmissions++];
+            submission->commandBuffers.clear();
+            submission->commandBufferDeviceMasks.clear();
+            submission->waitSemaphores = m_WaitSemaphores;
+            submission->waitSemaphoreValues = m_WaitSemaphoreValues;
+            submission->waitSemaphoreQueues = m_WaitSemaphoreQueues;
+            submission->signalSemaphores.clear();
+            submission->signalSemaphoreValues.clear();
+        }
+
         for (size_t i = 0; i < numCmd; i++)
         {
             CommandList* commandList = checked_cast<CommandList*>(ppCmd[i]);
             TrackedCommandBufferPtr commandBuffer = commandList->getCurrentCmdBuf();
 
-            commandBuffers[i] = commandBuffer->cmdBuf;
+            submission->commandBuffers.push_back(commandBuffer->cmdBuf);
+            submission->commandBufferDeviceMasks.push_back(commandList->getDeviceMask());
+            commandBuffer->submissionID = m_LastSubmittedID;
             m_CommandBuffersInFlight.push_back(commandBuffer);
 
             for (const auto& buffer : commandBuffer->referencedStagingBuffers)
@@ -143,88 +232,315 @@ namespace nvrhi::vulkan
                 buffer->lastUseCommandListID = m_LastSubmittedID;
             }
         }
-        
-        m_SignalSemaphores.push_back(trackingSemaphore);
-        m_SignalSemaphoreValues.push_back(m_LastSubmittedID);
 
-        auto timelineSemaphoreInfo = vk::TimelineSemaphoreSubmitInfo()
-            .setSignalSemaphoreValueCount(uint32_t(m_SignalSemaphoreValues.size()))
-            .setPSignalSemaphoreValues(m_SignalSemaphoreValues.data());
-
-        if (!m_WaitSemaphoreValues.empty()) 
-        {
-            timelineSemaphoreInfo.setWaitSemaphoreValueCount(uint32_t(m_WaitSemaphoreValues.size()));
-            timelineSemaphoreInfo.setPWaitSemaphoreValues(m_WaitSemaphoreValues.data());
-        }
-
-        auto submitInfo = vk::SubmitInfo()
-            .setPNext(&timelineSemaphoreInfo)
-            .setCommandBufferCount(uint32_t(numCmd))
-            .setPCommandBuffers(commandBuffers.data())
-            .setWaitSemaphoreCount(uint32_t(m_WaitSemaphores.size()))
-            .setPWaitSemaphores(m_WaitSemaphores.data())
-            .setPWaitDstStageMask(waitStageArray.data())
-            .setSignalSemaphoreCount(uint32_t(m_SignalSemaphores.size()))
-            .setPSignalSemaphores(m_SignalSemaphores.data());
-
-        m_Queue.submit(submitInfo);
+        submission->signalSemaphores.insert(submission->signalSemaphores.end(), m_SignalSemaphores.begin(), m_SignalSemaphores.end());
+        submission->signalSemaphoreValues.insert(submission->signalSemaphoreValues.end(), m_SignalSemaphoreValues.begin(), m_SignalSemaphoreValues.end());
+        submission->submissionID = m_LastSubmittedID;
 
         m_WaitSemaphores.clear();
         m_WaitSemaphoreValues.clear();
+        m_WaitSemaphoreQueues.clear();
         m_SignalSemaphores.clear();
         m_SignalSemaphoreValues.clear();
         
         return m_LastSubmittedID;
     }
 
-    uint64_t Queue::updateLastFinishedID()
+    void Queue::flush(uint64_t upToID)
     {
-        m_LastFinishedID = m_Context.device.getSemaphoreCounterValue(trackingSemaphore);
+        std::unique_lock lock(m_SubmitMutex);
+
+        while (m_FirstPendingSubmission < m_NumPendingSubmissions && m_LastFlushedID < upToID)
+        {
+            // Take the entries up to the one containing upToID, but stop at the first entry that waits
+            // for a submission which is still queued on another queue. That queue is flushed up to the
+            // waited submission first, so that a submitted wait never depends on a later flush.
+            const size_t first = m_FirstPendingSubmission;
+            size_t end = first;
+            Queue* dependencyQueue = nullptr;
+            uint64_t dependencyID = 0;
+
+            while (end < m_NumPendingSubmissions && !dependencyQueue)
+            {
+                const PendingSubmission& submission = m_PendingSubmissions[end];
+
+                for (size_t j = 0; j < submission.waitSemaphores.size(); j++)
+                {
+                    Queue* waitQueue = submission.waitSemaphoreQueues[j];
+                    const uint64_t value = submission.waitSemaphoreValues[j];
+
+                    if (waitQueue && value > waitQueue->getLastFlushedID() && value <= waitQueue->getLastSubmittedID())
+                    {
+                        dependencyQueue = waitQueue;
+                        dependencyID = value;
+                        break;
+                    }
+                }
+
+                if (dependencyQueue)
+                    break;
 
-        return m_LastFinishedID;
+                ++end;
+
+                if (submission.submissionID >= upToID)
+                    break;
+            }
+
+            if (end > first)
+            {
+                submitPendingEntries(first, end - first);
+                m_FirstPendingSubmission = end;
+                m_LastFlushedID = m_PendingSubmissions[end - 1].submissionID;
+            }
+
+            if (dependencyQueue)
+            {
+                // The other queue may be flushing this one at the same time, so don't hold the lock
+                lock.unlock();
+                dependencyQueue->flush(dependencyID);
+                lock.lock();
+            }
+        }
+
+        if (m_FirstPendingSubmission == m_NumPendingSubmissions)
+        {
+            m_FirstPendingSubmission = 0;
+            m_NumPendingSubmissions = 0;
+        }
     }
 
-    void Queue::retireCommandBuffers()
+    void Queue::submitPendingEntries(size_t first, size_t count)
     {
-        std::list<TrackedCommandBufferPtr> submissions = std::move(m_CommandBuffersInFlight);
+        // Every entry also signals the tracking semaphore; the entries point into these arrays,
+        // so they are filled completely before the submit infos are built.
+        size_t numSignals = 0;
+        for (size_t i = 0; i < count; i++)
+            numSignals += m_PendingSubmissions[first + i].signalSemaphores.size() + 1;
 
-        uint64_t lastFinishedID = updateLastFinishedID();
-        
-        for (const TrackedCommandBufferPtr& cmd : submissions)
+        if (m_Context.extensions.KHR_synchronization2)
         {
-            if (cmd->submissionID <= lastFinishedID)
+            std::vector<vk::CommandBufferSubmitInfo> commandBufferInfos;
+            std::vector<vk::SemaphoreSubmitInfo> waitInfos;
+            std::vector<vk::SemaphoreSubmitInfo> signalInfos;
+            std::vector<vk::SubmitInfo2> submitInfos(count);
+            signalInfos.reserve(numSignals);
+
+            for (size_t i = 0; i < count; i++)
             {
-                cmd->referencedResources.clear();
-                cmd->referencedStagingBuffers.clear();
-                cmd->submissionID = 0;
-                m_CommandBuffersPool.push_back(cmd);
+                const PendingSubmission& submission = m_PendingSubmissions[first + i];
 
-#ifdef NVRHI_WITH_RTXMU
-                if (!cmd->rtxmuBuildIds.empty())
+                for (size_t j = 0; j < submission.commandBuffers.size(); j++)
                 {
-                    std::lock_guard lockGuard(m_Context.rtxMuResources->asListMutex);
-                    
-                    m_Context.rtxMuResources->asBuildsCompleted.insert(m_Context.rtxMuResources->asBuildsCompleted.end(),
-                        cmd->rtxmuBuildIds.begin(), cmd->rtxmuBuildIds.end());
+                    // A zero mask means all devices, so only set it with device groups
+                    commandBufferInfos.push_back(vk::CommandBufferSubmitInfo()
+                        .setCommandBuffer(submission.commandBuffers[j])
+                        .setDeviceMask(m_Context.deviceGroupSize > 1 ? submission.commandBufferDeviceMasks[j] : 0));
+                }
 
-                    cmd->rtxmuBuildIds.clear();
+                for (size_t j = 0; j < submission.waitSemaphores.size(); j++)
+                {
+                    waitInfos.push_back(vk::SemaphoreSubmitInfo()
+                        .setSemaphore(submission.waitSemaphores[j])
+                        .setValue(submission.waitSemaphoreValues[j])
+                        .setStageMask(vk::PipelineStageFlagBits2::eAllCommands));
                 }
-                if (!cmd->rtxmuCompactionIds.empty())
+
+                for (size_t j = 0; j < submission.signalSemaphores.size(); j++)
                 {
-                    m_Context.rtxMemUtil->GarbageCollection(cmd->rtxmuCompactionIds);
-                    cmd->rtxmuCompactionIds.clear();
+                    signalInfos.push_back(vk::SemaphoreSubmitInfo()
+                        .setSemaphore(submission.signalSemaphores[j])
+                        .setValue(submission.signalSemaphoreValues[j])
+                        .setStageMask(vk::PipelineStageFlagBits2::eAllCommands));
                 }
-#endif
+
+                signalInfos.push_back(vk::SemaphoreSubmitInfo()
+                    .setSemaphore(trackingSemaphore)
+                    .setValue(submission.submissionID)
+                    .setStageMask(vk::PipelineStageFlagBits2::eAllCommands));
             }
-            else
+
+            size_t commandBufferOffset = 0;
+            size_t waitOffset = 0;
+            size_t signalOffset = 0;
+            for (size_t i = 0; i < count; i++)
             {
-                m_CommandBuffersInFlight.push_back(cmd);
+                const PendingSubmission& submission = m_PendingSubmissions[first + i];
+                const size_t numEntrySignals = submission.signalSemaphores.size() + 1;
+
+                submitInfos[i]
+                    .setCommandBufferInfoCount(uint32_t(submission.commandBuffers.size()))
+                    .setPCommandBufferInfos(commandBufferInfos.data() + commandBufferOffset)
+                    .setWaitSemaphoreInfoCount(uint32_t(submission.waitSemaphores.size()))
+                    .setPWaitSemaphoreInfos(waitInfos.data() + waitOffset)
+                    .setSignalSemaphoreInfoCount(uint32_t(numEntrySignals))
+                    .setPSignalSemaphoreInfos(signalInfos.data() + signalOffset);
+
+                commandBufferOffset += submission.commandBuffers.size();
+                waitOffset += submission.waitSemaphores.size();
+                signalOffset += numEntrySignals;
             }
+
+            m_Queue.submit2(submitInfos);
+        }
+        else
+        {
+            std::vector<vk::PipelineStageFlags> waitStages;
+            std::vector<vk::Semaphore> signalSemaphores;
+            std::vector<uint64_t> signalValues;
+            std::vector<vk::TimelineSemaphoreSubmitInfo> timelineInfos(count);
+            std::vector<vk::DeviceGroupSubmitInfo> deviceGroupInfos(count);
+            std::vector<vk::SubmitInfo> submitInfos(count);
+            signalSemaphores.reserve(numSignals);
+            signalValues.reserve(numSignals);
+
+            size_t signalOffset = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                const PendingSubmission& submission = m_PendingSubmissions[first + i];
+                const size_t numEntrySignals = submission.signalSemaphores.size() + 1;
+
+                if (waitStages.size() < submission.waitSemaphores.size())
+                    waitStages.resize(submission.waitSemaphores.size(), vk::PipelineStageFlagBits::eTopOfPipe);
+
+                signalSemaphores.insert(signalSemaphores.end(), submission.signalSemaphores.begin(), submission.signalSemaphores.end());
+                signalSemaphores.push_back(trackingSemaphore);
+                signalValues.insert(signalValues.end(), submission.signalSemaphoreValues.begin(), submission.signalSemaphoreValues.end());
+                signalValues.push_back(submission.submissionID);
+
+                timelineInfos[i]
+                    .setWaitSemaphoreValueCount(uint32_t(submission.waitSemaphoreValues.size()))
+                    .setPWaitSemaphoreValues(submission.waitSemaphoreValues.data())
+                    .setSignalSemaphoreValueCount(uint32_t(numEntrySignals))
+                    .setPSignalSemaphoreValues(signalValues.data() + signalOffset);
+
+                submitInfos[i]
+                    .setCommandBufferCount(uint32_t(submission.commandBuffers.size()))
+                    .setPCommandBuffers(submission.commandBuffers.data())
+                    .setWaitSemaphoreCount(uint32_t(submission.waitSemaphores.size()))
+                    .setPWaitSemaphores(submission.waitSemaphores.data())
+                    .setSignalSemaphoreCount(uint32_t(numEntrySignals))
+                    .setPSignalSemaphores(signalSemaphores.data() + signalOffset);
+
+                signalOffset += numEntrySignals;
+            }
+
+            // The semaphore operations run on device 0; the index array is all zeros, so all entries share it
+            std::vector<uint32_t> semaphoreDeviceIndices;
+            if (m_Context.deviceGroupSize > 1)
+            {
+                size_t maxSemaphores = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    maxSemaphores = std::max(maxSemaphores, m_PendingSubmissions[first + i].waitSemaphores.size());
+                    maxSemaphores = std::max(maxSemaphores, m_PendingSubmissions[first + i].signalSemaphores.size() + 1);
+                }
+                semaphoreDeviceIndices.resize(maxSemaphores, 0);
+            }
+
+            // The wait stages are the same for every entry, so they can share the array
+            for (size_t i = 0; i < count; i++)
+            {
+                submitInfos[i]
+                    .setPNext(&timelineInfos[i])
+                    .setPWaitDstStageMask(waitStages.data());
+
+                if (m_Context.deviceGroupSize > 1)
+                {
+                    const PendingSubmission& submission = m_PendingSubmissions[first + i];
+
+                    deviceGroupInfos[i]
+                        .setWaitSemaphoreCount(uint32_t(submission.waitSemaphores.size()))
+                        .setPWaitSemaphoreDeviceIndices(semaphoreDeviceIndices.data())
+                        .setCommandBufferCount(uint32_t(submission.commandBuffers.size()))
+                        .setPCommandBufferDeviceMasks(submission.commandBufferDeviceMasks.data())
+                        .setSignalSemaphoreCount(uint32_t(submission.signalSemaphores.size() + 1))
+                        .setPSignalSemaphoreDeviceIndices(semaphoreDeviceIndices.data());
+
+                    timelineInfos[i].setPNext(&deviceGroupInfos[i]);
+                }
+            }
+
+            m_Queue.submit(submitInfos);
+        }
+    }
+
+    uint64_t Queue::updateLastFinishedID()
+    {
+        const uint64_t finishedID = m_Context.device.getSemaphoreCounterValue(trackingSemaphore);
+
+        // Two threads may race here, never let the value go backwards
+        uint64_t previousID = m_LastFinishedID.load(std::memory_order_relaxed);
+        while (previousID < finishedID && !m_LastFinishedID.compare_exchange_weak(previousID, finishedID, std::memory_order_relaxed))
+            ;
+
+        return std::max(previousID, finishedID);
+    }
+
+    bool Queue::retireCommandBuffers(std::chrono::steady_clock::time_point deadline)
+    {
+        const uint64_t lastFinishedID = updateLastFinishedID();
+        
+        while (true)
+        {
+            // The command buffers are in submission order, so the first unfinished one ends the search.
+            // Only the list operations are done under the lock, the references are released without it.
+            TrackedCommandBufferPtr cmd;
+            {
+                std::lock_guard lockGuard(m_SubmitMutex);
+
+                if (m_CommandBuffersInFlight.empty() || m_CommandBuffersInFlight.front()->submissionID > lastFinishedID)
+                    return true;
+
+                cmd = m_CommandBuffersInFlight.pop_front();
+            }
+
+            cmd->referencedResources.clear();
+            cmd->referencedStagingBuffers.clear();
+            cmd->referencedBundles.clear();
+            cmd->usedSplitBarrierEvents = 0;
+            cmd->submissionID = 0;
+
+#ifdef NVRHI_WITH_RTXMU
+            if (!cmd->rtxmuBuildIds.empty())
+            {
+                std::lock_guard lockGuard(m_Context.rtxMuResources->asListMutex);
+                
+                m_Context.rtxMuResources->asBuildsCompleted.insert(m_Context.rtxMuResources->asBuildsCompleted.end(),
+                    cmd->rtxmuBuildIds.begin(), cmd->rtxmuBuildIds.end());
+
+                cmd->rtxmuBuildIds.clear();
+            }
+            if (!cmd->rtxmuCompactionIds.empty())
+            {
+                m_Context.rtxMemUtil->GarbageCollection(cmd->rtxmuCompactionIds);
+                cmd->rtxmuCompactionIds.clear();
+            }
+#else
+            if (!cmd->compactableBuilds.empty())
+            {
+                std::lock_guard lockGuard(m_Context.compactionResources->asListMutex);
+
+                m_Context.compactionResources->asBuildsCompleted.insert(m_Context.compactionResources->asBuildsCompleted.end(),
+                    cmd->compactableBuilds.begin(), cmd->compactableBuilds.end());
+
+                cmd->compactableBuilds.clear();
+            }
+#endif
+
+            {
+                std::lock_guard lockGuard(m_Mutex);
+                m_CommandBuffersPool.push_back(std::move(cmd));
+            }
+
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
         }
     }
 
     TrackedCommandBufferPtr Queue::getCommandBufferInFlight(uint64_t submissionID)
     {
+        std::lock_guard lockGuard(m_SubmitMutex);
+
         for (const TrackedCommandBufferPtr& cmd : m_CommandBuffersInFlight)
         {
             if (cmd->submissionID == submissionID)
@@ -245,7 +561,16 @@ namespace nvrhi::vulkan
     {
         Queue& waitQueue = *m_Queues[uint32_t(waitQueueID)];
 
-        waitQueue.addWaitSemaphore(semaphore, value);
+        // A wait for another queue's submission is recorded with that queue, which is then flushed up to the
+        // waited submission when the waiting queue is flushed, see Queue::flush
+        Queue* executionQueue = nullptr;
+        for (const auto& queue : m_Queues)
+        {
+            if (queue && VkSemaphore(queue->trackingSemaphore) == semaphore)
+                executionQueue = queue.get();
+        }
+
+        waitQueue.addWaitSemaphore(semaphore, value, executionQueue);
     }
 
     void Device::queueSignalSemaphore(CommandQueue executionQueueID, VkSemaphore semaphore, uint64_t value)
@@ -257,6 +582,12 @@ namespace nvrhi::vulkan
 
     void Device::queueWaitForCommandList(CommandQueue waitQueueID, CommandQueue executionQueueID, uint64_t instance)
     {
+        if (m_AutomaticQueueSync || m_AccelStructQueueSync)
+        {
+            std::lock_guard lockGuard(m_QueueSyncMutex);
+            m_QueueSynchronizer.waitAdded(waitQueueID, executionQueueID, instance);
+        }
+
         queueWaitForSemaphore(waitQueueID, getQueueSemaphore(executionQueueID), instance);
     }
 
@@ -283,6 +614,9 @@ namespace nvrhi::vulkan
         if (commandListID > m_LastSubmittedID || commandListID == 0)
             return false;
 
+        if (commandListID > m_LastFlushedID)
+            flush(commandListID);
+
         if (pollCommandList(commandListID))
             return true;
 
@@ -23,6 +23,11 @@
 #include "vulkan-backend.h"
 #include <nvrhi/common/misc.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
 namespace nvrhi::vulkan
 {
     static vk::DeviceOrHostAddressConstKHR getBufferAddress(IBuffer* _buffer, uint64_t offset)
@@ -255,32 +260,22 @@ namespace nvrhi::vulkan
             auto buildSizes = m_Context.device.getAccelerationStructureBuildSizesKHR(
                 vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, maxPrimitiveCounts);
 
-            BufferDesc bufferDesc;
-            bufferDesc.byteSize = buildSizes.accelerationStructureSize;
-            bufferDesc.debugName = desc.debugName;
-            bufferDesc.initialState = desc.isTopLevel ? ResourceStates::AccelStructRead : ResourceStates::AccelStructBuildBlas;
-            bufferDesc.keepInitialState = true;
-            bufferDesc.isAccelStructStorage = true;
-            bufferDesc.isVirtual = desc.isVirtual;
-            as->dataBuffer = createBuffer(bufferDesc);
-
-            Buffer* dataBuffer = checked_cast<Buffer*>(as->dataBuffer.Get());
-
-            auto createInfo = vk::AccelerationStructureCreateInfoKHR()
-                .setType(desc.isTopLevel ? vk::AccelerationStructureTypeKHR::eTopLevel : vk::AccelerationStructureTypeKHR::eBottomLevel)
-                .setBuffer(dataBuffer->buffer)
-                .setSize(buildSizes.accelerationStructureSize);
-
-            as->accelStruct = m_Context.device.createAccelerationStructureKHR(createInfo, m_Context.allocationCallbacks);
-
-            if (!desc.isVirtual)
-            {
-                auto addressInfo = vk::AccelerationStructureDeviceAddressInfoKHR()
-                    .setAccelerationStructure(as->accelStruct);
+            createAccelStructStorage(as, buildSizes.accelerationStructureSize);
+        }
 
-                as->accelStructDeviceAddress = m_Context.device.getAccelerationStructureAddressKHR(addressInfo);
-            }
+#ifndef NVRHI_WITH_RTXMU
+        if (!desc.isTopLevel && !desc.isVirtual && (desc.buildFlags & rt::AccelStructBuildFlags::AllowCompaction) != 0)
+        {
+            auto poolInfo = vk::QueryPoolCreateInfo()
+                .setQueryType(vk::QueryType::eAccelerationStructureCompactedSizeKHR)
+                .setQueryCount(1);
+
+            // Without the query, the BLAS is simply not compacted
+            const vk::Result res = m_Context.device.createQueryPool(&poolInfo, m_Context.allocationCallbacks, &as->compactedSizeQueryPool);
+            if (res != vk::Result::eSuccess)
+                as->compactedSizeQueryPool = nullptr;
         }
+#endif
 
         // Sanitize the geometry data to avoid dangling pointers, we don't need these buffers in the Desc
         for (auto& geometry : as->desc.bottomLevelGeometries)
@@ -298,6 +293,37 @@ namespace nvrhi::vulkan
         return rt::AccelStructHandle::Create(as);
     }
 
+    void Device::createAccelStructStorage(AccelStruct* as, uint64_t byteSize)
+    {
+        const rt::AccelStructDesc& desc = as->desc;
+
+        BufferDesc bufferDesc;
+        bufferDesc.byteSize = byteSize;
+        bufferDesc.debugName = desc.debugName;
+        bufferDesc.initialState = desc.isTopLevel ? ResourceStates::AccelStructRead : ResourceStates::AccelStructBuildBlas;
+        bufferDesc.keepInitialState = true;
+        bufferDesc.isAccelStructStorage = true;
+        bufferDesc.isVirtual = desc.isVirtual;
+        as->dataBuffer = createBuffer(bufferDesc);
+
+        Buffer* dataBuffer = checked_cast<Buffer*>(as->dataBuffer.Get());
+
+        auto createInfo = vk::AccelerationStructureCreateInfoKHR()
+            .setType(desc.isTopLevel ? vk::AccelerationStructureTypeKHR::eTopLevel : vk::AccelerationStructureTypeKHR::eBottomLevel)
+            .setBuffer(dataBuffer->buffer)
+            .setSize(byteSize);
+
+        as->accelStruct = m_Context.device.createAccelerationStructureKHR(createInfo, m_Context.allocationCallbacks);
+
+        if (!desc.isVirtual)
+        {
+            auto addressInfo = vk::AccelerationStructureDeviceAddressInfoKHR()
+                .setAccelerationStructure(as->accelStruct);
+
+            as->accelStructDeviceAddress = m_Context.device.getAccelerationStructureAddressKHR(addressInfo);
+        }
+    }
+
     MemoryRequirements Device::getAccelStructMemoryRequirements(rt::IAccelStruct* _as)
     {
         AccelStruct* as = checked_cast<AccelStruct*>(_as);
@@ -389,162 +415,312 @@ namespace nvrhi::vulkan
         m_CurrentCmdBuf->cmdBuf.buildMicromapsEXT(1, &buildInfo);
     }
 
-    void CommandList::buildBottomLevelAccelStruct(rt::IAccelStruct* _as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags)
+    void CommandList::buildBottomLevelAccelStruct(rt::IAccelStruct* as, const rt::GeometryDesc* pGeometries, size_t numGeometries, rt::AccelStructBuildFlags buildFlags)
     {
-        AccelStruct* as = checked_cast<AccelStruct*>(_as);
+        rt::BottomLevelAccelStructBuild build;
+        build.accelStruct = as;
+        build.geometries = pGeometries;
+        build.numGeometries = numGeometries;
+        build.buildFlags = buildFlags;
 
-        const bool performUpdate = (buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
-        if (performUpdate)
-        {
-            assert(as->allowUpdate);
-        }
+        buildBottomLevelAccelStructs(&build, 1);
+    }
+
+    void CommandList::buildBottomLevelAccelStructs(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds)
+    {
+        if (numBuilds == 0)
+            return;
+
+        size_t totalGeometries = 0;
+        for (size_t buildIndex = 0; buildIndex < numBuilds; buildIndex++)
+            totalGeometries += builds[buildIndex].numGeometries;
+
+        // The geometry arrays for all builds are stored together. They must not be reallocated after the build infos
+        // point at them, and the triangle geometries point at their OMM structures.
+        std::vector<vk::AccelerationStructureGeometryKHR> geometries(totalGeometries);
+        std::vector<vk::AccelerationStructureTrianglesOpacityMicromapEXT> omms(totalGeometries);
+        std::vector<vk::AccelerationStructureBuildRangeInfoKHR> buildRanges(totalGeometries);
+        std::vector<uint32_t> maxPrimitiveCounts(totalGeometries);
 
-        std::vector<vk::AccelerationStructureGeometryKHR> geometries;
-        std::vector<vk::AccelerationStructureTrianglesOpacityMicromapEXT> omms;
-        std::vector<vk::AccelerationStructureBuildRangeInfoKHR> buildRanges;
-        std::vector<uint32_t> maxPrimitiveCounts;
-        geometries.resize(numGeometries);
-        omms.resize(numGeometries);
-        maxPrimitiveCounts.resize(numGeometries);
-        buildRanges.resize(numGeometries);
+        std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos(numBuilds);
+        std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> buildRangeArrays(numBuilds);
+        std::vector<uint64_t> scratchSizes(numBuilds, 0);
+        std::vector<bool> buildValid(numBuilds, true);
 
-        for (size_t i = 0; i < numGeometries; i++)
+        size_t firstGeometry = 0;
+        for (size_t buildIndex = 0; buildIndex < numBuilds; buildIndex++)
         {
-            convertBottomLevelGeometry(pGeometries[i], geometries[i], omms[i], maxPrimitiveCounts[i], &buildRanges[i], m_Context);
+            const rt::BottomLevelAccelStructBuild& build = builds[buildIndex];
+            AccelStruct* as = checked_cast<AccelStruct*>(build.accelStruct);
 
-            const rt::GeometryDesc& src = pGeometries[i];
+            const bool performUpdate = (build.buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
+            if (performUpdate)
+            {
+                assert(as->allowUpdate);
+            }
 
-            switch (src.geometryType)
+            for (size_t i = 0; i < build.numGeometries; i++)
             {
-            case rt::GeometryType::Triangles: {
-                const rt::GeometryTriangles& srct = src.geometryData.triangles;
-                if (m_EnableAutomaticBarriers)
+                const size_t geometryIndex = firstGeometry + i;
+                convertBottomLevelGeometry(build.geometries[i], geometries[geometryIndex], omms[geometryIndex],
+                    maxPrimitiveCounts[geometryIndex], &buildRanges[geometryIndex], m_Context);
+
+                const rt::GeometryDesc& src = build.geometries[i];
+
+                switch (src.geometryType)
                 {
-                    if (srct.indexBuffer)
-                        requireBufferState(srct.indexBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
-                    if (srct.vertexBuffer)
-                        requireBufferState(srct.vertexBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
-                    if (OpacityMicromap* om = checked_cast<OpacityMicromap*>(srct.opacityMicromap))
-                        requireBufferState(om->dataBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
+                case rt::GeometryType::Triangles: {
+                    const rt::GeometryTriangles& srct = src.geometryData.triangles;
+                    if (m_EnableAutomaticBarriers)
+                    {
+                        if (srct.indexBuffer)
+                            requireBufferState(srct.indexBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
+                        if (srct.vertexBuffer)
+                            requireBufferState(srct.vertexBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
+                        if (OpacityMicromap* om = checked_cast<OpacityMicromap*>(srct.opacityMicromap))
+                            requireBufferState(om->dataBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
+                    }
+                    break;
+                }
+                case rt::GeometryType::AABBs: {
+                    const rt::GeometryAABBs& srca = src.geometryData.aabbs;
+                    if (m_EnableAutomaticBarriers)
+                    {
+                        if (srca.buffer)
+                            requireBufferState(srca.buffer, nvrhi::ResourceStates::AccelStructBuildInput);
+                    }
+                    break;
+                }
                 }
-                break;
             }
-            case rt::GeometryType::AABBs: {
-                const rt::GeometryAABBs& srca = src.geometryData.aabbs;
-                if (m_EnableAutomaticBarriers)
+
+            vk::AccelerationStructureBuildGeometryInfoKHR& buildInfo = buildInfos[buildIndex];
+            buildInfo = vk::AccelerationStructureBuildGeometryInfoKHR()
+                .setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
+                .setMode(performUpdate ? vk::BuildAccelerationStructureModeKHR::eUpdate : vk::BuildAccelerationStructureModeKHR::eBuild)
+                .setGeometryCount(uint32_t(build.numGeometries))
+                .setPGeometries(geometries.data() + firstGeometry)
+                .setFlags(convertAccelStructBuildFlags(build.buildFlags))
+                .setDstAccelerationStructure(as->accelStruct);
+
+            if (as->allowUpdate)
+                buildInfo.flags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate;
+
+            if (performUpdate)
+                buildInfo.setSrcAccelerationStructure(as->accelStruct);
+
+            buildRangeArrays[buildIndex] = buildRanges.data() + firstGeometry;
+
+#ifndef NVRHI_WITH_RTXMU
+            auto buildSizes = m_Context.device.getAccelerationStructureBuildSizesKHR(
+                vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo,
+                vk::ArrayProxy<const uint32_t>(uint32_t(build.numGeometries), maxPrimitiveCounts.data() + firstGeometry));
+
+            if (as->compacted && !performUpdate)
+            {
+                // A full rebuild can need more than the compacted storage, go back to storage of the original size.
+                // The temporary AS object holds the compacted storage until this command list completes.
+                RefCountPtr<AccelStruct> compactedAS = RefCountPtr<AccelStruct>::Create(new AccelStruct(m_Context));
+                compactedAS->desc = as->desc;
+                m_Device->createAccelStructStorage(compactedAS, std::max(as->uncompactedSize, buildSizes.accelerationStructureSize));
+
+                if (compactedAS->accelStruct)
                 {
-                    if (srca.buffer)
-                        requireBufferState(srca.buffer, nvrhi::ResourceStates::AccelStructBuildInput);
+                    std::swap(as->dataBuffer, compactedAS->dataBuffer);
+                    std::swap(as->accelStruct, compactedAS->accelStruct);
+                    std::swap(as->accelStructDeviceAddress, compactedAS->accelStructDeviceAddress);
+                    m_CurrentCmdBuf->referencedResources.push_back(compactedAS.Get());
+
+                    buildInfo.setDstAccelerationStructure(as->accelStruct);
+                    as->compacted = false;
+                    as->compactionSavings.reset();
                 }
-                break;
             }
+
+            if (m_EnableAutomaticBarriers)
+            {
+                requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
             }
-        }
 
-        auto buildInfo = vk::AccelerationStructureBuildGeometryInfoKHR()
-            .setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
-            .setMode(performUpdate ? vk::BuildAccelerationStructureModeKHR::eUpdate : vk::BuildAccelerationStructureModeKHR::eBuild)
-            .setGeometries(geometries)
-            .setFlags(convertAccelStructBuildFlags(buildFlags))
-            .setDstAccelerationStructure(as->accelStruct);
+            if (buildSizes.accelerationStructureSize > as->dataBuffer->getDesc().byteSize)
+            {
+                std::stringstream ss;
+                ss << "BLAS " << utils::DebugNameToString(as->desc.debugName) << " build requires at least "
+                    << buildSizes.accelerationStructureSize << " bytes in the data buffer, while the allocated buffer is only "
+                    << as->dataBuffer->getDesc().byteSize << " bytes";
 
-        if (as->allowUpdate)
-            buildInfo.flags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate;
+                m_Context.error(ss.str());
+                buildValid[buildIndex] = false;
+            }
 
-        if (performUpdate)
-            buildInfo.setSrcAccelerationStructure(as->accelStruct);
-        
-#ifdef NVRHI_WITH_RTXMU
-        commitBarriers();
+            scratchSizes[buildIndex] = performUpdate
+                ? buildSizes.updateScratchSize
+                : buildSizes.buildScratchSize;
+#endif
 
-        std::array<vk::AccelerationStructureBuildGeometryInfoKHR, 1> buildInfos = { buildInfo };
-        std::array<const vk::AccelerationStructureBuildRangeInfoKHR*, 1> buildRangeArrays = { buildRanges.data() };
-        std::array<const uint32_t*, 1> maxPrimArrays = { maxPrimitiveCounts.data() };
+            firstGeometry += build.numGeometries;
+        }
+
+        // All state transitions for the batch are committed at once
+        commitBarriers();
 
-        if(as->rtxmuId == ~0ull)
+#ifdef NVRHI_WITH_RTXMU
+        // RTXMU manages the scratch memory by itself, pass the builds to it one by one
+        for (size_t buildIndex = 0; buildIndex < numBuilds; buildIndex++)
         {
-            std::vector<uint64_t> accelStructsToBuild;
-            m_Context.rtxMemUtil->PopulateBuildCommandList(m_CurrentCmdBuf->cmdBuf,
-                                                           buildInfos.data(),
-                                                           buildRangeArrays.data(),
-                                                           maxPrimArrays.data(),
-                                                           (uint32_t)buildInfos.size(),
-                                                           accelStructsToBuild);
+            AccelStruct* as = checked_cast<AccelStruct*>(builds[buildIndex].accelStruct);
+            const uint32_t* maxPrimitiveCountArray = maxPrimitiveCounts.data() + (buildRangeArrays[buildIndex] - buildRanges.data());
 
+            if(as->rtxmuId == ~0ull)
+            {
+                std::vector<uint64_t> accelStructsToBuild;
+                m_Context.rtxMemUtil->PopulateBuildCommandList(m_CurrentCmdBuf->cmdBuf,
+                                                               &buildInfos[buildIndex],
+                                                               &buildRangeArrays[buildIndex],
+                                                               &maxPrimitiveCountArray,
+                                                               1,
+                                                               accelStructsToBuild);
 
-            as->rtxmuId = accelStructsToBuild[0];
-            
-            as->rtxmuBuffer = m_Context.rtxMemUtil->GetBuffer(as->rtxmuId);
-            as->accelStruct = m_Context.rtxMemUtil->GetAccelerationStruct(as->rtxmuId);
-            as->accelStructDeviceAddress = m_Context.rtxMemUtil->GetDeviceAddress(as->rtxmuId);
 
-            m_CurrentCmdBuf->rtxmuBuildIds.push_back(as->rtxmuId);
-        }
-        else
-        {
-            std::vector<uint64_t> buildsToUpdate(1, as->rtxmuId);
+                as->rtxmuId = accelStructsToBuild[0];
+                
+                as->rtxmuBuffer = m_Context.rtxMemUtil->GetBuffer(as->rtxmuId);
+                as->accelStruct = m_Context.rtxMemUtil->GetAccelerationStruct(as->rtxmuId);
+                as->accelStructDeviceAddress = m_Context.rtxMemUtil->GetDeviceAddress(as->rtxmuId);
 
-            m_Context.rtxMemUtil->PopulateUpdateCommandList(m_CurrentCmdBuf->cmdBuf,
-                                                            buildInfos.data(),
-                                                            buildRangeArrays.data(),
-                                                            maxPrimArrays.data(),
-                                                            (uint32_t)buildInfos.size(),
-                                                            buildsToUpdate);
+                m_CurrentCmdBuf->rtxmuBuildIds.push_back(as->rtxmuId);
+            }
+            else
+            {
+                std::vector<uint64_t> buildsToUpdate(1, as->rtxmuId);
+
+                m_Context.rtxMemUtil->PopulateUpdateCommandList(m_CurrentCmdBuf->cmdBuf,
+                                                                &buildInfos[buildIndex],
+                                                                &buildRangeArrays[buildIndex],
+                                                                &maxPrimitiveCountArray,
+                                                                1,
+                                                                buildsToUpdate);
+            }
         }
 #else
+        const uint64_t scratchAlignment = m_Context.accelStructProperties.minAccelerationStructureScratchOffsetAlignment;
+        const uint64_t currentVersion = MakeVersion(m_CurrentCmdBuf->recordingID, m_CommandListParameters.queueType, false);
+        const uint64_t batchScratchLimit = std::max<uint64_t>(m_CommandListParameters.scratchBatchSize, scratchAlignment);
 
-        if (m_EnableAutomaticBarriers)
+        std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> batchInfos;
+        std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> batchRangeArrays;
+        batchInfos.reserve(numBuilds);
+        batchRangeArrays.reserve(numBuilds);
+
+        size_t buildIndex = 0;
+        while (buildIndex < numBuilds)
         {
-            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
+            // Collect the builds that fit into the scratch limit, but always take at least one build
+            size_t batchEnd = buildIndex;
+            uint64_t batchScratchSize = 0;
+            while (batchEnd < numBuilds)
+            {
+                uint64_t newScratchSize = align(batchScratchSize, scratchAlignment) + scratchSizes[batchEnd];
+                if (newScratchSize > batchScratchLimit && batchEnd > buildIndex)
+                    break;
+
+                if (buildValid[batchEnd])
+                    batchScratchSize = newScratchSize;
+                ++batchEnd;
+            }
+
+            Buffer* scratchBuffer = nullptr;
+            uint64_t scratchOffset = 0;
+
+            if (batchScratchSize > 0)
+            {
+                bool allocated = m_ScratchManager->suballocateBuffer(batchScratchSize, &scratchBuffer, &scratchOffset, nullptr,
+                    currentVersion, uint32_t(scratchAlignment));
+
+                if (!allocated)
+                {
+                    std::stringstream ss;
+                    ss << "Couldn't suballocate a scratch buffer for " << (batchEnd - buildIndex) << " BLAS build(s) starting with "
+                        << utils::DebugNameToString(builds[buildIndex].accelStruct->getDesc().debugName) << ". "
+                        "The builds require " << batchScratchSize << " bytes of scratch space.";
+
+                    m_Context.error(ss.str());
+                    buildIndex = batchEnd;
+                    continue;
+                }
+
+                assert(scratchBuffer->deviceAddress);
+            }
+
+            batchInfos.clear();
+            batchRangeArrays.clear();
+
+            uint64_t scratchAddress = scratchBuffer ? scratchBuffer->deviceAddress + scratchOffset : 0;
+            uint64_t batchScratchOffset = 0;
+            for (size_t index = buildIndex; index < batchEnd; index++)
+            {
+                if (!buildValid[index])
+                    continue;
+
+                batchScratchOffset = align(batchScratchOffset, scratchAlignment);
+                buildInfos[index].setScratchData(scratchAddress + batchScratchOffset);
+                batchScratchOffset += scratchSizes[index];
+
+                batchInfos.push_back(buildInfos[index]);
+                batchRangeArrays.push_back(buildRangeArrays[index]);
+            }
+
+            if (!batchInfos.empty())
+                m_CurrentCmdBuf->cmdBuf.buildAccelerationStructuresKHR(batchInfos, batchRangeArrays);
+
+            buildIndex = batchEnd;
         }
-        commitBarriers();
 
-        auto buildSizes = m_Context.device.getAccelerationStructureBuildSizesKHR(
-            vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfo, maxPrimitiveCounts);
+        writeCompactedSizes(builds, numBuilds, buildValid);
+#endif
 
-        if (buildSizes.accelerationStructureSize > as->dataBuffer->getDesc().byteSize)
+        for (size_t index = 0; index < numBuilds; index++)
         {
-            std::stringstream ss;
-            ss << "BLAS " << utils::DebugNameToString(as->desc.debugName) << " build requires at least "
-                << buildSizes.accelerationStructureSize << " bytes in the data buffer, while the allocated buffer is only "
-                << as->dataBuffer->getDesc().byteSize << " bytes";
-
-            m_Context.error(ss.str());
-            return;
+            if (builds[index].accelStruct->getDesc().trackLiveness)
+                m_CurrentCmdBuf->referencedResources.push_back(builds[index].accelStruct);
         }
+    }
 
-        size_t scratchSize = performUpdate
-            ? buildSizes.updateScratchSize
-            : buildSizes.buildScratchSize;
+#ifndef NVRHI_WITH_RTXMU
+    void CommandList::writeCompactedSizes(const rt::BottomLevelAccelStructBuild* builds, size_t numBuilds, const std::vector<bool>& buildValid)
+    {
+        std::vector<AccelStruct*> compactable;
+        
+        for (size_t index = 0; index < numBuilds; index++)
+        {
+            AccelStruct* as = checked_cast<AccelStruct*>(builds[index].accelStruct);
+            const bool performUpdate = (builds[index].buildFlags & rt::AccelStructBuildFlags::PerformUpdate) != 0;
 
-        Buffer* scratchBuffer = nullptr;
-        uint64_t scratchOffset = 0;
-        uint64_t currentVersion = MakeVersion(m_CurrentCmdBuf->recordingID, m_CommandListParameters.queueType, false);
+            if (!buildValid[index] || !as->compactedSizeQueryPool || as->compacted || performUpdate)
+                continue;
 
-        bool allocated = m_ScratchManager->suballocateBuffer(scratchSize, &scratchBuffer, &scratchOffset, nullptr,
-            currentVersion, m_Context.accelStructProperties.minAccelerationStructureScratchOffsetAlignment);
+            // The builds must finish before their sizes are queried. The data buffer is internal to the AS,
+            // so this barrier is placed even when automatic barriers are disabled.
+            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructBuildBlas);
 
-        if (!allocated)
-        {
-            std::stringstream ss;
-            ss << "Couldn't suballocate a scratch buffer for BLAS " << utils::DebugNameToString(as->desc.debugName) << " build. "
-                "The build requires " << scratchSize << " bytes of scratch space.";
+            compactable.push_back(as);
+        }
 
-            m_Context.error(ss.str());
+        if (compactable.empty())
             return;
-        }
-        
-        assert(scratchBuffer->deviceAddress);
-        buildInfo.setScratchData(scratchBuffer->deviceAddress + scratchOffset);
 
-        std::array<vk::AccelerationStructureBuildGeometryInfoKHR, 1> buildInfos = { buildInfo };
-        std::array<const vk::AccelerationStructureBuildRangeInfoKHR*, 1> buildRangeArrays = { buildRanges.data() };
+        commitBarriers();
 
-        m_CurrentCmdBuf->cmdBuf.buildAccelerationStructuresKHR(buildInfos, buildRangeArrays);
-#endif
-        if (as->desc.trackLiveness)
-            m_CurrentCmdBuf->referencedResources.push_back(as);
+        for (AccelStruct* as : compactable)
+        {
+            m_CurrentCmdBuf->cmdBuf.resetQueryPool(as->compactedSizeQueryPool, 0, 1);
+            m_CurrentCmdBuf->cmdBuf.writeAccelerationStructuresPropertiesKHR(1, &as->accelStruct,
+                vk::QueryType::eAccelerationStructureCompactedSizeKHR, as->compactedSizeQueryPool, 0);
+
+            m_CurrentCmdBuf->compactableBuilds.push_back(as);
+        }
     }
+#endif
 
     void CommandList::compactBottomLevelAccelStructs()
     {
@@ -563,6 +739,95 @@ namespace nvrhi::vulkan
                 m_Context.rtxMuResources->asBuildsCompleted.clear();
             }
         }
+#else
+        std::vector<rt::AccelStructHandle> completedBuilds;
+        {
+            std::lock_guard lockGuard(m_Context.compactionResources->asListMutex);
+            completedBuilds.swap(m_Context.compactionResources->asBuildsCompleted);
+        }
+
+        if (completedBuilds.empty())
+            return;
+
+        struct CompactionCopy
+        {
+            AccelStruct* as;
+            RefCountPtr<AccelStruct> compactedAS;
+            uint64_t originalSize;
+            uint64_t compactedSize;
+        };
+
+        std::vector<CompactionCopy> copies;
+
+        for (const rt::AccelStructHandle& handle : completedBuilds)
+        {
+            AccelStruct* as = checked_cast<AccelStruct*>(handle.Get());
+
+            if (as->compacted)
+                continue;
+
+            uint64_t compactedSize = 0;
+            const vk::Result res = m_Context.device.getQueryPoolResults(as->compactedSizeQueryPool, 0, 1,
+                sizeof(compactedSize), &compactedSize, sizeof(compactedSize), vk::QueryResultFlagBits::e64);
+
+            if (res != vk::Result::eSuccess)
+            {
+                std::stringstream ss;
+                ss << "Couldn't get the compacted size of BLAS " << utils::DebugNameToString(as->desc.debugName)
+                    << ", the compaction is skipped";
+                m_Context.warning(ss.str());
+                continue;
+            }
+
+            const uint64_t originalSize = as->dataBuffer->getDesc().byteSize;
+            if (compactedSize == 0 || compactedSize >= originalSize)
+                continue;
+
+            // Create the compacted storage in a temporary AS object. Its contents are swapped with the original AS
+            // after the copy, so that the temporary object holds the original storage until this command list completes.
+            RefCountPtr<AccelStruct> compactedAS = RefCountPtr<AccelStruct>::Create(new AccelStruct(m_Context));
+            compactedAS->desc = as->desc;
+            compactedAS->allowUpdate = as->allowUpdate;
+            m_Device->createAccelStructStorage(compactedAS, compactedSize);
+
+            if (!compactedAS->accelStruct)
+                continue;
+
+            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructBuildBlas);
+            requireBufferState(compactedAS->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
+
+            copies.push_back({ as, compactedAS, originalSize, compactedSize });
+        }
+
+        if (copies.empty())
+            return;
+
+        commitBarriers();
+
+        for (CompactionCopy& copy : copies)
+        {
+            AccelStruct* as = copy.as;
+
+            auto copyInfo = vk::CopyAccelerationStructureInfoKHR()
+                .setSrc(as->accelStruct)
+                .setDst(copy.compactedAS->accelStruct)
+                .setMode(vk::CopyAccelerationStructureModeKHR::eCompact);
+
+            m_CurrentCmdBuf->cmdBuf.copyAccelerationStructureKHR(copyInfo);
+
+            std::swap(as->dataBuffer, copy.compactedAS->dataBuffer);
+            std::swap(as->accelStruct, copy.compactedAS->accelStruct);
+            std::swap(as->accelStructDeviceAddress, copy.compactedAS->accelStructDeviceAddress);
+
+            as->compacted = true;
+            as->uncompactedSize = copy.originalSize;
+            as->compactionSavings = TrackedAllocation(m_Context.memoryCounters, &InternalMemoryCounters::compactionSavedBytes,
+                copy.originalSize - copy.compactedSize);
+
+            m_CurrentCmdBuf->referencedResources.push_back(copy.compactedAS.Get());
+            if (as->desc.trackLiveness)
+                m_CurrentCmdBuf->referencedResources.push_back(as);
+        }
 #endif
     }
 
@@ -575,7 +840,7 @@ namespace nvrhi::vulkan
         if (performUpdate)
         {
             assert(as->allowUpdate);
-            assert(as->instances.size() == numInstances);
+            assert(as->instances.empty() || as->instances.size() == numInstances); // empty when built from a buffer
         }
 
         auto geometry = vk::AccelerationStructureGeometryKHR()
@@ -738,6 +1003,90 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->referencedResources.push_back(as);
     }
 
+    rt::InstanceDesc* CommandList::beginTopLevelInstanceWrite(rt::IAccelStruct* _as, size_t numInstances)
+    {
+        AccelStruct* as = checked_cast<AccelStruct*>(_as);
+
+        static_assert(sizeof(rt::InstanceDesc) == sizeof(vk::AccelerationStructureInstanceKHR));
+
+        uint64_t currentVersion = MakeVersion(m_CurrentCmdBuf->recordingID, m_CommandListParameters.queueType, false);
+
+        Buffer* uploadBuffer = nullptr;
+        uint64_t uploadOffset = 0;
+        void* uploadCpuVA = nullptr;
+        if (!m_UploadManager->suballocateBuffer(std::max<size_t>(numInstances, 1) * sizeof(vk::AccelerationStructureInstanceKHR),
+            &uploadBuffer, &uploadOffset, &uploadCpuVA, currentVersion))
+        {
+            std::stringstream ss;
+            ss << "Couldn't suballocate an upload buffer for " << numInstances << " instances of TLAS "
+                << utils::DebugNameToString(as->desc.debugName);
+
+            m_Context.error(ss.str());
+            return nullptr;
+        }
+
+        m_PendingInstanceWrite.accelStruct = as;
+        m_PendingInstanceWrite.instanceData = uploadBuffer->deviceAddress + uploadOffset;
+        m_PendingInstanceWrite.numInstances = numInstances;
+
+        return static_cast<rt::InstanceDesc*>(uploadCpuVA);
+    }
+
+    void CommandList::commitTopLevelInstanceWrite(rt::IAccelStruct* _as, rt::AccelStructBuildFlags buildFlags, rt::IAccelStruct* const* bottomLevelASes, size_t numBottomLevelASes)
+    {
+        AccelStruct* as = checked_cast<AccelStruct*>(_as);
+
+        if (m_PendingInstanceWrite.accelStruct != as)
+        {
+            std::stringstream ss;
+            ss << "commitTopLevelInstanceWrite called for TLAS " << utils::DebugNameToString(as->desc.debugName)
+                << " without a matching beginTopLevelInstanceWrite";
+
+            m_Context.error(ss.str());
+            return;
+        }
+
+        const PendingInstanceWrite pending = m_PendingInstanceWrite;
+        m_PendingInstanceWrite = PendingInstanceWrite();
+
+        for (size_t i = 0; i < numBottomLevelASes; i++)
+        {
+            if (!bottomLevelASes[i])
+                continue;
+
+            AccelStruct* blas = checked_cast<AccelStruct*>(bottomLevelASes[i]);
+
+#ifndef NVRHI_WITH_RTXMU
+            if (m_EnableAutomaticBarriers)
+            {
+                requireBufferState(blas->dataBuffer, nvrhi::ResourceStates::AccelStructBuildBlas);
+            }
+#endif
+
+            if (blas->desc.trackLiveness)
+                m_CurrentCmdBuf->referencedResources.push_back(blas);
+        }
+
+#ifdef NVRHI_WITH_RTXMU
+        m_Context.rtxMemUtil->PopulateUAVBarriersCommandList(m_CurrentCmdBuf->cmdBuf, m_CurrentCmdBuf->rtxmuBuildIds);
+#endif
+
+        as->instances.clear();
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireBufferState(as->dataBuffer, nvrhi::ResourceStates::AccelStructWrite);
+        }
+        commitBarriers();
+
+        uint64_t currentVersion = MakeVersion(m_CurrentCmdBuf->recordingID, m_CommandListParameters.queueType, false);
+
+        buildTopLevelAccelStructInternal(as, pending.instanceData, pending.numInstances, buildFlags, currentVersion);
+
+        if (as->desc.trackLiveness)
+            m_CurrentCmdBuf->referencedResources.push_back(as);
+    }
+
     AccelStruct::~AccelStruct()
     {
 #ifdef NVRHI_WITH_RTXMU
@@ -757,6 +1106,12 @@ namespace nvrhi::vulkan
             m_Context.device.destroyAccelerationStructureKHR(accelStruct, m_Context.allocationCallbacks);
             accelStruct = nullptr;
         }
+
+        if (compactedSizeQueryPool)
+        {
+            m_Context.device.destroyQueryPool(compactedSizeQueryPool, m_Context.allocationCallbacks);
+            compactedSizeQueryPool = nullptr;
+        }
     }
 
     Object AccelStruct::getNativeObject(ObjectType objectType)
@@ -836,6 +1191,13 @@ namespace nvrhi::vulkan
             }
         }
 
+        if (m_CommandListParameters.enableStatistics)
+        {
+            countStateChanges(m_Statistics, {
+                !m_CurrentRayTracingState.shaderTable || m_CurrentRayTracingState.shaderTable->getPipeline() != pso,
+                arraysAreDifferent(m_CurrentRayTracingState.bindings, state.bindings) || m_AnyVolatileBufferWrites });
+        }
+
         if (m_CurrentRayTracingState.shaderTable != state.shaderTable)
         {
             m_CurrentCmdBuf->referencedResources.push_back(state.shaderTable);
@@ -853,34 +1215,18 @@ namespace nvrhi::vulkan
             bindBindingSets(vk::PipelineBindPoint::eRayTracingKHR, pso->pipelineLayout, state.bindings);
         }
 
-        // Rebuild the SBT if we're binding a new one or if it's been changed since the previous bind.
-
-        if (m_CurrentRayTracingState.shaderTable != shaderTable || m_CurrentShaderTablePointers.version != shaderTable->version)
-        {
-            const uint32_t shaderGroupHandleSize = m_Context.rayTracingPipelineProperties.shaderGroupHandleSize;
-            const uint32_t shaderGroupBaseAlignment = m_Context.rayTracingPipelineProperties.shaderGroupBaseAlignment;
-
-            const uint32_t shaderTableSize = shaderTable->getNumEntries() * shaderGroupBaseAlignment;
+        // Upload the modified SBT records, then rebuild the pointers if we're binding a new table or if its layout has changed.
 
-            // First, allocate a piece of the upload buffer. That will be our SBT on the device.
-
-            Buffer* uploadBuffer = nullptr;
-            uint64_t uploadOffset = 0;
-            uint8_t* uploadCpuVA = nullptr;
-            bool allocated = m_UploadManager->suballocateBuffer(shaderTableSize, &uploadBuffer, &uploadOffset, (void**)&uploadCpuVA,
-                MakeVersion(m_CurrentCmdBuf->recordingID, m_CommandListParameters.queueType, false),
-                shaderGroupBaseAlignment);
-
-            if (!allocated)
-            {
-                m_Context.error("Failed to suballocate an upload buffer for the SBT");
-                return;
-            }
+        if (!commitShaderTable(shaderTable))
+            return;
 
-            assert(uploadCpuVA);
-            assert(uploadBuffer);
+        Buffer* shaderTableBuffer = checked_cast<Buffer*>(shaderTable->buffer.Get());
 
-            // Copy the shader and group handles into the device SBT, record the pointers.
+        if (m_CurrentRayTracingState.shaderTable != shaderTable || m_CurrentShaderTablePointers.version != shaderTable->version ||
+            m_CurrentShaderTablePointers.buffer != shaderTableBuffer)
+        {
+            const uint32_t shaderGroupBaseAlignment = m_Context.rayTracingPipelineProperties.shaderGroupBaseAlignment;
+            const uint64_t baseAddress = shaderTableBuffer->deviceAddress + shaderTable->bufferOffset;
 
             vk::StridedDeviceAddressRegionKHR rayGenHandle;
             vk::StridedDeviceAddressRegionKHR missHandles;
@@ -890,10 +1236,7 @@ namespace nvrhi::vulkan
             // ... RayGen
 
             uint32_t sbtIndex = 0;
-            memcpy(uploadCpuVA + sbtIndex * shaderGroupBaseAlignment,
-                pso->shaderGroupHandles.data() + shaderGroupHandleSize * shaderTable->rayGenerationShader,
-                shaderGroupHandleSize);
-            rayGenHandle.setDeviceAddress(uploadBuffer->deviceAddress + uploadOffset + sbtIndex * shaderGroupBaseAlignment);
+            rayGenHandle.setDeviceAddress(baseAddress + sbtIndex * shaderGroupBaseAlignment);
             rayGenHandle.setSize(shaderGroupBaseAlignment);
             rayGenHandle.setStride(shaderGroupBaseAlignment);
             sbtIndex++;
@@ -902,46 +1245,27 @@ namespace nvrhi::vulkan
 
             if (!shaderTable->missShaders.empty())
             {
-                missHandles.setDeviceAddress(uploadBuffer->deviceAddress + uploadOffset + sbtIndex * shaderGroupBaseAlignment);
-                for (uint32_t shaderGroupIndex : shaderTable->missShaders)
-                {
-                    memcpy(uploadCpuVA + sbtIndex * shaderGroupBaseAlignment,
-                        pso->shaderGroupHandles.data() + shaderGroupHandleSize * shaderGroupIndex,
-                        shaderGroupHandleSize);
-                    sbtIndex++;
-                }
+                missHandles.setDeviceAddress(baseAddress + sbtIndex * shaderGroupBaseAlignment);
                 missHandles.setSize(shaderGroupBaseAlignment * uint32_t(shaderTable->missShaders.size()));
                 missHandles.setStride(shaderGroupBaseAlignment);
+                sbtIndex += uint32_t(shaderTable->missShaders.size());
             }
 
             // ... Hit Groups
 
             if (!shaderTable->hitGroups.empty())
             {
-                hitGroupHandles.setDeviceAddress(uploadBuffer->deviceAddress + uploadOffset + sbtIndex * shaderGroupBaseAlignment);
-                for (uint32_t shaderGroupIndex : shaderTable->hitGroups)
-                {
-                    memcpy(uploadCpuVA + sbtIndex * shaderGroupBaseAlignment,
-                        pso->shaderGroupHandles.data() + shaderGroupHandleSize * shaderGroupIndex,
-                        shaderGroupHandleSize);
-                    sbtIndex++;
-                }
+                hitGroupHandles.setDeviceAddress(baseAddress + sbtIndex * shaderGroupBaseAlignment);
                 hitGroupHandles.setSize(shaderGroupBaseAlignment * uint32_t(shaderTable->hitGroups.size()));
                 hitGroupHandles.setStride(shaderGroupBaseAlignment);
+                sbtIndex += uint32_t(shaderTable->hitGroups.size());
             }
 
             // ... Callable
 
             if (!shaderTable->callableShaders.empty())
             {
-                callableHandles.setDeviceAddress(uploadBuffer->deviceAddress + uploadOffset + sbtIndex * shaderGroupBaseAlignment);
-                for (uint32_t shaderGroupIndex : shaderTable->callableShaders)
-                {
-                    memcpy(uploadCpuVA + sbtIndex * shaderGroupBaseAlignment,
-                        pso->shaderGroupHandles.data() + shaderGroupHandleSize * shaderGroupIndex,
-                        shaderGroupHandleSize);
-                    sbtIndex++;
-                }
+                callableHandles.setDeviceAddress(baseAddress + sbtIndex * shaderGroupBaseAlignment);
                 callableHandles.setSize(shaderGroupBaseAlignment * uint32_t(shaderTable->callableShaders.size()));
                 callableHandles.setStride(shaderGroupBaseAlignment);
             }
@@ -952,8 +1276,14 @@ namespace nvrhi::vulkan
             m_CurrentShaderTablePointers.miss = missHandles;
             m_CurrentShaderTablePointers.hitGroups = hitGroupHandles;
             m_CurrentShaderTablePointers.callable = callableHandles;
+            m_CurrentShaderTablePointers.buffer = shaderTableBuffer;
             m_CurrentShaderTablePointers.version = shaderTable->version;
+
+            m_CurrentCmdBuf->referencedResources.push_back(shaderTable);
+            m_CurrentCmdBuf->referencedResources.push_back(shaderTableBuffer);
         }
+
+        requireBufferState(shaderTableBuffer, ResourceStates::ShaderResource);
         
         commitBarriers();
 
@@ -970,6 +1300,7 @@ namespace nvrhi::vulkan
 
         updateRayTracingVolatileBuffers();
 
+        countDispatches(1);
         m_CurrentCmdBuf->cmdBuf.traceRaysKHR(
             &m_CurrentShaderTablePointers.rayGen,
             &m_CurrentShaderTablePointers.miss,
@@ -978,6 +1309,101 @@ namespace nvrhi::vulkan
             args.width, args.height, args.depth);
     }
 
+    bool CommandList::commitShaderTable(ShaderTable* shaderTable)
+    {
+        RayTracingPipeline* pso = shaderTable->pipeline;
+
+        const uint32_t shaderGroupHandleSize = m_Context.rayTracingPipelineProperties.shaderGroupHandleSize;
+        const uint32_t shaderGroupBaseAlignment = m_Context.rayTracingPipelineProperties.shaderGroupBaseAlignment;
+        const uint32_t numEntries = shaderTable->getNumEntries();
+        const uint64_t shaderTableSize = uint64_t(numEntries) * shaderGroupBaseAlignment;
+
+        std::lock_guard lockGuard(shaderTable->mutex);
+
+        bool fullRewrite = shaderTable->bufferVersion != shaderTable->version;
+
+        // (Re)create the device-local table if it doesn't fit the current layout. Leave some room for growth
+        // so that adding a few records doesn't reallocate the buffer every time.
+
+        if (!shaderTable->buffer || shaderTable->buffer->getDesc().byteSize < shaderTable->bufferOffset + shaderTableSize)
+        {
+            BufferDesc bufferDesc;
+            bufferDesc.byteSize = shaderTableSize + shaderTableSize / 2 + shaderGroupBaseAlignment;
+            bufferDesc.debugName = "ShaderTable";
+            bufferDesc.isShaderBindingTable = true;
+            bufferDesc.initialState = ResourceStates::ShaderResource;
+            bufferDesc.keepInitialState = true;
+
+            shaderTable->buffer = m_Device->createBuffer(bufferDesc);
+
+            if (!shaderTable->buffer)
+            {
+                m_Context.error("Failed to create a buffer for the SBT");
+                return false;
+            }
+            
+            // The SBT regions must be aligned to shaderGroupBaseAlignment, which buffer allocations don't guarantee
+            const uint64_t deviceAddress = checked_cast<Buffer*>(shaderTable->buffer.Get())->deviceAddress;
+            shaderTable->bufferOffset = align(deviceAddress, uint64_t(shaderGroupBaseAlignment)) - deviceAddress;
+
+            fullRewrite = true;
+        }
+
+        if (!fullRewrite && shaderTable->dirtyRecords.empty())
+            return true;
+
+        std::vector<uint8_t> recordData;
+
+        auto writeRecords = [this, shaderTable, pso, shaderGroupHandleSize, shaderGroupBaseAlignment, &recordData](uint32_t firstRecord, uint32_t numRecords)
+        {
+            recordData.assign(size_t(numRecords) * shaderGroupBaseAlignment, 0);
+
+            for (uint32_t i = 0; i < numRecords; i++)
+            {
+                const int shaderGroupIndex = shaderTable->getShaderGroupForRecord(firstRecord + i);
+                if (shaderGroupIndex < 0)
+                    continue;
+
+                memcpy(recordData.data() + size_t(i) * shaderGroupBaseAlignment,
+                    pso->shaderGroupHandles.data() + size_t(shaderGroupHandleSize) * shaderGroupIndex,
+                    shaderGroupHandleSize);
+            }
+
+            requireBufferState(shaderTable->buffer, ResourceStates::CopyDest);
+            writeBuffer(shaderTable->buffer, recordData.data(), recordData.size(),
+                shaderTable->bufferOffset + uint64_t(firstRecord) * shaderGroupBaseAlignment);
+        };
+
+        if (fullRewrite)
+        {
+            writeRecords(0, numEntries);
+        }
+        else
+        {
+            // Patch the modified records, merging adjacent ones into a single write
+
+            std::vector<uint32_t>& dirtyRecords = shaderTable->dirtyRecords;
+            std::sort(dirtyRecords.begin(), dirtyRecords.end());
+            dirtyRecords.erase(std::unique(dirtyRecords.begin(), dirtyRecords.end()), dirtyRecords.end());
+
+            size_t rangeStart = 0;
+            while (rangeStart < dirtyRecords.size() && dirtyRecords[rangeStart] < numEntries)
+            {
+                size_t rangeEnd = rangeStart + 1;
+                while (rangeEnd < dirtyRecords.size() && dirtyRecords[rangeEnd] == dirtyRecords[rangeEnd - 1] + 1 && dirtyRecords[rangeEnd] < numEntries)
+                    ++rangeEnd;
+
+                writeRecords(dirtyRecords[rangeStart], uint32_t(rangeEnd - rangeStart));
+                rangeStart = rangeEnd;
+            }
+        }
+
+        shaderTable->dirtyRecords.clear();
+        shaderTable->bufferVersion = shaderTable->version;
+
+        return true;
+    }
+
     void CommandList::updateRayTracingVolatileBuffers()
     {
         if (m_AnyVolatileBufferWrites && m_CurrentRayTracingState.shaderTable)
@@ -1011,6 +1437,26 @@ namespace nvrhi::vulkan
 
     rt::PipelineHandle Device::createRayTracingPipeline(const rt::PipelineDesc& desc)
     {
+        TraceScope traceScope(m_Context.traceRecorder.get(), "createRayTracingPipeline", "Pipeline");
+
+        if ((desc.isLibrary || !desc.libraries.empty()) && !m_Context.extensions.KHR_pipeline_library)
+        {
+            m_Context.error("Ray tracing pipeline libraries require the " VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME " extension");
+            return nullptr;
+        }
+
+        for (const rt::PipelineHandle& library : desc.libraries)
+        {
+            if (!library || !library->getDesc().isLibrary)
+            {
+                m_Context.error("Pipelines linked into a ray tracing pipeline must be created with isLibrary = true");
+                return nullptr;
+            }
+        }
+
+        if (!validatePushDescriptorLayouts(desc.globalBindingLayouts, "createRayTracingPipeline"))
+            return nullptr;
+
         RayTracingPipeline* pso = new RayTracingPipeline(m_Context);
         pso->desc = desc;
 
@@ -1189,9 +1635,33 @@ namespace nvrhi::vulkan
             shaderGroups.push_back(shaderGroupCreateInfo);
         }
 
+        // Linked libraries contribute their groups after the groups of this pipeline, in the order they are listed
+
+        uint32_t numShaderGroups = uint32_t(shaderGroups.size());
+        std::vector<vk::Pipeline> libraryPipelines;
+        libraryPipelines.reserve(desc.libraries.size());
+
+        for (const rt::PipelineHandle& _library : desc.libraries)
+        {
+            RayTracingPipeline* library = checked_cast<RayTracingPipeline*>(_library.Get());
+            libraryPipelines.push_back(library->pipeline);
+
+            for (const auto& [exportName, shaderGroupIndex] : library->shaderGroups)
+                pso->shaderGroups[exportName] = numShaderGroups + shaderGroupIndex;
+
+            numShaderGroups += library->numShaderGroups;
+        }
+
+        pso->numShaderGroups = numShaderGroups;
+
         // Create the pipeline object
 
-        auto libraryInfo = vk::PipelineLibraryCreateInfoKHR();
+        auto libraryInfo = vk::PipelineLibraryCreateInfoKHR()
+            .setLibraries(libraryPipelines);
+
+        auto libraryInterface = vk::RayTracingPipelineInterfaceCreateInfoKHR()
+            .setMaxPipelineRayPayloadSize(desc.maxPayloadSize)
+            .setMaxPipelineRayHitAttributeSize(desc.maxAttributeSize);
         
         auto pipelineInfo = vk::RayTracingPipelineCreateInfoKHR()
             .setStages(shaderStages)
@@ -1200,26 +1670,131 @@ namespace nvrhi::vulkan
             .setMaxPipelineRayRecursionDepth(desc.maxRecursionDepth)
             .setPLibraryInfo(&libraryInfo);
 
-        res = m_Context.device.createRayTracingPipelinesKHR(vk::DeferredOperationKHR(), m_Context.pipelineCache,
-            1, &pipelineInfo,
-            m_Context.allocationCallbacks,
-            &pso->pipeline);
+        if (desc.isLibrary)
+            pipelineInfo.setFlags(vk::PipelineCreateFlagBits::eLibraryKHR);
+
+        // Pipelines must be created for the binding model the device uses
+        if (m_Context.descriptorBuffer)
+            pipelineInfo.flags |= vk::PipelineCreateFlagBits::eDescriptorBufferEXT;
+
+        if (desc.isLibrary || !desc.libraries.empty())
+            pipelineInfo.setPLibraryInterface(&libraryInterface);
+
+        if (m_Context.extensions.KHR_deferred_host_operations && m_TaskScheduler)
+        {
+            res = createDeferredRayTracingPipeline(pipelineInfo, pso->pipeline);
+        }
+        else
+        {
+            res = m_Context.device.createRayTracingPipelinesKHR(vk::DeferredOperationKHR(), m_Context.getPipelineCache(),
+                1, &pipelineInfo,
+                m_Context.allocationCallbacks,
+                &pso->pipeline);
+        }
 
         CHECK_VK_FAIL(res)
 
-        // Obtain the shader group handles to fill the SBT buffer later
+        // Obtain the shader group handles to fill the SBT buffer later.
+        // Libraries are not used in shader tables directly, the handles are queried from the linked pipeline.
 
-        pso->shaderGroupHandles.resize(m_Context.rayTracingPipelineProperties.shaderGroupHandleSize * shaderGroups.size());
+        if (!desc.isLibrary && numShaderGroups > 0)
+        {
+            pso->shaderGroupHandles.resize(m_Context.rayTracingPipelineProperties.shaderGroupHandleSize * numShaderGroups);
 
-        res = m_Context.device.getRayTracingShaderGroupHandlesKHR(pso->pipeline, 0, 
-            uint32_t(shaderGroups.size()), 
-            pso->shaderGroupHandles.size(), pso->shaderGroupHandles.data());
+            res = m_Context.device.getRayTracingShaderGroupHandlesKHR(pso->pipeline, 0,
+                numShaderGroups,
+                pso->shaderGroupHandles.size(), pso->shaderGroupHandles.data());
 
-        CHECK_VK_FAIL(res)
+            CHECK_VK_FAIL(res)
+        }
 
         return rt::PipelineHandle::Create(pso);
     }
 
+    vk::Result Device::createDeferredRayTracingPipeline(const vk::RayTracingPipelineCreateInfoKHR& pipelineInfo, vk::Pipeline& outPipeline)
+    {
+        vk::DeferredOperationKHR operation;
+        vk::Result res = m_Context.device.createDeferredOperationKHR(m_Context.allocationCallbacks, &operation);
+        if (res != vk::Result::eSuccess)
+        {
+            return m_Context.device.createRayTracingPipelinesKHR(vk::DeferredOperationKHR(), m_Context.getPipelineCache(),
+                1, &pipelineInfo, m_Context.allocationCallbacks, &outPipeline);
+        }
+
+        res = m_Context.device.createRayTracingPipelinesKHR(operation, m_Context.getPipelineCache(),
+            1, &pipelineInfo, m_Context.allocationCallbacks, &outPipeline);
+
+        if (res == vk::Result::eOperationDeferredKHR)
+        {
+            // Worker tasks may start after the operation has completed, or not at all before it completes.
+            // Track them so that the operation is only destroyed when no worker can touch it anymore.
+            struct JoinState
+            {
+                std::mutex mutex;
+                std::condition_variable condition;
+                uint32_t activeWorkers = 0;
+                bool finished = false;
+            };
+
+            auto state = std::make_shared<JoinState>();
+            const vk::Device device = m_Context.device;
+            const uint32_t maxConcurrency = m_Context.device.getDeferredOperationMaxConcurrencyKHR(operation);
+            const uint32_t numWorkers = std::min(maxConcurrency, m_TaskScheduler->getConcurrency());
+
+            // The calling thread joins the operation too, so it takes one of the slots
+            for (uint32_t worker = 1; worker < numWorkers; ++worker)
+            {
+                m_TaskScheduler->scheduleTask([state, device, operation]()
+                {
+                    {
+                        std::lock_guard lockGuard(state->mutex);
+                        if (state->finished)
+                            return;
+                        ++state->activeWorkers;
+                    }
+
+                    // eThreadIdleKHR means there is no work for this thread right now, leave the rest to the other threads
+                    (void)device.deferredOperationJoinKHR(operation);
+
+                    {
+                        std::lock_guard lockGuard(state->mutex);
+                        --state->activeWorkers;
+                    }
+                    state->condition.notify_all();
+                });
+            }
+
+            while (true)
+            {
+                const vk::Result joinResult = m_Context.device.deferredOperationJoinKHR(operation);
+
+                if (joinResult == vk::Result::eSuccess)
+                    break;
+
+                if (joinResult != vk::Result::eThreadDoneKHR && joinResult != vk::Result::eThreadIdleKHR)
+                    break;
+
+                // Other threads are still working on the operation
+                if (m_Context.device.getDeferredOperationResultKHR(operation) != vk::Result::eNotReady)
+                    break;
+
+                std::this_thread::yield();
+            }
+
+            {
+                std::unique_lock lock(state->mutex);
+                state->finished = true;
+                state->condition.wait(lock, [&state]() { return state->activeWorkers == 0; });
+            }
+
+            res = m_Context.device.getDeferredOperationResultKHR(operation);
+        }
+
+        m_Context.device.destroyDeferredOperationKHR(operation, m_Context.allocationCallbacks);
+
+        return res;
+    }
+
     RayTracingPipeline::~RayTracingPipeline()
     {
         if (pipeline)
@@ -1237,6 +1812,12 @@ namespace nvrhi::vulkan
 
     rt::ShaderTableHandle RayTracingPipeline::createShaderTable()
     {
+        if (desc.isLibrary)
+        {
+            m_Context.error("Cannot create a shader table for a ray tracing pipeline library");
+            return nullptr;
+        }
+
         ShaderTable* st = new ShaderTable(m_Context, this);
         return rt::ShaderTableHandle::Create(st);
     }
@@ -1284,7 +1865,7 @@ namespace nvrhi::vulkan
         if (verifyShaderGroupExists(exportName, shaderGroupIndex))
         {
             rayGenerationShader = shaderGroupIndex;
-            ++version;
+            dirtyRecords.push_back(0);
         }
     }
 
@@ -1342,6 +1923,45 @@ namespace nvrhi::vulkan
         return -1;
     }
 
+    bool ShaderTable::setRecord(std::vector<uint32_t>& records, uint32_t firstRecord, int index, const char* exportName, IBindingSet* bindings)
+    {
+        if (bindings != nullptr)
+            utils::NotSupported();
+
+        if (index < 0 || size_t(index) >= records.size())
+        {
+            std::stringstream ss;
+            ss << "Shader table record index " << index << " is out of range, the table has " << records.size() << " records of this type";
+            m_Context.error(ss.str());
+            return false;
+        }
+
+        const int shaderGroupIndex = pipeline->findShaderGroup(exportName);
+
+        if (!verifyShaderGroupExists(exportName, shaderGroupIndex))
+            return false;
+
+        records[index] = uint32_t(shaderGroupIndex);
+        dirtyRecords.push_back(firstRecord + uint32_t(index));
+
+        return true;
+    }
+
+    bool ShaderTable::setMissShader(int index, const char* exportName, IBindingSet* bindings /*= nullptr*/)
+    {
+        return setRecord(missShaders, 1, index, exportName, bindings);
+    }
+
+    bool ShaderTable::setHitGroup(int index, const char* exportName, IBindingSet* bindings /*= nullptr*/)
+    {
+        return setRecord(hitGroups, 1 + uint32_t(missShaders.size()), index, exportName, bindings);
+    }
+
+    bool ShaderTable::setCallableShader(int index, const char* exportName, IBindingSet* bindings /*= nullptr*/)
+    {
+        return setRecord(callableShaders, 1 + uint32_t(missShaders.size() + hitGroups.size()), index, exportName, bindings);
+    }
+
     void ShaderTable::clearMissShaders()
     {
         missShaders.clear();
@@ -1367,4 +1987,24 @@ namespace nvrhi::vulkan
             uint32_t(hitGroups.size()) +
             uint32_t(callableShaders.size());
     }
+
+    int ShaderTable::getShaderGroupForRecord(uint32_t recordIndex) const
+    {
+        if (recordIndex == 0)
+            return rayGenerationShader;
+        recordIndex -= 1;
+
+        if (recordIndex < missShaders.size())
+            return int(missShaders[recordIndex]);
+        recordIndex -= uint32_t(missShaders.size());
+
+        if (recordIndex < hitGroups.size())
+            return int(hitGroups[recordIndex]);
+        recordIndex -= uint32_t(hitGroups.size());
+
+        if (recordIndex < callableShaders.size())
+            return int(callableShaders[recordIndex]);
+
+        return -1;
+    }
 } // namespace nvrhi::vulkan
@@ -23,11 +23,38 @@
 #include "vulkan-backend.h"
 #include <nvrhi/common/misc.h>
 
+#include <algorithm>
+
 namespace nvrhi::vulkan
 {
 
     BindingLayoutHandle Device::createBindingLayout(const BindingLayoutDesc& desc)
     {
+        if (desc.usePushDescriptors && m_Context.extensions.KHR_push_descriptor)
+        {
+            for (const BindingLayoutItem& item : desc.bindings)
+            {
+                if (item.type == ResourceType::VolatileConstantBuffer)
+                {
+                    m_Context.error("Binding layouts that use push descriptors cannot contain volatile constant buffers");
+                    return nullptr;
+                }
+            }
+
+            // Every item except the push constants is one descriptor, see the BindingLayout constructor
+            const size_t numDescriptors = std::count_if(desc.bindings.begin(), desc.bindings.end(),
+                [](const BindingLayoutItem& item) { return item.type != ResourceType::PushConstants; });
+
+            if (numDescriptors > m_Context.pushDescriptorProperties.maxPushDescriptors)
+            {
+                std::stringstream ss;
+                ss << "Binding layouts that use push descriptors can have at most "
+                   << m_Context.pushDescriptorProperties.maxPushDescriptors << " descriptors, this one has " << numDescriptors;
+                m_Context.error(ss.str());
+                return nullptr;
+            }
+        }
+
         BindingLayout* ret = new BindingLayout(m_Context, desc);
 
         ret->bake();
@@ -35,6 +62,28 @@ namespace nvrhi::vulkan
         return BindingLayoutHandle::Create(ret);
     }
 
+    bool Device::validatePushDescriptorLayouts(const BindingLayoutVector& layouts, const char* operation) const
+    {
+        uint32_t numPushDescriptorLayouts = 0;
+        for (const BindingLayoutHandle& _layout : layouts)
+        {
+            const BindingLayout* layout = checked_cast<const BindingLayout*>(_layout.Get());
+            if (layout && layout->pushDescriptors)
+                ++numPushDescriptorLayouts;
+        }
+
+        if (numPushDescriptorLayouts > 1)
+        {
+            std::stringstream ss;
+            ss << operation << ": " << numPushDescriptorLayouts << " binding layouts use push descriptors, "
+                "but a Vulkan pipeline layout can only contain one of them";
+            m_Context.error(ss.str());
+            return false;
+        }
+
+        return true;
+    }
+
     BindingLayoutHandle Device::createBindlessLayout(const BindlessLayoutDesc& desc)
     {
         BindingLayout* ret = new BindingLayout(m_Context, desc);
@@ -47,6 +96,7 @@ namespace nvrhi::vulkan
     BindingLayout::BindingLayout(const VulkanContext& context, const BindingLayoutDesc& _desc)
         : desc(_desc)
         , isBindless(false)
+        , pushDescriptors(_desc.usePushDescriptors && context.extensions.KHR_push_descriptor)
         , m_Context(context)
     {
         vk::ShaderStageFlagBits shaderStageFlags = convertShaderTypeToShaderStageFlagBits(desc.visibility);
@@ -99,7 +149,10 @@ namespace nvrhi::vulkan
 
             case ResourceType::VolatileConstantBuffer:
                 registerOffset = _desc.bindingOffsets.constantBuffer;
-                descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+                // Descriptor buffers have no dynamic offsets, the descriptors are rewritten for each version instead
+                descriptorType = context.descriptorBuffer
+                    ? vk::DescriptorType::eUniformBuffer
+                    : vk::DescriptorType::eUniformBufferDynamic;
                 break;
 
             case ResourceType::Sampler:
@@ -143,6 +196,7 @@ namespace nvrhi::vulkan
     BindingLayout::BindingLayout(const VulkanContext& context, const BindlessLayoutDesc& _desc)
         : bindlessDesc(_desc)
         , isBindless(true)
+        , pushDescriptors(false)
         , m_Context(context)
     {
         desc.visibility = bindlessDesc.visibility;
@@ -238,7 +292,23 @@ namespace nvrhi::vulkan
             .setBindingCount(uint32_t(vulkanLayoutBindings.size()))
             .setPBindings(vulkanLayoutBindings.data());
 
-        std::vector<vk::DescriptorBindingFlags> bindFlag(vulkanLayoutBindings.size(), vk::DescriptorBindingFlagBits::ePartiallyBound);
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound;
+
+        // All set layouts in a pipeline layout must agree on the descriptor buffer flag, so push descriptor layouts
+        // have it too (which requires descriptorBufferPushDescriptors). They just never get a range of the buffer.
+        const bool useDescriptorBuffer = m_Context.descriptorBuffer != nullptr;
+
+        // With update-after-bind, descriptor table writes and resizes don't invalidate the command buffers
+        // that use the table, so it never needs to be bound again after growing.
+        // Descriptor buffers behave that way without any flags.
+        if (isBindless && m_Context.descriptorUpdateAfterBindSupported && !useDescriptorBuffer)
+        {
+            bindingFlags |= vk::DescriptorBindingFlagBits::eUpdateAfterBind
+                | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+            descriptorSetLayoutInfo.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool);
+        }
+
+        std::vector<vk::DescriptorBindingFlags> bindFlag(vulkanLayoutBindings.size(), bindingFlags);
 
         auto extendedInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo()
             .setBindingCount(uint32_t(vulkanLayoutBindings.size()))
@@ -249,11 +319,36 @@ namespace nvrhi::vulkan
             descriptorSetLayoutInfo.setPNext(&extendedInfo);
         }
 
+        if (pushDescriptors)
+        {
+            descriptorSetLayoutInfo.setFlags(vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR);
+        }
+
+        if (useDescriptorBuffer)
+        {
+            descriptorSetLayoutInfo.flags |= vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT;
+        }
+
         const vk::Result res = m_Context.device.createDescriptorSetLayout(&descriptorSetLayoutInfo,
                                                                         m_Context.allocationCallbacks,
                                                                         &descriptorSetLayout);
         CHECK_VK_RETURN(res)
 
+        if (useDescriptorBuffer)
+        {
+            m_Context.device.getDescriptorSetLayoutSizeEXT(descriptorSetLayout, &descriptorBufferSize);
+
+            descriptorBufferBindingOffsets.resize(vulkanLayoutBindings.size());
+            for (size_t index = 0; index < vulkanLayoutBindings.size(); index++)
+            {
+                m_Context.device.getDescriptorSetLayoutBindingOffsetEXT(descriptorSetLayout,
+                    vulkanLayoutBindings[index].binding, &descriptorBufferBindingOffsets[index]);
+            }
+
+            // No pools are needed, and push descriptor layouts have no sets at all
+            return vk::Result::eSuccess;
+        }
+
         // count the number of descriptors required per type
         std::unordered_map<vk::DescriptorType, uint32_t> poolSizeMap;
         for (auto layoutBinding : vulkanLayoutBindings)
@@ -280,8 +375,84 @@ namespace nvrhi::vulkan
         return vk::Result::eSuccess;
     }
 
+    vk::Result BindingLayout::allocateDescriptorSet(vk::DescriptorSet& outSet, vk::DescriptorPool& outPool)
+    {
+        std::lock_guard lockGuard(m_DescriptorSetMutex);
+
+        if (!m_FreeDescriptorSets.empty())
+        {
+            outSet = m_FreeDescriptorSets.back().first;
+            outPool = m_FreeDescriptorSets.back().second;
+            m_FreeDescriptorSets.pop_back();
+            return vk::Result::eSuccess;
+        }
+
+        if (m_FreeSetsInCurrentPool == 0)
+        {
+            // Bindless layouts have large variable-size bindings, so give each of them a separate pool.
+            // Regular layouts start with small pools and double their size up to a limit.
+            constexpr uint32_t c_MinSetsPerPool = 16;
+            constexpr uint32_t c_MaxSetsPerPool = 256;
+
+            if (isBindless)
+                m_SetsPerPool = 1;
+            else
+                m_SetsPerPool = (m_SetsPerPool == 0) ? c_MinSetsPerPool : std::min(m_SetsPerPool * 2, c_MaxSetsPerPool);
+
+            std::vector<vk::DescriptorPoolSize> poolSizes = descriptorPoolSizeInfo;
+            for (auto& poolSize : poolSizes)
+                poolSize.descriptorCount *= m_SetsPerPool;
+
+            auto poolInfo = vk::DescriptorPoolCreateInfo()
+                .setPoolSizeCount(uint32_t(poolSizes.size()))
+                .setPPoolSizes(poolSizes.data())
+                .setMaxSets(m_SetsPerPool);
+
+            if (isBindless && m_Context.descriptorUpdateAfterBindSupported)
+                poolInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind);
+
+            vk::DescriptorPool pool;
+            const vk::Result res = m_Context.device.createDescriptorPool(&poolInfo,
+                                                                       m_Context.allocationCallbacks,
+                                                                       &pool);
+            CHECK_VK_RETURN(res)
+
+            m_DescriptorPools.push_back(pool);
+            m_FreeSetsInCurrentPool = m_SetsPerPool;
+        }
+
+        outPool = m_DescriptorPools.back();
+
+        auto descriptorSetAllocInfo = vk::DescriptorSetAllocateInfo()
+            .setDescriptorPool(outPool)
+            .setDescriptorSetCount(1)
+            .setPSetLayouts(&descriptorSetLayout);
+
+        const vk::Result res = m_Context.device.allocateDescriptorSets(&descriptorSetAllocInfo, &outSet);
+        CHECK_VK_RETURN(res)
+
+        --m_FreeSetsInCurrentPool;
+
+        return vk::Result::eSuccess;
+    }
+
+    void BindingLayout::releaseDescriptorSet(vk::DescriptorSet set, vk::DescriptorPool pool)
+    {
+        std::lock_guard lockGuard(m_DescriptorSetMutex);
+
+        m_FreeDescriptorSets.push_back(std::make_pair(set, pool));
+    }
+
     BindingLayout::~BindingLayout()
     {
+        // destroying the pools frees all descriptor sets allocated from them
+        for (vk::DescriptorPool pool : m_DescriptorPools)
+        {
+            m_Context.device.destroyDescriptorPool(pool, m_Context.allocationCallbacks);
+        }
+        m_DescriptorPools.clear();
+        m_FreeDescriptorSets.clear();
+
         if (descriptorSetLayout)
         {
             m_Context.device.destroyDescriptorSetLayout(descriptorSetLayout, m_Context.allocationCallbacks);
@@ -289,7 +460,7 @@ namespace nvrhi::vulkan
         }
     }
 
-    static Texture::TextureSubresourceViewType getTextureViewType(Format bindingFormat, Format textureFormat)
+    Texture::TextureSubresourceViewType Texture::getTextureViewType(Format bindingFormat, Format textureFormat)
     {
         Format format = (bindingFormat == Format::UNKNOWN) ? textureFormat : bindingFormat;
 
@@ -303,46 +474,11 @@ namespace nvrhi::vulkan
             return Texture::TextureSubresourceViewType::AllAspects;
     }
 
-    BindingSetHandle Device::createBindingSet(const BindingSetDesc& desc, IBindingLayout* _layout)
+    void generateDescriptorWrites(const VulkanContext& context, const BindingSetDesc& desc, const BindingLayout* layout,
+        vk::DescriptorSet descriptorSet, DescriptorWriteData& outData)
     {
-        BindingLayout* layout = checked_cast<BindingLayout*>(_layout);
-
-        BindingSet *ret = new BindingSet(m_Context);
-        ret->desc = desc;
-        ret->layout = layout;
-
-        const auto& descriptorSetLayout = layout->descriptorSetLayout;
-        const auto& poolSizes = layout->descriptorPoolSizeInfo;
-
-        // create descriptor pool to allocate a descriptor from
-        auto poolInfo = vk::DescriptorPoolCreateInfo()
-            .setPoolSizeCount(uint32_t(poolSizes.size()))
-            .setPPoolSizes(poolSizes.data())
-            .setMaxSets(1);
-
-        vk::Result res = m_Context.device.createDescriptorPool(&poolInfo,
-                                                             m_Context.allocationCallbacks,
-                                                             &ret->descriptorPool);
-        CHECK_VK_FAIL(res)
-        
-        // create the descriptor set
-        auto descriptorSetAllocInfo = vk::DescriptorSetAllocateInfo()
-            .setDescriptorPool(ret->descriptorPool)
-            .setDescriptorSetCount(1)
-            .setPSetLayouts(&descriptorSetLayout);
-
-        res = m_Context.device.allocateDescriptorSets(&descriptorSetAllocInfo,
-            &ret->descriptorSet);
-        CHECK_VK_FAIL(res)
-        
-        // collect all of the descriptor write data
-        static_vector<vk::DescriptorImageInfo, c_MaxBindingsPerLayout> descriptorImageInfo;
-        static_vector<vk::DescriptorBufferInfo, c_MaxBindingsPerLayout> descriptorBufferInfo;
-        static_vector<vk::WriteDescriptorSet, c_MaxBindingsPerLayout> descriptorWriteInfo;
-        static_vector<vk::WriteDescriptorSetAccelerationStructureKHR, c_MaxBindingsPerLayout> accelStructWriteInfo;
-
         auto generateWriteDescriptorData =
-            // generates a vk::WriteDescriptorSet struct in descriptorWriteInfo
+            // generates a vk::WriteDescriptorSet struct in outData.writes
             [&](uint32_t bindingLocation,
                 vk::DescriptorType descriptorType,
                 vk::DescriptorImageInfo *imageInfo,
@@ -350,9 +486,9 @@ namespace nvrhi::vulkan
                 vk::BufferView *bufferView,
                 const void* pNext = nullptr)
         {
-            descriptorWriteInfo.push_back(
+            outData.writes.push_back(
                 vk::WriteDescriptorSet()
-                .setDstSet(ret->descriptorSet)
+                .setDstSet(descriptorSet)
                 .setDstBinding(bindingLocation)
                 .setDstArrayElement(0)
                 .setDescriptorCount(1)
@@ -362,6 +498,7 @@ namespace nvrhi::vulkan
                 .setPTexelBufferView(bufferView)
                 .setPNext(pNext)
             );
+            outData.addressInfo.emplace_back();
         };
 
         for (size_t bindingIndex = 0; bindingIndex < desc.bindings.size(); bindingIndex++)
@@ -374,8 +511,6 @@ namespace nvrhi::vulkan
                 continue;
             }
 
-            ret->resources.push_back(binding.resourceHandle); // keep a strong reference to the resource
-
             switch (binding.type)
             {
             case ResourceType::Texture_SRV:
@@ -383,10 +518,10 @@ namespace nvrhi::vulkan
                 const auto texture = checked_cast<Texture *>(binding.resourceHandle);
 
                 const auto subresource = binding.subresources.resolve(texture->desc, false);
-                const auto textureViewType = getTextureViewType(binding.format, texture->desc.format);
+                const auto textureViewType = Texture::getTextureViewType(binding.format, texture->desc.format);
                 auto& view = texture->getSubresourceView(subresource, binding.dimension, binding.format, vk::ImageUsageFlagBits::eSampled, textureViewType);
 
-                auto& imageInfo = descriptorImageInfo.emplace_back();
+                auto& imageInfo = outData.imageInfo.emplace_back();
                 imageInfo = vk::DescriptorImageInfo()
                     .setImageView(view.view)
                     .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
@@ -396,11 +531,11 @@ namespace nvrhi::vulkan
                     &imageInfo, nullptr, nullptr);
 
                 if (!texture->permanentState)
-                    ret->bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
+                    outData.bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
                 else
                     verifyPermanentResourceState(texture->permanentState,
                         ResourceStates::ShaderResource,
-                        true, texture->desc.debugName, m_Context.messageCallback);
+                        true, texture->desc.debugName, context.messageCallback);
             }
 
             break;
@@ -410,10 +545,10 @@ namespace nvrhi::vulkan
                 const auto texture = checked_cast<Texture *>(binding.resourceHandle);
 
                 const auto subresource = binding.subresources.resolve(texture->desc, true);
-                const auto textureViewType = getTextureViewType(binding.format, texture->desc.format);
+                const auto textureViewType = Texture::getTextureViewType(binding.format, texture->desc.format);
                 auto& view = texture->getSubresourceView(subresource, binding.dimension, binding.format, vk::ImageUsageFlagBits::eStorage, textureViewType);
 
-                auto& imageInfo = descriptorImageInfo.emplace_back();
+                auto& imageInfo = outData.imageInfo.emplace_back();
                 imageInfo = vk::DescriptorImageInfo()
                     .setImageView(view.view)
                     .setImageLayout(vk::ImageLayout::eGeneral);
@@ -423,11 +558,11 @@ namespace nvrhi::vulkan
                     &imageInfo, nullptr, nullptr);
 
                 if (!texture->permanentState)
-                    ret->bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
+                    outData.bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
                 else
                     verifyPermanentResourceState(texture->permanentState,
                         ResourceStates::UnorderedAccess,
-                        true, texture->desc.debugName, m_Context.messageCallback);
+                        true, texture->desc.debugName, context.messageCallback);
             }
 
             break;
@@ -457,6 +592,9 @@ namespace nvrhi::vulkan
                 nvrhi::hash_combine(viewInfoHash, range.byteSize);
                 nvrhi::hash_combine(viewInfoHash, (uint64_t)vkformat);
 
+                // Binding sets and descriptor tables may be created from several threads at once
+                std::lock_guard viewCacheLockGuard(buffer->viewCacheMutex);
+
                 const auto& bufferViewFound = buffer->viewCache.find(viewInfoHash);
                 auto& bufferViewRef = (bufferViewFound != buffer->viewCache.end()) ? bufferViewFound->second : buffer->viewCache[viewInfoHash];
                 if (bufferViewFound == buffer->viewCache.end())
@@ -469,7 +607,7 @@ namespace nvrhi::vulkan
                         .setRange(range.byteSize)
                         .setFormat(vk::Format(vkformat));
 
-                    res = m_Context.device.createBufferView(&bufferViewInfo, m_Context.allocationCallbacks, &bufferViewRef);
+                    const vk::Result res = context.device.createBufferView(&bufferViewInfo, context.allocationCallbacks, &bufferViewRef);
                     ASSERT_VK_OK(res);
                 }
 
@@ -477,12 +615,17 @@ namespace nvrhi::vulkan
                     layoutBinding.descriptorType,
                     nullptr, nullptr, &bufferViewRef);
 
+                outData.addressInfo.back() = vk::DescriptorAddressInfoEXT()
+                    .setAddress(buffer->deviceAddress + range.byteOffset)
+                    .setRange(range.byteSize)
+                    .setFormat(vk::Format(vkformat));
+
                 if (!buffer->permanentState)
-                    ret->bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
+                    outData.bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
                 else
                     verifyPermanentResourceState(buffer->permanentState, 
                         isUAV ? ResourceStates::UnorderedAccess : ResourceStates::ShaderResource,
-                        false, buffer->desc.debugName, m_Context.messageCallback);
+                        false, buffer->desc.debugName, context.messageCallback);
             }
             break;
 
@@ -504,7 +647,7 @@ namespace nvrhi::vulkan
 
                 const auto range = binding.range.resolve(buffer->desc);
 
-                auto& bufferInfo = descriptorBufferInfo.emplace_back();
+                auto& bufferInfo = outData.bufferInfo.emplace_back();
                 bufferInfo = vk::DescriptorBufferInfo()
                     .setBuffer(buffer->buffer)
                     .setOffset(range.byteOffset)
@@ -515,15 +658,27 @@ namespace nvrhi::vulkan
                     layoutBinding.descriptorType,
                     nullptr, &bufferInfo, nullptr);
 
+                outData.addressInfo.back() = vk::DescriptorAddressInfoEXT()
+                    .setAddress(buffer->deviceAddress + range.byteOffset)
+                    .setRange(range.byteSize);
+
                 if (binding.type == ResourceType::VolatileConstantBuffer) 
                 {
                     assert(buffer->desc.isVolatile);
-                    ret->volatileConstantBuffers.push_back(buffer);
+                    outData.volatileConstantBuffers.push_back(buffer);
+
+                    if (!layout->descriptorBufferBindingOffsets.empty())
+                    {
+                        VolatileBufferDescriptor& volatileDescriptor = outData.volatileBufferDescriptors.emplace_back();
+                        volatileDescriptor.descriptorOffset = layout->descriptorBufferBindingOffsets[bindingIndex];
+                        volatileDescriptor.rangeOffset = range.byteOffset;
+                        volatileDescriptor.rangeSize = range.byteSize;
+                    }
                 }
                 else
                 {
                     if (!buffer->permanentState)
-                        ret->bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
+                        outData.bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
                     else
                     {
                         ResourceStates requiredState;
@@ -535,7 +690,7 @@ namespace nvrhi::vulkan
                             requiredState = ResourceStates::ShaderResource;
 
                         verifyPermanentResourceState(buffer->permanentState, requiredState,
-                            false, buffer->desc.debugName, m_Context.messageCallback);
+                            false, buffer->desc.debugName, context.messageCallback);
                     }
                 }
             }
@@ -546,7 +701,7 @@ namespace nvrhi::vulkan
             {
                 const auto sampler = checked_cast<Sampler *>(binding.resourceHandle);
 
-                auto& imageInfo = descriptorImageInfo.emplace_back();
+                auto& imageInfo = outData.imageInfo.emplace_back();
                 imageInfo = vk::DescriptorImageInfo()
                     .setSampler(sampler->sampler);
 
@@ -561,7 +716,7 @@ namespace nvrhi::vulkan
             {
                 const auto as = checked_cast<AccelStruct*>(binding.resourceHandle);
 
-                auto& accelStructWrite = accelStructWriteInfo.emplace_back();
+                auto& accelStructWrite = outData.accelStructInfo.emplace_back();
                 accelStructWrite.accelerationStructureCount = 1;
                 accelStructWrite.pAccelerationStructures = &as->accelStruct;
 
@@ -569,7 +724,9 @@ namespace nvrhi::vulkan
                     layoutBinding.descriptorType,
                     nullptr, nullptr, nullptr, &accelStructWrite);
 
-                ret->bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
+                outData.addressInfo.back().setAddress(as->accelStructDeviceAddress);
+
+                outData.bindingsThatNeedTransitions.push_back(static_cast<uint16_t>(bindingIndex));
             }
 
             break;
@@ -583,18 +740,423 @@ namespace nvrhi::vulkan
                 utils::InvalidEnum();
                 break;
             }
+
+            // every binding generates at most one write
+            if (outData.writes.size() > outData.writeLayoutBindings.size())
+                outData.writeLayoutBindings.push_back(static_cast<uint16_t>(bindingIndex));
         }
+    }
 
-        m_Context.device.updateDescriptorSets(uint32_t(descriptorWriteInfo.size()), descriptorWriteInfo.data(), 0, nullptr);
+    static size_t getDescriptorSize(const VulkanContext& context, vk::DescriptorType type)
+    {
+        const vk::PhysicalDeviceDescriptorBufferPropertiesEXT& props = context.descriptorBufferProperties;
+
+        switch (type)  // NOLINT(clang-diagnostic-switch-enum)
+        {
+        case vk::DescriptorType::eSampler:
+            return props.samplerDescriptorSize;
+        case vk::DescriptorType::eSampledImage:
+            return props.sampledImageDescriptorSize;
+        case vk::DescriptorType::eStorageImage:
+            return props.storageImageDescriptorSize;
+        case vk::DescriptorType::eUniformTexelBuffer:
+            return props.uniformTexelBufferDescriptorSize;
+        case vk::DescriptorType::eStorageTexelBuffer:
+            return props.storageTexelBufferDescriptorSize;
+        case vk::DescriptorType::eUniformBuffer:
+            return props.uniformBufferDescriptorSize;
+        case vk::DescriptorType::eStorageBuffer:
+            return props.storageBufferDescriptorSize;
+        case vk::DescriptorType::eAccelerationStructureKHR:
+            return props.accelerationStructureDescriptorSize;
+        default:
+            utils::InvalidEnum();
+            return 0;
+        }
+    }
+
+    vk::DeviceSize BindingLayout::getDescriptorTableSize(uint32_t capacity) const
+    {
+        vk::DeviceSize size = 0;
+        for (size_t index = 0; index < vulkanLayoutBindings.size(); index++)
+        {
+            const vk::DeviceSize end = descriptorBufferBindingOffsets[index]
+                + vk::DeviceSize(capacity) * getDescriptorSize(m_Context, vulkanLayoutBindings[index].descriptorType);
+            size = std::max(size, end);
+        }
+        return size;
+    }
+
+    // Writes one descriptor with vkGetDescriptorEXT. Images and samplers are described by imageInfo,
+    // buffers and acceleration structures by addressInfo.
+    static void getDescriptor(const VulkanContext& context, vk::DescriptorType type,
+        const vk::DescriptorImageInfo* imageInfo, const vk::DescriptorAddressInfoEXT* addressInfo, uint8_t* dest)
+    {
+        vk::DescriptorDataEXT data;
+
+        switch (type)  // NOLINT(clang-diagnostic-switch-enum)
+        {
+        case vk::DescriptorType::eSampler:
+            data.setPSampler(&imageInfo->sampler);
+            break;
+        case vk::DescriptorType::eSampledImage:
+            data.setPSampledImage(imageInfo);
+            break;
+        case vk::DescriptorType::eStorageImage:
+            data.setPStorageImage(imageInfo);
+            break;
+        case vk::DescriptorType::eUniformTexelBuffer:
+            data.setPUniformTexelBuffer(addressInfo);
+            break;
+        case vk::DescriptorType::eStorageTexelBuffer:
+            data.setPStorageTexelBuffer(addressInfo);
+            break;
+        case vk::DescriptorType::eUniformBuffer:
+            data.setPUniformBuffer(addressInfo);
+            break;
+        case vk::DescriptorType::eStorageBuffer:
+            data.setPStorageBuffer(addressInfo);
+            break;
+        case vk::DescriptorType::eAccelerationStructureKHR:
+            data.setAccelerationStructure(addressInfo->address);
+            break;
+        default:
+            utils::InvalidEnum();
+            return;
+        }
+
+        const auto getInfo = vk::DescriptorGetInfoEXT()
+            .setType(type)
+            .setData(data);
+
+        context.device.getDescriptorEXT(&getInfo, getDescriptorSize(context, type), dest);
+    }
+
+    void writeDescriptorBufferSet(const VulkanContext& context, const BindingLayout* layout, const DescriptorWriteData& writeData, uint8_t* setData)
+    {
+        for (size_t index = 0; index < writeData.writes.size(); index++)
+        {
+            const vk::WriteDescriptorSet& write = writeData.writes[index];
+            const vk::DeviceSize offset = layout->descriptorBufferBindingOffsets[writeData.writeLayoutBindings[index]]
+                + write.dstArrayElement * getDescriptorSize(context, write.descriptorType);
+
+            getDescriptor(context, write.descriptorType, write.pImageInfo, &writeData.addressInfo[index], setData + offset);
+        }
+    }
+
+    DescriptorBuffer::~DescriptorBuffer()
+    {
+        if (mappedMemory)
+        {
+            m_Allocator.unmapMemory(this);
+            mappedMemory = nullptr;
+        }
+
+        if (buffer)
+        {
+            m_Context.device.destroyBuffer(buffer, m_Context.allocationCallbacks);
+            buffer = vk::Buffer();
+        }
+
+        if (memory)
+        {
+            m_Allocator.freeMemory(this);
+        }
+    }
+
+    vk::Result DescriptorBuffer::create(vk::DeviceSize size)
+    {
+        // Samplers and resources share the buffer, so it has to fit the limits for both
+        const vk::PhysicalDeviceDescriptorBufferPropertiesEXT& props = m_Context.descriptorBufferProperties;
+        size = std::min({ size, props.maxResourceDescriptorBufferRange, props.maxSamplerDescriptorBufferRange });
+
+        // Some implementations store push descriptors in a buffer that the application binds
+        vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT
+            | vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT
+            | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+        if (!props.bufferlessPushDescriptors)
+            usage |= vk::BufferUsageFlagBits::ePushDescriptorsDescriptorBufferEXT;
+
+        auto bufferInfo = vk::BufferCreateInfo()
+            .setSize(size)
+            .setUsage(usage)
+            .setSharingMode(vk::SharingMode::eExclusive);
+
+        vk::Result res = m_Context.device.createBuffer(&bufferInfo, m_Context.allocationCallbacks, &buffer);
+        CHECK_VK_RETURN(res)
+
+        vk::MemoryRequirements memRequirements;
+        m_Context.device.getBufferMemoryRequirements(buffer, &memRequirements);
+
+        // The GPU reads the descriptors for every draw, so prefer video memory that the CPU can write (resizable BAR)
+        const vk::MemoryPropertyFlags hostMemory = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        res = vk::Result::eErrorOutOfDeviceMemory;
+        if (m_Context.deviceLocalHostVisibleMemory)
+            res = m_Allocator.allocateMemory(this, memRequirements, hostMemory | vk::MemoryPropertyFlagBits::eDeviceLocal, true, false, nullptr, buffer);
+        if (res != vk::Result::eSuccess)
+            res = m_Allocator.allocateMemory(this, memRequirements, hostMemory, true, false, nullptr, buffer);
+        CHECK_VK_RETURN(res)
+
+        m_Context.device.bindBufferMemory(buffer, memory, 0);
+
+        mappedMemory = static_cast<uint8_t*>(m_Allocator.mapMemory(this, 0, size));
+        deviceAddress = m_Context.device.getBufferAddress(vk::BufferDeviceAddressInfo().setBuffer(buffer));
+
+        m_Context.nameVKObject(VkBuffer(buffer), vk::DebugReportObjectTypeEXT::eBuffer, "NVRHI descriptor buffer");
+
+        m_Ranges.reset(size);
+
+        return vk::Result::eSuccess;
+    }
+
+    RefCountPtr<DescriptorBufferRange> DescriptorBuffer::allocate(vk::DeviceSize size)
+    {
+        const vk::DeviceSize alignment = m_Context.descriptorBufferProperties.descriptorBufferOffsetAlignment;
+        size = align(std::max(size, alignment), alignment);
+
+        uint64_t offset = 0;
+        {
+            std::lock_guard lockGuard(m_Mutex);
+
+            if (!m_Ranges.allocate(size, alignment, offset))
+                return nullptr;
+        }
+
+        return RefCountPtr<DescriptorBufferRange>::Create(new DescriptorBufferRange(*this, offset, size));
+    }
+
+    void DescriptorBuffer::release(vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        std::lock_guard lockGuard(m_Mutex);
+
+        m_Ranges.release(offset, size);
+    }
+
+    BindingSetHandle Device::createBindingSet(const BindingSetDesc& desc, IBindingLayout* layout)
+    {
+        return m_ObjectCache.getBindingSet(desc, layout, [this, &desc, layout] { return createBindingSetInternal(desc, layout); });
+    }
+
+    BindingSetHandle Device::createBindingSetInternal(const BindingSetDesc& desc, IBindingLayout* _layout)
+    {
+        BindingLayout* layout = checked_cast<BindingLayout*>(_layout);
+
+        if (layout->pushDescriptors)
+        {
+            m_Context.error("Cannot create a binding set for a layout that uses push descriptors, "
+                "use ICommandList::setPushBindings instead");
+            return nullptr;
+        }
+
+        BindingSet *ret = new BindingSet(m_Context);
+        ret->desc = desc;
+        ret->layout = layout;
+
+        if (m_Context.descriptorBuffer)
+        {
+            ret->descriptorBufferRange = m_Context.descriptorBuffer->allocate(layout->descriptorBufferSize);
+            if (!ret->descriptorBufferRange)
+            {
+                m_Context.error("The descriptor buffer is full, increase DeviceDesc::descriptorBufferSize");
+                delete ret;
+                return nullptr;
+            }
+
+            ret->descriptorBufferOffset = ret->descriptorBufferRange->offset;
+        }
+        else
+        {
+            // get a descriptor set from the layout's shared pools
+            const vk::Result res = layout->allocateDescriptorSet(ret->descriptorSet, ret->descriptorPool);
+            if (res != vk::Result::eSuccess)
+            {
+                delete ret;
+                return nullptr;
+            }
+        }
+        
+        ret->writeDescriptors();
+
+        return BindingSetHandle::Create(ret);
+    }
+
+    void BindingSet::writeDescriptors()
+    {
+        const BindingLayout* bindingLayout = checked_cast<BindingLayout*>(layout.Get());
+
+        // collect all of the descriptor write data
+        DescriptorWriteData writeData;
+        generateDescriptorWrites(m_Context, desc, bindingLayout, descriptorSet, writeData);
+
+        for (const BindingSetItem& binding : desc.bindings)
+        {
+            if (binding.resourceHandle)
+                resources.push_back(binding.resourceHandle); // keep a strong reference to the resource
+        }
+
+        bindingsThatNeedTransitions = std::move(writeData.bindingsThatNeedTransitions);
+        volatileConstantBuffers = writeData.volatileConstantBuffers;
+        volatileBufferDescriptors = writeData.volatileBufferDescriptors;
+
+        if (m_Context.descriptorBuffer)
+        {
+            // the range may have been used by another set, so clear the descriptors for the null bindings
+            uint8_t* setData = m_Context.descriptorBuffer->mappedMemory + descriptorBufferOffset;
+            memset(setData, 0, bindingLayout->descriptorBufferSize);
+
+            writeDescriptorBufferSet(m_Context, bindingLayout, writeData, setData);
+            return;
+        }
+
+        m_Context.device.updateDescriptorSets(uint32_t(writeData.writes.size()), writeData.writes.data(), 0, nullptr);
+    }
+
+    TransientDescriptorPool::~TransientDescriptorPool()
+    {
+        // destroying the pool frees all transient descriptor sets allocated from it
+        if (pool)
+        {
+            m_Context.device.destroyDescriptorPool(pool, m_Context.allocationCallbacks);
+            pool = vk::DescriptorPool();
+        }
+    }
+
+    vk::Result CommandList::createTransientDescriptorPool()
+    {
+        constexpr uint32_t c_TransientSetsPerPool = 256;
+        constexpr uint32_t c_TransientDescriptorsPerType = 1024;
+
+        static_vector<vk::DescriptorPoolSize, 10> poolSizes;
+        for (vk::DescriptorType type : {
+            vk::DescriptorType::eSampledImage,
+            vk::DescriptorType::eStorageImage,
+            vk::DescriptorType::eUniformTexelBuffer,
+            vk::DescriptorType::eStorageTexelBuffer,
+            vk::DescriptorType::eStorageBuffer,
+            vk::DescriptorType::eUniformBuffer,
+            vk::DescriptorType::eUniformBufferDynamic,
+            vk::DescriptorType::eSampler })
+        {
+            poolSizes.push_back(vk::DescriptorPoolSize(type, c_TransientDescriptorsPerType));
+        }
+
+        if (m_Context.extensions.KHR_acceleration_structure)
+            poolSizes.push_back(vk::DescriptorPoolSize(vk::DescriptorType::eAccelerationStructureKHR, c_TransientDescriptorsPerType));
+
+        auto poolInfo = vk::DescriptorPoolCreateInfo()
+            .setPoolSizeCount(uint32_t(poolSizes.size()))
+            .setPPoolSizes(poolSizes.data())
+            .setMaxSets(c_TransientSetsPerPool);
+
+        // The previous pool, if any, stays alive as long as the binding sets allocated from it
+        m_TransientDescriptorPool = RefCountPtr<TransientDescriptorPool>::Create(new TransientDescriptorPool(m_Context));
+
+        return m_Context.device.createDescriptorPool(&poolInfo, m_Context.allocationCallbacks, &m_TransientDescriptorPool->pool);
+    }
+
+    uint8_t* CommandList::allocateTransientDescriptors(vk::DeviceSize size, vk::DeviceSize& outOffset)
+    {
+        constexpr vk::DeviceSize c_TransientDescriptorChunkSize = 64 * 1024;
+        const vk::DeviceSize alignment = m_Context.descriptorBufferProperties.descriptorBufferOffsetAlignment;
+
+        vk::DeviceSize offset = align(m_TransientDescriptorChunkOffset, alignment);
+
+        if (!m_TransientDescriptorChunk || offset + size > m_TransientDescriptorChunk->size)
+        {
+            // The previous chunk, if any, stays alive as long as the command buffers and transient sets that use it
+            m_TransientDescriptorChunk = m_Context.descriptorBuffer->allocate(std::max(size, c_TransientDescriptorChunkSize));
+            if (!m_TransientDescriptorChunk)
+            {
+                m_Context.error("The descriptor buffer is full, increase DeviceDesc::descriptorBufferSize");
+                return nullptr;
+            }
+
+            m_CurrentCmdBuf->referencedResources.push_back(m_TransientDescriptorChunk.Get());
+            offset = 0;
+        }
+
+        m_TransientDescriptorChunkOffset = offset + size;
+        outOffset = m_TransientDescriptorChunk->offset + offset;
+
+        return m_TransientDescriptorChunk->getData() + offset;
+    }
+
+    BindingSetHandle CommandList::createTransientBindingSet(const BindingSetDesc& desc, IBindingLayout* _layout)
+    {
+        BindingLayout* layout = checked_cast<BindingLayout*>(_layout);
+
+        if (layout->pushDescriptors)
+        {
+            m_Context.error("Cannot create a binding set for a layout that uses push descriptors, "
+                "use ICommandList::setPushBindings instead");
+            return nullptr;
+        }
+
+        if (m_Context.descriptorBuffer)
+        {
+            vk::DeviceSize descriptorBufferOffset = 0;
+            if (!allocateTransientDescriptors(layout->descriptorBufferSize, descriptorBufferOffset))
+                return nullptr;
+
+            BindingSet* ret = new BindingSet(m_Context);
+            ret->desc = desc;
+            ret->layout = layout;
+            ret->transient = true;
+            ret->descriptorBufferOffset = descriptorBufferOffset;
+            ret->resources.push_back(m_TransientDescriptorChunk.Get());
+
+            ret->writeDescriptors();
+
+            return BindingSetHandle::Create(ret);
+        }
+
+        vk::Result res = vk::Result::eSuccess;
+        if (!m_TransientDescriptorPool || !m_TransientDescriptorPool->pool)
+        {
+            res = createTransientDescriptorPool();
+            CHECK_VK_FAIL(res)
+        }
+
+        auto descriptorSetAllocInfo = vk::DescriptorSetAllocateInfo()
+            .setDescriptorPool(m_TransientDescriptorPool->pool)
+            .setDescriptorSetCount(1)
+            .setPSetLayouts(&layout->descriptorSetLayout);
+
+        vk::DescriptorSet descriptorSet;
+        res = m_Context.device.allocateDescriptorSets(&descriptorSetAllocInfo, &descriptorSet);
+
+        if (res == vk::Result::eErrorOutOfPoolMemory || res == vk::Result::eErrorFragmentedPool)
+        {
+            // The current pool is exhausted, start a new one
+            res = createTransientDescriptorPool();
+            CHECK_VK_FAIL(res)
+
+            descriptorSetAllocInfo.setDescriptorPool(m_TransientDescriptorPool->pool);
+            res = m_Context.device.allocateDescriptorSets(&descriptorSetAllocInfo, &descriptorSet);
+        }
+        CHECK_VK_FAIL(res)
+
+        BindingSet* ret = new BindingSet(m_Context);
+        ret->desc = desc;
+        ret->layout = layout;
+        ret->transient = true;
+        ret->descriptorPool = m_TransientDescriptorPool->pool;
+        ret->descriptorSet = descriptorSet;
+        ret->resources.push_back(m_TransientDescriptorPool.Get());
+
+        ret->writeDescriptors();
 
         return BindingSetHandle::Create(ret);
     }
 
     BindingSet::~BindingSet()
     {
-        if (descriptorPool)
+        // Command buffers keep references to the objects they use until they are retired,
+        // so by the time this runs, the GPU is done with the descriptor set and it can be reused.
+        // Transient sets are freed all at once with their pool.
+        if (descriptorSet && !transient)
         {
-            m_Context.device.destroyDescriptorPool(descriptorPool, m_Context.allocationCallbacks);
+            checked_cast<BindingLayout*>(layout.Get())->releaseDescriptorSet(descriptorSet, descriptorPool);
             descriptorPool = vk::DescriptorPool();
             descriptorSet = vk::DescriptorSet();
         }
@@ -621,38 +1183,40 @@ namespace nvrhi::vulkan
         ret->layout = layout;
         ret->capacity = layout->vulkanLayoutBindings[0].descriptorCount;
 
-        const auto& descriptorSetLayout = layout->descriptorSetLayout;
-        const auto& poolSizes = layout->descriptorPoolSizeInfo;
-
-        // create descriptor pool to allocate a descriptor from
-        auto poolInfo = vk::DescriptorPoolCreateInfo()
-            .setPoolSizeCount(uint32_t(poolSizes.size()))
-            .setPPoolSizes(poolSizes.data())
-            .setMaxSets(1);
+        if (m_Context.descriptorBuffer)
+        {
+            // Like on DX12, tables start empty unless the layout reserves the maximum capacity,
+            // so that the fixed-size descriptor buffer only holds the slots that are actually used
+            if (!layout->bindlessDesc.reserveMaxCapacity)
+                ret->capacity = 0;
 
-        vk::Result res = m_Context.device.createDescriptorPool(&poolInfo,
-                                                             m_Context.allocationCallbacks,
-                                                             &ret->descriptorPool);
-        CHECK_VK_FAIL(res)
+            if (!allocateDescriptorTableRange(ret, ret->capacity, false))
+            {
+                delete ret;
+                return nullptr;
+            }
 
-        // create the descriptor set
-        auto descriptorSetAllocInfo = vk::DescriptorSetAllocateInfo()
-            .setDescriptorPool(ret->descriptorPool)
-            .setDescriptorSetCount(1)
-            .setPSetLayouts(&descriptorSetLayout);
+            return DescriptorTableHandle::Create(ret);
+        }
 
-        res = m_Context.device.allocateDescriptorSets(&descriptorSetAllocInfo,
-            &ret->descriptorSet);
-        CHECK_VK_FAIL(res)
+        // get a descriptor set from the layout's shared pools
+        const vk::Result res = layout->allocateDescriptorSet(ret->descriptorSet, ret->descriptorPool);
+        if (res != vk::Result::eSuccess)
+        {
+            delete ret;
+            return nullptr;
+        }
 
         return DescriptorTableHandle::Create(ret);
     }
 
     DescriptorTable::~DescriptorTable()
     {
-        if (descriptorPool)
+        // Command buffers keep references to the objects they use until they are retired,
+        // so by the time this runs, the GPU is done with the descriptor set and it can be reused.
+        if (descriptorSet)
         {
-            m_Context.device.destroyDescriptorPool(descriptorPool, m_Context.allocationCallbacks);
+            checked_cast<BindingLayout*>(layout.Get())->releaseDescriptorSet(descriptorSet, descriptorPool);
             descriptorPool = vk::DescriptorPool();
             descriptorSet = vk::DescriptorSet();
         }
@@ -671,54 +1235,124 @@ namespace nvrhi::vulkan
         }
     }
 
+    bool Device::allocateDescriptorTableRange(DescriptorTable* descriptorTable, uint32_t capacity, bool keepContents)
+    {
+        const BindingLayout* layout = checked_cast<BindingLayout*>(descriptorTable->layout.Get());
+
+        RefCountPtr<DescriptorBufferRange> range = m_Context.descriptorBuffer->allocate(layout->getDescriptorTableSize(capacity));
+        if (!range)
+        {
+            m_Context.error("The descriptor buffer is full, increase DeviceDesc::descriptorBufferSize");
+            return false;
+        }
+
+        uint8_t* newData = range->getData();
+        memset(newData, 0, range->size);
+
+        if (keepContents && descriptorTable->descriptorBufferRange)
+        {
+            const uint8_t* oldData = descriptorTable->descriptorBufferRange->getData();
+            const uint32_t keptCapacity = std::min(capacity, descriptorTable->descriptorBufferCapacity);
+
+            for (size_t index = 0; index < layout->vulkanLayoutBindings.size(); index++)
+            {
+                const vk::DeviceSize offset = layout->descriptorBufferBindingOffsets[index];
+                const size_t descriptorSize = getDescriptorSize(m_Context, layout->vulkanLayoutBindings[index].descriptorType);
+                memcpy(newData + offset, oldData + offset, keptCapacity * descriptorSize);
+            }
+        }
+
+        // Command buffers that bound the old range keep it alive until they are retired
+        descriptorTable->descriptorBufferRange = range;
+        descriptorTable->descriptorBufferCapacity = capacity;
+        return true;
+    }
+
     void Device::resizeDescriptorTable(IDescriptorTable* _descriptorTable, uint32_t newSize, bool keepContents)
     {
-        assert(newSize <= checked_cast<DescriptorTable*>(_descriptorTable)->layout->getBindlessDesc()->maxCapacity);
-        (void)_descriptorTable;
-        (void)newSize;
+        DescriptorTable* descriptorTable = checked_cast<DescriptorTable*>(_descriptorTable);
+
+        assert(newSize <= descriptorTable->layout->getBindlessDesc()->maxCapacity);
+
+        // Descriptor buffer ranges that are too small move to a new location, and the table has to be bound again
+        if (m_Context.descriptorBuffer && newSize > descriptorTable->descriptorBufferCapacity)
+        {
+            if (allocateDescriptorTableRange(descriptorTable, newSize, keepContents))
+                descriptorTable->capacity = newSize;
+            return;
+        }
+
+        // The descriptor set (or range) has room for 'newSize' slots, so resizing only changes the range of slots
+        // that can be written. The contents are always kept.
         (void)keepContents;
+
+        descriptorTable->capacity = newSize;
     }
 
-    bool Device::writeDescriptorTable(IDescriptorTable* _descriptorTable, const BindingSetItem& binding)
+    bool Device::writeDescriptorTable(IDescriptorTable* descriptorTable, const BindingSetItem& binding)
+    {
+        return writeDescriptorTable(descriptorTable, &binding, 1);
+    }
+
+    bool Device::writeDescriptorTable(IDescriptorTable* _descriptorTable, const BindingSetItem* bindings, size_t numBindings)
     {
         DescriptorTable* descriptorTable = checked_cast<DescriptorTable*>(_descriptorTable);
         BindingLayout* layout = checked_cast<BindingLayout*>(descriptorTable->layout.Get());
 
-        if (binding.slot >= descriptorTable->capacity)
-            return false;
-
-        vk::Result res;
-
-        // collect all of the descriptor write data
-        static_vector<vk::DescriptorImageInfo, c_MaxBindingsPerLayout> descriptorImageInfo;
-        static_vector<vk::DescriptorBufferInfo, c_MaxBindingsPerLayout> descriptorBufferInfo;
-        static_vector<vk::WriteDescriptorSet, c_MaxBindingsPerLayout> descriptorWriteInfo;
+        if (numBindings == 0)
+            return true;
 
-        auto generateWriteDescriptorData =
-            // generates a vk::WriteDescriptorSet struct in descriptorWriteInfo
-            [&](uint32_t bindingLocation,
-                vk::DescriptorType descriptorType,
-                vk::DescriptorImageInfo* imageInfo,
-                vk::DescriptorBufferInfo* bufferInfo,
-                vk::BufferView* bufferView)
+        for (size_t index = 0; index < numBindings; index++)
         {
-            descriptorWriteInfo.push_back(
-                vk::WriteDescriptorSet()
-                .setDstSet(descriptorTable->descriptorSet)
-                .setDstBinding(bindingLocation)
-                .setDstArrayElement(binding.slot)
-                .setDescriptorCount(1)
-                .setDescriptorType(descriptorType)
-                .setPImageInfo(imageInfo)
-                .setPBufferInfo(bufferInfo)
-                .setPTexelBufferView(bufferView)
-            );
-        };
+            if (bindings[index].slot >= descriptorTable->capacity)
+                return false;
+        }
+
+        vk::Result res;
 
-        for (uint32_t bindingLocation = 0; bindingLocation < uint32_t(layout->bindlessDesc.registerSpaces.size()); bindingLocation++)
+        // collect all of the descriptor write data; every item may match several register spaces,
+        // so reserve for the worst case to keep the info pointers stable
+        const size_t maxWrites = numBindings * layout->bindlessDesc.registerSpaces.size();
+        std::vector<vk::DescriptorImageInfo> descriptorImageInfo;
+        std::vector<vk::DescriptorBufferInfo> descriptorBufferInfo;
+        std::vector<vk::WriteDescriptorSet> descriptorWriteInfo;
+        std::vector<vk::DescriptorAddressInfoEXT> descriptorAddressInfo; // for descriptor buffers, one per write
+        descriptorImageInfo.reserve(maxWrites);
+        descriptorBufferInfo.reserve(maxWrites);
+        descriptorWriteInfo.reserve(maxWrites);
+        descriptorAddressInfo.reserve(maxWrites);
+
+        for (size_t index = 0; index < numBindings; index++)
         {
-            if (layout->bindlessDesc.registerSpaces[bindingLocation].type == binding.type)
+            const BindingSetItem& binding = bindings[index];
+
+            auto generateWriteDescriptorData =
+                // generates a vk::WriteDescriptorSet struct in descriptorWriteInfo
+                [&](uint32_t bindingLocation,
+                    vk::DescriptorType descriptorType,
+                    vk::DescriptorImageInfo* imageInfo,
+                    vk::DescriptorBufferInfo* bufferInfo,
+                    vk::BufferView* bufferView)
             {
+                descriptorWriteInfo.push_back(
+                    vk::WriteDescriptorSet()
+                    .setDstSet(descriptorTable->descriptorSet)
+                    .setDstBinding(bindingLocation)
+                    .setDstArrayElement(binding.slot)
+                    .setDescriptorCount(1)
+                    .setDescriptorType(descriptorType)
+                    .setPImageInfo(imageInfo)
+                    .setPBufferInfo(bufferInfo)
+                    .setPTexelBufferView(bufferView)
+                );
+                descriptorAddressInfo.emplace_back();
+            };
+
+            for (uint32_t bindingLocation = 0; bindingLocation < uint32_t(layout->bindlessDesc.registerSpaces.size()); bindingLocation++)
+            {
+                if (layout->bindlessDesc.registerSpaces[bindingLocation].type != binding.type)
+                    continue;
+
                 const vk::DescriptorSetLayoutBinding& layoutBinding = layout->vulkanLayoutBindings[bindingLocation];
 
                 switch (binding.type)
@@ -728,7 +1362,7 @@ namespace nvrhi::vulkan
                     const auto& texture = checked_cast<Texture*>(binding.resourceHandle);
 
                     const auto subresource = binding.subresources.resolve(texture->desc, false);
-                    const auto textureViewType = getTextureViewType(binding.format, texture->desc.format);
+                    const auto textureViewType = Texture::getTextureViewType(binding.format, texture->desc.format);
                     auto& view = texture->getSubresourceView(subresource, binding.dimension, binding.format, vk::ImageUsageFlagBits::eSampled, textureViewType);
 
                     auto& imageInfo = descriptorImageInfo.emplace_back();
@@ -748,7 +1382,7 @@ namespace nvrhi::vulkan
                     const auto texture = checked_cast<Texture*>(binding.resourceHandle);
 
                     const auto subresource = binding.subresources.resolve(texture->desc, true);
-                    const auto textureViewType = getTextureViewType(binding.format, texture->desc.format);
+                    const auto textureViewType = Texture::getTextureViewType(binding.format, texture->desc.format);
                     auto& view = texture->getSubresourceView(subresource, binding.dimension, binding.format, vk::ImageUsageFlagBits::eStorage, textureViewType);
 
                     auto& imageInfo = descriptorImageInfo.emplace_back();
@@ -776,6 +1410,9 @@ namespace nvrhi::vulkan
                     nvrhi::hash_combine(viewInfoHash, range.byteSize);
                     nvrhi::hash_combine(viewInfoHash, (uint64_t)vkformat);
 
+                    // Descriptor tables may be written from several threads at once
+                    std::lock_guard viewCacheLockGuard(buffer->viewCacheMutex);
+
                     const auto& bufferViewFound = buffer->viewCache.find(viewInfoHash);
                     auto& bufferViewRef = (bufferViewFound != buffer->viewCache.end()) ? bufferViewFound->second : buffer->viewCache[viewInfoHash];
                     if (bufferViewFound == buffer->viewCache.end())
@@ -795,6 +1432,11 @@ namespace nvrhi::vulkan
                     generateWriteDescriptorData(layoutBinding.binding,
                         layoutBinding.descriptorType,
                         nullptr, nullptr, &bufferViewRef);
+
+                    descriptorAddressInfo.back() = vk::DescriptorAddressInfoEXT()
+                        .setAddress(buffer->deviceAddress + range.byteOffset)
+                        .setRange(range.byteSize)
+                        .setFormat(vk::Format(vkformat));
                 }
                 break;
 
@@ -819,6 +1461,10 @@ namespace nvrhi::vulkan
                     generateWriteDescriptorData(layoutBinding.binding,
                         layoutBinding.descriptorType,
                         nullptr, &bufferInfo, nullptr);
+
+                    descriptorAddressInfo.back() = vk::DescriptorAddressInfoEXT()
+                        .setAddress(buffer->deviceAddress + range.byteOffset)
+                        .setRange(range.byteSize);
                 }
 
                 break;
@@ -854,43 +1500,206 @@ namespace nvrhi::vulkan
             }
         }
 
+        if (m_Context.descriptorBuffer)
+        {
+            // Every slot has its own memory in the descriptor buffer, so threads that write different slots don't need a lock.
+            // With bindless layouts, binding numbers are the indices into vulkanLayoutBindings.
+            uint8_t* tableData = descriptorTable->descriptorBufferRange->getData();
+
+            for (size_t index = 0; index < descriptorWriteInfo.size(); index++)
+            {
+                const vk::WriteDescriptorSet& write = descriptorWriteInfo[index];
+                const vk::DeviceSize offset = layout->descriptorBufferBindingOffsets[write.dstBinding]
+                    + write.dstArrayElement * getDescriptorSize(m_Context, write.descriptorType);
+
+                getDescriptor(m_Context, write.descriptorType, write.pImageInfo, &descriptorAddressInfo[index], tableData + offset);
+            }
+
+            return true;
+        }
+
+        // Host access to the descriptor set must be externally synchronized, even when the threads write different elements.
+        // The lock only covers the single update call, all view creation above happens outside of it.
+        std::lock_guard lockGuard(descriptorTable->mutex);
+
         m_Context.device.updateDescriptorSets(uint32_t(descriptorWriteInfo.size()), descriptorWriteInfo.data(), 0, nullptr);
 
         return true;
     }
 
+    uint64_t CommandList::getVolatileConstantBufferOffset(Buffer* constantBuffer)
+    {
+        auto found = m_VolatileBufferStates.find(constantBuffer);
+        if (found == m_VolatileBufferStates.end() || !found->second.initialized)
+        {
+            std::stringstream ss;
+            ss << "Binding volatile constant buffer " << utils::DebugNameToString(constantBuffer->desc.debugName)
+               << " before writing into it is invalid.";
+            m_Context.error(ss.str());
+
+            return 0; // use zero offset just to use something
+        }
+
+        return constantBuffer->volatileRing
+            ? found->second.ringOffset
+            : found->second.latestVersion * constantBuffer->desc.byteSize;
+    }
+
+    void CommandList::bindDescriptorBufferSets(vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, const BindingSetVector& bindings)
+    {
+        DescriptorBuffer* descriptorBuffer = m_Context.descriptorBuffer;
+
+        if (!m_DescriptorBufferBound)
+        {
+            auto bindingInfo = vk::DescriptorBufferBindingInfoEXT()
+                .setAddress(descriptorBuffer->deviceAddress)
+                .setUsage(vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT | vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT);
+
+            // Without bufferless push descriptors, the implementation needs the buffer handle for the push descriptor sets
+            auto pushDescriptorBufferHandle = vk::DescriptorBufferBindingPushDescriptorBufferHandleEXT()
+                .setBuffer(descriptorBuffer->buffer);
+            if (!m_Context.descriptorBufferProperties.bufferlessPushDescriptors)
+            {
+                bindingInfo.usage |= vk::BufferUsageFlagBits::ePushDescriptorsDescriptorBufferEXT;
+                bindingInfo.setPNext(&pushDescriptorBufferHandle);
+            }
+
+            m_CurrentCmdBuf->cmdBuf.bindDescriptorBuffersEXT(1, &bindingInfo);
+            m_DescriptorBufferBound = true;
+        }
+
+        BindingVector<uint32_t> bufferIndices;
+        BindingVector<vk::DeviceSize> offsets;
+        uint32_t firstSet = 0;
+
+        auto flushOffsets = [&]()
+        {
+            if (!offsets.empty())
+            {
+                m_CurrentCmdBuf->cmdBuf.setDescriptorBufferOffsetsEXT(bindPoint, pipelineLayout,
+                    firstSet, uint32_t(offsets.size()), bufferIndices.data(), offsets.data());
+            }
+
+            bufferIndices.resize(0);
+            offsets.resize(0);
+        };
+
+        for (uint32_t setIndex = 0; setIndex < uint32_t(bindings.size()); setIndex++)
+        {
+            IBindingSet* bindingSetHandle = bindings[setIndex];
+
+            // Slots that use push descriptors are not in the descriptor buffer
+            if (!bindingSetHandle)
+            {
+                flushOffsets();
+                firstSet = setIndex + 1;
+                continue;
+            }
+
+            vk::DeviceSize offset;
+
+            const BindingSetDesc* desc = bindingSetHandle->getDesc();
+            if (desc)
+            {
+                BindingSet* bindingSet = checked_cast<BindingSet*>(bindingSetHandle);
+                offset = bindingSet->descriptorBufferOffset;
+
+                if (!bindingSet->volatileConstantBuffers.empty())
+                {
+                    // There are no dynamic offsets, so bind a copy of the set that points at the current versions
+                    const BindingLayout* layout = checked_cast<BindingLayout*>(bindingSet->layout.Get());
+
+                    vk::DeviceSize copyOffset = 0;
+                    if (uint8_t* setData = allocateTransientDescriptors(layout->descriptorBufferSize, copyOffset))
+                    {
+                        memcpy(setData, descriptorBuffer->mappedMemory + bindingSet->descriptorBufferOffset, layout->descriptorBufferSize);
+
+                        for (size_t index = 0; index < bindingSet->volatileConstantBuffers.size(); index++)
+                        {
+                            Buffer* constantBuffer = bindingSet->volatileConstantBuffers[index];
+                            const VolatileBufferDescriptor& volatileDescriptor = bindingSet->volatileBufferDescriptors[index];
+
+                            const auto addressInfo = vk::DescriptorAddressInfoEXT()
+                                .setAddress(constantBuffer->deviceAddress + volatileDescriptor.rangeOffset + getVolatileConstantBufferOffset(constantBuffer))
+                                .setRange(volatileDescriptor.rangeSize);
+
+                            getDescriptor(m_Context, vk::DescriptorType::eUniformBuffer, nullptr, &addressInfo, setData + volatileDescriptor.descriptorOffset);
+                        }
+
+                        offset = copyOffset;
+
+                        if (m_CommandListParameters.enableStatistics)
+                            m_Statistics.numDescriptorsWritten += uint32_t(bindingSet->volatileConstantBuffers.size());
+                    }
+                }
+
+                if (desc->trackLiveness)
+                    m_CurrentCmdBuf->referencedResources.push_back(bindingSetHandle);
+            }
+            else
+            {
+                DescriptorTable* table = checked_cast<DescriptorTable*>(bindingSetHandle);
+                offset = table->descriptorBufferRange->offset;
+
+                // The range is replaced when the table grows, which must not free the one used here
+                m_CurrentCmdBuf->referencedResources.push_back(table->descriptorBufferRange);
+            }
+
+            bufferIndices.push_back(0);
+            offsets.push_back(offset);
+        }
+
+        flushOffsets();
+    }
+
     void CommandList::bindBindingSets(vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, const BindingSetVector& bindings)
     {
+        if (m_Context.descriptorBuffer)
+        {
+            bindDescriptorBufferSets(bindPoint, pipelineLayout, bindings);
+            return;
+        }
+
         BindingVector<vk::DescriptorSet> descriptorSets;
         static_vector<uint32_t, c_MaxVolatileConstantBuffers> dynamicOffsets;
+        uint32_t firstSet = 0;
+
+        auto flushDescriptorSets = [&]()
+        {
+            if (!descriptorSets.empty())
+            {
+                m_CurrentCmdBuf->cmdBuf.bindDescriptorSets(bindPoint, pipelineLayout,
+                    firstSet, uint32_t(descriptorSets.size()), descriptorSets.data(),
+                    uint32_t(dynamicOffsets.size()), dynamicOffsets.data());
+            }
 
-        for (const auto& bindingSetHandle : bindings)
+            descriptorSets.resize(0);
+            dynamicOffsets.resize(0);
+        };
+
+        for (uint32_t setIndex = 0; setIndex < uint32_t(bindings.size()); setIndex++)
         {
+            IBindingSet* bindingSetHandle = bindings[setIndex];
+
+            // Slots that use push descriptors have no set, so the sets around them are bound in separate ranges
+            if (!bindingSetHandle)
+            {
+                flushDescriptorSets();
+                firstSet = setIndex + 1;
+                continue;
+            }
+
             const BindingSetDesc* desc = bindingSetHandle->getDesc();
             if (desc)
             {
                 BindingSet* bindingSet = checked_cast<BindingSet*>(bindingSetHandle);
                 descriptorSets.push_back(bindingSet->descriptorSet);
 
-                for (Buffer* constnatBuffer : bindingSet->volatileConstantBuffers)
+                for (Buffer* constantBuffer : bindingSet->volatileConstantBuffers)
                 {
-                    auto found = m_VolatileBufferStates.find(constnatBuffer);
-                    if (found == m_VolatileBufferStates.end())
-                    {
-                        std::stringstream ss;
-                        ss << "Binding volatile constant buffer " << utils::DebugNameToString(constnatBuffer->desc.debugName)
-                           << " before writing into it is invalid.";
-                        m_Context.error(ss.str());
-
-                        dynamicOffsets.push_back(0); // use zero offset just to use something
-                    }
-                    else
-                    {
-                        uint32_t version = found->second.latestVersion;
-                        uint64_t offset = version * constnatBuffer->desc.byteSize;
-                        assert(offset < std::numeric_limits<uint32_t>::max());
-                        dynamicOffsets.push_back(uint32_t(offset));
-                    }
+                    const uint64_t offset = getVolatileConstantBufferOffset(constantBuffer);
+                    assert(offset < std::numeric_limits<uint32_t>::max());
+                    dynamicOffsets.push_back(uint32_t(offset));
                 }
 
                 if (desc->trackLiveness)
@@ -903,12 +1712,52 @@ namespace nvrhi::vulkan
             }
         }
 
-        if (!descriptorSets.empty())
+        flushDescriptorSets();
+    }
+
+    void CommandList::setPushBindings(uint32_t layoutIndex, const BindingSetDesc& bindings)
+    {
+        m_PushBindings.set(layoutIndex, bindings);
+    }
+
+    void CommandList::commitPushBindings(vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, const BindingLayoutVector& layouts)
+    {
+        for (const PushBindings::Entry& entry : m_PushBindings.getEntries())
         {
-            m_CurrentCmdBuf->cmdBuf.bindDescriptorSets(bindPoint, pipelineLayout,
-                /* firstSet = */ 0, uint32_t(descriptorSets.size()), descriptorSets.data(),
-                uint32_t(dynamicOffsets.size()), dynamicOffsets.data());
+            if (entry.layoutIndex >= layouts.size())
+                continue;
+
+            const BindingLayout* layout = checked_cast<const BindingLayout*>(layouts[entry.layoutIndex].Get());
+            if (!layout->pushDescriptors)
+            {
+                m_Context.error("Push bindings are provided for a binding layout that was not created with usePushDescriptors");
+                continue;
+            }
+
+            DescriptorWriteData writeData;
+            generateDescriptorWrites(m_Context, entry.desc, layout, vk::DescriptorSet(), writeData);
+
+            if (!writeData.writes.empty())
+            {
+                m_CurrentCmdBuf->cmdBuf.pushDescriptorSetKHR(bindPoint, pipelineLayout, entry.layoutIndex,
+                    uint32_t(writeData.writes.size()), writeData.writes.data());
+
+                if (m_CommandListParameters.enableStatistics)
+                {
+                    for (const vk::WriteDescriptorSet& write : writeData.writes)
+                        m_Statistics.numDescriptorsWritten += write.descriptorCount;
+                }
+            }
+
+            // there is no binding set to hold the resources, so the command buffer does
+            for (const BindingSetItem& binding : entry.desc.bindings)
+            {
+                if (binding.resourceHandle)
+                    m_CurrentCmdBuf->referencedResources.push_back(binding.resourceHandle);
+            }
         }
+
+        m_PushBindings.clear();
     }
 
 
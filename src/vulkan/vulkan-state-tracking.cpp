@@ -26,8 +26,49 @@
 namespace nvrhi::vulkan
 {
     
+    void CommandList::setResourceStatesForBindingItem(const BindingSetItem& binding)
+    {
+        switch(binding.type)  // NOLINT(clang-diagnostic-switch-enum)
+        {
+            case ResourceType::Texture_SRV:
+                requireTextureState(checked_cast<ITexture*>(binding.resourceHandle), binding.subresources, ResourceStates::ShaderResource);
+                break;
+
+            case ResourceType::Texture_UAV:
+                requireTextureState(checked_cast<ITexture*>(binding.resourceHandle), binding.subresources, ResourceStates::UnorderedAccess);
+                break;
+
+            case ResourceType::TypedBuffer_SRV:
+            case ResourceType::StructuredBuffer_SRV:
+            case ResourceType::RawBuffer_SRV:
+                requireBufferState(checked_cast<IBuffer*>(binding.resourceHandle), ResourceStates::ShaderResource);
+                break;
+
+            case ResourceType::TypedBuffer_UAV:
+            case ResourceType::StructuredBuffer_UAV:
+            case ResourceType::RawBuffer_UAV:
+                requireBufferState(checked_cast<IBuffer*>(binding.resourceHandle), ResourceStates::UnorderedAccess);
+                break;
+
+            case ResourceType::ConstantBuffer:
+                requireBufferState(checked_cast<IBuffer*>(binding.resourceHandle), ResourceStates::ConstantBuffer);
+                break;
+
+            case ResourceType::RayTracingAccelStruct:
+                requireBufferState(checked_cast<AccelStruct*>(binding.resourceHandle)->dataBuffer, ResourceStates::AccelStructRead);
+                break;
+
+            default:
+                // do nothing
+                break;
+        }
+    }
+
     void CommandList::setResourceStatesForBindingSet(IBindingSet* _bindingSet)
     {
+        if (!_bindingSet)
+            return; // the slot is provided through push bindings
+
         if (_bindingSet->getDesc() == nullptr)
             return; // is bindless
 
@@ -35,40 +76,18 @@ namespace nvrhi::vulkan
 
         for (auto bindingIndex : bindingSet->bindingsThatNeedTransitions)
         {
-            const BindingSetItem& binding = bindingSet->desc.bindings[bindingIndex];
+            setResourceStatesForBindingItem(bindingSet->desc.bindings[bindingIndex]);
+        }
+    }
 
-            switch(binding.type)  // NOLINT(clang-diagnostic-switch-enum)
+    void CommandList::setResourceStatesForPushBindings()
+    {
+        for (const PushBindings::Entry& entry : m_PushBindings.getEntries())
+        {
+            for (const BindingSetItem& binding : entry.desc.bindings)
             {
-                case ResourceType::Texture_SRV:
-                    requireTextureState(checked_cast<ITexture*>(binding.resourceHandle), binding.subresources, ResourceStates::ShaderResource);
-                    break;
-
-                case ResourceType::Texture_UAV:
-                    requireTextureState(checked_cast<ITexture*>(binding.resourceHandle), binding.subresources, ResourceStates::UnorderedAccess);
-                    break;
-
-                case ResourceType::TypedBuffer_SRV:
-                case ResourceType::StructuredBuffer_SRV:
-                case ResourceType::RawBuffer_SRV:
-                    requireBufferState(checked_cast<IBuffer*>(binding.resourceHandle), ResourceStates::ShaderResource);
-                    break;
-
-                case ResourceType::TypedBuffer_UAV:
-                case ResourceType::StructuredBuffer_UAV:
-                case ResourceType::RawBuffer_UAV:
-                    requireBufferState(checked_cast<IBuffer*>(binding.resourceHandle), ResourceStates::UnorderedAccess);
-                    break;
-
-                case ResourceType::ConstantBuffer:
-                    requireBufferState(checked_cast<IBuffer*>(binding.resourceHandle), ResourceStates::ConstantBuffer);
-                    break;
-
-                case ResourceType::RayTracingAccelStruct:
-                    requireBufferState(checked_cast<AccelStruct*>(binding.resourceHandle)->dataBuffer, ResourceStates::AccelStructRead);
-
-                default:
-                    // do nothing
-                    break;
+                if (binding.resourceHandle)
+                    setResourceStatesForBindingItem(binding);
             }
         }
     }
@@ -98,7 +117,8 @@ namespace nvrhi::vulkan
             }
         }
 
-        if (m_CurrentGraphicsState.framebuffer != state.framebuffer)
+        // Bundles inherit the render pass, its attachments are transitioned by the command list that executes the bundle
+        if (m_CurrentGraphicsState.framebuffer != state.framebuffer && !m_CommandListParameters.isBundle)
         {
             setResourceStatesForFramebuffer(state.framebuffer);
         }
@@ -107,6 +127,11 @@ namespace nvrhi::vulkan
         {
             requireBufferState(state.indirectParams, ResourceStates::IndirectArgument);
         }
+
+        if (state.indirectCountBuffer && state.indirectCountBuffer != m_CurrentGraphicsState.indirectCountBuffer)
+        {
+            requireBufferState(state.indirectCountBuffer, ResourceStates::IndirectArgument);
+        }
     }
 
     void CommandList::trackResourcesAndBarriers(const MeshletState& state)
@@ -130,17 +155,38 @@ namespace nvrhi::vulkan
         {
             requireBufferState(state.indirectParams, ResourceStates::IndirectArgument);
         }
+
+        if (state.indirectCountBuffer && state.indirectCountBuffer != m_CurrentMeshletState.indirectCountBuffer)
+        {
+            requireBufferState(state.indirectCountBuffer, ResourceStates::IndirectArgument);
+        }
     }
 
     void CommandList::requireTextureState(ITexture* _texture, TextureSubresourceSet subresources, ResourceStates state)
     {
+        if (m_CommandListParameters.isBundle)
+        {
+            m_BundleStates.requireTextureState(_texture, subresources, state);
+            return;
+        }
+
         Texture* texture = checked_cast<Texture*>(_texture);
 
+        // Pending clears come first in the command list, before the state of any texture changes
+        if (!m_DeferredClears.empty())
+            executeDeferredClears();
+
         m_StateTracker.requireTextureState(texture, subresources, state);
     }
 
     void CommandList::requireBufferState(IBuffer* _buffer, ResourceStates state)
     {
+        if (m_CommandListParameters.isBundle)
+        {
+            m_BundleStates.requireBufferState(_buffer, state);
+            return;
+        }
+
         Buffer* buffer = checked_cast<Buffer*>(_buffer);
 
         m_StateTracker.requireBufferState(buffer, state);
@@ -158,10 +204,16 @@ namespace nvrhi::vulkan
         vk::PipelineStageFlags beforeStageFlags = vk::PipelineStageFlags(0);
         vk::PipelineStageFlags afterStageFlags = vk::PipelineStageFlags(0);
 
+        // Split barriers require events with dependency info from KHR_synchronization2.
+        // Without it, the Begin half is a regular barrier and the End half is a no-op.
+
         for (const TextureBarrier& barrier : m_StateTracker.getTextureBarriers())
         {
-            ResourceStateMapping before = convertResourceState(barrier.stateBefore);
-            ResourceStateMapping after = convertResourceState(barrier.stateAfter);
+            if (barrier.split == BarrierSplit::End)
+                continue;
+
+            ResourceStateMapping before = convertResourceState(barrier.stateBefore, m_CommandListParameters.queueType);
+            ResourceStateMapping after = convertResourceState(barrier.stateAfter, m_CommandListParameters.queueType);
 
             if ((before.stageFlags != beforeStageFlags || after.stageFlags != afterStageFlags) && !imageBarriers.empty())
             {
@@ -187,9 +239,9 @@ namespace nvrhi::vulkan
 
             vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange()
                 .setBaseArrayLayer(barrier.entireTexture ? 0 : barrier.arraySlice)
-                .setLayerCount(barrier.entireTexture ? texture->desc.arraySize : 1)
+                .setLayerCount(barrier.entireTexture ? texture->desc.arraySize : barrier.numArraySlices)
                 .setBaseMipLevel(barrier.entireTexture ? 0 : barrier.mipLevel)
-                .setLevelCount(barrier.entireTexture ? texture->desc.mipLevels : 1)
+                .setLevelCount(barrier.entireTexture ? texture->desc.mipLevels : barrier.numMipLevels)
                 .setAspectMask(aspectMask);
 
             imageBarriers.push_back(vk::ImageMemoryBarrier()
@@ -215,8 +267,11 @@ namespace nvrhi::vulkan
 
         for (const BufferBarrier& barrier : m_StateTracker.getBufferBarriers())
         {
-            ResourceStateMapping before = convertResourceState(barrier.stateBefore);
-            ResourceStateMapping after = convertResourceState(barrier.stateAfter);
+            if (barrier.split == BarrierSplit::End)
+                continue;
+
+            ResourceStateMapping before = convertResourceState(barrier.stateBefore, m_CommandListParameters.queueType);
+            ResourceStateMapping after = convertResourceState(barrier.stateAfter, m_CommandListParameters.queueType);
 
             if ((before.stageFlags != beforeStageFlags || after.stageFlags != afterStageFlags) && !bufferBarriers.empty())
             {
@@ -251,15 +306,69 @@ namespace nvrhi::vulkan
         m_StateTracker.clearBarriers();
     }
 
+    void CommandList::beginSplitBarrier(PendingSplitBarrier& pending)
+    {
+        pending.event = m_CurrentCmdBuf->acquireSplitBarrierEvent();
+        if (!pending.event)
+            return;
+
+        vk::DependencyInfo dep_info;
+        if (pending.imageBarrier.image)
+            dep_info.setImageMemoryBarriers(pending.imageBarrier);
+        else
+            dep_info.setBufferMemoryBarriers(pending.bufferBarrier);
+
+        m_CurrentCmdBuf->cmdBuf.setEvent2(pending.event, dep_info);
+
+        m_PendingSplitBarriers.push_back(pending);
+    }
+
+    void CommandList::endSplitBarrier(const void* resource, MipLevel mipLevel, ArraySlice arraySlice, bool entireTexture)
+    {
+        for (auto it = m_PendingSplitBarriers.begin(); it != m_PendingSplitBarriers.end(); ++it)
+        {
+            if (it->resource != resource || it->entireTexture != entireTexture ||
+                (!entireTexture && (it->mipLevel != mipLevel || it->arraySlice != arraySlice)))
+                continue;
+
+            vk::DependencyInfo dep_info;
+            vk::PipelineStageFlags2 dstStageMask;
+            if (it->imageBarrier.image)
+            {
+                dep_info.setImageMemoryBarriers(it->imageBarrier);
+                dstStageMask = it->imageBarrier.dstStageMask;
+            }
+            else
+            {
+                dep_info.setBufferMemoryBarriers(it->bufferBarrier);
+                dstStageMask = it->bufferBarrier.dstStageMask;
+            }
+
+            m_CurrentCmdBuf->cmdBuf.waitEvents2(1, &it->event, &dep_info);
+
+            // Unsignal the event on the GPU, so it can be set again after the command buffer is retired
+            m_CurrentCmdBuf->cmdBuf.resetEvent2(it->event, dstStageMask);
+
+            m_PendingSplitBarriers.erase(it);
+            return;
+        }
+
+        // The Begin half was not recorded, e.g. if the event could not be created: nothing to wait for
+    }
+
     void CommandList::commitBarriersInternal_synchronization2()
     {
         std::vector<vk::ImageMemoryBarrier2> imageBarriers;
         std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
 
+        // Split barriers are recorded in order: End halves first, since the regular barriers in the same batch
+        // may transition the same resources further, and Begin halves last, after the regular barriers.
+        std::vector<PendingSplitBarrier> beginSplitBarriers;
+
         for (const TextureBarrier& barrier : m_StateTracker.getTextureBarriers())
         {
-            ResourceStateMapping2 before = convertResourceState2(barrier.stateBefore);
-            ResourceStateMapping2 after = convertResourceState2(barrier.stateAfter);
+            ResourceStateMapping2 before = convertResourceState2(barrier.stateBefore, m_CommandListParameters.queueType);
+            ResourceStateMapping2 after = convertResourceState2(barrier.stateAfter, m_CommandListParameters.queueType);
 
             assert(after.imageLayout != vk::ImageLayout::eUndefined);
 
@@ -274,12 +383,12 @@ namespace nvrhi::vulkan
 
             vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange()
                 .setBaseArrayLayer(barrier.entireTexture ? 0 : barrier.arraySlice)
-                .setLayerCount(barrier.entireTexture ? texture->desc.arraySize : 1)
+                .setLayerCount(barrier.entireTexture ? texture->desc.arraySize : barrier.numArraySlices)
                 .setBaseMipLevel(barrier.entireTexture ? 0 : barrier.mipLevel)
-                .setLevelCount(barrier.entireTexture ? texture->desc.mipLevels : 1)
+                .setLevelCount(barrier.entireTexture ? texture->desc.mipLevels : barrier.numMipLevels)
                 .setAspectMask(aspectMask);
 
-            imageBarriers.push_back(vk::ImageMemoryBarrier2()
+            auto imageBarrier = vk::ImageMemoryBarrier2()
                 .setSrcAccessMask(before.accessMask)
                 .setDstAccessMask(after.accessMask)
                 .setSrcStageMask(before.stageFlags)
@@ -289,7 +398,26 @@ namespace nvrhi::vulkan
                 .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
                 .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
                 .setImage(texture->image)
-                .setSubresourceRange(subresourceRange));
+                .setSubresourceRange(subresourceRange);
+
+            if (barrier.split == BarrierSplit::End)
+            {
+                endSplitBarrier(barrier.texture, barrier.mipLevel, barrier.arraySlice, barrier.entireTexture);
+            }
+            else if (barrier.split == BarrierSplit::Begin)
+            {
+                PendingSplitBarrier pending;
+                pending.resource = barrier.texture;
+                pending.mipLevel = barrier.mipLevel;
+                pending.arraySlice = barrier.arraySlice;
+                pending.entireTexture = barrier.entireTexture;
+                pending.imageBarrier = imageBarrier;
+                beginSplitBarriers.push_back(pending);
+            }
+            else
+            {
+                imageBarriers.push_back(imageBarrier);
+            }
         }
 
         if (!imageBarriers.empty())
@@ -304,12 +432,12 @@ namespace nvrhi::vulkan
 
         for (const BufferBarrier& barrier : m_StateTracker.getBufferBarriers())
         {
-            ResourceStateMapping2 before = convertResourceState2(barrier.stateBefore);
-            ResourceStateMapping2 after = convertResourceState2(barrier.stateAfter);
+            ResourceStateMapping2 before = convertResourceState2(barrier.stateBefore, m_CommandListParameters.queueType);
+            ResourceStateMapping2 after = convertResourceState2(barrier.stateAfter, m_CommandListParameters.queueType);
 
             Buffer* buffer = static_cast<Buffer*>(barrier.buffer);
 
-            bufferBarriers.push_back(vk::BufferMemoryBarrier2()
+            auto bufferBarrier = vk::BufferMemoryBarrier2()
                 .setSrcAccessMask(before.accessMask)
                 .setDstAccessMask(after.accessMask)
                 .setSrcStageMask(before.stageFlags)
@@ -318,7 +446,24 @@ namespace nvrhi::vulkan
                 .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
                 .setBuffer(buffer->buffer)
                 .setOffset(0)
-                .setSize(buffer->desc.byteSize));
+                .setSize(buffer->desc.byteSize);
+
+            if (barrier.split == BarrierSplit::End)
+            {
+                endSplitBarrier(barrier.buffer, 0, 0, true);
+            }
+            else if (barrier.split == BarrierSplit::Begin)
+            {
+                PendingSplitBarrier pending;
+                pending.resource = barrier.buffer;
+                pending.entireTexture = true;
+                pending.bufferBarrier = bufferBarrier;
+                beginSplitBarriers.push_back(pending);
+            }
+            else
+            {
+                bufferBarriers.push_back(bufferBarrier);
+            }
         }
 
         if (!bufferBarriers.empty())
@@ -330,14 +475,47 @@ namespace nvrhi::vulkan
         }
         bufferBarriers.clear();
 
+        for (PendingSplitBarrier& pending : beginSplitBarriers)
+            beginSplitBarrier(pending);
+
         m_StateTracker.clearBarriers();
     }
 
+    void CommandList::aliasingBarrier(IResource* resourceBefore, IResource* resourceAfter)
+    {
+        commitBarriers();
+        endRenderPass();
+
+        // Vulkan has no aliasing barrier: make the writes to the shared memory visible with a global memory barrier.
+        if (resourceBefore)
+            m_CurrentCmdBuf->referencedResources.push_back(resourceBefore);
+        if (resourceAfter)
+            m_CurrentCmdBuf->referencedResources.push_back(resourceAfter);
+
+        // The layout of an image is lost when other resources write its memory, so its next transition
+        // must start from UNDEFINED, which is the layout of ResourceStates::Common.
+        if (Texture* textureAfter = dynamic_cast<Texture*>(resourceAfter))
+        {
+            if (textureAfter->permanentState == ResourceStates::Unknown)
+                m_StateTracker.beginTrackingTextureState(textureAfter, AllSubresources, ResourceStates::Common);
+        }
+
+        const auto memoryBarrier = vk::MemoryBarrier()
+            .setSrcAccessMask(vk::AccessFlagBits::eMemoryWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+
+        m_CurrentCmdBuf->cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eAllCommands,
+            vk::DependencyFlags(), { memoryBarrier }, {}, {});
+    }
+
     void CommandList::commitBarriers()
     {
         if (m_StateTracker.getBufferBarriers().empty() && m_StateTracker.getTextureBarriers().empty())
             return;
 
+        if (m_CommandListParameters.enableStatistics)
+            countBarriers(m_StateTracker, m_Statistics);
+
         endRenderPass();
 
         if (m_Context.extensions.KHR_synchronization2)
@@ -354,6 +532,9 @@ namespace nvrhi::vulkan
     {
         Texture* texture = checked_cast<Texture*>(_texture);
 
+        if (!m_DeferredClears.empty())
+            executeDeferredClears();
+
         m_StateTracker.beginTrackingTextureState(texture, subresources, stateBits);
     }
 
@@ -368,6 +549,9 @@ namespace nvrhi::vulkan
     {
         Texture* texture = checked_cast<Texture*>(_texture);
 
+        if (!m_DeferredClears.empty())
+            executeDeferredClears();
+
         m_StateTracker.requireTextureState(texture, subresources, stateBits);
 
         if (m_CurrentCmdBuf)
@@ -384,6 +568,26 @@ namespace nvrhi::vulkan
             m_CurrentCmdBuf->referencedResources.push_back(buffer);
     }
     
+    void CommandList::beginTextureStateTransition(ITexture* _texture, TextureSubresourceSet subresources, ResourceStates stateBits)
+    {
+        Texture* texture = checked_cast<Texture*>(_texture);
+
+        m_StateTracker.beginTextureStateTransition(texture, subresources, stateBits);
+
+        if (m_CurrentCmdBuf)
+            m_CurrentCmdBuf->referencedResources.push_back(texture);
+    }
+
+    void CommandList::beginBufferStateTransition(IBuffer* _buffer, ResourceStates stateBits)
+    {
+        Buffer* buffer = checked_cast<Buffer*>(_buffer);
+
+        m_StateTracker.beginBufferStateTransition(buffer, stateBits);
+
+        if (m_CurrentCmdBuf)
+            m_CurrentCmdBuf->referencedResources.push_back(buffer);
+    }
+
     void CommandList::setAccelStructState(rt::IAccelStruct* _as, ResourceStates stateBits)
     {
         AccelStruct* as = checked_cast<AccelStruct*>(_as);
@@ -402,6 +606,9 @@ namespace nvrhi::vulkan
     {
         Texture* texture = checked_cast<Texture*>(_texture);
 
+        if (!m_DeferredClears.empty())
+            executeDeferredClears();
+
         m_StateTracker.setPermanentTextureState(texture, AllSubresources, stateBits);
 
         if (m_CurrentCmdBuf)
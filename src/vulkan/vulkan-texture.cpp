@@ -21,6 +21,7 @@
 */
 
 #include <algorithm>
+#include <numeric>
 
 #include "vulkan-backend.h"
 #include <nvrhi/common/misc.h>
@@ -212,11 +213,14 @@ namespace nvrhi::vulkan
         if (d.isTypeless)
             flags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
 
+        if (d.isTiled)
+            flags |= vk::ImageCreateFlagBits::eSparseBinding | vk::ImageCreateFlagBits::eSparseResidency;
+
         return flags;
     }
 
     // fills out all info fields in Texture based on a TextureDesc
-    static void fillTextureInfo(Texture *texture, const TextureDesc& desc)
+    static void fillTextureInfo(const VulkanContext& context, Texture *texture, const TextureDesc& desc)
     {
         texture->desc = desc;
 
@@ -239,6 +243,12 @@ namespace nvrhi::vulkan
                                 .setSharingMode(vk::SharingMode::eExclusive)
                                 .setSamples(sampleCount)
                                 .setFlags(flags);
+
+        if (!context.concurrentQueueFamilies.empty())
+        {
+            texture->imageInfo.setSharingMode(vk::SharingMode::eConcurrent)
+                .setQueueFamilyIndices(context.concurrentQueueFamilies);
+        }
         
 #if _WIN32
         const auto handleType = vk::ExternalMemoryHandleTypeFlagBits::eOpaqueWin32;
@@ -253,13 +263,40 @@ namespace nvrhi::vulkan
             texture->imageInfo.setPNext(&texture->externalMemoryImageInfo);
     }
 
+    TextureSubresourceView* Texture::findViewLockFree(const SubresourceViewKey& key, size_t hash) const
+    {
+        for (uint32_t probe = 0; probe < c_ViewTableSize; probe++)
+        {
+            SubresourceViewMap::value_type* entry = m_ViewTable[(hash + probe) % c_ViewTableSize].load(std::memory_order_acquire);
+
+            // Slots are filled in probe order and never cleared, so an empty slot ends the search
+            if (!entry)
+                return nullptr;
+
+            if (entry->first == key)
+                return &entry->second;
+        }
+
+        return nullptr;
+    }
+
+    void Texture::publishView(SubresourceViewMap::value_type* entry, size_t hash)
+    {
+        for (uint32_t probe = 0; probe < c_ViewTableSize; probe++)
+        {
+            auto& slot = m_ViewTable[(hash + probe) % c_ViewTableSize];
+            if (!slot.load(std::memory_order_relaxed))
+            {
+                // Release ordering makes the view creation visible to the readers that find the entry
+                slot.store(entry, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
     TextureSubresourceView& Texture::getSubresourceView(const TextureSubresourceSet& subresource, TextureDimension dimension,
         Format format, vk::ImageUsageFlags usage, TextureSubresourceViewType viewtype)
     {
-        // This function is called from createBindingSet etc. and therefore free-threaded.
-        // It modifies the subresourceViews map associated with the texture.
-        std::lock_guard lockGuard(m_Mutex);
-
         if (dimension == TextureDimension::Unknown)
             dimension = desc.dimension;
 
@@ -271,7 +308,16 @@ namespace nvrhi::vulkan
         if (!desc.isTypeless)
             usage = vk::ImageUsageFlags(0);
 
-        auto cachekey = std::make_tuple(subresource, viewtype, dimension, format, usage);
+        const SubresourceViewKey cachekey = std::make_tuple(subresource, viewtype, dimension, format, usage);
+        const size_t hash = Hash()(cachekey);
+
+        if (TextureSubresourceView* existingView = findViewLockFree(cachekey, hash))
+            return *existingView;
+
+        // This function is called from createBindingSet etc. and therefore free-threaded.
+        // It modifies the subresourceViews map associated with the texture.
+        std::lock_guard lockGuard(m_Mutex);
+
         auto iter = subresourceViews.find(cachekey);
         if (iter != subresourceViews.end())
         {
@@ -320,14 +366,31 @@ namespace nvrhi::vulkan
         const std::string debugName = std::string("ImageView for: ") + utils::DebugNameToString(desc.debugName);
         m_Context.nameVKObject(VkImageView(view.view), vk::DebugReportObjectTypeEXT::eImageView, debugName.c_str());
 
+        publishView(&*std::get<0>(iter_pair), hash);
+
         return view;
     }
 
+    void Texture::createDefaultViews()
+    {
+        // Typeless textures have no format to create the views with, their bindings always specify one
+        if (desc.isTypeless)
+            return;
+
+        const TextureSubresourceViewType viewType = getTextureViewType(Format::UNKNOWN, desc.format);
+
+        if (desc.isShaderResource)
+            getSubresourceView(AllSubresources.resolve(desc, false), desc.dimension, Format::UNKNOWN, vk::ImageUsageFlagBits::eSampled, viewType);
+
+        if (desc.isUAV)
+            getSubresourceView(AllSubresources.resolve(desc, true), desc.dimension, Format::UNKNOWN, vk::ImageUsageFlagBits::eStorage, viewType);
+    }
+
     TextureHandle Device::createTexture(const TextureDesc& desc)
     {
         Texture *texture = new Texture(m_Context, m_Allocator);
         assert(texture);
-        fillTextureInfo(texture, desc);
+        fillTextureInfo(m_Context, texture, desc);
 
         vk::Result res = m_Context.device.createImage(&texture->imageInfo, m_Context.allocationCallbacks, &texture->image);
         ASSERT_VK_OK(res);
@@ -335,7 +398,7 @@ namespace nvrhi::vulkan
 
         m_Context.nameVKObject(texture->image, vk::DebugReportObjectTypeEXT::eImage, desc.debugName.c_str());
 
-        if (!desc.isVirtual)
+        if (!desc.isVirtual && !desc.isTiled)
         {
             res = m_Allocator.allocateTextureMemory(texture);
             ASSERT_VK_OK(res);
@@ -350,7 +413,10 @@ namespace nvrhi::vulkan
 #endif
             }
 
-            m_Context.nameVKObject(texture->memory, vk::DebugReportObjectTypeEXT::eDeviceMemory, desc.debugName.c_str());
+            if (!texture->memoryBlock)
+                m_Context.nameVKObject(texture->memory, vk::DebugReportObjectTypeEXT::eDeviceMemory, desc.debugName.c_str());
+
+            texture->createDefaultViews();
         }
 
         return TextureHandle::Create(texture);
@@ -383,10 +449,159 @@ namespace nvrhi::vulkan
         m_Context.device.bindImageMemory(texture->image, heap->memory, offset);
 
         texture->heap = heap;
+        texture->createDefaultViews();
 
         return true;
     }
 
+    void Device::getTextureTiling(ITexture* _texture, uint32_t* numTiles, PackedMipDesc* packedMipDesc, TileShape* tileShape,
+        uint32_t* numSubresourceTilings, SubresourceTiling* subresourceTilings)
+    {
+        Texture* texture = checked_cast<Texture*>(_texture);
+
+        const vk::MemoryRequirements memoryRequirements = m_Context.device.getImageMemoryRequirements(texture->image);
+        const std::vector<vk::SparseImageMemoryRequirements> sparseRequirements = m_Context.device.getImageSparseMemoryRequirements(texture->image);
+
+        // The sparse block size is the memory alignment of sparse images, 64 KB on all known implementations
+        const uint64_t tileSize = memoryRequirements.alignment;
+        vk::Extent3D granularity = { 1, 1, 1 };
+        uint32_t numStandardMips = texture->desc.mipLevels;
+        uint64_t mipTailSize = 0;
+        uint64_t mipTailOffset = 0;
+
+        if (!sparseRequirements.empty())
+        {
+            const vk::SparseImageMemoryRequirements& requirements = sparseRequirements[0];
+            granularity = requirements.formatProperties.imageGranularity;
+            numStandardMips = std::min(requirements.imageMipTailFirstLod, texture->desc.mipLevels);
+            mipTailSize = requirements.imageMipTailSize;
+            mipTailOffset = requirements.imageMipTailOffset;
+        }
+
+        if (numTiles)
+            *numTiles = uint32_t(memoryRequirements.size / tileSize);
+
+        if (packedMipDesc)
+        {
+            packedMipDesc->numStandardMips = numStandardMips;
+            packedMipDesc->numPackedMips = texture->desc.mipLevels - numStandardMips;
+            packedMipDesc->numTilesForPackedMips = uint32_t((mipTailSize + tileSize - 1) / tileSize);
+            packedMipDesc->startTileIndexInOverallResource = uint32_t(mipTailOffset / tileSize);
+        }
+
+        if (tileShape)
+        {
+            tileShape->widthInTexels = granularity.width;
+            tileShape->heightInTexels = granularity.height;
+            tileShape->depthInTexels = granularity.depth;
+        }
+
+        if (numSubresourceTilings)
+        {
+            const uint32_t count = std::min(*numSubresourceTilings, numStandardMips);
+            uint32_t startTileIndex = 0;
+
+            for (uint32_t mipLevel = 0; mipLevel < count; ++mipLevel)
+            {
+                SubresourceTiling& tiling = subresourceTilings[mipLevel];
+                tiling.widthInTiles = (std::max(texture->desc.width >> mipLevel, 1u) + granularity.width - 1) / granularity.width;
+                tiling.heightInTiles = (std::max(texture->desc.height >> mipLevel, 1u) + granularity.height - 1) / granularity.height;
+                tiling.depthInTiles = (std::max(texture->desc.depth >> mipLevel, 1u) + granularity.depth - 1) / granularity.depth;
+                tiling.startTileIndexInOverallResource = startTileIndex;
+
+                startTileIndex += tiling.widthInTiles * tiling.heightInTiles * tiling.depthInTiles;
+            }
+
+            *numSubresourceTilings = count;
+        }
+    }
+
+    void Device::updateTextureTileMappings(ITexture* _texture, const TextureTilesMapping* tileMappings, uint32_t numTileMappings, CommandQueue executionQueue)
+    {
+        Texture* texture = checked_cast<Texture*>(_texture);
+        Queue* queue = m_Queues[uint32_t(executionQueue)].get();
+
+        const vk::MemoryRequirements memoryRequirements = m_Context.device.getImageMemoryRequirements(texture->image);
+        const std::vector<vk::SparseImageMemoryRequirements> sparseRequirements = m_Context.device.getImageSparseMemoryRequirements(texture->image);
+        if (sparseRequirements.empty())
+            return;
+
+        const vk::SparseImageMemoryRequirements& requirements = sparseRequirements[0];
+        const vk::Extent3D granularity = requirements.formatProperties.imageGranularity;
+        const bool singleMipTail = !!(requirements.formatProperties.flags & vk::SparseImageFormatFlagBits::eSingleMiptail);
+        const vk::ImageAspectFlags aspectMask = guessImageAspectFlags(texture->imageInfo.format);
+
+        std::vector<vk::SparseImageMemoryBind> imageBinds;
+        std::vector<vk::SparseMemoryBind> mipTailBinds;
+
+        for (uint32_t mappingIndex = 0; mappingIndex < numTileMappings; ++mappingIndex)
+        {
+            const TextureTilesMapping& mapping = tileMappings[mappingIndex];
+            Heap* heap = mapping.heap ? checked_cast<Heap*>(mapping.heap) : nullptr;
+            const vk::DeviceMemory memory = heap ? heap->memory : vk::DeviceMemory();
+
+            for (uint32_t i = 0; i < mapping.numTextureRegions; ++i)
+            {
+                const TiledTextureCoordinate& coordinate = mapping.tiledTextureCoordinates[i];
+                const TiledTextureRegion& region = mapping.tiledTextureRegions[i];
+                const uint64_t memoryOffset = heap ? mapping.byteOffsets[i] : 0;
+
+                if (coordinate.mipLevel >= requirements.imageMipTailFirstLod)
+                {
+                    // The mip tail is not addressed in tiles but as an opaque memory range
+                    vk::DeviceSize resourceOffset = requirements.imageMipTailOffset;
+                    if (!singleMipTail)
+                        resourceOffset += coordinate.arraySlice * requirements.imageMipTailStride;
+
+                    mipTailBinds.push_back(vk::SparseMemoryBind()
+                        .setResourceOffset(resourceOffset + coordinate.x * memoryRequirements.alignment)
+                        .setSize(region.numTiles * memoryRequirements.alignment)
+                        .setMemory(memory)
+                        .setMemoryOffset(memoryOffset));
+                }
+                else
+                {
+                    // Regions that reach the edge of the mip level must end at the edge and not at the tile boundary
+                    const uint32_t mipWidth = std::max(texture->desc.width >> coordinate.mipLevel, 1u);
+                    const uint32_t mipHeight = std::max(texture->desc.height >> coordinate.mipLevel, 1u);
+                    const uint32_t mipDepth = std::max(texture->desc.depth >> coordinate.mipLevel, 1u);
+
+                    const vk::Offset3D offset(coordinate.x * granularity.width, coordinate.y * granularity.height, coordinate.z * granularity.depth);
+                    const vk::Extent3D extent(
+                        std::min(region.width * granularity.width, mipWidth - uint32_t(offset.x)),
+                        std::min(region.height * granularity.height, mipHeight - uint32_t(offset.y)),
+                        std::min(region.depth * granularity.depth, mipDepth - uint32_t(offset.z)));
+
+                    imageBinds.push_back(vk::SparseImageMemoryBind()
+                        .setSubresource(vk::ImageSubresource(aspectMask, coordinate.mipLevel, coordinate.arraySlice))
+                        .setOffset(offset)
+                        .setExtent(extent)
+                        .setMemory(memory)
+                        .setMemoryOffset(memoryOffset));
+                }
+            }
+
+            if (heap && std::find(texture->tileMappingHeaps.begin(), texture->tileMappingHeaps.end(), mapping.heap) == texture->tileMappingHeaps.end())
+                texture->tileMappingHeaps.push_back(mapping.heap);
+        }
+
+        const auto imageBindInfo = vk::SparseImageMemoryBindInfo()
+            .setImage(texture->image)
+            .setBinds(imageBinds);
+
+        const auto mipTailBindInfo = vk::SparseImageOpaqueMemoryBindInfo()
+            .setImage(texture->image)
+            .setBinds(mipTailBinds);
+
+        auto bindInfo = vk::BindSparseInfo();
+        if (!imageBinds.empty())
+            bindInfo.setImageBinds(imageBindInfo);
+        if (!mipTailBinds.empty())
+            bindInfo.setImageOpaqueBinds(mipTailBindInfo);
+
+        queue->bindSparse(bindInfo);
+    }
+
     void CommandList::copyTexture(ITexture* _dst, const TextureSlice& dstSlice,
                                   ITexture* _src, const TextureSlice& srcSlice)
     {
@@ -533,6 +748,123 @@ namespace nvrhi::vulkan
             1, &imageCopy);
     }
 
+    void CommandList::writeTextureRegions(ITexture* _dest, const TextureUploadRegion* regions, size_t numRegions)
+    {
+        endRenderPass();
+
+        Texture* dest = checked_cast<Texture*>(_dest);
+
+        if (numRegions == 0)
+            return;
+
+        const TextureDesc& desc = dest->getDesc();
+        const FormatInfo& formatInfo = getFormatInfo(desc.format);
+
+        // bufferOffset must be a multiple of 4 and of the texel block size
+        const uint64_t regionAlignment = std::lcm(uint64_t(4), uint64_t(formatInfo.bytesPerBlock));
+
+        struct RegionLayout
+        {
+            uint64_t offset;
+            uint32_t numRows;
+            uint32_t rowPitch;
+            uint32_t depth;
+        };
+
+        std::vector<RegionLayout> layouts(numRegions);
+        std::vector<vk::BufferImageCopy> imageCopies(numRegions);
+
+        MipLevel minMip = regions[0].mipLevel, maxMip = regions[0].mipLevel;
+        ArraySlice minSlice = regions[0].arraySlice, maxSlice = regions[0].arraySlice;
+
+        // Compute the packed layout of all regions
+        uint64_t totalBytes = 0;
+        for (size_t i = 0; i < numRegions; i++)
+        {
+            const TextureUploadRegion& region = regions[i];
+
+            uint32_t mipWidth, mipHeight, mipDepth;
+            computeMipLevelInformation(desc, region.mipLevel, &mipWidth, &mipHeight, &mipDepth);
+
+            uint32_t deviceNumCols = (mipWidth + formatInfo.blockSize - 1) / formatInfo.blockSize;
+            uint32_t deviceNumRows = (mipHeight + formatInfo.blockSize - 1) / formatInfo.blockSize;
+            uint32_t deviceRowPitch = deviceNumCols * formatInfo.bytesPerBlock;
+
+            RegionLayout& layout = layouts[i];
+            layout.offset = (totalBytes + regionAlignment - 1) / regionAlignment * regionAlignment;
+            layout.numRows = deviceNumRows;
+            layout.rowPitch = deviceRowPitch;
+            layout.depth = mipDepth;
+            totalBytes = layout.offset + uint64_t(deviceRowPitch) * deviceNumRows * mipDepth;
+
+            imageCopies[i] = vk::BufferImageCopy()
+                .setBufferOffset(layout.offset)
+                .setBufferRowLength(deviceNumCols * formatInfo.blockSize)
+                .setBufferImageHeight(deviceNumRows * formatInfo.blockSize)
+                .setImageSubresource(vk::ImageSubresourceLayers()
+                    .setAspectMask(guessImageAspectFlags(dest->imageInfo.format))
+                    .setMipLevel(region.mipLevel)
+                    .setBaseArrayLayer(region.arraySlice)
+                    .setLayerCount(1))
+                .setImageExtent(vk::Extent3D().setWidth(mipWidth).setHeight(mipHeight).setDepth(mipDepth));
+
+            minMip = std::min(minMip, region.mipLevel);
+            maxMip = std::max(maxMip, region.mipLevel);
+            minSlice = std::min(minSlice, region.arraySlice);
+            maxSlice = std::max(maxSlice, region.arraySlice);
+        }
+
+        Buffer* uploadBuffer;
+        uint64_t uploadOffset;
+        void* uploadCpuVA;
+        if (!m_UploadManager->suballocateBuffer(
+            totalBytes,
+            &uploadBuffer,
+            &uploadOffset,
+            &uploadCpuVA,
+            MakeVersion(m_CurrentCmdBuf->recordingID, m_CommandListParameters.queueType, false)))
+        {
+            m_Context.error("Couldn't suballocate an upload buffer");
+            return;
+        }
+
+        for (size_t i = 0; i < numRegions; i++)
+        {
+            const TextureUploadRegion& region = regions[i];
+            const RegionLayout& layout = layouts[i];
+
+            size_t minRowPitch = std::min(size_t(layout.rowPitch), region.rowPitch);
+            uint8_t* mappedPtr = (uint8_t*)uploadCpuVA + layout.offset;
+            for (uint32_t slice = 0; slice < layout.depth; slice++)
+            {
+                const uint8_t* sourcePtr = (const uint8_t*)region.data + region.depthPitch * slice;
+                for (uint32_t row = 0; row < layout.numRows; row++)
+                {
+                    memcpy(mappedPtr, sourcePtr, minRowPitch);
+                    mappedPtr += layout.rowPitch;
+                    sourcePtr += region.rowPitch;
+                }
+            }
+
+            imageCopies[i].bufferOffset += uploadOffset;
+        }
+
+        assert(m_CurrentCmdBuf);
+
+        // Transition the smallest subresource range that covers all regions with a single barrier
+        if (m_EnableAutomaticBarriers)
+        {
+            requireTextureState(dest, TextureSubresourceSet(minMip, maxMip - minMip + 1, minSlice, maxSlice - minSlice + 1), ResourceStates::CopyDest);
+        }
+        commitBarriers();
+
+        m_CurrentCmdBuf->referencedResources.push_back(dest);
+
+        m_CurrentCmdBuf->cmdBuf.copyBufferToImage(uploadBuffer->buffer,
+            dest->image, vk::ImageLayout::eTransferDstOptimal,
+            uint32_t(imageCopies.size()), imageCopies.data());
+    }
+
     void CommandList::resolveTexture(ITexture* _dest, const TextureSubresourceSet& dstSubresources, ITexture* _src, const TextureSubresourceSet& srcSubresources)
     {
         endRenderPass();
@@ -575,15 +907,10 @@ namespace nvrhi::vulkan
         m_CurrentCmdBuf->cmdBuf.resolveImage(src->image, vk::ImageLayout::eTransferSrcOptimal, dest->image, vk::ImageLayout::eTransferDstOptimal, regions);
     }
 
-    void CommandList::clearTexture(ITexture* _texture, TextureSubresourceSet subresources, const vk::ClearColorValue& clearValue)
+    void CommandList::clearColorImage(Texture* texture, const TextureSubresourceSet& subresources, const vk::ClearColorValue& clearValue)
     {
-        endRenderPass();
-
-        Texture* texture = checked_cast<Texture*>(_texture);
         assert(texture);
         assert(m_CurrentCmdBuf);
-        
-        subresources = subresources.resolve(texture->desc, false);
 
         if (m_EnableAutomaticBarriers)
         {
@@ -604,35 +931,128 @@ namespace nvrhi::vulkan
             1, &subresourceRange);
     }
 
-    void CommandList::clearTextureFloat(ITexture* texture, TextureSubresourceSet subresources, const Color& clearColor)
+    void CommandList::clearDepthStencilImage(Texture* texture, const TextureSubresourceSet& subresources, vk::ImageAspectFlags aspects,
+        const vk::ClearDepthStencilValue& clearValue)
+    {
+        assert(texture);
+        assert(m_CurrentCmdBuf);
+
+        if (m_EnableAutomaticBarriers)
+        {
+            requireTextureState(texture, subresources, ResourceStates::CopyDest);
+        }
+        commitBarriers();
+
+        vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange()
+            .setAspectMask(aspects)
+            .setBaseArrayLayer(subresources.baseArraySlice)
+            .setLayerCount(subresources.numArraySlices)
+            .setBaseMipLevel(subresources.baseMipLevel)
+            .setLevelCount(subresources.numMipLevels);
+
+        m_CurrentCmdBuf->cmdBuf.clearDepthStencilImage(texture->image,
+            vk::ImageLayout::eTransferDstOptimal,
+            &clearValue,
+            1, &subresourceRange);
+    }
+
+    bool CommandList::deferClear(Texture* texture, const TextureSubresourceSet& subresources, vk::ImageAspectFlags aspects, const vk::ClearValue& value)
+    {
+        // Render passes only cover one mip level, and bundles can't contain clears
+        if (!m_CommandListParameters.enableDeferredClears || m_CommandListParameters.isBundle ||
+            !texture->desc.isRenderTarget || subresources.numMipLevels != 1)
+            return false;
+
+        for (DeferredClear& clear : m_DeferredClears)
+        {
+            if (clear.texture != texture)
+                continue;
+
+            if (clear.subresources != subresources)
+            {
+                // Overlapping clears of different subresources have to stay in order, run the earlier ones now
+                endRenderPass();
+                break;
+            }
+
+            // Clearing the same subresources again replaces the values of the aspects that are cleared now
+            if (aspects & vk::ImageAspectFlagBits::eColor)
+                clear.value.color = value.color;
+            if (aspects & vk::ImageAspectFlagBits::eDepth)
+                clear.value.depthStencil.depth = value.depthStencil.depth;
+            if (aspects & vk::ImageAspectFlagBits::eStencil)
+                clear.value.depthStencil.stencil = value.depthStencil.stencil;
+            clear.aspects |= aspects;
+            return true;
+        }
+
+        // The render pass that takes over the clear must begin after this point.
+        // When other clears are pending, there is no active render pass, and ending it would execute them.
+        if (m_DeferredClears.empty())
+            endRenderPass();
+
+        DeferredClear clear;
+        clear.texture = texture;
+        clear.subresources = subresources;
+        clear.aspects = aspects;
+        clear.value = value;
+        m_DeferredClears.push_back(clear);
+
+        m_CurrentCmdBuf->referencedResources.push_back(texture);
+        return true;
+    }
+
+    void CommandList::executeDeferredClears()
+    {
+        // The clears go through requireTextureState and endRenderPass again, so take them out of the list first
+        std::vector<DeferredClear> clears;
+        clears.swap(m_DeferredClears);
+
+        for (const DeferredClear& clear : clears)
+        {
+            if (clear.aspects & vk::ImageAspectFlagBits::eColor)
+                clearColorImage(clear.texture, clear.subresources, clear.value.color);
+            else
+                clearDepthStencilImage(clear.texture, clear.subresources, clear.aspects, clear.value.depthStencil);
+        }
+
+        // Keep the storage for the next recording
+        clears.clear();
+        if (m_DeferredClears.empty())
+            m_DeferredClears.swap(clears);
+    }
+
+    void CommandList::clearTextureFloat(ITexture* _texture, TextureSubresourceSet subresources, const Color& clearColor)
     {
+        Texture* texture = checked_cast<Texture*>(_texture);
+        assert(texture);
+
+        subresources = subresources.resolve(texture->desc, false);
+
         auto clearValue = vk::ClearColorValue()
             .setFloat32({ clearColor.r, clearColor.g, clearColor.b, clearColor.a });
 
-        clearTexture(texture, subresources, clearValue);
+        if (deferClear(texture, subresources, vk::ImageAspectFlagBits::eColor, vk::ClearValue().setColor(clearValue)))
+            return;
+
+        endRenderPass();
+
+        clearColorImage(texture, subresources, clearValue);
     }
 
     void CommandList::clearDepthStencilTexture(ITexture* _texture, TextureSubresourceSet subresources, bool clearDepth, float depth, bool clearStencil, uint8_t stencil)
     {
-        endRenderPass();
-
         if (!clearDepth && !clearStencil)
         {
+            endRenderPass();
             return;
         }
 
         Texture* texture = checked_cast<Texture*>(_texture);
         assert(texture);
-        assert(m_CurrentCmdBuf);
         
         subresources = subresources.resolve(texture->desc, false);
 
-        if (m_EnableAutomaticBarriers)
-        {
-            requireTextureState(texture, subresources, ResourceStates::CopyDest);
-        }
-        commitBarriers();
-
         vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlags();
 
         if (clearDepth)
@@ -641,29 +1061,29 @@ namespace nvrhi::vulkan
         if (clearStencil)
             aspectFlags |= vk::ImageAspectFlagBits::eStencil;
 
-        vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange()
-            .setAspectMask(aspectFlags)
-            .setBaseArrayLayer(subresources.baseArraySlice)
-            .setLayerCount(subresources.numArraySlices)
-            .setBaseMipLevel(subresources.baseMipLevel)
-            .setLevelCount(subresources.numMipLevels);
-
         auto clearValue = vk::ClearDepthStencilValue(depth, uint32_t(stencil));
-        m_CurrentCmdBuf->cmdBuf.clearDepthStencilImage(texture->image,
-            vk::ImageLayout::eTransferDstOptimal,
-            &clearValue,
-            1, &subresourceRange);
+
+        if (deferClear(texture, subresources, aspectFlags, vk::ClearValue().setDepthStencil(clearValue)))
+            return;
+
+        endRenderPass();
+
+        clearDepthStencilImage(texture, subresources, aspectFlags, clearValue);
     }
 
-    void CommandList::clearTextureUInt(ITexture* texture, TextureSubresourceSet subresources, uint32_t clearColor)
+    void CommandList::clearTextureUInt(ITexture* _texture, TextureSubresourceSet subresources, uint32_t clearColor)
     {
+        endRenderPass();
+
+        Texture* texture = checked_cast<Texture*>(_texture);
+
         int clearColorInt = int(clearColor);
 
         auto clearValue = vk::ClearColorValue()
             .setUint32({ clearColor, clearColor, clearColor, clearColor })
             .setInt32({ clearColorInt, clearColorInt, clearColorInt, clearColorInt });
 
-        clearTexture(texture, subresources, clearValue);
+        clearColorImage(texture, subresources.resolve(texture->desc, false), clearValue);
     }
 
     Object Texture::getNativeObject(ObjectType objectType)
@@ -753,7 +1173,7 @@ namespace nvrhi::vulkan
         vk::Image image(VkImage(_texture.integer));
 
         Texture *texture = new Texture(m_Context, m_Allocator);
-        fillTextureInfo(texture, desc);
+        fillTextureInfo(m_Context, texture, desc);
 
         texture->image = image;
         texture->managed = false;
@@ -789,6 +1209,11 @@ namespace nvrhi::vulkan
     }
 
     SamplerHandle Device::createSampler(const SamplerDesc& desc)
+    {
+        return m_ObjectCache.getSampler(desc, [this, &desc] { return createSamplerInternal(desc); });
+    }
+
+    SamplerHandle Device::createSamplerInternal(const SamplerDesc& desc)
     {
         Sampler *sampler = new Sampler(m_Context);
 
@@ -22,12 +22,16 @@
 
 #include "vulkan-backend.h"
 #include <nvrhi/common/misc.h>
+#include <sstream>
 
 namespace nvrhi::vulkan
 {
 
     std::shared_ptr<BufferChunk> UploadManager::CreateChunk(uint64_t size)
     {
+        TraceScope traceScope(m_Device->getContext().traceRecorder.get(), m_IsScratchBuffer ? "Create scratch chunk" : "Create upload chunk", "Upload");
+        traceScope.setArg("bytes", size);
+
         std::shared_ptr<BufferChunk> chunk = std::make_shared<BufferChunk>();
 
         if (m_IsScratchBuffer)
@@ -58,12 +62,20 @@ namespace nvrhi::vulkan
             chunk->bufferSize = size;
         }
 
+        chunk->memoryTracking = TrackedAllocation(m_Device->getContext().memoryCounters,
+            m_IsScratchBuffer ? &InternalMemoryCounters::scratchBufferBytes : &InternalMemoryCounters::uploadBufferBytes, size);
+
         return chunk;
     }
 
     bool UploadManager::suballocateBuffer(uint64_t size, Buffer** pBuffer, uint64_t* pOffset, void** pCpuVA,
         uint64_t currentVersion, uint32_t alignment)
     {
+        m_BytesRequested += size;
+
+        if (m_Ring)
+            return suballocateFromRing(size, pBuffer, pOffset, pCpuVA, currentVersion, alignment);
+
         std::shared_ptr<BufferChunk> chunkToRetire;
 
         if (m_CurrentChunk)
@@ -121,6 +133,11 @@ namespace nvrhi::vulkan
                 return false;
 
             m_CurrentChunk = CreateChunk(sizeToAllocate);
+            if (!m_CurrentChunk->buffer)
+            {
+                m_CurrentChunk.reset();
+                return false;
+            }
         }
 
         m_CurrentChunk->version = currentVersion;
@@ -147,6 +164,89 @@ namespace nvrhi::vulkan
             if (chunk->version == currentVersion)
                 chunk->version = submittedVersion;
         }
+
+        if (m_Ring)
+        {
+            m_Ring->submit(currentVersion, submittedVersion);
+        }
+    }
+
+    bool UploadManager::suballocateFromRing(uint64_t size, Buffer** pBuffer, uint64_t* pOffset, void** pCpuVA,
+        uint64_t currentVersion, uint32_t alignment)
+    {
+        if (!m_RingChunk)
+        {
+            m_RingChunk = CreateChunk(m_Ring->getSize());
+            if (!m_RingChunk->buffer)
+            {
+                m_RingChunk.reset();
+                return false;
+            }
+        }
+
+        const CommandQueue queue = VersionGetQueue(currentVersion);
+        m_Ring->retire(m_Device->queueGetCompletedInstance(queue));
+
+        uint64_t offset = 0;
+        while (!m_Ring->allocate(size, alignment, currentVersion, offset))
+        {
+            const uint64_t oldestVersion = m_Ring->getOldestSubmittedVersion();
+            if (oldestVersion == 0)
+            {
+                std::stringstream ss;
+                ss << "Cannot allocate " << size << " bytes from the upload ring of " << m_Ring->getSize() << " bytes, "
+                    "increase CommandListParameters::uploadRingSize or execute the command list more often";
+                m_Device->getContext().error(ss.str());
+                return false;
+            }
+
+            // The ring is full, wait until the GPU is done with the oldest uploads
+            m_Device->getQueue(queue)->waitCommandList(VersionGetInstance(oldestVersion), ~0ull);
+            m_Ring->retire(m_Device->queueGetCompletedInstance(queue));
+            ++m_NumStalls;
+        }
+
+        m_HighWaterMark = std::max(m_HighWaterMark, m_Ring->getBytesInFlight());
+
+        *pBuffer = checked_cast<Buffer*>(m_RingChunk->buffer.Get());
+        *pOffset = offset;
+        if (pCpuVA)
+            *pCpuVA = (char*)m_RingChunk->mappedMemory + offset;
+
+        return true;
+    }
+
+    UploadStatistics UploadManager::getStatistics() const
+    {
+        UploadStatistics statistics;
+        statistics.numStalls = m_NumStalls;
+
+        if (m_Ring)
+        {
+            statistics.capacity = m_Ring->getSize();
+            statistics.bytesInFlight = m_Ring->getBytesInFlight();
+            statistics.highWaterMark = m_HighWaterMark;
+        }
+        else
+        {
+            // Chunks that are in the pool but not yet known to be completed are counted as in flight
+            for (const auto& chunk : m_ChunkPool)
+            {
+                statistics.capacity += chunk->bufferSize;
+                if (chunk->version != 0)
+                    statistics.bytesInFlight += chunk->bufferSize;
+            }
+            if (m_CurrentChunk)
+            {
+                statistics.capacity += m_CurrentChunk->bufferSize;
+                statistics.bytesInFlight += m_CurrentChunk->bufferSize;
+            }
+
+            // Chunks are never released, so the capacity is also the peak
+            statistics.highWaterMark = statistics.capacity;
+        }
+
+        return statistics;
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "bench.h"
+
+#include <nvrhi/d3d12.h>
+#include <d3d12.h>
+
+namespace nvrhi::bench
+{
+    class D3D12BenchDevice final : public BenchDevice
+    {
+    public:
+        ~D3D12BenchDevice() override
+        {
+            if (m_NvrhiDevice)
+            {
+                m_NvrhiDevice->waitForIdle();
+                m_NvrhiDevice = nullptr;
+            }
+        }
+
+        bool init(IMessageCallback* messageCallback)
+        {
+            // The default adapter is used, which is the one that drives the primary display
+            if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(&m_Device))))
+                return false;
+
+            D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+            if (FAILED(m_Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_GraphicsQueue))))
+                return false;
+
+            d3d12::DeviceDesc deviceDesc;
+            deviceDesc.errorCB = messageCallback;
+            deviceDesc.pDevice = m_Device;
+            deviceDesc.pGraphicsCommandQueue = m_GraphicsQueue;
+
+            m_NvrhiDevice = d3d12::createDevice(deviceDesc);
+            return m_NvrhiDevice != nullptr;
+        }
+
+        [[nodiscard]] IDevice* getDevice() const override { return m_NvrhiDevice; }
+        [[nodiscard]] const char* getBackendName() const override { return "d3d12"; }
+
+    private:
+        RefCountPtr<ID3D12Device> m_Device;
+        RefCountPtr<ID3D12CommandQueue> m_GraphicsQueue;
+        DeviceHandle m_NvrhiDevice;
+    };
+
+    std::unique_ptr<BenchDevice> createD3D12BenchDevice(IMessageCallback* messageCallback)
+    {
+        auto device = std::make_unique<D3D12BenchDevice>();
+        if (!device->init(messageCallback))
+            return nullptr;
+
+        return device;
+    }
+}
@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "bench.h"
+
+#include <nvrhi/vulkan.h>
+
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+// A static NVRHI library expects the application to define the default dispatcher,
+// the shared library defines and exports its own.
+#if !defined(VULKAN_HPP_STORAGE_SHARED)
+VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
+#endif
+
+namespace nvrhi::bench
+{
+    class VulkanBenchDevice final : public BenchDevice
+    {
+    public:
+        ~VulkanBenchDevice() override
+        {
+            if (m_NvrhiDevice)
+            {
+                m_NvrhiDevice->waitForIdle();
+                m_NvrhiDevice = nullptr;
+            }
+
+            if (m_Device)
+                m_Device.destroy();
+
+            if (m_Instance)
+                m_Instance.destroy();
+        }
+
+        bool init(IMessageCallback* messageCallback)
+        {
+            const auto vkGetInstanceProcAddr = m_Loader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
+            if (!vkGetInstanceProcAddr)
+                return false;
+
+            VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
+
+            // Timeline semaphores are required by NVRHI and are core in Vulkan 1.2
+            const auto applicationInfo = vk::ApplicationInfo()
+                .setPApplicationName("nvrhi-bench")
+                .setApiVersion(VK_API_VERSION_1_2);
+
+            const auto instanceInfo = vk::InstanceCreateInfo()
+                .setPApplicationInfo(&applicationInfo);
+
+            if (vk::createInstance(&instanceInfo, nullptr, &m_Instance) != vk::Result::eSuccess)
+                return false;
+
+            VULKAN_HPP_DEFAULT_DISPATCHER.init(m_Instance);
+
+            uint32_t numPhysicalDevices = 0;
+            if (m_Instance.enumeratePhysicalDevices(&numPhysicalDevices, nullptr) != vk::Result::eSuccess || numPhysicalDevices == 0)
+                return false;
+
+            std::vector<vk::PhysicalDevice> physicalDevices(numPhysicalDevices);
+            if (m_Instance.enumeratePhysicalDevices(&numPhysicalDevices, physicalDevices.data()) != vk::Result::eSuccess)
+                return false;
+
+            // Prefer a discrete GPU, otherwise take the first device with a graphics queue
+            int graphicsQueueFamily = -1;
+            for (const vk::PhysicalDevice& physicalDevice : physicalDevices)
+            {
+                const vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+                if (properties.apiVersion < VK_API_VERSION_1_2)
+                    continue;
+
+                const std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
+                for (size_t family = 0; family < queueFamilies.size(); family++)
+                {
+                    if (queueFamilies[family].queueFlags & vk::QueueFlagBits::eGraphics)
+                    {
+                        if (!m_PhysicalDevice || properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu)
+                        {
+                            m_PhysicalDevice = physicalDevice;
+                            graphicsQueueFamily = int(family);
+                        }
+                        break;
+                    }
+                }
+
+                if (m_PhysicalDevice && properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu)
+                    break;
+            }
+
+            if (!m_PhysicalDevice)
+                return false;
+
+            const float queuePriority = 1.f;
+            const auto queueInfo = vk::DeviceQueueCreateInfo()
+                .setQueueFamilyIndex(uint32_t(graphicsQueueFamily))
+                .setQueueCount(1)
+                .setPQueuePriorities(&queuePriority);
+
+            auto vulkan12Features = vk::PhysicalDeviceVulkan12Features()
+                .setTimelineSemaphore(true);
+
+            const auto deviceInfo = vk::DeviceCreateInfo()
+                .setQueueCreateInfos(queueInfo)
+                .setPNext(&vulkan12Features);
+
+            if (m_PhysicalDevice.createDevice(&deviceInfo, nullptr, &m_Device) != vk::Result::eSuccess)
+                return false;
+
+            VULKAN_HPP_DEFAULT_DISPATCHER.init(m_Device);
+
+            vulkan::DeviceDesc deviceDesc;
+            deviceDesc.errorCB = messageCallback;
+            deviceDesc.instance = m_Instance;
+            deviceDesc.physicalDevice = m_PhysicalDevice;
+            deviceDesc.device = m_Device;
+            deviceDesc.graphicsQueue = m_Device.getQueue(uint32_t(graphicsQueueFamily), 0);
+            deviceDesc.graphicsQueueIndex = graphicsQueueFamily;
+
+            m_NvrhiDevice = vulkan::createDevice(deviceDesc);
+            return m_NvrhiDevice != nullptr;
+        }
+
+        [[nodiscard]] IDevice* getDevice() const override { return m_NvrhiDevice; }
+        [[nodiscard]] const char* getBackendName() const override { return "vulkan"; }
+
+    private:
+        vk::DynamicLoader m_Loader;
+        vk::Instance m_Instance;
+        vk::PhysicalDevice m_PhysicalDevice;
+        vk::Device m_Device;
+        DeviceHandle m_NvrhiDevice;
+    };
+
+    std::unique_ptr<BenchDevice> createVulkanBenchDevice(IMessageCallback* messageCallback)
+    {
+        auto device = std::make_unique<VulkanBenchDevice>();
+        if (!device->init(messageCallback))
+            return nullptr;
+
+        return device;
+    }
+}
@@ -0,0 +1,826 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+// nvrhi-bench: microbenchmarks for the CPU cost of the NVRHI hot paths.
+// Every benchmark is run on each available backend, with and without the validation layer,
+// and reports the time per operation. Use --json to write the results in a machine-readable form.
+
+#include "bench.h"
+
+#include <nvrhi/utils.h>
+#if NVRHI_BENCH_WITH_VALIDATION
+#include <nvrhi/validation.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if NVRHI_BENCH_EMBEDDED_DXIL
+#include "bench_vs.dxil.h"
+#include "bench_ps.dxil.h"
+#endif
+#if NVRHI_BENCH_EMBEDDED_SPIRV
+#include "bench_vs.spirv.h"
+#include "bench_ps.spirv.h"
+#endif
+
+namespace nvrhi::bench
+{
+    bool getBenchShaders(GraphicsAPI api, const void** vertexShader, size_t* vertexShaderSize,
+        const void** pixelShader, size_t* pixelShaderSize)
+    {
+        *vertexShader = nullptr;
+        *pixelShader = nullptr;
+        *vertexShaderSize = 0;
+        *pixelShaderSize = 0;
+
+        switch (api)
+        {
+        case GraphicsAPI::D3D12:
+#if NVRHI_BENCH_EMBEDDED_DXIL
+            *vertexShader = g_BenchVSDXIL;
+            *vertexShaderSize = sizeof(g_BenchVSDXIL);
+            *pixelShader = g_BenchPSDXIL;
+            *pixelShaderSize = sizeof(g_BenchPSDXIL);
+#endif
+            break;
+
+        case GraphicsAPI::VULKAN:
+#if NVRHI_BENCH_EMBEDDED_SPIRV
+            *vertexShader = g_BenchVSSPIRV;
+            *vertexShaderSize = sizeof(g_BenchVSSPIRV);
+            *pixelShader = g_BenchPSSPIRV;
+            *pixelShaderSize = sizeof(g_BenchPSSPIRV);
+#endif
+            break;
+
+        default:
+            break;
+        }
+
+        return *vertexShader != nullptr && *pixelShader != nullptr;
+    }
+
+    namespace
+    {
+        // Counts the errors, so that a benchmark that triggers them can be reported as failed
+        class MessageCallback final : public IMessageCallback
+        {
+        public:
+            void message(MessageSeverity severity, const char* messageText) override
+            {
+                if (severity == MessageSeverity::Error || severity == MessageSeverity::Fatal)
+                {
+                    ++numErrors;
+                    fprintf(stderr, "NVRHI error: %s\n", messageText);
+                }
+            }
+
+            uint32_t numErrors = 0;
+        };
+
+        class Benchmark
+        {
+        public:
+            virtual ~Benchmark() = default;
+            [[nodiscard]] virtual const char* getName() const = 0;
+
+            // Creates the objects used by run(). Returns false if the benchmark can't run on the device.
+            virtual bool setup(IDevice* device) = 0;
+
+            // Performs the measured operations once and returns their count
+            virtual uint32_t run(IDevice* device) = 0;
+
+            // Unmeasured work that follows each run, such as executing the recorded command list
+            virtual void finish(IDevice* device) { (void)device; }
+
+            // Number of bytes that each operation transfers, for the throughput benchmarks
+            [[nodiscard]] virtual uint64_t getBytesPerOperation() const { return 0; }
+        };
+
+        // A texture, a sampler and a constant buffer, matching the resources used by shaders/bench.hlsl
+        struct BenchResources
+        {
+            TextureHandle texture;
+            SamplerHandle sampler;
+            BufferHandle constantBuffer;
+            BindingLayoutHandle bindingLayout;
+
+            bool create(IDevice* device)
+            {
+                texture = device->createTexture(TextureDesc()
+                    .setWidth(64)
+                    .setHeight(64)
+                    .setFormat(Format::RGBA8_UNORM)
+                    .setInitialState(ResourceStates::ShaderResource)
+                    .setKeepInitialState(true)
+                    .setDebugName("BenchTexture"));
+
+                sampler = device->createSampler(SamplerDesc());
+
+                constantBuffer = device->createBuffer(BufferDesc()
+                    .setByteSize(256)
+                    .setIsConstantBuffer(true)
+                    .setInitialState(ResourceStates::ConstantBuffer)
+                    .setKeepInitialState(true)
+                    .setDebugName("BenchConstants"));
+
+                bindingLayout = device->createBindingLayout(BindingLayoutDesc()
+                    .setVisibility(ShaderType::All)
+                    .addItem(BindingLayoutItem::ConstantBuffer(0))
+                    .addItem(BindingLayoutItem::Texture_SRV(0))
+                    .addItem(BindingLayoutItem::Sampler(0)));
+
+                return texture && sampler && constantBuffer && bindingLayout;
+            }
+
+            [[nodiscard]] BindingSetDesc getBindingSetDesc() const
+            {
+                return BindingSetDesc()
+                    .addItem(BindingSetItem::ConstantBuffer(0, constantBuffer))
+                    .addItem(BindingSetItem::Texture_SRV(0, texture))
+                    .addItem(BindingSetItem::Sampler(0, sampler));
+            }
+        };
+
+        // Objects shared by the draw and pipeline benchmarks
+        struct BenchPipeline
+        {
+            ShaderHandle vertexShader;
+            ShaderHandle pixelShader;
+            TextureHandle renderTarget;
+            FramebufferHandle framebuffer;
+            GraphicsPipelineDesc pipelineDesc;
+
+            bool create(IDevice* device, IBindingLayout* bindingLayout)
+            {
+                const void* vsBinary = nullptr;
+                const void* psBinary = nullptr;
+                size_t vsSize = 0;
+                size_t psSize = 0;
+                if (!getBenchShaders(device->getGraphicsAPI(), &vsBinary, &vsSize, &psBinary, &psSize))
+                    return false;
+
+                ShaderDesc vsDesc(ShaderType::Vertex);
+                vsDesc.entryName = "main_vs";
+                vertexShader = device->createShader(vsDesc, vsBinary, vsSize);
+
+                ShaderDesc psDesc(ShaderType::Pixel);
+                psDesc.entryName = "main_ps";
+                pixelShader = device->createShader(psDesc, psBinary, psSize);
+
+                renderTarget = device->createTexture(TextureDesc()
+                    .setWidth(64)
+                    .setHeight(64)
+                    .setFormat(Format::RGBA8_UNORM)
+                    .setIsRenderTarget(true)
+                    .setInitialState(ResourceStates::RenderTarget)
+                    .setKeepInitialState(true)
+                    .setDebugName("BenchRenderTarget"));
+
+                if (!vertexShader || !pixelShader || !renderTarget)
+                    return false;
+
+                framebuffer = device->createFramebuffer(FramebufferDesc().addColorAttachment(renderTarget));
+
+                pipelineDesc = GraphicsPipelineDesc()
+                    .setVertexShader(vertexShader)
+                    .setPixelShader(pixelShader)
+                    .addBindingLayout(bindingLayout);
+                pipelineDesc.renderState.rasterState.setCullNone();
+                pipelineDesc.renderState.depthStencilState.setDepthTestEnable(false);
+
+                return framebuffer != nullptr;
+            }
+        };
+
+        void executeAndCollect(IDevice* device, ICommandList* commandList)
+        {
+            device->executeCommandLists(&commandList, 1);
+            device->waitForIdle();
+            device->runGarbageCollection();
+        }
+
+        class BindingSetCreationBenchmark final : public Benchmark
+        {
+        public:
+            [[nodiscard]] const char* getName() const override { return "binding-set-creation"; }
+
+            bool setup(IDevice* device) override
+            {
+                return m_Resources.create(device);
+            }
+
+            uint32_t run(IDevice* device) override
+            {
+                const BindingSetDesc desc = m_Resources.getBindingSetDesc();
+
+                for (uint32_t i = 0; i < c_NumSets; i++)
+                    m_BindingSets.push_back(device->createBindingSet(desc, m_Resources.bindingLayout));
+
+                return c_NumSets;
+            }
+
+            void finish(IDevice* device) override
+            {
+                m_BindingSets.clear();
+                device->runGarbageCollection();
+            }
+
+        private:
+            static constexpr uint32_t c_NumSets = 256;
+            BenchResources m_Resources;
+            std::vector<BindingSetHandle> m_BindingSets;
+        };
+
+        class DrawBenchmark final : public Benchmark
+        {
+        public:
+            [[nodiscard]] const char* getName() const override { return "set-graphics-state-draw"; }
+
+            bool setup(IDevice* device) override
+            {
+                if (!m_Resources.create(device) || !m_Pipeline.create(device, m_Resources.bindingLayout))
+                    return false;
+
+                m_GraphicsPipeline = device->createGraphicsPipeline(m_Pipeline.pipelineDesc, m_Pipeline.framebuffer);
+                m_CommandList = device->createCommandList();
+
+                // Two binding sets used in turn, so that every setGraphicsState call changes the bindings
+                for (BindingSetHandle& bindingSet : m_BindingSets)
+                    bindingSet = device->createBindingSet(m_Resources.getBindingSetDesc(), m_Resources.bindingLayout);
+
+                return m_GraphicsPipeline && m_CommandList && m_BindingSets[0] && m_BindingSets[1];
+            }
+
+            uint32_t run(IDevice* device) override
+            {
+                (void)device;
+
+                m_CommandList->open();
+
+                GraphicsState state = GraphicsState()
+                    .setPipeline(m_GraphicsPipeline)
+                    .setFramebuffer(m_Pipeline.framebuffer)
+                    .setViewport(ViewportState().addViewportAndScissorRect(m_Pipeline.framebuffer->getFramebufferInfo().getViewport()));
+                state.bindings.resize(1);
+
+                for (uint32_t i = 0; i < c_NumDraws; i++)
+                {
+                    state.bindings[0] = m_BindingSets[i & 1];
+                    m_CommandList->setGraphicsState(state);
+                    m_CommandList->draw(DrawArguments().setVertexCount(3));
+                }
+
+                m_CommandList->close();
+
+                return c_NumDraws;
+            }
+
+            void finish(IDevice* device) override
+            {
+                executeAndCollect(device, m_CommandList);
+            }
+
+        private:
+            static constexpr uint32_t c_NumDraws = 1024;
+            BenchResources m_Resources;
+            BenchPipeline m_Pipeline;
+            GraphicsPipelineHandle m_GraphicsPipeline;
+            BindingSetHandle m_BindingSets[2];
+            CommandListHandle m_CommandList;
+        };
+
+        class WriteBufferBenchmark final : public Benchmark
+        {
+        public:
+            [[nodiscard]] const char* getName() const override { return "write-buffer"; }
+
+            bool setup(IDevice* device) override
+            {
+                m_Buffer = device->createBuffer(BufferDesc()
+                    .setByteSize(c_NumWrites * c_WriteSize)
+                    .setInitialState(ResourceStates::CopyDest)
+                    .setKeepInitialState(true)
+                    .setDebugName("BenchUploadTarget"));
+
+                m_CommandList = device->createCommandList();
+                m_Data.resize(c_WriteSize, 0xcd);
+
+                return m_Buffer && m_CommandList;
+            }
+
+            uint32_t run(IDevice* device) override
+            {
+                (void)device;
+
+                m_CommandList->open();
+
+                for (uint32_t i = 0; i < c_NumWrites; i++)
+                    m_CommandList->writeBuffer(m_Buffer, m_Data.data(), c_WriteSize, uint64_t(i) * c_WriteSize);
+
+                m_CommandList->close();
+
+                return c_NumWrites;
+            }
+
+            void finish(IDevice* device) override
+            {
+                executeAndCollect(device, m_CommandList);
+            }
+
+            [[nodiscard]] uint64_t getBytesPerOperation() const override { return c_WriteSize; }
+
+        private:
+            static constexpr uint32_t c_NumWrites = 4096;
+            static constexpr uint32_t c_WriteSize = 256;
+            BufferHandle m_Buffer;
+            CommandListHandle m_CommandList;
+            std::vector<uint8_t> m_Data;
+        };
+
+        class TextureStateBenchmark final : public Benchmark
+        {
+        public:
+            [[nodiscard]] const char* getName() const override { return "require-texture-state"; }
+
+            bool setup(IDevice* device) override
+            {
+                m_Texture = device->createTexture(TextureDesc()
+                    .setDimension(TextureDimension::Texture2DArray)
+                    .setWidth(128)
+                    .setHeight(128)
+                    .setMipLevels(c_NumMipLevels)
+                    .setArraySize(c_NumArraySlices)
+                    .setFormat(Format::RGBA8_UNORM)
+                    .setIsUAV(true)
+                    .setInitialState(ResourceStates::ShaderResource)
+                    .setKeepInitialState(true)
+                    .setDebugName("BenchStateTexture"));
+
+                m_CommandList = device->createCommandList();
+
+                return m_Texture && m_CommandList;
+            }
+
+            uint32_t run(IDevice* device) override
+            {
+                (void)device;
+
+                m_CommandList->open();
+
+                // Transition every subresource on its own, then the whole texture back, which merges the tracking
+                for (ArraySlice arraySlice = 0; arraySlice < c_NumArraySlices; arraySlice++)
+                {
+                    for (MipLevel mipLevel = 0; mipLevel < c_NumMipLevels; mipLevel++)
+                    {
+                        m_CommandList->setTextureState(m_Texture, TextureSubresourceSet(mipLevel, 1, arraySlice, 1),
+                            ResourceStates::UnorderedAccess);
+                    }
+                }
+                m_CommandList->commitBarriers();
+
+                m_CommandList->setTextureState(m_Texture, AllSubresources, ResourceStates::ShaderResource);
+                m_CommandList->commitBarriers();
+
+                m_CommandList->close();
+
+                return c_NumMipLevels * c_NumArraySlices + 1;
+            }
+
+            void finish(IDevice* device) override
+            {
+                executeAndCollect(device, m_CommandList);
+            }
+
+        private:
+            static constexpr uint32_t c_NumMipLevels = 8;
+            static constexpr uint32_t c_NumArraySlices = 64;
+            TextureHandle m_Texture;
+            CommandListHandle m_CommandList;
+        };
+
+        class PipelineCreationBenchmark final : public Benchmark
+        {
+        public:
+            [[nodiscard]] const char* getName() const override { return "create-graphics-pipeline-warm"; }
+
+            bool setup(IDevice* device) override
+            {
+                if (!m_Resources.create(device) || !m_Pipeline.create(device, m_Resources.bindingLayout))
+                    return false;
+
+                // The first pipeline warms up the driver and NVRHI caches, the measured ones are identical to it
+                m_WarmPipeline = device->createGraphicsPipeline(m_Pipeline.pipelineDesc, m_Pipeline.framebuffer);
+                return m_WarmPipeline != nullptr;
+            }
+
+            uint32_t run(IDevice* device) override
+            {
+                for (uint32_t i = 0; i < c_NumPipelines; i++)
+                    m_Pipelines.push_back(device->createGraphicsPipeline(m_Pipeline.pipelineDesc, m_Pipeline.framebuffer));
+
+                return c_NumPipelines;
+            }
+
+            void finish(IDevice* device) override
+            {
+                m_Pipelines.clear();
+                device->runGarbageCollection();
+            }
+
+        private:
+            static constexpr uint32_t c_NumPipelines = 16;
+            BenchResources m_Resources;
+            BenchPipeline m_Pipeline;
+            GraphicsPipelineHandle m_WarmPipeline;
+            std::vector<GraphicsPipelineHandle> m_Pipelines;
+        };
+
+        class SubmissionBenchmark final : public Benchmark
+        {
+        public:
+            [[nodiscard]] const char* getName() const override { return "submission-gc"; }
+
+            bool setup(IDevice* device) override
+            {
+                m_CommandList = device->createCommandList();
+                return m_CommandList != nullptr;
+            }
+
+            uint32_t run(IDevice* device) override
+            {
+                // Each iteration records an empty command list, submits it and collects the ones that have finished,
+                // which is the per-frame overhead of the submission path outside of the recorded work
+                for (uint32_t i = 0; i < c_NumSubmissions; i++)
+                {
+                    m_CommandList->open();
+                    m_CommandList->close();
+
+                    ICommandList* commandList = m_CommandList;
+                    device->executeCommandLists(&commandList, 1);
+                    device->runGarbageCollection();
+                }
+
+                return c_NumSubmissions;
+            }
+
+            void finish(IDevice* device) override
+            {
+                device->waitForIdle();
+                device->runGarbageCollection();
+            }
+
+        private:
+            static constexpr uint32_t c_NumSubmissions = 64;
+            CommandListHandle m_CommandList;
+        };
+
+        std::vector<std::unique_ptr<Benchmark>> createBenchmarks()
+        {
+            std::vector<std::unique_ptr<Benchmark>> benchmarks;
+            benchmarks.push_back(std::make_unique<BindingSetCreationBenchmark>());
+            benchmarks.push_back(std::make_unique<DrawBenchmark>());
+            benchmarks.push_back(std::make_unique<WriteBufferBenchmark>());
+            benchmarks.push_back(std::make_unique<TextureStateBenchmark>());
+            benchmarks.push_back(std::make_unique<PipelineCreationBenchmark>());
+            benchmarks.push_back(std::make_unique<SubmissionBenchmark>());
+            return benchmarks;
+        }
+
+        struct BenchmarkResult
+        {
+            std::string benchmark;
+            std::string backend;
+            bool validation = false;
+            bool skipped = false;
+            uint32_t numErrors = 0;
+            uint32_t operationsPerSample = 0;
+            std::vector<double> sampleNanoseconds; // per operation
+            uint64_t bytesPerOperation = 0;
+
+            [[nodiscard]] double getMin() const { return *std::min_element(sampleNanoseconds.begin(), sampleNanoseconds.end()); }
+
+            [[nodiscard]] double getMedian() const
+            {
+                std::vector<double> sorted = sampleNanoseconds;
+                std::sort(sorted.begin(), sorted.end());
+                const size_t middle = sorted.size() / 2;
+                return (sorted.size() % 2) ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) * 0.5;
+            }
+
+            [[nodiscard]] double getMean() const
+            {
+                double sum = 0.0;
+                for (double sample : sampleNanoseconds)
+                    sum += sample;
+                return sum / double(sampleNanoseconds.size());
+            }
+        };
+
+        struct Options
+        {
+            std::vector<std::string> backends;
+            bool withValidation = true;
+            bool withoutValidation = true;
+            uint32_t numSamples = 10;
+            std::string filter;
+            std::string jsonPath;
+            bool listOnly = false;
+        };
+
+        BenchmarkResult runBenchmark(Benchmark& benchmark, IDevice* device, const char* backendName, bool validation,
+            MessageCallback& messageCallback, uint32_t numSamples)
+        {
+            BenchmarkResult result;
+            result.benchmark = benchmark.getName();
+            result.backend = backendName;
+            result.validation = validation;
+            result.bytesPerOperation = benchmark.getBytesPerOperation();
+
+            const uint32_t errorsBefore = messageCallback.numErrors;
+
+            if (!benchmark.setup(device))
+            {
+                result.skipped = true;
+                return result;
+            }
+
+            // One unmeasured run to populate the caches and allocate the upload chunks
+            benchmark.run(device);
+            benchmark.finish(device);
+
+            for (uint32_t sample = 0; sample < numSamples; sample++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                const uint32_t numOperations = benchmark.run(device);
+                const auto end = std::chrono::steady_clock::now();
+
+                benchmark.finish(device);
+
+                const double nanoseconds = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                result.sampleNanoseconds.push_back(nanoseconds / double(std::max(numOperations, 1u)));
+                result.operationsPerSample = numOperations;
+            }
+
+            result.numErrors = messageCallback.numErrors - errorsBefore;
+            return result;
+        }
+
+        std::string escapeJson(const std::string& s)
+        {
+            std::string escaped;
+            for (char c : s)
+            {
+                if (c == '"' || c == '\\')
+                    escaped += '\\';
+                escaped += c;
+            }
+            return escaped;
+        }
+
+        void writeJson(std::ostream& os, const std::vector<BenchmarkResult>& results, uint32_t numSamples)
+        {
+            os << "{\n  \"version\": 1,\n  \"samples\": " << numSamples << ",\n  \"results\": [";
+
+            for (size_t i = 0; i < results.size(); i++)
+            {
+                const BenchmarkResult& result = results[i];
+
+                os << (i ? ",\n" : "\n") << "    {"
+                    << "\"benchmark\": \"" << escapeJson(result.benchmark) << "\", "
+                    << "\"backend\": \"" << escapeJson(result.backend) << "\", "
+                    << "\"validation\": " << (result.validation ? "true" : "false") << ", "
+                    << "\"skipped\": " << (result.skipped ? "true" : "false");
+
+                if (!result.skipped)
+                {
+                    os << ", \"errors\": " << result.numErrors
+                        << ", \"operationsPerSample\": " << result.operationsPerSample
+                        << ", \"minNs\": " << result.getMin()
+                        << ", \"medianNs\": " << result.getMedian()
+                        << ", \"meanNs\": " << result.getMean();
+
+                    if (result.bytesPerOperation)
+                        os << ", \"bytesPerSecond\": " << double(result.bytesPerOperation) * 1e9 / result.getMedian();
+                }
+
+                os << "}";
+            }
+
+            os << "\n  ]\n}\n";
+        }
+
+        void printResult(const BenchmarkResult& result)
+        {
+            if (result.skipped)
+            {
+                printf("%-8s %-4s %-32s skipped\n", result.backend.c_str(), result.validation ? "val" : "", result.benchmark.c_str());
+                return;
+            }
+
+            printf("%-8s %-4s %-32s median %10.1f ns  min %10.1f ns  mean %10.1f ns",
+                result.backend.c_str(), result.validation ? "val" : "", result.benchmark.c_str(),
+                result.getMedian(), result.getMin(), result.getMean());
+
+            if (result.bytesPerOperation)
+                printf("  %8.1f MB/s", double(result.bytesPerOperation) * 1e3 / result.getMedian());
+
+            if (result.numErrors)
+                printf("  (%u errors)", result.numErrors);
+
+            printf("\n");
+        }
+
+        void printUsage()
+        {
+            printf(
+                "Usage: nvrhi-bench [options]\n"
+                "  --backend <name>       Run on this backend only, can be repeated: vulkan, d3d12\n"
+                "  --validation <mode>    on, off or both (default)\n"
+                "  --samples <n>          Number of measured samples per benchmark (default 10)\n"
+                "  --filter <text>        Run only the benchmarks whose names contain the text\n"
+                "  --json <file>          Write the results as JSON into the file, '-' for stdout\n"
+                "  --list                 List the benchmarks and exit\n");
+        }
+
+        bool parseOptions(int argc, char** argv, Options& options)
+        {
+            for (int i = 1; i < argc; i++)
+            {
+                const bool hasValue = i + 1 < argc;
+                const char* arg = argv[i];
+
+                if (!strcmp(arg, "--backend") && hasValue)
+                    options.backends.emplace_back(argv[++i]);
+                else if (!strcmp(arg, "--validation") && hasValue)
+                {
+                    const std::string mode = argv[++i];
+                    if (mode != "on" && mode != "off" && mode != "both")
+                        return false;
+                    options.withValidation = mode != "off";
+                    options.withoutValidation = mode != "on";
+                }
+                else if (!strcmp(arg, "--samples") && hasValue)
+                    options.numSamples = std::max(uint32_t(strtoul(argv[++i], nullptr, 10)), 1u);
+                else if (!strcmp(arg, "--filter") && hasValue)
+                    options.filter = argv[++i];
+                else if (!strcmp(arg, "--json") && hasValue)
+                    options.jsonPath = argv[++i];
+                else if (!strcmp(arg, "--list"))
+                    options.listOnly = true;
+                else
+                    return false;
+            }
+
+            return true;
+        }
+
+        bool isBackendSelected(const Options& options, const char* name)
+        {
+            return options.backends.empty()
+                || std::find(options.backends.begin(), options.backends.end(), name) != options.backends.end();
+        }
+    }
+}
+
+using namespace nvrhi::bench;
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (options.listOnly)
+    {
+        for (const auto& benchmark : createBenchmarks())
+            printf("%s\n", benchmark->getName());
+        return 0;
+    }
+
+#if !NVRHI_BENCH_WITH_VALIDATION
+    if (options.withValidation && !options.withoutValidation)
+    {
+        fprintf(stderr, "nvrhi-bench was built without the validation layer\n");
+        return 1;
+    }
+    options.withValidation = false;
+#endif
+
+    MessageCallback messageCallback;
+    std::vector<BenchmarkResult> results;
+
+    using CreateDeviceFunc = std::unique_ptr<BenchDevice>(*)(nvrhi::IMessageCallback*);
+    std::vector<std::pair<const char*, CreateDeviceFunc>> backends;
+#if NVRHI_BENCH_WITH_VULKAN
+    backends.emplace_back("vulkan", createVulkanBenchDevice);
+#endif
+#if NVRHI_BENCH_WITH_DX12
+    backends.emplace_back("d3d12", createD3D12BenchDevice);
+#endif
+
+    // Progress goes to stderr when the JSON is written to stdout
+    FILE* log = options.jsonPath == "-" ? stderr : stdout;
+
+    for (const auto& [backendName, createDevice] : backends)
+    {
+        if (!isBackendSelected(options, backendName))
+            continue;
+
+        std::unique_ptr<BenchDevice> benchDevice = createDevice(&messageCallback);
+        if (!benchDevice)
+        {
+            fprintf(stderr, "Failed to create a %s device, skipping the backend\n", backendName);
+            continue;
+        }
+
+        for (int validation = 0; validation < 2; validation++)
+        {
+            if ((validation && !options.withValidation) || (!validation && !options.withoutValidation))
+                continue;
+
+            nvrhi::DeviceHandle device = benchDevice->getDevice();
+#if NVRHI_BENCH_WITH_VALIDATION
+            if (validation)
+                device = nvrhi::validation::createValidationLayer(device);
+#endif
+
+            // New benchmark objects for every device, they hold resources created on the device
+            for (const auto& benchmark : createBenchmarks())
+            {
+                if (!options.filter.empty() && std::string(benchmark->getName()).find(options.filter) == std::string::npos)
+                    continue;
+
+                results.push_back(runBenchmark(*benchmark, device, backendName, validation != 0, messageCallback, options.numSamples));
+
+                if (log == stdout)
+                    printResult(results.back());
+                else
+                    fprintf(log, "%s %s%s done\n", backendName, benchmark->getName(), validation ? " (validation)" : "");
+            }
+
+            device->waitForIdle();
+            device->runGarbageCollection();
+        }
+    }
+
+    if (results.empty())
+    {
+        fprintf(stderr, "No benchmarks were run\n");
+        return 1;
+    }
+
+    if (options.jsonPath == "-")
+    {
+        writeJson(std::cout, results, options.numSamples);
+    }
+    else if (!options.jsonPath.empty())
+    {
+        std::ofstream file(options.jsonPath);
+        if (!file.is_open())
+        {
+            fprintf(stderr, "Cannot open %s for writing\n", options.jsonPath.c_str());
+            return 1;
+        }
+
+        writeJson(file, results, options.numSamples);
+    }
+
+    for (const BenchmarkResult& result : results)
+    {
+        if (result.numErrors)
+            return 2;
+    }
+
+    return 0;
+}
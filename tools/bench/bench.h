@@ -0,0 +1,52 @@
+/*
+* Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+#include <memory>
+
+namespace nvrhi::bench
+{
+    // Owns a graphics API device created for benchmarking and the NVRHI device that wraps it.
+    // The benchmarks only need the command queues, so no window or swap chain is created.
+    class BenchDevice
+    {
+    public:
+        virtual ~BenchDevice() = default;
+        [[nodiscard]] virtual IDevice* getDevice() const = 0;
+        [[nodiscard]] virtual const char* getBackendName() const = 0;
+    };
+
+    // Each returns nullptr if the API or a suitable adapter is not available.
+#if NVRHI_BENCH_WITH_VULKAN
+    std::unique_ptr<BenchDevice> createVulkanBenchDevice(IMessageCallback* messageCallback);
+#endif
+#if NVRHI_BENCH_WITH_DX12
+    std::unique_ptr<BenchDevice> createD3D12BenchDevice(IMessageCallback* messageCallback);
+#endif
+
+    // Returns the compiled shaders from shaders/bench.hlsl for the API, or false if they were not built
+    bool getBenchShaders(GraphicsAPI api, const void** vertexShader, size_t* vertexShaderSize,
+        const void** pixelShader, size_t* pixelShaderSize);
+}
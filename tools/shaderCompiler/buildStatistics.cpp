@@ -0,0 +1,176 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "buildStatistics.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+static const char* c_HistoryHeader = "NVRHI shader compilation times 1";
+
+void TaskDurationHistory::load(const string& fileName)
+{
+	m_Durations.clear();
+
+	ifstream file(fileName);
+	if (!file.is_open())
+		return;
+
+	string line;
+	if (!getline(file, line) || line != c_HistoryHeader)
+		return;
+
+	// Every line is "<milliseconds> <key>", the key can contain spaces
+	while (getline(file, line))
+	{
+		size_t separator = line.find(' ');
+		if (separator == string::npos)
+			continue;
+
+		double milliseconds = atof(line.substr(0, separator).c_str());
+		m_Durations[line.substr(separator + 1)] = milliseconds;
+	}
+}
+
+bool TaskDurationHistory::save(const string& fileName) const
+{
+	ofstream file(fileName);
+	if (!file.is_open())
+		return false;
+
+	file << c_HistoryHeader << "\n";
+
+	char buf[32];
+	for (const auto& it : m_Durations)
+	{
+		snprintf(buf, sizeof(buf), "%.1f", it.second);
+		file << buf << " " << it.first << "\n";
+	}
+
+	return file.good();
+}
+
+double TaskDurationHistory::get(const string& key) const
+{
+	auto found = m_Durations.find(key);
+	return found != m_Durations.end() ? found->second : -1.0;
+}
+
+void TaskDurationHistory::set(const string& key, double milliseconds)
+{
+	m_Durations[key] = milliseconds;
+}
+
+double TaskDurationHistory::getAverage(double defaultValue) const
+{
+	if (m_Durations.empty())
+		return defaultValue;
+
+	double sum = 0.0;
+	for (const auto& it : m_Durations)
+		sum += it.second;
+
+	return sum / double(m_Durations.size());
+}
+
+static string escapeJson(const string& s)
+{
+	string result;
+	result.reserve(s.size());
+
+	for (char c : s)
+	{
+		switch (c)
+		{
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20)
+			{
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				result += buf;
+			}
+			else
+				result += c;
+		}
+	}
+
+	return result;
+}
+
+bool writeTimingReport(const string& fileName, const string& platformName, unsigned int threadCount,
+	double totalSeconds, vector<TaskTiming> timings)
+{
+	ofstream file(fileName);
+	if (!file.is_open())
+		return false;
+
+	std::stable_sort(timings.begin(), timings.end(), [](const TaskTiming& a, const TaskTiming& b) {
+		return a.milliseconds > b.milliseconds;
+	});
+
+	double totalTaskMilliseconds = 0.0;
+	for (const TaskTiming& timing : timings)
+		totalTaskMilliseconds += timing.milliseconds;
+
+	char buf[64];
+
+	file << "{\n";
+	file << "  \"platform\": \"" << escapeJson(platformName) << "\",\n";
+	file << "  \"threads\": " << threadCount << ",\n";
+	snprintf(buf, sizeof(buf), "%.3f", totalSeconds);
+	file << "  \"totalSeconds\": " << buf << ",\n";
+	snprintf(buf, sizeof(buf), "%.3f", totalTaskMilliseconds / 1000.0);
+	file << "  \"totalTaskSeconds\": " << buf << ",\n";
+	file << "  \"permutations\": [";
+
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		const TaskTiming& timing = timings[i];
+		const char* result = timing.success ? (timing.fromCache ? "cached" : "ok") : "failed";
+
+		snprintf(buf, sizeof(buf), "%.1f", timing.milliseconds);
+
+		// Remove the trailing space that the combined defines have
+		string defines = timing.defines;
+		while (!defines.empty() && defines.back() == ' ')
+			defines.pop_back();
+
+		file << (i == 0 ? "\n" : ",\n");
+		file << "    { \"shader\": \"" << escapeJson(timing.shaderName) << "\""
+			<< ", \"entryPoint\": \"" << escapeJson(timing.entryPoint) << "\""
+			<< ", \"defines\": \"" << escapeJson(defines) << "\""
+			<< ", \"milliseconds\": " << buf
+			<< ", \"thread\": " << timing.threadIndex
+			<< ", \"result\": \"" << result << "\" }";
+	}
+
+	file << "\n  ]\n}\n";
+
+	return file.good();
+}
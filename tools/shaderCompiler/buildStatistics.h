@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+// Compilation times of the shader permutations, used to schedule the longest tasks first
+// and to find the permutations that take the most time to build.
+
+struct TaskTiming
+{
+	std::string shaderName;
+	std::string entryPoint;
+	std::string defines;
+	double milliseconds = 0.0;
+	unsigned int threadIndex = 0;
+	bool success = false;
+	bool fromCache = false;
+};
+
+// Durations of the tasks from the previous runs, stored in a text file.
+class TaskDurationHistory
+{
+public:
+	void load(const std::string& fileName);
+	bool save(const std::string& fileName) const;
+
+	// Returns the duration in milliseconds, or a negative value if the task is not in the history.
+	double get(const std::string& key) const;
+	void set(const std::string& key, double milliseconds);
+
+	// Returns the average duration of all recorded tasks, or 'defaultValue' if there are none.
+	double getAverage(double defaultValue) const;
+
+private:
+	std::map<std::string, double> m_Durations;
+};
+
+// Writes a JSON report with all timings sorted from the slowest to the fastest.
+bool writeTimingReport(const std::string& fileName, const std::string& platformName, unsigned int threadCount,
+	double totalSeconds, std::vector<TaskTiming> timings);
@@ -0,0 +1,461 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "inProcessCompiler.h"
+#include <nvrhi/common/resource.h>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <list>
+#include <cstring>
+
+#if __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+#include <experimental/filesystem> 
+namespace fs = std::experimental::filesystem;
+#else
+error "Missing the <filesystem> header."
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <d3dcompiler.h>
+#define SHADERCOMPILER_WITH_D3DCOMPILER 1
+#else
+#include <dlfcn.h>
+#define SHADERCOMPILER_WITH_D3DCOMPILER 0
+#endif
+
+#if __has_include(<dxc/dxcapi.h>)
+#include <dxc/dxcapi.h>
+#define SHADERCOMPILER_WITH_DXC 1
+#elif __has_include(<dxcapi.h>)
+#include <dxcapi.h>
+#define SHADERCOMPILER_WITH_DXC 1
+#else
+#define SHADERCOMPILER_WITH_DXC 0
+#endif
+
+using namespace std;
+
+template<typename T>
+using ComPtr = nvrhi::RefCountPtr<T>;
+
+static void* g_CompilerLibrary = nullptr;
+
+#if SHADERCOMPILER_WITH_DXC
+static DxcCreateInstanceProc g_DxcCreateInstance = nullptr;
+
+// The DXC objects are not thread-safe, so every worker thread has its own
+struct DxcThreadContext
+{
+	ComPtr<IDxcUtils> utils;
+	ComPtr<IDxcCompiler3> compiler;
+	ComPtr<IDxcIncludeHandler> includeHandler;
+};
+
+static thread_local DxcThreadContext t_Dxc;
+#endif
+
+#if SHADERCOMPILER_WITH_D3DCOMPILER
+static pD3DCompile g_D3DCompile = nullptr;
+#endif
+
+static void* loadLibrary(const fs::path& path)
+{
+#ifdef _WIN32
+	return (void*)LoadLibraryW(path.wstring().c_str());
+#else
+	return dlopen(path.string().c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void* getProcAddress(void* library, const char* name)
+{
+#ifdef _WIN32
+	return (void*)GetProcAddress((HMODULE)library, name);
+#else
+	return dlsym(library, name);
+#endif
+}
+
+// Splits the additional compiler options on whitespace, like the shell does for the command line
+static void appendSplitOptions(const vector<string>& options, vector<string>& outArguments)
+{
+	for (const string& option : options)
+	{
+		istringstream ss(option);
+		for (string token; ss >> token;)
+			outArguments.push_back(token);
+	}
+}
+
+bool isInProcessCompilationSupported(Platform platform)
+{
+	switch (platform)
+	{
+	case Platform::DXBC: return SHADERCOMPILER_WITH_D3DCOMPILER != 0;
+	case Platform::DXIL:
+	case Platform::SPIRV: return SHADERCOMPILER_WITH_DXC != 0;
+	default: return false;
+	}
+}
+
+bool initInProcessCompiler(const CommandLineOptions& options, string& outErrorMessage)
+{
+	vector<fs::path> candidates;
+	const fs::path compilerDir = fs::path(options.compilerPath).parent_path();
+
+	if (options.platform == Platform::DXBC)
+	{
+		// FXC is a thin wrapper around the system d3dcompiler_47.dll
+		candidates.push_back(compilerDir / "d3dcompiler_47.dll");
+		candidates.push_back("d3dcompiler_47.dll");
+	}
+	else
+	{
+#ifdef _WIN32
+		candidates.push_back(compilerDir / "dxcompiler.dll");
+		candidates.push_back("dxcompiler.dll");
+#else
+		// Linux DXC packages put the library into lib/ next to bin/
+		candidates.push_back(compilerDir / "libdxcompiler.so");
+		candidates.push_back(compilerDir / ".." / "lib" / "libdxcompiler.so");
+		candidates.push_back("libdxcompiler.so");
+#endif
+	}
+
+	for (const fs::path& candidate : candidates)
+	{
+		g_CompilerLibrary = loadLibrary(candidate);
+		if (g_CompilerLibrary)
+			break;
+	}
+
+	if (!g_CompilerLibrary)
+	{
+		outErrorMessage = "cannot load the compiler library for in-process compilation";
+		return false;
+	}
+
+#if SHADERCOMPILER_WITH_D3DCOMPILER
+	if (options.platform == Platform::DXBC)
+	{
+		g_D3DCompile = (pD3DCompile)getProcAddress(g_CompilerLibrary, "D3DCompile");
+		if (!g_D3DCompile)
+		{
+			outErrorMessage = "the compiler library doesn't export D3DCompile";
+			return false;
+		}
+		return true;
+	}
+#endif
+
+#if SHADERCOMPILER_WITH_DXC
+	g_DxcCreateInstance = (DxcCreateInstanceProc)getProcAddress(g_CompilerLibrary, "DxcCreateInstance");
+	if (!g_DxcCreateInstance)
+	{
+		outErrorMessage = "the compiler library doesn't export DxcCreateInstance";
+		return false;
+	}
+	return true;
+#else
+	outErrorMessage = "in-process compilation is not supported for this platform";
+	return false;
+#endif
+}
+
+#if SHADERCOMPILER_WITH_DXC
+static wstring toWide(const string& s)
+{
+	// Paths go through fs::path for the proper conversion, everything else on the command line is ASCII
+	return fs::path(s).wstring();
+}
+
+static bool compileWithDxc(const CommandLineOptions& options, const CompilerOptions& compilerOptions, const string& sourceFile,
+	vector<char>& outBinary, string& outMessages)
+{
+	if (!t_Dxc.compiler)
+	{
+		if (FAILED(g_DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&t_Dxc.utils))) ||
+			FAILED(g_DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&t_Dxc.compiler))) ||
+			FAILED(t_Dxc.utils->CreateDefaultIncludeHandler(&t_Dxc.includeHandler)))
+		{
+			outMessages = "cannot create the DXC compiler instance";
+			t_Dxc = DxcThreadContext();
+			return false;
+		}
+	}
+
+	const wstring wideSourceFile = toWide(sourceFile);
+	ComPtr<IDxcBlobEncoding> source;
+	if (FAILED(t_Dxc.utils->LoadFile(wideSourceFile.c_str(), nullptr, &source)))
+	{
+		outMessages = "cannot read " + sourceFile;
+		return false;
+	}
+
+	// Same arguments as buildCompilerCommandLine, minus the output file
+	vector<string> arguments;
+	arguments.push_back("-T");
+	arguments.push_back(compilerOptions.target);
+	if (!compilerOptions.entryPoint.empty())
+	{
+		arguments.push_back("-E");
+		arguments.push_back(compilerOptions.entryPoint);
+	}
+	for (const string& define : compilerOptions.definitions)
+		arguments.push_back("-D" + define);
+	for (const string& define : options.additionalDefines)
+		arguments.push_back("-D" + define);
+	for (const string& dir : options.includePaths)
+		arguments.push_back("-I" + dir);
+
+	appendSplitOptions(options.additionalCompilerOptions, arguments);
+
+	if (options.platform == Platform::SPIRV)
+	{
+		arguments.push_back("-spirv");
+
+		const pair<const char*, int> shifts[] = {
+			{ "-fvk-t-shift", options.vulkanTextureShift },
+			{ "-fvk-s-shift", options.vulkanSamplerShift },
+			{ "-fvk-b-shift", options.vulkanConstantShift },
+			{ "-fvk-u-shift", options.vulkanUavShift }
+		};
+
+		for (int space = 0; space < 10; space++)
+		{
+			for (const auto& [name, shift] : shifts)
+			{
+				arguments.push_back(name);
+				arguments.push_back(to_string(shift));
+				arguments.push_back(to_string(space));
+			}
+		}
+	}
+
+	vector<wstring> wideArguments;
+	wideArguments.reserve(arguments.size() + 1);
+	wideArguments.push_back(wideSourceFile); // the source name, used to resolve relative includes
+	for (const string& argument : arguments)
+		wideArguments.push_back(toWide(argument));
+
+	vector<LPCWSTR> argumentPointers;
+	for (const wstring& argument : wideArguments)
+		argumentPointers.push_back(argument.c_str());
+
+	DxcBuffer sourceBuffer;
+	sourceBuffer.Ptr = source->GetBufferPointer();
+	sourceBuffer.Size = source->GetBufferSize();
+	sourceBuffer.Encoding = DXC_CP_ACP;
+
+	ComPtr<IDxcResult> result;
+	if (FAILED(t_Dxc.compiler->Compile(&sourceBuffer, argumentPointers.data(), uint32_t(argumentPointers.size()),
+		t_Dxc.includeHandler, IID_PPV_ARGS(&result))))
+	{
+		outMessages = "IDxcCompiler3::Compile failed";
+		return false;
+	}
+
+	ComPtr<IDxcBlobUtf8> errors;
+	result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr);
+	if (errors && errors->GetStringLength() > 0)
+		outMessages.assign(errors->GetStringPointer(), errors->GetStringLength());
+
+	HRESULT status = S_OK;
+	result->GetStatus(&status);
+	if (FAILED(status))
+		return false;
+
+	ComPtr<IDxcBlob> object;
+	result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr);
+	if (!object)
+		return false;
+
+	const char* data = static_cast<const char*>(object->GetBufferPointer());
+	outBinary.assign(data, data + object->GetBufferSize());
+	return true;
+}
+#endif
+
+#if SHADERCOMPILER_WITH_D3DCOMPILER
+// Resolves the includes relative to the including file first, then in the include paths, like FXC does
+class IncludeHandler : public ID3DInclude
+{
+public:
+	IncludeHandler(const CommandLineOptions& options, const fs::path& sourceFile)
+		: m_Options(options)
+		, m_SourceDirectory(sourceFile.parent_path())
+	{ }
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* outData, UINT* outBytes) override
+	{
+		(void)includeType;
+
+		// The directory of the including file, or of the source file for the top level includes
+		fs::path parentDirectory = m_SourceDirectory;
+		for (const auto& [data, directory] : m_OpenFiles)
+		{
+			if (data.data() == parentData)
+				parentDirectory = directory;
+		}
+
+		vector<fs::path> candidates = { parentDirectory / fileName };
+		for (const string& includePath : m_Options.includePaths)
+			candidates.push_back(fs::path(includePath) / fileName);
+
+		for (const fs::path& candidate : candidates)
+		{
+			ifstream file(candidate, ios::binary);
+			if (!file.is_open())
+				continue;
+
+			string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+			m_OpenFiles.emplace_back(std::move(contents), candidate.parent_path());
+
+			*outData = m_OpenFiles.back().first.data();
+			*outBytes = UINT(m_OpenFiles.back().first.size());
+			return S_OK;
+		}
+
+		return E_FAIL;
+	}
+
+	HRESULT __stdcall Close(LPCVOID data) override
+	{
+		(void)data;
+		// The contents are kept until the compilation finishes, because they identify the parent files
+		return S_OK;
+	}
+
+private:
+	const CommandLineOptions& m_Options;
+	fs::path m_SourceDirectory;
+	list<pair<string, fs::path>> m_OpenFiles; // list, so that the strings don't move
+};
+
+static bool compileWithD3DCompiler(const CommandLineOptions& options, const CompilerOptions& compilerOptions, const string& sourceFile,
+	vector<char>& outBinary, string& outMessages)
+{
+	ifstream file(sourceFile, ios::binary);
+	if (!file.is_open())
+	{
+		outMessages = "cannot read " + sourceFile;
+		return false;
+	}
+
+	const string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+	// D3D_SHADER_MACRO needs separate name and value strings
+	vector<pair<string, string>> defines;
+	auto addDefine = [&defines](const string& define)
+	{
+		const size_t equals = define.find('=');
+		if (equals == string::npos)
+			defines.emplace_back(define, "1");
+		else
+			defines.emplace_back(define.substr(0, equals), define.substr(equals + 1));
+	};
+	for (const string& define : compilerOptions.definitions)
+		addDefine(define);
+	for (const string& define : options.additionalDefines)
+		addDefine(define);
+
+	vector<D3D_SHADER_MACRO> macros;
+	for (const auto& [name, value] : defines)
+		macros.push_back({ name.c_str(), value.c_str() });
+	macros.push_back({ nullptr, nullptr });
+
+	// The options that FXC translates to compile flags
+	vector<string> extraOptions;
+	appendSplitOptions(options.additionalCompilerOptions, extraOptions);
+
+	UINT flags = 0;
+	for (const string& option : extraOptions)
+	{
+		if (option == "-Od") flags |= D3DCOMPILE_SKIP_OPTIMIZATION;
+		else if (option == "-O0") flags |= D3DCOMPILE_OPTIMIZATION_LEVEL0;
+		else if (option == "-O1") flags |= D3DCOMPILE_OPTIMIZATION_LEVEL1;
+		else if (option == "-O2") flags |= D3DCOMPILE_OPTIMIZATION_LEVEL2;
+		else if (option == "-O3") flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
+		else if (option == "-Zi") flags |= D3DCOMPILE_DEBUG;
+		else if (option == "-WX") flags |= D3DCOMPILE_WARNINGS_ARE_ERRORS;
+		else if (option == "-Zpr") flags |= D3DCOMPILE_PACK_MATRIX_ROW_MAJOR;
+		else if (option == "-Zpc") flags |= D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR;
+		else if (option == "-Gec") flags |= D3DCOMPILE_ENABLE_BACKWARDS_COMPATIBILITY;
+		else if (option == "-Ges") flags |= D3DCOMPILE_ENABLE_STRICTNESS;
+		else if (option == "-Gfa") flags |= D3DCOMPILE_AVOID_FLOW_CONTROL;
+		else if (option == "-Gfp") flags |= D3DCOMPILE_PREFER_FLOW_CONTROL;
+		else if (option == "-all_resources_bound") flags |= D3DCOMPILE_ALL_RESOURCES_BOUND;
+		else
+		{
+			outMessages = "option " + option + " is not supported by in-process DXBC compilation, use --external";
+			return false;
+		}
+	}
+
+	IncludeHandler includeHandler(options, sourceFile);
+
+	ComPtr<ID3DBlob> code;
+	ComPtr<ID3DBlob> errors;
+	const HRESULT hr = g_D3DCompile(source.data(), source.size(), sourceFile.c_str(), macros.data(), &includeHandler,
+		compilerOptions.entryPoint.empty() ? "main" : compilerOptions.entryPoint.c_str(), compilerOptions.target.c_str(),
+		flags, 0, &code, &errors);
+
+	if (errors)
+		outMessages.assign(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize());
+
+	if (FAILED(hr) || !code)
+		return false;
+
+	const char* data = static_cast<const char*>(code->GetBufferPointer());
+	outBinary.assign(data, data + code->GetBufferSize());
+	return true;
+}
+#endif
+
+bool compileInProcess(const CommandLineOptions& options, const CompilerOptions& compilerOptions, const string& sourceFile,
+	vector<char>& outBinary, string& outMessages)
+{
+#if SHADERCOMPILER_WITH_D3DCOMPILER
+	if (options.platform == Platform::DXBC)
+		return compileWithD3DCompiler(options, compilerOptions, sourceFile, outBinary, outMessages);
+#endif
+
+#if SHADERCOMPILER_WITH_DXC
+	if (options.platform == Platform::DXIL || options.platform == Platform::SPIRV)
+		return compileWithDxc(options, compilerOptions, sourceFile, outBinary, outMessages);
+#endif
+
+	(void)options;
+	(void)compilerOptions;
+	(void)sourceFile;
+	(void)outBinary;
+	outMessages = "in-process compilation is not supported for this platform";
+	return false;
+}
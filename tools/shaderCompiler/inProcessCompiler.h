@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "options.h"
+#include <string>
+#include <vector>
+
+// In-process compilation: the compiler library (dxcompiler for DXIL and SPIR-V, d3dcompiler_47 for DXBC)
+// is loaded once, every worker thread creates its own compiler instance on first use, and the sources are compiled
+// into memory without launching the compiler executable or writing intermediate files.
+// Available when the DXC headers (dxcapi.h) are found at build time, or on Windows for DXBC.
+
+// Returns true if this build of the tool can compile the given platform in-process.
+bool isInProcessCompilationSupported(Platform platform);
+
+// Loads the compiler library. The library is searched next to the compiler executable first, then in the default paths.
+bool initInProcessCompiler(const CommandLineOptions& options, std::string& outErrorMessage);
+
+// Compiles one shader permutation with the same options that buildCompilerCommandLine would pass to the executable.
+// Returns false if the compilation failed, 'outMessages' receives the errors and warnings in both cases.
+bool compileInProcess(const CommandLineOptions& options, const CompilerOptions& compilerOptions, const std::string& sourceFile,
+	std::vector<char>& outBinary, std::string& outMessages);
@@ -74,6 +74,12 @@ bool CommandLineOptions::parse(int argc, char** argv)
 		("f,force", "Treat all source files as modified", value(force))
 		("k,keep", "Keep intermediate files", value(keep))
 		("c,compiler", "Path to the compiler executable (FXC or DXC)", value(compilerPath))
+		("external", "Run the compiler executable for every shader instead of loading the compiler library in-process", value(external))
+		("cache", "Directory for the compilation cache and the include dependency database", value(cacheDirectory))
+		("shared-cache", "Compilation cache directory shared between machines, used when the local cache misses", value(sharedCacheDirectory))
+		("legacy-blob", "Write the permutation blobs in the version 1 format, without the index", value(legacyBlob))
+		("compress", "Compress the binaries in the permutation blobs, which makes them require utils::ShaderBlobFile to load", value(compressBlob))
+		("timing-report", "Write the compilation time of every permutation into a JSON file", value(timingReportFile))
 		("I,include", "Include paths", value(includePaths))
 		("D,define", "Additional defines", value(additionalDefines))
 		("ignore", "Include files to ignore", value(ignoreFileNames))
@@ -124,6 +130,9 @@ bool CommandLineOptions::parse(int argc, char** argv)
 		else
 			throw OptionException("Unrecognized platform: " + platformName);
 
+		if (compressBlob && legacyBlob)
+			throw OptionException("Compression is not supported with the legacy blob format");
+
 		if (argc > 1)
 			throw OptionException("Unexpected positional arguments");
 
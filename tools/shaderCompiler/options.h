@@ -20,6 +20,8 @@
 * DEALINGS IN THE SOFTWARE.
 */
 
+#pragma once
+
 #include <string>
 #include <vector>
 
@@ -40,12 +42,18 @@ struct CommandLineOptions
     std::vector<std::string> ignoreFileNames;
     std::vector<std::string> additionalCompilerOptions;
 	std::string compilerPath;
+	std::string cacheDirectory;
+	std::string sharedCacheDirectory;
+	std::string timingReportFile;
 	Platform platform = Platform::UNKNOWN;
 	bool parallel = false;
 	bool verbose = false;
 	bool force = false;
 	bool help = false;
 	bool keep = false;
+	bool external = false;
+	bool legacyBlob = false;
+	bool compressBlob = false;
 	int vulkanTextureShift = 0;
 	int vulkanSamplerShift = 128;
 	int vulkanConstantShift = 256;
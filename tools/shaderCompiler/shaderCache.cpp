@@ -0,0 +1,306 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#include "shaderCache.h"
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <regex>
+#include <thread>
+#include <cstring>
+#include <cinttypes>
+
+#if __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+#include <experimental/filesystem> 
+namespace fs = std::experimental::filesystem;
+#else
+error "Missing the <filesystem> header."
+#endif
+
+using namespace std;
+
+static const char* c_DatabaseHeader = "NVRHI shader dependencies 1";
+static const char c_CacheEntryMagic[4] = { 'N', 'V', 'S', 'C' };
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+void DependencyDatabase::load(const string& fileName)
+{
+	m_Files.clear();
+	m_Modified = false;
+
+	ifstream file(fileName);
+	if (!file.is_open())
+		return;
+
+	string line;
+	if (!getline(file, line) || line != c_DatabaseHeader)
+		return;
+
+	for (string name; getline(file, name);)
+	{
+		SourceFileInfo info;
+		size_t includeCount = 0;
+
+		if (!getline(file, line))
+			break;
+
+		if (sscanf(line.c_str(), "%" SCNd64 " %" SCNu64 " %" SCNx64 " %zu", &info.writeTime, &info.fileSize, &info.contentHash, &includeCount) != 4)
+		{
+			m_Files.clear();
+			return;
+		}
+
+		for (size_t i = 0; i < includeCount; i++)
+		{
+			string include;
+			if (!getline(file, include))
+			{
+				m_Files.clear();
+				return;
+			}
+			info.includes.push_back(include);
+		}
+
+		m_Files[name] = std::move(info);
+	}
+}
+
+bool DependencyDatabase::save(const string& fileName)
+{
+	if (!m_Modified)
+		return true;
+
+	ofstream file(fileName);
+	if (!file.is_open())
+		return false;
+
+	file << c_DatabaseHeader << "\n";
+
+	char buf[128];
+	for (const auto& it : m_Files)
+	{
+		const SourceFileInfo& info = it.second;
+		snprintf(buf, sizeof(buf), "%" PRId64 " %" PRIu64 " %016" PRIx64 " %zu", info.writeTime, info.fileSize, info.contentHash, info.includes.size());
+
+		file << it.first << "\n" << buf << "\n";
+		for (const string& include : info.includes)
+			file << include << "\n";
+	}
+
+	m_Modified = false;
+
+	return file.good();
+}
+
+const SourceFileInfo* DependencyDatabase::getFileInfo(const string& fileName, bool parseIncludes)
+{
+	static basic_regex<char> include_pattern("\\s*#include\\s+[\"<]([^>\"]+)[>\"].*");
+
+	error_code ec;
+	int64_t writeTime = (int64_t)fs::last_write_time(fileName, ec).time_since_epoch().count();
+	if (ec)
+		return nullptr;
+
+	uint64_t fileSize = (uint64_t)fs::file_size(fileName, ec);
+	if (ec)
+		return nullptr;
+
+	auto found = m_Files.find(fileName);
+	if (found != m_Files.end() && found->second.writeTime == writeTime && found->second.fileSize == fileSize)
+		return &found->second;
+
+	ifstream file(fileName, ios::binary);
+	if (!file.is_open())
+		return nullptr;
+
+	string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+	SourceFileInfo info;
+	info.writeTime = writeTime;
+	info.fileSize = fileSize;
+	info.contentHash = hashBytes(contents.data(), contents.size());
+
+	if (parseIncludes)
+	{
+		istringstream lines(contents);
+		for (string line; getline(lines, line);)
+		{
+			std::match_results<const char*> result;
+			std::regex_match(line.c_str(), result, include_pattern);
+			if (!result.empty())
+				info.includes.push_back(string(result[1]));
+		}
+	}
+
+	m_Modified = true;
+
+	SourceFileInfo& entry = m_Files[fileName];
+	entry = std::move(info);
+	return &entry;
+}
+
+static string getEntryPath(const string& directory, uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016" PRIx64 ".bin", key);
+
+	// Spread the entries over 256 subdirectories to keep the directory listings short
+	return (fs::path(directory) / string(name, 2) / name).string();
+}
+
+static bool readEntry(const string& path, const string& description, vector<char>& outBinary)
+{
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+		return false;
+
+	char magic[4];
+	uint32_t descriptionSize = 0;
+	uint64_t binarySize = 0;
+
+	if (!file.read(magic, sizeof(magic)) || memcmp(magic, c_CacheEntryMagic, sizeof(magic)) != 0)
+		return false;
+
+	if (!file.read(reinterpret_cast<char*>(&descriptionSize), sizeof(descriptionSize)) || descriptionSize != description.size())
+		return false;
+
+	string storedDescription(descriptionSize, '\0');
+	if (!file.read(&storedDescription[0], descriptionSize) || storedDescription != description)
+		return false;
+
+	if (!file.read(reinterpret_cast<char*>(&binarySize), sizeof(binarySize)))
+		return false;
+
+	outBinary.resize(size_t(binarySize));
+	if (!file.read(outBinary.data(), outBinary.size()))
+	{
+		outBinary.clear();
+		return false;
+	}
+
+	return true;
+}
+
+static void writeEntry(const string& path, const string& description, const vector<char>& binary)
+{
+	error_code ec;
+	fs::create_directories(fs::path(path).parent_path(), ec);
+
+	// Write into a temporary file and rename it, so that concurrent readers never see a partial entry,
+	// and concurrent writers of the same entry (which have identical contents) don't corrupt each other
+	ostringstream tempPath;
+	tempPath << path << "." << hash<thread::id>()(this_thread::get_id()) << ".tmp";
+
+	{
+		ofstream file(tempPath.str(), ios::binary);
+		if (!file.is_open())
+			return;
+
+		uint32_t descriptionSize = (uint32_t)description.size();
+		uint64_t binarySize = binary.size();
+
+		file.write(c_CacheEntryMagic, sizeof(c_CacheEntryMagic));
+		file.write(reinterpret_cast<const char*>(&descriptionSize), sizeof(descriptionSize));
+		file.write(description.data(), description.size());
+		file.write(reinterpret_cast<const char*>(&binarySize), sizeof(binarySize));
+		file.write(binary.data(), binary.size());
+
+		if (!file.good())
+		{
+			file.close();
+			fs::remove(tempPath.str(), ec);
+			return;
+		}
+	}
+
+	fs::rename(tempPath.str(), path, ec);
+	if (ec)
+		fs::remove(tempPath.str(), ec);
+}
+
+bool ShaderCache::init(const string& localDirectory, const string& sharedDirectory, string& outErrorMessage)
+{
+	m_LocalDirectory = localDirectory;
+	m_SharedDirectory = sharedDirectory;
+
+	if (!m_LocalDirectory.empty())
+	{
+		error_code ec;
+		fs::create_directories(m_LocalDirectory, ec);
+		if (!fs::is_directory(m_LocalDirectory))
+		{
+			outErrorMessage = "cannot create the cache directory " + m_LocalDirectory;
+			m_LocalDirectory.clear();
+			return false;
+		}
+	}
+
+	// The shared cache may be temporarily unavailable, which just means that everything is compiled locally
+	if (!m_SharedDirectory.empty() && !fs::is_directory(m_SharedDirectory))
+	{
+		outErrorMessage = "the shared cache directory " + m_SharedDirectory + " is not available";
+		m_SharedDirectory.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCache::fetch(uint64_t key, const string& description, vector<char>& outBinary)
+{
+	if (!m_LocalDirectory.empty() && readEntry(getEntryPath(m_LocalDirectory, key), description, outBinary))
+		return true;
+
+	if (!m_SharedDirectory.empty() && readEntry(getEntryPath(m_SharedDirectory, key), description, outBinary))
+	{
+		if (!m_LocalDirectory.empty())
+			writeEntry(getEntryPath(m_LocalDirectory, key), description, outBinary);
+
+		return true;
+	}
+
+	return false;
+}
+
+void ShaderCache::store(uint64_t key, const string& description, const vector<char>& binary)
+{
+	if (!m_LocalDirectory.empty())
+		writeEntry(getEntryPath(m_LocalDirectory, key), description, binary);
+
+	if (!m_SharedDirectory.empty())
+		writeEntry(getEntryPath(m_SharedDirectory, key), description, binary);
+}
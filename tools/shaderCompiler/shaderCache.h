@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2014-2021, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+// Content-addressed compilation cache.
+// Every shader permutation is identified by a key that is computed from the contents of its source file and
+// all the files it includes, the target, entry point, defines, compiler options, and the compiler identity.
+// Compiled binaries are stored in a local cache directory and, optionally, in a shared directory that can be
+// located on a network drive and used by multiple machines. Unchanged permutations are fetched from
+// either directory instead of being recompiled, regardless of the file timestamps.
+
+// 64-bit FNV-1a hash of a memory range, can be chained through 'hash'.
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+inline uint64_t hashString(const std::string& s, uint64_t hash = 0xcbf29ce484222325ull)
+{
+	// Include the terminating zero so that adjacent strings don't merge together
+	return hashBytes(s.c_str(), s.size() + 1, hash);
+}
+
+struct SourceFileInfo
+{
+	int64_t writeTime = 0;
+	uint64_t fileSize = 0;
+	uint64_t contentHash = 0;
+	// Names of the included files exactly as written in the #include directives, in source order
+	std::vector<std::string> includes;
+};
+
+// Persistent database of source file hashes and include directives.
+// Files whose size and write time match the database are not opened again.
+class DependencyDatabase
+{
+public:
+	// Loads the database, a missing or corrupted file results in an empty database.
+	void load(const std::string& fileName);
+
+	// Writes the database if anything has changed since it was loaded.
+	bool save(const std::string& fileName);
+
+	// Returns the information for a file, parsing the file if it's not in the database or has changed.
+	// Returns nullptr if the file cannot be read. Not thread-safe.
+	const SourceFileInfo* getFileInfo(const std::string& fileName, bool parseIncludes = true);
+
+private:
+	std::map<std::string, SourceFileInfo> m_Files;
+	bool m_Modified = false;
+};
+
+class ShaderCache
+{
+public:
+	// Either directory can be empty; the cache is enabled when at least one of them is set.
+	// Returns false if a directory is not usable, the cache then works with the other one.
+	bool init(const std::string& localDirectory, const std::string& sharedDirectory, std::string& outErrorMessage);
+	
+	bool isEnabled() const { return !m_LocalDirectory.empty() || !m_SharedDirectory.empty(); }
+
+	// Looks up a binary in the local cache, then in the shared one. Binaries found in the shared cache are copied
+	// into the local cache. 'description' is the full key text, it's compared with the stored one to rule out hash collisions.
+	// Thread-safe.
+	bool fetch(uint64_t key, const std::string& description, std::vector<char>& outBinary);
+
+	// Writes a binary into both cache directories. Failures are not fatal and are ignored. Thread-safe.
+	void store(uint64_t key, const std::string& description, const std::vector<char>& binary);
+
+private:
+	std::string m_LocalDirectory;
+	std::string m_SharedDirectory;
+};
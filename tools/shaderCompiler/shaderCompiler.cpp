@@ -21,16 +21,25 @@
 */
 
 #include "options.h"
+#include "inProcessCompiler.h"
+#include "shaderCache.h"
+#include "buildStatistics.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <map>
 #include <list>
+#include <deque>
+#include <memory>
+#include <chrono>
 #include <cstdio>
-#include <regex>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <csignal>
+#include <limits>
 #include <nvrhi/common/shader-blob.h>
 #include <nvrhi/common/misc.h>
 
@@ -62,28 +71,73 @@ struct CompileTask
 	string entryPoint;
 	string combinedDefines;
 	string commandLine;
+
+	// Used by the in-process compilation
+	CompilerOptions compilerOptions;
+	fs::path outputFile;
+	string blobName; // empty if the shader has no permutations
+	size_t blobEntryIndex = 0;
+
+	// Used by the compilation cache
+	string cacheDescription;
+	uint64_t cacheKey = 0;
+
+	// Used by the scheduler and the timing report
+	string historyKey;
+	double predictedDuration = 0.0;
+	chrono::steady_clock::time_point startTime;
+	unsigned int threadIndex = 0;
+};
+
+// Every worker thread has its own queue, sorted from the longest task to the shortest.
+// Workers take tasks from the front of their own queue, and steal from the back of other queues when theirs is empty.
+struct WorkerQueue
+{
+	mutex queueMutex;
+	deque<CompileTask> tasks;
 };
 
 vector<CompileTask> g_CompileTasks;
+vector<unique_ptr<WorkerQueue>> g_WorkerQueues;
+TaskDurationHistory g_DurationHistory;
+vector<TaskTiming> g_TaskTimings;
 int g_OriginalTaskCount;
 atomic<int> g_ProcessedTaskCount;
-mutex g_TaskMutex;
 mutex g_ReportMutex;
 bool g_Terminate = false;
 bool g_CompileSuccess = true;
+bool g_InProcess = false;
 fs::file_time_type g_ConfigWriteTime;
 
 struct BlobEntry
 {
 	fs::path compiledPermutationFile;
 	string permutation;
+
+	// Filled by the in-process compilation, which doesn't need the intermediate file
+	vector<char> binary;
+	bool compiledInMemory = false;
 };
 
 map<string, vector<BlobEntry>> g_ShaderBlobs;
 
-map<fs::path, fs::file_time_type> g_HierarchicalUpdateTimes;
+struct SourceHierarchy
+{
+	fs::file_time_type updateTime;
+	uint64_t contentHash = 0;
+};
+
+map<fs::path, SourceHierarchy> g_SourceHierarchies;
 vector<fs::path> g_IgnoreIncludes;
 
+DependencyDatabase g_Dependencies;
+ShaderCache g_ShaderCache;
+uint64_t g_CompilerHash = 0;
+atomic<int> g_CachedTaskCount;
+
+// Increment when the cache entries produced by the same inputs become incompatible
+const int c_CacheVersion = 1;
+
 const char* g_SharedCompilerOptions = "-nologo ";
 
 string path_string(fs::path path)
@@ -91,19 +145,19 @@ string path_string(fs::path path)
 	return path.make_preferred().string();
 }
 
-bool getHierarchicalUpdateTime(const fs::path& rootFilePath, list<fs::path>& callStack, fs::file_time_type& outTime)
+// Finds the latest update time and the combined content hash of a source file and everything it includes.
+// The include directives come from the dependency database, so only the files that have changed are parsed.
+bool getSourceHierarchy(const fs::path& rootFilePath, list<fs::path>& callStack, SourceHierarchy& outHierarchy)
 {
-	static basic_regex<char> include_pattern("\\s*#include\\s+[\"<]([^>\"]+)[>\"].*");
-
-	auto found = g_HierarchicalUpdateTimes.find(rootFilePath);
-	if (found != g_HierarchicalUpdateTimes.end())
+	auto found = g_SourceHierarchies.find(rootFilePath);
+	if (found != g_SourceHierarchies.end())
 	{
-		outTime = found->second;
+		outHierarchy = found->second;
 		return true;
 	}
 
-	ifstream inputFile(rootFilePath);
-	if (!inputFile.is_open())
+	const SourceFileInfo* fileInfo = g_Dependencies.getFileInfo(fs::absolute(rootFilePath).generic_string());
+	if (!fileInfo)
 	{
 		cout << "ERROR: Cannot open file  " << path_string(rootFilePath) << endl;
 		for (const fs::path& otherPath : callStack)
@@ -115,72 +169,70 @@ bool getHierarchicalUpdateTime(const fs::path& rootFilePath, list<fs::path>& cal
 	callStack.push_front(rootFilePath);
 
 	fs::path rootBasePath = rootFilePath.parent_path();
-	fs::file_time_type hierarchicalUpdateTime = fs::last_write_time(rootFilePath);
+	SourceHierarchy hierarchy;
+	hierarchy.updateTime = fs::file_time_type(fs::file_time_type::duration(fileInfo->writeTime));
+	hierarchy.contentHash = fileInfo->contentHash;
 
-	uint32_t lineno = 0;
-	for (string line; getline(inputFile, line);)
+	// Copy the include list because parsing the included files can modify the database
+	const vector<string> includes = fileInfo->includes;
+
+	for (const string& includeName : includes)
 	{
-		lineno++;
+		fs::path include = includeName;
 
-		std::match_results<const char*> result;
-		std::regex_match(line.c_str(), result, include_pattern);
-		if (!result.empty())
+		bool ignoreThisInclude = false;
+		for (const fs::path& ignoredPath : g_IgnoreIncludes)
 		{
-			fs::path include = string(result[1]);
-
-			bool ignoreThisInclude = false;
-			for (const fs::path& ignoredPath : g_IgnoreIncludes)
+			if (ignoredPath == include)
 			{
-				if (ignoredPath == include)
-				{
-					ignoreThisInclude = true;
-					break;
-				}
+				ignoreThisInclude = true;
+				break;
 			}
+		}
 
-			if (ignoreThisInclude)
-				continue;
+		if (ignoreThisInclude)
+			continue;
 
-			bool foundIncludedFile = false;
-			fs::path includedFilePath = rootBasePath / include;
-			if (fs::exists(includedFilePath))
-			{
-				foundIncludedFile = true;
-			}
-			else
+		bool foundIncludedFile = false;
+		fs::path includedFilePath = rootBasePath / include;
+		if (fs::exists(includedFilePath))
+		{
+			foundIncludedFile = true;
+		}
+		else
+		{
+			for (const string& includePath : g_Options.includePaths)
 			{
-				for (const string& includePath : g_Options.includePaths)
+				includedFilePath = includePath / include;
+				if (fs::exists(includedFilePath))
 				{
-					includedFilePath = includePath / include;
-					if (fs::exists(includedFilePath))
-					{
-						foundIncludedFile = true;
-						break;
-					}
+					foundIncludedFile = true;
+					break;
 				}
 			}
+		}
 
-			if (!foundIncludedFile)
-			{
-				cout << "ERROR: Cannot find include file  " << path_string(include) << endl;
-				for (const fs::path& otherPath : callStack)
-					cout << "                    included in  " << path_string(otherPath) << endl;
+		if (!foundIncludedFile)
+		{
+			cout << "ERROR: Cannot find include file  " << path_string(include) << endl;
+			for (const fs::path& otherPath : callStack)
+				cout << "                    included in  " << path_string(otherPath) << endl;
 
-				return false;
-			}
+			return false;
+		}
 
-			fs::file_time_type dependencyTime;
-			if (!getHierarchicalUpdateTime(includedFilePath, callStack, dependencyTime))
-				return false;
+		SourceHierarchy dependency;
+		if (!getSourceHierarchy(includedFilePath, callStack, dependency))
+			return false;
 
-			hierarchicalUpdateTime = std::max(dependencyTime, hierarchicalUpdateTime);
-		}
+		hierarchy.updateTime = std::max(dependency.updateTime, hierarchy.updateTime);
+		hierarchy.contentHash = hashBytes(&dependency.contentHash, sizeof(dependency.contentHash), hierarchy.contentHash);
 	}
 
 	callStack.pop_front();
 
-	g_HierarchicalUpdateTimes[rootFilePath] = hierarchicalUpdateTime;
-	outTime = hierarchicalUpdateTime;
+	g_SourceHierarchies[rootFilePath] = hierarchy;
+	outHierarchy = hierarchy;
 
 	return true;
 }
@@ -228,6 +280,33 @@ string buildCompilerCommandLine(const CompilerOptions& options, const fs::path&
 	return ss.str();
 }
 
+// Builds the text that identifies a compilation for the cache. It must not contain any machine-specific data
+// like absolute paths, so that the entries in a shared cache can be used by different machines.
+string buildCacheDescription(const CompilerOptions& options, const SourceHierarchy& sourceHierarchy)
+{
+	std::ostringstream ss;
+	ss << "version " << c_CacheVersion << "\n";
+	ss << "platform " << g_PlatformName << "\n";
+	ss << "compiler " << std::hex << g_CompilerHash << std::dec << "\n";
+	ss << "source " << options.shaderName << " " << std::hex << sourceHierarchy.contentHash << std::dec << "\n";
+	ss << "target " << options.target << "\n";
+	ss << "entry " << options.entryPoint << "\n";
+	for (const string& define : options.definitions)
+		ss << "define " << define << "\n";
+	for (const string& define : g_Options.additionalDefines)
+		ss << "define " << define << "\n";
+	for (const string& option : g_Options.additionalCompilerOptions)
+		ss << "option " << option << "\n";
+
+	if (g_Options.platform == Platform::SPIRV)
+	{
+		ss << "shifts " << g_Options.vulkanTextureShift << " " << g_Options.vulkanSamplerShift << " "
+			<< g_Options.vulkanConstantShift << " " << g_Options.vulkanUavShift << "\n";
+	}
+
+	return ss.str();
+}
+
 void printError(uint32_t lineno, const string& error)
 {
 	cerr << g_Options.inputFile << "(" << lineno << "): " << error << endl;
@@ -284,6 +363,9 @@ bool processShaderConfig(uint32_t lineno, const string& shaderConfig)
 
 	fs::path sourceFile = fs::path(g_Options.inputFile).parent_path() / compilerOptions.shaderName;
 
+	SourceHierarchy sourceHierarchy;
+	bool haveSourceHierarchy = false;
+
 	fs::path compiledShaderPath = g_Options.outputPath / compiledShaderName.parent_path();
 	if (!fs::exists(compiledShaderPath))
 	{
@@ -297,12 +379,13 @@ bool processShaderConfig(uint32_t lineno, const string& shaderConfig)
 		{
 			fs::file_time_type compiledFileTime = fs::last_write_time(compiledShaderFile);
 
-			fs::file_time_type sourceHierarchyTime;
 			list<fs::path> callStack;
-			if (!getHierarchicalUpdateTime(sourceFile, callStack, sourceHierarchyTime))
+			if (!getSourceHierarchy(sourceFile, callStack, sourceHierarchy))
 				return false;
 
-			sourceHierarchyTime = std::max(sourceHierarchyTime, g_ConfigWriteTime);
+			haveSourceHierarchy = true;
+
+			fs::file_time_type sourceHierarchyTime = std::max(sourceHierarchy.updateTime, g_ConfigWriteTime);
 
 			if (compiledFileTime > sourceHierarchyTime)
 				return true;
@@ -329,7 +412,21 @@ bool processShaderConfig(uint32_t lineno, const string& shaderConfig)
 	task.entryPoint = compilerOptions.entryPoint;
 	task.combinedDefines = combinedDefines.str();
 	task.commandLine = commandLine;
-	g_CompileTasks.push_back(task);
+	task.compilerOptions = compilerOptions;
+	task.outputFile = compiledPermutationFile;
+
+	if (g_ShaderCache.isEnabled())
+	{
+		if (!haveSourceHierarchy)
+		{
+			list<fs::path> callStack;
+			if (!getSourceHierarchy(sourceFile, callStack, sourceHierarchy))
+				return false;
+		}
+
+		task.cacheDescription = buildCacheDescription(compilerOptions, sourceHierarchy);
+		task.cacheKey = hashString(task.cacheDescription);
+	}
 
 	if (!compilerOptions.definitions.empty())
 	{
@@ -338,9 +435,16 @@ bool processShaderConfig(uint32_t lineno, const string& shaderConfig)
 		entry.permutation = combinedDefines.str();
 
 		vector<BlobEntry>& entries = g_ShaderBlobs[path_string(compiledShaderName)];
+		task.blobName = path_string(compiledShaderName);
+		task.blobEntryIndex = entries.size();
 		entries.push_back(entry);
 	}
 
+	task.historyKey = task.shaderName + ":" + task.entryPoint + " " + compilerOptions.target + " " + task.combinedDefines;
+	task.predictedDuration = g_DurationHistory.get(task.historyKey);
+
+	g_CompileTasks.push_back(task);
+
 	return true;
 }
 
@@ -409,8 +513,211 @@ bool trim(string& s)
 	return !s.empty();
 }
 
-bool WriteShaderBlob(const string& compiledShaderName, const vector<BlobEntry>& entries)
+// Returns the binary of a compiled permutation, reading and removing the intermediate file if it wasn't compiled in memory.
+bool getBlobEntryBinary(BlobEntry& entry, vector<char>& outBinary)
+{
+	if (entry.compiledInMemory)
+	{
+		outBinary = std::move(entry.binary);
+		return true;
+	}
+
+	string inputFileName = path_string(entry.compiledPermutationFile);
+	FILE* inputFile = fopen(inputFileName.c_str(), "rb");
+
+	if (!inputFile)
+	{
+		cout << "ERROR: cannot read " << inputFileName << endl;
+		return false;
+	}
+
+	fseek(inputFile, 0, SEEK_END);
+	size_t fileSize = ftell(inputFile);
+	fseek(inputFile, 0, SEEK_SET);
+
+	if (fileSize > size_t(std::numeric_limits<uint32_t>::max()))
+	{
+		cout << "ERROR: binary shader file too big: " << inputFileName << endl;
+		fclose(inputFile);
+		outBinary.clear();
+		return true;
+	}
+
+	outBinary.resize(fileSize);
+	fread(outBinary.data(), 1, fileSize, inputFile);
+	fclose(inputFile);
+
+	if (!g_Options.keep)
+	{
+		fs::remove(inputFileName);
+	}
+
+	return true;
+}
+
+void WriteShaderBlobV1(FILE* outputFile, const vector<BlobEntry>& entries, const vector<vector<char>>& binaries)
 {
+	fwrite("NVSP", 1, 4, outputFile);
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const BlobEntry& entry = entries[i];
+		const vector<char>& binary = binaries[i];
+
+		if (binary.empty())
+			continue;
+
+		nvrhi::ShaderBlobEntry binaryEntry;
+		binaryEntry.permutationSize = (uint32_t)entry.permutation.size();
+		binaryEntry.dataSize = (uint32_t)binary.size();
+
+		fwrite(&binaryEntry, 1, sizeof(binaryEntry), outputFile);
+		fwrite(entry.permutation.data(), 1, entry.permutation.size(), outputFile);
+		fwrite(binary.data(), 1, binary.size(), outputFile);
+	}
+}
+
+void WriteShaderBlobV2(FILE* outputFile, const vector<BlobEntry>& entries, const vector<vector<char>>& binaries)
+{
+	struct IndexedPermutation
+	{
+		string permutation;
+		const vector<char>* binary;
+		vector<uint8_t> compressedBinary;
+		uint64_t hash;
+	};
+
+	vector<IndexedPermutation> permutations;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (binaries[i].empty())
+			continue;
+
+		// The permutation strings are stored without the trailing space
+		IndexedPermutation permutation;
+		permutation.permutation = entries[i].permutation;
+		while (!permutation.permutation.empty() && permutation.permutation.back() == ' ')
+			permutation.permutation.pop_back();
+		permutation.binary = &binaries[i];
+		permutation.hash = nvrhi::hashShaderPermutation(permutation.permutation.data(), permutation.permutation.size());
+		permutations.push_back(std::move(permutation));
+	}
+
+	std::sort(permutations.begin(), permutations.end(), [](const IndexedPermutation& a, const IndexedPermutation& b) {
+		return a.hash != b.hash ? a.hash < b.hash : a.permutation < b.permutation;
+	});
+
+	nvrhi::ShaderBlobHeader header{};
+	memcpy(header.signature, "NVS2", 4);
+	header.permutationCount = (uint32_t)permutations.size();
+	header.payloadAlignment = nvrhi::c_ShaderBlobAlignment;
+	header.flags = g_Options.compressBlob ? nvrhi::c_ShaderBlobFlagCompressed : 0;
+
+	// Use the beginning of a median-sized binary as the dictionary for all binaries in the blob.
+	// The permutations are compiled from the same source, so their contents are similar.
+	nvrhi::ShaderBlobDictionary dictionary{};
+	const vector<char>* dictionarySource = nullptr;
+	if (g_Options.compressBlob && permutations.size() > 1)
+	{
+		vector<const vector<char>*> binariesBySize;
+		for (const IndexedPermutation& permutation : permutations)
+			binariesBySize.push_back(permutation.binary);
+
+		std::nth_element(binariesBySize.begin(), binariesBySize.begin() + binariesBySize.size() / 2, binariesBySize.end(),
+			[](const vector<char>* a, const vector<char>* b) { return a->size() < b->size(); });
+
+		dictionarySource = binariesBySize[binariesBySize.size() / 2];
+		dictionary.size = std::min(dictionarySource->size(), nvrhi::c_ShaderBlobMaxDictionarySize);
+	}
+
+	if (g_Options.compressBlob)
+	{
+		for (IndexedPermutation& permutation : permutations)
+		{
+			permutation.compressedBinary = nvrhi::compressShaderBinary(permutation.binary->data(), permutation.binary->size(),
+				dictionarySource ? dictionarySource->data() : nullptr, size_t(dictionary.size));
+		}
+	}
+
+	vector<nvrhi::ShaderBlobIndexEntry> index(permutations.size());
+
+	uint64_t offset = sizeof(header) + sizeof(nvrhi::ShaderBlobIndexEntry) * index.size();
+	if (g_Options.compressBlob)
+		offset += sizeof(dictionary);
+
+	for (size_t i = 0; i < permutations.size(); i++)
+	{
+		index[i].permutationHash = permutations[i].hash;
+		index[i].permutationOffset = (uint32_t)offset;
+		index[i].permutationSize = (uint32_t)permutations[i].permutation.size();
+		offset += permutations[i].permutation.size();
+	}
+
+	if (dictionary.size)
+	{
+		offset = nvrhi::align<uint64_t>(offset, nvrhi::c_ShaderBlobAlignment);
+		dictionary.offset = offset;
+		offset += dictionary.size;
+	}
+
+	for (size_t i = 0; i < permutations.size(); i++)
+	{
+		offset = nvrhi::align<uint64_t>(offset, nvrhi::c_ShaderBlobAlignment);
+		index[i].dataOffset = offset;
+		index[i].dataSize = g_Options.compressBlob
+			? sizeof(nvrhi::ShaderBlobCompressedPayload) + permutations[i].compressedBinary.size()
+			: permutations[i].binary->size();
+		offset += index[i].dataSize;
+	}
+
+	fwrite(&header, 1, sizeof(header), outputFile);
+	fwrite(index.data(), sizeof(nvrhi::ShaderBlobIndexEntry), index.size(), outputFile);
+	if (g_Options.compressBlob)
+		fwrite(&dictionary, 1, sizeof(dictionary), outputFile);
+	
+	for (const IndexedPermutation& permutation : permutations)
+		fwrite(permutation.permutation.data(), 1, permutation.permutation.size(), outputFile);
+
+	const char padding[nvrhi::c_ShaderBlobAlignment] = {};
+	auto writePadding = [outputFile, &padding](uint64_t dataOffset)
+	{
+		uint64_t position = (uint64_t)ftell(outputFile);
+		if (position < dataOffset)
+			fwrite(padding, 1, size_t(dataOffset - position), outputFile);
+	};
+
+	if (dictionary.size)
+	{
+		writePadding(dictionary.offset);
+		fwrite(dictionarySource->data(), 1, size_t(dictionary.size), outputFile);
+	}
+
+	for (size_t i = 0; i < permutations.size(); i++)
+	{
+		writePadding(index[i].dataOffset);
+
+		if (g_Options.compressBlob)
+		{
+			nvrhi::ShaderBlobCompressedPayload payload{};
+			payload.uncompressedSize = (uint32_t)permutations[i].binary->size();
+
+			fwrite(&payload, 1, sizeof(payload), outputFile);
+			fwrite(permutations[i].compressedBinary.data(), 1, permutations[i].compressedBinary.size(), outputFile);
+		}
+		else
+			fwrite(permutations[i].binary->data(), 1, permutations[i].binary->size(), outputFile);
+	}
+}
+
+bool WriteShaderBlob(const string& compiledShaderName, vector<BlobEntry>& entries)
+{
+	vector<vector<char>> binaries(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (!getBlobEntryBinary(entries[i], binaries[i]))
+			return false;
+	}
+
 	fs::path outputFilePath = fs::path(g_Options.outputPath) / compiledShaderName;
 	string outputFileName = path_string(outputFilePath);
 
@@ -426,72 +733,212 @@ bool WriteShaderBlob(const string& compiledShaderName, const vector<BlobEntry>&
 		cout << "INFO: writing " << outputFileName << endl;
 	}
 
-	fwrite("NVSP", 1, 4, outputFile);
+	if (g_Options.legacyBlob)
+		WriteShaderBlobV1(outputFile, entries, binaries);
+	else
+		WriteShaderBlobV2(outputFile, entries, binaries);
+
+	fclose(outputFile);
+
+	return true;
+}
+
+void reportTaskResult(const CompileTask& task, bool success, const string& messages, bool fromCache = false)
+{
+	g_ProcessedTaskCount++;
 
-	for (const BlobEntry& entry : entries)
+	chrono::duration<double, milli> duration = chrono::steady_clock::now() - task.startTime;
+
+	lock_guard<mutex> guard(g_ReportMutex);
+
+	TaskTiming timing;
+	timing.shaderName = task.shaderName;
+	timing.entryPoint = task.entryPoint;
+	timing.defines = task.combinedDefines;
+	timing.milliseconds = duration.count();
+	timing.threadIndex = task.threadIndex;
+	timing.success = success;
+	timing.fromCache = fromCache;
+	g_TaskTimings.push_back(timing);
+
+	// Cache hits say nothing about the compilation time
+	if (success && !fromCache)
+		g_DurationHistory.set(task.historyKey, timing.milliseconds);
+
+	const char* resultCode = success ? (fromCache ? "CACHE" : " OK  ") : "FAIL ";
+	float progress = (float)g_ProcessedTaskCount / (float)g_OriginalTaskCount;
+
+	char buf[1024];
+	snprintf(buf, sizeof(buf), "[%5.1f%%] %s %s %s:%s %s", 
+		progress * 100.f, 
+		g_PlatformName.c_str(), 
+		resultCode, 
+		task.shaderName.c_str(), 
+		task.entryPoint.c_str(), 
+		task.combinedDefines.c_str());
+
+	cout << buf << endl;
+
+	if (!success && !g_Terminate)
 	{
-		string inputFileName = path_string(entry.compiledPermutationFile);
-		FILE* inputFile = fopen(inputFileName.c_str(), "rb");
+		cout << "ERRORS for " << task.shaderName << ":" << task.entryPoint << " " << task.combinedDefines << ": " << endl;
+		cout << messages << endl;
+		g_CompileSuccess = false;
+	}
+}
+
+bool writeBinaryFile(const fs::path& path, const vector<char>& binary)
+{
+	FILE* file = fopen(path_string(path).c_str(), "wb");
+	if (!file)
+		return false;
 
-		if (!inputFile)
+	fwrite(binary.data(), 1, binary.size(), file);
+	fclose(file);
+	return true;
+}
+
+bool readBinaryFile(const fs::path& path, vector<char>& outBinary)
+{
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+		return false;
+
+	outBinary.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	return true;
+}
+
+// Delivers a compiled binary to its destination: either the output file or the shader blob entry.
+bool storeTaskBinary(const CompileTask& task, vector<char>& binary, string& outMessages)
+{
+	if (binary.size() > size_t(std::numeric_limits<uint32_t>::max()))
+	{
+		outMessages = "binary shader too big";
+		return false;
+	}
+
+	if (task.blobName.empty())
+	{
+		// Shaders without permutations are not packed into a blob, write the final output right away
+		if (!writeBinaryFile(task.outputFile, binary))
 		{
-			cout << "ERROR: cannot read " << inputFileName << endl;
-			fclose(outputFile);
+			outMessages = "cannot write " + path_string(task.outputFile);
 			return false;
 		}
+	}
+	else
+	{
+		if (g_Options.keep)
+			writeBinaryFile(task.outputFile, binary);
 
-		fseek(inputFile, 0, SEEK_END);
-		size_t fileSize = ftell(inputFile);
-		fseek(inputFile, 0, SEEK_SET);
+		// The map doesn't change while the threads run, and every task owns its entry
+		BlobEntry& entry = g_ShaderBlobs.find(task.blobName)->second[task.blobEntryIndex];
+		entry.binary = std::move(binary);
+		entry.compiledInMemory = true;
+	}
 
-		if (fileSize == 0)
-		{
-			fclose(inputFile);
-			continue;
-		}
+	return true;
+}
 
-		if (fileSize > size_t(std::numeric_limits<uint32_t>::max()))
-		{
-			cout << "ERROR: binary shader file too big: " << inputFileName << endl;
-			fclose(inputFile);
-			continue;
-		}
+void compileTaskInProcess(const CompileTask& task)
+{
+	vector<char> binary;
+	string messages;
+	bool success = compileInProcess(g_Options, task.compilerOptions, task.sourceFile, binary, messages);
 
-		void* buffer = malloc(fileSize);
-		fread(buffer, 1, fileSize, inputFile);
-		fclose(inputFile);
+	if (success)
+	{
+		if (g_ShaderCache.isEnabled())
+			g_ShaderCache.store(task.cacheKey, task.cacheDescription, binary);
+
+		success = storeTaskBinary(task, binary, messages);
+	}
 
-		if (!g_Options.keep)
+	reportTaskResult(task, success, messages);
+}
+
+// Distributes the tasks between the worker queues, longest first, always to the queue with the least total work.
+// Tasks that are not in the history are expected to take the average time.
+void distributeTasks(unsigned int threadCount)
+{
+	const double defaultDuration = g_DurationHistory.getAverage(1.0);
+	for (CompileTask& task : g_CompileTasks)
+	{
+		if (task.predictedDuration < 0.0)
+			task.predictedDuration = defaultDuration;
+	}
+
+	std::stable_sort(g_CompileTasks.begin(), g_CompileTasks.end(), [](const CompileTask& a, const CompileTask& b) {
+		return a.predictedDuration > b.predictedDuration;
+	});
+
+	vector<double> queueDurations(threadCount, 0.0);
+	g_WorkerQueues.clear();
+	for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+		g_WorkerQueues.push_back(make_unique<WorkerQueue>());
+
+	for (CompileTask& task : g_CompileTasks)
+	{
+		size_t shortestQueue = std::min_element(queueDurations.begin(), queueDurations.end()) - queueDurations.begin();
+		queueDurations[shortestQueue] += task.predictedDuration;
+		g_WorkerQueues[shortestQueue]->tasks.push_back(std::move(task));
+	}
+
+	g_CompileTasks.clear();
+}
+
+bool popTask(unsigned int threadIndex, CompileTask& outTask)
+{
+	{
+		WorkerQueue& queue = *g_WorkerQueues[threadIndex];
+		lock_guard<mutex> guard(queue.queueMutex);
+		if (!queue.tasks.empty())
 		{
-			fs::remove(inputFileName);
+			outTask = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
 		}
-		
-		nvrhi::ShaderBlobEntry binaryEntry;
-		binaryEntry.permutationSize = (uint32_t)entry.permutation.size();
-		binaryEntry.dataSize = (uint32_t)fileSize;
-
-		fwrite(&binaryEntry, 1, sizeof(binaryEntry), outputFile);
-		fwrite(entry.permutation.data(), 1, entry.permutation.size(), outputFile);
-		fwrite(buffer, 1, fileSize, outputFile);
 	}
 
-	fclose(outputFile);
+	// No new tasks are added after the start, so a pass over empty queues means that all work is taken
+	for (size_t offset = 1; offset < g_WorkerQueues.size(); offset++)
+	{
+		WorkerQueue& queue = *g_WorkerQueues[(threadIndex + offset) % g_WorkerQueues.size()];
+		lock_guard<mutex> guard(queue.queueMutex);
+		if (!queue.tasks.empty())
+		{
+			outTask = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
 
-	return true;
+	return false;
 }
 
-void compileThreadProc()
+void compileThreadProc(unsigned int threadIndex)
 {
 	while (!g_Terminate)
 	{
 		CompileTask task;
+		if (!popTask(threadIndex, task))
+			return;
+
+		task.startTime = chrono::steady_clock::now();
+		task.threadIndex = threadIndex;
+
+		if (g_ShaderCache.isEnabled())
 		{
-			lock_guard<mutex> guard(g_TaskMutex);
-			if (g_CompileTasks.empty())
-				return;
+			vector<char> binary;
+			if (g_ShaderCache.fetch(task.cacheKey, task.cacheDescription, binary))
+			{
+				g_CachedTaskCount++;
 
-			task = g_CompileTasks[g_CompileTasks.size() - 1];
-			g_CompileTasks.pop_back();
+				string messages;
+				bool success = storeTaskBinary(task, binary, messages);
+				reportTaskResult(task, success, messages, true);
+				continue;
+			}
 		}
 
 		if (g_Options.verbose)
@@ -500,6 +947,12 @@ void compileThreadProc()
 			cout << task.commandLine << endl;
 		}
 
+		if (g_InProcess)
+		{
+			compileTaskInProcess(task);
+			continue;
+		}
+
 		string commandLine = task.commandLine + " 2>&1";
 
 		FILE* pipe = popen(commandLine.c_str(), "r");
@@ -518,31 +971,15 @@ void compileThreadProc()
 			ss << buf;
 
 		int result = pclose(pipe);
-		g_ProcessedTaskCount++;
 
+		if (result == 0 && g_ShaderCache.isEnabled())
 		{
-			lock_guard<mutex> guard(g_ReportMutex);
-
-			const char* resultCode = (result == 0) ? " OK  " : "FAIL ";
-			float progress = (float)g_ProcessedTaskCount / (float)g_OriginalTaskCount;
-
-			sprintf(buf, "[%5.1f%%] %s %s %s:%s %s", 
-				progress * 100.f, 
-				g_PlatformName.c_str(), 
-				resultCode, 
-				task.shaderName.c_str(), 
-				task.entryPoint.c_str(), 
-				task.combinedDefines.c_str());
-
-			cout << buf << endl;
- 
-			if (result != 0 && !g_Terminate)
-			{
-				cout << "ERRORS for " << task.shaderName << ":" << task.entryPoint << " " << task.combinedDefines << ": " << endl;
-				cout << ss.str() << endl;
-				g_CompileSuccess = false;
-			}
+			vector<char> binary;
+			if (readBinaryFile(task.outputFile, binary))
+				g_ShaderCache.store(task.cacheKey, task.cacheDescription, binary);
 		}
+
+		reportTaskResult(task, result == 0, ss.str());
 	}
 }
 
@@ -581,6 +1018,30 @@ int main(int argc, char** argv)
 
 	// Updated shaderCompiler executable also means everything must be recompiled
 	g_ConfigWriteTime = std::max(g_ConfigWriteTime, fs::last_write_time(argv[0]));
+
+	// The durations are stored in the cache directory if there is one, otherwise next to the outputs
+	fs::path durationHistoryFile = g_Options.cacheDirectory.empty() ? fs::path(g_Options.outputPath) : fs::path(g_Options.cacheDirectory);
+	durationHistoryFile /= "nvrhi-scomp-times-" + g_PlatformName + ".txt";
+	g_DurationHistory.load(path_string(durationHistoryFile));
+
+	fs::path dependencyDatabaseFile;
+	if (!g_Options.cacheDirectory.empty() || !g_Options.sharedCacheDirectory.empty())
+	{
+		string errorMessage;
+		if (!g_ShaderCache.init(g_Options.cacheDirectory, g_Options.sharedCacheDirectory, errorMessage))
+			cout << "INFO: " << errorMessage << endl;
+
+		if (!g_Options.cacheDirectory.empty())
+		{
+			dependencyDatabaseFile = fs::path(g_Options.cacheDirectory) / "dependencies.txt";
+			g_Dependencies.load(path_string(dependencyDatabaseFile));
+		}
+
+		// The compiler library is distributed together with the executable, so the executable identifies the compiler version
+		const SourceFileInfo* compilerInfo = g_Dependencies.getFileInfo(fs::absolute(g_Options.compilerPath).generic_string(), false);
+		if (compilerInfo)
+			g_CompilerHash = compilerInfo->contentHash;
+	}
 	
 	ifstream configFile(g_Options.inputFile);
 	uint32_t lineno = 0;
@@ -595,6 +1056,9 @@ int main(int argc, char** argv)
 			return 1;
 	}
 
+	if (!dependencyDatabaseFile.empty() && !g_Dependencies.save(path_string(dependencyDatabaseFile)))
+		cout << "INFO: cannot write " << path_string(dependencyDatabaseFile) << endl;
+
 	if (g_CompileTasks.empty())
 	{
 		cout << "All " << g_PlatformName << " outputs are up to date." << endl;
@@ -603,6 +1067,16 @@ int main(int argc, char** argv)
 
 	g_OriginalTaskCount = (int)g_CompileTasks.size();
 	g_ProcessedTaskCount = 0;
+	g_CachedTaskCount = 0;
+
+	if (!g_Options.external && isInProcessCompilationSupported(g_Options.platform))
+	{
+		string errorMessage;
+		g_InProcess = initInProcessCompiler(g_Options, errorMessage);
+
+		if (!g_InProcess)
+			cout << "INFO: " << errorMessage << ", running " << g_Options.compilerPath << " for every shader" << endl;
+	}
 
 	{
 		// Workaround for weird behavior of _popen / cmd.exe on Windows
@@ -630,21 +1104,44 @@ int main(int argc, char** argv)
 
 	signal(SIGINT, signal_handler);
 
+	distributeTasks(threadCount);
+
+	auto startTime = chrono::steady_clock::now();
+
 	vector<thread> threads;
 	threads.resize(threadCount);
 	for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++)
 	{
-		threads[threadIndex] = thread(compileThreadProc);
+		threads[threadIndex] = thread(compileThreadProc, threadIndex);
 	}
 	for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++)
 	{
 		threads[threadIndex].join();
 	}
 
+	chrono::duration<double> totalTime = chrono::steady_clock::now() - startTime;
+
+	if (!fs::exists(durationHistoryFile.parent_path()))
+		fs::create_directories(durationHistoryFile.parent_path());
+
+	if (!g_DurationHistory.save(path_string(durationHistoryFile)))
+		cout << "INFO: cannot write " << path_string(durationHistoryFile) << endl;
+
+	if (!g_Options.timingReportFile.empty())
+	{
+		if (writeTimingReport(g_Options.timingReportFile, g_PlatformName, threadCount, totalTime.count(), g_TaskTimings))
+			cout << "INFO: timing report written to " << g_Options.timingReportFile << endl;
+		else
+			cout << "ERROR: cannot write " << g_Options.timingReportFile << endl;
+	}
+
+	if (g_ShaderCache.isEnabled())
+		cout << "INFO: " << g_CachedTaskCount << " of " << g_OriginalTaskCount << " " << g_PlatformName << " shaders were found in the cache." << endl;
+
 	if (!g_CompileSuccess || g_Terminate)
 		return 1;
 
-	for (const pair<const string, vector<BlobEntry>>& it : g_ShaderBlobs)
+	for (pair<const string, vector<BlobEntry>>& it : g_ShaderBlobs)
 	{
 		if (!WriteShaderBlob(it.first, it.second))
 			return 1;